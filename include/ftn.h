@@ -69,6 +69,7 @@ typedef struct {
 #include "ftn/nodelist.h"
 #include "ftn/packet.h"
 #include "ftn/rfc822.h"
+#include "ftn/mime.h"
 #include "ftn/version.h"
 #include "ftn/config.h"
 #include "ftn/router.h"
@@ -0,0 +1,112 @@
+/*
+ * areafix.h - Echo area subscriptions and Areafix robot for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_AREAFIX_H
+#define FTN_AREAFIX_H
+
+#include "ftn.h"
+#include "ftn/packet.h"
+#include <limits.h>
+
+/* Name the Areafix robot answers to */
+#define FTN_AREAFIX_ROBOT_NAME "Areafix"
+
+/* Link bitsets are arrays of words, one bit per link */
+typedef unsigned long ftn_areafix_word_t;
+
+#define FTN_AREAFIX_WORD_BITS (sizeof(ftn_areafix_word_t) * CHAR_BIT)
+#define FTN_AREAFIX_BIT_SET(bits, i) \
+    ((bits)[(i) / FTN_AREAFIX_WORD_BITS] |= 1UL << ((i) % FTN_AREAFIX_WORD_BITS))
+#define FTN_AREAFIX_BIT_CLEAR(bits, i) \
+    ((bits)[(i) / FTN_AREAFIX_WORD_BITS] &= ~(1UL << ((i) % FTN_AREAFIX_WORD_BITS)))
+#define FTN_AREAFIX_BIT_TEST(bits, i) \
+    (((bits)[(i) / FTN_AREAFIX_WORD_BITS] >> ((i) % FTN_AREAFIX_WORD_BITS)) & 1UL)
+
+/* Link (downlink or uplink) */
+typedef struct {
+    ftn_address_t address;            /* Link address */
+    char* password;                   /* Areafix password (NULL for none) */
+    int insecure;                     /* Accept requests and files without a password */
+} ftn_areafix_link_t;
+
+/* Echo area */
+typedef struct {
+    char* tag;                        /* Upper-case area tag */
+    ftn_areafix_word_t* links;        /* Bitset of subscribed links */
+} ftn_areafix_area_t;
+
+/* Subscription table */
+typedef struct {
+    char* db_path;                    /* Path to subscription database */
+    ftn_areafix_link_t* links;        /* Links, indexed by bit number */
+    size_t link_count;
+    size_t link_capacity;
+    size_t words;                     /* Words in each link bitset */
+    ftn_areafix_area_t* areas;        /* Areas, indexed by area ID */
+    size_t area_count;
+    size_t area_capacity;
+    size_t* buckets;                  /* Tag hash index (area ID + 1, 0 = empty) */
+    size_t bucket_count;
+    int modified;                     /* Whether the database needs saving */
+} ftn_areafix_t;
+
+/* Lifecycle */
+ftn_areafix_t* ftn_areafix_new(const char* db_path);
+void ftn_areafix_free(ftn_areafix_t* areafix);
+ftn_error_t ftn_areafix_load(ftn_areafix_t* areafix);
+ftn_error_t ftn_areafix_save(ftn_areafix_t* areafix);
+
+/* Links and areas */
+ftn_error_t ftn_areafix_add_link(ftn_areafix_t* areafix, const ftn_address_t* address,
+                                 const char* password, size_t* link_id);
+int ftn_areafix_find_link(const ftn_areafix_t* areafix, const ftn_address_t* address);
+ftn_error_t ftn_areafix_add_area(ftn_areafix_t* areafix, const char* tag, size_t* area_id);
+int ftn_areafix_find_area(const ftn_areafix_t* areafix, const char* tag);
+
+/* Subscriptions */
+ftn_error_t ftn_areafix_subscribe(ftn_areafix_t* areafix, size_t area_id, size_t link_id);
+ftn_error_t ftn_areafix_unsubscribe(ftn_areafix_t* areafix, size_t area_id, size_t link_id);
+int ftn_areafix_is_subscribed(const ftn_areafix_t* areafix, size_t area_id, size_t link_id);
+
+/*
+ * Bitsets. A bitset is only valid until the next link is added, since
+ * adding links may widen every bitset.
+ */
+ftn_areafix_word_t* ftn_areafix_bitset_new(const ftn_areafix_t* areafix);
+size_t ftn_areafix_bitset_count(const ftn_areafix_t* areafix, const ftn_areafix_word_t* bits);
+
+/* Set the bits of every link listed in a message's SEEN-BY lines */
+ftn_error_t ftn_areafix_seenby_bits(const ftn_areafix_t* areafix, const ftn_message_t* msg,
+                                    ftn_areafix_word_t* bits);
+
+/* Links to export to: subscribed AND NOT seen-by. Returns the link count. */
+size_t ftn_areafix_fanout(const ftn_areafix_t* areafix, size_t area_id,
+                          const ftn_areafix_word_t* seen, ftn_areafix_word_t* out);
+
+/* Areafix robot */
+int ftn_areafix_is_request(const ftn_message_t* msg, const ftn_address_t* local);
+ftn_error_t ftn_areafix_process_request(ftn_areafix_t* areafix, const ftn_message_t* msg, char** response);
+ftn_error_t ftn_areafix_write_reply(const char* outbox, const ftn_address_t* local,
+                                    const ftn_message_t* request, const char* response);
+
+#endif /* FTN_AREAFIX_H */
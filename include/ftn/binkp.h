@@ -46,7 +46,9 @@ typedef enum {
     BINKP_ERROR_NETWORK,
     BINKP_ERROR_TIMEOUT,
     BINKP_ERROR_AUTH_FAILED,
-    BINKP_ERROR_PROTOCOL_ERROR
+    BINKP_ERROR_PROTOCOL_ERROR,
+    BINKP_ERROR_NOMEM,
+    BINKP_ERROR_FILE_IO
 } ftn_binkp_error_t;
 
 /* Binkp frame structure */
@@ -68,6 +70,10 @@ ftn_binkp_error_t ftn_binkp_frame_serialize(const ftn_binkp_frame_t* frame, uint
 ftn_binkp_error_t ftn_binkp_frame_send(ftn_net_connection_t* conn, const ftn_binkp_frame_t* frame);
 ftn_binkp_error_t ftn_binkp_frame_receive(ftn_net_connection_t* conn, ftn_binkp_frame_t* frame, int timeout_ms);
 
+/* Send len bytes of a file at offset as one data frame, with the payload
+   going from the page cache to the socket through ftn_net_sendfile */
+ftn_binkp_error_t ftn_binkp_frame_sendfile(ftn_net_connection_t* conn, int fd, long offset, size_t len);
+
 /* Utility functions */
 size_t ftn_binkp_frame_total_size(const ftn_binkp_frame_t* frame);
 int ftn_binkp_frame_is_command(const ftn_binkp_frame_t* frame);
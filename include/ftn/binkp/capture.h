@@ -0,0 +1,131 @@
+/*
+ * capture.h - Binkp session capture and replay for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_BINKP_CAPTURE_H
+#define FTN_BINKP_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+#include "../binkp.h"
+#include "../config.h"
+
+/*
+ * Capture file layout (all integers big-endian):
+ *
+ *   header:  "BKPCAP2\n" | role (1: 'O' originator, 'A' answerer)
+ *            | 3 reserved bytes | session start (4, unix time)
+ *   record:  direction (1: 'S' sent, 'R' received)
+ *            | microseconds since the previous record (4)
+ *            | binkp frame header (2) | frame data
+ *
+ * The frame length is taken from the binkp header itself, so a record
+ * costs seven bytes on top of the frame as it appeared on the wire.
+ * Offsets are per-frame deltas, so sessions of any length can be
+ * captured; a gap of over 71 minutes between two frames is recorded as
+ * the largest delta. Version 1 captures, which stored the offset from
+ * the session start, can still be replayed.
+ *
+ * M_PWD frames are never written as sent: the password is dropped and
+ * only the command byte is kept. On replay the password of the replay
+ * configuration is put back in its place.
+ */
+#define BINKP_CAPTURE_MAGIC "BKPCAP2\n"
+#define BINKP_CAPTURE_MAGIC_V1 "BKPCAP1\n"
+#define BINKP_CAPTURE_MAGIC_SIZE 8
+#define BINKP_CAPTURE_HEADER_SIZE 16
+#define BINKP_CAPTURE_RECORD_SIZE 7
+
+/* Frame direction, as seen by the local (captured) side */
+typedef enum {
+    BINKP_CAPTURE_SENT = 'S',
+    BINKP_CAPTURE_RECEIVED = 'R'
+} ftn_binkp_capture_dir_t;
+
+/* Open capture stream */
+typedef struct {
+    FILE* file;
+    long last_sec;              /* Time of the previous record */
+    long last_usec;
+    unsigned long frames;
+    unsigned long bytes;
+    int failed;
+} ftn_binkp_capture_t;
+
+/* One captured frame */
+typedef struct {
+    ftn_binkp_capture_dir_t direction;
+    double offset_us;           /* From the session start */
+    ftn_binkp_frame_t frame;
+} ftn_binkp_capture_record_t;
+
+/* Capture loaded for replay */
+typedef struct {
+    int is_originator;          /* Role of the captured side */
+    time_t session_start;
+    ftn_binkp_capture_record_t* records;
+    size_t count;
+    size_t capacity;
+
+    /* Replay cursors: received frames are fed, sent frames are compared */
+    size_t recv_pos;
+    size_t send_pos;
+    int honor_timing;           /* Sleep to reproduce the captured pacing */
+    const char* password;       /* Stands in for redacted M_PWD frames */
+    long start_sec;
+    long start_usec;
+
+    /* Statistics */
+    unsigned long frames_fed;
+    unsigned long frames_sent;
+    unsigned long divergences;
+} ftn_binkp_replay_t;
+
+/* Replay run summary */
+typedef struct {
+    ftn_binkp_error_t result;
+    unsigned long frames_fed;
+    unsigned long frames_sent;
+    unsigned long divergences;
+    unsigned long frames_unused; /* Received frames the engine never read */
+    unsigned long wall_us;
+    unsigned long cpu_us;
+} ftn_binkp_replay_stats_t;
+
+/* Capture */
+ftn_binkp_capture_t* ftn_binkp_capture_open(const char* path, int is_originator);
+ftn_binkp_error_t ftn_binkp_capture_record(ftn_binkp_capture_t* capture, ftn_binkp_capture_dir_t direction, const ftn_binkp_frame_t* frame);
+void ftn_binkp_capture_close(ftn_binkp_capture_t* capture);
+
+/* Replay */
+ftn_binkp_replay_t* ftn_binkp_replay_load(const char* path);
+void ftn_binkp_replay_free(ftn_binkp_replay_t* replay);
+void ftn_binkp_replay_rewind(ftn_binkp_replay_t* replay);
+ftn_binkp_error_t ftn_binkp_replay_receive(ftn_binkp_replay_t* replay, ftn_binkp_frame_t* frame);
+ftn_binkp_error_t ftn_binkp_replay_send(ftn_binkp_replay_t* replay, const ftn_binkp_frame_t* frame);
+
+/* Run a session engine against the capture, with the capture as the remote side */
+ftn_binkp_error_t ftn_binkp_replay_run(ftn_binkp_replay_t* replay, ftn_config_t* config, ftn_binkp_replay_stats_t* stats);
+
+#endif /* FTN_BINKP_CAPTURE_H */
@@ -45,6 +45,13 @@ typedef struct {
     int challenge_generated;
 } ftn_cram_context_t;
 
+/* Incremental MD5 state */
+typedef struct {
+    uint32_t state[4];
+    uint32_t count[2];
+    uint8_t buffer[64];
+} ftn_md5_context_t;
+
 /* CRAM operations */
 ftn_binkp_error_t ftn_cram_init(ftn_cram_context_t* ctx);
 void ftn_cram_free(ftn_cram_context_t* ctx);
@@ -67,6 +74,11 @@ ftn_binkp_error_t ftn_hmac_sha1(const uint8_t* key, size_t key_len, const uint8_
 ftn_binkp_error_t ftn_md5_hash(const uint8_t* data, size_t len, uint8_t* digest);
 ftn_binkp_error_t ftn_sha1_hash(const uint8_t* data, size_t len, uint8_t* digest);
 
+/* MD5 over data supplied in pieces */
+void ftn_md5_init(ftn_md5_context_t* ctx);
+void ftn_md5_update(ftn_md5_context_t* ctx, const void* data, size_t len);
+void ftn_md5_final(ftn_md5_context_t* ctx, uint8_t digest[16]);
+
 /* Utility functions */
 char* ftn_bytes_to_hex(const uint8_t* bytes, size_t len, int lowercase);
 ftn_binkp_error_t ftn_hex_to_bytes(const char* hex, uint8_t** bytes, size_t* len);
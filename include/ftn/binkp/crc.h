@@ -26,6 +26,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <time.h>
 #include "../binkp.h"
 
 /* CRC verification modes */
@@ -69,6 +70,33 @@ typedef struct {
     uint32_t timestamp;
 } ftn_crc_file_info_t;
 
+/* Cached CRC of one file version, keyed by device, inode, size and mtime */
+typedef struct {
+    unsigned long dev;
+    unsigned long ino;
+    unsigned long size;
+    long mtime_sec;
+    long mtime_nsec;
+    uint32_t crc32;
+    time_t last_used;
+} ftn_crc_cache_entry_t;
+
+/* Persistent file CRC cache */
+typedef struct {
+    char* path;                       /* Cache file (NULL for memory only) */
+    ftn_crc_cache_entry_t* entries;
+    size_t count;
+    size_t capacity;
+    size_t* buckets;                  /* (dev, inode) hash index (entry + 1, 0 = empty) */
+    size_t bucket_count;
+    int modified;                     /* Whether the cache needs saving */
+    unsigned long hits;
+    unsigned long misses;
+} ftn_crc_cache_t;
+
+/* Entries not used for this long are dropped when the cache is saved */
+#define FTN_CRC_CACHE_MAX_AGE (30L * 24 * 60 * 60)
+
 /* CRC operations */
 ftn_binkp_error_t ftn_crc_init(ftn_crc_context_t* ctx);
 void ftn_crc_free(ftn_crc_context_t* ctx);
@@ -83,6 +111,20 @@ uint32_t ftn_crc32_calculate(const uint8_t* data, size_t len);
 uint32_t ftn_crc32_update(uint32_t crc, const uint8_t* data, size_t len);
 ftn_binkp_error_t ftn_crc32_file(const char* filename, uint32_t* crc);
 
+/*
+ * CRC cache. Saving merges with entries other processes have saved since
+ * the cache was loaded, so one cache file can be shared by every mailer.
+ */
+ftn_crc_cache_t* ftn_crc_cache_new(const char* path);
+void ftn_crc_cache_free(ftn_crc_cache_t* cache);
+ftn_binkp_error_t ftn_crc_cache_load(ftn_crc_cache_t* cache);
+ftn_binkp_error_t ftn_crc_cache_save(ftn_crc_cache_t* cache);
+int ftn_crc_cache_lookup(ftn_crc_cache_t* cache, const char* filename, uint32_t* crc);
+ftn_binkp_error_t ftn_crc_cache_store(ftn_crc_cache_t* cache, const char* filename, uint32_t crc);
+
+/* Like ftn_crc32_file, but only reads files the cache has not seen */
+ftn_binkp_error_t ftn_crc32_file_cached(ftn_crc_cache_t* cache, const char* filename, uint32_t* crc);
+
 /* File CRC operations */
 ftn_binkp_error_t ftn_crc_start_file(ftn_crc_context_t* ctx, const char* filename, uint32_t expected_crc);
 ftn_binkp_error_t ftn_crc_update_file(ftn_crc_context_t* ctx, const uint8_t* data, size_t len);
@@ -112,7 +154,7 @@ ftn_crc_algorithm_t ftn_crc_algorithm_from_name(const char* name);
 void ftn_crc_get_stats(const ftn_crc_context_t* ctx, uint32_t* files_verified, uint32_t* files_failed, uint32_t* bytes_verified);
 double ftn_crc_get_success_rate(const ftn_crc_context_t* ctx);
 
-/* CRC table initialization (call once at startup) */
+/* CRC table initialization (no longer needed; the table is static) */
 void ftn_crc32_init_table(void);
 
 #endif /* FTN_BINKP_CRC_H */
\ No newline at end of file
@@ -26,6 +26,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <time.h>
 #include "../binkp.h"
 #include "zlib.h"
 
@@ -38,6 +39,7 @@ typedef enum {
 
 /* PLZ compression levels */
 typedef enum {
+    PLZ_LEVEL_AUTO = -1,        /* Adapt to the link, see ftn_plz_choose_level */
     PLZ_LEVEL_DEFAULT = 0,
     PLZ_LEVEL_FAST = 1,
     PLZ_LEVEL_NORMAL = 6,
@@ -57,6 +59,19 @@ typedef struct {
     z_stream decompress_stream;
     int compress_initialized;
     int decompress_initialized;
+    int stream_level;           /* zlib level the compress stream is set to */
+
+    /* Adaptive level selection */
+    int adaptive;
+    int current_level;          /* zlib level chosen for the link, 1-9 */
+    uint32_t window_in;         /* Uncompressed bytes in this window */
+    uint32_t window_out;        /* Compressed bytes in this window */
+    double window_compress_us;  /* Time spent in deflate */
+    uint32_t window_drained;    /* Bytes written to the socket */
+    double window_drain_us;     /* Time spent writing them */
+    double compress_rate;       /* Last measured deflate input bytes/s */
+    double drain_rate;          /* Last measured socket bytes/s */
+    int level_changes;
 
     /* Statistics */
     uint32_t bytes_sent_uncompressed;
@@ -71,6 +86,26 @@ typedef struct {
     size_t decompress_buffer_size;
 } ftn_plz_context_t;
 
+/* Adaptive level selection: bytes of input per measurement window */
+#define FTN_PLZ_ADAPT_WINDOW 65536
+
+/* Per-link adaptive level history */
+typedef struct {
+    char* address;
+    int level;
+    double compress_rate;
+    double drain_rate;
+    time_t updated;
+} ftn_plz_link_t;
+
+typedef struct {
+    char* path;
+    ftn_plz_link_t* links;
+    size_t count;
+    size_t capacity;
+    int modified;
+} ftn_plz_history_t;
+
 /* PLZ operations */
 ftn_binkp_error_t ftn_plz_init(ftn_plz_context_t* ctx);
 void ftn_plz_free(ftn_plz_context_t* ctx);
@@ -82,6 +117,20 @@ ftn_binkp_error_t ftn_plz_configure_from_network(ftn_plz_context_t* ctx, const v
 ftn_binkp_error_t ftn_plz_negotiate(ftn_plz_context_t* ctx, const char* remote_option);
 ftn_binkp_error_t ftn_plz_create_option(const ftn_plz_context_t* ctx, char** option);
 
+/* Adaptive level selection */
+ftn_binkp_error_t ftn_plz_set_adaptive(ftn_plz_context_t* ctx, int initial_level);
+void ftn_plz_record_drain(ftn_plz_context_t* ctx, size_t bytes, unsigned long elapsed_us);
+int ftn_plz_choose_level(int level, double compress_rate, double link_rate);
+int ftn_plz_current_level(const ftn_plz_context_t* ctx);
+
+/* Per-link history */
+ftn_plz_history_t* ftn_plz_history_new(const char* path);
+void ftn_plz_history_free(ftn_plz_history_t* history);
+ftn_binkp_error_t ftn_plz_history_load(ftn_plz_history_t* history);
+ftn_binkp_error_t ftn_plz_history_save(ftn_plz_history_t* history);
+int ftn_plz_history_level(const ftn_plz_history_t* history, const char* address);
+ftn_binkp_error_t ftn_plz_history_update(ftn_plz_history_t* history, const char* address, const ftn_plz_context_t* ctx);
+
 /* Compression operations */
 ftn_binkp_error_t ftn_plz_compress_data(ftn_plz_context_t* ctx, const uint8_t* input, size_t input_len,
                                         uint8_t** output, size_t* output_len);
@@ -29,6 +29,8 @@
 #include <time.h>
 #include "../binkp.h"
 #include "commands.h"
+#include "capture.h"
+#include "plz.h"
 #include "../net.h"
 #include "../config.h"
 
@@ -70,7 +72,7 @@ typedef struct {
 } ftn_binkp_file_transfer_t;
 
 /* Session context */
-typedef struct {
+typedef struct ftn_binkp_session {
     ftn_binkp_session_state_t state;
     ftn_net_connection_t* connection;
     ftn_config_t* config;
@@ -103,10 +105,23 @@ typedef struct {
     /* Timeouts */
     int frame_timeout_ms;
     int session_timeout_ms;
+
+    /* Optional frame capture, and replay in place of the connection.
+       Both are owned by the caller, not by the session. */
+    ftn_binkp_capture_t* capture;
+    ftn_binkp_replay_t* replay;
+
+    /* Optional PLZ compression of sent data frames, and the per-link
+       level history for plz_level = auto. Owned by the caller. */
+    ftn_plz_context_t* plz;
+    ftn_plz_history_t* plz_history;
 } ftn_binkp_session_t;
 
 /* Session management */
 ftn_binkp_error_t ftn_binkp_session_init(ftn_binkp_session_t* session, ftn_net_connection_t* conn, ftn_config_t* config, int is_originator);
+ftn_binkp_error_t ftn_binkp_session_init_replay(ftn_binkp_session_t* session, ftn_binkp_replay_t* replay, ftn_config_t* config);
+void ftn_binkp_session_set_capture(ftn_binkp_session_t* session, ftn_binkp_capture_t* capture);
+void ftn_binkp_session_set_plz(ftn_binkp_session_t* session, ftn_plz_context_t* plz, ftn_plz_history_t* history);
 void ftn_binkp_session_free(ftn_binkp_session_t* session);
 
 /* Session execution */
@@ -126,6 +141,13 @@ ftn_binkp_error_t ftn_binkp_process_data(ftn_binkp_session_t* session, const ftn
 /* Session utilities */
 ftn_binkp_error_t ftn_binkp_send_command(ftn_binkp_session_t* session, ftn_binkp_command_t cmd, const char* args);
 ftn_binkp_error_t ftn_binkp_send_frame(ftn_binkp_session_t* session, const ftn_binkp_frame_t* frame);
+
+/*
+ * Send len bytes of an open file at offset as one data frame. The payload
+ * goes through ftn_net_sendfile unless the session compresses, captures
+ * or replays its frames, in which case it is read into a frame first.
+ */
+ftn_binkp_error_t ftn_binkp_send_file_data(ftn_binkp_session_t* session, int fd, long offset, size_t len);
 ftn_binkp_error_t ftn_binkp_receive_frame(ftn_binkp_session_t* session, ftn_binkp_frame_t* frame);
 
 /* File transfer operations */
@@ -27,6 +27,29 @@
 #include "ftn.h"
 #include "log_levels.h"
 
+/* Path template segment kinds */
+typedef enum {
+    FTN_PATH_SEGMENT_LITERAL,
+    FTN_PATH_SEGMENT_USER,
+    FTN_PATH_SEGMENT_NETWORK
+} ftn_path_segment_type_t;
+
+typedef struct {
+    ftn_path_segment_type_t type;
+    const char* text;           /* Literal text, points into the template source */
+    size_t length;
+} ftn_path_segment_t;
+
+/* A path template split into literal text and %USER%/%NETWORK% segments */
+typedef struct {
+    char* source;
+    ftn_path_segment_t* segments;
+    size_t segment_count;
+    size_t literal_length;      /* Total length of the literal segments */
+    int uses_user;
+    int uses_network;
+} ftn_path_template_t;
+
 /* Configuration section structures */
 typedef struct {
     char* name;
@@ -41,12 +64,23 @@ typedef struct {
 
 typedef struct {
     char* path;
+    int pack;                   /* Append articles to per-group pack files */
+    int compress;               /* Deflate articles written to packs */
+    char* nntp;                 /* News server to feed instead of the spool */
+    int nntp_window;            /* CHECK/TAKETHIS commands in flight (0 = default) */
+    int nntp_batch;             /* Articles per feed flush (0 = default) */
+    char* jam;                  /* Root of JAM message bases (may be NULL) */
+    int jam_batch;              /* Messages queued per base before a write (0 = default) */
 } ftn_news_config_t;
 
 typedef struct {
     char* inbox;
+    ftn_path_template_t* inbox_template; /* inbox, compiled at load */
     char* outbox;
     char* sent;
+    char* lmtp;                 /* LMTP socket for delivery instead of Maildir */
+    char* lmtp_domain;          /* Domain appended to LMTP recipients */
+    int lmtp_batch;             /* Messages per pipelined LMTP flush (0 = default) */
 } ftn_mail_config_t;
 
 
@@ -63,6 +97,9 @@ typedef struct {
     int sleep_interval;
     int max_connections;        /* Maximum concurrent connections */
     int poll_interval;          /* Default polling interval in seconds */
+    int toss_budget;            /* Seconds of echomail tossing per cycle (0 = unlimited) */
+    int prefetch_depth;         /* Inbox packets to read ahead while tossing (0 = off) */
+    char* nodelist;             /* Nodelist shared by the daemon's components */
 } ftn_daemon_config_t;
 
 typedef struct {
@@ -78,21 +115,46 @@ typedef struct {
     char* processed;
     char* bad;
     char* duplicate_db;
+    int duplicate_hash;         /* Keep hashed keys instead of MSGIDs in duplicate_db */
+    char* areafix_db;           /* Echo area subscription database */
+    char* fileecho_path;        /* File echo area storage */
+    char* filebox_path;         /* Per-link outgoing file echo copies */
+    char* filefix_db;           /* File echo subscription database */
+    char* freq_dirs;            /* Comma-separated file request directories */
+    char* freq_magic;           /* File request magic names */
+    char* freq_index;           /* Persistent file request index */
+    int freq_limit;             /* Files sent per request (0 = default) */
     /* Mailer-specific fields */
     char* hub_hostname;         /* TCP hostname for binkp connection */
     int hub_port;               /* TCP port (default 24554) */
+    int listen_port;            /* Answer binkp calls on this port (0 = off) */
     char* password;             /* Session password */
     int poll_frequency;         /* Poll interval in seconds */
     int use_cram;               /* Use CRAM authentication */
     int use_compression;        /* Enable compression */
     int use_crc;                /* Enable CRC verification */
+    char* crc_cache;            /* Persistent file CRC cache */
+    char* capture_dir;          /* Directory for binkp session captures */
     int use_nr_mode;            /* Enable Non-Reliable mode */
     char* outbound_path;        /* BSO outbound directory */
+    /* TCP tuning profile */
+    int tcp_bandwidth;          /* Link bandwidth in kbit/s (0 = system buffers) */
+    int tcp_rtt;                /* Round-trip time in ms */
+    int tcp_notsent_lowat;      /* TCP_NOTSENT_LOWAT in bytes (0 = system default) */
+    int tcp_cork;               /* Cork the socket around frame bursts */
+    char* tcp_congestion;       /* Congestion control algorithm, e.g. "bbr" */
+    /* binkps (binkp over TLS) */
+    int use_tls;                /* Wrap the session in TLS */
+    char* tls_ca_file;          /* Verify the uplink against this CA */
+    char* tls_cert_file;        /* Client certificate, if the uplink wants one */
+    char* tls_key_file;         /* Client certificate key */
+    char* tls_fingerprint;      /* Pinned SHA-256 of the uplink certificate */
     /* PLZ compression settings */
     char* plz_mode_str;         /* PLZ mode string (none, supported, required) */
     int plz_mode;               /* PLZ mode as enum value */
     char* plz_level_str;        /* PLZ level string (fast, normal, best) */
     int plz_level;              /* PLZ level as enum value */
+    char* plz_history;          /* Per-link adaptive PLZ level history */
 } ftn_network_config_t;
 
 typedef struct {
@@ -134,6 +196,9 @@ ftn_error_t ftn_config_validate_mailer(const ftn_config_t* config);
 
 /* Path templating functions */
 char* ftn_config_expand_path(const char* template, const char* user, const char* network);
+ftn_path_template_t* ftn_path_template_compile(const char* template);
+void ftn_path_template_free(ftn_path_template_t* tpl);
+char* ftn_path_template_expand(const ftn_path_template_t* tpl, const char* user, const char* network);
 
 /* Accessor functions for configuration sections */
 const ftn_node_config_t* ftn_config_get_node(const ftn_config_t* config);
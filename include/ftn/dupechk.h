@@ -26,8 +26,22 @@
 
 #include "ftn.h"
 #include "ftn/packet.h"
+#include <stdint.h>
 #include <time.h>
 
+/*
+ * By default the database keeps each normalized MSGID as a string. In
+ * hashed mode (ftn_dupecheck_set_hashed()) it keeps a 128-bit MD5 key
+ * and the day the message was first seen, 20 bytes each, in one flat
+ * open-addressed table. Messages without a MSGID are then keyed by a
+ * hash of their names, subject, date and body, plus the area of
+ * echomail or the addresses of netmail, so they are caught too. The
+ * addresses of echomail name the link it came from, not the message,
+ * and are left out. A hashed database is saved with its own header and
+ * loaded in hashed mode; a string database loaded in hashed mode is
+ * converted.
+ */
+
 /* Duplicate checker structure */
 typedef struct {
     char* db_path;                    /* Path to duplicate database file */
@@ -52,12 +66,22 @@ typedef struct {
     time_t timestamp;                 /* When message was first seen */
 } ftn_dupecheck_entry_t;
 
+/* Hashed database entry (internal) */
+typedef struct {
+    uint32_t key[4];                  /* MD5 of the MSGID or the content */
+    uint32_t day;                     /* Days since the epoch when first seen, 0 if free */
+} ftn_dupecheck_key_t;
+
 /* Database structure (internal) */
 typedef struct {
     ftn_dupecheck_entry_t* entries;   /* Array of entries */
     size_t entry_count;               /* Number of entries */
     size_t entry_capacity;            /* Allocated capacity */
     int modified;                     /* Whether database needs saving */
+    int hashed;                       /* Keys are kept instead of entries */
+    ftn_dupecheck_key_t* keys;        /* Open-addressed key table */
+    size_t key_count;                 /* Keys in use */
+    size_t key_capacity;              /* Table size, a power of two */
 } ftn_dupecheck_db_t;
 
 /* Duplicate checker lifecycle */
@@ -79,6 +103,10 @@ ftn_error_t ftn_dupecheck_cleanup_old(ftn_dupecheck_t* dupecheck, time_t cutoff_
 ftn_error_t ftn_dupecheck_get_stats(const ftn_dupecheck_t* dupecheck, ftn_dupecheck_stats_t* stats);
 ftn_error_t ftn_dupecheck_set_retention(ftn_dupecheck_t* dupecheck, time_t retention_days);
 ftn_error_t ftn_dupecheck_set_max_entries(ftn_dupecheck_t* dupecheck, size_t max_entries);
+ftn_error_t ftn_dupecheck_set_hashed(ftn_dupecheck_t* dupecheck, int hashed);
+
+/* Hashed key of a message: its MSGID, or its content when it has none */
+ftn_error_t ftn_dupecheck_message_key(const ftn_message_t* msg, ftn_dupecheck_key_t* key);
 
 /* Utility functions */
 int ftn_dupecheck_is_valid_msgid(const char* msgid);
@@ -93,5 +121,8 @@ ftn_error_t ftn_dupecheck_db_save(ftn_dupecheck_db_t* db, const char* db_path);
 ftn_error_t ftn_dupecheck_db_add_entry(ftn_dupecheck_db_t* db, const char* msgid, time_t timestamp);
 int ftn_dupecheck_db_find_entry(const ftn_dupecheck_db_t* db, const char* msgid);
 ftn_error_t ftn_dupecheck_db_cleanup_old(ftn_dupecheck_db_t* db, time_t cutoff_time);
+ftn_error_t ftn_dupecheck_db_set_hashed(ftn_dupecheck_db_t* db);
+ftn_error_t ftn_dupecheck_db_add_key(ftn_dupecheck_db_t* db, const ftn_dupecheck_key_t* key);
+int ftn_dupecheck_db_find_key(const ftn_dupecheck_db_t* db, const ftn_dupecheck_key_t* key);
 
 #endif /* FTN_DUPECHECK_H */
\ No newline at end of file
@@ -134,4 +134,21 @@ ftn_bso_error_t ftn_flow_update_file(const ftn_flow_file_t* flow);
 int ftn_flow_matches_pattern(const char* filename, const char* pattern);
 ftn_bso_error_t ftn_flow_generate_filename(const struct ftn_address* addr, ftn_flow_type_t type, ftn_flow_flavor_t flavor, char** filename);
 
+/* Outbound queueing */
+ftn_bso_error_t ftn_flow_get_path(const char* outbound_path, const struct ftn_address* addr, ftn_flow_type_t type, ftn_flow_flavor_t flavor, char** path);
+
+/*
+ * Appending takes the node's .bsy for the duration and returns
+ * BSO_ERROR_BUSY if another program holds it. Queueing defers the
+ * reference to a list in the outbound instead, which
+ * ftn_flow_attach_deferred() moves into the flow files of nodes that are
+ * no longer busy; remaining is set to the references still waiting.
+ * A pending file is written as "<filepath>.tmp" and only renamed to
+ * filepath once its reference can be appended.
+ */
+ftn_bso_error_t ftn_flow_append_reference(const char* outbound_path, const struct ftn_address* addr, ftn_flow_flavor_t flavor, const char* filepath, ftn_ref_directive_t directive);
+ftn_bso_error_t ftn_flow_queue_reference(const char* outbound_path, const struct ftn_address* addr, ftn_flow_flavor_t flavor, const char* filepath, ftn_ref_directive_t directive);
+ftn_bso_error_t ftn_flow_queue_pending(const char* outbound_path, const struct ftn_address* addr, ftn_flow_flavor_t flavor, const char* filepath, ftn_ref_directive_t directive);
+ftn_bso_error_t ftn_flow_attach_deferred(const char* outbound_path, size_t* remaining);
+
 #endif /* FTN_FLOW_H */
\ No newline at end of file
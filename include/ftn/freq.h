@@ -0,0 +1,118 @@
+/*
+ * freq.h - File request (FREQ) service for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_FREQ_H
+#define FTN_FREQ_H
+
+#include "ftn.h"
+#include <stddef.h>
+#include <time.h>
+
+/* Files sent for one request unless configured otherwise */
+#define FTN_FREQ_DEFAULT_LIMIT 50
+
+/* Requestable file (or magic name) */
+typedef struct {
+    char* name;                       /* Name as requested */
+    char* key;                        /* Upper-case name used for lookups */
+    char* path;                       /* Full path to send */
+    unsigned long size;
+    time_t mtime;
+    size_t dir;                       /* Owning directory (unused for magic names) */
+} ftn_freq_file_t;
+
+/* Indexed file area directory */
+typedef struct {
+    char* path;
+    time_t mtime;                     /* Directory mtime when last scanned (0 = never) */
+} ftn_freq_dir_t;
+
+/* File request index */
+typedef struct {
+    char* index_path;                 /* Persistent index (NULL for memory only) */
+    ftn_freq_dir_t* dirs;
+    size_t dir_count;
+    size_t dir_capacity;
+    ftn_freq_file_t* files;           /* Sorted by key */
+    size_t file_count;
+    size_t file_capacity;
+    ftn_freq_file_t* magic;           /* Magic names, sorted by key */
+    size_t magic_count;
+    size_t magic_capacity;
+    int modified;                     /* Whether the index needs saving */
+} ftn_freq_index_t;
+
+/* Lifecycle */
+ftn_freq_index_t* ftn_freq_index_new(const char* index_path);
+void ftn_freq_index_free(ftn_freq_index_t* index);
+ftn_error_t ftn_freq_index_load(ftn_freq_index_t* index);
+ftn_error_t ftn_freq_index_save(ftn_freq_index_t* index);
+
+/* Configuration; directories must be added before loading the index */
+ftn_error_t ftn_freq_index_add_dir(ftn_freq_index_t* index, const char* path);
+ftn_error_t ftn_freq_index_add_magic(ftn_freq_index_t* index, const char* name, const char* path);
+ftn_error_t ftn_freq_index_load_magic(ftn_freq_index_t* index, const char* magic_file);
+
+/*
+ * Build an index for a comma-separated list of directories, loading the
+ * persistent index and magic names when given and rescanning only the
+ * directories that changed. Returns NULL on failure.
+ */
+ftn_freq_index_t* ftn_freq_index_open(const char* dirs, const char* index_path, const char* magic_file);
+
+/* Rescan only the directories whose mtime changed since the last scan */
+ftn_error_t ftn_freq_index_update(ftn_freq_index_t* index, size_t* rescanned);
+
+/*
+ * Resolve a request (an exact name, a wildcard pattern or a magic name)
+ * against the index. Fills up to max entries and returns how many matched.
+ * The directories themselves are never read.
+ */
+size_t ftn_freq_resolve(const ftn_freq_index_t* index, const char* request,
+                        const ftn_freq_file_t** results, size_t max);
+
+/* Called for each file that answers a request */
+typedef ftn_error_t (*ftn_freq_send_fn)(const ftn_freq_file_t* file, void* data);
+
+/*
+ * Answer a .req file: send is called for every resolved file, up to
+ * limit files (0 for FTN_FREQ_DEFAULT_LIMIT). A binkp session uses this
+ * to send the files back to its peer in the same session.
+ */
+ftn_error_t ftn_freq_answer_request(const ftn_freq_index_t* index, const char* req_path, size_t limit,
+                                    ftn_freq_send_fn send, void* data, size_t* files_sent);
+
+/*
+ * Answer a .req file on hold: every resolved file is added, without a
+ * directive, to the requester's hold .flo in the outbound. A .req is
+ * named after the node being asked, so the requester must come from
+ * the session's authenticated remote address, never from the file name.
+ */
+ftn_error_t ftn_freq_process_request(const ftn_freq_index_t* index, const char* req_path,
+                                     const char* outbound_path, const ftn_address_t* requester,
+                                     size_t limit, size_t* files_queued);
+
+/* Utility */
+int ftn_freq_is_request_name(const char* filename);
+
+#endif /* FTN_FREQ_H */
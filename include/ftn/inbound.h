@@ -0,0 +1,78 @@
+/*
+ * inbound.h - Inbound packet scheduling for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_INBOUND_H
+#define FTN_INBOUND_H
+
+#include "ftn.h"
+#include <time.h>
+
+/* Packet classes, in the order they are tossed */
+typedef enum {
+    FTN_INBOUND_NETMAIL = 0,          /* Netmail (or empty) packet */
+    FTN_INBOUND_ECHOMAIL,             /* Echomail packet */
+    FTN_INBOUND_UNKNOWN               /* Unreadable or malformed packet */
+} ftn_inbound_class_t;
+
+/* Scheduled inbound packet */
+typedef struct {
+    char* path;                       /* Full path to the packet file */
+    ftn_inbound_class_t pkt_class;    /* Class of the first message */
+    long size;                        /* File size in bytes */
+    time_t mtime;                     /* Last modification time */
+    size_t source;                    /* Caller-defined source (e.g. network index) */
+    int prefetched;                   /* Whether readahead has been requested */
+} ftn_inbound_entry_t;
+
+/* Inbound packet queue */
+typedef struct {
+    ftn_inbound_entry_t* entries;     /* Array of scheduled packets */
+    size_t count;                     /* Number of packets */
+    size_t capacity;                  /* Allocated capacity */
+} ftn_inbound_queue_t;
+
+/* Queue lifecycle */
+ftn_inbound_queue_t* ftn_inbound_queue_new(void);
+void ftn_inbound_queue_free(ftn_inbound_queue_t* queue);
+void ftn_inbound_queue_clear(ftn_inbound_queue_t* queue);
+
+/* Queue operations */
+ftn_error_t ftn_inbound_queue_add(ftn_inbound_queue_t* queue, const char* path,
+                                  ftn_inbound_class_t pkt_class, long size,
+                                  time_t mtime, size_t source);
+void ftn_inbound_queue_sort(ftn_inbound_queue_t* queue);
+
+/* Ask the kernel to read ahead up to depth packets starting at start */
+ftn_error_t ftn_inbound_prefetch(ftn_inbound_queue_t* queue, size_t start, size_t depth);
+
+/* Scan an inbox directory once, classifying and queueing every .pkt file */
+ftn_error_t ftn_inbound_scan(ftn_inbound_queue_t* queue, const char* inbox, size_t source);
+
+/* Classify a packet by peeking at its first message header */
+ftn_error_t ftn_inbound_classify(const char* path, ftn_inbound_class_t* pkt_class);
+
+/* Utility functions */
+int ftn_inbound_is_packet_name(const char* filename);
+const char* ftn_inbound_class_string(ftn_inbound_class_t pkt_class);
+
+#endif /* FTN_INBOUND_H */
@@ -0,0 +1,71 @@
+/*
+ * intern.h - Name interning for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_INTERN_H
+#define FTN_INTERN_H
+
+#include "ftn.h"
+
+/*
+ * Interned names are mapped to small integer IDs that stay valid until
+ * ftn_intern_cleanup() is called. ID 0 is never assigned and means
+ * "no name". The strings returned by the accessors are owned by the
+ * intern table and must not be freed.
+ *
+ * The tables are process-wide. All functions are thread-safe, except
+ * that ftn_intern_cleanup() must not race with other use.
+ *
+ * Names come from incoming mail, so each kind holds at most
+ * FTN_INTERN_MAX_NAMES entries. Once a kind is full ftn_intern()
+ * returns FTN_INTERN_NONE for new names and callers fall back to
+ * working on the plain string.
+ */
+typedef unsigned int ftn_intern_id_t;
+
+#define FTN_INTERN_NONE 0
+#define FTN_INTERN_MAX_NAMES 65536
+
+/* Name kinds, each with its own ID space */
+typedef enum {
+    FTN_INTERN_AREA = 0,              /* Echo area tags (case-insensitive) */
+    FTN_INTERN_USER,                  /* User names (case-sensitive, as they name mailboxes) */
+    FTN_INTERN_NETWORK,               /* Network names (case-sensitive) */
+    FTN_INTERN_KIND_COUNT
+} ftn_intern_kind_t;
+
+/* Map a name to its ID, adding it if needed (FTN_INTERN_NONE on failure) */
+ftn_intern_id_t ftn_intern(ftn_intern_kind_t kind, const char* name);
+
+/* Look up a name without adding it */
+ftn_intern_id_t ftn_intern_find(ftn_intern_kind_t kind, const char* name);
+
+/* Accessors for an interned ID (NULL for unknown IDs) */
+const char* ftn_intern_name(ftn_intern_kind_t kind, ftn_intern_id_t id);
+const char* ftn_intern_lower(ftn_intern_kind_t kind, ftn_intern_id_t id);
+const char* ftn_intern_newsgroup(ftn_intern_id_t network_id, ftn_intern_id_t area_id);
+
+/* Table maintenance */
+size_t ftn_intern_count(ftn_intern_kind_t kind);
+void ftn_intern_cleanup(void);
+
+#endif /* FTN_INTERN_H */
@@ -0,0 +1,128 @@
+/*
+ * jam.h - JAM message base for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_JAM_H
+#define FTN_JAM_H
+
+#include "ftn.h"
+#include <stdint.h>
+
+/*
+ * A JAM message base is four files sharing a base name: the headers
+ * (.jhr), the message text (.jdt), an index of one fixed record per
+ * message number (.jdx) and the lastread file (.jlr). Each index record
+ * holds the CRC of the lowercased recipient name and the offset of the
+ * message header, so a message is found by number with one read and
+ * messages for a user are found by scanning the index alone.
+ *
+ * Appends are queued per base and written by ftn_jam_flush() with one
+ * write per file, while holding an fcntl() lock on the first byte of
+ * the .jhr file. That is the lock other JAM software uses as well, so
+ * the lock is per area and readers of other areas are never blocked.
+ * A flush that fails leaves the base as it was and keeps the queue, so
+ * a later flush writes the same messages.
+ */
+
+#define FTN_JAM_HEADER_SIZE 1024       /* Base header at the start of .jhr */
+#define FTN_JAM_MSGHDR_SIZE 76         /* Fixed part of each message header */
+#define FTN_JAM_INDEX_SIZE 8           /* One .jdx record */
+#define FTN_JAM_DEFAULT_BATCH 64
+
+/* Subfield IDs */
+#define FTN_JAM_OADDRESS       0
+#define FTN_JAM_DADDRESS       1
+#define FTN_JAM_SENDERNAME     2
+#define FTN_JAM_RECEIVERNAME   3
+#define FTN_JAM_MSGID          4
+#define FTN_JAM_REPLYID        5
+#define FTN_JAM_SUBJECT        6
+#define FTN_JAM_PID            7
+#define FTN_JAM_TRACE          8
+#define FTN_JAM_FTSKLUDGE      2000
+#define FTN_JAM_SEENBY2D       2001
+#define FTN_JAM_PATH2D         2002
+#define FTN_JAM_TZUTCINFO      2004
+
+/* Message attributes */
+#define FTN_JAM_MSG_LOCAL       0x00000001UL
+#define FTN_JAM_MSG_INTRANSIT   0x00000002UL
+#define FTN_JAM_MSG_PRIVATE     0x00000004UL
+#define FTN_JAM_MSG_READ        0x00000008UL
+#define FTN_JAM_MSG_SENT        0x00000010UL
+#define FTN_JAM_MSG_KILLSENT    0x00000020UL
+#define FTN_JAM_MSG_HOLD        0x00000080UL
+#define FTN_JAM_MSG_CRASH       0x00000100UL
+#define FTN_JAM_MSG_FILEREQUEST 0x00001000UL
+#define FTN_JAM_MSG_FILEATTACH  0x00002000UL
+#define FTN_JAM_MSG_RECEIPTREQ  0x00010000UL
+#define FTN_JAM_MSG_ORPHAN      0x00040000UL
+#define FTN_JAM_MSG_TYPEECHO    0x01000000UL
+#define FTN_JAM_MSG_TYPENET     0x02000000UL
+
+/* A queued message, with offsets relative to the batch buffers */
+typedef struct {
+    size_t header_offset;
+    size_t text_offset;
+    uint32_t to_crc;
+} ftn_jam_pending_t;
+
+/* An open message base */
+typedef struct {
+    char* path;                  /* Base name without extension */
+    size_t batch_size;           /* Queued messages that call for a flush */
+
+    /* Headers and text of queued messages */
+    unsigned char* headers;
+    size_t headers_len;
+    size_t headers_capacity;
+    unsigned char* text;
+    size_t text_len;
+    size_t text_capacity;
+    ftn_jam_pending_t* pending;
+    size_t pending_count;
+    size_t pending_capacity;
+
+    unsigned long written;       /* Messages written so far */
+} ftn_jam_base_t;
+
+/* Open a base, creating its files if needed. Nothing is read until a flush. */
+ftn_jam_base_t* ftn_jam_open(const char* path, size_t batch_size);
+
+/* Flush queued messages and release the base */
+ftn_error_t ftn_jam_close(ftn_jam_base_t* base);
+
+/* Queue a message; ftn_jam_flush() writes it */
+ftn_error_t ftn_jam_append(ftn_jam_base_t* base, const ftn_message_t* msg);
+int ftn_jam_batch_full(const ftn_jam_base_t* base);
+ftn_error_t ftn_jam_flush(ftn_jam_base_t* base);
+
+/* Readers. Message numbers start at the base's BaseMsgNum, usually 1. */
+ftn_error_t ftn_jam_count(const char* path, unsigned long* first, unsigned long* count);
+ftn_error_t ftn_jam_read(const char* path, unsigned long number, ftn_message_t** msg);
+ftn_error_t ftn_jam_find_recipient(const char* path, const char* name,
+                                   unsigned long* numbers, size_t max, size_t* count);
+
+/* CRC-32 of a lowercased string, as used for JAM names and MSGIDs */
+uint32_t ftn_jam_crc(const char* str);
+
+#endif /* FTN_JAM_H */
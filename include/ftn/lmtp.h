@@ -0,0 +1,83 @@
+/*
+ * lmtp.h - Pipelined LMTP delivery client for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_LMTP_H
+#define FTN_LMTP_H
+
+#include "ftn.h"
+#include "ftn/textproto.h"
+
+#define FTN_LMTP_DEFAULT_PORT 24
+#define FTN_LMTP_DEFAULT_BATCH 64
+#define FTN_LMTP_TIMEOUT_MS 30000
+#define FTN_LMTP_LINE_MAX FTN_TEXTPROTO_LINE_MAX
+
+/* A message waiting for delivery */
+typedef struct {
+    char* user;                  /* Local mailbox name */
+    char* network;               /* Network the message arrived from */
+    char* text;                  /* RFC822 message with LF line endings */
+    int mail_code;               /* Reply to MAIL FROM */
+    int rcpt_code;               /* Reply to RCPT TO */
+    int data_code;               /* Reply to DATA */
+    int status;                  /* Final reply code, 0 if never answered */
+} ftn_lmtp_message_t;
+
+/* LMTP client with a persistent connection */
+typedef struct {
+    ftn_textproto_t proto;       /* Connection, buffers and the last reply */
+    char* domain;                /* Appended to recipients (may be NULL) */
+    int pipelining;              /* Server advertised PIPELINING */
+    int rset_pending;            /* RSET replies still to be read */
+
+    /* Queued messages */
+    ftn_lmtp_message_t* queue;
+    size_t queue_count;
+    size_t queue_capacity;
+    size_t batch_size;           /* Queue length that calls for a flush */
+
+    /* Statistics */
+    unsigned long connections;
+    unsigned long delivered;
+    unsigned long failed;
+} ftn_lmtp_client_t;
+
+/* Client lifecycle */
+ftn_lmtp_client_t* ftn_lmtp_client_new(const char* target, const char* domain, size_t batch_size);
+void ftn_lmtp_client_free(ftn_lmtp_client_t* client);
+
+/* Connection management; ftn_lmtp_flush() connects on demand */
+ftn_error_t ftn_lmtp_connect(ftn_lmtp_client_t* client);
+void ftn_lmtp_disconnect(ftn_lmtp_client_t* client);
+
+/* Queue a message; the client takes ownership of text */
+ftn_error_t ftn_lmtp_queue(ftn_lmtp_client_t* client, const char* user, const char* network, char* text);
+int ftn_lmtp_queue_full(const ftn_lmtp_client_t* client);
+
+/* Deliver every queued message. Afterwards each queue entry holds its
+   final status until ftn_lmtp_clear() is called. */
+ftn_error_t ftn_lmtp_flush(ftn_lmtp_client_t* client);
+int ftn_lmtp_delivered(const ftn_lmtp_message_t* msg);
+void ftn_lmtp_clear(ftn_lmtp_client_t* client);
+
+#endif /* FTN_LMTP_H */
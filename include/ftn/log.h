@@ -27,6 +27,11 @@
 #include <stdarg.h>
 #include "log_levels.h"
 
+/*
+ * The logger is shared by the whole process. All functions here may be
+ * called from any thread; each message is written as one whole line.
+ */
+
 /* Logging initialization and cleanup - using void* to avoid circular includes */
 void ftn_log_init(const void* config);
 void ftn_log_cleanup(void);
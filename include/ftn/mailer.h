@@ -25,6 +25,8 @@
 #define FTN_MAILER_H
 
 #include "ftn.h"
+#include "ftn/transfer.h"
+#include "ftn/tls.h"
 #include <signal.h>
 #include <time.h>
 
@@ -41,14 +43,22 @@ typedef struct {
     time_t last_successful_poll;
     int consecutive_failures;
     ftn_net_connection_t* active_connection;
+    ftn_net_server_t* listener;   /* Open when listen_port is set */
+    ftn_tls_context_t* tls;       /* Created on the first binkps call */
+    ftn_freq_index_t* freq_index; /* Built on first use when freq_dirs is set */
+    ftn_crc_cache_t* crc_cache;   /* Loaded on first use when crc_cache is set */
+    ftn_plz_history_t* plz_history; /* Loaded on first use when plz_history is set */
 } ftn_network_context_t;
 
 /* Main mailer context */
 typedef struct {
     ftn_config_t* config;
+    int owns_config;            /* Config is freed with the context */
     char* config_filename;
+    char* capture_dir;          /* Capture every session here (overrides capture_dir) */
     ftn_network_context_t* networks;
     size_t network_count;
+    ftn_nodelist_t* nodelist;   /* Optional, for hubs without hub_hostname */
 
     /* Daemon settings */
     int daemon_mode;
@@ -71,6 +81,7 @@ typedef struct {
 /* Command line options */
 typedef struct {
     char* config_file;
+    char* capture_dir;
     int daemon_mode;
     int sleep_interval;
     int verbose;
@@ -87,6 +98,16 @@ void ftn_mailer_check_signals(ftn_mailer_context_t* mailer);
 ftn_mailer_context_t* ftn_mailer_context_new(void);
 void ftn_mailer_context_free(ftn_mailer_context_t* ctx);
 ftn_error_t ftn_mailer_context_init(ftn_mailer_context_t* ctx, const ftn_mailer_options_t* options);
+ftn_error_t ftn_mailer_context_attach(ftn_mailer_context_t* ctx, ftn_config_t* config);
+void ftn_mailer_set_nodelist(ftn_mailer_context_t* ctx, ftn_nodelist_t* nodelist);
+
+/*
+ * Carry a running mailer's statistics, PID file, capture directory and
+ * listening sockets over to a context attached to a new config, so a
+ * reload does not reset them. A listener moves to the new network with
+ * the same listen_port and takes that network's tuning.
+ */
+void ftn_mailer_context_adopt(ftn_mailer_context_t* ctx, ftn_mailer_context_t* old);
 
 /* Main application functions */
 ftn_error_t ftn_mailer_parse_args(int argc, char* argv[], ftn_mailer_options_t* options);
@@ -106,8 +127,51 @@ ftn_error_t ftn_mailer_daemon_loop(ftn_mailer_context_t* ctx);
 /* Network operations */
 ftn_error_t ftn_mailer_init_networks(ftn_mailer_context_t* ctx);
 ftn_error_t ftn_mailer_poll_networks(ftn_mailer_context_t* ctx);
+int ftn_mailer_poll_network(ftn_mailer_context_t* ctx, ftn_network_context_t* net, time_t now);
 time_t ftn_mailer_calculate_next_poll(ftn_mailer_context_t* ctx);
 
+/*
+ * Listen for binkp calls on a network's listen_port. The listening
+ * socket carries the network's TCP tuning, so answered sessions get the
+ * same buffers as calls to the hub.
+ */
+ftn_error_t ftn_mailer_open_listener(ftn_network_context_t* net);
+
+/* Open the listener of every network that has a listen_port and none yet */
+void ftn_mailer_open_listeners(ftn_mailer_context_t* ctx);
+
+/*
+ * Answer one call waiting on a network's listener: returns 1 when a call
+ * was answered, 0 when none arrived within timeout_ms and -1 when the
+ * network does not listen.
+ */
+int ftn_mailer_answer_network(ftn_mailer_context_t* ctx, ftn_network_context_t* net, int timeout_ms);
+
+/*
+ * Prepare a session's transfer context for a network: received .req
+ * files are answered from the network's file request index, which is
+ * refreshed here so each session sees new files, and sent files take
+ * their CRCs from the network's CRC cache. CRCs learned in the previous
+ * session are saved here.
+ */
+ftn_error_t ftn_mailer_setup_transfer(ftn_network_context_t* net, ftn_transfer_context_t* transfer);
+
+/*
+ * Set up PLZ for a session with a network from its use_compression,
+ * plz_mode and plz_level keys. With plz_level = auto the session starts
+ * each link at the level remembered in plz_history, and records where
+ * it settled. Levels learned in the previous session are saved here.
+ * The caller frees plz with ftn_plz_free after the session.
+ */
+ftn_error_t ftn_mailer_setup_plz(ftn_network_context_t* net, ftn_binkp_session_t* session, ftn_plz_context_t* plz);
+
+/*
+ * Open a capture file for a session with a network, when --capture or
+ * the network's capture_dir asks for one. Returns NULL when sessions
+ * are not captured or the file cannot be created.
+ */
+ftn_binkp_capture_t* ftn_mailer_open_capture(ftn_mailer_context_t* ctx, ftn_network_context_t* net, int is_originator);
+
 /* Statistics and monitoring */
 void ftn_mailer_dump_statistics(ftn_mailer_context_t* ctx);
 void ftn_mailer_update_stats(ftn_mailer_context_t* ctx, int success, size_t bytes_sent, size_t bytes_received);
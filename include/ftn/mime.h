@@ -0,0 +1,57 @@
+/*
+ * mime.h - MIME body and header decoding for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_MIME_H
+#define FTN_MIME_H
+
+#include <stddef.h>
+
+/* FTN character sets (FTS-5003) that mail can be transcoded into */
+#define FTN_CHRS_UTF8   "UTF-8"
+#define FTN_CHRS_LATIN1 "LATIN-1"
+#define FTN_CHRS_CP437  "CP437"
+#define FTN_CHRS_ASCII  "ASCII"
+
+/* Transfer decoding. The output buffer must hold at least len bytes;
+   both return the number of bytes written. Whitespace and line breaks
+   in base64 input are skipped, and decoding stops at the padding. */
+size_t ftn_mime_base64_decode(const char* in, size_t len, char* out);
+size_t ftn_mime_qp_decode(const char* in, size_t len, char* out, int header);
+
+/* Transcode text from a MIME charset into an FTN character set.
+   Unknown source charsets are copied unchanged; characters the target
+   cannot represent become '?'. Returns a NUL-terminated copy. */
+char* ftn_mime_transcode(const char* in, size_t len, const char* charset, const char* chrs);
+
+/* Decode a message body for FTN: picks the text/plain part of a
+   multipart message, undoes base64 or quoted-printable encoding and
+   transcodes to chrs. Returns NULL if the message has no text body. */
+char* ftn_mime_decode_body(const rfc822_message_t* message, const char* chrs);
+
+/* Decode RFC 2047 encoded words ("=?charset?B?...?=") in a header */
+char* ftn_mime_decode_header(const char* value, const char* chrs);
+
+/* CHRS kludge value for an FTN character set, e.g. "UTF-8 4" */
+const char* ftn_mime_chrs_kludge(const char* chrs);
+
+#endif /* FTN_MIME_H */
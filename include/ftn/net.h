@@ -45,6 +45,19 @@ typedef int ftn_socket_t;
 #define FTN_INVALID_SOCKET (-1)
 #endif
 
+/* Socket buffer limits when sizing from the bandwidth-delay product */
+#define FTN_NET_MIN_BUFFER (64 * 1024)
+#define FTN_NET_MAX_BUFFER (64 * 1024 * 1024)
+
+/* Per-link socket tuning profile */
+typedef struct {
+    unsigned long bandwidth_kbps;   /* Link bandwidth in kbit/s (0 = system buffers) */
+    unsigned long rtt_ms;           /* Round-trip time in milliseconds */
+    int notsent_lowat;              /* TCP_NOTSENT_LOWAT in bytes (0 = system default) */
+    int cork_frames;                /* Cork the socket while sending frame bursts */
+    char congestion[16];            /* Congestion control algorithm ("" = system default) */
+} ftn_net_tuning_t;
+
 /* Network connection structure */
 typedef struct {
     ftn_socket_t socket;
@@ -55,6 +68,11 @@ typedef struct {
     time_t connect_time;
     size_t bytes_sent;
     size_t bytes_received;
+    int cork_frames;                /* From the tuning profile */
+    int corked;
+    void* tls;                      /* TLS session (see tls.h), NULL for plain TCP */
+    int ktls_send;                  /* Kernel encrypts outgoing records */
+    int ktls_recv;                  /* Kernel decrypts incoming records */
 } ftn_net_connection_t;
 
 /* Network server structure */
@@ -64,6 +82,9 @@ typedef struct {
     int listening;
     int max_connections;
     char* bind_address;
+    ftn_net_tuning_t tuning;        /* Applied to accepted connections */
+    int has_tuning;
+    int unix_socket;                /* bind_address is a socket path, removed on free */
 } ftn_net_server_t;
 
 /* Network initialization and cleanup */
@@ -72,6 +93,8 @@ void ftn_net_cleanup(void);
 
 /* Connection management */
 ftn_net_connection_t* ftn_net_connect(const char* hostname, int port, int timeout_ms);
+ftn_net_connection_t* ftn_net_connect_tuned(const char* hostname, int port, int timeout_ms, const ftn_net_tuning_t* tuning);
+ftn_net_connection_t* ftn_net_connect_unix(const char* path, int timeout_ms);
 ftn_error_t ftn_net_disconnect(ftn_net_connection_t* conn);
 void ftn_net_connection_free(ftn_net_connection_t* conn);
 
@@ -80,6 +103,7 @@ ftn_error_t ftn_net_send(ftn_net_connection_t* conn, const void* data, size_t le
 ftn_error_t ftn_net_recv(ftn_net_connection_t* conn, void* buffer, size_t len, size_t* bytes_received);
 ftn_error_t ftn_net_send_all(ftn_net_connection_t* conn, const void* data, size_t len);
 ftn_error_t ftn_net_recv_all(ftn_net_connection_t* conn, void* buffer, size_t len);
+ftn_error_t ftn_net_sendfile(ftn_net_connection_t* conn, int fd, long offset, size_t len, size_t* bytes_sent);
 
 /* Non-blocking I/O */
 ftn_error_t ftn_net_set_non_blocking(ftn_net_connection_t* conn, int non_blocking);
@@ -89,7 +113,9 @@ ftn_error_t ftn_net_select(ftn_net_connection_t** read_conns, size_t read_count,
 
 /* Server operations */
 ftn_net_server_t* ftn_net_listen(int port, const char* bind_address, int max_connections);
+ftn_net_server_t* ftn_net_listen_unix(const char* path, int max_connections);
 ftn_net_connection_t* ftn_net_accept(ftn_net_server_t* server, int timeout_ms);
+ftn_error_t ftn_net_server_set_tuning(ftn_net_server_t* server, const ftn_net_tuning_t* tuning);
 void ftn_net_server_free(ftn_net_server_t* server);
 
 /* Socket options */
@@ -97,6 +123,12 @@ ftn_error_t ftn_net_set_keepalive(ftn_net_connection_t* conn, int enable);
 ftn_error_t ftn_net_set_nodelay(ftn_net_connection_t* conn, int enable);
 ftn_error_t ftn_net_set_timeout(ftn_net_connection_t* conn, int timeout_ms);
 
+/* Socket tuning */
+void ftn_net_tuning_init(ftn_net_tuning_t* tuning);
+size_t ftn_net_tuning_buffer_size(const ftn_net_tuning_t* tuning);
+ftn_error_t ftn_net_apply_tuning(ftn_net_connection_t* conn, const ftn_net_tuning_t* tuning);
+ftn_error_t ftn_net_set_cork(ftn_net_connection_t* conn, int enable);
+
 /* Utility functions */
 ftn_error_t ftn_net_resolve_hostname(const char* hostname, char* ip_buffer, size_t buffer_size);
 const char* ftn_net_get_error_string(ftn_error_t error);
@@ -0,0 +1,99 @@
+/*
+ * nlmgr.h - Nodelist manager with hot reload for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_NLMGR_H
+#define FTN_NLMGR_H
+
+#include <time.h>
+#include "ftn.h"
+
+/*
+ * The nodelist manager holds the nodelist index of a long-running
+ * process and replaces it when a new nodelist arrives.
+ *
+ * The path is either a nodelist file or a directory. For a directory,
+ * the most recently modified NODELIST.nnn file is used. The owner calls
+ * ftn_nodelist_manager_check() regularly. Every interval it looks for a
+ * changed file and, if there is one, parses it in a background thread.
+ * A later check publishes the new index with an atomic pointer swap.
+ *
+ * The thread that calls check may read the index with
+ * ftn_nodelist_manager_get(), a single load that never waits for a
+ * reload; the index it returns is valid until that thread's next check.
+ * Other threads, and anything that keeps the index across a check, take
+ * a reference with ftn_nodelist_manager_acquire() and hand it back with
+ * ftn_nodelist_manager_release(). A replaced index is freed when its
+ * last reference is released, however many checks that takes.
+ */
+
+#define FTN_NODELIST_CHECK_INTERVAL 60
+
+struct ftn_nodelist_build;
+
+/* An index replaced while readers still held references to it */
+typedef struct ftn_nodelist_hold {
+    ftn_nodelist_t* nodelist;
+    unsigned long readers;
+    struct ftn_nodelist_hold* next;
+} ftn_nodelist_hold_t;
+
+typedef struct {
+    char* path;                     /* Nodelist file or directory */
+    int interval;                   /* Seconds between looks at the path */
+    time_t next_check;
+    ftn_nodelist_t* current;        /* Published index (may be NULL) */
+    unsigned long readers;          /* References to current from acquire() */
+    ftn_nodelist_hold_t* retired;   /* Replaced indexes still referenced */
+    char* file;                     /* File the current index was built from */
+    time_t file_mtime;
+    long file_size;
+    char* failed_file;              /* Last file that could not be loaded */
+    time_t failed_mtime;
+    long failed_size;
+    struct ftn_nodelist_build* build; /* Build in progress (may be NULL) */
+    unsigned long reloads;          /* Times a loaded index was replaced */
+} ftn_nodelist_manager_t;
+
+/* Create a manager and load the nodelist the path points to now.
+   An interval of 0 selects FTN_NODELIST_CHECK_INTERVAL. */
+ftn_nodelist_manager_t* ftn_nodelist_manager_new(const char* path, int interval);
+void ftn_nodelist_manager_free(ftn_nodelist_manager_t* mgr);
+
+/* Current index, NULL when no nodelist has been loaded. Only for the
+   thread that calls check, until its next check. */
+ftn_nodelist_t* ftn_nodelist_manager_get(const ftn_nodelist_manager_t* mgr);
+
+/* Current index with a reference that keeps it alive across reloads,
+   NULL when no nodelist has been loaded. Safe from any thread; every
+   non-NULL result must be released before the manager is freed. */
+ftn_nodelist_t* ftn_nodelist_manager_acquire(ftn_nodelist_manager_t* mgr);
+void ftn_nodelist_manager_release(ftn_nodelist_manager_t* mgr, ftn_nodelist_t* nodelist);
+
+/* Publish a finished build and start a new one if the nodelist changed.
+   Returns 1 when a new index was published. */
+int ftn_nodelist_manager_check(ftn_nodelist_manager_t* mgr, time_t now);
+
+/* Resolve a nodelist path to the file to load (caller frees) */
+char* ftn_nodelist_manager_locate(const char* path, time_t* mtime, long* size);
+
+#endif /* FTN_NLMGR_H */
@@ -0,0 +1,94 @@
+/*
+ * nntp.h - Streaming NNTP feed client for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_NNTP_H
+#define FTN_NNTP_H
+
+#include "ftn.h"
+#include "ftn/textproto.h"
+
+#define FTN_NNTP_DEFAULT_PORT 119
+#define FTN_NNTP_DEFAULT_WINDOW 16
+#define FTN_NNTP_DEFAULT_BATCH 64
+#define FTN_NNTP_TIMEOUT_MS 30000
+#define FTN_NNTP_LINE_MAX FTN_TEXTPROTO_LINE_MAX
+
+/* An article waiting to be fed */
+typedef struct {
+    char* message_id;            /* "<local@domain>" */
+    char* area;                  /* Echo area, for spooling if the feed fails */
+    char* network;
+    char* text;                  /* Article with LF line endings */
+    int status;                  /* Final reply code, 0 if never answered */
+} ftn_nntp_article_t;
+
+/* Outstanding command in the pipeline */
+typedef struct {
+    int takethis;                /* TAKETHIS, otherwise CHECK */
+    size_t article;              /* Index into the queue */
+} ftn_nntp_pending_t;
+
+/* Streaming feed with a persistent connection (RFC 4644) */
+typedef struct {
+    ftn_textproto_t proto;       /* Connection, buffers and the last reply */
+    size_t window;               /* Commands outstanding before waiting for a reply */
+
+    /* Pipeline of outstanding commands, oldest first */
+    ftn_nntp_pending_t* pending;
+    size_t pending_head;
+    size_t pending_count;
+
+    /* Queued articles */
+    ftn_nntp_article_t* queue;
+    size_t queue_count;
+    size_t queue_capacity;
+    size_t batch_size;           /* Queue length that calls for a flush */
+
+    /* Statistics */
+    unsigned long connections;
+    unsigned long accepted;      /* 239 */
+    unsigned long refused;       /* 438, the server has it already */
+    unsigned long rejected;      /* 439 */
+    unsigned long deferred;      /* 431, try again later */
+} ftn_nntp_feed_t;
+
+/* Feed lifecycle */
+ftn_nntp_feed_t* ftn_nntp_feed_new(const char* target, size_t window, size_t batch_size);
+void ftn_nntp_feed_free(ftn_nntp_feed_t* feed);
+
+/* Connection management; ftn_nntp_flush() connects on demand */
+ftn_error_t ftn_nntp_connect(ftn_nntp_feed_t* feed);
+void ftn_nntp_disconnect(ftn_nntp_feed_t* feed);
+
+/* Queue an article; the feed takes ownership of text */
+ftn_error_t ftn_nntp_queue(ftn_nntp_feed_t* feed, const char* message_id, const char* area,
+                           const char* network, char* text);
+int ftn_nntp_queue_full(const ftn_nntp_feed_t* feed);
+
+/* Offer every queued article. Afterwards each queue entry holds its
+   final status until ftn_nntp_clear() is called. */
+ftn_error_t ftn_nntp_flush(ftn_nntp_feed_t* feed);
+int ftn_nntp_done(const ftn_nntp_article_t* article);
+void ftn_nntp_clear(ftn_nntp_feed_t* feed);
+
+#endif /* FTN_NNTP_H */
@@ -0,0 +1,88 @@
+/*
+ * outbound.h - BSO netmail outbound for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_OUTBOUND_H
+#define FTN_OUTBOUND_H
+
+#include <stddef.h>
+#include "ftn.h"
+#include "ftn/flow.h"
+#include "ftn/control.h"
+
+/*
+ * The outbound queues netmail for other nodes in a Binkley-style
+ * outbound. Messages for a next hop are appended to its existing
+ * netmail packet for the flavor, named by ftn_flow_generate_filename(),
+ * which is created only when there is none. A run that forwards
+ * thousands of messages touches a handful of packets.
+ *
+ * The first message for a next hop takes the node's .bsy lock and
+ * opens its packet under an fcntl lock; both are held until
+ * ftn_outbound_flush(). If another program holds the .bsy, messages go
+ * to a new packet in the zone directory instead. It keeps a ".tmp" name
+ * until the node is free and it is referenced from the node's flow file
+ * with a "^" (delete after sending) directive. Only packets to the hub
+ * carry the network's packet password.
+ */
+
+#define FTN_OUTBOUND_MAX_OPEN 32       /* Next hops with a packet open at once */
+
+/* A next hop with an open packet */
+typedef struct {
+    ftn_address_t address;
+    ftn_flow_flavor_t flavor;
+    ftn_control_lock_t lock;           /* Held unless spilled */
+    int spilled;                       /* Writing a separate packet for the flow file */
+    ftn_packet_writer_t* writer;
+} ftn_outbound_packet_t;
+
+/* Outbound state */
+typedef struct {
+    char* path;                        /* BSO outbound directory */
+    ftn_address_t address;             /* Our address, for packet headers */
+    ftn_address_t hub;                 /* The node the password is shared with */
+    int has_hub;
+    char password[8];                  /* Hub's packet password (not terminated) */
+    ftn_outbound_packet_t* packets;
+    size_t packet_count;
+    size_t packet_capacity;
+    size_t messages_queued;            /* Messages queued since created */
+} ftn_outbound_t;
+
+/* Lifecycle; hub and password may be NULL. Only packets to the hub carry
+   the password. Freeing flushes first. */
+ftn_outbound_t* ftn_outbound_new(const char* path, const ftn_address_t* address, const ftn_address_t* hub,
+                                 const char* password);
+void ftn_outbound_free(ftn_outbound_t* outbound);
+
+/* Flavor for a message: crash, hold or normal, from its attributes */
+ftn_flow_flavor_t ftn_outbound_flavor(const ftn_message_t* message);
+
+/* Queue a message for a next hop */
+ftn_error_t ftn_outbound_add(ftn_outbound_t* outbound, const ftn_address_t* next_hop,
+                             ftn_flow_flavor_t flavor, const ftn_message_t* message);
+
+/* Terminate and close every open packet and release the locks */
+ftn_error_t ftn_outbound_flush(ftn_outbound_t* outbound);
+
+#endif /* FTN_OUTBOUND_H */
@@ -0,0 +1,101 @@
+/*
+ * pack.h - Append-only article packs for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_PACK_H
+#define FTN_PACK_H
+
+#include "ftn.h"
+#include <sys/types.h>
+#include <time.h>
+
+/*
+ * A pack holds the articles of one newsgroup in two files: <name>.pack,
+ * which articles are only ever appended to, and <name>.idx, a small
+ * header followed by one fixed-size record per article number. Storing
+ * an article is two appends, and reading one is an index lookup and a
+ * single pread(). The group's active range and the overview byte counts
+ * come straight from the index.
+ *
+ * Appends lock the first byte of the index with fcntl(), so several
+ * processes can write to one group. Readers need no lock: a record is
+ * written only after its article is complete.
+ *
+ * Articles appended with FTN_PACK_COMPRESS are deflated one by one
+ * against a preset dictionary of Usenet and FTN header lines, so even
+ * short messages shrink and each article still takes a single read.
+ * Each index record says whether its article is compressed, so a pack
+ * may hold both kinds and ftn_pack_read() always returns plain text.
+ */
+
+#define FTN_PACK_INDEX_HEADER_SIZE 16  /* "FTNI", version, first article, reserved */
+#define FTN_PACK_RECORD_SIZE 16        /* Offset (64 bits), length, arrival time */
+#define FTN_PACK_VERSION 1
+
+/* ftn_pack_open() flags */
+#define FTN_PACK_READ 0
+#define FTN_PACK_WRITE 1               /* Append, creating the pack if needed */
+#define FTN_PACK_COMPRESS 2            /* Deflate appended articles */
+
+/* Where an article is stored */
+typedef struct {
+    off_t offset;
+    size_t length;               /* Bytes stored in the pack */
+    time_t arrived;
+    int compressed;
+} ftn_pack_entry_t;
+
+/* An open pack */
+typedef struct {
+    char* path;                  /* Name without extension */
+    int pack_fd;
+    int index_fd;
+    int flags;                   /* FTN_PACK_* flags it was opened with */
+    unsigned long appended;      /* Articles appended through this handle */
+
+    /* Compression state, kept for the life of the handle */
+    void* deflate_stream;        /* z_stream (see zlib.h) */
+    void* inflate_stream;
+    unsigned char* buffer;
+    size_t buffer_size;
+    unsigned long bytes_in;      /* Article bytes appended */
+    unsigned long bytes_out;     /* Bytes those took in the pack */
+} ftn_pack_t;
+
+/* Open a pack with FTN_PACK_* flags */
+ftn_pack_t* ftn_pack_open(const char* path, int flags);
+void ftn_pack_close(ftn_pack_t* pack);
+
+/* Append an article and return its number */
+ftn_error_t ftn_pack_append(ftn_pack_t* pack, const char* article, size_t length, long* number);
+
+/* Active range; last is first - 1 for an empty group */
+ftn_error_t ftn_pack_range(ftn_pack_t* pack, long* first, long* last);
+
+/* Read access by article number; ftn_pack_read() decompresses */
+ftn_error_t ftn_pack_entry(ftn_pack_t* pack, long number, ftn_pack_entry_t* entry);
+ftn_error_t ftn_pack_read(ftn_pack_t* pack, long number, char** article, size_t* length);
+
+/* NOV overview line (without line ending) for one article */
+ftn_error_t ftn_pack_overview(ftn_pack_t* pack, long number, char** line);
+
+#endif /* FTN_PACK_H */
@@ -24,6 +24,7 @@
 #ifndef PACKET_H
 #define PACKET_H
 
+#include <stdio.h>
 #include <time.h>
 
 /* Message Types */
@@ -135,6 +136,26 @@ typedef struct {
     size_t message_capacity;       /* Capacity of messages array */
 } ftn_packet_t;
 
+/* Streaming Packet Writer
+ *
+ * Appends messages straight to disk instead of holding them in an
+ * ftn_packet_t.  The packet is written as "<filename>.tmp" and renamed
+ * to its final name when closed.  A writer from ftn_packet_writer_reopen()
+ * instead appends to the named packet in place, holding an fcntl lock on
+ * it until it is closed.  A message that cannot be appended, or synced
+ * with ftn_packet_writer_sync(), is cut back off the end of the file.
+ */
+typedef struct {
+    FILE* fp;                      /* Open temporary file */
+    char* filename;                /* Final packet filename */
+    char* temp_filename;           /* Filename while being written */
+    size_t message_count;          /* Messages appended so far */
+    size_t size;                   /* Bytes written so far */
+    time_t opened;                 /* When the packet was opened */
+    long append_offset;            /* Where in-place appending started */
+    long message_offset;           /* Where the last appended message starts */
+} ftn_packet_writer_t;
+
 /* Packet Functions */
 
 /* Create and destroy packets */
@@ -148,6 +169,14 @@ ftn_error_t ftn_packet_save(const char* filename, const ftn_packet_t* packet);
 /* Add messages to packets */
 ftn_error_t ftn_packet_add_message(ftn_packet_t* packet, ftn_message_t* message);
 
+/* Stream messages into a packet file */
+ftn_packet_writer_t* ftn_packet_writer_open(const char* filename, const ftn_packet_header_t* header);
+ftn_packet_writer_t* ftn_packet_writer_reopen(const char* filename, const ftn_packet_header_t* header);
+ftn_error_t ftn_packet_writer_append(ftn_packet_writer_t* writer, const ftn_message_t* message);
+ftn_error_t ftn_packet_writer_sync(ftn_packet_writer_t* writer);
+ftn_error_t ftn_packet_writer_close(ftn_packet_writer_t* writer);
+void ftn_packet_writer_abort(ftn_packet_writer_t* writer);
+
 /* Message Functions */
 
 /* Create and destroy messages */
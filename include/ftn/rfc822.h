@@ -69,6 +69,10 @@ ftn_error_t ftn_to_rfc822(const ftn_message_t* ftn_msg, const char* domain, rfc8
 /* Convert RFC822 message to FTN */
 ftn_error_t rfc822_to_ftn(const rfc822_message_t* rfc_msg, const char* domain, ftn_message_t** ftn_msg);
 
+/* As above, transcoding MIME text to an FTN character set (see mime.h;
+   NULL means UTF-8). Adds a CHRS kludge when the text is not ASCII. */
+ftn_error_t rfc822_to_ftn_chrs(const rfc822_message_t* rfc_msg, const char* domain, const char* chrs, ftn_message_t** ftn_msg);
+
 /* Utility functions */
 
 /* Format FTN address for RFC822 */
@@ -94,6 +98,7 @@ ftn_error_t ftn_to_usenet(const ftn_message_t* ftn_msg, const char* network, rfc
 
 /* Convert RFC1036 USENET article to FTN Echomail message */
 ftn_error_t usenet_to_ftn(const rfc822_message_t* usenet_msg, const char* network, ftn_message_t** ftn_msg);
+ftn_error_t usenet_to_ftn_chrs(const rfc822_message_t* usenet_msg, const char* network, const char* chrs, ftn_message_t** ftn_msg);
 
 /* Generate newsgroup name from network and area */
 char* ftn_area_to_newsgroup(const char* network, const char* area);
@@ -24,10 +24,12 @@
 #ifndef FTN_ROUTER_H
 #define FTN_ROUTER_H
 
+#include <stdio.h>
 #include "ftn.h"
 #include "ftn/packet.h"
 #include "ftn/config.h"
 #include "ftn/dupechk.h"
+#include "ftn/intern.h"
 
 /* Routing action types */
 typedef enum {
@@ -56,6 +58,16 @@ typedef struct {
     ftn_routing_action_t action;    /* Action to take */
     char* parameter;                /* Action-specific parameter */
     int priority;                   /* Rule priority (lower = higher priority) */
+
+    /* Profiling counters, maintained by ftn_router_route_message() */
+    unsigned long evaluations;      /* Times the pattern was tested */
+    unsigned long matches;          /* Times the pattern matched */
+    double match_time;              /* Cumulative pattern test time in seconds */
+
+    /* Result of the last area: test, so a run of messages in one area
+       costs an integer compare instead of an fnmatch() per rule */
+    ftn_intern_id_t last_area_id;   /* Area last tested (FTN_INTERN_NONE if none) */
+    int last_area_match;            /* Whether it matched */
 } ftn_routing_rule_t;
 
 /* Router structure */
@@ -65,12 +77,14 @@ typedef struct {
     ftn_routing_rule_t** rules;     /* Array of routing rules */
     size_t rule_count;              /* Number of rules */
     size_t rule_capacity;           /* Capacity of rules array */
+    int profile;                    /* Time each rule's pattern test */
 } ftn_router_t;
 
 /* Destination information */
 typedef struct {
     ftn_address_t address;          /* Destination address */
     char* area_name;                /* Echo area name (for echomail) */
+    ftn_intern_id_t area_id;        /* Interned area, FTN_INTERN_NONE if unknown */
     char* network_name;             /* Network name */
     int is_local;                   /* Whether destination is local */
 } ftn_destination_t;
@@ -92,6 +106,13 @@ ftn_error_t ftn_router_add_rule(ftn_router_t* router, const ftn_routing_rule_t*
 ftn_error_t ftn_router_remove_rule(ftn_router_t* router, const char* rule_name);
 ftn_error_t ftn_router_load_rules_from_config(ftn_router_t* router);
 
+/* Rule profiling. Evaluations and matches are always counted; match_time
+   is only kept once profiling is enabled, as reading the clock twice per
+   rule costs more than most pattern tests. */
+void ftn_router_set_profiling(ftn_router_t* router, int enabled);
+void ftn_router_reset_rule_stats(ftn_router_t* router);
+void ftn_router_print_rule_profile(const ftn_router_t* router, FILE* fp);
+
 /* Message analysis */
 ftn_error_t ftn_router_analyze_message(ftn_router_t* router, const ftn_message_t* msg, ftn_destination_t* dest);
 ftn_error_t ftn_router_get_message_area(const ftn_message_t* msg, char** area_name);
@@ -28,17 +28,66 @@
 #include "ftn/packet.h"
 #include "ftn/config.h"
 #include "ftn/rfc822.h"
+#include "ftn/lmtp.h"
+#include "ftn/nntp.h"
+#include "ftn/jam.h"
+#include "ftn/pack.h"
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
+/* JAM message base kept open for one area */
+typedef struct {
+    unsigned int network_id;     /* Interned network name */
+    unsigned int area_id;        /* Interned area tag, 0 once the intern table is full */
+    ftn_jam_base_t* base;
+} ftn_storage_jam_t;
+
+/* Pack kept open for one newsgroup */
+typedef struct {
+    unsigned int network_id;     /* Interned network name */
+    unsigned int area_id;        /* Interned area tag, 0 once the intern table is full */
+    char* newsgroup;             /* Newsgroup name for the active file */
+    ftn_pack_t* pack;
+    int touched;                 /* Appended to since the active file was updated */
+} ftn_storage_pack_t;
+
+/* Maildirs kept resolved at once; the cache is emptied when it fills */
+#define FTN_STORAGE_MAILDIR_MAX 1024
+
+/* Maildir resolved for one (user, network) pair */
+typedef struct {
+    unsigned int user_id;        /* Interned user name, 0 when the template has no %USER% */
+    unsigned int network_id;     /* Interned network name, 0 when the template has no %NETWORK% */
+    char* path;                  /* Expanded mail_root template, NULL for a free slot */
+    int exists;                  /* Maildir and its subdirectories are known to exist */
+} ftn_storage_maildir_t;
+
 /* Storage system structure */
 typedef struct {
     const ftn_config_t* config;
     char* news_root;             /* Base news spool directory */
     char* mail_root;             /* Base mail directory */
+    const ftn_path_template_t* mail_template; /* Compiled mail_root */
+    ftn_path_template_t* own_template;        /* mail_template, when not taken from the config */
+    ftn_storage_maildir_t* maildirs;          /* Open-addressed cache of resolved Maildirs */
+    size_t maildir_count;
+    size_t maildir_capacity;
+    ftn_storage_maildir_t maildir_spare;      /* Maildir of a name the intern table had no room for */
     FILE* active_file;           /* Active file handle */
     char* active_file_path;      /* Path to active file */
+    ftn_lmtp_client_t* lmtp;     /* LMTP delivery in place of Maildir (may be NULL) */
+    ftn_nntp_feed_t* nntp;       /* News server feed in place of the spool (may be NULL) */
+    int pack;                    /* Spool articles into pack files (FTN_PACK_* flags, 0 for files) */
+    ftn_storage_pack_t* packs;   /* Open packs */
+    size_t pack_count;
+    size_t pack_capacity;
+    char* jam_root;              /* Base JAM message base directory (may be NULL) */
+    size_t jam_batch;            /* Messages queued per base before a write */
+    ftn_storage_jam_t* jam;      /* Bases written to so far */
+    size_t jam_count;
+    size_t jam_capacity;
+    int undelivered;             /* A flush lost messages since the last ftn_storage_flush */
 } ftn_storage_t;
 
 /* Message list structure for outbound scanning */
@@ -71,6 +120,7 @@ ftn_error_t ftn_storage_initialize(ftn_storage_t* storage);
 /* Maildir operations */
 ftn_error_t ftn_storage_store_mail(ftn_storage_t* storage, const ftn_message_t* msg,
                                   const char* username, const char* network);
+ftn_error_t ftn_storage_flush_mail(ftn_storage_t* storage);
 ftn_error_t ftn_storage_create_maildir(const char* path);
 ftn_error_t ftn_storage_generate_maildir_filename(ftn_maildir_file_t* file_info,
                                                  const char* maildir_path);
@@ -79,6 +129,10 @@ void ftn_maildir_file_free(ftn_maildir_file_t* file_info);
 /* USENET spool operations */
 ftn_error_t ftn_storage_store_news(ftn_storage_t* storage, const ftn_message_t* msg,
                                   const char* area, const char* network);
+ftn_error_t ftn_storage_flush_news(ftn_storage_t* storage);
+
+/* Deliver mail and news queued for LMTP and NNTP */
+ftn_error_t ftn_storage_flush(ftn_storage_t* storage);
 ftn_error_t ftn_storage_create_newsgroup(ftn_storage_t* storage, const char* newsgroup);
 ftn_error_t ftn_storage_update_active_file(ftn_storage_t* storage, const char* newsgroup,
                                           long article_num);
@@ -173,6 +227,9 @@ ftn_error_t ftn_storage_release_lock(int lock_fd, const char* lock_path);
 #define FTN_MAILDIR_NEW "new"
 #define FTN_MAILDIR_CUR "cur"
 
+/* Packs kept open at once; all are closed when the limit is reached */
+#define FTN_STORAGE_MAX_PACKS 64
+
 /* USENET active file name */
 #define FTN_USENET_ACTIVE_FILE "active"
 
@@ -0,0 +1,75 @@
+/*
+ * textproto.h - Line-based client connections for LMTP and NNTP
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_TEXTPROTO_H
+#define FTN_TEXTPROTO_H
+
+#include "ftn.h"
+
+#define FTN_TEXTPROTO_LINE_MAX 1024
+
+/* Connection to a server that speaks CRLF command lines and three-digit replies */
+typedef struct {
+    const char* protocol;        /* "LMTP" or "NNTP", for log messages */
+    char* target;                /* Socket path, or host[:port] */
+    void* conn;                  /* ftn_net_connection_t (see net.h) */
+
+    /* Outgoing commands and message data, sent in one write */
+    char* out;
+    size_t out_len;
+    size_t out_capacity;
+
+    /* Reply reader */
+    char in[FTN_TEXTPROTO_LINE_MAX];
+    size_t in_len;
+    size_t in_pos;
+    char last_reply[FTN_TEXTPROTO_LINE_MAX];
+} ftn_textproto_t;
+
+char* ftn_textproto_strdup(const char* str);
+
+/* Lifecycle; protocol must outlive the connection */
+ftn_error_t ftn_textproto_init(ftn_textproto_t* proto, const char* protocol, const char* target);
+void ftn_textproto_free(ftn_textproto_t* proto);
+
+/* "unix:path" or anything with a slash is a local socket, the rest is
+   host[:port]. Buffers are reset; the caller reads the greeting. */
+ftn_error_t ftn_textproto_connect(ftn_textproto_t* proto, int default_port, int timeout_ms);
+void ftn_textproto_close(ftn_textproto_t* proto);
+
+/* Output buffer */
+ftn_error_t ftn_textproto_reserve(ftn_textproto_t* proto, size_t len);
+ftn_error_t ftn_textproto_append(ftn_textproto_t* proto, const char* data, size_t len);
+/* verb and arg are sent as given, followed by CRLF */
+ftn_error_t ftn_textproto_append_command(ftn_textproto_t* proto, const char* verb, const char* arg);
+/* Message content: CRLF line endings, dot-stuffed, terminated by "." */
+ftn_error_t ftn_textproto_append_dotted(ftn_textproto_t* proto, const char* text);
+ftn_error_t ftn_textproto_write(ftn_textproto_t* proto);
+
+/* Read one reply, following "250-" continuation lines, into *code. When
+   keyword is given, *has_keyword is set if a line of the reply names it. */
+ftn_error_t ftn_textproto_read_reply(ftn_textproto_t* proto, int* code, const char* keyword, int* has_keyword);
+/* A complete reply line is already buffered */
+int ftn_textproto_reply_buffered(const ftn_textproto_t* proto);
+
+#endif /* FTN_TEXTPROTO_H */
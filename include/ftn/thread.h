@@ -0,0 +1,74 @@
+/*
+ * thread.h - Thread support for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_THREAD_H
+#define FTN_THREAD_H
+
+#include <time.h>
+
+/*
+ * Thread safety in libFTN
+ *
+ * Objects created by the library (packets, configs, sessions, caches and
+ * so on) carry all of their own state. Different objects may be used from
+ * different threads at the same time. One object must not be used from
+ * two threads at once without the caller's own locking.
+ *
+ * The process-wide state that remains, the logger and the intern tables,
+ * is guarded by the mutexes below. Lookup tables are read-only.
+ *
+ * Build with NO_THREADS=1 (-DFTN_NO_THREADS) on platforms without
+ * threads; the mutexes then do nothing.
+ */
+
+#if defined(FTN_NO_THREADS)
+typedef int ftn_mutex_t;
+#define FTN_MUTEX_INITIALIZER 0
+#elif defined(_WIN32)
+#include <windows.h>
+typedef SRWLOCK ftn_mutex_t;
+#define FTN_MUTEX_INITIALIZER SRWLOCK_INIT
+#else
+#include <pthread.h>
+typedef pthread_mutex_t ftn_mutex_t;
+#define FTN_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
+
+/* Statically initialized mutex operations */
+void ftn_mutex_lock(ftn_mutex_t* mutex);
+void ftn_mutex_unlock(ftn_mutex_t* mutex);
+
+/* Pointer publication. A pointer stored with ftn_atomic_store_ptr() is
+   seen by ftn_atomic_load_ptr() in another thread together with every
+   write made before the store, without either side taking a lock. */
+void* ftn_atomic_load_ptr(void* const* ptr);
+void ftn_atomic_store_ptr(void** ptr, void* value);
+
+/* Reentrant time conversion into a caller-supplied struct tm */
+struct tm* ftn_localtime_r(const time_t* timep, struct tm* result);
+struct tm* ftn_gmtime_r(const time_t* timep, struct tm* result);
+
+/* Seconds on a clock that never steps backwards, for timing intervals */
+double ftn_monotonic_time(void);
+
+#endif /* FTN_THREAD_H */
@@ -0,0 +1,100 @@
+/*
+ * tic.h - TIC file echo processing for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_TIC_H
+#define FTN_TIC_H
+
+#include "ftn.h"
+#include "ftn/areafix.h"
+#include <stddef.h>
+
+/* Parsed TIC file */
+typedef struct {
+    char* area;                       /* File echo tag */
+    char* file;                       /* Name of the attached file */
+    char* lfn;                        /* Long file name (NULL if absent) */
+    char* desc;                       /* One-line description */
+    char* replaces;                   /* File this one supersedes */
+    char* magic;                      /* Magic name for file requests */
+    char* password;                   /* Pw line */
+    ftn_address_t origin;             /* System that hatched the file */
+    ftn_address_t from;               /* Link the file arrived from */
+    ftn_address_t to;                 /* Link the file is addressed to */
+    int has_to;
+    unsigned long size;               /* File size from the Size line */
+    int has_size;
+    unsigned long crc;                /* CRC-32 from the Crc line */
+    int has_crc;
+    char** ldesc;                     /* Long description lines */
+    size_t ldesc_count;
+    char** path;                      /* Path lines, oldest first */
+    size_t path_count;
+    ftn_address_t* seenby;            /* Seenby addresses */
+    size_t seenby_count;
+    size_t seenby_capacity;
+    char** extra;                     /* Unrecognised lines, passed through */
+    size_t extra_count;
+} ftn_tic_t;
+
+/* Where a TIC and its file are distributed */
+typedef struct {
+    ftn_address_t address;            /* Our address on this network */
+    const char* fileecho_path;        /* Local file area storage */
+    const char* filebox_path;         /* Per-link copies awaiting pickup */
+    const char* outbound_path;        /* BSO outbound for .flo files */
+    const char* bad_path;             /* Refused files go here (may be NULL) */
+    ftn_areafix_t* subscriptions;     /* File echo subscriptions (may be NULL) */
+} ftn_tic_context_t;
+
+/* Lifecycle */
+ftn_tic_t* ftn_tic_new(void);
+void ftn_tic_free(ftn_tic_t* tic);
+
+/* Reading and writing */
+ftn_error_t ftn_tic_parse(const char* path, ftn_tic_t** tic);
+ftn_error_t ftn_tic_write(const ftn_tic_t* tic, const char* path);
+ftn_error_t ftn_tic_add_seenby(ftn_tic_t* tic, const ftn_address_t* address);
+int ftn_tic_is_seenby(const ftn_tic_t* tic, const ftn_address_t* address);
+
+/* Check a received file against the TIC's Size and Crc lines */
+ftn_error_t ftn_tic_validate(const ftn_tic_t* tic, const char* file_path);
+
+/*
+ * Process one inbound TIC: validate its file, move it into the file area
+ * and hard-link it into the filebox of every subscribed link that has not
+ * seen it, queueing the copy and a fresh TIC in the link's .flo file.
+ * The TIC must come from a configured link with its password, or from a
+ * link marked insecure. Returns FTN_ERROR_NOTFOUND while the file has not
+ * arrived yet, FTN_ERROR_INVALID for a refused sender and FTN_ERROR_CRC if
+ * the file does not match; refused and damaged files are moved to
+ * bad_path. FTN_ERROR_FILE means the file could not be stored or queued
+ * for some link: the file is left beside its TIC, whose Seenby then lists
+ * the links already served, so a later call sends only to the rest. The
+ * TIC itself is left in place.
+ */
+ftn_error_t ftn_tic_process(const ftn_tic_context_t* ctx, const char* tic_path, size_t* links_sent);
+
+/* Utility */
+int ftn_tic_is_tic_name(const char* filename);
+
+#endif /* FTN_TIC_H */
@@ -0,0 +1,70 @@
+/*
+ * tls.h - binkps (binkp over TLS) transport for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_TLS_H
+#define FTN_TLS_H
+
+#include <stddef.h>
+#include "net.h"
+
+/*
+ * TLS is optional: build with "make WITH_TLS=1" to link against OpenSSL.
+ * Without it every call fails with FTN_ERROR_NETWORK and ftn_tls_available()
+ * returns 0.
+ *
+ * Once a handshake completes the connection's ftn_net_send/ftn_net_recv
+ * calls go through TLS transparently. When the kernel accepts the session
+ * keys (kTLS), records are encrypted in the kernel and ftn_net_sendfile
+ * keeps its zero-copy path; otherwise file data is read and encrypted in
+ * user space.
+ */
+
+typedef struct ftn_tls_context ftn_tls_context_t;
+
+/* Availability */
+int ftn_tls_available(void);
+
+/* Contexts: certificate and key are required for servers. Clients always
+   verify the server, against the CA file or else the system CA store, and
+   check its certificate against the server name given to ftn_tls_start.
+   Servers only ask for client certificates when given a CA file. A context
+   is meant to be kept and shared by every session with the same peer. */
+ftn_tls_context_t* ftn_tls_context_new(int is_server, const char* cert_file, const char* key_file, const char* ca_file);
+void ftn_tls_context_free(ftn_tls_context_t* ctx);
+
+/* Pin a client context to one server certificate, given as its SHA-256
+   fingerprint in hex (colons optional). The CA and name checks are then
+   replaced by an exact match, which suits self-signed hub certificates. */
+ftn_error_t ftn_tls_context_set_fingerprint(ftn_tls_context_t* ctx, const char* fingerprint);
+
+/* Sessions */
+ftn_error_t ftn_tls_start(ftn_tls_context_t* ctx, ftn_net_connection_t* conn, const char* server_name);
+void ftn_tls_close(ftn_net_connection_t* conn);
+int ftn_tls_is_ktls(const ftn_net_connection_t* conn);
+
+/* I/O used by net.c for TLS connections */
+ftn_error_t ftn_tls_send(ftn_net_connection_t* conn, const void* data, size_t len, size_t* bytes_sent);
+ftn_error_t ftn_tls_recv(ftn_net_connection_t* conn, void* buffer, size_t len, size_t* bytes_received);
+ftn_error_t ftn_tls_sendfile(ftn_net_connection_t* conn, int fd, long offset, size_t len, size_t* bytes_sent);
+
+#endif /* FTN_TLS_H */
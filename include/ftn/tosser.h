@@ -0,0 +1,89 @@
+/*
+ * tosser.h - Inbound packet tosser for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FTN_TOSSER_H
+#define FTN_TOSSER_H
+
+#include <stddef.h>
+#include <time.h>
+#include "ftn.h"
+#include "ftn/config.h"
+#include "ftn/router.h"
+#include "ftn/storage.h"
+#include "ftn/dupechk.h"
+#include "ftn/areafix.h"
+#include "ftn/outbound.h"
+
+/*
+ * The tosser delivers the packets, TIC files and file requests waiting
+ * in each network inbox. Its storage, duplicate database, router and
+ * Areafix tables are loaded once by ftn_tosser_new() and reused by
+ * every pass, so a long-running daemon keeps them in memory. Netmail
+ * routed elsewhere is appended to the network's BSO outbound. The
+ * config must outlive the tosser. A tosser must only be used by one
+ * thread at a time.
+ */
+
+/* Statistics for one tossing pass */
+typedef struct {
+    size_t packets_processed;
+    size_t messages_processed;
+    size_t duplicates_found;
+    size_t messages_stored;
+    size_t messages_forwarded;
+    size_t errors_encountered;
+    size_t packets_deferred;
+    size_t files_processed;
+    time_t processing_start_time;
+    time_t processing_end_time;
+} ftn_toss_stats_t;
+
+/* Tosser state shared by every pass */
+typedef struct {
+    const ftn_config_t* config;
+    ftn_storage_t* storage;
+    ftn_dupecheck_t* dupecheck;
+    ftn_router_t* router;
+    ftn_areafix_t** areafix;    /* Per network, NULL where none is configured */
+    ftn_outbound_t** outbound;  /* Per network, NULL without an outbound_path */
+} ftn_tosser_t;
+
+/* Tosser lifecycle */
+ftn_tosser_t* ftn_tosser_new(const ftn_config_t* config);
+void ftn_tosser_free(ftn_tosser_t* tosser);
+
+/* Toss every network inbox; echomail stops after time_budget seconds (0 = no limit) */
+ftn_error_t ftn_tosser_process_inbox(ftn_tosser_t* tosser, int time_budget, ftn_toss_stats_t* stats);
+
+/* Toss one packet that arrived for a network, without scanning the inbox */
+ftn_error_t ftn_tosser_toss_packet(ftn_tosser_t* tosser, const char* packet_path, size_t network_index,
+                                   ftn_toss_stats_t* stats);
+
+/* Write the duplicate database if it has changed */
+ftn_error_t ftn_tosser_flush(ftn_tosser_t* tosser);
+
+/* Statistics */
+void ftn_toss_stats_init(ftn_toss_stats_t* stats);
+void ftn_toss_stats_print(const ftn_toss_stats_t* stats);
+
+#endif /* FTN_TOSSER_H */
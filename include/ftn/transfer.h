@@ -30,6 +30,8 @@
 #include "bso.h"
 #include "flow.h"
 #include "binkp/session.h"
+#include "binkp/crc.h"
+#include "freq.h"
 
 /* Forward declarations */
 struct ftn_address;
@@ -58,6 +60,9 @@ typedef struct {
     ftn_transfer_state_t state;
     time_t start_time;
     int resume_offset;
+    uint32_t crc32;             /* Whole-file CRC, when has_crc is set */
+    int has_crc;
+    uint32_t running_crc;       /* CRC of the data sent so far */
 } ftn_file_transfer_t;
 
 /* Transfer batch context */
@@ -71,6 +76,11 @@ typedef struct {
     int batch_complete;
     size_t total_files;
     size_t completed_files;
+    ftn_crc_cache_t* crc_cache; /* Shared file CRC cache (may be NULL) */
+    int use_crc;                /* Session negotiated the CRC option */
+    const ftn_freq_index_t* freq_index; /* Answers received .req files (may be NULL) */
+    size_t freq_limit;          /* Files sent per request (0 = default) */
+    size_t requests_answered;
 } ftn_transfer_context_t;
 
 /* Transfer statistics */
@@ -94,6 +104,8 @@ ftn_bso_error_t ftn_file_transfer_setup_receive(ftn_file_transfer_t* transfer, c
 ftn_bso_error_t ftn_transfer_context_init(ftn_transfer_context_t* ctx);
 void ftn_transfer_context_free(ftn_transfer_context_t* ctx);
 ftn_bso_error_t ftn_transfer_context_set_session(ftn_transfer_context_t* ctx, struct ftn_binkp_session* session);
+ftn_bso_error_t ftn_transfer_context_set_crc(ftn_transfer_context_t* ctx, ftn_crc_cache_t* cache, int use_crc);
+ftn_bso_error_t ftn_transfer_context_set_freq(ftn_transfer_context_t* ctx, const ftn_freq_index_t* index, size_t limit);
 
 /* Transfer queue management */
 ftn_bso_error_t ftn_transfer_add_file(ftn_transfer_context_t* ctx, const ftn_file_transfer_t* transfer);
@@ -115,6 +127,14 @@ ftn_bso_error_t ftn_transfer_receive_file_header(ftn_transfer_context_t* ctx, co
 ftn_bso_error_t ftn_transfer_receive_file_data(ftn_transfer_context_t* ctx, const void* data, size_t len);
 ftn_bso_error_t ftn_transfer_complete_receive(ftn_transfer_context_t* ctx);
 
+/*
+ * Answer a file request received in this session. The resolved files are
+ * added to the send queue, so they go back to the session's peer rather
+ * than to a node derived from the .req name. Requests are only answered
+ * once the session is authenticated.
+ */
+ftn_bso_error_t ftn_transfer_answer_request(ftn_transfer_context_t* ctx, const char* req_path, size_t* queued);
+
 /* File validation and post-processing */
 ftn_bso_error_t ftn_transfer_validate_received_file(const ftn_file_transfer_t* transfer);
 ftn_bso_error_t ftn_transfer_apply_action(ftn_file_transfer_t* transfer);
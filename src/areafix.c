@@ -0,0 +1,778 @@
+/*
+ * areafix.c - Echo area subscriptions and Areafix robot for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/areafix.h"
+#include "ftn/packet.h"
+#include "ftn/thread.h"
+
+#define DB_VERSION_STRING      "# libFTN Areafix Database v1.0"
+#define INITIAL_CAPACITY       16
+#define INITIAL_BUCKETS        64
+#define MAX_LINE_LENGTH        8192
+
+/* Growable response text */
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} ftn_areafix_text_t;
+
+static char* ftn_areafix_strdup(const char* str) {
+    char* result;
+    if (!str) return NULL;
+
+    result = malloc(strlen(str) + 1);
+    if (result) {
+        strcpy(result, str);
+    }
+    return result;
+}
+
+static char* ftn_areafix_strdup_upper(const char* str) {
+    char* result;
+    char* p;
+
+    result = ftn_areafix_strdup(str);
+    if (!result) return NULL;
+
+    for (p = result; *p; p++) {
+        *p = (char)toupper((unsigned char)*p);
+    }
+    return result;
+}
+
+/* FNV-1a over the upper-cased tag */
+static unsigned long ftn_areafix_hash(const char* tag) {
+    unsigned long hash = 2166136261UL;
+
+    while (*tag) {
+        hash ^= (unsigned char)toupper((unsigned char)*tag);
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+        tag++;
+    }
+    return hash;
+}
+
+static size_t ftn_areafix_words_for(size_t link_count) {
+    size_t words = (link_count + FTN_AREAFIX_WORD_BITS - 1) / FTN_AREAFIX_WORD_BITS;
+    return words ? words : 1;
+}
+
+/* Rebuild the tag index with room for at least twice the areas */
+static ftn_error_t ftn_areafix_rehash(ftn_areafix_t* areafix, size_t bucket_count) {
+    size_t* buckets;
+    size_t i;
+    size_t slot;
+
+    buckets = calloc(bucket_count, sizeof(size_t));
+    if (!buckets) return FTN_ERROR_NOMEM;
+
+    for (i = 0; i < areafix->area_count; i++) {
+        slot = ftn_areafix_hash(areafix->areas[i].tag) & (bucket_count - 1);
+        while (buckets[slot]) {
+            slot = (slot + 1) & (bucket_count - 1);
+        }
+        buckets[slot] = i + 1;
+    }
+
+    free(areafix->buckets);
+    areafix->buckets = buckets;
+    areafix->bucket_count = bucket_count;
+    return FTN_OK;
+}
+
+static ftn_error_t ftn_areafix_text_append(ftn_areafix_text_t* text, const char* str) {
+    size_t len = strlen(str);
+
+    if (text->length + len + 1 > text->capacity) {
+        size_t new_capacity = text->capacity ? text->capacity * 2 : 256;
+        char* new_data;
+
+        while (text->length + len + 1 > new_capacity) {
+            new_capacity *= 2;
+        }
+        new_data = realloc(text->data, new_capacity);
+        if (!new_data) return FTN_ERROR_NOMEM;
+
+        text->data = new_data;
+        text->capacity = new_capacity;
+    }
+
+    memcpy(text->data + text->length, str, len + 1);
+    text->length += len;
+    return FTN_OK;
+}
+
+static ftn_error_t ftn_areafix_text_line(ftn_areafix_text_t* text, const char* a, const char* b) {
+    if (ftn_areafix_text_append(text, a) != FTN_OK) return FTN_ERROR_NOMEM;
+    if (b && ftn_areafix_text_append(text, b) != FTN_OK) return FTN_ERROR_NOMEM;
+    return ftn_areafix_text_append(text, "\r");
+}
+
+/* Lifecycle */
+ftn_areafix_t* ftn_areafix_new(const char* db_path) {
+    ftn_areafix_t* areafix;
+
+    areafix = malloc(sizeof(ftn_areafix_t));
+    if (!areafix) return NULL;
+
+    memset(areafix, 0, sizeof(ftn_areafix_t));
+    areafix->words = 1;
+
+    if (db_path) {
+        areafix->db_path = ftn_areafix_strdup(db_path);
+        if (!areafix->db_path) {
+            free(areafix);
+            return NULL;
+        }
+    }
+
+    if (ftn_areafix_rehash(areafix, INITIAL_BUCKETS) != FTN_OK) {
+        free(areafix->db_path);
+        free(areafix);
+        return NULL;
+    }
+
+    return areafix;
+}
+
+void ftn_areafix_free(ftn_areafix_t* areafix) {
+    size_t i;
+
+    if (!areafix) return;
+
+    for (i = 0; i < areafix->link_count; i++) {
+        free(areafix->links[i].password);
+    }
+    for (i = 0; i < areafix->area_count; i++) {
+        free(areafix->areas[i].tag);
+        free(areafix->areas[i].links);
+    }
+    free(areafix->links);
+    free(areafix->areas);
+    free(areafix->buckets);
+    free(areafix->db_path);
+    free(areafix);
+}
+
+/*
+ * Database format, one record per line:
+ *   link|<address>|<password>[|insecure]
+ *   area|<tag>|<address>,<address>,...
+ * Links must appear before the areas that reference them.
+ */
+ftn_error_t ftn_areafix_load(ftn_areafix_t* areafix) {
+    FILE* fp;
+    char line[MAX_LINE_LENGTH];
+    char* kind;
+    char* name;
+    char* rest;
+    char* addr_str;
+    char* flags;
+    char* saveptr;
+    ftn_address_t address;
+    size_t area_id;
+    size_t link_id;
+    int found;
+    ftn_error_t error = FTN_OK;
+
+    if (!areafix || !areafix->db_path) return FTN_ERROR_INVALID_PARAMETER;
+
+    fp = fopen(areafix->db_path, "r");
+    if (!fp) {
+        /* Database doesn't exist yet - start with an empty table */
+        return FTN_OK;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0') {
+            continue;
+        }
+
+        kind = line;
+        name = strchr(kind, '|');
+        if (!name) continue;
+        *name++ = '\0';
+        rest = strchr(name, '|');
+        if (rest) {
+            *rest++ = '\0';
+        } else {
+            rest = name + strlen(name);
+        }
+        ftn_trim(name);
+
+        if (strcmp(kind, "link") == 0) {
+            if (!ftn_address_parse(name, &address)) continue;
+            flags = strrchr(rest, '|');
+            if (flags) *flags++ = '\0';
+            ftn_trim(rest);
+            error = ftn_areafix_add_link(areafix, &address, rest[0] ? rest : NULL, &link_id);
+            if (error == FTN_OK && flags) {
+                ftn_trim(flags);
+                areafix->links[link_id].insecure = (strcmp(flags, "insecure") == 0);
+            }
+        } else if (strcmp(kind, "area") == 0) {
+            if (!name[0]) continue;
+            error = ftn_areafix_add_area(areafix, name, &area_id);
+            if (error != FTN_OK) break;
+
+            for (addr_str = strtok_r(rest, ",", &saveptr); addr_str;
+                 addr_str = strtok_r(NULL, ",", &saveptr)) {
+                ftn_trim(addr_str);
+                if (!ftn_address_parse(addr_str, &address)) continue;
+                found = ftn_areafix_find_link(areafix, &address);
+                if (found < 0) continue;
+                ftn_areafix_subscribe(areafix, area_id, (size_t)found);
+            }
+        }
+
+        if (error != FTN_OK) break;
+    }
+
+    fclose(fp);
+    areafix->modified = 0;
+    return error;
+}
+
+ftn_error_t ftn_areafix_save(ftn_areafix_t* areafix) {
+    FILE* fp;
+    char temp_path[1024];
+    char addr_str[64];
+    size_t i, j;
+    int first;
+
+    if (!areafix || !areafix->db_path) return FTN_ERROR_INVALID_PARAMETER;
+    if (!areafix->modified) return FTN_OK;
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", areafix->db_path);
+    fp = fopen(temp_path, "w");
+    if (!fp) return FTN_ERROR_FILE;
+
+    fprintf(fp, "%s\n", DB_VERSION_STRING);
+
+    for (i = 0; i < areafix->link_count; i++) {
+        ftn_address_to_string(&areafix->links[i].address, addr_str, sizeof(addr_str));
+        fprintf(fp, "link|%s|%s%s\n", addr_str,
+                areafix->links[i].password ? areafix->links[i].password : "",
+                areafix->links[i].insecure ? "|insecure" : "");
+    }
+
+    for (i = 0; i < areafix->area_count; i++) {
+        fprintf(fp, "area|%s|", areafix->areas[i].tag);
+        first = 1;
+        for (j = 0; j < areafix->link_count; j++) {
+            if (!FTN_AREAFIX_BIT_TEST(areafix->areas[i].links, j)) continue;
+            ftn_address_to_string(&areafix->links[j].address, addr_str, sizeof(addr_str));
+            fprintf(fp, "%s%s", first ? "" : ",", addr_str);
+            first = 0;
+        }
+        fputc('\n', fp);
+    }
+
+    if (fclose(fp) != 0 || rename(temp_path, areafix->db_path) != 0) {
+        remove(temp_path);
+        return FTN_ERROR_FILE;
+    }
+
+    areafix->modified = 0;
+    return FTN_OK;
+}
+
+/* Links and areas */
+ftn_error_t ftn_areafix_add_link(ftn_areafix_t* areafix, const ftn_address_t* address,
+                                 const char* password, size_t* link_id) {
+    ftn_areafix_link_t* link;
+    size_t new_words;
+    size_t i;
+    int existing;
+
+    if (!areafix || !address) return FTN_ERROR_INVALID_PARAMETER;
+
+    existing = ftn_areafix_find_link(areafix, address);
+    if (existing >= 0) {
+        link = &areafix->links[existing];
+        free(link->password);
+        link->password = password ? ftn_areafix_strdup(password) : NULL;
+        if (password && !link->password) return FTN_ERROR_NOMEM;
+        if (link_id) *link_id = (size_t)existing;
+        areafix->modified = 1;
+        return FTN_OK;
+    }
+
+    if (areafix->link_count >= areafix->link_capacity) {
+        size_t new_capacity = areafix->link_capacity ? areafix->link_capacity * 2 : INITIAL_CAPACITY;
+        ftn_areafix_link_t* new_links = realloc(areafix->links, new_capacity * sizeof(ftn_areafix_link_t));
+        if (!new_links) return FTN_ERROR_NOMEM;
+
+        areafix->links = new_links;
+        areafix->link_capacity = new_capacity;
+    }
+
+    /* Widen every area bitset when the new link needs another word */
+    new_words = ftn_areafix_words_for(areafix->link_count + 1);
+    if (new_words > areafix->words) {
+        for (i = 0; i < areafix->area_count; i++) {
+            ftn_areafix_word_t* bits = realloc(areafix->areas[i].links, new_words * sizeof(ftn_areafix_word_t));
+            if (!bits) return FTN_ERROR_NOMEM;
+
+            memset(bits + areafix->words, 0, (new_words - areafix->words) * sizeof(ftn_areafix_word_t));
+            areafix->areas[i].links = bits;
+        }
+        areafix->words = new_words;
+    }
+
+    link = &areafix->links[areafix->link_count];
+    link->address = *address;
+    link->password = NULL;
+    link->insecure = 0;
+    if (password) {
+        link->password = ftn_areafix_strdup(password);
+        if (!link->password) return FTN_ERROR_NOMEM;
+    }
+
+    if (link_id) *link_id = areafix->link_count;
+    areafix->link_count++;
+    areafix->modified = 1;
+    return FTN_OK;
+}
+
+int ftn_areafix_find_link(const ftn_areafix_t* areafix, const ftn_address_t* address) {
+    size_t i;
+
+    if (!areafix || !address) return -1;
+
+    for (i = 0; i < areafix->link_count; i++) {
+        if (ftn_address_compare(&areafix->links[i].address, address) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+ftn_error_t ftn_areafix_add_area(ftn_areafix_t* areafix, const char* tag, size_t* area_id) {
+    ftn_areafix_area_t* area;
+    size_t slot;
+    int existing;
+
+    if (!areafix || !tag || !tag[0]) return FTN_ERROR_INVALID_PARAMETER;
+
+    existing = ftn_areafix_find_area(areafix, tag);
+    if (existing >= 0) {
+        if (area_id) *area_id = (size_t)existing;
+        return FTN_OK;
+    }
+
+    if (areafix->area_count >= areafix->area_capacity) {
+        size_t new_capacity = areafix->area_capacity ? areafix->area_capacity * 2 : INITIAL_CAPACITY;
+        ftn_areafix_area_t* new_areas = realloc(areafix->areas, new_capacity * sizeof(ftn_areafix_area_t));
+        if (!new_areas) return FTN_ERROR_NOMEM;
+
+        areafix->areas = new_areas;
+        areafix->area_capacity = new_capacity;
+    }
+
+    /* Keep the index at most half full */
+    if ((areafix->area_count + 1) * 2 > areafix->bucket_count) {
+        if (ftn_areafix_rehash(areafix, areafix->bucket_count * 2) != FTN_OK) {
+            return FTN_ERROR_NOMEM;
+        }
+    }
+
+    area = &areafix->areas[areafix->area_count];
+    area->tag = ftn_areafix_strdup_upper(tag);
+    area->links = calloc(areafix->words, sizeof(ftn_areafix_word_t));
+    if (!area->tag || !area->links) {
+        free(area->tag);
+        free(area->links);
+        return FTN_ERROR_NOMEM;
+    }
+
+    slot = ftn_areafix_hash(area->tag) & (areafix->bucket_count - 1);
+    while (areafix->buckets[slot]) {
+        slot = (slot + 1) & (areafix->bucket_count - 1);
+    }
+    areafix->buckets[slot] = areafix->area_count + 1;
+
+    if (area_id) *area_id = areafix->area_count;
+    areafix->area_count++;
+    areafix->modified = 1;
+    return FTN_OK;
+}
+
+int ftn_areafix_find_area(const ftn_areafix_t* areafix, const char* tag) {
+    size_t slot;
+    size_t index;
+
+    if (!areafix || !tag || !areafix->bucket_count) return -1;
+
+    slot = ftn_areafix_hash(tag) & (areafix->bucket_count - 1);
+    while ((index = areafix->buckets[slot]) != 0) {
+        if (strcasecmp(areafix->areas[index - 1].tag, tag) == 0) {
+            return (int)(index - 1);
+        }
+        slot = (slot + 1) & (areafix->bucket_count - 1);
+    }
+    return -1;
+}
+
+/* Subscriptions */
+ftn_error_t ftn_areafix_subscribe(ftn_areafix_t* areafix, size_t area_id, size_t link_id) {
+    if (!areafix || area_id >= areafix->area_count || link_id >= areafix->link_count) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    if (!FTN_AREAFIX_BIT_TEST(areafix->areas[area_id].links, link_id)) {
+        FTN_AREAFIX_BIT_SET(areafix->areas[area_id].links, link_id);
+        areafix->modified = 1;
+    }
+    return FTN_OK;
+}
+
+ftn_error_t ftn_areafix_unsubscribe(ftn_areafix_t* areafix, size_t area_id, size_t link_id) {
+    if (!areafix || area_id >= areafix->area_count || link_id >= areafix->link_count) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    if (FTN_AREAFIX_BIT_TEST(areafix->areas[area_id].links, link_id)) {
+        FTN_AREAFIX_BIT_CLEAR(areafix->areas[area_id].links, link_id);
+        areafix->modified = 1;
+    }
+    return FTN_OK;
+}
+
+int ftn_areafix_is_subscribed(const ftn_areafix_t* areafix, size_t area_id, size_t link_id) {
+    if (!areafix || area_id >= areafix->area_count || link_id >= areafix->link_count) {
+        return 0;
+    }
+    return (int)FTN_AREAFIX_BIT_TEST(areafix->areas[area_id].links, link_id);
+}
+
+/* Bitsets */
+ftn_areafix_word_t* ftn_areafix_bitset_new(const ftn_areafix_t* areafix) {
+    if (!areafix) return NULL;
+    return calloc(areafix->words, sizeof(ftn_areafix_word_t));
+}
+
+size_t ftn_areafix_bitset_count(const ftn_areafix_t* areafix, const ftn_areafix_word_t* bits) {
+    size_t count = 0;
+    size_t i;
+    ftn_areafix_word_t word;
+
+    if (!areafix || !bits) return 0;
+
+    for (i = 0; i < areafix->words; i++) {
+        for (word = bits[i]; word; word &= word - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+ftn_error_t ftn_areafix_seenby_bits(const ftn_areafix_t* areafix, const ftn_message_t* msg,
+                                    ftn_areafix_word_t* bits) {
+    char* work;
+    char* token;
+    char* slash;
+    char* saveptr;
+    unsigned int net = 0;
+    unsigned int node;
+    size_t i, j;
+
+    if (!areafix || !msg || !bits) return FTN_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < msg->seenby_count; i++) {
+        if (!msg->seenby[i]) continue;
+
+        work = ftn_areafix_strdup(msg->seenby[i]);
+        if (!work) return FTN_ERROR_NOMEM;
+
+        /* SEEN-BY entries are 2D: "net/node" sets the net for following "node" entries */
+        for (token = strtok_r(work, " \t", &saveptr); token;
+             token = strtok_r(NULL, " \t", &saveptr)) {
+            slash = strchr(token, '/');
+            if (slash) {
+                net = (unsigned int)atoi(token);
+                node = (unsigned int)atoi(slash + 1);
+            } else {
+                node = (unsigned int)atoi(token);
+            }
+
+            for (j = 0; j < areafix->link_count; j++) {
+                if (areafix->links[j].address.net == net &&
+                    areafix->links[j].address.node == node &&
+                    areafix->links[j].address.point == 0) {
+                    FTN_AREAFIX_BIT_SET(bits, j);
+                }
+            }
+        }
+
+        free(work);
+    }
+
+    return FTN_OK;
+}
+
+size_t ftn_areafix_fanout(const ftn_areafix_t* areafix, size_t area_id,
+                          const ftn_areafix_word_t* seen, ftn_areafix_word_t* out) {
+    const ftn_areafix_word_t* subs;
+    size_t i;
+
+    if (!areafix || !out || area_id >= areafix->area_count) return 0;
+
+    subs = areafix->areas[area_id].links;
+    for (i = 0; i < areafix->words; i++) {
+        out[i] = seen ? (subs[i] & ~seen[i]) : subs[i];
+    }
+    return ftn_areafix_bitset_count(areafix, out);
+}
+
+/* Areafix robot */
+int ftn_areafix_is_request(const ftn_message_t* msg, const ftn_address_t* local) {
+    if (!msg || msg->type != FTN_MSG_NETMAIL || !msg->to_user) return 0;
+    if (strcasecmp(msg->to_user, FTN_AREAFIX_ROBOT_NAME) != 0) return 0;
+    if (local && ftn_address_compare(&msg->dest_addr, local) != 0) return 0;
+    return 1;
+}
+
+/* Apply a subscribe or unsubscribe pattern, reporting each area touched */
+static ftn_error_t ftn_areafix_apply(ftn_areafix_t* areafix, size_t link_id, const char* pattern,
+                                     int subscribe, ftn_areafix_text_t* text) {
+    char* upper;
+    size_t i;
+    int matched = 0;
+    int was;
+    ftn_error_t error = FTN_OK;
+
+    /* Tags are stored upper-case, so match against an upper-case pattern */
+    upper = ftn_areafix_strdup_upper(pattern);
+    if (!upper) return FTN_ERROR_NOMEM;
+
+    for (i = 0; i < areafix->area_count && error == FTN_OK; i++) {
+        if (fnmatch(upper, areafix->areas[i].tag, 0) != 0) continue;
+        matched = 1;
+
+        was = ftn_areafix_is_subscribed(areafix, i, link_id);
+        if (subscribe) {
+            ftn_areafix_subscribe(areafix, i, link_id);
+            error = ftn_areafix_text_line(text, was ? "Already linked: " : "Linked: ",
+                                          areafix->areas[i].tag);
+        } else if (was) {
+            ftn_areafix_unsubscribe(areafix, i, link_id);
+            error = ftn_areafix_text_line(text, "Unlinked: ", areafix->areas[i].tag);
+        }
+    }
+
+    if (error == FTN_OK && !matched) {
+        error = ftn_areafix_text_line(text, "No such area: ", upper);
+    }
+
+    free(upper);
+    return error;
+}
+
+static ftn_error_t ftn_areafix_list(const ftn_areafix_t* areafix, size_t link_id,
+                                    int subscribed_only, ftn_areafix_text_t* text) {
+    size_t i;
+    int linked;
+
+    if (ftn_areafix_text_line(text, subscribed_only ? "Linked areas:" : "Available areas (* = linked):",
+                              NULL) != FTN_OK) return FTN_ERROR_NOMEM;
+
+    for (i = 0; i < areafix->area_count; i++) {
+        linked = ftn_areafix_is_subscribed(areafix, i, link_id);
+        if (subscribed_only && !linked) continue;
+        if (ftn_areafix_text_line(text, linked && !subscribed_only ? " * " : "   ",
+                                  areafix->areas[i].tag) != FTN_OK) return FTN_ERROR_NOMEM;
+    }
+    return FTN_OK;
+}
+
+ftn_error_t ftn_areafix_process_request(ftn_areafix_t* areafix, const ftn_message_t* msg, char** response) {
+    ftn_areafix_text_t text;
+    const ftn_areafix_link_t* link;
+    char* work = NULL;
+    char* line;
+    char* saveptr;
+    int link_index;
+    ftn_error_t error = FTN_OK;
+
+    if (!areafix || !msg || !response) return FTN_ERROR_INVALID_PARAMETER;
+
+    *response = NULL;
+    memset(&text, 0, sizeof(text));
+
+    link_index = ftn_areafix_find_link(areafix, &msg->orig_addr);
+    if (link_index < 0) {
+        error = ftn_areafix_text_line(&text, "Your system is not a known link.", NULL);
+        goto done;
+    }
+
+    /* The subject carries the link's Areafix password. A link without one
+       is only served when it is marked insecure, as for TICs. */
+    link = &areafix->links[link_index];
+    if (!link->password && !link->insecure) {
+        error = ftn_areafix_text_line(&text, "Your link has no Areafix password.", NULL);
+        goto done;
+    }
+    if (link->password && (!msg->subject || strcasecmp(msg->subject, link->password) != 0)) {
+        error = ftn_areafix_text_line(&text, "Password incorrect.", NULL);
+        goto done;
+    }
+
+    work = ftn_areafix_strdup(msg->text ? msg->text : "");
+    if (!work) {
+        error = FTN_ERROR_NOMEM;
+        goto done;
+    }
+
+    for (line = strtok_r(work, "\r\n", &saveptr); line && error == FTN_OK;
+         line = strtok_r(NULL, "\r\n", &saveptr)) {
+        ftn_trim(line);
+        if (line[0] == '\0' || line[0] == '\001') continue;
+
+        /* Stop at the tearline or origin line */
+        if (strncmp(line, "---", 3) == 0 || strncmp(line, "* Origin:", 9) == 0) break;
+
+        if (strcasecmp(line, "%LIST") == 0) {
+            error = ftn_areafix_list(areafix, (size_t)link_index, 0, &text);
+        } else if (strcasecmp(line, "%QUERY") == 0) {
+            error = ftn_areafix_list(areafix, (size_t)link_index, 1, &text);
+        } else if (strcasecmp(line, "%HELP") == 0) {
+            error = ftn_areafix_text_line(&text,
+                "Commands: +AREA or AREA to link, -AREA to unlink, %LIST, %QUERY, %HELP. "
+                "Area names may contain wildcards.", NULL);
+        } else if (line[0] == '%') {
+            error = ftn_areafix_text_line(&text, "Unknown command: ", line);
+        } else if (line[0] == '-') {
+            error = ftn_areafix_apply(areafix, (size_t)link_index, line + 1, 0, &text);
+        } else {
+            error = ftn_areafix_apply(areafix, (size_t)link_index, line[0] == '+' ? line + 1 : line, 1, &text);
+        }
+    }
+
+    if (error == FTN_OK && text.length == 0) {
+        error = ftn_areafix_text_line(&text, "No commands found.", NULL);
+    }
+
+done:
+    free(work);
+    if (error != FTN_OK) {
+        free(text.data);
+        return error;
+    }
+
+    *response = text.data;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_areafix_write_reply(const char* outbox, const ftn_address_t* local,
+                                    const ftn_message_t* request, const char* response) {
+    ftn_packet_t* packet = NULL;
+    ftn_message_t* reply = NULL;
+    struct tm tm_buf;
+    struct tm* tm_info;
+    struct stat st;
+    char path[1024];
+    time_t now;
+    unsigned long serial;
+    int attempts;
+    ftn_error_t error;
+
+    if (!outbox || !local || !request || !response) return FTN_ERROR_INVALID_PARAMETER;
+
+    packet = ftn_packet_new();
+    reply = ftn_message_new(FTN_MSG_NETMAIL);
+    if (!packet || !reply) {
+        error = FTN_ERROR_NOMEM;
+        goto cleanup;
+    }
+
+    reply->orig_addr = *local;
+    reply->dest_addr = request->orig_addr;
+    reply->attributes = FTN_ATTR_PRIVATE | FTN_ATTR_KILLSENT | FTN_ATTR_LOCAL;
+    reply->from_user = ftn_areafix_strdup(FTN_AREAFIX_ROBOT_NAME);
+    reply->to_user = ftn_areafix_strdup(request->from_user ? request->from_user : "Sysop");
+    reply->subject = ftn_areafix_strdup("Areafix response");
+    reply->text = ftn_areafix_strdup(response);
+    if (!reply->from_user || !reply->to_user || !reply->subject || !reply->text) {
+        error = FTN_ERROR_NOMEM;
+        goto cleanup;
+    }
+
+    if (local->zone != request->orig_addr.zone) {
+        error = ftn_message_set_intl(reply, &reply->dest_addr, &reply->orig_addr);
+        if (error != FTN_OK) goto cleanup;
+    }
+    if (local->point) ftn_message_set_fmpt(reply, local->point);
+    if (request->orig_addr.point) ftn_message_set_topt(reply, request->orig_addr.point);
+
+    now = time(NULL);
+    tm_info = ftn_localtime_r(&now, &tm_buf);
+    if (tm_info) {
+        packet->header.year = tm_info->tm_year + 1900;
+        packet->header.month = tm_info->tm_mon;
+        packet->header.day = tm_info->tm_mday;
+        packet->header.hour = tm_info->tm_hour;
+        packet->header.minute = tm_info->tm_min;
+        packet->header.second = tm_info->tm_sec;
+    }
+    packet->header.packet_type = 0x0002;
+    packet->header.orig_zone = local->zone;
+    packet->header.orig_net = local->net;
+    packet->header.orig_node = local->node;
+    packet->header.dest_zone = request->orig_addr.zone;
+    packet->header.dest_net = request->orig_addr.net;
+    packet->header.dest_node = request->orig_addr.node;
+
+    error = ftn_packet_add_message(packet, reply);
+    if (error != FTN_OK) goto cleanup;
+    reply = NULL; /* Owned by the packet now */
+
+    /* Pick an unused packet name in the outbox */
+    serial = (unsigned long)now & 0xFFFFFFFFUL;
+    for (attempts = 0; attempts < 256; attempts++) {
+        snprintf(path, sizeof(path), "%s/%08lx.pkt", outbox, (serial + attempts) & 0xFFFFFFFFUL);
+        if (stat(path, &st) != 0) break;
+    }
+    if (attempts >= 256) {
+        error = FTN_ERROR_FILE;
+        goto cleanup;
+    }
+
+    error = ftn_packet_save(path, packet);
+
+cleanup:
+    if (reply) ftn_message_free(reply);
+    if (packet) ftn_packet_free(packet);
+    return error;
+}
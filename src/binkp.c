@@ -170,6 +170,11 @@ ftn_binkp_error_t ftn_binkp_frame_send(ftn_net_connection_t* conn, const ftn_bin
         return result;
     }
 
+    /* Hold partial segments back until the burst ends at the next receive */
+    if (conn->cork_frames && !conn->corked) {
+        ftn_net_set_cork(conn, 1);
+    }
+
     net_result = ftn_net_send_all(conn, buffer, bytes_written);
     if (net_result != FTN_OK) {
         logf_error("Failed to send binkp frame: network error");
@@ -180,6 +185,47 @@ ftn_binkp_error_t ftn_binkp_frame_send(ftn_net_connection_t* conn, const ftn_bin
     return BINKP_OK;
 }
 
+ftn_binkp_error_t ftn_binkp_frame_sendfile(ftn_net_connection_t* conn, int fd, long offset, size_t len) {
+    uint8_t header[BINKP_HEADER_SIZE];
+    size_t bytes_sent;
+    ftn_error_t net_result;
+
+    if (!conn || fd < 0 || offset < 0) {
+        return BINKP_ERROR_INVALID_FRAME;
+    }
+
+    if (len > BINKP_MAX_FRAME_SIZE) {
+        return BINKP_ERROR_FRAME_TOO_LARGE;
+    }
+
+    header[0] = (uint8_t)((len >> 8) & 0x7F);
+    header[1] = (uint8_t)(len & 0xFF);
+
+    if (conn->cork_frames && !conn->corked) {
+        ftn_net_set_cork(conn, 1);
+    }
+
+    net_result = ftn_net_send_all(conn, header, sizeof(header));
+    if (net_result != FTN_OK) {
+        logf_error("Failed to send binkp frame: network error");
+        return BINKP_ERROR_NETWORK;
+    }
+
+    /* The header promised len bytes, so a short file breaks the stream */
+    net_result = ftn_net_sendfile(conn, fd, offset, len, &bytes_sent);
+    if (net_result == FTN_ERROR_FILE_IO || (net_result == FTN_OK && bytes_sent != len)) {
+        logf_error("Failed to send binkp frame: file read error");
+        return BINKP_ERROR_FILE_IO;
+    }
+    if (net_result != FTN_OK) {
+        logf_error("Failed to send binkp frame: network error");
+        return BINKP_ERROR_NETWORK;
+    }
+
+    logf_debug("Sent binkp frame: %zu bytes from file", len + BINKP_HEADER_SIZE);
+    return BINKP_OK;
+}
+
 ftn_binkp_error_t ftn_binkp_frame_receive(ftn_net_connection_t* conn, ftn_binkp_frame_t* frame, int timeout_ms) {
     uint8_t header[BINKP_HEADER_SIZE];
     uint16_t header_word;
@@ -190,6 +236,11 @@ ftn_binkp_error_t ftn_binkp_frame_receive(ftn_net_connection_t* conn, ftn_binkp_
         return BINKP_ERROR_INVALID_FRAME;
     }
 
+    /* Flush any corked burst before waiting on the peer */
+    if (conn->corked) {
+        ftn_net_set_cork(conn, 0);
+    }
+
     /* Set receive timeout */
     if (timeout_ms > 0) {
         ftn_net_set_timeout(conn, timeout_ms);
@@ -280,6 +331,10 @@ const char* ftn_binkp_error_string(ftn_binkp_error_t error) {
             return "Authentication failed";
         case BINKP_ERROR_PROTOCOL_ERROR:
             return "Protocol error";
+        case BINKP_ERROR_NOMEM:
+            return "Out of memory";
+        case BINKP_ERROR_FILE_IO:
+            return "File I/O error";
         default:
             return "Unknown error";
     }
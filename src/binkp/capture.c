@@ -0,0 +1,470 @@
+/*
+ * capture.c - Binkp session capture and replay for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include "ftn/binkp/capture.h"
+#include "ftn/binkp/session.h"
+#include "ftn/log.h"
+
+static void capture_now(long* sec, long* usec) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    *sec = (long)tv.tv_sec;
+    *usec = (long)tv.tv_usec;
+}
+
+static double capture_elapsed_us(long start_sec, long start_usec) {
+    long sec;
+    long usec;
+    double elapsed;
+
+    capture_now(&sec, &usec);
+    elapsed = (double)(sec - start_sec) * 1000000.0 + (double)(usec - start_usec);
+    return elapsed < 0.0 ? 0.0 : elapsed;
+}
+
+static void put_be32(uint8_t* buffer, uint32_t value) {
+    buffer[0] = (uint8_t)((value >> 24) & 0xFF);
+    buffer[1] = (uint8_t)((value >> 16) & 0xFF);
+    buffer[2] = (uint8_t)((value >> 8) & 0xFF);
+    buffer[3] = (uint8_t)(value & 0xFF);
+}
+
+static uint32_t get_be32(const uint8_t* buffer) {
+    return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) |
+           ((uint32_t)buffer[2] << 8) | (uint32_t)buffer[3];
+}
+
+ftn_binkp_capture_t* ftn_binkp_capture_open(const char* path, int is_originator) {
+    ftn_binkp_capture_t* capture;
+    uint8_t header[BINKP_CAPTURE_HEADER_SIZE];
+
+    if (!path) {
+        return NULL;
+    }
+
+    capture = malloc(sizeof(ftn_binkp_capture_t));
+    if (!capture) {
+        return NULL;
+    }
+    memset(capture, 0, sizeof(ftn_binkp_capture_t));
+
+    capture->file = fopen(path, "wb");
+    if (!capture->file) {
+        logf_error("Cannot create binkp capture %s", path);
+        free(capture);
+        return NULL;
+    }
+
+    capture_now(&capture->last_sec, &capture->last_usec);
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, BINKP_CAPTURE_MAGIC, BINKP_CAPTURE_MAGIC_SIZE);
+    header[8] = (uint8_t)(is_originator ? 'O' : 'A');
+    put_be32(header + 12, (uint32_t)capture->last_sec);
+
+    if (fwrite(header, 1, sizeof(header), capture->file) != sizeof(header)) {
+        logf_error("Cannot write binkp capture header to %s", path);
+        fclose(capture->file);
+        free(capture);
+        return NULL;
+    }
+
+    logf_debug("Capturing binkp session to %s", path);
+    return capture;
+}
+
+ftn_binkp_error_t ftn_binkp_capture_record(ftn_binkp_capture_t* capture, ftn_binkp_capture_dir_t direction, const ftn_binkp_frame_t* frame) {
+    uint8_t record[BINKP_CAPTURE_RECORD_SIZE];
+    size_t size;
+    long sec;
+    long usec;
+    double delta;
+
+    if (!capture || !frame) {
+        return BINKP_ERROR_INVALID_FRAME;
+    }
+
+    /* A broken capture must never break the session it is watching */
+    if (capture->failed || !capture->file) {
+        return BINKP_ERROR_NETWORK;
+    }
+
+    capture_now(&sec, &usec);
+    delta = (double)(sec - capture->last_sec) * 1000000.0 + (double)(usec - capture->last_usec);
+    if (delta < 0.0) {
+        delta = 0.0;
+    } else if (delta > 4294967295.0) {
+        delta = 4294967295.0;
+    }
+    capture->last_sec = sec;
+    capture->last_usec = usec;
+
+    /* Keep the password out of the capture */
+    size = frame->size;
+    if (frame->is_command && size > 1 && frame->data[0] == BINKP_M_PWD) {
+        size = 1;
+    }
+
+    record[0] = (uint8_t)direction;
+    put_be32(record + 1, (uint32_t)delta);
+    record[5] = (uint8_t)((frame->header[0] & 0x80) | ((size >> 8) & 0x7F));
+    record[6] = (uint8_t)(size & 0xFF);
+
+    if (fwrite(record, 1, sizeof(record), capture->file) != sizeof(record) ||
+        (size > 0 && fwrite(frame->data, 1, size, capture->file) != size)) {
+        logf_warning("Binkp capture write failed, capture disabled");
+        capture->failed = 1;
+        return BINKP_ERROR_NETWORK;
+    }
+
+    capture->frames++;
+    capture->bytes += (unsigned long)size;
+    return BINKP_OK;
+}
+
+void ftn_binkp_capture_close(ftn_binkp_capture_t* capture) {
+    if (!capture) {
+        return;
+    }
+
+    if (capture->file) {
+        fclose(capture->file);
+    }
+
+    logf_debug("Binkp capture closed: %lu frames, %lu bytes", capture->frames, capture->bytes);
+    free(capture);
+}
+
+static ftn_binkp_error_t replay_add_record(ftn_binkp_replay_t* replay, ftn_binkp_capture_dir_t direction, double offset_us, const uint8_t* header, const uint8_t* data) {
+    ftn_binkp_capture_record_t* record;
+    ftn_binkp_capture_record_t* new_records;
+    size_t new_capacity;
+    size_t size;
+
+    if (replay->count >= replay->capacity) {
+        new_capacity = replay->capacity ? replay->capacity * 2 : 16;
+        new_records = realloc(replay->records, new_capacity * sizeof(ftn_binkp_capture_record_t));
+        if (!new_records) {
+            return BINKP_ERROR_NOMEM;
+        }
+        replay->records = new_records;
+        replay->capacity = new_capacity;
+    }
+
+    record = &replay->records[replay->count];
+    record->direction = direction;
+    record->offset_us = offset_us;
+    ftn_binkp_frame_init(&record->frame);
+
+    size = (size_t)(((header[0] & 0x7F) << 8) | header[1]);
+    if (size > 0) {
+        record->frame.data = malloc(size);
+        if (!record->frame.data) {
+            return BINKP_ERROR_NOMEM;
+        }
+        memcpy(record->frame.data, data, size);
+    }
+    record->frame.header[0] = header[0];
+    record->frame.header[1] = header[1];
+    record->frame.is_command = (header[0] & 0x80) ? 1 : 0;
+    record->frame.size = size;
+
+    replay->count++;
+    return BINKP_OK;
+}
+
+ftn_binkp_replay_t* ftn_binkp_replay_load(const char* path) {
+    ftn_binkp_replay_t* replay = NULL;
+    FILE* fp;
+    uint8_t header[BINKP_CAPTURE_HEADER_SIZE];
+    uint8_t record[BINKP_CAPTURE_RECORD_SIZE];
+    uint8_t* data = NULL;
+    size_t size;
+    size_t got;
+    int deltas;
+    double offset_us = 0.0;
+
+    if (!path) {
+        return NULL;
+    }
+
+    fp = fopen(path, "rb");
+    if (!fp) {
+        logf_error("Cannot open binkp capture %s", path);
+        return NULL;
+    }
+
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header) ||
+        (memcmp(header, BINKP_CAPTURE_MAGIC, BINKP_CAPTURE_MAGIC_SIZE) != 0 &&
+         memcmp(header, BINKP_CAPTURE_MAGIC_V1, BINKP_CAPTURE_MAGIC_SIZE) != 0) ||
+        (header[8] != 'O' && header[8] != 'A')) {
+        logf_error("%s is not a binkp capture", path);
+        goto cleanup;
+    }
+    deltas = memcmp(header, BINKP_CAPTURE_MAGIC, BINKP_CAPTURE_MAGIC_SIZE) == 0;
+
+    replay = malloc(sizeof(ftn_binkp_replay_t));
+    data = malloc(BINKP_MAX_FRAME_SIZE);
+    if (!replay || !data) {
+        free(replay);
+        replay = NULL;
+        goto cleanup;
+    }
+    memset(replay, 0, sizeof(ftn_binkp_replay_t));
+    replay->is_originator = header[8] == 'O';
+    replay->session_start = (time_t)get_be32(header + 12);
+
+    while ((got = fread(record, 1, sizeof(record), fp)) == sizeof(record)) {
+        if (record[0] != BINKP_CAPTURE_SENT && record[0] != BINKP_CAPTURE_RECEIVED) {
+            logf_warning("Binkp capture %s: bad record at frame %lu, truncating",
+                         path, (unsigned long)replay->count);
+            break;
+        }
+
+        size = (size_t)(((record[5] & 0x7F) << 8) | record[6]);
+        if (size > 0 && fread(data, 1, size, fp) != size) {
+            logf_warning("Binkp capture %s: short frame at %lu, truncating",
+                         path, (unsigned long)replay->count);
+            break;
+        }
+
+        if (deltas) {
+            offset_us += (double)get_be32(record + 1);
+        } else {
+            offset_us = (double)get_be32(record + 1);
+        }
+
+        if (replay_add_record(replay, (ftn_binkp_capture_dir_t)record[0], offset_us,
+                              record + 5, data) != BINKP_OK) {
+            ftn_binkp_replay_free(replay);
+            replay = NULL;
+            goto cleanup;
+        }
+    }
+
+    if (got > 0 && got < sizeof(record)) {
+        logf_warning("Binkp capture %s: trailing partial record ignored", path);
+    }
+
+    ftn_binkp_replay_rewind(replay);
+
+cleanup:
+    free(data);
+    fclose(fp);
+    return replay;
+}
+
+void ftn_binkp_replay_free(ftn_binkp_replay_t* replay) {
+    size_t i;
+
+    if (!replay) {
+        return;
+    }
+
+    for (i = 0; i < replay->count; i++) {
+        ftn_binkp_frame_free(&replay->records[i].frame);
+    }
+    free(replay->records);
+    free(replay);
+}
+
+void ftn_binkp_replay_rewind(ftn_binkp_replay_t* replay) {
+    if (!replay) {
+        return;
+    }
+
+    replay->recv_pos = 0;
+    replay->send_pos = 0;
+    replay->frames_fed = 0;
+    replay->frames_sent = 0;
+    replay->divergences = 0;
+    capture_now(&replay->start_sec, &replay->start_usec);
+}
+
+static void replay_wait(ftn_binkp_replay_t* replay, double offset_us) {
+    double now_us;
+    double delay_us;
+    struct timeval tv;
+
+    now_us = capture_elapsed_us(replay->start_sec, replay->start_usec);
+    if (offset_us <= now_us) {
+        return;
+    }
+
+    delay_us = offset_us - now_us;
+    tv.tv_sec = (long)(delay_us / 1000000.0);
+    tv.tv_usec = (long)(delay_us - (double)tv.tv_sec * 1000000.0);
+    select(0, NULL, NULL, NULL, &tv);
+}
+
+/* A captured M_PWD with its password dropped */
+static int replay_is_redacted_pwd(const ftn_binkp_frame_t* frame) {
+    return frame->is_command && frame->size == 1 && frame->data[0] == BINKP_M_PWD;
+}
+
+/* Put the replay password back into a redacted M_PWD */
+static ftn_binkp_error_t replay_password_frame(const ftn_binkp_replay_t* replay, ftn_binkp_frame_t* frame) {
+    const char* password = replay->password ? replay->password : "-";
+    uint8_t* data;
+    size_t size;
+    ftn_binkp_error_t result;
+
+    size = 1 + strlen(password);
+    data = malloc(size);
+    if (!data) {
+        return BINKP_ERROR_NOMEM;
+    }
+    data[0] = BINKP_M_PWD;
+    memcpy(data + 1, password, size - 1);
+
+    result = ftn_binkp_frame_create(frame, 1, data, size);
+    free(data);
+    return result;
+}
+
+ftn_binkp_error_t ftn_binkp_replay_receive(ftn_binkp_replay_t* replay, ftn_binkp_frame_t* frame) {
+    const ftn_binkp_capture_record_t* record;
+
+    if (!replay || !frame) {
+        return BINKP_ERROR_INVALID_FRAME;
+    }
+
+    while (replay->recv_pos < replay->count &&
+           replay->records[replay->recv_pos].direction != BINKP_CAPTURE_RECEIVED) {
+        replay->recv_pos++;
+    }
+
+    /* The peer hung up where the capture ends */
+    if (replay->recv_pos >= replay->count) {
+        return BINKP_ERROR_NETWORK;
+    }
+
+    record = &replay->records[replay->recv_pos++];
+    if (replay->honor_timing) {
+        replay_wait(replay, record->offset_us);
+    }
+
+    ftn_binkp_frame_init(frame);
+    if (replay_is_redacted_pwd(&record->frame)) {
+        if (replay_password_frame(replay, frame) != BINKP_OK) {
+            return BINKP_ERROR_NOMEM;
+        }
+    } else if (ftn_binkp_frame_create(frame, record->frame.is_command, record->frame.data, record->frame.size) != BINKP_OK) {
+        return BINKP_ERROR_NOMEM;
+    }
+
+    replay->frames_fed++;
+    return BINKP_OK;
+}
+
+ftn_binkp_error_t ftn_binkp_replay_send(ftn_binkp_replay_t* replay, const ftn_binkp_frame_t* frame) {
+    const ftn_binkp_capture_record_t* record;
+
+    if (!replay || !frame) {
+        return BINKP_ERROR_INVALID_FRAME;
+    }
+
+    replay->frames_sent++;
+
+    while (replay->send_pos < replay->count &&
+           replay->records[replay->send_pos].direction != BINKP_CAPTURE_SENT) {
+        replay->send_pos++;
+    }
+
+    if (replay->send_pos >= replay->count) {
+        logf_debug("Replay: frame %lu sent past the end of the capture", replay->frames_sent);
+        replay->divergences++;
+        return BINKP_OK;
+    }
+
+    record = &replay->records[replay->send_pos++];
+    if (replay_is_redacted_pwd(&record->frame)) {
+        /* Only the command survived capture; any password matches */
+        if (!frame->is_command || frame->size < 1 || frame->data[0] != BINKP_M_PWD) {
+            logf_debug("Replay: frame %lu differs from the capture", replay->frames_sent);
+            replay->divergences++;
+        }
+    } else if (record->frame.header[0] != frame->header[0] ||
+        record->frame.header[1] != frame->header[1] ||
+        (frame->size > 0 && memcmp(record->frame.data, frame->data, frame->size) != 0)) {
+        logf_debug("Replay: frame %lu differs from the capture", replay->frames_sent);
+        replay->divergences++;
+    }
+
+    return BINKP_OK;
+}
+
+ftn_binkp_error_t ftn_binkp_replay_run(ftn_binkp_replay_t* replay, ftn_config_t* config, ftn_binkp_replay_stats_t* stats) {
+    ftn_binkp_session_t session;
+    ftn_binkp_error_t result;
+    long start_sec;
+    long start_usec;
+    clock_t cpu_start;
+    size_t i;
+
+    if (!replay || !config) {
+        return BINKP_ERROR_INVALID_FRAME;
+    }
+
+    ftn_binkp_replay_rewind(replay);
+    if (config->network_count > 0 && config->networks[0].password) {
+        replay->password = config->networks[0].password;
+    }
+
+    result = ftn_binkp_session_init_replay(&session, replay, config);
+    if (result != BINKP_OK) {
+        return result;
+    }
+
+    capture_now(&start_sec, &start_usec);
+    cpu_start = clock();
+
+    result = ftn_binkp_session_run(&session);
+
+    if (stats) {
+        memset(stats, 0, sizeof(ftn_binkp_replay_stats_t));
+        stats->result = result;
+        stats->wall_us = (unsigned long)capture_elapsed_us(start_sec, start_usec);
+        stats->cpu_us = (unsigned long)((double)(clock() - cpu_start) * 1000000.0 / CLOCKS_PER_SEC);
+        stats->frames_fed = replay->frames_fed;
+        stats->frames_sent = replay->frames_sent;
+        stats->divergences = replay->divergences;
+        for (i = replay->recv_pos; i < replay->count; i++) {
+            if (replay->records[i].direction == BINKP_CAPTURE_RECEIVED) {
+                stats->frames_unused++;
+            }
+        }
+    }
+
+    ftn_binkp_session_free(&session);
+    return result;
+}
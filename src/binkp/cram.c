@@ -31,11 +31,7 @@
 #include "ftn/log.h"
 
 /* Simple MD5 implementation for CRAM (RFC 1321) */
-typedef struct {
-    uint32_t state[4];
-    uint32_t count[2];
-    uint8_t buffer[64];
-} md5_context_t;
+typedef ftn_md5_context_t md5_context_t;
 
 /* Simple SHA1 implementation for CRAM (RFC 3174) */
 typedef struct {
@@ -162,30 +158,32 @@ static void sha1_final(uint8_t digest[20], sha1_context_t* ctx) {
     }
 }
 
-/* MD5 Constants and functions */
-#define MD5_S11 7
-#define MD5_S12 12
-#define MD5_S13 17
-#define MD5_S14 22
-#define MD5_S21 5
-#define MD5_S22 9
-#define MD5_S23 14
-#define MD5_S24 20
-#define MD5_S31 4
-#define MD5_S32 11
-#define MD5_S33 16
-#define MD5_S34 23
-#define MD5_S41 6
-#define MD5_S42 10
-#define MD5_S43 15
-#define MD5_S44 21
-
-static uint32_t md5_f(uint32_t x, uint32_t y, uint32_t z) { return (x & y) | (~x & z); }
-/*
-static uint32_t md5_g(uint32_t x, uint32_t y, uint32_t z) { return (x & z) | (y & ~z); }
-static uint32_t md5_h(uint32_t x, uint32_t y, uint32_t z) { return x ^ y ^ z; }
-static uint32_t md5_i(uint32_t x, uint32_t y, uint32_t z) { return y ^ (x | ~z); }
-*/
+/* MD5 constants (RFC 1321, section 3.4) */
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+    0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+    0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+    0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+    0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+    0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const int md5_shift[4][4] = {
+    { 7, 12, 17, 22 },
+    { 5, 9, 14, 20 },
+    { 4, 11, 16, 23 },
+    { 6, 10, 15, 21 }
+};
 
 static uint32_t md5_rotleft(uint32_t value, int shift) {
     return (value << shift) | (value >> (32 - shift));
@@ -194,19 +192,28 @@ static uint32_t md5_rotleft(uint32_t value, int shift) {
 static void md5_transform(uint32_t state[4], const uint8_t block[64]) {
     uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
     uint32_t x[16];
-    int i;
+    uint32_t f, temp;
+    int i, g, round;
 
     for (i = 0; i < 16; i++) {
         x[i] = (uint32_t)block[i * 4] | ((uint32_t)block[i * 4 + 1] << 8) |
                ((uint32_t)block[i * 4 + 2] << 16) | ((uint32_t)block[i * 4 + 3] << 24);
     }
 
-    /* Round 1 */
-    a = b + md5_rotleft(a + md5_f(b, c, d) + x[0] + 0xd76aa478, MD5_S11);
-    d = a + md5_rotleft(d + md5_f(a, b, c) + x[1] + 0xe8c7b756, MD5_S12);
-    c = d + md5_rotleft(c + md5_f(d, a, b) + x[2] + 0x242070db, MD5_S13);
-    b = c + md5_rotleft(b + md5_f(c, d, a) + x[3] + 0xc1bdceee, MD5_S14);
-    /* ... (simplified - full implementation would have all 64 operations) */
+    for (i = 0; i < 64; i++) {
+        round = i / 16;
+        switch (round) {
+            case 0:  f = (b & c) | (~b & d); g = i; break;
+            case 1:  f = (d & b) | (~d & c); g = (5 * i + 1) % 16; break;
+            case 2:  f = b ^ c ^ d;          g = (3 * i + 5) % 16; break;
+            default: f = c ^ (b | ~d);       g = (7 * i) % 16; break;
+        }
+        temp = d;
+        d = c;
+        c = b;
+        b = b + md5_rotleft(a + f + md5_k[i] + x[g], md5_shift[round][i % 4]);
+        a = temp;
+    }
 
     state[0] += a;
     state[1] += b;
@@ -490,6 +497,18 @@ ftn_binkp_error_t ftn_md5_hash(const uint8_t* data, size_t len, uint8_t* digest)
     return BINKP_OK;
 }
 
+void ftn_md5_init(ftn_md5_context_t* ctx) {
+    md5_init(ctx);
+}
+
+void ftn_md5_update(ftn_md5_context_t* ctx, const void* data, size_t len) {
+    md5_update(ctx, (const uint8_t*)data, len);
+}
+
+void ftn_md5_final(ftn_md5_context_t* ctx, uint8_t digest[16]) {
+    md5_final(digest, ctx);
+}
+
 ftn_binkp_error_t ftn_sha1_hash(const uint8_t* data, size_t len, uint8_t* digest) {
     sha1_context_t ctx;
 
@@ -21,40 +21,101 @@
  * SOFTWARE.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "ftn/binkp/crc.h"
 #include "ftn/log.h"
 
 /* CRC32 polynomial (IEEE 802.3) */
 #define CRC32_POLYNOMIAL 0xEDB88320UL
 
-/* Global CRC32 lookup table */
-static uint32_t crc32_table[256];
-static int crc32_table_initialized = 0;
+/* CRC cache file format */
+#define CRC_CACHE_VERSION_STRING "# libFTN CRC Cache v1.0"
+#define CRC_CACHE_INITIAL_CAPACITY 16
+#define CRC_CACHE_INITIAL_BUCKETS 64
+
+/* Refresh an entry's last-used time at most this often */
+#define CRC_CACHE_TOUCH_INTERVAL (24L * 60 * 60)
+
+/* CRC32 lookup table for CRC32_POLYNOMIAL, precomputed so that it is
+   read-only and safe to share between threads */
+static const uint32_t crc32_table[256] = {
+    0x00000000UL, 0x77073096UL, 0xEE0E612CUL, 0x990951BAUL,
+    0x076DC419UL, 0x706AF48FUL, 0xE963A535UL, 0x9E6495A3UL,
+    0x0EDB8832UL, 0x79DCB8A4UL, 0xE0D5E91EUL, 0x97D2D988UL,
+    0x09B64C2BUL, 0x7EB17CBDUL, 0xE7B82D07UL, 0x90BF1D91UL,
+    0x1DB71064UL, 0x6AB020F2UL, 0xF3B97148UL, 0x84BE41DEUL,
+    0x1ADAD47DUL, 0x6DDDE4EBUL, 0xF4D4B551UL, 0x83D385C7UL,
+    0x136C9856UL, 0x646BA8C0UL, 0xFD62F97AUL, 0x8A65C9ECUL,
+    0x14015C4FUL, 0x63066CD9UL, 0xFA0F3D63UL, 0x8D080DF5UL,
+    0x3B6E20C8UL, 0x4C69105EUL, 0xD56041E4UL, 0xA2677172UL,
+    0x3C03E4D1UL, 0x4B04D447UL, 0xD20D85FDUL, 0xA50AB56BUL,
+    0x35B5A8FAUL, 0x42B2986CUL, 0xDBBBC9D6UL, 0xACBCF940UL,
+    0x32D86CE3UL, 0x45DF5C75UL, 0xDCD60DCFUL, 0xABD13D59UL,
+    0x26D930ACUL, 0x51DE003AUL, 0xC8D75180UL, 0xBFD06116UL,
+    0x21B4F4B5UL, 0x56B3C423UL, 0xCFBA9599UL, 0xB8BDA50FUL,
+    0x2802B89EUL, 0x5F058808UL, 0xC60CD9B2UL, 0xB10BE924UL,
+    0x2F6F7C87UL, 0x58684C11UL, 0xC1611DABUL, 0xB6662D3DUL,
+    0x76DC4190UL, 0x01DB7106UL, 0x98D220BCUL, 0xEFD5102AUL,
+    0x71B18589UL, 0x06B6B51FUL, 0x9FBFE4A5UL, 0xE8B8D433UL,
+    0x7807C9A2UL, 0x0F00F934UL, 0x9609A88EUL, 0xE10E9818UL,
+    0x7F6A0DBBUL, 0x086D3D2DUL, 0x91646C97UL, 0xE6635C01UL,
+    0x6B6B51F4UL, 0x1C6C6162UL, 0x856530D8UL, 0xF262004EUL,
+    0x6C0695EDUL, 0x1B01A57BUL, 0x8208F4C1UL, 0xF50FC457UL,
+    0x65B0D9C6UL, 0x12B7E950UL, 0x8BBEB8EAUL, 0xFCB9887CUL,
+    0x62DD1DDFUL, 0x15DA2D49UL, 0x8CD37CF3UL, 0xFBD44C65UL,
+    0x4DB26158UL, 0x3AB551CEUL, 0xA3BC0074UL, 0xD4BB30E2UL,
+    0x4ADFA541UL, 0x3DD895D7UL, 0xA4D1C46DUL, 0xD3D6F4FBUL,
+    0x4369E96AUL, 0x346ED9FCUL, 0xAD678846UL, 0xDA60B8D0UL,
+    0x44042D73UL, 0x33031DE5UL, 0xAA0A4C5FUL, 0xDD0D7CC9UL,
+    0x5005713CUL, 0x270241AAUL, 0xBE0B1010UL, 0xC90C2086UL,
+    0x5768B525UL, 0x206F85B3UL, 0xB966D409UL, 0xCE61E49FUL,
+    0x5EDEF90EUL, 0x29D9C998UL, 0xB0D09822UL, 0xC7D7A8B4UL,
+    0x59B33D17UL, 0x2EB40D81UL, 0xB7BD5C3BUL, 0xC0BA6CADUL,
+    0xEDB88320UL, 0x9ABFB3B6UL, 0x03B6E20CUL, 0x74B1D29AUL,
+    0xEAD54739UL, 0x9DD277AFUL, 0x04DB2615UL, 0x73DC1683UL,
+    0xE3630B12UL, 0x94643B84UL, 0x0D6D6A3EUL, 0x7A6A5AA8UL,
+    0xE40ECF0BUL, 0x9309FF9DUL, 0x0A00AE27UL, 0x7D079EB1UL,
+    0xF00F9344UL, 0x8708A3D2UL, 0x1E01F268UL, 0x6906C2FEUL,
+    0xF762575DUL, 0x806567CBUL, 0x196C3671UL, 0x6E6B06E7UL,
+    0xFED41B76UL, 0x89D32BE0UL, 0x10DA7A5AUL, 0x67DD4ACCUL,
+    0xF9B9DF6FUL, 0x8EBEEFF9UL, 0x17B7BE43UL, 0x60B08ED5UL,
+    0xD6D6A3E8UL, 0xA1D1937EUL, 0x38D8C2C4UL, 0x4FDFF252UL,
+    0xD1BB67F1UL, 0xA6BC5767UL, 0x3FB506DDUL, 0x48B2364BUL,
+    0xD80D2BDAUL, 0xAF0A1B4CUL, 0x36034AF6UL, 0x41047A60UL,
+    0xDF60EFC3UL, 0xA867DF55UL, 0x316E8EEFUL, 0x4669BE79UL,
+    0xCB61B38CUL, 0xBC66831AUL, 0x256FD2A0UL, 0x5268E236UL,
+    0xCC0C7795UL, 0xBB0B4703UL, 0x220216B9UL, 0x5505262FUL,
+    0xC5BA3BBEUL, 0xB2BD0B28UL, 0x2BB45A92UL, 0x5CB36A04UL,
+    0xC2D7FFA7UL, 0xB5D0CF31UL, 0x2CD99E8BUL, 0x5BDEAE1DUL,
+    0x9B64C2B0UL, 0xEC63F226UL, 0x756AA39CUL, 0x026D930AUL,
+    0x9C0906A9UL, 0xEB0E363FUL, 0x72076785UL, 0x05005713UL,
+    0x95BF4A82UL, 0xE2B87A14UL, 0x7BB12BAEUL, 0x0CB61B38UL,
+    0x92D28E9BUL, 0xE5D5BE0DUL, 0x7CDCEFB7UL, 0x0BDBDF21UL,
+    0x86D3D2D4UL, 0xF1D4E242UL, 0x68DDB3F8UL, 0x1FDA836EUL,
+    0x81BE16CDUL, 0xF6B9265BUL, 0x6FB077E1UL, 0x18B74777UL,
+    0x88085AE6UL, 0xFF0F6A70UL, 0x66063BCAUL, 0x11010B5CUL,
+    0x8F659EFFUL, 0xF862AE69UL, 0x616BFFD3UL, 0x166CCF45UL,
+    0xA00AE278UL, 0xD70DD2EEUL, 0x4E048354UL, 0x3903B3C2UL,
+    0xA7672661UL, 0xD06016F7UL, 0x4969474DUL, 0x3E6E77DBUL,
+    0xAED16A4AUL, 0xD9D65ADCUL, 0x40DF0B66UL, 0x37D83BF0UL,
+    0xA9BCAE53UL, 0xDEBB9EC5UL, 0x47B2CF7FUL, 0x30B5FFE9UL,
+    0xBDBDF21CUL, 0xCABAC28AUL, 0x53B39330UL, 0x24B4A3A6UL,
+    0xBAD03605UL, 0xCDD70693UL, 0x54DE5729UL, 0x23D967BFUL,
+    0xB3667A2EUL, 0xC4614AB8UL, 0x5D681B02UL, 0x2A6F2B94UL,
+    0xB40BBE37UL, 0xC30C8EA1UL, 0x5A05DF1BUL, 0x2D02EF8DUL
+};
 
 void ftn_crc32_init_table(void) {
-    uint32_t crc;
-    int i, j;
-
-    if (crc32_table_initialized) {
-        return;
-    }
-
-    for (i = 0; i < 256; i++) {
-        crc = (uint32_t)i;
-        for (j = 0; j < 8; j++) {
-            if (crc & 1) {
-                crc = (crc >> 1) ^ CRC32_POLYNOMIAL;
-            } else {
-                crc >>= 1;
-            }
-        }
-        crc32_table[i] = crc;
-    }
-
-    crc32_table_initialized = 1;
+    /* The table is static; kept for API compatibility */
 }
 
 uint32_t ftn_crc32_calculate(const uint8_t* data, size_t len) {
@@ -64,10 +125,6 @@ uint32_t ftn_crc32_calculate(const uint8_t* data, size_t len) {
 uint32_t ftn_crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
     size_t i;
 
-    if (!crc32_table_initialized) {
-        ftn_crc32_init_table();
-    }
-
     if (!data) {
         return crc;
     }
@@ -92,7 +149,7 @@ ftn_binkp_error_t ftn_crc32_file(const char* filename, uint32_t* crc) {
     file = fopen(filename, "rb");
     if (!file) {
         logf_error("Failed to open file %s for CRC calculation", filename);
-        return BINKP_ERROR_PROTOCOL_ERROR;
+        return BINKP_ERROR_FILE_IO;
     }
 
     file_crc = 0xFFFFFFFFUL;
@@ -101,6 +158,11 @@ ftn_binkp_error_t ftn_crc32_file(const char* filename, uint32_t* crc) {
         file_crc = ftn_crc32_update(file_crc, buffer, bytes_read);
     }
 
+    if (ferror(file)) {
+        logf_error("Failed to read file %s for CRC calculation", filename);
+        fclose(file);
+        return BINKP_ERROR_FILE_IO;
+    }
     fclose(file);
 
     *crc = file_crc ^ 0xFFFFFFFFUL;
@@ -117,9 +179,6 @@ ftn_binkp_error_t ftn_crc_init(ftn_crc_context_t* ctx) {
     ctx->remote_mode = CRC_MODE_NONE;
     ctx->algorithm = CRC_ALGORITHM_NONE;
 
-    /* Initialize CRC table if not already done */
-    ftn_crc32_init_table();
-
     return BINKP_OK;
 }
 
@@ -501,4 +560,342 @@ double ftn_crc_get_success_rate(const ftn_crc_context_t* ctx) {
     }
 
     return (double)ctx->files_verified / (double)total_files;
-}
\ No newline at end of file
+}
+
+/* Fill an entry's key fields from the file's current metadata */
+static int ftn_crc_cache_key(const char* filename, ftn_crc_cache_entry_t* key) {
+    struct stat st;
+
+    if (stat(filename, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return 0;
+    }
+
+    memset(key, 0, sizeof(ftn_crc_cache_entry_t));
+    key->dev = (unsigned long)st.st_dev;
+    key->ino = (unsigned long)st.st_ino;
+    key->size = (unsigned long)st.st_size;
+    key->mtime_sec = (long)st.st_mtime;
+#if defined(__APPLE__)
+    key->mtime_nsec = (long)st.st_mtimespec.tv_nsec;
+#else
+    key->mtime_nsec = (long)st.st_mtim.tv_nsec;
+#endif
+    return 1;
+}
+
+static int ftn_crc_cache_same_version(const ftn_crc_cache_entry_t* a, const ftn_crc_cache_entry_t* b) {
+    return a->size == b->size && a->mtime_sec == b->mtime_sec && a->mtime_nsec == b->mtime_nsec;
+}
+
+static size_t ftn_crc_cache_hash(unsigned long dev, unsigned long ino) {
+    unsigned long hash = 2166136261UL;
+
+    hash = (hash ^ dev) * 16777619UL;
+    hash = (hash ^ ino) * 16777619UL;
+    hash ^= hash >> 15;
+    return (size_t)hash;
+}
+
+/* Bucket holding the (dev, ino) pair, or the empty bucket where it belongs */
+static size_t ftn_crc_cache_slot(const ftn_crc_cache_t* cache, unsigned long dev, unsigned long ino) {
+    size_t mask = cache->bucket_count - 1;
+    size_t slot = ftn_crc_cache_hash(dev, ino) & mask;
+    const ftn_crc_cache_entry_t* entry;
+
+    while (cache->buckets[slot] != 0) {
+        entry = &cache->entries[cache->buckets[slot] - 1];
+        if (entry->dev == dev && entry->ino == ino) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static ftn_binkp_error_t ftn_crc_cache_rehash(ftn_crc_cache_t* cache, size_t bucket_count) {
+    size_t* buckets;
+    size_t i;
+
+    buckets = calloc(bucket_count, sizeof(size_t));
+    if (!buckets) {
+        return BINKP_ERROR_NOMEM;
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_count = bucket_count;
+
+    for (i = 0; i < cache->count; i++) {
+        cache->buckets[ftn_crc_cache_slot(cache, cache->entries[i].dev, cache->entries[i].ino)] = i + 1;
+    }
+    return BINKP_OK;
+}
+
+/* Add or replace the entry for a file; a new version of a file replaces the old one */
+static ftn_binkp_error_t ftn_crc_cache_put(ftn_crc_cache_t* cache, const ftn_crc_cache_entry_t* entry) {
+    ftn_crc_cache_entry_t* grown;
+    size_t new_capacity;
+    size_t slot;
+    ftn_binkp_error_t result;
+
+    if (!cache->buckets || (cache->count + 1) * 2 > cache->bucket_count) {
+        result = ftn_crc_cache_rehash(cache, cache->bucket_count ? cache->bucket_count * 2
+                                                                 : CRC_CACHE_INITIAL_BUCKETS);
+        if (result != BINKP_OK) {
+            return result;
+        }
+    }
+
+    slot = ftn_crc_cache_slot(cache, entry->dev, entry->ino);
+    if (cache->buckets[slot] != 0) {
+        cache->entries[cache->buckets[slot] - 1] = *entry;
+        cache->modified = 1;
+        return BINKP_OK;
+    }
+
+    if (cache->count >= cache->capacity) {
+        new_capacity = cache->capacity ? cache->capacity * 2 : CRC_CACHE_INITIAL_CAPACITY;
+        grown = realloc(cache->entries, new_capacity * sizeof(ftn_crc_cache_entry_t));
+        if (!grown) {
+            return BINKP_ERROR_NOMEM;
+        }
+        cache->entries = grown;
+        cache->capacity = new_capacity;
+    }
+
+    cache->entries[cache->count] = *entry;
+    cache->buckets[slot] = ++cache->count;
+    cache->modified = 1;
+    return BINKP_OK;
+}
+
+ftn_crc_cache_t* ftn_crc_cache_new(const char* path) {
+    ftn_crc_cache_t* cache;
+
+    cache = malloc(sizeof(ftn_crc_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+
+    memset(cache, 0, sizeof(ftn_crc_cache_t));
+    if (path) {
+        cache->path = malloc(strlen(path) + 1);
+        if (!cache->path) {
+            free(cache);
+            return NULL;
+        }
+        strcpy(cache->path, path);
+    }
+    return cache;
+}
+
+void ftn_crc_cache_free(ftn_crc_cache_t* cache) {
+    if (!cache) {
+        return;
+    }
+
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache->path);
+    free(cache);
+}
+
+/* Read a cache file, keeping in-memory entries for files already known */
+static ftn_binkp_error_t ftn_crc_cache_merge_file(ftn_crc_cache_t* cache) {
+    FILE* fp;
+    char line[256];
+    ftn_crc_cache_entry_t entry;
+    unsigned long crc;
+    long last_used;
+    size_t slot;
+    ftn_binkp_error_t result = BINKP_OK;
+
+    fp = fopen(cache->path, "r");
+    if (!fp) {
+        /* No cache yet */
+        return BINKP_OK;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        memset(&entry, 0, sizeof(entry));
+        if (sscanf(line, "%lu|%lu|%lu|%ld|%ld|%lx|%ld", &entry.dev, &entry.ino, &entry.size,
+                   &entry.mtime_sec, &entry.mtime_nsec, &crc, &last_used) != 7) {
+            continue;
+        }
+        entry.crc32 = (uint32_t)crc;
+        entry.last_used = (time_t)last_used;
+
+        if (cache->buckets) {
+            slot = ftn_crc_cache_slot(cache, entry.dev, entry.ino);
+            if (cache->buckets[slot] != 0) {
+                continue;
+            }
+        }
+
+        result = ftn_crc_cache_put(cache, &entry);
+        if (result != BINKP_OK) {
+            break;
+        }
+    }
+
+    fclose(fp);
+    return result;
+}
+
+ftn_binkp_error_t ftn_crc_cache_load(ftn_crc_cache_t* cache) {
+    ftn_binkp_error_t result;
+
+    if (!cache || !cache->path) {
+        return BINKP_ERROR_INVALID_COMMAND;
+    }
+
+    result = ftn_crc_cache_merge_file(cache);
+    cache->modified = 0;
+    return result;
+}
+
+ftn_binkp_error_t ftn_crc_cache_save(ftn_crc_cache_t* cache) {
+    FILE* fp;
+    char temp_path[1024];
+    time_t cutoff;
+    size_t i;
+    ftn_binkp_error_t result;
+
+    if (!cache || !cache->path) {
+        return BINKP_ERROR_INVALID_COMMAND;
+    }
+    if (!cache->modified) {
+        return BINKP_OK;
+    }
+
+    /* Pick up what other processes saved since we loaded */
+    result = ftn_crc_cache_merge_file(cache);
+    if (result != BINKP_OK) {
+        return result;
+    }
+
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", cache->path, (long)getpid());
+    fp = fopen(temp_path, "w");
+    if (!fp) {
+        logf_error("Failed to write CRC cache %s", temp_path);
+        return BINKP_ERROR_FILE_IO;
+    }
+
+    cutoff = time(NULL) - FTN_CRC_CACHE_MAX_AGE;
+    fprintf(fp, "%s\n", CRC_CACHE_VERSION_STRING);
+    for (i = 0; i < cache->count; i++) {
+        if (cache->entries[i].last_used < cutoff) {
+            continue;
+        }
+        fprintf(fp, "%lu|%lu|%lu|%ld|%ld|%08lx|%ld\n", cache->entries[i].dev,
+                cache->entries[i].ino, cache->entries[i].size, cache->entries[i].mtime_sec,
+                cache->entries[i].mtime_nsec, (unsigned long)cache->entries[i].crc32,
+                (long)cache->entries[i].last_used);
+    }
+
+    if (fclose(fp) != 0 || rename(temp_path, cache->path) != 0) {
+        remove(temp_path);
+        logf_error("Failed to save CRC cache %s", cache->path);
+        return BINKP_ERROR_FILE_IO;
+    }
+
+    cache->modified = 0;
+    return BINKP_OK;
+}
+
+int ftn_crc_cache_lookup(ftn_crc_cache_t* cache, const char* filename, uint32_t* crc) {
+    ftn_crc_cache_entry_t key;
+    ftn_crc_cache_entry_t* entry;
+    size_t slot;
+    time_t now;
+
+    if (!cache || !filename || !crc || !cache->buckets) {
+        if (cache) {
+            cache->misses++;
+        }
+        return 0;
+    }
+
+    if (!ftn_crc_cache_key(filename, &key)) {
+        cache->misses++;
+        return 0;
+    }
+
+    slot = ftn_crc_cache_slot(cache, key.dev, key.ino);
+    if (cache->buckets[slot] == 0) {
+        cache->misses++;
+        return 0;
+    }
+
+    entry = &cache->entries[cache->buckets[slot] - 1];
+    if (!ftn_crc_cache_same_version(entry, &key)) {
+        cache->misses++;
+        return 0;
+    }
+
+    now = time(NULL);
+    if (now - entry->last_used > CRC_CACHE_TOUCH_INTERVAL) {
+        entry->last_used = now;
+        cache->modified = 1;
+    }
+
+    *crc = entry->crc32;
+    cache->hits++;
+    return 1;
+}
+
+ftn_binkp_error_t ftn_crc_cache_store(ftn_crc_cache_t* cache, const char* filename, uint32_t crc) {
+    ftn_crc_cache_entry_t entry;
+
+    if (!cache || !filename) {
+        return BINKP_ERROR_INVALID_COMMAND;
+    }
+
+    if (!ftn_crc_cache_key(filename, &entry)) {
+        return BINKP_ERROR_FILE_IO;
+    }
+    entry.crc32 = crc;
+    entry.last_used = time(NULL);
+
+    return ftn_crc_cache_put(cache, &entry);
+}
+
+ftn_binkp_error_t ftn_crc32_file_cached(ftn_crc_cache_t* cache, const char* filename, uint32_t* crc) {
+    ftn_crc_cache_entry_t before;
+    ftn_crc_cache_entry_t after;
+    ftn_binkp_error_t result;
+
+    if (!cache) {
+        return ftn_crc32_file(filename, crc);
+    }
+    if (!filename || !crc) {
+        return BINKP_ERROR_INVALID_COMMAND;
+    }
+
+    if (ftn_crc_cache_lookup(cache, filename, crc)) {
+        return BINKP_OK;
+    }
+
+    if (!ftn_crc_cache_key(filename, &before)) {
+        return ftn_crc32_file(filename, crc);
+    }
+
+    result = ftn_crc32_file(filename, crc);
+    if (result != BINKP_OK) {
+        return result;
+    }
+
+    /* Only remember the CRC if the file did not change while it was read */
+    if (ftn_crc_cache_key(filename, &after) && after.dev == before.dev &&
+        after.ino == before.ino && ftn_crc_cache_same_version(&after, &before)) {
+        before.crc32 = *crc;
+        before.last_used = time(NULL);
+        ftn_crc_cache_put(cache, &before);
+    }
+
+    return BINKP_OK;
+}
@@ -21,9 +21,14 @@
  * SOFTWARE.
  */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <sys/time.h>
 #include "ftn/binkp/plz.h"
 #include "ftn/log.h"
 #include "ftn/config.h"
@@ -33,6 +38,78 @@
 #define PLZ_DEFAULT_BUFFER_SIZE 8192
 #define PLZ_MAX_FRAME_SIZE 32767
 
+/* Adaptive level selection */
+#define PLZ_ADAPT_HEADROOM 2.0      /* Spare deflate speed needed to step a level up */
+#define PLZ_HISTORY_VERSION_STRING "# libFTN PLZ History v1.0"
+#define PLZ_HISTORY_INITIAL_CAPACITY 16
+
+static char* plz_strdup(const char* str) {
+    char* copy;
+
+    if (!str) {
+        return NULL;
+    }
+
+    copy = malloc(strlen(str) + 1);
+    if (copy) {
+        strcpy(copy, str);
+    }
+    return copy;
+}
+
+static double plz_now_us(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec * 1000000.0 + (double)tv.tv_usec;
+}
+
+/* zlib level for the next frame */
+static int plz_zlib_level(const ftn_plz_context_t* ctx) {
+    if (ctx->adaptive) {
+        return ctx->current_level;
+    }
+
+    switch (ctx->compression_level) {
+        case PLZ_LEVEL_FAST:
+            return Z_BEST_SPEED;
+        case PLZ_LEVEL_BEST:
+            return Z_BEST_COMPRESSION;
+        case PLZ_LEVEL_NORMAL:
+        case PLZ_LEVEL_DEFAULT:
+        default:
+            return Z_DEFAULT_COMPRESSION;
+    }
+}
+
+/* Close a measurement window and move one level towards the link's balance point */
+static void plz_adapt(ftn_plz_context_t* ctx) {
+    double link_rate;
+    int level;
+
+    ctx->compress_rate = (double)ctx->window_in * 1000000.0 /
+                         (ctx->window_compress_us > 1.0 ? ctx->window_compress_us : 1.0);
+    ctx->drain_rate = (double)ctx->window_drained * 1000000.0 / ctx->window_drain_us;
+
+    /* Uncompressed bytes per second the link carries at the current ratio */
+    link_rate = ctx->drain_rate * (double)ctx->window_in /
+                (double)(ctx->window_out > 0 ? ctx->window_out : 1);
+
+    level = ftn_plz_choose_level(ctx->current_level, ctx->compress_rate, link_rate);
+    if (level != ctx->current_level) {
+        logf_debug("PLZ level %d -> %d (deflate %.0f B/s, link %.0f B/s)",
+                   ctx->current_level, level, ctx->compress_rate, link_rate);
+        ctx->current_level = level;
+        ctx->level_changes++;
+    }
+
+    ctx->window_in = 0;
+    ctx->window_out = 0;
+    ctx->window_compress_us = 0.0;
+    ctx->window_drained = 0;
+    ctx->window_drain_us = 0.0;
+}
+
 ftn_binkp_error_t ftn_plz_init(ftn_plz_context_t* ctx) {
     if (!ctx) {
         return BINKP_ERROR_INVALID_COMMAND;
@@ -117,11 +194,76 @@ ftn_binkp_error_t ftn_plz_set_level(ftn_plz_context_t* ctx, ftn_plz_level_t leve
         return BINKP_ERROR_INVALID_COMMAND;
     }
 
+    if (level == PLZ_LEVEL_AUTO) {
+        return ftn_plz_set_adaptive(ctx, ctx->current_level);
+    }
+
     ctx->compression_level = level;
+    ctx->adaptive = 0;
     logf_debug("Set PLZ compression level to %s", ftn_plz_level_name(level));
     return BINKP_OK;
 }
 
+ftn_binkp_error_t ftn_plz_set_adaptive(ftn_plz_context_t* ctx, int initial_level) {
+    if (!ctx) {
+        return BINKP_ERROR_INVALID_COMMAND;
+    }
+
+    if (initial_level < Z_BEST_SPEED || initial_level > Z_BEST_COMPRESSION) {
+        initial_level = PLZ_LEVEL_NORMAL;
+    }
+
+    ctx->compression_level = PLZ_LEVEL_AUTO;
+    ctx->adaptive = 1;
+    ctx->current_level = initial_level;
+    logf_debug("Set PLZ compression level to AUTO, starting at %d", initial_level);
+    return BINKP_OK;
+}
+
+void ftn_plz_record_drain(ftn_plz_context_t* ctx, size_t bytes, unsigned long elapsed_us) {
+    if (!ctx || !ctx->adaptive) {
+        return;
+    }
+
+    ctx->window_drained += (uint32_t)bytes;
+    ctx->window_drain_us += (double)elapsed_us;
+}
+
+int ftn_plz_choose_level(int level, double compress_rate, double link_rate) {
+    if (level < Z_BEST_SPEED) {
+        level = Z_BEST_SPEED;
+    } else if (level > Z_BEST_COMPRESSION) {
+        level = Z_BEST_COMPRESSION;
+    }
+
+    if (compress_rate <= 0.0 || link_rate <= 0.0) {
+        return level;
+    }
+
+    /* Deflate cannot keep the socket busy: trade ratio for speed */
+    if (compress_rate < link_rate && level > Z_BEST_SPEED) {
+        return level - 1;
+    }
+
+    /* The socket is the bottleneck and deflate has time to spare */
+    if (compress_rate > link_rate * PLZ_ADAPT_HEADROOM && level < Z_BEST_COMPRESSION) {
+        return level + 1;
+    }
+
+    return level;
+}
+
+int ftn_plz_current_level(const ftn_plz_context_t* ctx) {
+    int level;
+
+    if (!ctx) {
+        return 0;
+    }
+
+    level = plz_zlib_level(ctx);
+    return level == Z_DEFAULT_COMPRESSION ? PLZ_LEVEL_NORMAL : level;
+}
+
 ftn_binkp_error_t ftn_plz_configure_from_network(ftn_plz_context_t* ctx, const void* network_config) {
     const ftn_network_config_t* net_config;
     ftn_plz_mode_t effective_mode;
@@ -220,7 +362,8 @@ ftn_binkp_error_t ftn_plz_create_option(const ftn_plz_context_t* ctx, char** opt
 
 ftn_binkp_error_t ftn_plz_compress_data(ftn_plz_context_t* ctx, const uint8_t* input, size_t input_len,
                                         uint8_t** output, size_t* output_len) {
-    uLongf compressed_len;
+    uLong compressed_len;
+    double started_us;
     int zlib_level;
     int result;
 
@@ -239,38 +382,60 @@ ftn_binkp_error_t ftn_plz_compress_data(ftn_plz_context_t* ctx, const uint8_t* i
         return BINKP_OK;
     }
 
-    /* Map PLZ compression level to zlib level */
-    switch (ctx->compression_level) {
-        case PLZ_LEVEL_FAST:
-            zlib_level = Z_BEST_SPEED;
-            break;
-        case PLZ_LEVEL_BEST:
-            zlib_level = Z_BEST_COMPRESSION;
-            break;
-        case PLZ_LEVEL_NORMAL:
-        case PLZ_LEVEL_DEFAULT:
-        default:
-            zlib_level = Z_DEFAULT_COMPRESSION;
-            break;
+    /* Each frame is a complete zlib stream; the deflate state is reused between frames */
+    zlib_level = plz_zlib_level(ctx);
+    if (!ctx->compress_initialized) {
+        result = deflateInit(&ctx->compress_stream, zlib_level);
+        if (result != Z_OK) {
+            logf_error("PLZ compression failed: zlib error %d", result);
+            return BINKP_ERROR_BUFFER_TOO_SMALL;
+        }
+        ctx->compress_initialized = 1;
+        ctx->stream_level = zlib_level;
+    } else {
+        deflateReset(&ctx->compress_stream);
+        if (zlib_level != ctx->stream_level) {
+            /* Nothing is pending after a reset, so the new level covers the whole frame */
+            deflateParams(&ctx->compress_stream, zlib_level, Z_DEFAULT_STRATEGY);
+            ctx->stream_level = zlib_level;
+        }
     }
 
-    /* Calculate maximum compressed size (worst case) */
-    compressed_len = compressBound(input_len);
+    compressed_len = deflateBound(&ctx->compress_stream, input_len);
     *output = malloc(compressed_len);
     if (!*output) {
         return BINKP_ERROR_BUFFER_TOO_SMALL;
     }
 
-    /* Compress using zlib */
-    result = compress2(*output, &compressed_len, input, input_len, zlib_level);
-    if (result != Z_OK) {
+    ctx->compress_stream.next_in = (Bytef*)input;
+    ctx->compress_stream.avail_in = (uInt)input_len;
+    ctx->compress_stream.next_out = *output;
+    ctx->compress_stream.avail_out = (uInt)compressed_len;
+
+    started_us = ctx->adaptive ? plz_now_us() : 0.0;
+    result = deflate(&ctx->compress_stream, Z_FINISH);
+    if (result != Z_STREAM_END) {
         free(*output);
         *output = NULL;
         logf_error("PLZ compression failed: zlib error %d", result);
         return BINKP_ERROR_BUFFER_TOO_SMALL;
     }
 
-    *output_len = compressed_len;
+    *output_len = compressed_len - ctx->compress_stream.avail_out;
+
+    if (ctx->adaptive) {
+        ctx->window_compress_us += plz_now_us() - started_us;
+        ctx->window_in += (uint32_t)input_len;
+        ctx->window_out += (uint32_t)*output_len;
+        if (ctx->window_in >= FTN_PLZ_ADAPT_WINDOW && ctx->window_drain_us > 0.0 && ctx->window_drained > 0) {
+            plz_adapt(ctx);
+        } else if (ctx->window_in >= FTN_PLZ_ADAPT_WINDOW * 4) {
+            /* Nobody reports socket timing; keep the level and start over */
+            ctx->window_in = 0;
+            ctx->window_out = 0;
+            ctx->window_compress_us = 0.0;
+        }
+    }
 
     /* Update statistics */
     ctx->bytes_sent_uncompressed += input_len;
@@ -506,6 +671,8 @@ ftn_plz_mode_t ftn_plz_mode_from_name(const char* name) {
 
 const char* ftn_plz_level_name(ftn_plz_level_t level) {
     switch (level) {
+        case PLZ_LEVEL_AUTO:
+            return "AUTO";
         case PLZ_LEVEL_DEFAULT:
             return "DEFAULT";
         case PLZ_LEVEL_FAST:
@@ -530,6 +697,8 @@ ftn_plz_level_t ftn_plz_level_from_name(const char* name) {
         return PLZ_LEVEL_NORMAL;
     } else if (strcasecmp(name, "BEST") == 0) {
         return PLZ_LEVEL_BEST;
+    } else if (strcasecmp(name, "AUTO") == 0) {
+        return PLZ_LEVEL_AUTO;
     } else if (strcasecmp(name, "DEFAULT") == 0) {
         return PLZ_LEVEL_DEFAULT;
     }
@@ -563,4 +732,208 @@ double ftn_plz_get_compression_ratio(const ftn_plz_context_t* ctx) {
     }
 
     return (double)ctx->bytes_sent_compressed / (double)ctx->bytes_sent_uncompressed;
-}
\ No newline at end of file
+}
+
+ftn_plz_history_t* ftn_plz_history_new(const char* path) {
+    ftn_plz_history_t* history;
+
+    history = malloc(sizeof(ftn_plz_history_t));
+    if (!history) {
+        return NULL;
+    }
+
+    memset(history, 0, sizeof(ftn_plz_history_t));
+    if (path) {
+        history->path = plz_strdup(path);
+        if (!history->path) {
+            free(history);
+            return NULL;
+        }
+    }
+    return history;
+}
+
+void ftn_plz_history_free(ftn_plz_history_t* history) {
+    size_t i;
+
+    if (!history) {
+        return;
+    }
+
+    for (i = 0; i < history->count; i++) {
+        free(history->links[i].address);
+    }
+    free(history->links);
+    free(history->path);
+    free(history);
+}
+
+static ftn_plz_link_t* plz_history_find(const ftn_plz_history_t* history, const char* address) {
+    size_t i;
+
+    for (i = 0; i < history->count; i++) {
+        if (strcasecmp(history->links[i].address, address) == 0) {
+            return &history->links[i];
+        }
+    }
+    return NULL;
+}
+
+static ftn_plz_link_t* plz_history_add(ftn_plz_history_t* history, const char* address) {
+    ftn_plz_link_t* grown;
+    ftn_plz_link_t* link;
+    size_t new_capacity;
+
+    if (history->count >= history->capacity) {
+        new_capacity = history->capacity ? history->capacity * 2 : PLZ_HISTORY_INITIAL_CAPACITY;
+        grown = realloc(history->links, new_capacity * sizeof(ftn_plz_link_t));
+        if (!grown) {
+            return NULL;
+        }
+        history->links = grown;
+        history->capacity = new_capacity;
+    }
+
+    link = &history->links[history->count];
+    memset(link, 0, sizeof(ftn_plz_link_t));
+    link->address = plz_strdup(address);
+    if (!link->address) {
+        return NULL;
+    }
+    history->count++;
+    return link;
+}
+
+ftn_binkp_error_t ftn_plz_history_load(ftn_plz_history_t* history) {
+    FILE* fp;
+    char line[256];
+    char* separator;
+    ftn_plz_link_t* link;
+    int level;
+    double compress_rate;
+    double drain_rate;
+    long updated;
+
+    if (!history || !history->path) {
+        return BINKP_ERROR_INVALID_COMMAND;
+    }
+
+    fp = fopen(history->path, "r");
+    if (!fp) {
+        /* No history yet */
+        return BINKP_OK;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        /* address|level|compress_rate|drain_rate|updated */
+        separator = strchr(line, '|');
+        if (!separator) {
+            continue;
+        }
+        *separator = '\0';
+        if (sscanf(separator + 1, "%d|%lf|%lf|%ld", &level, &compress_rate, &drain_rate, &updated) != 4 ||
+            level < Z_BEST_SPEED || level > Z_BEST_COMPRESSION) {
+            continue;
+        }
+
+        link = plz_history_find(history, line);
+        if (!link) {
+            link = plz_history_add(history, line);
+            if (!link) {
+                fclose(fp);
+                return BINKP_ERROR_BUFFER_TOO_SMALL;
+            }
+        }
+        link->level = level;
+        link->compress_rate = compress_rate;
+        link->drain_rate = drain_rate;
+        link->updated = (time_t)updated;
+    }
+
+    fclose(fp);
+    history->modified = 0;
+    return BINKP_OK;
+}
+
+ftn_binkp_error_t ftn_plz_history_save(ftn_plz_history_t* history) {
+    FILE* fp;
+    char temp_path[1024];
+    size_t i;
+
+    if (!history || !history->path) {
+        return BINKP_ERROR_INVALID_COMMAND;
+    }
+    if (!history->modified) {
+        return BINKP_OK;
+    }
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", history->path);
+    fp = fopen(temp_path, "w");
+    if (!fp) {
+        logf_error("Failed to write PLZ history %s", temp_path);
+        return BINKP_ERROR_PROTOCOL_ERROR;
+    }
+
+    fprintf(fp, "%s\n", PLZ_HISTORY_VERSION_STRING);
+    for (i = 0; i < history->count; i++) {
+        fprintf(fp, "%s|%d|%.0f|%.0f|%ld\n", history->links[i].address, history->links[i].level,
+                history->links[i].compress_rate, history->links[i].drain_rate,
+                (long)history->links[i].updated);
+    }
+
+    if (fclose(fp) != 0 || rename(temp_path, history->path) != 0) {
+        remove(temp_path);
+        logf_error("Failed to save PLZ history %s", history->path);
+        return BINKP_ERROR_PROTOCOL_ERROR;
+    }
+
+    history->modified = 0;
+    return BINKP_OK;
+}
+
+int ftn_plz_history_level(const ftn_plz_history_t* history, const char* address) {
+    const ftn_plz_link_t* link;
+
+    if (!history || !address) {
+        return 0;
+    }
+
+    link = plz_history_find(history, address);
+    return link ? link->level : 0;
+}
+
+ftn_binkp_error_t ftn_plz_history_update(ftn_plz_history_t* history, const char* address, const ftn_plz_context_t* ctx) {
+    ftn_plz_link_t* link;
+
+    if (!history || !address || !ctx || strchr(address, '|')) {
+        return BINKP_ERROR_INVALID_COMMAND;
+    }
+
+    /* Only adaptive sessions learn anything about the link */
+    if (!ctx->adaptive) {
+        return BINKP_OK;
+    }
+
+    link = plz_history_find(history, address);
+    if (!link) {
+        link = plz_history_add(history, address);
+        if (!link) {
+            return BINKP_ERROR_BUFFER_TOO_SMALL;
+        }
+    }
+
+    link->level = ctx->current_level;
+    if (ctx->compress_rate > 0.0) {
+        link->compress_rate = ctx->compress_rate;
+    }
+    if (ctx->drain_rate > 0.0) {
+        link->drain_rate = ctx->drain_rate;
+    }
+    link->updated = time(NULL);
+    history->modified = 1;
+    return BINKP_OK;
+}
@@ -21,18 +21,18 @@
  * SOFTWARE.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <sys/time.h>
+#include <unistd.h>
 #include "ftn/binkp/session.h"
 #include "ftn/log.h"
 
-ftn_binkp_error_t ftn_binkp_session_init(ftn_binkp_session_t* session, ftn_net_connection_t* conn, ftn_config_t* config, int is_originator) {
-    if (!session || !conn || !config) {
-        return BINKP_ERROR_INVALID_FRAME;
-    }
-
+static ftn_binkp_error_t session_setup(ftn_binkp_session_t* session, ftn_net_connection_t* conn, ftn_config_t* config, int is_originator) {
     memset(session, 0, sizeof(ftn_binkp_session_t));
 
     session->connection = conn;
@@ -63,6 +63,106 @@ ftn_binkp_error_t ftn_binkp_session_init(ftn_binkp_session_t* session, ftn_net_c
     return BINKP_OK;
 }
 
+ftn_binkp_error_t ftn_binkp_session_init(ftn_binkp_session_t* session, ftn_net_connection_t* conn, ftn_config_t* config, int is_originator) {
+    if (!session || !conn || !config) {
+        return BINKP_ERROR_INVALID_FRAME;
+    }
+
+    return session_setup(session, conn, config, is_originator);
+}
+
+ftn_binkp_error_t ftn_binkp_session_init_replay(ftn_binkp_session_t* session, ftn_binkp_replay_t* replay, ftn_config_t* config) {
+    ftn_binkp_error_t result;
+
+    if (!session || !replay || !config) {
+        return BINKP_ERROR_INVALID_FRAME;
+    }
+
+    /* The engine takes the captured side's role; the capture plays the peer */
+    result = session_setup(session, NULL, config, replay->is_originator);
+    if (result == BINKP_OK) {
+        session->replay = replay;
+    }
+
+    return result;
+}
+
+void ftn_binkp_session_set_capture(ftn_binkp_session_t* session, ftn_binkp_capture_t* capture) {
+    if (session) {
+        session->capture = capture;
+    }
+}
+
+void ftn_binkp_session_set_plz(ftn_binkp_session_t* session, ftn_plz_context_t* plz, ftn_plz_history_t* history) {
+    if (session) {
+        session->plz = plz;
+        session->plz_history = history;
+    }
+}
+
+/* First address of the remote M_ADR list, which keys the PLZ history */
+static const char* session_remote_address(const ftn_binkp_session_t* session, char* buffer, size_t size) {
+    size_t len;
+
+    if (!session->remote_addresses) {
+        return NULL;
+    }
+
+    len = strcspn(session->remote_addresses, " ");
+    if (len == 0 || len >= size) {
+        return NULL;
+    }
+    memcpy(buffer, session->remote_addresses, len);
+    buffer[len] = '\0';
+    return buffer;
+}
+
+/* Advertise PLZ in an M_NUL OPT when it is enabled */
+static ftn_binkp_error_t session_send_options(ftn_binkp_session_t* session) {
+    char* option = NULL;
+    char opt[64];
+    ftn_binkp_error_t result;
+
+    if (!session->plz) {
+        return BINKP_OK;
+    }
+
+    result = ftn_plz_create_option(session->plz, &option);
+    if (result != BINKP_OK || !option) {
+        return result;
+    }
+
+    snprintf(opt, sizeof(opt), "OPT %s", option);
+    free(option);
+    return ftn_binkp_send_command(session, BINKP_M_NUL, opt);
+}
+
+/* Negotiate PLZ from the remote M_NUL OPT list */
+static ftn_binkp_error_t session_receive_options(ftn_binkp_session_t* session, const char* args) {
+    char option[64];
+    size_t len;
+    ftn_binkp_error_t result;
+
+    if (!session->plz || strncmp(args, "OPT ", 4) != 0) {
+        return BINKP_OK;
+    }
+
+    for (args += 4; *args; args += len) {
+        args += strspn(args, " ");
+        len = strcspn(args, " ");
+        if (len == 0 || len >= sizeof(option) || strncmp(args, "PLZ", 3) != 0) {
+            continue;
+        }
+        memcpy(option, args, len);
+        option[len] = '\0';
+        result = ftn_plz_negotiate(session->plz, option);
+        if (result != BINKP_OK) {
+            return result;
+        }
+    }
+    return BINKP_OK;
+}
+
 void ftn_binkp_session_free(ftn_binkp_session_t* session) {
     if (!session) {
         return;
@@ -94,6 +194,7 @@ void ftn_binkp_session_free(ftn_binkp_session_t* session) {
 
 ftn_binkp_error_t ftn_binkp_session_run(ftn_binkp_session_t* session) {
     ftn_binkp_error_t result;
+    char address[128];
     time_t start_time;
     time_t current_time;
 
@@ -125,6 +226,12 @@ ftn_binkp_error_t ftn_binkp_session_run(ftn_binkp_session_t* session) {
         return BINKP_ERROR_PROTOCOL_ERROR;
     }
 
+    /* Remember the level an adaptive session settled on for this link */
+    if (session->plz && session->plz_history &&
+        session_remote_address(session, address, sizeof(address))) {
+        ftn_plz_history_update(session->plz_history, address, session->plz);
+    }
+
     logf_info("Binkp session completed successfully");
     return BINKP_OK;
 }
@@ -165,6 +272,9 @@ ftn_binkp_error_t ftn_binkp_handle_originator_state(ftn_binkp_session_t* session
             result = ftn_binkp_send_command(session, BINKP_M_NUL, "libftn binkp/1.0");
             if (result != BINKP_OK) return result;
 
+            result = session_send_options(session);
+            if (result != BINKP_OK) return result;
+
             /* Send M_ADR with our addresses */
             result = ftn_binkp_send_command(session, BINKP_M_ADR, session->local_addresses);
             if (result != BINKP_OK) return result;
@@ -231,6 +341,9 @@ ftn_binkp_error_t ftn_binkp_handle_answerer_state(ftn_binkp_session_t* session)
 
     switch (session->state) {
         case BINKP_STATE_R0_WAIT_CONN:
+            result = session_send_options(session);
+            if (result != BINKP_OK) return result;
+
             /* Send our address immediately */
             result = ftn_binkp_send_command(session, BINKP_M_ADR, session->local_addresses);
             if (result != BINKP_OK) return result;
@@ -320,6 +433,7 @@ ftn_binkp_error_t ftn_binkp_process_frame(ftn_binkp_session_t* session, const ft
     }
 
     if (frame->is_command) {
+        ftn_binkp_command_init(&cmd_frame);
         result = ftn_binkp_command_parse(frame, &cmd_frame);
         if (result != BINKP_OK) {
             return result;
@@ -334,6 +448,9 @@ ftn_binkp_error_t ftn_binkp_process_frame(ftn_binkp_session_t* session, const ft
 }
 
 ftn_binkp_error_t ftn_binkp_process_command(ftn_binkp_session_t* session, const ftn_binkp_command_frame_t* cmd) {
+    char address[128];
+    int level;
+
     if (!session || !cmd) {
         return BINKP_ERROR_INVALID_COMMAND;
     }
@@ -344,7 +461,7 @@ ftn_binkp_error_t ftn_binkp_process_command(ftn_binkp_session_t* session, const
         case BINKP_M_NUL:
             /* Information message, just log it */
             logf_info("Remote info: %s", cmd->args ? cmd->args : "");
-            return BINKP_OK;
+            return cmd->args ? session_receive_options(session, cmd->args) : BINKP_OK;
 
         case BINKP_M_ADR:
             /* Address information */
@@ -358,6 +475,13 @@ ftn_binkp_error_t ftn_binkp_process_command(ftn_binkp_session_t* session, const
                 }
                 logf_info("Remote addresses: %s", cmd->args);
 
+                /* An adaptive link starts from the level it settled on last time */
+                if (session->plz && session->plz->adaptive && session->plz_history &&
+                    session_remote_address(session, address, sizeof(address)) &&
+                    (level = ftn_plz_history_level(session->plz_history, address)) > 0) {
+                    ftn_plz_set_adaptive(session->plz, level);
+                }
+
                 /* Transition states based on current state */
                 if (session->state == BINKP_STATE_S3_WAIT_ADDR) {
                     session->state = BINKP_STATE_S4_AUTH_REMOTE;
@@ -466,12 +590,86 @@ ftn_binkp_error_t ftn_binkp_send_command(ftn_binkp_session_t* session, ftn_binkp
 }
 
 ftn_binkp_error_t ftn_binkp_send_frame(ftn_binkp_session_t* session, const ftn_binkp_frame_t* frame) {
+    ftn_binkp_frame_t compressed;
+    const ftn_binkp_frame_t* wire = frame;
+    struct timeval before;
+    struct timeval after;
+    ftn_binkp_error_t result;
+
     if (!session || !frame) {
         return BINKP_ERROR_INVALID_FRAME;
     }
 
-    session->bytes_sent += ftn_binkp_frame_total_size(frame);
-    return ftn_binkp_frame_send(session->connection, frame);
+    /* Data frames go through PLZ once it has been negotiated */
+    if (session->plz && ftn_plz_is_negotiated(session->plz) && !frame->is_command) {
+        result = ftn_plz_compress_frame(session->plz, frame, &compressed);
+        if (result != BINKP_OK) {
+            return result;
+        }
+        wire = &compressed;
+    }
+
+    session->bytes_sent += ftn_binkp_frame_total_size(wire);
+
+    if (session->replay) {
+        result = ftn_binkp_replay_send(session->replay, wire);
+    } else {
+        gettimeofday(&before, NULL);
+        result = ftn_binkp_frame_send(session->connection, wire);
+        gettimeofday(&after, NULL);
+
+        /* Socket write times let an adaptive PLZ level track the link */
+        if (result == BINKP_OK && wire != frame && after.tv_sec >= before.tv_sec) {
+            ftn_plz_record_drain(session->plz, ftn_binkp_frame_total_size(wire),
+                                 (unsigned long)((after.tv_sec - before.tv_sec) * 1000000L +
+                                                 (after.tv_usec - before.tv_usec)));
+        }
+        if (result == BINKP_OK && session->capture) {
+            ftn_binkp_capture_record(session->capture, BINKP_CAPTURE_SENT, wire);
+        }
+    }
+
+    if (wire != frame && compressed.data != frame->data) {
+        free(compressed.data);
+    }
+    return result;
+}
+
+ftn_binkp_error_t ftn_binkp_send_file_data(ftn_binkp_session_t* session, int fd, long offset, size_t len) {
+    uint8_t buffer[BINKP_MAX_FRAME_SIZE];
+    ftn_binkp_frame_t frame;
+    ftn_binkp_error_t result;
+    ssize_t got;
+
+    if (!session || fd < 0 || offset < 0) {
+        return BINKP_ERROR_INVALID_FRAME;
+    }
+
+    if (len > BINKP_MAX_FRAME_SIZE) {
+        return BINKP_ERROR_FRAME_TOO_LARGE;
+    }
+
+    /* Zero copy when the frame goes to the socket exactly as it is on disk */
+    if (!session->replay && !session->capture && session->connection &&
+        !(session->plz && ftn_plz_is_negotiated(session->plz))) {
+        result = ftn_binkp_frame_sendfile(session->connection, fd, offset, len);
+        if (result == BINKP_OK) {
+            session->bytes_sent += BINKP_HEADER_SIZE + len;
+        }
+        return result;
+    }
+
+    got = pread(fd, buffer, len, (off_t)offset);
+    if (got < 0 || (size_t)got != len) {
+        return BINKP_ERROR_FILE_IO;
+    }
+
+    frame.header[0] = (uint8_t)((len >> 8) & 0x7F);
+    frame.header[1] = (uint8_t)(len & 0xFF);
+    frame.data = buffer;
+    frame.size = len;
+    frame.is_command = 0;
+    return ftn_binkp_send_frame(session, &frame);
 }
 
 ftn_binkp_error_t ftn_binkp_receive_frame(ftn_binkp_session_t* session, ftn_binkp_frame_t* frame) {
@@ -481,7 +679,15 @@ ftn_binkp_error_t ftn_binkp_receive_frame(ftn_binkp_session_t* session, ftn_bink
         return BINKP_ERROR_INVALID_FRAME;
     }
 
-    result = ftn_binkp_frame_receive(session->connection, frame, session->frame_timeout_ms);
+    if (session->replay) {
+        result = ftn_binkp_replay_receive(session->replay, frame);
+    } else {
+        result = ftn_binkp_frame_receive(session->connection, frame, session->frame_timeout_ms);
+        if (result == BINKP_OK && session->capture) {
+            ftn_binkp_capture_record(session->capture, BINKP_CAPTURE_RECEIVED, frame);
+        }
+    }
+
     if (result == BINKP_OK) {
         session->bytes_received += ftn_binkp_frame_total_size(frame);
     }
@@ -0,0 +1,146 @@
+/*
+ * binkplay - Replay a captured binkp session against the session engine
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#include <ftn.h>
+#include <ftn/log.h>
+#include <ftn/binkp/capture.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void print_version(void) {
+    printf("binkplay (libFTN) %s\n", ftn_get_version());
+    printf("%s\n", ftn_get_copyright());
+    printf("License: %s\n", ftn_get_license());
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [options] <capture_file>\n", program_name);
+    printf("Replay a captured binkp session, with the capture acting as the remote side\n");
+    printf("\nOptions:\n");
+    printf("  -c, --config FILE       Take the local address and password from FILE\n");
+    printf("  -a, --address ADDR      Local address list sent in M_ADR\n");
+    printf("  -p, --password PWD      Session password\n");
+    printf("  -r, --repeat N          Replay N times and report the average (default: 1)\n");
+    printf("      --realtime          Reproduce the captured frame timing\n");
+    printf("  -v, --verbose           Enable verbose logging\n");
+    printf("  -h, --help              Show this help message\n");
+    printf("      --version           Show version information\n");
+    printf("\nExample:\n");
+    printf("  %s -a 1:2/3 -r 1000 session.bkc\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    const char* capture_file = NULL;
+    const char* config_file = NULL;
+    const char* address = NULL;
+    const char* password = NULL;
+    int repeat = 1;
+    int realtime = 0;
+    int verbose = 0;
+    ftn_config_t* loaded = NULL;
+    ftn_config_t local_config;
+    ftn_network_config_t local_network;
+    ftn_config_t* config;
+    ftn_binkp_replay_t* replay;
+    ftn_binkp_replay_stats_t stats;
+    double wall_total = 0.0;
+    double cpu_total = 0.0;
+    int exit_code = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "--version") == 0) {
+            print_version();
+            return 0;
+        } else if ((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--config") == 0) && i + 1 < argc) {
+            config_file = argv[++i];
+        } else if ((strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--address") == 0) && i + 1 < argc) {
+            address = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--password") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--repeat") == 0) && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+            if (repeat < 1) {
+                printf("Error: Invalid repeat count: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--realtime") == 0) {
+            realtime = 1;
+        } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+            verbose = 1;
+        } else if (argv[i][0] != '-' && !capture_file) {
+            capture_file = argv[i];
+        } else {
+            printf("Error: Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!capture_file) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    /* The session outcome is part of the summary, so keep the log quiet */
+    ftn_log_set_level(verbose ? FTN_LOG_DEBUG : FTN_LOG_CRITICAL);
+
+    /* The engine reads its identity from the first configured network */
+    memset(&local_config, 0, sizeof(local_config));
+    memset(&local_network, 0, sizeof(local_network));
+    config = &local_config;
+    if (config_file) {
+        loaded = ftn_config_new();
+        if (!loaded || ftn_config_load(loaded, config_file) != FTN_OK || loaded->network_count == 0) {
+            printf("Error: Cannot load networks from %s\n", config_file);
+            ftn_config_free(loaded);
+            return 1;
+        }
+        local_network = loaded->networks[0];
+    }
+    if (address) {
+        local_network.address_str = (char*)address;
+    }
+    if (password) {
+        local_network.password = (char*)password;
+    }
+    local_config.networks = &local_network;
+    local_config.network_count = 1;
+
+    replay = ftn_binkp_replay_load(capture_file);
+    if (!replay) {
+        printf("Error: Cannot load capture %s\n", capture_file);
+        ftn_config_free(loaded);
+        return 1;
+    }
+    replay->honor_timing = realtime;
+
+    printf("Capture: %s (%s, %lu frames)\n", capture_file,
+           replay->is_originator ? "originator" : "answerer", (unsigned long)replay->count);
+
+    for (i = 0; i < repeat; i++) {
+        ftn_binkp_replay_run(replay, config, &stats);
+        wall_total += (double)stats.wall_us;
+        cpu_total += (double)stats.cpu_us;
+    }
+
+    printf("Result: %s\n", stats.result == BINKP_OK ? "completed" : ftn_binkp_error_string(stats.result));
+    printf("Frames fed: %lu, sent: %lu, divergent: %lu, unread: %lu\n",
+           stats.frames_fed, stats.frames_sent, stats.divergences, stats.frames_unused);
+    printf("Time per run: %.1f us wall, %.1f us cpu (%d run%s)\n",
+           wall_total / repeat, cpu_total / repeat, repeat, repeat == 1 ? "" : "s");
+
+    if (stats.divergences > 0) {
+        exit_code = 2;
+    }
+
+    ftn_binkp_replay_free(replay);
+    ftn_config_free(loaded);
+    return exit_code;
+}
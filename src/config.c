@@ -364,42 +364,120 @@ int ftn_config_ini_has_section(const ftn_config_ini_t* ini, const char* section_
 }
 
 /* Path templating functions */
-char* ftn_config_expand_path(const char* template, const char* user, const char* network) {
-    char* result;
+static void path_template_add(ftn_path_template_t* tpl, ftn_path_segment_type_t type,
+                              const char* text, size_t length) {
+    ftn_path_segment_t* segment;
+
+    /* Adjacent literal text is kept in one segment */
+    if (type == FTN_PATH_SEGMENT_LITERAL && tpl->segment_count > 0 &&
+        tpl->segments[tpl->segment_count - 1].type == FTN_PATH_SEGMENT_LITERAL) {
+        tpl->segments[tpl->segment_count - 1].length += length;
+        tpl->literal_length += length;
+        return;
+    }
+
+    segment = &tpl->segments[tpl->segment_count++];
+    segment->type = type;
+    segment->text = text;
+    segment->length = length;
+    if (type == FTN_PATH_SEGMENT_LITERAL) {
+        tpl->literal_length += length;
+    } else if (type == FTN_PATH_SEGMENT_USER) {
+        tpl->uses_user = 1;
+    } else {
+        tpl->uses_network = 1;
+    }
+}
+
+ftn_path_template_t* ftn_path_template_compile(const char* template) {
+    ftn_path_template_t* tpl;
     const char* src;
+    size_t max_segments;
+
+    if (!template) return NULL;
+
+    tpl = malloc(sizeof(ftn_path_template_t));
+    if (!tpl) return NULL;
+    memset(tpl, 0, sizeof(ftn_path_template_t));
+
+    tpl->source = ftn_config_strdup(template);
+    /* Each variable can add itself and one literal segment */
+    max_segments = 1;
+    for (src = template; *src; src++) {
+        if (*src == '%') max_segments += 2;
+    }
+    tpl->segments = malloc(sizeof(ftn_path_segment_t) * max_segments);
+    if (!tpl->source || !tpl->segments) {
+        ftn_path_template_free(tpl);
+        return NULL;
+    }
+
+    src = tpl->source;
+    while (*src) {
+        if (strncmp(src, "%USER%", 6) == 0) {
+            path_template_add(tpl, FTN_PATH_SEGMENT_USER, src, 6);
+            src += 6;
+        } else if (strncmp(src, "%NETWORK%", 9) == 0) {
+            path_template_add(tpl, FTN_PATH_SEGMENT_NETWORK, src, 9);
+            src += 9;
+        } else {
+            path_template_add(tpl, FTN_PATH_SEGMENT_LITERAL, src, 1);
+            src++;
+        }
+    }
+
+    return tpl;
+}
+
+void ftn_path_template_free(ftn_path_template_t* tpl) {
+    if (!tpl) return;
+
+    free(tpl->source);
+    free(tpl->segments);
+    free(tpl);
+}
+
+/* A variable without a value is left in the path as it was written */
+char* ftn_path_template_expand(const ftn_path_template_t* tpl, const char* user, const char* network) {
+    char* result;
     char* dst;
     size_t result_len;
     size_t user_len = 0;
     size_t network_len = 0;
+    size_t i;
 
-    if (!template) return NULL;
+    if (!tpl) return NULL;
 
     if (user) user_len = strlen(user);
     if (network) network_len = strlen(network);
 
-    /* Calculate maximum possible result length */
-    result_len = strlen(template) + user_len + network_len + 1;
+    result_len = tpl->literal_length + 1;
+    for (i = 0; i < tpl->segment_count; i++) {
+        const ftn_path_segment_t* segment = &tpl->segments[i];
+        if (segment->type == FTN_PATH_SEGMENT_USER && user) {
+            result_len += user_len;
+        } else if (segment->type == FTN_PATH_SEGMENT_NETWORK && network) {
+            result_len += network_len;
+        } else if (segment->type != FTN_PATH_SEGMENT_LITERAL) {
+            result_len += segment->length;
+        }
+    }
+
     result = malloc(result_len);
     if (!result) return NULL;
 
-    src = template;
     dst = result;
-
-    while (*src) {
-        if (*src == '%') {
-            if (strncmp(src, "%USER%", 6) == 0 && user) {
-                strcpy(dst, user);
-                dst += user_len;
-                src += 6;
-            } else if (strncmp(src, "%NETWORK%", 9) == 0 && network) {
-                strcpy(dst, network);
-                dst += network_len;
-                src += 9;
-            } else {
-                *dst++ = *src++;
-            }
+    for (i = 0; i < tpl->segment_count; i++) {
+        const ftn_path_segment_t* segment = &tpl->segments[i];
+        if (segment->type == FTN_PATH_SEGMENT_USER && user) {
+            memcpy(dst, user, user_len);
+            dst += user_len;
+        } else if (segment->type == FTN_PATH_SEGMENT_NETWORK && network) {
+            memcpy(dst, network, network_len);
+            dst += network_len;
         } else {
-            *dst++ = *src++;
+            memcpy(dst, segment->text, segment->length);
+            dst += segment->length;
         }
     }
 
@@ -407,6 +485,18 @@ char* ftn_config_expand_path(const char* template, const char* user, const char*
     return result;
 }
 
+char* ftn_config_expand_path(const char* template, const char* user, const char* network) {
+    ftn_path_template_t* tpl;
+    char* result;
+
+    tpl = ftn_path_template_compile(template);
+    if (!tpl) return NULL;
+
+    result = ftn_path_template_expand(tpl, user, network);
+    ftn_path_template_free(tpl);
+    return result;
+}
+
 /* Main configuration functions */
 ftn_config_t* ftn_config_new(void) {
     ftn_config_t* config = malloc(sizeof(ftn_config_t));
@@ -443,14 +533,19 @@ void ftn_config_free(ftn_config_t* config) {
     /* Free news config */
     if (config->news) {
         if (config->news->path) free(config->news->path);
+        if (config->news->nntp) free(config->news->nntp);
+        if (config->news->jam) free(config->news->jam);
         free(config->news);
     }
 
     /* Free mail config */
     if (config->mail) {
         if (config->mail->inbox) free(config->mail->inbox);
+        ftn_path_template_free(config->mail->inbox_template);
         if (config->mail->outbox) free(config->mail->outbox);
         if (config->mail->sent) free(config->mail->sent);
+        if (config->mail->lmtp) free(config->mail->lmtp);
+        if (config->mail->lmtp_domain) free(config->mail->lmtp_domain);
         free(config->mail);
     }
 
@@ -465,6 +560,7 @@ void ftn_config_free(ftn_config_t* config) {
     /* Free daemon config */
     if (config->daemon) {
         if (config->daemon->pid_file) free(config->daemon->pid_file);
+        if (config->daemon->nodelist) free(config->daemon->nodelist);
         free(config->daemon);
     }
 
@@ -481,13 +577,28 @@ void ftn_config_free(ftn_config_t* config) {
             if (config->networks[i].processed) free(config->networks[i].processed);
             if (config->networks[i].bad) free(config->networks[i].bad);
             if (config->networks[i].duplicate_db) free(config->networks[i].duplicate_db);
+            if (config->networks[i].areafix_db) free(config->networks[i].areafix_db);
+            if (config->networks[i].fileecho_path) free(config->networks[i].fileecho_path);
+            if (config->networks[i].filebox_path) free(config->networks[i].filebox_path);
+            if (config->networks[i].filefix_db) free(config->networks[i].filefix_db);
+            if (config->networks[i].freq_dirs) free(config->networks[i].freq_dirs);
+            if (config->networks[i].freq_magic) free(config->networks[i].freq_magic);
+            if (config->networks[i].freq_index) free(config->networks[i].freq_index);
             /* Free mailer-specific fields */
             if (config->networks[i].hub_hostname) free(config->networks[i].hub_hostname);
             if (config->networks[i].password) free(config->networks[i].password);
             if (config->networks[i].outbound_path) free(config->networks[i].outbound_path);
+            if (config->networks[i].crc_cache) free(config->networks[i].crc_cache);
+            if (config->networks[i].capture_dir) free(config->networks[i].capture_dir);
             /* Free PLZ fields */
             if (config->networks[i].plz_mode_str) free(config->networks[i].plz_mode_str);
             if (config->networks[i].plz_level_str) free(config->networks[i].plz_level_str);
+            if (config->networks[i].plz_history) free(config->networks[i].plz_history);
+            if (config->networks[i].tcp_congestion) free(config->networks[i].tcp_congestion);
+            if (config->networks[i].tls_ca_file) free(config->networks[i].tls_ca_file);
+            if (config->networks[i].tls_cert_file) free(config->networks[i].tls_cert_file);
+            if (config->networks[i].tls_key_file) free(config->networks[i].tls_key_file);
+            if (config->networks[i].tls_fingerprint) free(config->networks[i].tls_fingerprint);
         }
         free(config->networks);
     }
@@ -568,6 +679,41 @@ static ftn_error_t ftn_config_load_news_section(ftn_config_t* config, const ftn_
         if (!config->news->path) return FTN_ERROR_NOMEM;
     }
 
+    value = ftn_config_ini_get_value(ini, "news", "pack");
+    config->news->pack = (value && (ftn_config_strcasecmp(value, "yes") == 0 ||
+                          ftn_config_strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0)) ? 1 : 0;
+
+    value = ftn_config_ini_get_value(ini, "news", "compress");
+    config->news->compress = (value && (ftn_config_strcasecmp(value, "yes") == 0 ||
+                              ftn_config_strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0)) ? 1 : 0;
+
+    value = ftn_config_ini_get_value(ini, "news", "nntp");
+    if (value) {
+        config->news->nntp = ftn_config_strdup(value);
+        if (!config->news->nntp) return FTN_ERROR_NOMEM;
+    }
+
+    value = ftn_config_ini_get_value(ini, "news", "nntp_window");
+    if (value) {
+        config->news->nntp_window = atoi(value);
+    }
+
+    value = ftn_config_ini_get_value(ini, "news", "nntp_batch");
+    if (value) {
+        config->news->nntp_batch = atoi(value);
+    }
+
+    value = ftn_config_ini_get_value(ini, "news", "jam");
+    if (value) {
+        config->news->jam = ftn_config_strdup(value);
+        if (!config->news->jam) return FTN_ERROR_NOMEM;
+    }
+
+    value = ftn_config_ini_get_value(ini, "news", "jam_batch");
+    if (value) {
+        config->news->jam_batch = atoi(value);
+    }
+
     return FTN_OK;
 }
 
@@ -586,6 +732,8 @@ static ftn_error_t ftn_config_load_mail_section(ftn_config_t* config, const ftn_
     if (value) {
         config->mail->inbox = ftn_config_strdup(value);
         if (!config->mail->inbox) return FTN_ERROR_NOMEM;
+        config->mail->inbox_template = ftn_path_template_compile(value);
+        if (!config->mail->inbox_template) return FTN_ERROR_NOMEM;
     }
 
     value = ftn_config_ini_get_value(ini, "mail", "outbox");
@@ -600,6 +748,23 @@ static ftn_error_t ftn_config_load_mail_section(ftn_config_t* config, const ftn_
         if (!config->mail->sent) return FTN_ERROR_NOMEM;
     }
 
+    value = ftn_config_ini_get_value(ini, "mail", "lmtp");
+    if (value) {
+        config->mail->lmtp = ftn_config_strdup(value);
+        if (!config->mail->lmtp) return FTN_ERROR_NOMEM;
+    }
+
+    value = ftn_config_ini_get_value(ini, "mail", "lmtp_domain");
+    if (value) {
+        config->mail->lmtp_domain = ftn_config_strdup(value);
+        if (!config->mail->lmtp_domain) return FTN_ERROR_NOMEM;
+    }
+
+    value = ftn_config_ini_get_value(ini, "mail", "lmtp_batch");
+    if (value) {
+        config->mail->lmtp_batch = atoi(value);
+    }
+
     return FTN_OK;
 }
 
@@ -666,6 +831,7 @@ static ftn_error_t ftn_config_load_daemon_section(ftn_config_t* config, const ft
     config->daemon->sleep_interval = 60;
     config->daemon->max_connections = 10;
     config->daemon->poll_interval = 300;
+    config->daemon->prefetch_depth = 4;
 
     value = ftn_config_ini_get_value(ini, "daemon", "pid_file");
     if (value) {
@@ -697,6 +863,28 @@ static ftn_error_t ftn_config_load_daemon_section(ftn_config_t* config, const ft
         }
     }
 
+    value = ftn_config_ini_get_value(ini, "daemon", "toss_budget");
+    if (value) {
+        config->daemon->toss_budget = atoi(value);
+        if (config->daemon->toss_budget < 0) {
+            config->daemon->toss_budget = 0;
+        }
+    }
+
+    value = ftn_config_ini_get_value(ini, "daemon", "prefetch_depth");
+    if (value) {
+        config->daemon->prefetch_depth = atoi(value);
+        if (config->daemon->prefetch_depth < 0) {
+            config->daemon->prefetch_depth = 0;
+        }
+    }
+
+    value = ftn_config_ini_get_value(ini, "daemon", "nodelist");
+    if (value) {
+        config->daemon->nodelist = ftn_config_strdup(value);
+        if (!config->daemon->nodelist) return FTN_ERROR_NOMEM;
+    }
+
     return FTN_OK;
 }
 
@@ -800,6 +988,57 @@ static ftn_error_t ftn_config_load_network_sections(ftn_config_t* config, const
                 if (!net->duplicate_db) return FTN_ERROR_NOMEM;
             }
 
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "duplicate_hash");
+            net->duplicate_hash = (value && (ftn_config_strcasecmp(value, "yes") == 0 ||
+                                 ftn_config_strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0)) ? 1 : 0;
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "areafix_db");
+            if (value) {
+                net->areafix_db = ftn_config_strdup(value);
+                if (!net->areafix_db) return FTN_ERROR_NOMEM;
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "fileecho_path");
+            if (value) {
+                net->fileecho_path = ftn_config_strdup(value);
+                if (!net->fileecho_path) return FTN_ERROR_NOMEM;
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "filebox_path");
+            if (value) {
+                net->filebox_path = ftn_config_strdup(value);
+                if (!net->filebox_path) return FTN_ERROR_NOMEM;
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "filefix_db");
+            if (value) {
+                net->filefix_db = ftn_config_strdup(value);
+                if (!net->filefix_db) return FTN_ERROR_NOMEM;
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "freq_dirs");
+            if (value) {
+                net->freq_dirs = ftn_config_strdup(value);
+                if (!net->freq_dirs) return FTN_ERROR_NOMEM;
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "freq_magic");
+            if (value) {
+                net->freq_magic = ftn_config_strdup(value);
+                if (!net->freq_magic) return FTN_ERROR_NOMEM;
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "freq_index");
+            if (value) {
+                net->freq_index = ftn_config_strdup(value);
+                if (!net->freq_index) return FTN_ERROR_NOMEM;
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "freq_limit");
+            if (value) {
+                net->freq_limit = atoi(value);
+            }
+
             /* Load mailer-specific settings */
             value = ftn_config_ini_get_value(ini, ini->sections[i].name, "hub_hostname");
             if (value) {
@@ -844,6 +1083,18 @@ static ftn_error_t ftn_config_load_network_sections(ftn_config_t* config, const
             net->use_crc = (value && (ftn_config_strcasecmp(value, "yes") == 0 ||
                           ftn_config_strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0)) ? 1 : 0;
 
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "crc_cache");
+            if (value) {
+                net->crc_cache = ftn_config_strdup(value);
+                if (!net->crc_cache) return FTN_ERROR_NOMEM;
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "capture_dir");
+            if (value) {
+                net->capture_dir = ftn_config_strdup(value);
+                if (!net->capture_dir) return FTN_ERROR_NOMEM;
+            }
+
             value = ftn_config_ini_get_value(ini, ini->sections[i].name, "use_nr_mode");
             net->use_nr_mode = (value && (ftn_config_strcasecmp(value, "yes") == 0 ||
                               ftn_config_strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0)) ? 1 : 0;
@@ -854,6 +1105,78 @@ static ftn_error_t ftn_config_load_network_sections(ftn_config_t* config, const
                 if (!net->outbound_path) return FTN_ERROR_NOMEM;
             }
 
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "listen_port");
+            if (value) {
+                net->listen_port = atoi(value);
+                if (net->listen_port < 0 || net->listen_port > 65535) {
+                    net->listen_port = 0;
+                }
+            }
+
+            /* TCP tuning - zero leaves the system defaults alone */
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "tcp_bandwidth");
+            if (value) {
+                net->tcp_bandwidth = atoi(value);
+                if (net->tcp_bandwidth < 0) {
+                    net->tcp_bandwidth = 0;
+                }
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "tcp_rtt");
+            if (value) {
+                net->tcp_rtt = atoi(value);
+                if (net->tcp_rtt < 0) {
+                    net->tcp_rtt = 0;
+                }
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "tcp_notsent_lowat");
+            if (value) {
+                net->tcp_notsent_lowat = atoi(value);
+                if (net->tcp_notsent_lowat < 0) {
+                    net->tcp_notsent_lowat = 0;
+                }
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "tcp_cork");
+            net->tcp_cork = (value && (ftn_config_strcasecmp(value, "yes") == 0 ||
+                           ftn_config_strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0)) ? 1 : 0;
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "tcp_congestion");
+            if (value) {
+                net->tcp_congestion = ftn_config_strdup(value);
+                if (!net->tcp_congestion) return FTN_ERROR_NOMEM;
+            }
+
+            /* binkps (binkp over TLS) */
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "use_tls");
+            net->use_tls = (value && (ftn_config_strcasecmp(value, "yes") == 0 ||
+                          ftn_config_strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0)) ? 1 : 0;
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "tls_ca_file");
+            if (value) {
+                net->tls_ca_file = ftn_config_strdup(value);
+                if (!net->tls_ca_file) return FTN_ERROR_NOMEM;
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "tls_cert_file");
+            if (value) {
+                net->tls_cert_file = ftn_config_strdup(value);
+                if (!net->tls_cert_file) return FTN_ERROR_NOMEM;
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "tls_key_file");
+            if (value) {
+                net->tls_key_file = ftn_config_strdup(value);
+                if (!net->tls_key_file) return FTN_ERROR_NOMEM;
+            }
+
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "tls_fingerprint");
+            if (value) {
+                net->tls_fingerprint = ftn_config_strdup(value);
+                if (!net->tls_fingerprint) return FTN_ERROR_NOMEM;
+            }
+
             /* PLZ compression settings */
             value = ftn_config_ini_get_value(ini, ini->sections[i].name, "plz_mode");
             if (value) {
@@ -879,6 +1202,8 @@ static ftn_error_t ftn_config_load_network_sections(ftn_config_t* config, const
                     net->plz_level = 1; /* PLZ_LEVEL_FAST */
                 } else if (ftn_config_strcasecmp(value, "best") == 0) {
                     net->plz_level = 9; /* PLZ_LEVEL_BEST */
+                } else if (ftn_config_strcasecmp(value, "auto") == 0) {
+                    net->plz_level = -1; /* PLZ_LEVEL_AUTO */
                 } else {
                     net->plz_level = 6; /* PLZ_LEVEL_NORMAL */
                 }
@@ -887,6 +1212,12 @@ static ftn_error_t ftn_config_load_network_sections(ftn_config_t* config, const
                 net->plz_level_str = ftn_config_strdup("normal");
             }
 
+            value = ftn_config_ini_get_value(ini, ini->sections[i].name, "plz_history");
+            if (value) {
+                net->plz_history = ftn_config_strdup(value);
+                if (!net->plz_history) return FTN_ERROR_NOMEM;
+            }
+
             config->network_count++;
         }
     }
@@ -1079,13 +1410,18 @@ ftn_error_t ftn_config_reload(ftn_config_t* config, const char* filename) {
 
     if (old_news) {
         if (old_news->path) free(old_news->path);
+        if (old_news->nntp) free(old_news->nntp);
+        if (old_news->jam) free(old_news->jam);
         free(old_news);
     }
 
     if (old_mail) {
         if (old_mail->inbox) free(old_mail->inbox);
+        ftn_path_template_free(old_mail->inbox_template);
         if (old_mail->outbox) free(old_mail->outbox);
         if (old_mail->sent) free(old_mail->sent);
+        if (old_mail->lmtp) free(old_mail->lmtp);
+        if (old_mail->lmtp_domain) free(old_mail->lmtp_domain);
         free(old_mail);
     }
 
@@ -1098,6 +1434,7 @@ ftn_error_t ftn_config_reload(ftn_config_t* config, const char* filename) {
 
     if (old_daemon) {
         if (old_daemon->pid_file) free(old_daemon->pid_file);
+        if (old_daemon->nodelist) free(old_daemon->nodelist);
         free(old_daemon);
     }
 
@@ -1114,12 +1451,27 @@ ftn_error_t ftn_config_reload(ftn_config_t* config, const char* filename) {
             if (old_networks[i].processed) free(old_networks[i].processed);
             if (old_networks[i].bad) free(old_networks[i].bad);
             if (old_networks[i].duplicate_db) free(old_networks[i].duplicate_db);
+            if (old_networks[i].areafix_db) free(old_networks[i].areafix_db);
+            if (old_networks[i].fileecho_path) free(old_networks[i].fileecho_path);
+            if (old_networks[i].filebox_path) free(old_networks[i].filebox_path);
+            if (old_networks[i].filefix_db) free(old_networks[i].filefix_db);
+            if (old_networks[i].freq_dirs) free(old_networks[i].freq_dirs);
+            if (old_networks[i].freq_magic) free(old_networks[i].freq_magic);
+            if (old_networks[i].freq_index) free(old_networks[i].freq_index);
             if (old_networks[i].hub_hostname) free(old_networks[i].hub_hostname);
             if (old_networks[i].password) free(old_networks[i].password);
             if (old_networks[i].outbound_path) free(old_networks[i].outbound_path);
+            if (old_networks[i].crc_cache) free(old_networks[i].crc_cache);
+            if (old_networks[i].capture_dir) free(old_networks[i].capture_dir);
             /* Free PLZ fields */
             if (old_networks[i].plz_mode_str) free(old_networks[i].plz_mode_str);
             if (old_networks[i].plz_level_str) free(old_networks[i].plz_level_str);
+            if (old_networks[i].plz_history) free(old_networks[i].plz_history);
+            if (old_networks[i].tcp_congestion) free(old_networks[i].tcp_congestion);
+            if (old_networks[i].tls_ca_file) free(old_networks[i].tls_ca_file);
+            if (old_networks[i].tls_cert_file) free(old_networks[i].tls_cert_file);
+            if (old_networks[i].tls_key_file) free(old_networks[i].tls_key_file);
+            if (old_networks[i].tls_fingerprint) free(old_networks[i].tls_fingerprint);
         }
         free(old_networks);
     }
@@ -1144,8 +1496,9 @@ ftn_error_t ftn_config_validate_mailer(const ftn_config_t* config) {
     for (i = 0; i < config->network_count; i++) {
         const ftn_network_config_t* net = &config->networks[i];
 
-        /* Hub hostname is required for mailer operation */
-        if (!net->hub_hostname || strlen(net->hub_hostname) == 0) {
+        /* Hub hostname is required, unless it can be found in the nodelist */
+        if ((!net->hub_hostname || strlen(net->hub_hostname) == 0) &&
+            (!config->daemon->nodelist || !net->hub_str)) {
             return FTN_ERROR_INVALID;
         }
 
@@ -29,12 +29,21 @@
 
 #include "ftn.h"
 #include "ftn/dupechk.h"
+#include "ftn/intern.h"
 #include "ftn/packet.h"
+#include "ftn/binkp/cram.h"
 
 /* Default settings */
 #define DEFAULT_RETENTION_DAYS (30 * 24 * 60 * 60)  /* 30 days in seconds */
 #define DEFAULT_MAX_ENTRIES    10000
 #define DB_VERSION_STRING      "# libFTN Duplicate Database v1.0"
+#define DB_HASHED_VERSION_STRING "# libFTN Hashed Duplicate Database v1.0"
+#define KEY_TABLE_INITIAL      1024
+#define SECONDS_PER_DAY        86400L
+
+static uint32_t dupecheck_day(time_t timestamp);
+static void dupecheck_hash_msgid(const char* normalized, ftn_dupecheck_key_t* key);
+static int dupecheck_parse_key(const char* hex, ftn_dupecheck_key_t* key);
 
 /* Utility functions */
 char* ftn_dupecheck_strdup(const char* str) {
@@ -74,12 +83,12 @@ char* ftn_dupecheck_extract_msgid(const ftn_message_t* msg) {
     char* msgid_line;
     char* msgid_start;
 
-    if (!msg || !msg->control_lines) {
+    if (!msg) {
         return NULL;
     }
 
     /* Search through control lines for MSGID */
-    for (i = 0; i < msg->control_count; i++) {
+    for (i = 0; msg->control_lines && i < msg->control_count; i++) {
         line = msg->control_lines[i];
         if (!line) continue;
 
@@ -107,6 +116,15 @@ char* ftn_dupecheck_extract_msgid(const ftn_message_t* msg) {
         }
     }
 
+    /* The packet parser moves ^AMSGID out of the control lines */
+    if (msg->msgid) {
+        msgid_line = ftn_dupecheck_strdup(msg->msgid);
+        if (!msgid_line) return NULL;
+        ftn_dupecheck_trim(msgid_line);
+        if (strlen(msgid_line) > 0) return msgid_line;
+        free(msgid_line);
+    }
+
     return NULL;
 }
 
@@ -142,6 +160,128 @@ char* ftn_dupecheck_normalize_msgid(const char* msgid) {
     return normalized;
 }
 
+/* Day stamp of a time; never 0, which marks a free table slot */
+static uint32_t dupecheck_day(time_t timestamp) {
+    uint32_t day = timestamp > 0 ? (uint32_t)(timestamp / SECONDS_PER_DAY) : 0;
+    return day ? day : 1;
+}
+
+static void dupecheck_digest_key(const uint8_t digest[16], ftn_dupecheck_key_t* key) {
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        key->key[i] = (uint32_t)digest[i * 4] << 24 | (uint32_t)digest[i * 4 + 1] << 16 |
+                      (uint32_t)digest[i * 4 + 2] << 8 | (uint32_t)digest[i * 4 + 3];
+    }
+}
+
+static void dupecheck_hash_msgid(const char* normalized, ftn_dupecheck_key_t* key) {
+    ftn_md5_context_t ctx;
+    uint8_t digest[16];
+
+    /* The leading tag keeps MSGID keys apart from content keys */
+    ftn_md5_init(&ctx);
+    ftn_md5_update(&ctx, "M", 1);
+    ftn_md5_update(&ctx, normalized, strlen(normalized));
+    ftn_md5_final(&ctx, digest);
+    dupecheck_digest_key(digest, key);
+}
+
+/* Hash one field with a terminator, so neighbouring fields cannot run together */
+static void dupecheck_hash_field(ftn_md5_context_t* ctx, const char* value) {
+    if (value) {
+        ftn_md5_update(ctx, value, strlen(value));
+    }
+    ftn_md5_update(ctx, "", 1);
+}
+
+/* Area tags are case-insensitive, so the key takes the interned lower-case
+   form; past the intern table's limit the tag is folded here instead */
+static void dupecheck_hash_area(ftn_md5_context_t* ctx, const char* area) {
+    const char* lower = NULL;
+    char c;
+
+    if (area) {
+        lower = ftn_intern_lower(FTN_INTERN_AREA, ftn_intern(FTN_INTERN_AREA, area));
+    }
+    if (lower || !area) {
+        dupecheck_hash_field(ctx, lower);
+        return;
+    }
+
+    for (; *area; area++) {
+        c = (char)tolower((unsigned char)*area);
+        ftn_md5_update(ctx, &c, 1);
+    }
+    ftn_md5_update(ctx, "", 1);
+}
+
+ftn_error_t ftn_dupecheck_message_key(const ftn_message_t* msg, ftn_dupecheck_key_t* key) {
+    ftn_md5_context_t ctx;
+    uint8_t digest[16];
+    char numbers[128];
+    char* msgid;
+    char* normalized = NULL;
+
+    if (!msg || !key) return FTN_ERROR_INVALID_PARAMETER;
+
+    memset(key, 0, sizeof(ftn_dupecheck_key_t));
+
+    msgid = ftn_dupecheck_extract_msgid(msg);
+    if (msgid) {
+        normalized = ftn_dupecheck_normalize_msgid(msgid);
+        free(msgid);
+    }
+    if (normalized && ftn_dupecheck_is_valid_msgid(normalized)) {
+        dupecheck_hash_msgid(normalized, key);
+        free(normalized);
+        return FTN_OK;
+    }
+    free(normalized);
+
+    /*
+     * No MSGID: hash the header fields and body in a single pass. An
+     * echomail's addresses come from the packet it arrived in, so copies
+     * from two links would differ there; only netmail keys on them.
+     */
+    if (msg->area) {
+        snprintf(numbers, sizeof(numbers), "%ld", (long)msg->timestamp);
+    } else {
+        snprintf(numbers, sizeof(numbers), "%u:%u/%u.%u %u:%u/%u.%u %ld",
+                 msg->orig_addr.zone, msg->orig_addr.net, msg->orig_addr.node, msg->orig_addr.point,
+                 msg->dest_addr.zone, msg->dest_addr.net, msg->dest_addr.node, msg->dest_addr.point,
+                 (long)msg->timestamp);
+    }
+
+    ftn_md5_init(&ctx);
+    ftn_md5_update(&ctx, "C", 1);
+    dupecheck_hash_field(&ctx, numbers);
+    dupecheck_hash_area(&ctx, msg->area);
+    dupecheck_hash_field(&ctx, msg->from_user);
+    dupecheck_hash_field(&ctx, msg->to_user);
+    dupecheck_hash_field(&ctx, msg->subject);
+    dupecheck_hash_field(&ctx, msg->text);
+    ftn_md5_final(&ctx, digest);
+    dupecheck_digest_key(digest, key);
+
+    return FTN_OK;
+}
+
+/* 32 hex digits, as written by ftn_dupecheck_db_save() */
+static int dupecheck_parse_key(const char* hex, ftn_dupecheck_key_t* key) {
+    unsigned long words[4];
+    int i;
+
+    if (strlen(hex) != 32) return 0;
+    if (sscanf(hex, "%8lx%8lx%8lx%8lx", &words[0], &words[1], &words[2], &words[3]) != 4) {
+        return 0;
+    }
+    for (i = 0; i < 4; i++) {
+        key->key[i] = (uint32_t)words[i];
+    }
+    return 1;
+}
+
 int ftn_dupecheck_is_valid_msgid(const char* msgid) {
     if (!msgid || strlen(msgid) == 0) {
         return 0;
@@ -167,6 +307,10 @@ ftn_dupecheck_db_t* ftn_dupecheck_db_new(void) {
     db->entry_count = 0;
     db->entry_capacity = 0;
     db->modified = 0;
+    db->hashed = 0;
+    db->keys = NULL;
+    db->key_count = 0;
+    db->key_capacity = 0;
 
     return db;
 }
@@ -184,10 +328,106 @@ void ftn_dupecheck_db_free(ftn_dupecheck_db_t* db) {
         }
         free(db->entries);
     }
+    free(db->keys);
 
     free(db);
 }
 
+/* Slot holding a key, or the free slot where it belongs */
+static size_t dupecheck_key_slot(const ftn_dupecheck_key_t* keys, size_t capacity, const ftn_dupecheck_key_t* key) {
+    size_t mask = capacity - 1;
+    size_t i = (size_t)key->key[0] & mask;
+
+    while (keys[i].day != 0 && memcmp(keys[i].key, key->key, sizeof(key->key)) != 0) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/* Move the keys still wanted into a fresh table */
+static ftn_error_t dupecheck_rebuild_keys(ftn_dupecheck_db_t* db, size_t capacity, uint32_t min_day) {
+    ftn_dupecheck_key_t* table;
+    size_t count = 0;
+    size_t i;
+
+    table = calloc(capacity, sizeof(ftn_dupecheck_key_t));
+    if (!table) return FTN_ERROR_NOMEM;
+
+    for (i = 0; i < db->key_capacity; i++) {
+        if (db->keys[i].day != 0 && db->keys[i].day >= min_day) {
+            table[dupecheck_key_slot(table, capacity, &db->keys[i])] = db->keys[i];
+            count++;
+        }
+    }
+
+    free(db->keys);
+    db->keys = table;
+    db->key_capacity = capacity;
+    db->key_count = count;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_dupecheck_db_add_key(ftn_dupecheck_db_t* db, const ftn_dupecheck_key_t* key) {
+    ftn_error_t result;
+    size_t slot;
+
+    if (!db || !key || key->day == 0) return FTN_ERROR_INVALID_PARAMETER;
+
+    /* Keep the table at most three quarters full */
+    if ((db->key_count + 1) * 4 > db->key_capacity * 3) {
+        result = dupecheck_rebuild_keys(db, db->key_capacity ? db->key_capacity * 2 : KEY_TABLE_INITIAL, 0);
+        if (result != FTN_OK) return result;
+    }
+
+    slot = dupecheck_key_slot(db->keys, db->key_capacity, key);
+    if (db->keys[slot].day != 0) {
+        return FTN_OK; /* Already exists, no need to add */
+    }
+
+    db->keys[slot] = *key;
+    db->key_count++;
+    db->modified = 1;
+    return FTN_OK;
+}
+
+int ftn_dupecheck_db_find_key(const ftn_dupecheck_db_t* db, const ftn_dupecheck_key_t* key) {
+    size_t slot;
+
+    if (!db || !key || !db->keys) return -1;
+
+    slot = dupecheck_key_slot(db->keys, db->key_capacity, key);
+    return db->keys[slot].day != 0 ? (int)slot : -1;
+}
+
+ftn_error_t ftn_dupecheck_db_set_hashed(ftn_dupecheck_db_t* db) {
+    ftn_dupecheck_key_t key;
+    ftn_error_t result = FTN_OK;
+    size_t i;
+
+    if (!db) return FTN_ERROR_INVALID_PARAMETER;
+    if (db->hashed) return FTN_OK;
+
+    db->hashed = 1;
+
+    /* Convert the MSGIDs already held */
+    for (i = 0; i < db->entry_count; i++) {
+        if (db->entries[i].msgid) {
+            if (result == FTN_OK) {
+                dupecheck_hash_msgid(db->entries[i].msgid, &key);
+                key.day = dupecheck_day(db->entries[i].timestamp);
+                result = ftn_dupecheck_db_add_key(db, &key);
+            }
+            free(db->entries[i].msgid);
+        }
+    }
+    free(db->entries);
+    db->entries = NULL;
+    db->entry_count = 0;
+    db->entry_capacity = 0;
+
+    return result;
+}
+
 ftn_error_t ftn_dupecheck_db_add_entry(ftn_dupecheck_db_t* db, const char* msgid, time_t timestamp) {
     ftn_dupecheck_entry_t* new_entries;
 
@@ -239,6 +479,16 @@ ftn_error_t ftn_dupecheck_db_cleanup_old(ftn_dupecheck_db_t* db, time_t cutoff_t
 
     if (!db) return FTN_ERROR_INVALID_PARAMETER;
 
+    if (db->hashed) {
+        if (!db->keys) return FTN_OK;
+        i = db->key_count;
+        if (dupecheck_rebuild_keys(db, db->key_capacity, dupecheck_day(cutoff_time)) != FTN_OK) {
+            return FTN_ERROR_NOMEM;
+        }
+        if (db->key_count != i) db->modified = 1;
+        return FTN_OK;
+    }
+
     /* Remove entries older than cutoff time */
     for (i = 0; i < db->entry_count; ) {
         if (db->entries[i].timestamp < cutoff_time) {
@@ -287,6 +537,8 @@ ftn_error_t ftn_dupecheck_db_load(ftn_dupecheck_db_t* db, const char* db_path) {
     char* timestamp_str;
     char* msgid_str;
     time_t timestamp;
+    ftn_dupecheck_key_t key;
+    int hashed_file = 0;
 
     if (!db || !db_path) return FTN_ERROR_INVALID_PARAMETER;
 
@@ -299,6 +551,16 @@ ftn_error_t ftn_dupecheck_db_load(ftn_dupecheck_db_t* db, const char* db_path) {
     while (fgets(line, sizeof(line), fp)) {
         ftn_dupecheck_trim(line);
 
+        /* A hashed database is loaded in hashed mode */
+        if (strcmp(line, DB_HASHED_VERSION_STRING) == 0) {
+            hashed_file = 1;
+            if (ftn_dupecheck_db_set_hashed(db) != FTN_OK) {
+                fclose(fp);
+                return FTN_ERROR_NOMEM;
+            }
+            continue;
+        }
+
         /* Skip empty lines and comments */
         if (strlen(line) == 0 || line[0] == '#') {
             continue;
@@ -317,14 +579,29 @@ ftn_error_t ftn_dupecheck_db_load(ftn_dupecheck_db_t* db, const char* db_path) {
         ftn_dupecheck_trim(timestamp_str);
         ftn_dupecheck_trim(msgid_str);
 
+        if (hashed_file) {
+            /* day|key */
+            key.day = (uint32_t)strtoul(timestamp_str, NULL, 10);
+            if (key.day > 0 && dupecheck_parse_key(msgid_str, &key)) {
+                ftn_dupecheck_db_add_key(db, &key);
+            }
+            continue;
+        }
+
         timestamp = ftn_dupecheck_parse_timestamp(timestamp_str);
         if (timestamp > 0 && strlen(msgid_str) > 0) {
-            ftn_dupecheck_db_add_entry(db, msgid_str, timestamp);
+            if (db->hashed) {
+                dupecheck_hash_msgid(msgid_str, &key);
+                key.day = dupecheck_day(timestamp);
+                ftn_dupecheck_db_add_key(db, &key);
+            } else {
+                ftn_dupecheck_db_add_entry(db, msgid_str, timestamp);
+            }
         }
     }
 
     fclose(fp);
-    db->modified = 0; /* Clear modified flag after loading */
+    db->modified = hashed_file ? 0 : db->hashed; /* A converted database is saved hashed */
     return FTN_OK;
 }
 
@@ -342,6 +619,21 @@ ftn_error_t ftn_dupecheck_db_save(ftn_dupecheck_db_t* db, const char* db_path) {
     fp = fopen(db_path, "w");
     if (!fp) return FTN_ERROR_FILE;
 
+    if (db->hashed) {
+        fprintf(fp, "%s\n", DB_HASHED_VERSION_STRING);
+        fprintf(fp, "# day|key\n");
+        for (i = 0; i < db->key_capacity; i++) {
+            if (db->keys[i].day != 0) {
+                fprintf(fp, "%lu|%08lx%08lx%08lx%08lx\n", (unsigned long)db->keys[i].day,
+                        (unsigned long)db->keys[i].key[0], (unsigned long)db->keys[i].key[1],
+                        (unsigned long)db->keys[i].key[2], (unsigned long)db->keys[i].key[3]);
+            }
+        }
+        fclose(fp);
+        db->modified = 0;
+        return FTN_OK;
+    }
+
     /* Write header */
     fprintf(fp, "%s\n", DB_VERSION_STRING);
     fprintf(fp, "# timestamp|msgid\n");
@@ -433,6 +725,14 @@ ftn_error_t ftn_dupecheck_is_duplicate(ftn_dupecheck_t* dupecheck, const ftn_mes
     *is_dupe = 0;
     db = (ftn_dupecheck_db_t*)dupecheck->db_handle;
 
+    if (db->hashed) {
+        ftn_dupecheck_key_t key;
+
+        ftn_dupecheck_message_key(msg, &key);
+        *is_dupe = ftn_dupecheck_db_find_key(db, &key) >= 0 ? 1 : 0;
+        return FTN_OK;
+    }
+
     /* Extract MSGID from message */
     msgid = ftn_dupecheck_extract_msgid(msg);
     if (!msgid) {
@@ -470,6 +770,15 @@ ftn_error_t ftn_dupecheck_add_message(ftn_dupecheck_t* dupecheck, const ftn_mess
 
     db = (ftn_dupecheck_db_t*)dupecheck->db_handle;
 
+    if (db->hashed) {
+        ftn_dupecheck_key_t key;
+
+        ftn_dupecheck_message_key(msg, &key);
+        time(&current_time);
+        key.day = dupecheck_day(current_time);
+        return ftn_dupecheck_db_add_key(db, &key);
+    }
+
     /* Extract MSGID from message */
     msgid = ftn_dupecheck_extract_msgid(msg);
     if (!msgid) {
@@ -516,6 +825,15 @@ ftn_error_t ftn_dupecheck_get_stats(const ftn_dupecheck_t* dupecheck, ftn_dupech
     memset(stats, 0, sizeof(ftn_dupecheck_stats_t));
     stats->total_entries = db->entry_count;
 
+    if (db->hashed) {
+        stats->total_entries = db->key_count;
+        for (i = 0; i < db->key_capacity; i++) {
+            if (db->keys[i].day != 0 && (oldest == 0 || (time_t)db->keys[i].day * SECONDS_PER_DAY < oldest)) {
+                oldest = (time_t)db->keys[i].day * SECONDS_PER_DAY;
+            }
+        }
+    }
+
     /* Find oldest entry */
     for (i = 0; i < db->entry_count; i++) {
         if (oldest == 0 || db->entries[i].timestamp < oldest) {
@@ -541,4 +859,21 @@ ftn_error_t ftn_dupecheck_set_max_entries(ftn_dupecheck_t* dupecheck, size_t max
 
     dupecheck->max_entries = max_entries;
     return FTN_OK;
-}
\ No newline at end of file
+}
+
+ftn_error_t ftn_dupecheck_set_hashed(ftn_dupecheck_t* dupecheck, int hashed) {
+    ftn_dupecheck_db_t* db;
+
+    if (!dupecheck || !dupecheck->db_handle) return FTN_ERROR_INVALID_PARAMETER;
+
+    db = (ftn_dupecheck_db_t*)dupecheck->db_handle;
+    if (!hashed) {
+        /* Hashed keys cannot be turned back into MSGIDs */
+        return db->hashed ? FTN_ERROR_INVALID : FTN_OK;
+    }
+    if (db->hashed) return FTN_OK;
+
+    if (ftn_dupecheck_db_set_hashed(db) != FTN_OK) return FTN_ERROR_NOMEM;
+    db->modified = 1;
+    return FTN_OK;
+}
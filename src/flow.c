@@ -21,15 +21,24 @@
  * SOFTWARE.
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
-#include <sys/stat.h>
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include "ftn/flow.h"
+#include "ftn/control.h"
 #include "ftn/log.h"
 
+/* References for busy nodes wait here, one per line:
+   "<zone> <net> <node> <point> <flavor> <directive> <path>" */
+#define FLOW_DEFERRED_NAME ".deferred"
+
 /* Address structure (should match the one in bso.c) */
 typedef struct ftn_address {
     int zone;
@@ -626,4 +635,413 @@ ftn_bso_error_t ftn_flow_validate_file_exists(const ftn_reference_entry_t* entry
     }
 
     return BSO_OK;
-}
\ No newline at end of file
+}
+
+ftn_bso_error_t ftn_flow_generate_filename(const struct ftn_address* addr, ftn_flow_type_t type, ftn_flow_flavor_t flavor, char** filename) {
+    const char* flavor_str;
+    const char* extension;
+
+    if (!addr || !filename) {
+        return BSO_ERROR_INVALID_PATH;
+    }
+
+    switch (flavor) {
+        case FLOW_FLAVOR_IMMEDIATE:  flavor_str = "i"; break;
+        case FLOW_FLAVOR_CONTINUOUS: flavor_str = "c"; break;
+        case FLOW_FLAVOR_DIRECT:     flavor_str = "d"; break;
+        case FLOW_FLAVOR_HOLD:       flavor_str = "h"; break;
+        default:                     flavor_str = ""; break;
+    }
+    extension = (type == FLOW_TYPE_NETMAIL) ? "out" : "flo";
+
+    if (addr->point != 0) {
+        /* Inside a point directory the file is named after the point number */
+        ftn_address_t point_addr;
+
+        memset(&point_addr, 0, sizeof(point_addr));
+        point_addr.zone = addr->zone;
+        point_addr.node = addr->point;
+        *filename = ftn_bso_get_flow_filename(&point_addr, flavor_str, extension);
+    } else {
+        *filename = ftn_bso_get_flow_filename(addr, flavor_str, extension);
+    }
+
+    return *filename ? BSO_OK : BSO_ERROR_MEMORY;
+}
+
+ftn_bso_error_t ftn_flow_get_path(const char* outbound_path, const struct ftn_address* addr, ftn_flow_type_t type, ftn_flow_flavor_t flavor, char** path) {
+    char* dir = NULL;
+    char* point_dir;
+    char* filename = NULL;
+    ftn_bso_error_t result;
+    size_t len;
+
+    if (!outbound_path || !addr || !path) {
+        return BSO_ERROR_INVALID_PATH;
+    }
+    *path = NULL;
+
+    result = ftn_bso_ensure_directory(outbound_path);
+    if (result != BSO_OK) {
+        return result;
+    }
+
+    dir = ftn_bso_get_zone_path(outbound_path, addr->zone);
+    if (!dir) {
+        return BSO_ERROR_INVALID_PATH;
+    }
+    result = ftn_bso_ensure_directory(dir);
+    if (result != BSO_OK) {
+        goto cleanup;
+    }
+
+    if (addr->point != 0) {
+        point_dir = ftn_bso_get_point_path(dir, addr);
+        if (!point_dir) {
+            result = BSO_ERROR_MEMORY;
+            goto cleanup;
+        }
+        free(dir);
+        dir = point_dir;
+        result = ftn_bso_ensure_directory(dir);
+        if (result != BSO_OK) {
+            goto cleanup;
+        }
+    }
+
+    result = ftn_flow_generate_filename(addr, type, flavor, &filename);
+    if (result != BSO_OK) {
+        goto cleanup;
+    }
+
+    len = strlen(dir) + strlen(filename) + 2;
+    *path = malloc(len);
+    if (!*path) {
+        result = BSO_ERROR_MEMORY;
+        goto cleanup;
+    }
+    snprintf(*path, len, "%s/%s", dir, filename);
+
+cleanup:
+    free(filename);
+    free(dir);
+    return result;
+}
+
+/* Append one reference line; the caller holds the node's .bsy */
+static ftn_bso_error_t flow_append_line(const char* outbound_path, const struct ftn_address* addr, ftn_flow_flavor_t flavor, const char* filepath, ftn_ref_directive_t directive) {
+    char* flow_path = NULL;
+    const char* prefix;
+    FILE* fp;
+    ftn_bso_error_t result;
+
+    switch (directive) {
+        case REF_DIRECTIVE_TRUNCATE: prefix = "#"; break;
+        case REF_DIRECTIVE_DELETE:   prefix = "^"; break;
+        case REF_DIRECTIVE_SKIP:     prefix = "~"; break;
+        case REF_DIRECTIVE_SEND:     prefix = "@"; break;
+        default:                     prefix = ""; break;
+    }
+
+    result = ftn_flow_get_path(outbound_path, addr, FLOW_TYPE_REFERENCE, flavor, &flow_path);
+    if (result != BSO_OK) {
+        return result;
+    }
+
+    fp = fopen(flow_path, "a");
+    if (!fp) {
+        logf_error("Failed to open flow file %s: %s", flow_path, strerror(errno));
+        free(flow_path);
+        return BSO_ERROR_FILE_IO;
+    }
+
+    if (fprintf(fp, "%s%s\n", prefix, filepath) < 0) {
+        result = BSO_ERROR_FILE_IO;
+    }
+    if (fclose(fp) != 0) {
+        result = BSO_ERROR_FILE_IO;
+    }
+
+    if (result == BSO_OK) {
+        logf_debug("Queued %s%s in %s", prefix, filepath, flow_path);
+    } else {
+        logf_error("Failed to append to flow file %s", flow_path);
+    }
+
+    free(flow_path);
+    return result;
+}
+
+/*
+ * Reference a file while holding the node's .bsy. A pending file still
+ * waits under "<filepath>.tmp" and gets its real name first, so nothing
+ * outside the flow file ever sees it.
+ */
+static ftn_bso_error_t flow_attach(const char* outbound_path, const struct ftn_address* addr, ftn_flow_flavor_t flavor, const char* filepath, ftn_ref_directive_t directive, int pending) {
+    ftn_control_lock_t lock;
+    ftn_bso_error_t result;
+    struct stat st;
+    char* temp_path;
+
+    if (!outbound_path || !addr || !filepath || *filepath == '\0') {
+        return BSO_ERROR_INVALID_PATH;
+    }
+
+    result = ftn_bso_ensure_directory(outbound_path);
+    if (result != BSO_OK) {
+        return result;
+    }
+
+    /* A mailer in session with the node may be reading or rewriting its flow file */
+    result = ftn_control_acquire_lock(addr, outbound_path, &lock);
+    if (result != BSO_OK) {
+        return result;
+    }
+
+    if (pending) {
+        temp_path = malloc(strlen(filepath) + 5);
+        if (!temp_path) {
+            ftn_control_release_lock(&lock);
+            return BSO_ERROR_MEMORY;
+        }
+        sprintf(temp_path, "%s.tmp", filepath);
+        /* Already renamed by an attempt whose append failed */
+        if (rename(temp_path, filepath) != 0 && stat(filepath, &st) != 0) {
+            logf_error("Failed to rename %s: %s", temp_path, strerror(errno));
+            result = BSO_ERROR_FILE_IO;
+        }
+        free(temp_path);
+    }
+
+    if (result == BSO_OK) {
+        result = flow_append_line(outbound_path, addr, flavor, filepath, directive);
+    }
+
+    ftn_control_release_lock(&lock);
+    return result;
+}
+
+ftn_bso_error_t ftn_flow_append_reference(const char* outbound_path, const struct ftn_address* addr, ftn_flow_flavor_t flavor, const char* filepath, ftn_ref_directive_t directive) {
+    return flow_attach(outbound_path, addr, flavor, filepath, directive, 0);
+}
+
+/* Open the deferred list with an exclusive fcntl lock over the whole file */
+static int flow_open_deferred(const char* outbound_path, char* path, size_t size) {
+    struct flock fl;
+    int fd;
+
+    if (ftn_bso_ensure_directory(outbound_path) != BSO_OK) {
+        return -1;
+    }
+    snprintf(path, size, "%s/%s", outbound_path, FLOW_DEFERRED_NAME);
+
+    fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        logf_error("Failed to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &fl) < 0) {
+        if (errno != EINTR) {
+            logf_error("Failed to lock %s: %s", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static int flow_write_all(int fd, const char* data, size_t len) {
+    ssize_t written;
+
+    while (len > 0) {
+        written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return 0;
+}
+
+static ftn_bso_error_t flow_queue(const char* outbound_path, const struct ftn_address* addr, ftn_flow_flavor_t flavor, const char* filepath, ftn_ref_directive_t directive, int pending) {
+    char path[1024];
+    char* line;
+    size_t len;
+    ftn_bso_error_t result;
+    int fd;
+
+    result = flow_attach(outbound_path, addr, flavor, filepath, directive, pending);
+    if (result != BSO_ERROR_BUSY) {
+        return result;
+    }
+
+    len = strlen(filepath) + 96;
+    line = malloc(len);
+    if (!line) {
+        return BSO_ERROR_MEMORY;
+    }
+    snprintf(line, len, "%d %d %d %d %d %d %d %s\n", addr->zone, addr->net, addr->node,
+             addr->point, (int)flavor, (int)directive, pending, filepath);
+
+    fd = flow_open_deferred(outbound_path, path, sizeof(path));
+    if (fd < 0) {
+        free(line);
+        return BSO_ERROR_FILE_IO;
+    }
+
+    result = BSO_OK;
+    if (flow_write_all(fd, line, strlen(line)) != 0) {
+        logf_error("Failed to write %s: %s", path, strerror(errno));
+        result = BSO_ERROR_FILE_IO;
+    }
+    if (close(fd) != 0) {
+        result = BSO_ERROR_FILE_IO;
+    }
+
+    if (result == BSO_OK) {
+        logf_info("%d:%d/%d.%d is busy, deferred %s", addr->zone, addr->net, addr->node,
+                  addr->point, filepath);
+    }
+    free(line);
+    return result;
+}
+
+ftn_bso_error_t ftn_flow_queue_reference(const char* outbound_path, const struct ftn_address* addr, ftn_flow_flavor_t flavor, const char* filepath, ftn_ref_directive_t directive) {
+    return flow_queue(outbound_path, addr, flavor, filepath, directive, 0);
+}
+
+ftn_bso_error_t ftn_flow_queue_pending(const char* outbound_path, const struct ftn_address* addr, ftn_flow_flavor_t flavor, const char* filepath, ftn_ref_directive_t directive) {
+    return flow_queue(outbound_path, addr, flavor, filepath, directive, 1);
+}
+
+ftn_bso_error_t ftn_flow_attach_deferred(const char* outbound_path, size_t* remaining) {
+    struct ftn_address addr;
+    struct ftn_address* busy = NULL;
+    struct ftn_address* grown;
+    struct stat st;
+    char path[1024];
+    char* data = NULL;
+    char* keep = NULL;
+    char* line;
+    char* next;
+    size_t keep_len = 0;
+    size_t waiting = 0;
+    size_t busy_count = 0;
+    size_t i;
+    ssize_t got;
+    int flavor;
+    int directive;
+    int pending;
+    int offset;
+    int fd;
+    ftn_bso_error_t result = BSO_OK;
+    ftn_bso_error_t status;
+
+    if (remaining) *remaining = 0;
+    if (!outbound_path) {
+        return BSO_ERROR_INVALID_PATH;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", outbound_path, FLOW_DEFERRED_NAME);
+    if (stat(path, &st) != 0 || st.st_size == 0) {
+        return BSO_OK;
+    }
+
+    fd = flow_open_deferred(outbound_path, path, sizeof(path));
+    if (fd < 0) {
+        return BSO_ERROR_FILE_IO;
+    }
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return BSO_ERROR_FILE_IO;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return BSO_OK;
+    }
+
+    data = malloc((size_t)st.st_size + 1);
+    keep = malloc((size_t)st.st_size + 1);
+    if (!data || !keep) {
+        result = BSO_ERROR_MEMORY;
+        goto cleanup;
+    }
+    got = pread(fd, data, (size_t)st.st_size, 0);
+    if (got != (ssize_t)st.st_size) {
+        result = BSO_ERROR_FILE_IO;
+        goto cleanup;
+    }
+    data[got] = '\0';
+
+    /* Attach in order; once a node is busy its later lines wait too */
+    memset(&addr, 0, sizeof(addr));
+    for (line = data; *line; line = next) {
+        next = strchr(line, '\n');
+        if (next) {
+            *next++ = '\0';
+        } else {
+            next = line + strlen(line);
+        }
+
+        /* Lines from before pending files have no pending field */
+        pending = 0;
+        if ((sscanf(line, "%d %d %d %d %d %d %d %n", &addr.zone, &addr.net, &addr.node,
+                    &addr.point, &flavor, &directive, &pending, &offset) != 7 &&
+             sscanf(line, "%d %d %d %d %d %d %n", &addr.zone, &addr.net, &addr.node,
+                    &addr.point, &flavor, &directive, &offset) != 6) || !line[offset]) {
+            logf_warning("Dropping malformed deferred reference: %s", line);
+            continue;
+        }
+
+        for (i = 0; i < busy_count; i++) {
+            if (busy[i].zone == addr.zone && busy[i].net == addr.net &&
+                busy[i].node == addr.node && busy[i].point == addr.point) {
+                break;
+            }
+        }
+        status = BSO_ERROR_BUSY;
+        if (i == busy_count) {
+            status = flow_attach(outbound_path, &addr, (ftn_flow_flavor_t)flavor,
+                                 line + offset, (ftn_ref_directive_t)directive, pending != 0);
+        }
+        if (status == BSO_OK) {
+            continue;
+        }
+        if (status != BSO_ERROR_BUSY) {
+            result = status;
+        }
+        if (i == busy_count) {
+            grown = realloc(busy, (busy_count + 1) * sizeof(struct ftn_address));
+            if (grown) {
+                busy = grown;
+                busy[busy_count++] = addr;
+            } else {
+                result = BSO_ERROR_MEMORY;
+            }
+        }
+        keep_len += (size_t)sprintf(keep + keep_len, "%s\n", line);
+        waiting++;
+    }
+
+    /* Appenders wait on the fcntl lock, so nothing is lost between read and rewrite */
+    if (ftruncate(fd, 0) != 0 || flow_write_all(fd, keep, keep_len) != 0) {
+        logf_error("Failed to rewrite %s: %s", path, strerror(errno));
+        result = BSO_ERROR_FILE_IO;
+    }
+
+cleanup:
+    if (close(fd) != 0 && result == BSO_OK) {
+        result = BSO_ERROR_FILE_IO;
+    }
+    free(data);
+    free(keep);
+    free(busy);
+    if (remaining) *remaining = waiting;
+    return result;
+}
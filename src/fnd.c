@@ -0,0 +1,779 @@
+/*
+ * fnd.c - Combined FTN daemon (mailer, tosser and scanner) for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef FTN_NO_THREADS
+#include <pthread.h>
+#endif
+
+#include "ftn.h"
+#include "ftn/config.h"
+#include "ftn/version.h"
+#include "ftn/mailer.h"
+#include "ftn/tosser.h"
+#include "ftn/nlmgr.h"
+#include "ftn/intern.h"
+#include "ftn/thread.h"
+#include "ftn/log.h"
+
+/* Modules */
+#define FND_MODULE_MAILER  0x01
+#define FND_MODULE_TOSSER  0x02
+#define FND_MODULE_SCANNER 0x04
+#define FND_MODULE_ALL     (FND_MODULE_MAILER | FND_MODULE_TOSSER | FND_MODULE_SCANNER)
+
+/* Directory state seen by the scanner */
+typedef struct {
+    time_t inbox_mtime;
+    time_t outbound_mtime;
+} fnd_watch_t;
+
+struct fnd_pool;
+
+/* State shared by every module */
+typedef struct {
+    ftn_config_t* config;           /* Config snapshot */
+    ftn_nodelist_manager_t* nodelist; /* Nodelist, reloaded when it changes (may be NULL) */
+    ftn_nodelist_t* mailer_nodelist;  /* The mailer's reference to the index (may be NULL) */
+    ftn_tosser_t* tosser;           /* Tosser, with the dupe DB and Areafix tables */
+    ftn_mailer_context_t* mailer;   /* Mailer and its per-network schedule */
+    fnd_watch_t* watch;             /* Scanner state, one per network */
+    struct fnd_pool* pool;          /* Uplink pollers (NULL polls one at a time) */
+    int modules;
+    int workers;                    /* Uplinks polled at the same time */
+    int sleep_interval;
+    int toss_pending;               /* Inbound work is waiting */
+    time_t next_toss;
+    unsigned long tossing_passes;
+    unsigned long sessions;
+} fnd_t;
+
+static int verbose_mode = 0;
+static int daemon_mode = 0;
+static const char* config_file_path = NULL;
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [OPTIONS]\n", program_name);
+    printf("\nFidoNet Technology Network daemon: mailer, tosser and scanner in one process\n\n");
+    printf("Options:\n");
+    printf("  -c, --config FILE     Configuration file path (required)\n");
+    printf("  -d, --daemon          Run in continuous (daemon) mode\n");
+    printf("  -s, --sleep SECONDS   Seconds between inbox scans (default: from config)\n");
+    printf("  -w, --workers N       Uplinks to poll at the same time (default: max_connections)\n");
+    printf("  -m, --modules LIST    Modules to run: mailer,tosser,scanner (default: all)\n");
+    printf("  -v, --verbose         Enable verbose logging\n");
+    printf("  -h, --help            Show this help message\n");
+    printf("      --version         Show version information\n");
+    printf("\nExamples:\n");
+    printf("  %s -c /etc/ftn.ini                     # Poll and toss once\n", program_name);
+    printf("  %s -c /etc/ftn.ini -d                  # Daemon mode\n", program_name);
+    printf("  %s -c /etc/ftn.ini -d -m tosser        # Tosser only\n", program_name);
+}
+
+static void print_version(void) {
+    printf("fnd (libFTN) %d.%d.%d\n", FTN_VERSION_MAJOR, FTN_VERSION_MINOR, FTN_VERSION_PATCH);
+    printf("Copyright (c) 2025 Andrew C. Young\n");
+    printf("This is free software; see the source for copying conditions.\n");
+}
+
+static int parse_modules(const char* list) {
+    char buffer[128];
+    char* name;
+    char* saveptr = NULL;
+    int modules = 0;
+
+    strncpy(buffer, list, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+
+    for (name = strtok_r(buffer, ",", &saveptr); name; name = strtok_r(NULL, ",", &saveptr)) {
+        ftn_trim(name);
+        if (strcmp(name, "mailer") == 0) {
+            modules |= FND_MODULE_MAILER;
+        } else if (strcmp(name, "tosser") == 0) {
+            modules |= FND_MODULE_TOSSER;
+        } else if (strcmp(name, "scanner") == 0) {
+            modules |= FND_MODULE_SCANNER;
+        } else if (strcmp(name, "all") == 0) {
+            modules |= FND_MODULE_ALL;
+        } else {
+            return -1;
+        }
+    }
+    return modules;
+}
+
+static time_t dir_mtime(const char* path) {
+    struct stat st;
+
+    if (!path || stat(path, &st) != 0) {
+        return 0;
+    }
+    return st.st_mtime;
+}
+
+/* Free the state built from one config snapshot, including the config */
+static void fnd_release(fnd_t* state) {
+    ftn_tosser_free(state->tosser);
+    state->tosser = NULL;
+    free(state->watch);
+    state->watch = NULL;
+    ftn_mailer_context_free(state->mailer);
+    state->mailer = NULL;
+    ftn_nodelist_manager_release(state->nodelist, state->mailer_nodelist);
+    state->mailer_nodelist = NULL;
+    ftn_nodelist_manager_free(state->nodelist);
+    state->nodelist = NULL;
+    ftn_config_free(state->config);
+    state->config = NULL;
+}
+
+/*
+ * Build everything a config snapshot needs into next without touching the
+ * running state. The config is owned by next from here, and is freed with
+ * the rest of it on failure.
+ */
+static int fnd_build(const fnd_t* fnd, ftn_config_t* config, fnd_t* next) {
+    size_t i;
+
+    memset(next, 0, sizeof(fnd_t));
+    next->config = config;
+
+    if (config->daemon && config->daemon->nodelist) {
+        next->nodelist = ftn_nodelist_manager_new(config->daemon->nodelist, 0);
+        if (!next->nodelist) {
+            logf_warning("Failed to set up nodelist: %s", config->daemon->nodelist);
+        }
+    }
+
+    if (fnd->modules & FND_MODULE_TOSSER) {
+        next->tosser = ftn_tosser_new(config);
+        if (!next->tosser) {
+            log_error("Failed to initialize tosser");
+            fnd_release(next);
+            return -1;
+        }
+    }
+
+    /* The mailer context also carries the daemon's PID file */
+    next->mailer = ftn_mailer_context_new();
+    if (!next->mailer) {
+        log_error("Failed to allocate mailer context");
+        fnd_release(next);
+        return -1;
+    }
+    if (fnd->modules & FND_MODULE_MAILER) {
+        if (ftn_mailer_context_attach(next->mailer, config) != FTN_OK) {
+            log_error("Configuration is not usable by the mailer");
+            fnd_release(next);
+            return -1;
+        }
+        next->mailer_nodelist = ftn_nodelist_manager_acquire(next->nodelist);
+        ftn_mailer_set_nodelist(next->mailer, next->mailer_nodelist);
+    }
+
+    /* The scanner only reacts to changes made after this point */
+    next->watch = calloc(config->network_count ? config->network_count : 1, sizeof(fnd_watch_t));
+    if (!next->watch) {
+        log_error("Failed to allocate scanner state");
+        fnd_release(next);
+        return -1;
+    }
+    for (i = 0; i < config->network_count; i++) {
+        next->watch[i].inbox_mtime = dir_mtime(config->networks[i].inbox);
+        next->watch[i].outbound_mtime = dir_mtime(config->networks[i].outbound_path);
+    }
+
+    return 0;
+}
+
+/* Replace the running state with one made by fnd_build; this cannot fail */
+static void fnd_commit(fnd_t* fnd, fnd_t* next) {
+    if (fnd->mailer) {
+        ftn_mailer_context_adopt(next->mailer, fnd->mailer);
+    }
+    fnd_release(fnd);
+
+    fnd->config = next->config;
+    fnd->nodelist = next->nodelist;
+    fnd->tosser = next->tosser;
+    fnd->mailer = next->mailer;
+    fnd->watch = next->watch;
+    memset(next, 0, sizeof(fnd_t));
+
+    if (fnd->modules & FND_MODULE_MAILER) {
+        ftn_mailer_open_listeners(fnd->mailer);
+    }
+    fnd->toss_pending = 1;
+}
+
+static ftn_config_t* load_config(const char* path) {
+    ftn_config_t* config;
+
+    config = ftn_config_new();
+    if (!config) {
+        log_critical("Failed to allocate configuration structure");
+        return NULL;
+    }
+    if (ftn_config_load(config, path) != FTN_OK) {
+        logf_critical("Failed to load configuration from: %s", path);
+        ftn_config_free(config);
+        return NULL;
+    }
+    if (ftn_config_validate(config) != FTN_OK) {
+        log_critical("Configuration validation failed");
+        ftn_config_free(config);
+        return NULL;
+    }
+    return config;
+}
+
+/*
+ * Swap in a new config snapshot. The new state is built in full first, so
+ * the running one is only replaced once nothing else can go wrong. The
+ * loop calls this between cycles, while no poll worker is running.
+ */
+static void fnd_reload(fnd_t* fnd) {
+    ftn_config_t* config;
+    fnd_t next;
+
+    logf_info("Reloading configuration from: %s", config_file_path);
+
+    config = load_config(config_file_path);
+    if (!config) {
+        log_error("Failed to reload configuration, keeping current config");
+        return;
+    }
+
+    if (fnd_build(fnd, config, &next) != 0) {
+        log_error("Failed to build state for the new configuration, keeping current config");
+        return;
+    }
+
+    fnd_commit(fnd, &next);
+    log_info("Configuration reloaded successfully");
+}
+
+/* Scanner: notice new inbound files and new outbound mail */
+static void fnd_scan(fnd_t* fnd, time_t now) {
+    const ftn_network_config_t* network;
+    time_t mtime;
+    size_t i;
+
+    for (i = 0; i < fnd->config->network_count; i++) {
+        network = &fnd->config->networks[i];
+
+        mtime = dir_mtime(network->inbox);
+        if (mtime != fnd->watch[i].inbox_mtime) {
+            fnd->watch[i].inbox_mtime = mtime;
+            logf_debug("Inbox changed for network %s", network->name);
+            fnd->toss_pending = 1;
+        }
+
+        /* Mail queued for an uplink is sent now rather than at the next poll */
+        mtime = dir_mtime(network->outbound_path);
+        if (mtime != fnd->watch[i].outbound_mtime) {
+            fnd->watch[i].outbound_mtime = mtime;
+            if ((fnd->modules & FND_MODULE_MAILER) && i < fnd->mailer->network_count) {
+                logf_debug("Outbound changed for network %s, polling", network->name);
+                fnd->mailer->networks[i].next_poll_time = now;
+            }
+        }
+    }
+}
+
+/* Networks due for a poll, shared by the worker threads */
+typedef struct {
+    fnd_t* fnd;
+    size_t* due;
+    int* results;
+    size_t count;
+    size_t next;
+    time_t now;
+} fnd_poll_batch_t;
+
+#ifndef FTN_NO_THREADS
+/* Poll workers, started once and woken for each batch */
+struct fnd_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t work;            /* A batch is ready, or the pool is stopping */
+    pthread_cond_t done;            /* The last busy worker finished its batch */
+    pthread_t* threads;
+    size_t thread_count;
+    fnd_poll_batch_t* batch;
+    unsigned long generation;       /* Bumped for every batch */
+    size_t busy;                    /* Workers still on the current batch */
+    int stopping;
+};
+
+static void* fnd_poll_worker(void* arg) {
+    struct fnd_pool* pool = (struct fnd_pool*)arg;
+    fnd_poll_batch_t* batch;
+    unsigned long seen = 0;
+    size_t i;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stopping && pool->generation == seen) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if (pool->stopping) break;
+        seen = pool->generation;
+        batch = pool->batch;
+
+        for (;;) {
+            i = batch->next++;
+            if (i >= batch->count) break;
+
+            pthread_mutex_unlock(&pool->lock);
+            batch->results[i] = ftn_mailer_poll_network(batch->fnd->mailer,
+                                                        &batch->fnd->mailer->networks[batch->due[i]],
+                                                        batch->now);
+            pthread_mutex_lock(&pool->lock);
+        }
+
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void fnd_pool_free(struct fnd_pool* pool) {
+    size_t i;
+
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+/* Start the workers; NULL leaves fnd polling one uplink at a time */
+static struct fnd_pool* fnd_pool_new(size_t workers) {
+    struct fnd_pool* pool;
+
+    pool = calloc(1, sizeof(struct fnd_pool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->threads = malloc(workers * sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (pool->thread_count = 0; pool->thread_count < workers; pool->thread_count++) {
+        if (pthread_create(&pool->threads[pool->thread_count], NULL, fnd_poll_worker, pool) != 0) {
+            break;
+        }
+    }
+
+    if (pool->thread_count == 0) {
+        fnd_pool_free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/* Hand a batch to the workers and wait until every uplink in it is polled */
+static void fnd_pool_run(struct fnd_pool* pool, fnd_poll_batch_t* batch) {
+    pthread_mutex_lock(&pool->lock);
+    pool->batch = batch;
+    pool->busy = pool->thread_count;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pool->batch = NULL;
+    pthread_mutex_unlock(&pool->lock);
+}
+#else
+static void fnd_pool_free(struct fnd_pool* pool) {
+    (void)pool;
+}
+#endif
+
+/* Mailer: answer waiting calls, then poll every uplink that is due, several at a time */
+static void fnd_poll(fnd_t* fnd, time_t now) {
+    ftn_mailer_context_t* mailer = fnd->mailer;
+    size_t* due;
+    int* results;
+    size_t count = 0;
+    size_t i;
+
+    for (i = 0; i < mailer->network_count; i++) {
+        while (ftn_mailer_answer_network(mailer, &mailer->networks[i], 0) > 0) {
+            ftn_mailer_update_stats(mailer, 1, 0, 0);
+            fnd->sessions++;
+            fnd->toss_pending = 1;
+        }
+    }
+
+    due = malloc(mailer->network_count * sizeof(size_t));
+    results = malloc(mailer->network_count * sizeof(int));
+    if (!due || !results) {
+        free(due);
+        free(results);
+        return;
+    }
+
+    for (i = 0; i < mailer->network_count; i++) {
+        if (now >= mailer->networks[i].next_poll_time) {
+            due[count++] = i;
+        }
+    }
+
+#ifndef FTN_NO_THREADS
+    if (count > 1 && fnd->pool) {
+        fnd_poll_batch_t batch;
+
+        batch.fnd = fnd;
+        batch.due = due;
+        batch.results = results;
+        batch.count = count;
+        batch.next = 0;
+        batch.now = now;
+        fnd_pool_run(fnd->pool, &batch);
+    } else
+#endif
+    {
+        for (i = 0; i < count; i++) {
+            results[i] = ftn_mailer_poll_network(mailer, &mailer->networks[due[i]], now);
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (results[i] < 0) continue;
+        ftn_mailer_update_stats(mailer, results[i] > 0, 0, 0);
+        if (results[i] > 0) {
+            fnd->sessions++;
+            /* Whatever the session brought in is tossed straight away */
+            fnd->toss_pending = 1;
+        }
+    }
+
+    free(due);
+    free(results);
+}
+
+/* Tosser: one pass over the inboxes; returns the number of deferred packets */
+static size_t fnd_toss(fnd_t* fnd, time_t now) {
+    ftn_toss_stats_t stats;
+    int time_budget = fnd->config->daemon ? fnd->config->daemon->toss_budget : 0;
+
+    ftn_toss_stats_init(&stats);
+    if (ftn_tosser_process_inbox(fnd->tosser, daemon_mode ? time_budget : 0, &stats) != FTN_OK) {
+        log_error("Error processing inbox, continuing");
+    }
+    ftn_tosser_flush(fnd->tosser);
+    fnd->tossing_passes++;
+
+    fnd->toss_pending = stats.packets_deferred > 0;
+    fnd->next_toss = now + fnd->sleep_interval;
+    return stats.packets_deferred;
+}
+
+static void fnd_dump_stats(const fnd_t* fnd) {
+    const ftn_nodelist_t* nodelist;
+
+    log_info("=== FND Statistics ===");
+    logf_info("Modules: %s%s%s",
+              (fnd->modules & FND_MODULE_MAILER) ? "mailer " : "",
+              (fnd->modules & FND_MODULE_TOSSER) ? "tosser " : "",
+              (fnd->modules & FND_MODULE_SCANNER) ? "scanner" : "");
+    logf_info("Tossing passes: %lu", fnd->tossing_passes);
+    logf_info("Successful sessions: %lu", fnd->sessions);
+    nodelist = ftn_nodelist_manager_get(fnd->nodelist);
+    if (nodelist) {
+        logf_info("Nodelist entries: %lu (%lu reloads)", (unsigned long)nodelist->count,
+                  fnd->nodelist->reloads);
+    }
+    if (fnd->modules & FND_MODULE_MAILER) {
+        ftn_mailer_dump_statistics(fnd->mailer);
+    }
+}
+
+/* One pass of every module, for single-shot mode */
+static int fnd_run_once(fnd_t* fnd) {
+    time_t now = time(NULL);
+
+    if (fnd->modules & FND_MODULE_MAILER) {
+        fnd_poll(fnd, now);
+    }
+    if (fnd->modules & FND_MODULE_TOSSER) {
+        fnd_toss(fnd, now);
+    }
+    return 0;
+}
+
+static int fnd_run_loop(fnd_t* fnd) {
+    ftn_log_level_t level;
+    time_t now;
+
+    ftn_mailer_setup_signals();
+
+    while (!fnmailer_shutdown_requested) {
+        now = time(NULL);
+
+        /* No poll is running here, so the mailer can switch to a new nodelist */
+        if (fnd->nodelist && ftn_nodelist_manager_check(fnd->nodelist, now) &&
+            (fnd->modules & FND_MODULE_MAILER)) {
+            ftn_nodelist_t* previous = fnd->mailer_nodelist;
+
+            fnd->mailer_nodelist = ftn_nodelist_manager_acquire(fnd->nodelist);
+            ftn_mailer_set_nodelist(fnd->mailer, fnd->mailer_nodelist);
+            ftn_nodelist_manager_release(fnd->nodelist, previous);
+        }
+
+        if (fnd->modules & FND_MODULE_SCANNER) {
+            fnd_scan(fnd, now);
+        }
+
+        if ((fnd->modules & FND_MODULE_MAILER) && now >= ftn_mailer_calculate_next_poll(fnd->mailer)) {
+            fnd_poll(fnd, now);
+        }
+
+        /* Without the scanner the inboxes are checked on the sleep interval only */
+        if ((fnd->modules & FND_MODULE_TOSSER) && (fnd->toss_pending || now >= fnd->next_toss)) {
+            if (fnd_toss(fnd, now) > 0) {
+                /* Work through a deferred backlog without waiting */
+                continue;
+            }
+        }
+
+        if (fnmailer_reload_requested) {
+            fnd_reload(fnd);
+            fnmailer_reload_requested = 0;
+        }
+        if (fnmailer_dump_stats_requested) {
+            fnd_dump_stats(fnd);
+            fnmailer_dump_stats_requested = 0;
+        }
+        if (fnmailer_toggle_debug_requested) {
+            level = ftn_log_get_level() == FTN_LOG_DEBUG ? FTN_LOG_INFO : FTN_LOG_DEBUG;
+            ftn_log_set_level(level);
+            logf_info("Log level changed to %s", level == FTN_LOG_DEBUG ? "DEBUG" : "INFO");
+            fnmailer_toggle_debug_requested = 0;
+        }
+
+        sleep(1);
+    }
+
+    ftn_mailer_cleanup_signals();
+    log_info("Daemon loop shutting down");
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    fnd_t fnd;
+    ftn_config_t* config;
+    int sleep_interval = 0;
+    int workers = 0;
+    int result = 0;
+    int i;
+
+    memset(&fnd, 0, sizeof(fnd));
+    fnd.modules = FND_MODULE_ALL;
+
+    /* Parse command-line arguments */
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--config") == 0) {
+            if (i + 1 < argc) {
+                config_file_path = argv[++i];
+            } else {
+                fprintf(stderr, "Error: %s requires an argument\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--daemon") == 0) {
+            daemon_mode = 1;
+        } else if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sleep") == 0 ||
+                   strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--workers") == 0) {
+            int value;
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: %s requires an argument\n", argv[i]);
+                return 1;
+            }
+            value = atoi(argv[i + 1]);
+            if (value <= 0) {
+                fprintf(stderr, "Error: Invalid value for %s: %s\n", argv[i], argv[i + 1]);
+                return 1;
+            }
+            if (argv[i][1] == 's' || argv[i][2] == 's') {
+                sleep_interval = value;
+            } else {
+                workers = value;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--modules") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: %s requires an argument\n", argv[i]);
+                return 1;
+            }
+            fnd.modules = parse_modules(argv[++i]);
+            if (fnd.modules <= 0) {
+                fprintf(stderr, "Error: Invalid module list: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+            verbose_mode = 1;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "--version") == 0) {
+            print_version();
+            return 0;
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!config_file_path) {
+        fprintf(stderr, "Error: Configuration file is required\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    /* Initialize logging early */
+    {
+        ftn_logging_config_t log_config = {0};
+        log_config.level = verbose_mode ? FTN_LOG_DEBUG : FTN_LOG_INFO;
+        log_config.ident = "fnd";
+        ftn_log_init(&log_config);
+    }
+
+    log_info("FTN daemon starting up");
+
+    config = load_config(config_file_path);
+    if (!config) {
+        ftn_log_cleanup();
+        return 1;
+    }
+
+    /* Re-initialize logging based on config file settings */
+    if (config->logging) {
+        ftn_log_init(config->logging);
+        if (verbose_mode) {
+            ftn_log_set_level(FTN_LOG_DEBUG);
+        }
+    }
+
+    fnd.sleep_interval = sleep_interval;
+    if (fnd.sleep_interval <= 0) {
+        fnd.sleep_interval = config->daemon ? config->daemon->sleep_interval : 60;
+    }
+    fnd.workers = workers;
+    if (fnd.workers <= 0) {
+        fnd.workers = config->daemon ? config->daemon->max_connections : 1;
+    }
+
+    if (ftn_net_init() != FTN_OK) {
+        log_critical("Failed to initialize network layer");
+        ftn_config_free(config);
+        ftn_log_cleanup();
+        return 1;
+    }
+
+    {
+        fnd_t next;
+
+        if (fnd_build(&fnd, config, &next) != 0) {
+            result = 1;
+            goto cleanup;
+        }
+        fnd_commit(&fnd, &next);
+    }
+
+    if (daemon_mode) {
+        if (config->daemon && config->daemon->pid_file) {
+            fnd.mailer->pid_file = malloc(strlen(config->daemon->pid_file) + 1);
+            if (fnd.mailer->pid_file) {
+                strcpy(fnd.mailer->pid_file, config->daemon->pid_file);
+            }
+        }
+        if (ftn_mailer_daemonize(fnd.mailer) != FTN_OK) {
+            log_critical("Failed to daemonize process");
+            result = 1;
+            goto cleanup;
+        }
+    }
+
+#ifndef FTN_NO_THREADS
+    /* Started once, and only in the process that polls: threads do not
+       survive the daemon's fork(). A reload keeps the same workers. */
+    if ((fnd.modules & FND_MODULE_MAILER) && fnd.workers > 1) {
+        fnd.pool = fnd_pool_new((size_t)fnd.workers);
+        if (!fnd.pool) {
+            log_warning("Failed to start poll workers, polling one uplink at a time");
+        }
+    }
+#endif
+
+    if (daemon_mode) {
+        if (ftn_mailer_create_pid_file(fnd.mailer) != FTN_OK) {
+            log_error("Failed to write PID file, continuing...");
+        }
+        result = fnd_run_loop(&fnd);
+        ftn_mailer_remove_pid_file(fnd.mailer);
+    } else {
+        result = fnd_run_once(&fnd);
+    }
+
+cleanup:
+    fnd_pool_free(fnd.pool);
+    fnd_release(&fnd);
+    ftn_net_cleanup();
+    ftn_intern_cleanup();
+    log_info("FTN daemon shutting down");
+    ftn_log_cleanup();
+
+    return result;
+}
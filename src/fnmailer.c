@@ -135,6 +135,9 @@ cleanup:
     if (options.config_file) {
         free(options.config_file);
     }
+    if (options.capture_dir) {
+        free(options.capture_dir);
+    }
 
     /* Cleanup network layer */
     ftn_net_cleanup();
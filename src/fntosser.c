@@ -30,17 +30,13 @@
 #include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <dirent.h>
-#include <errno.h>
 #include <fcntl.h>
 
 #include "ftn.h"
 #include "ftn/config.h"
 #include "ftn/version.h"
-#include "ftn/packet.h"
-#include "ftn/router.h"
-#include "ftn/storage.h"
-#include "ftn/dupechk.h"
+#include "ftn/tosser.h"
+#include "ftn/intern.h"
 #include "ftn/log.h"
 
 /* Global daemon state */
@@ -50,35 +46,13 @@ static volatile sig_atomic_t dump_stats_requested = 0;
 static volatile sig_atomic_t toggle_debug_requested = 0;
 static int verbose_mode = 0;
 static int daemon_mode = 0;
+static int profile_rules = 0;
 static const char* config_file_path = NULL;
 static ftn_config_t* global_config = NULL;
+static ftn_tosser_t* global_tosser = NULL;
 
 static ftn_log_level_t current_log_level = FTN_LOG_INFO;
 
-/* Processing error types */
-typedef enum {
-    FTN_PROCESS_SUCCESS,
-    FTN_PROCESS_ERROR_PACKET_PARSE,
-    FTN_PROCESS_ERROR_DUPLICATE,
-    FTN_PROCESS_ERROR_ROUTING,
-    FTN_PROCESS_ERROR_STORAGE,
-    FTN_PROCESS_ERROR_FILE_MOVE,
-    FTN_PROCESS_ERROR_DIRECTORY,
-    FTN_PROCESS_ERROR_PERMISSION
-} ftn_process_error_t;
-
-/* Processing statistics */
-typedef struct {
-    size_t packets_processed;
-    size_t messages_processed;
-    size_t duplicates_found;
-    size_t messages_stored;
-    size_t messages_forwarded;
-    size_t errors_encountered;
-    time_t processing_start_time;
-    time_t processing_end_time;
-} ftn_processing_stats_t;
-
 /* Global statistics */
 typedef struct {
     unsigned long packets_processed;
@@ -87,6 +61,8 @@ typedef struct {
     unsigned long messages_stored;
     unsigned long messages_forwarded;
     unsigned long errors_total;
+    unsigned long packets_deferred;
+    unsigned long files_processed;
     time_t start_time;
     time_t last_cycle_time;
     double avg_cycle_time;
@@ -105,20 +81,7 @@ static void ftn_log_init_compat(ftn_log_level_t level, const char* ident) {
 /* Use new cleanup function */
 
 /* Function prototypes */
-static ftn_error_t ensure_directories_exist(const ftn_network_config_t* network);
-static ftn_error_t move_packet_to_processed(const char* packet_path, const char* processed_dir);
-static ftn_error_t move_packet_to_bad(const char* packet_path, const char* bad_dir);
-static ftn_error_t process_single_packet(const char* packet_path, const ftn_network_config_t* network,
-                                        ftn_router_t* router, ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
-                                        ftn_processing_stats_t* stats);
-static ftn_error_t process_message(const ftn_message_t* msg, const ftn_network_config_t* network,
-                                  ftn_router_t* router, ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
-                                  ftn_processing_stats_t* stats);
-static int process_network_inbox_enhanced(const ftn_network_config_t* network, ftn_router_t* router,
-                                         ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
-                                         ftn_processing_stats_t* stats);
-static void print_processing_stats(const ftn_processing_stats_t* stats);
-static void init_processing_stats(ftn_processing_stats_t* stats);
+static int process_inbox(int time_budget, ftn_toss_stats_t* stats);
 static int run_single_shot(void);
 static int daemonize(void);
 static int setup_daemon_environment(void);
@@ -132,8 +95,10 @@ static void handle_sigusr2(int sig);
 static int write_pid_file(const char* pid_file);
 static int remove_pid_file(const char* pid_file);
 static void ftn_stats_init(void);
-static void ftn_stats_update(const ftn_processing_stats_t* stats);
+static void ftn_stats_update(const ftn_toss_stats_t* stats);
 static void ftn_stats_dump(void);
+static void ftn_stats_log_rules(void);
+static void ftn_stats_report_rules(void);
 
 void print_usage(const char* program_name) {
     printf("Usage: %s [OPTIONS]\n", program_name);
@@ -143,6 +108,7 @@ void print_usage(const char* program_name) {
     printf("  -d, --daemon          Run in continuous (daemon) mode\n");
     printf("  -s, --sleep SECONDS   Sleep interval for daemon mode (default: 60)\n");
     printf("  -v, --verbose         Enable verbose logging\n");
+    printf("      --profile-rules   Print per-rule routing counters on exit\n");
     printf("  -h, --help            Show this help message\n");
     printf("      --version         Show version information\n");
     printf("\nExamples:\n");
@@ -256,7 +222,7 @@ static void ftn_stats_init(void) {
     global_stats.start_time = time(NULL);
 }
 
-static void ftn_stats_update(const ftn_processing_stats_t* stats) {
+static void ftn_stats_update(const ftn_toss_stats_t* stats) {
     double total_time;
     if (!stats) return;
 
@@ -266,6 +232,8 @@ static void ftn_stats_update(const ftn_processing_stats_t* stats) {
     global_stats.messages_stored += stats->messages_stored;
     global_stats.messages_forwarded += stats->messages_forwarded;
     global_stats.errors_total += stats->errors_encountered;
+    global_stats.packets_deferred += stats->packets_deferred;
+    global_stats.files_processed += stats->files_processed;
 
     global_stats.last_cycle_time = time(NULL);
     global_stats.cycles_completed++;
@@ -292,8 +260,49 @@ static void ftn_stats_dump(void) {
     logf_info("Messages Stored: %lu", global_stats.messages_stored);
     logf_info("Messages Forwarded: %lu", global_stats.messages_forwarded);
     logf_info("Total Errors: %lu", global_stats.errors_total);
+    logf_info("Packets Deferred: %lu", global_stats.packets_deferred);
+    logf_info("Files Processed: %lu", global_stats.files_processed);
     logf_info("Processing Cycles: %lu", global_stats.cycles_completed);
     logf_info("Average Cycle Time: %.2f seconds", global_stats.avg_cycle_time);
+
+    ftn_stats_log_rules();
+}
+
+static void ftn_stats_log_rules(void) {
+    ftn_router_t* router;
+    size_t i;
+
+    if (!global_tosser || !global_tosser->router) {
+        return;
+    }
+
+    router = global_tosser->router;
+    for (i = 0; i < router->rule_count; i++) {
+        const ftn_routing_rule_t* rule = router->rules[i];
+        const char* name = rule->name ? rule->name : "-";
+
+        if (router->profile) {
+            logf_info("Rule %s: %lu evaluated, %lu matched, %.3f ms",
+                      name, rule->evaluations, rule->matches, rule->match_time * 1e3);
+        } else {
+            logf_info("Rule %s: %lu evaluated, %lu matched", name, rule->evaluations, rule->matches);
+        }
+    }
+}
+
+/* The --profile-rules report; counters reset whenever the tosser is rebuilt */
+static void ftn_stats_report_rules(void) {
+    if (!profile_rules || !global_tosser || !global_tosser->router) {
+        return;
+    }
+
+    /* A daemon has no terminal, so the report goes to the log instead */
+    if (daemon_mode) {
+        ftn_stats_log_rules();
+        return;
+    }
+    ftn_router_print_rule_profile(global_tosser->router, stdout);
+    fflush(stdout);
 }
 
 
@@ -322,7 +331,10 @@ static void reload_configuration(void) {
         return;
     }
 
-    /* This is a simple swap. In a multi-threaded environment, this would need a lock. */
+    /* The tosser points into the old config; it is rebuilt on the next cycle */
+    ftn_stats_report_rules();
+    ftn_tosser_free(global_tosser);
+    global_tosser = NULL;
     ftn_config_free(global_config);
     global_config = new_config;
 
@@ -370,92 +382,35 @@ static void setup_daemon_signals(void) {
     signal(SIGPIPE, SIG_IGN); /* Ignore broken pipes */
 }
 
-int process_inbox(const ftn_config_t* config) {
-    ftn_processing_stats_t stats;
-    ftn_router_t* router = NULL;
-    ftn_storage_t* storage = NULL;
-    ftn_dupecheck_t* dupecheck = NULL;
-    const ftn_network_config_t* network;
-    int result = 0;
-    size_t i;
-
-    if (!config) {
-        log_error("Invalid configuration provided to process_inbox");
-        return -1;
-    }
-
-    init_processing_stats(&stats);
-    logf_info("Processing inbox for %lu configured networks", (unsigned long)config->network_count);
-
-    /* Initialize storage first */
-    storage = ftn_storage_new(config);
-    if (!storage) {
-        log_error("Failed to initialize storage");
-        return -1;
-    }
-
-    if (ftn_storage_initialize(storage) != FTN_OK) {
-        log_error("Failed to initialize storage");
-        ftn_storage_free(storage);
-        return -1;
-    }
-
-    /* Initialize duplicate checker - use first network's duplicate_db path */
-    if (config->network_count > 0 && config->networks[0].duplicate_db) {
-        dupecheck = ftn_dupecheck_new(config->networks[0].duplicate_db);
-    } else {
-        /* Use default path */
-        dupecheck = ftn_dupecheck_new("dupecheck.db");
-    }
 
-    if (!dupecheck) {
-        log_error("Failed to initialize duplicate checker");
-        ftn_storage_free(storage);
-        return -1;
-    }
+/* Toss every inbox, keeping the tosser and its databases between cycles */
+static int process_inbox(int time_budget, ftn_toss_stats_t* stats) {
+    int result = 0;
 
-    if (ftn_dupecheck_load(dupecheck) != FTN_OK) {
-        log_error("Failed to load duplicate database");
-        result = -1;
-        goto cleanup;
+    if (!global_tosser) {
+        global_tosser = ftn_tosser_new(global_config);
+        if (!global_tosser) {
+            log_error("Failed to initialize tosser");
+            return -1;
+        }
+        ftn_router_set_profiling(global_tosser->router, profile_rules);
     }
 
-    /* Initialize router with config and dupecheck */
-    router = ftn_router_new(config, dupecheck);
-    if (!router) {
-        log_error("Failed to initialize router");
+    if (ftn_tosser_process_inbox(global_tosser, time_budget, stats) != FTN_OK) {
         result = -1;
-        goto cleanup;
     }
-
-    /* Process each configured network */
-    for (i = 0; i < config->network_count; i++) {
-        network = &config->networks[i];
-        logf_debug("Processing network: %s", network->name);
-
-        if (process_network_inbox_enhanced(network, router, storage, dupecheck, &stats) != 0) {
-            logf_error("Error processing network: %s", network->name);
-            result = -1;
-            /* Continue processing other networks */
-        }
-    }
-
-    stats.processing_end_time = time(NULL);
-    print_processing_stats(&stats);
-
-cleanup:
-    if (dupecheck) ftn_dupecheck_free(dupecheck);
-    if (storage) ftn_storage_free(storage);
-    if (router) ftn_router_free(router);
-
+    ftn_tosser_flush(global_tosser);
     return result;
 }
 
-
 int run_single_shot(void) {
+    ftn_toss_stats_t stats;
+
     log_info("Running in single-shot mode");
 
-    if (process_inbox(global_config) != 0) {
+    /* Single-shot runs always drain the inbox completely */
+    ftn_toss_stats_init(&stats);
+    if (process_inbox(0, &stats) != 0) {
         log_error("Error processing inbox");
         return -1;
     }
@@ -469,12 +424,13 @@ static int run_daemon_loop(int sleep_interval) {
     ftn_stats_init();
 
     while (!shutdown_requested) {
-        ftn_processing_stats_t stats;
-        init_processing_stats(&stats);
+        ftn_toss_stats_t stats;
+        int time_budget = global_config->daemon ? global_config->daemon->toss_budget : 0;
+        ftn_toss_stats_init(&stats);
 
         log_debug("Starting processing cycle");
 
-        if (process_inbox(global_config) != 0) {
+        if (process_inbox(time_budget, &stats) != 0) {
             log_error("Error processing inbox, continuing");
         }
 
@@ -497,6 +453,13 @@ static int run_daemon_loop(int sleep_interval) {
             toggle_debug_requested = 0;
         }
 
+        /* Work through a deferred backlog without waiting */
+        if (stats.packets_deferred > 0) {
+            logf_debug("Processing cycle complete, %lu packets deferred, continuing immediately",
+                       (unsigned long)stats.packets_deferred);
+            continue;
+        }
+
         logf_debug("Processing cycle complete, sleeping for %d seconds", sleep_interval);
         for (i = 0; i < sleep_interval && !shutdown_requested; i++) {
             sleep(1);
@@ -507,343 +470,6 @@ static int run_daemon_loop(int sleep_interval) {
     return 0;
 }
 
-/* Initialize processing statistics */
-static void init_processing_stats(ftn_processing_stats_t* stats) {
-    if (!stats) return;
-
-    memset(stats, 0, sizeof(ftn_processing_stats_t));
-    stats->processing_start_time = time(NULL);
-}
-
-/* Print processing statistics */
-static void print_processing_stats(const ftn_processing_stats_t* stats) {
-    double elapsed_time;
-
-    if (!stats) return;
-
-    elapsed_time = difftime(stats->processing_end_time, stats->processing_start_time);
-
-    log_info("Processing Statistics:");
-    logf_info("  Packets processed: %lu", (unsigned long)stats->packets_processed);
-    logf_info("  Messages processed: %lu", (unsigned long)stats->messages_processed);
-    logf_info("  Duplicates found: %lu", (unsigned long)stats->duplicates_found);
-    logf_info("  Messages stored: %lu", (unsigned long)stats->messages_stored);
-    logf_info("  Messages forwarded: %lu", (unsigned long)stats->messages_forwarded);
-    logf_info("  Errors encountered: %lu", (unsigned long)stats->errors_encountered);
-    logf_info("  Processing time: %.2f seconds", elapsed_time);
-}
-
-/* Ensure required directories exist */
-static ftn_error_t ensure_directories_exist(const ftn_network_config_t* network) {
-    struct stat st;
-
-    if (!network) {
-        return FTN_ERROR_INVALID;
-    }
-
-    /* Create inbox directory */
-    if (network->inbox) {
-        if (stat(network->inbox, &st) != 0) {
-            if (mkdir(network->inbox, 0755) != 0) {
-                logf_error("Failed to create inbox directory: %s", network->inbox);
-                return FTN_ERROR_FILE;
-            }
-            logf_debug("Created inbox directory: %s", network->inbox);
-        }
-    }
-
-    /* Create outbox directory */
-    if (network->outbox) {
-        if (stat(network->outbox, &st) != 0) {
-            if (mkdir(network->outbox, 0755) != 0) {
-                logf_error("Failed to create outbox directory: %s", network->outbox);
-                return FTN_ERROR_FILE;
-            }
-            logf_debug("Created outbox directory: %s", network->outbox);
-        }
-    }
-
-    /* Create processed directory */
-    if (network->processed) {
-        if (stat(network->processed, &st) != 0) {
-            if (mkdir(network->processed, 0755) != 0) {
-                logf_error("Failed to create processed directory: %s", network->processed);
-                return FTN_ERROR_FILE;
-            }
-            logf_debug("Created processed directory: %s", network->processed);
-        }
-    }
-
-    /* Create bad directory */
-    if (network->bad) {
-        if (stat(network->bad, &st) != 0) {
-            if (mkdir(network->bad, 0755) != 0) {
-                logf_error("Failed to create bad directory: %s", network->bad);
-                return FTN_ERROR_FILE;
-            }
-            logf_debug("Created bad directory: %s", network->bad);
-        }
-    }
-
-    return FTN_OK;
-}
-
-/* Move packet to processed directory */
-static ftn_error_t move_packet_to_processed(const char* packet_path, const char* processed_dir) {
-    char dest_path[512];
-    const char* filename;
-
-    if (!packet_path || !processed_dir) {
-        return FTN_ERROR_INVALID;
-    }
-
-    filename = strrchr(packet_path, '/');
-    if (filename) {
-        filename++; /* Skip the '/' */
-    } else {
-        filename = packet_path;
-    }
-
-    snprintf(dest_path, sizeof(dest_path), "%s/%s", processed_dir, filename);
-
-    if (rename(packet_path, dest_path) != 0) {
-        logf_error("Failed to move packet %s to processed directory: %s", packet_path, strerror(errno));
-        return FTN_ERROR_FILE;
-    }
-
-    logf_debug("Moved packet to processed: %s -> %s", packet_path, dest_path);
-    return FTN_OK;
-}
-
-/* Move packet to bad directory */
-static ftn_error_t move_packet_to_bad(const char* packet_path, const char* bad_dir) {
-    char dest_path[512];
-    const char* filename;
-
-    if (!packet_path || !bad_dir) {
-        return FTN_ERROR_INVALID;
-    }
-
-    filename = strrchr(packet_path, '/');
-    if (filename) {
-        filename++; /* Skip the '/' */
-    } else {
-        filename = packet_path;
-    }
-
-    snprintf(dest_path, sizeof(dest_path), "%s/%s", bad_dir, filename);
-
-    if (rename(packet_path, dest_path) != 0) {
-        logf_error("Failed to move packet %s to bad directory: %s", packet_path, strerror(errno));
-        return FTN_ERROR_FILE;
-    }
-
-    logf_debug("Moved packet to bad: %s -> %s", packet_path, dest_path);
-    return FTN_OK;
-}
-
-/* Process a single message */
-static ftn_error_t process_message(const ftn_message_t* msg, const ftn_network_config_t* network,
-                                  ftn_router_t* router, ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
-                                  ftn_processing_stats_t* stats) {
-    ftn_routing_decision_t decision;
-    ftn_error_t error;
-    int is_duplicate;
-
-    if (!msg || !network || !router || !storage || !dupecheck || !stats) {
-        return FTN_ERROR_INVALID;
-    }
-
-    stats->messages_processed++;
-
-    /* Check for duplicates */
-    error = ftn_dupecheck_is_duplicate(dupecheck, msg, &is_duplicate);
-    if (error != FTN_OK) {
-        log_error("Duplicate check failed for message");
-        stats->errors_encountered++;
-        return FTN_ERROR_INVALID;
-    }
-
-    if (is_duplicate) {
-        logf_debug("Skipping duplicate message: %s", msg->msgid ? msg->msgid : "no-msgid");
-        stats->duplicates_found++;
-        return FTN_OK;
-    }
-
-    /* Add to duplicate database */
-    error = ftn_dupecheck_add_message(dupecheck, msg);
-    if (error != FTN_OK) {
-        log_error("Failed to add message to duplicate database");
-        /* Continue processing - this is not fatal */
-    }
-
-    /* Determine routing */
-    error = ftn_router_route_message(router, msg, &decision);
-    if (error != FTN_OK) {
-        log_error("Routing failed for message");
-        stats->errors_encountered++;
-        return FTN_ERROR_INVALID;
-    }
-
-    /* Store message based on routing decision */
-    switch (decision.action) {
-        case FTN_ROUTE_LOCAL_MAIL:
-            error = ftn_storage_store_mail(storage, msg, decision.destination_user, network->name);
-            if (error == FTN_OK) {
-                stats->messages_stored++;
-                logf_debug("Stored netmail for user: %s", decision.destination_user);
-            } else {
-                logf_error("Failed to store netmail for user: %s", decision.destination_user);
-                stats->errors_encountered++;
-                return FTN_ERROR_INVALID;
-            }
-            break;
-
-        case FTN_ROUTE_LOCAL_NEWS:
-            error = ftn_storage_store_news(storage, msg, decision.destination_area, network->name);
-            if (error == FTN_OK) {
-                stats->messages_stored++;
-                logf_debug("Stored echomail for area: %s", decision.destination_area);
-            } else {
-                logf_error("Failed to store echomail for area: %s", decision.destination_area);
-                stats->errors_encountered++;
-                return FTN_ERROR_INVALID;
-            }
-            break;
-
-        case FTN_ROUTE_FORWARD:
-            /* TODO: Implement forwarding queue */
-            stats->messages_forwarded++;
-            {
-                char addr_str[64];
-                ftn_address_to_string(&decision.forward_to, addr_str, sizeof(addr_str));
-                logf_debug("Message marked for forwarding to %s", addr_str);
-            }
-            break;
-
-        case FTN_ROUTE_DROP:
-            logf_debug("Dropping message per routing rules: %s", msg->msgid ? msg->msgid : "no-msgid");
-            break;
-
-        default:
-            logf_error("Invalid routing action: %d", decision.action);
-            stats->errors_encountered++;
-            return FTN_ERROR_INVALID;
-    }
-
-    return FTN_OK;
-}
-
-/* Process a single packet file */
-static ftn_error_t process_single_packet(const char* packet_path, const ftn_network_config_t* network,
-                                        ftn_router_t* router, ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
-                                        ftn_processing_stats_t* stats) {
-    ftn_packet_t* packet = NULL;
-    ftn_error_t error;
-    size_t i;
-
-    if (!packet_path || !network || !router || !storage || !dupecheck || !stats) {
-        return FTN_ERROR_INVALID;
-    }
-
-    logf_debug("Processing packet: %s", packet_path);
-
-    /* Load packet */
-    error = ftn_packet_load(packet_path, &packet);
-    if (error != FTN_OK) {
-        logf_error("Failed to load packet: %s", packet_path);
-        stats->errors_encountered++;
-
-        /* Move to bad directory */
-        if (network->bad) {
-            move_packet_to_bad(packet_path, network->bad);
-        }
-        return FTN_ERROR_PARSE;
-    }
-
-    stats->packets_processed++;
-    logf_debug("Loaded packet with %lu messages", (unsigned long)packet->message_count);
-
-    /* Process each message in the packet */
-    for (i = 0; i < packet->message_count; i++) {
-        error = process_message(packet->messages[i], network, router, storage, dupecheck, stats);
-        if (error != FTN_OK) {
-            logf_error("Error processing message %lu in packet %s", (unsigned long)(i + 1), packet_path);
-            /* Continue processing other messages */
-        }
-    }
-
-    /* Move packet to processed directory */
-    if (network->processed) {
-        error = move_packet_to_processed(packet_path, network->processed);
-        if (error != FTN_OK) {
-            logf_error("Failed to move processed packet: %s", packet_path);
-            /* Not fatal - packet was processed successfully */
-        }
-    }
-
-    ftn_packet_free(packet);
-    return FTN_OK;
-}
-
-/* Process network inbox */
-static int process_network_inbox_enhanced(const ftn_network_config_t* network, ftn_router_t* router,
-                                         ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
-                                         ftn_processing_stats_t* stats) {
-    DIR* dir;
-    struct dirent* entry;
-    char packet_path[512];
-    int result = 0;
-
-    if (!network || !router || !storage || !dupecheck || !stats) {
-        log_error("Invalid parameters to process_network_inbox_enhanced");
-        return -1;
-    }
-
-    logf_info("Processing inbox for network: %s", network->name);
-
-    /* Ensure directories exist */
-    if (ensure_directories_exist(network) != FTN_OK) {
-        logf_error("Failed to ensure directories exist for network: %s", network->name);
-        return -1;
-    }
-
-    if (!network->inbox) {
-        logf_error("No inbox path configured for network: %s", network->name);
-        return -1;
-    }
-
-    /* Open inbox directory */
-    dir = opendir(network->inbox);
-    if (!dir) {
-        logf_error("Failed to open inbox directory: %s", network->inbox);
-        return -1;
-    }
-
-    /* Process each .pkt file */
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] == '.') {
-            continue; /* Skip hidden files and . .. */
-        }
-
-        /* Check if it's a packet file */
-        if (strlen(entry->d_name) > 4 &&
-            strcasecmp(entry->d_name + strlen(entry->d_name) - 4, ".pkt") == 0) {
-
-            snprintf(packet_path, sizeof(packet_path), "%s/%s", network->inbox, entry->d_name);
-
-            if (process_single_packet(packet_path, network, router, storage, dupecheck, stats) != FTN_OK) {
-                logf_error("Error processing packet: %s", packet_path);
-                result = -1;
-                /* Continue processing other packets */
-            }
-        }
-    }
-
-    closedir(dir);
-    return result;
-}
-
 int main(int argc, char* argv[]) {
     int sleep_interval = 60;
     int result = 0;
@@ -873,6 +499,8 @@ int main(int argc, char* argv[]) {
             }
         } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
             verbose_mode = 1;
+        } else if (strcmp(argv[i], "--profile-rules") == 0) {
+            profile_rules = 1;
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             print_usage(argv[0]);
             return 0;
@@ -962,7 +590,10 @@ int main(int argc, char* argv[]) {
     if (daemon_mode && global_config && global_config->daemon) {
         remove_pid_file(global_config->daemon->pid_file);
     }
+    ftn_stats_report_rules();
+    ftn_tosser_free(global_tosser);
     ftn_config_free(global_config);
+    ftn_intern_cleanup();
     log_info("FTN Tosser shutting down");
     ftn_log_cleanup();
 
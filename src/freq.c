@@ -0,0 +1,642 @@
+/*
+ * freq.c - File request (FREQ) service for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/freq.h"
+#include "ftn/flow.h"
+#include "ftn/log.h"
+
+/* BSO address layout used by the flow API */
+struct ftn_address {
+    int zone;
+    int net;
+    int node;
+    int point;
+    char* domain;
+};
+
+#define INDEX_VERSION_STRING   "# libFTN FREQ Index v1.0"
+#define INITIAL_CAPACITY       16
+#define MAX_LINE_LENGTH        4096
+
+static char* ftn_freq_strdup(const char* str) {
+    char* result;
+    if (!str) return NULL;
+
+    result = malloc(strlen(str) + 1);
+    if (result) {
+        strcpy(result, str);
+    }
+    return result;
+}
+
+static char* ftn_freq_strdup_upper(const char* str) {
+    char* result;
+    char* p;
+
+    result = ftn_freq_strdup(str);
+    if (!result) return NULL;
+
+    for (p = result; *p; p++) {
+        *p = (char)toupper((unsigned char)*p);
+    }
+    return result;
+}
+
+static void ftn_freq_file_free(ftn_freq_file_t* file) {
+    free(file->name);
+    free(file->key);
+    free(file->path);
+}
+
+static int ftn_freq_file_compare(const void* a, const void* b) {
+    const ftn_freq_file_t* fa = (const ftn_freq_file_t*)a;
+    const ftn_freq_file_t* fb = (const ftn_freq_file_t*)b;
+    return strcmp(fa->key, fb->key);
+}
+
+/* Append an entry to a file array, taking a copy of the strings */
+static ftn_error_t ftn_freq_file_append(ftn_freq_file_t** files, size_t* count, size_t* capacity,
+                                        const char* name, const char* path, unsigned long size,
+                                        time_t mtime, size_t dir) {
+    ftn_freq_file_t* grown;
+    ftn_freq_file_t* file;
+    size_t new_capacity;
+
+    if (*count >= *capacity) {
+        new_capacity = *capacity ? *capacity * 2 : INITIAL_CAPACITY;
+        grown = realloc(*files, new_capacity * sizeof(ftn_freq_file_t));
+        if (!grown) return FTN_ERROR_NOMEM;
+        *files = grown;
+        *capacity = new_capacity;
+    }
+
+    file = &(*files)[*count];
+    memset(file, 0, sizeof(ftn_freq_file_t));
+    file->name = ftn_freq_strdup(name);
+    file->key = ftn_freq_strdup_upper(name);
+    file->path = ftn_freq_strdup(path);
+    if (!file->name || !file->key || !file->path) {
+        ftn_freq_file_free(file);
+        return FTN_ERROR_NOMEM;
+    }
+    file->size = size;
+    file->mtime = mtime;
+    file->dir = dir;
+    (*count)++;
+    return FTN_OK;
+}
+
+static ftn_error_t ftn_freq_add_file(ftn_freq_index_t* index, size_t dir, const char* name,
+                                     unsigned long size, time_t mtime) {
+    char path[MAX_LINE_LENGTH];
+
+    snprintf(path, sizeof(path), "%s/%s", index->dirs[dir].path, name);
+    return ftn_freq_file_append(&index->files, &index->file_count, &index->file_capacity,
+                                name, path, size, mtime, dir);
+}
+
+/* Drop every indexed file that belongs to a directory */
+static void ftn_freq_remove_dir_files(ftn_freq_index_t* index, size_t dir) {
+    size_t i, kept = 0;
+
+    for (i = 0; i < index->file_count; i++) {
+        if (index->files[i].dir == dir) {
+            ftn_freq_file_free(&index->files[i]);
+        } else {
+            index->files[kept++] = index->files[i];
+        }
+    }
+    index->file_count = kept;
+}
+
+ftn_freq_index_t* ftn_freq_index_new(const char* index_path) {
+    ftn_freq_index_t* index;
+
+    index = malloc(sizeof(ftn_freq_index_t));
+    if (!index) return NULL;
+
+    memset(index, 0, sizeof(ftn_freq_index_t));
+    if (index_path) {
+        index->index_path = ftn_freq_strdup(index_path);
+        if (!index->index_path) {
+            free(index);
+            return NULL;
+        }
+    }
+    return index;
+}
+
+void ftn_freq_index_free(ftn_freq_index_t* index) {
+    size_t i;
+
+    if (!index) return;
+
+    for (i = 0; i < index->dir_count; i++) {
+        free(index->dirs[i].path);
+    }
+    for (i = 0; i < index->file_count; i++) {
+        ftn_freq_file_free(&index->files[i]);
+    }
+    for (i = 0; i < index->magic_count; i++) {
+        ftn_freq_file_free(&index->magic[i]);
+    }
+    free(index->dirs);
+    free(index->files);
+    free(index->magic);
+    free(index->index_path);
+    free(index);
+}
+
+ftn_error_t ftn_freq_index_add_dir(ftn_freq_index_t* index, const char* path) {
+    ftn_freq_dir_t* grown;
+    size_t new_capacity;
+    size_t len;
+    size_t i;
+
+    if (!index || !path || !path[0]) return FTN_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < index->dir_count; i++) {
+        if (strcmp(index->dirs[i].path, path) == 0) return FTN_OK;
+    }
+
+    if (index->dir_count >= index->dir_capacity) {
+        new_capacity = index->dir_capacity ? index->dir_capacity * 2 : INITIAL_CAPACITY;
+        grown = realloc(index->dirs, new_capacity * sizeof(ftn_freq_dir_t));
+        if (!grown) return FTN_ERROR_NOMEM;
+        index->dirs = grown;
+        index->dir_capacity = new_capacity;
+    }
+
+    index->dirs[index->dir_count].path = ftn_freq_strdup(path);
+    if (!index->dirs[index->dir_count].path) return FTN_ERROR_NOMEM;
+
+    /* Strip trailing slashes so file paths and the saved index stay canonical */
+    len = strlen(index->dirs[index->dir_count].path);
+    while (len > 1 && index->dirs[index->dir_count].path[len - 1] == '/') {
+        index->dirs[index->dir_count].path[--len] = '\0';
+    }
+    index->dirs[index->dir_count].mtime = 0;
+    index->dir_count++;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_freq_index_add_magic(ftn_freq_index_t* index, const char* name, const char* path) {
+    if (!index || !name || !name[0] || !path || !path[0]) return FTN_ERROR_INVALID_PARAMETER;
+
+    return ftn_freq_file_append(&index->magic, &index->magic_count, &index->magic_capacity,
+                                name, path, 0, 0, 0);
+}
+
+ftn_error_t ftn_freq_index_load_magic(ftn_freq_index_t* index, const char* magic_file) {
+    FILE* fp;
+    char line[MAX_LINE_LENGTH];
+    char* name;
+    char* path;
+    ftn_error_t error = FTN_OK;
+
+    if (!index || !magic_file) return FTN_ERROR_INVALID_PARAMETER;
+
+    fp = fopen(magic_file, "r");
+    if (!fp) return FTN_ERROR_FILE;
+
+    /* One "NAME /path/to/file" pair per line */
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        ftn_trim(line);
+        if (line[0] == '#' || line[0] == ';' || line[0] == '\0') continue;
+
+        name = line;
+        path = name + strcspn(name, " \t");
+        if (*path == '\0') continue;
+        *path++ = '\0';
+        ftn_trim(path);
+        if (!path[0]) continue;
+
+        error = ftn_freq_index_add_magic(index, name, path);
+        if (error != FTN_OK) break;
+    }
+
+    fclose(fp);
+    return error;
+}
+
+ftn_error_t ftn_freq_index_load(ftn_freq_index_t* index) {
+    FILE* fp;
+    char line[MAX_LINE_LENGTH];
+    char* fields[5];
+    size_t* dir_map = NULL;
+    size_t map_count = 0;
+    size_t map_capacity = 0;
+    size_t* grown;
+    size_t field_count;
+    size_t saved_dir;
+    size_t i;
+    char* p;
+    ftn_error_t error = FTN_OK;
+
+    if (!index || !index->index_path) return FTN_ERROR_INVALID_PARAMETER;
+
+    fp = fopen(index->index_path, "r");
+    if (!fp) {
+        /* Index doesn't exist yet - the first update scans everything */
+        return FTN_OK;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0') continue;
+
+        /* The last field is a name or path and may itself contain '|' */
+        fields[0] = line;
+        field_count = 1;
+        p = line;
+        while (field_count < (strncmp(line, "dir|", 4) == 0 ? 3u : 5u) &&
+               (p = strchr(p, '|')) != NULL) {
+            *p++ = '\0';
+            fields[field_count++] = p;
+        }
+
+        if (strcmp(fields[0], "dir") == 0 && field_count == 3) {
+            /* Map the saved directory number to the configured one, if any */
+            if (map_count >= map_capacity) {
+                map_capacity = map_capacity ? map_capacity * 2 : INITIAL_CAPACITY;
+                grown = realloc(dir_map, map_capacity * sizeof(size_t));
+                if (!grown) {
+                    error = FTN_ERROR_NOMEM;
+                    break;
+                }
+                dir_map = grown;
+            }
+            dir_map[map_count] = index->dir_count;
+            for (i = 0; i < index->dir_count; i++) {
+                if (strcmp(index->dirs[i].path, fields[2]) == 0) {
+                    index->dirs[i].mtime = (time_t)strtol(fields[1], NULL, 10);
+                    dir_map[map_count] = i;
+                    break;
+                }
+            }
+            map_count++;
+        } else if (strcmp(fields[0], "file") == 0 && field_count == 5) {
+            saved_dir = (size_t)strtoul(fields[1], NULL, 10);
+            if (saved_dir >= map_count || dir_map[saved_dir] >= index->dir_count) continue;
+
+            error = ftn_freq_add_file(index, dir_map[saved_dir], fields[4],
+                                      strtoul(fields[2], NULL, 10),
+                                      (time_t)strtol(fields[3], NULL, 10));
+            if (error != FTN_OK) break;
+        }
+    }
+
+    fclose(fp);
+    free(dir_map);
+
+    if (index->file_count > 1) {
+        qsort(index->files, index->file_count, sizeof(ftn_freq_file_t), ftn_freq_file_compare);
+    }
+    index->modified = 0;
+    return error;
+}
+
+ftn_error_t ftn_freq_index_save(ftn_freq_index_t* index) {
+    FILE* fp;
+    char temp_path[1024];
+    size_t i;
+
+    if (!index || !index->index_path) return FTN_ERROR_INVALID_PARAMETER;
+    if (!index->modified) return FTN_OK;
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", index->index_path);
+    fp = fopen(temp_path, "w");
+    if (!fp) return FTN_ERROR_FILE;
+
+    fprintf(fp, "%s\n", INDEX_VERSION_STRING);
+
+    for (i = 0; i < index->dir_count; i++) {
+        fprintf(fp, "dir|%ld|%s\n", (long)index->dirs[i].mtime, index->dirs[i].path);
+    }
+    for (i = 0; i < index->file_count; i++) {
+        fprintf(fp, "file|%lu|%lu|%ld|%s\n", (unsigned long)index->files[i].dir,
+                index->files[i].size, (long)index->files[i].mtime, index->files[i].name);
+    }
+
+    if (fclose(fp) != 0 || rename(temp_path, index->index_path) != 0) {
+        remove(temp_path);
+        return FTN_ERROR_FILE;
+    }
+
+    index->modified = 0;
+    return FTN_OK;
+}
+
+/* Re-read one directory's listing into the index */
+static ftn_error_t ftn_freq_scan_dir(ftn_freq_index_t* index, size_t dir, time_t dir_mtime) {
+    DIR* d;
+    struct dirent* entry;
+    struct stat st;
+    char path[MAX_LINE_LENGTH];
+    ftn_error_t error = FTN_OK;
+    time_t now;
+
+    ftn_freq_remove_dir_files(index, dir);
+
+    d = opendir(index->dirs[dir].path);
+    if (!d) {
+        index->dirs[dir].mtime = 0;
+        return FTN_ERROR_FILE;
+    }
+
+    while ((entry = readdir(d)) != NULL && error == FTN_OK) {
+        if (entry->d_name[0] == '.') continue;
+
+        snprintf(path, sizeof(path), "%s/%s", index->dirs[dir].path, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+        error = ftn_freq_add_file(index, dir, entry->d_name, (unsigned long)st.st_size, st.st_mtime);
+    }
+    closedir(d);
+
+    /*
+     * Directory mtimes only have one-second resolution, so a listing taken
+     * in the same second the directory changed may already be stale.
+     * Leave such directories marked for another scan.
+     */
+    now = time(NULL);
+    index->dirs[dir].mtime = (dir_mtime >= now) ? 0 : dir_mtime;
+    return error;
+}
+
+ftn_error_t ftn_freq_index_update(ftn_freq_index_t* index, size_t* rescanned) {
+    struct stat st;
+    size_t count = 0;
+    size_t i;
+    ftn_error_t error = FTN_OK;
+
+    if (!index) return FTN_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < index->dir_count; i++) {
+        if (stat(index->dirs[i].path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+            if (index->dirs[i].mtime != 0) {
+                ftn_freq_remove_dir_files(index, i);
+                index->dirs[i].mtime = 0;
+                index->modified = 1;
+            }
+            logf_warning("File request directory not found: %s", index->dirs[i].path);
+            continue;
+        }
+
+        if (index->dirs[i].mtime != 0 && index->dirs[i].mtime == st.st_mtime) continue;
+
+        logf_debug("Indexing file request directory: %s", index->dirs[i].path);
+        if (ftn_freq_scan_dir(index, i, st.st_mtime) != FTN_OK) {
+            logf_error("Failed to index file request directory: %s", index->dirs[i].path);
+            error = FTN_ERROR_FILE;
+        }
+        index->modified = 1;
+        count++;
+    }
+
+    if (count > 0 && index->file_count > 1) {
+        qsort(index->files, index->file_count, sizeof(ftn_freq_file_t), ftn_freq_file_compare);
+    }
+
+    if (rescanned) *rescanned = count;
+    return error;
+}
+
+/* First file whose key sorts at or after the given prefix */
+static size_t ftn_freq_lower_bound(const ftn_freq_index_t* index, const char* prefix, size_t len) {
+    size_t low = 0;
+    size_t high = index->file_count;
+    size_t mid;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (strncmp(index->files[mid].key, prefix, len) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+size_t ftn_freq_resolve(const ftn_freq_index_t* index, const char* request,
+                        const ftn_freq_file_t** results, size_t max) {
+    char* upper;
+    size_t prefix_len;
+    size_t found = 0;
+    size_t i;
+    int wildcard;
+
+    if (!index || !request || !results || max == 0) return 0;
+
+    upper = ftn_freq_strdup_upper(request);
+    if (!upper) return 0;
+
+    /* Magic names take precedence over file names */
+    for (i = 0; i < index->magic_count; i++) {
+        if (strcmp(index->magic[i].key, upper) == 0) {
+            results[0] = &index->magic[i];
+            free(upper);
+            return 1;
+        }
+    }
+
+    /* Only keys sharing the literal prefix can match, and they are adjacent */
+    prefix_len = strcspn(upper, "*?[");
+    wildcard = upper[prefix_len] != '\0';
+
+    for (i = ftn_freq_lower_bound(index, upper, prefix_len);
+         i < index->file_count && found < max; i++) {
+        if (strncmp(index->files[i].key, upper, prefix_len) != 0) break;
+
+        if (wildcard ? fnmatch(upper, index->files[i].key, 0) == 0
+                     : strcmp(index->files[i].key, upper) == 0) {
+            results[found++] = &index->files[i];
+        }
+    }
+
+    free(upper);
+    return found;
+}
+
+ftn_freq_index_t* ftn_freq_index_open(const char* dirs, const char* index_path, const char* magic_file) {
+    ftn_freq_index_t* index;
+    char* list;
+    char* dir;
+    char* next;
+
+    if (!dirs) return NULL;
+
+    index = ftn_freq_index_new(index_path);
+    if (!index) return NULL;
+
+    list = ftn_freq_strdup(dirs);
+    if (!list) {
+        ftn_freq_index_free(index);
+        return NULL;
+    }
+
+    for (dir = list; dir; dir = next) {
+        next = strchr(dir, ',');
+        if (next) *next++ = '\0';
+        ftn_trim(dir);
+        if (dir[0] && ftn_freq_index_add_dir(index, dir) != FTN_OK) {
+            free(list);
+            ftn_freq_index_free(index);
+            return NULL;
+        }
+    }
+    free(list);
+
+    if (index_path && ftn_freq_index_load(index) != FTN_OK) {
+        logf_warning("Failed to load file request index: %s", index_path);
+    }
+    if (magic_file && ftn_freq_index_load_magic(index, magic_file) != FTN_OK) {
+        logf_warning("Failed to load file request magic names: %s", magic_file);
+    }
+
+    ftn_freq_index_update(index, NULL);
+    if (index_path && ftn_freq_index_save(index) != FTN_OK) {
+        logf_warning("Failed to save file request index: %s", index_path);
+    }
+    return index;
+}
+
+ftn_error_t ftn_freq_answer_request(const ftn_freq_index_t* index, const char* req_path, size_t limit,
+                                    ftn_freq_send_fn send, void* data, size_t* files_sent) {
+    FILE* fp;
+    char line[MAX_LINE_LENGTH];
+    char* name;
+    const ftn_freq_file_t** results;
+    struct stat st;
+    size_t sent = 0;
+    size_t matched;
+    size_t i;
+    ftn_error_t error = FTN_OK;
+
+    if (!index || !req_path || !send) return FTN_ERROR_INVALID_PARAMETER;
+    if (files_sent) *files_sent = 0;
+    if (limit == 0) limit = FTN_FREQ_DEFAULT_LIMIT;
+
+    results = malloc(limit * sizeof(const ftn_freq_file_t*));
+    if (!results) return FTN_ERROR_NOMEM;
+
+    fp = fopen(req_path, "r");
+    if (!fp) {
+        free(results);
+        return FTN_ERROR_FILE;
+    }
+
+    while (fgets(line, sizeof(line), fp) && sent < limit) {
+        /* "NAME [!password] [+time]" - only the name is used */
+        line[strcspn(line, "\r\n")] = '\0';
+        ftn_trim(line);
+        if (line[0] == ';' || line[0] == '\0') continue;
+
+        name = line;
+        name[strcspn(name, " \t")] = '\0';
+
+        matched = ftn_freq_resolve(index, name, results, limit - sent);
+        if (matched == 0) {
+            logf_info("File request for %s: not found", name);
+            continue;
+        }
+
+        for (i = 0; i < matched; i++) {
+            /* The index may be a cycle behind; never send a vanished file */
+            if (stat(results[i]->path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+            error = send(results[i], data);
+            if (error != FTN_OK) break;
+            logf_info("File request for %s: sending %s", name, results[i]->path);
+            sent++;
+        }
+        if (error != FTN_OK) break;
+    }
+
+    fclose(fp);
+    free(results);
+
+    if (files_sent) *files_sent = sent;
+    return error;
+}
+
+/* Hold .flo target for ftn_freq_process_request */
+typedef struct {
+    const char* outbound_path;
+    struct ftn_address addr;
+} freq_flow_target_t;
+
+static ftn_error_t freq_queue_flow(const ftn_freq_file_t* file, void* data) {
+    freq_flow_target_t* target = (freq_flow_target_t*)data;
+
+    if (ftn_flow_queue_reference(target->outbound_path, &target->addr, FLOW_FLAVOR_HOLD,
+                                 file->path, REF_DIRECTIVE_NONE) != BSO_OK) {
+        return FTN_ERROR_FILE;
+    }
+    return FTN_OK;
+}
+
+ftn_error_t ftn_freq_process_request(const ftn_freq_index_t* index, const char* req_path,
+                                     const char* outbound_path, const ftn_address_t* requester,
+                                     size_t limit, size_t* files_queued) {
+    freq_flow_target_t target;
+
+    if (!index || !req_path || !outbound_path || !requester) return FTN_ERROR_INVALID_PARAMETER;
+
+    memset(&target, 0, sizeof(target));
+    target.outbound_path = outbound_path;
+    target.addr.zone = (int)requester->zone;
+    target.addr.net = (int)requester->net;
+    target.addr.node = (int)requester->node;
+    target.addr.point = (int)requester->point;
+
+    return ftn_freq_answer_request(index, req_path, limit, freq_queue_flow, &target, files_queued);
+}
+
+int ftn_freq_is_request_name(const char* filename) {
+    size_t len;
+    const char* ext;
+
+    if (!filename) return 0;
+
+    len = strlen(filename);
+    if (len <= 4) return 0;
+
+    ext = filename + len - 4;
+    return ext[0] == '.' && toupper((unsigned char)ext[1]) == 'R' &&
+           toupper((unsigned char)ext[2]) == 'E' && toupper((unsigned char)ext[3]) == 'Q';
+}
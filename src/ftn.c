@@ -38,6 +38,7 @@ int ftn_address_parse(const char* str, ftn_address_t* addr) {
     char* net_str;
     char* node_str;
     char* point_str;
+    char* saveptr = NULL;
     
     if (!str || !addr) return 0;
     
@@ -49,28 +50,28 @@ int ftn_address_parse(const char* str, ftn_address_t* addr) {
     addr->node = 0;
     addr->point = 0;
     
-    zone_str = strtok(tmp, ":");
+    zone_str = strtok_r(tmp, ":", &saveptr);
     if (!zone_str) {
         free(tmp);
         return 0;
     }
     addr->zone = atoi(zone_str);
     
-    net_str = strtok(NULL, "/");
+    net_str = strtok_r(NULL, "/", &saveptr);
     if (!net_str) {
         free(tmp);
         return 0;
     }
     addr->net = atoi(net_str);
     
-    node_str = strtok(NULL, ".");
+    node_str = strtok_r(NULL, ".", &saveptr);
     if (!node_str) {
         free(tmp);
         return 0;
     }
     addr->node = atoi(node_str);
     
-    point_str = strtok(NULL, "");
+    point_str = strtok_r(NULL, "", &saveptr);
     if (point_str) {
         addr->point = atoi(point_str);
     }
@@ -0,0 +1,306 @@
+/*
+ * inbound.c - Inbound packet scheduling for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ftn.h"
+#include "ftn/inbound.h"
+
+/* Packet layout (FTS-0001) */
+#define INBOUND_PACKET_HEADER_SIZE   58
+#define INBOUND_MESSAGE_HEADER_SIZE  34   /* Fixed fields plus DateTime */
+#define INBOUND_MESSAGE_TYPE         0x0002
+
+/*
+ * Enough to cover the packet header, the message header, the three
+ * null-terminated header strings at their maximum lengths and the
+ * start of the message text.
+ */
+#define INBOUND_PEEK_SIZE            256
+
+#define INBOUND_INITIAL_CAPACITY     16
+
+static char* ftn_inbound_strdup(const char* str) {
+    char* result;
+    if (!str) return NULL;
+
+    result = malloc(strlen(str) + 1);
+    if (result) {
+        strcpy(result, str);
+    }
+    return result;
+}
+
+/* Queue lifecycle */
+ftn_inbound_queue_t* ftn_inbound_queue_new(void) {
+    ftn_inbound_queue_t* queue;
+
+    queue = malloc(sizeof(ftn_inbound_queue_t));
+    if (!queue) return NULL;
+
+    memset(queue, 0, sizeof(ftn_inbound_queue_t));
+    return queue;
+}
+
+void ftn_inbound_queue_clear(ftn_inbound_queue_t* queue) {
+    size_t i;
+
+    if (!queue) return;
+
+    for (i = 0; i < queue->count; i++) {
+        free(queue->entries[i].path);
+    }
+    queue->count = 0;
+}
+
+void ftn_inbound_queue_free(ftn_inbound_queue_t* queue) {
+    if (!queue) return;
+
+    ftn_inbound_queue_clear(queue);
+    free(queue->entries);
+    free(queue);
+}
+
+/* Queue operations */
+ftn_error_t ftn_inbound_queue_add(ftn_inbound_queue_t* queue, const char* path,
+                                  ftn_inbound_class_t pkt_class, long size,
+                                  time_t mtime, size_t source) {
+    ftn_inbound_entry_t* entry;
+
+    if (!queue || !path) return FTN_ERROR_INVALID_PARAMETER;
+
+    if (queue->count >= queue->capacity) {
+        size_t new_capacity = queue->capacity ? queue->capacity * 2 : INBOUND_INITIAL_CAPACITY;
+        ftn_inbound_entry_t* new_entries = realloc(queue->entries, new_capacity * sizeof(ftn_inbound_entry_t));
+        if (!new_entries) return FTN_ERROR_NOMEM;
+
+        queue->entries = new_entries;
+        queue->capacity = new_capacity;
+    }
+
+    entry = &queue->entries[queue->count];
+    entry->path = ftn_inbound_strdup(path);
+    if (!entry->path) return FTN_ERROR_NOMEM;
+
+    entry->pkt_class = pkt_class;
+    entry->size = size;
+    entry->mtime = mtime;
+    entry->source = source;
+    entry->prefetched = 0;
+    queue->count++;
+
+    return FTN_OK;
+}
+
+/* Netmail first, then smaller packets, then older packets */
+static int ftn_inbound_compare(const void* a, const void* b) {
+    const ftn_inbound_entry_t* ea = (const ftn_inbound_entry_t*)a;
+    const ftn_inbound_entry_t* eb = (const ftn_inbound_entry_t*)b;
+
+    if (ea->pkt_class != eb->pkt_class) {
+        return ea->pkt_class < eb->pkt_class ? -1 : 1;
+    }
+    if (ea->size != eb->size) {
+        return ea->size < eb->size ? -1 : 1;
+    }
+    if (ea->mtime != eb->mtime) {
+        return ea->mtime < eb->mtime ? -1 : 1;
+    }
+    return strcmp(ea->path, eb->path);
+}
+
+void ftn_inbound_queue_sort(ftn_inbound_queue_t* queue) {
+    if (!queue || queue->count < 2) return;
+
+    qsort(queue->entries, queue->count, sizeof(ftn_inbound_entry_t), ftn_inbound_compare);
+}
+
+ftn_error_t ftn_inbound_prefetch(ftn_inbound_queue_t* queue, size_t start, size_t depth) {
+    ftn_inbound_entry_t* entry;
+    size_t end;
+    size_t i;
+    int fd;
+
+    if (!queue) return FTN_ERROR_INVALID_PARAMETER;
+
+    end = start + depth;
+    if (end > queue->count) {
+        end = queue->count;
+    }
+
+    for (i = start; i < end; i++) {
+        entry = &queue->entries[i];
+        if (entry->prefetched) {
+            continue;
+        }
+        entry->prefetched = 1;
+
+        fd = open(entry->path, O_RDONLY);
+        if (fd < 0) {
+            continue; /* Reported when the packet is loaded */
+        }
+#ifdef POSIX_FADV_WILLNEED
+        /* Start reading the whole file into the page cache in the background */
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+        close(fd);
+    }
+
+    return FTN_OK;
+}
+
+/* Skip a null-terminated string, returning the offset after it or 0 */
+static size_t ftn_inbound_skip_string(const unsigned char* buffer, size_t pos, size_t len) {
+    while (pos < len && buffer[pos] != '\0') {
+        pos++;
+    }
+    return pos < len ? pos + 1 : 0;
+}
+
+ftn_error_t ftn_inbound_classify(const char* path, ftn_inbound_class_t* pkt_class) {
+    FILE* fp;
+    unsigned char buffer[INBOUND_PEEK_SIZE];
+    size_t len;
+    size_t pos;
+    unsigned int msg_type;
+    int i;
+
+    if (!path || !pkt_class) return FTN_ERROR_INVALID_PARAMETER;
+
+    *pkt_class = FTN_INBOUND_UNKNOWN;
+
+    fp = fopen(path, "rb");
+    if (!fp) return FTN_ERROR_FILE;
+
+    len = fread(buffer, 1, sizeof(buffer), fp);
+    fclose(fp);
+
+    if (len < INBOUND_PACKET_HEADER_SIZE + 2) {
+        return FTN_OK;
+    }
+
+    pos = INBOUND_PACKET_HEADER_SIZE;
+    msg_type = buffer[pos] | (buffer[pos + 1] << 8);
+
+    /* A packet with no messages is trivially cheap to toss */
+    if (msg_type == 0) {
+        *pkt_class = FTN_INBOUND_NETMAIL;
+        return FTN_OK;
+    }
+    if (msg_type != INBOUND_MESSAGE_TYPE) {
+        return FTN_OK;
+    }
+
+    pos += INBOUND_MESSAGE_HEADER_SIZE;
+    if (pos >= len) {
+        return FTN_OK;
+    }
+
+    /* Skip toUserName, fromUserName and subject */
+    for (i = 0; i < 3; i++) {
+        pos = ftn_inbound_skip_string(buffer, pos, len);
+        if (pos == 0) {
+            return FTN_OK;
+        }
+    }
+
+    /* Echomail text starts with the AREA: line */
+    while (pos < len && (buffer[pos] == ' ' || buffer[pos] == '\t')) {
+        pos++;
+    }
+    if (len - pos >= 5 && memcmp(buffer + pos, "AREA:", 5) == 0) {
+        *pkt_class = FTN_INBOUND_ECHOMAIL;
+    } else {
+        *pkt_class = FTN_INBOUND_NETMAIL;
+    }
+
+    return FTN_OK;
+}
+
+ftn_error_t ftn_inbound_scan(ftn_inbound_queue_t* queue, const char* inbox, size_t source) {
+    DIR* dir;
+    struct dirent* entry;
+    struct stat st;
+    char packet_path[512];
+    ftn_inbound_class_t pkt_class;
+    ftn_error_t error = FTN_OK;
+
+    if (!queue || !inbox) return FTN_ERROR_INVALID_PARAMETER;
+
+    dir = opendir(inbox);
+    if (!dir) return FTN_ERROR_FILE;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue; /* Skip hidden files and . .. */
+        }
+        if (!ftn_inbound_is_packet_name(entry->d_name)) {
+            continue;
+        }
+
+        snprintf(packet_path, sizeof(packet_path), "%s/%s", inbox, entry->d_name);
+
+        if (stat(packet_path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue; /* Vanished or not a regular file */
+        }
+
+        if (ftn_inbound_classify(packet_path, &pkt_class) != FTN_OK) {
+            pkt_class = FTN_INBOUND_UNKNOWN;
+        }
+
+        error = ftn_inbound_queue_add(queue, packet_path, pkt_class, (long)st.st_size, st.st_mtime, source);
+        if (error != FTN_OK) {
+            break;
+        }
+    }
+
+    closedir(dir);
+    return error;
+}
+
+/* Utility functions */
+int ftn_inbound_is_packet_name(const char* filename) {
+    size_t len;
+
+    if (!filename) return 0;
+
+    len = strlen(filename);
+    return len > 4 && strcasecmp(filename + len - 4, ".pkt") == 0;
+}
+
+const char* ftn_inbound_class_string(ftn_inbound_class_t pkt_class) {
+    switch (pkt_class) {
+        case FTN_INBOUND_NETMAIL: return "netmail";
+        case FTN_INBOUND_ECHOMAIL: return "echomail";
+        case FTN_INBOUND_UNKNOWN: return "unknown";
+        default: return "invalid";
+    }
+}
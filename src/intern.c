@@ -0,0 +1,334 @@
+/*
+ * intern.c - Name interning for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "ftn.h"
+#include "ftn/intern.h"
+#include "ftn/thread.h"
+
+#define INITIAL_CAPACITY  16
+#define INITIAL_BUCKETS   64
+
+/* Newsgroup name built for an area in one network */
+typedef struct ftn_intern_group {
+    ftn_intern_id_t network;
+    char* name;
+    struct ftn_intern_group* next;
+} ftn_intern_group_t;
+
+/* Interned name */
+typedef struct {
+    char* name;                       /* Name as first seen */
+    char* lower;                      /* Lower-case form, built on first use */
+    ftn_intern_group_t* newsgroups;   /* Cached newsgroup names (areas only) */
+    unsigned long hash;
+} ftn_intern_entry_t;
+
+/* Per-kind table; IDs are entry index + 1 */
+typedef struct {
+    ftn_intern_entry_t* entries;
+    size_t count;
+    size_t capacity;
+    ftn_intern_id_t* buckets;         /* Open-addressing index (0 = empty) */
+    size_t bucket_count;
+    int fold_case;
+} ftn_intern_table_t;
+
+static ftn_intern_table_t intern_tables[FTN_INTERN_KIND_COUNT] = {
+    { NULL, 0, 0, NULL, 0, 1 },       /* FTN_INTERN_AREA */
+    { NULL, 0, 0, NULL, 0, 0 },       /* FTN_INTERN_USER */
+    { NULL, 0, 0, NULL, 0, 0 }        /* FTN_INTERN_NETWORK */
+};
+
+/* Guards the tables; the strings handed out never move once built */
+static ftn_mutex_t intern_mutex = FTN_MUTEX_INITIALIZER;
+
+static char* ftn_intern_strdup(const char* str) {
+    char* result;
+    if (!str) return NULL;
+
+    result = malloc(strlen(str) + 1);
+    if (result) {
+        strcpy(result, str);
+    }
+    return result;
+}
+
+/* FNV-1a, optionally over the upper-cased name */
+static unsigned long ftn_intern_hash(const char* name, int fold_case) {
+    unsigned long hash = 2166136261UL;
+    unsigned char c;
+
+    while (*name) {
+        c = (unsigned char)*name++;
+        if (fold_case) c = (unsigned char)toupper(c);
+        hash ^= c;
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
+static ftn_intern_table_t* ftn_intern_table(ftn_intern_kind_t kind) {
+    if ((int)kind < 0 || kind >= FTN_INTERN_KIND_COUNT) return NULL;
+    return &intern_tables[kind];
+}
+
+static ftn_intern_entry_t* ftn_intern_entry(ftn_intern_kind_t kind, ftn_intern_id_t id) {
+    ftn_intern_table_t* table = ftn_intern_table(kind);
+
+    if (!table || id == FTN_INTERN_NONE || id > table->count) return NULL;
+    return &table->entries[id - 1];
+}
+
+static ftn_intern_id_t ftn_intern_lookup(const ftn_intern_table_t* table, const char* name,
+                                         unsigned long hash) {
+    size_t slot;
+    ftn_intern_id_t id;
+    const ftn_intern_entry_t* entry;
+
+    if (!table->bucket_count) return FTN_INTERN_NONE;
+
+    slot = hash & (table->bucket_count - 1);
+    while ((id = table->buckets[slot]) != FTN_INTERN_NONE) {
+        entry = &table->entries[id - 1];
+        if (entry->hash == hash &&
+            (table->fold_case ? strcasecmp(entry->name, name) : strcmp(entry->name, name)) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & (table->bucket_count - 1);
+    }
+    return FTN_INTERN_NONE;
+}
+
+static ftn_error_t ftn_intern_rehash(ftn_intern_table_t* table, size_t bucket_count) {
+    ftn_intern_id_t* buckets;
+    size_t i;
+    size_t slot;
+
+    buckets = calloc(bucket_count, sizeof(ftn_intern_id_t));
+    if (!buckets) return FTN_ERROR_NOMEM;
+
+    for (i = 0; i < table->count; i++) {
+        slot = table->entries[i].hash & (bucket_count - 1);
+        while (buckets[slot] != FTN_INTERN_NONE) {
+            slot = (slot + 1) & (bucket_count - 1);
+        }
+        buckets[slot] = (ftn_intern_id_t)(i + 1);
+    }
+
+    free(table->buckets);
+    table->buckets = buckets;
+    table->bucket_count = bucket_count;
+    return FTN_OK;
+}
+
+static ftn_intern_id_t ftn_intern_add(ftn_intern_table_t* table, const char* name) {
+    ftn_intern_entry_t* entry;
+    unsigned long hash;
+    ftn_intern_id_t id;
+    size_t slot;
+
+    hash = ftn_intern_hash(name, table->fold_case);
+    id = ftn_intern_lookup(table, name, hash);
+    if (id != FTN_INTERN_NONE) return id;
+    if (table->count >= FTN_INTERN_MAX_NAMES) return FTN_INTERN_NONE;
+
+    if (table->count >= table->capacity) {
+        size_t new_capacity = table->capacity ? table->capacity * 2 : INITIAL_CAPACITY;
+        ftn_intern_entry_t* new_entries = realloc(table->entries, new_capacity * sizeof(ftn_intern_entry_t));
+        if (!new_entries) return FTN_INTERN_NONE;
+
+        table->entries = new_entries;
+        table->capacity = new_capacity;
+    }
+
+    /* Keep the index at most half full */
+    if ((table->count + 1) * 2 > table->bucket_count) {
+        if (ftn_intern_rehash(table, table->bucket_count ? table->bucket_count * 2 : INITIAL_BUCKETS) != FTN_OK) {
+            return FTN_INTERN_NONE;
+        }
+    }
+
+    entry = &table->entries[table->count];
+    memset(entry, 0, sizeof(ftn_intern_entry_t));
+    entry->name = ftn_intern_strdup(name);
+    if (!entry->name) return FTN_INTERN_NONE;
+    entry->hash = hash;
+
+    id = (ftn_intern_id_t)(table->count + 1);
+    slot = hash & (table->bucket_count - 1);
+    while (table->buckets[slot] != FTN_INTERN_NONE) {
+        slot = (slot + 1) & (table->bucket_count - 1);
+    }
+    table->buckets[slot] = id;
+    table->count++;
+
+    return id;
+}
+
+static const char* ftn_intern_entry_lower(ftn_intern_entry_t* entry) {
+    char* p;
+
+    if (!entry) return NULL;
+
+    if (!entry->lower) {
+        entry->lower = ftn_intern_strdup(entry->name);
+        if (!entry->lower) return NULL;
+        for (p = entry->lower; *p; p++) {
+            *p = (char)tolower((unsigned char)*p);
+        }
+    }
+    return entry->lower;
+}
+
+static const char* ftn_intern_entry_newsgroup(ftn_intern_entry_t* area, ftn_intern_id_t network_id) {
+    ftn_intern_entry_t* network = ftn_intern_entry(FTN_INTERN_NETWORK, network_id);
+    ftn_intern_group_t* group;
+    const char* lower;
+    size_t len;
+
+    if (!area || !network) return NULL;
+
+    /* An area is almost always carried by a single network, so this list
+       is short; entries are kept until cleanup so callers can hold them */
+    for (group = area->newsgroups; group; group = group->next) {
+        if (group->network == network_id) return group->name;
+    }
+
+    lower = ftn_intern_entry_lower(area);
+    if (!lower) return NULL;
+
+    group = malloc(sizeof(ftn_intern_group_t));
+    if (!group) return NULL;
+    len = strlen(network->name) + 1 + strlen(lower) + 1;
+    group->name = malloc(len);
+    if (!group->name) {
+        free(group);
+        return NULL;
+    }
+
+    sprintf(group->name, "%s.%s", network->name, lower);
+    group->network = network_id;
+    group->next = area->newsgroups;
+    area->newsgroups = group;
+    return group->name;
+}
+
+ftn_intern_id_t ftn_intern(ftn_intern_kind_t kind, const char* name) {
+    ftn_intern_table_t* table = ftn_intern_table(kind);
+    ftn_intern_id_t id;
+
+    if (!table || !name) return FTN_INTERN_NONE;
+
+    ftn_mutex_lock(&intern_mutex);
+    id = ftn_intern_add(table, name);
+    ftn_mutex_unlock(&intern_mutex);
+    return id;
+}
+
+ftn_intern_id_t ftn_intern_find(ftn_intern_kind_t kind, const char* name) {
+    ftn_intern_table_t* table = ftn_intern_table(kind);
+    ftn_intern_id_t id;
+
+    if (!table || !name) return FTN_INTERN_NONE;
+
+    ftn_mutex_lock(&intern_mutex);
+    id = ftn_intern_lookup(table, name, ftn_intern_hash(name, table->fold_case));
+    ftn_mutex_unlock(&intern_mutex);
+    return id;
+}
+
+const char* ftn_intern_name(ftn_intern_kind_t kind, ftn_intern_id_t id) {
+    ftn_intern_entry_t* entry;
+    const char* name;
+
+    ftn_mutex_lock(&intern_mutex);
+    entry = ftn_intern_entry(kind, id);
+    name = entry ? entry->name : NULL;
+    ftn_mutex_unlock(&intern_mutex);
+    return name;
+}
+
+const char* ftn_intern_lower(ftn_intern_kind_t kind, ftn_intern_id_t id) {
+    const char* lower;
+
+    ftn_mutex_lock(&intern_mutex);
+    lower = ftn_intern_entry_lower(ftn_intern_entry(kind, id));
+    ftn_mutex_unlock(&intern_mutex);
+    return lower;
+}
+
+const char* ftn_intern_newsgroup(ftn_intern_id_t network_id, ftn_intern_id_t area_id) {
+    const char* newsgroup;
+
+    ftn_mutex_lock(&intern_mutex);
+    newsgroup = ftn_intern_entry_newsgroup(ftn_intern_entry(FTN_INTERN_AREA, area_id), network_id);
+    ftn_mutex_unlock(&intern_mutex);
+    return newsgroup;
+}
+
+size_t ftn_intern_count(ftn_intern_kind_t kind) {
+    ftn_intern_table_t* table = ftn_intern_table(kind);
+    size_t count;
+
+    if (!table) return 0;
+
+    ftn_mutex_lock(&intern_mutex);
+    count = table->count;
+    ftn_mutex_unlock(&intern_mutex);
+    return count;
+}
+
+void ftn_intern_cleanup(void) {
+    ftn_intern_table_t* table;
+    ftn_intern_group_t* group;
+    size_t i;
+    int kind;
+
+    ftn_mutex_lock(&intern_mutex);
+    for (kind = 0; kind < FTN_INTERN_KIND_COUNT; kind++) {
+        table = &intern_tables[kind];
+        for (i = 0; i < table->count; i++) {
+            free(table->entries[i].name);
+            free(table->entries[i].lower);
+            while (table->entries[i].newsgroups) {
+                group = table->entries[i].newsgroups;
+                table->entries[i].newsgroups = group->next;
+                free(group->name);
+                free(group);
+            }
+        }
+        free(table->entries);
+        free(table->buckets);
+        table->entries = NULL;
+        table->count = 0;
+        table->capacity = 0;
+        table->buckets = NULL;
+        table->bucket_count = 0;
+    }
+    ftn_mutex_unlock(&intern_mutex);
+}
@@ -0,0 +1,985 @@
+/*
+ * jam.c - JAM message base for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/jam.h"
+#include "ftn/binkp/crc.h"
+
+#define JAM_FILE_MODE (S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)
+#define JAM_NONE 0xFFFFFFFFUL
+#define JAM_INDEX_CHUNK 512
+
+/* Base header fields */
+#define JAM_BASE_CREATED 4
+#define JAM_BASE_MODCOUNTER 8
+#define JAM_BASE_ACTIVE 12
+#define JAM_BASE_PASSWORD 16
+#define JAM_BASE_FIRST 20
+
+/* Message header fields */
+#define JAM_HDR_REVISION 4
+#define JAM_HDR_SUBFIELDLEN 8
+#define JAM_HDR_MSGIDCRC 16
+#define JAM_HDR_REPLYCRC 20
+#define JAM_HDR_WRITTEN 36
+#define JAM_HDR_RECEIVED 40
+#define JAM_HDR_PROCESSED 44
+#define JAM_HDR_NUMBER 48
+#define JAM_HDR_ATTRIBUTE 52
+#define JAM_HDR_OFFSET 60
+#define JAM_HDR_TXTLEN 64
+#define JAM_HDR_PASSWORD 68
+#define JAM_HDR_COST 72
+
+/* FTS-0001 attribute bits and their JAM equivalents */
+static const struct {
+    unsigned int ftn;
+    unsigned long jam;
+} jam_attribute_map[] = {
+    { FTN_ATTR_PRIVATE, FTN_JAM_MSG_PRIVATE },
+    { FTN_ATTR_CRASH, FTN_JAM_MSG_CRASH },
+    { FTN_ATTR_RECD, FTN_JAM_MSG_READ },
+    { FTN_ATTR_SENT, FTN_JAM_MSG_SENT },
+    { FTN_ATTR_FILEATTACH, FTN_JAM_MSG_FILEATTACH },
+    { FTN_ATTR_INTRANSIT, FTN_JAM_MSG_INTRANSIT },
+    { FTN_ATTR_ORPHAN, FTN_JAM_MSG_ORPHAN },
+    { FTN_ATTR_KILLSENT, FTN_JAM_MSG_KILLSENT },
+    { FTN_ATTR_LOCAL, FTN_JAM_MSG_LOCAL },
+    { FTN_ATTR_HOLDFORPICKUP, FTN_JAM_MSG_HOLD },
+    { FTN_ATTR_FILEREQUEST, FTN_JAM_MSG_FILEREQUEST },
+    { FTN_ATTR_RETRECREQ, FTN_JAM_MSG_RECEIPTREQ }
+};
+
+#define JAM_ATTRIBUTE_COUNT (sizeof(jam_attribute_map) / sizeof(jam_attribute_map[0]))
+
+/* JAM files are little-endian */
+static void jam_put_u16(unsigned char* p, unsigned int value) {
+    p[0] = (unsigned char)(value & 0xFF);
+    p[1] = (unsigned char)((value >> 8) & 0xFF);
+}
+
+static void jam_put_u32(unsigned char* p, unsigned long value) {
+    p[0] = (unsigned char)(value & 0xFF);
+    p[1] = (unsigned char)((value >> 8) & 0xFF);
+    p[2] = (unsigned char)((value >> 16) & 0xFF);
+    p[3] = (unsigned char)((value >> 24) & 0xFF);
+}
+
+static unsigned int jam_get_u16(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+}
+
+static unsigned long jam_get_u32(const unsigned char* p) {
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static char* jam_strdup(const char* str) {
+    char* result = malloc(strlen(str) + 1);
+
+    if (result) {
+        strcpy(result, str);
+    }
+    return result;
+}
+
+static char* jam_file_path(const char* path, const char* ext) {
+    char* result = malloc(strlen(path) + strlen(ext) + 1);
+    if (result) {
+        sprintf(result, "%s%s", path, ext);
+    }
+    return result;
+}
+
+static int jam_open_file(const char* path, const char* ext, int flags) {
+    char* file_path = jam_file_path(path, ext);
+    int fd;
+
+    if (!file_path) {
+        return -1;
+    }
+    fd = open(file_path, flags, JAM_FILE_MODE);
+    free(file_path);
+    return fd;
+}
+
+/* Lock or unlock the base. JAM software locks the first byte of .jhr. */
+static int jam_lock(int fd, int type) {
+    struct flock fl;
+
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = (short)type;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = 0;
+    fl.l_len = 1;
+    while (fcntl(fd, F_SETLKW, &fl) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int jam_pread_all(int fd, void* buf, size_t len, off_t offset) {
+    unsigned char* p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+        n = pread(fd, p, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+static int jam_pwrite_all(int fd, const void* buf, size_t len, off_t offset) {
+    const unsigned char* p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+        n = pwrite(fd, p, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+static int jam_reserve(unsigned char** buf, size_t* capacity, size_t needed) {
+    unsigned char* grown;
+    size_t new_capacity;
+
+    if (needed <= *capacity) {
+        return 0;
+    }
+    new_capacity = *capacity ? *capacity : 4096;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    grown = realloc(*buf, new_capacity);
+    if (!grown) {
+        return -1;
+    }
+    *buf = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+uint32_t ftn_jam_crc(const char* str) {
+    unsigned char chunk[64];
+    uint32_t crc = 0xFFFFFFFFUL;
+    size_t len;
+
+    if (!str) {
+        return crc;
+    }
+    while (*str) {
+        for (len = 0; len < sizeof(chunk) && str[len]; len++) {
+            chunk[len] = (unsigned char)tolower((unsigned char)str[len]);
+        }
+        crc = ftn_crc32_update(crc, chunk, len);
+        str += len;
+    }
+    return crc;
+}
+
+/* Write a fresh base header into a new, empty .jhr */
+static int jam_init_header(int fd) {
+    unsigned char header[FTN_JAM_HEADER_SIZE];
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, "JAM", 4);
+    jam_put_u32(header + JAM_BASE_CREATED, (unsigned long)time(NULL));
+    jam_put_u32(header + JAM_BASE_PASSWORD, JAM_NONE);
+    jam_put_u32(header + JAM_BASE_FIRST, 1);
+    return jam_pwrite_all(fd, header, sizeof(header), 0);
+}
+
+static ftn_error_t jam_read_base_header(int fd, unsigned char* header) {
+    if (jam_pread_all(fd, header, FTN_JAM_HEADER_SIZE, 0) != 0 ||
+        memcmp(header, "JAM", 4) != 0) {
+        return FTN_ERROR_INVALID_FORMAT;
+    }
+    return FTN_OK;
+}
+
+/* Create any missing files of a base */
+static ftn_error_t jam_create(const char* path) {
+    static const char* const others[] = { ".jdt", ".jdx", ".jlr" };
+    struct stat st;
+    ftn_error_t result = FTN_OK;
+    size_t i;
+    int fd;
+
+    fd = jam_open_file(path, ".jhr", O_RDWR | O_CREAT);
+    if (fd < 0) {
+        return FTN_ERROR_FILE;
+    }
+    if (jam_lock(fd, F_WRLCK) != 0 || fstat(fd, &st) != 0) {
+        close(fd);
+        return FTN_ERROR_FILE;
+    }
+    if (st.st_size == 0) {
+        if (jam_init_header(fd) != 0) {
+            result = FTN_ERROR_FILE;
+        }
+    } else if (st.st_size < FTN_JAM_HEADER_SIZE) {
+        result = FTN_ERROR_INVALID_FORMAT;
+    }
+    jam_lock(fd, F_UNLCK);
+    close(fd);
+
+    for (i = 0; result == FTN_OK && i < sizeof(others) / sizeof(others[0]); i++) {
+        fd = jam_open_file(path, others[i], O_WRONLY | O_CREAT);
+        if (fd < 0) {
+            result = FTN_ERROR_FILE;
+        } else {
+            close(fd);
+        }
+    }
+    return result;
+}
+
+ftn_jam_base_t* ftn_jam_open(const char* path, size_t batch_size) {
+    ftn_jam_base_t* base;
+
+    if (!path) {
+        return NULL;
+    }
+
+    base = malloc(sizeof(ftn_jam_base_t));
+    if (!base) {
+        return NULL;
+    }
+    memset(base, 0, sizeof(ftn_jam_base_t));
+    base->batch_size = batch_size > 0 ? batch_size : FTN_JAM_DEFAULT_BATCH;
+    base->path = jam_strdup(path);
+    if (!base->path || jam_create(path) != FTN_OK) {
+        free(base->path);
+        free(base);
+        return NULL;
+    }
+    return base;
+}
+
+ftn_error_t ftn_jam_close(ftn_jam_base_t* base) {
+    ftn_error_t result;
+
+    if (!base) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    result = ftn_jam_flush(base);
+    free(base->path);
+    free(base->headers);
+    free(base->text);
+    free(base->pending);
+    free(base);
+    return result;
+}
+
+static int jam_add_subfield(ftn_jam_base_t* base, unsigned int id, const char* value) {
+    unsigned char* p;
+    size_t len;
+
+    if (!value) {
+        return 0;
+    }
+    len = strlen(value);
+    if (jam_reserve(&base->headers, &base->headers_capacity, base->headers_len + 8 + len) != 0) {
+        return -1;
+    }
+    p = base->headers + base->headers_len;
+    jam_put_u16(p, id);
+    jam_put_u16(p + 2, 0);
+    jam_put_u32(p + 4, (unsigned long)len);
+    memcpy(p + 8, value, len);
+    base->headers_len += 8 + len;
+    return 0;
+}
+
+/* Kludge values without the leading blanks the packet parser leaves on them */
+static const char* jam_skip_blanks(const char* value) {
+    while (value && (*value == ' ' || *value == '\t')) {
+        value++;
+    }
+    return value;
+}
+
+static int jam_add_kludges(ftn_jam_base_t* base, const ftn_message_t* msg) {
+    char address[64];
+    const char* line;
+    size_t i;
+
+    ftn_address_to_string(&msg->orig_addr, address, sizeof(address));
+    if (jam_add_subfield(base, FTN_JAM_OADDRESS, address) != 0) {
+        return -1;
+    }
+    if (msg->type == FTN_MSG_NETMAIL) {
+        ftn_address_to_string(&msg->dest_addr, address, sizeof(address));
+        if (jam_add_subfield(base, FTN_JAM_DADDRESS, address) != 0) {
+            return -1;
+        }
+    }
+    if (jam_add_subfield(base, FTN_JAM_SENDERNAME, msg->from_user) != 0 ||
+        jam_add_subfield(base, FTN_JAM_RECEIVERNAME, msg->to_user) != 0 ||
+        jam_add_subfield(base, FTN_JAM_SUBJECT, msg->subject) != 0 ||
+        jam_add_subfield(base, FTN_JAM_MSGID, msg->msgid) != 0 ||
+        jam_add_subfield(base, FTN_JAM_REPLYID, msg->reply) != 0 ||
+        jam_add_subfield(base, FTN_JAM_TZUTCINFO, msg->tzutc) != 0) {
+        return -1;
+    }
+
+    for (i = 0; i < msg->control_count; i++) {
+        line = msg->control_lines[i];
+        if (!line) {
+            continue;
+        }
+        if (strncmp(line, "PID:", 4) == 0) {
+            if (jam_add_subfield(base, FTN_JAM_PID, jam_skip_blanks(line + 4)) != 0) {
+                return -1;
+            }
+        } else if (jam_add_subfield(base, FTN_JAM_FTSKLUDGE, line) != 0) {
+            return -1;
+        }
+    }
+    for (i = 0; i < msg->seenby_count; i++) {
+        if (jam_add_subfield(base, FTN_JAM_SEENBY2D, jam_skip_blanks(msg->seenby[i])) != 0) {
+            return -1;
+        }
+    }
+    for (i = 0; i < msg->path_count; i++) {
+        if (jam_add_subfield(base, FTN_JAM_PATH2D, jam_skip_blanks(msg->path[i])) != 0) {
+            return -1;
+        }
+    }
+    for (i = 0; i < msg->via_count; i++) {
+        if (msg->via_lines[i] && strncmp(msg->via_lines[i], "Via ", 4) == 0 &&
+            jam_add_subfield(base, FTN_JAM_TRACE, msg->via_lines[i] + 4) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Append one line of text, with JAM's CR line endings */
+static int jam_add_text(ftn_jam_base_t* base, const char* text) {
+    unsigned char* out;
+    const char* p;
+
+    if (!text) {
+        return 0;
+    }
+    if (jam_reserve(&base->text, &base->text_capacity, base->text_len + strlen(text) + 1) != 0) {
+        return -1;
+    }
+    out = base->text + base->text_len;
+    for (p = text; *p; p++) {
+        if (*p == '\n') {
+            if (p > text && p[-1] == '\r') {
+                continue;
+            }
+            *out++ = '\r';
+        } else {
+            *out++ = (unsigned char)*p;
+        }
+    }
+    if (out > base->text + base->text_len && out[-1] != '\r') {
+        *out++ = '\r';
+    }
+    base->text_len = (size_t)(out - base->text);
+    return 0;
+}
+
+static unsigned long jam_attributes(const ftn_message_t* msg) {
+    unsigned long attributes;
+    size_t i;
+
+    attributes = msg->type == FTN_MSG_NETMAIL ? FTN_JAM_MSG_TYPENET : FTN_JAM_MSG_TYPEECHO;
+    for (i = 0; i < JAM_ATTRIBUTE_COUNT; i++) {
+        if (msg->attributes & jam_attribute_map[i].ftn) {
+            attributes |= jam_attribute_map[i].jam;
+        }
+    }
+    return attributes;
+}
+
+ftn_error_t ftn_jam_append(ftn_jam_base_t* base, const ftn_message_t* msg) {
+    ftn_jam_pending_t* pending;
+    unsigned char* header;
+    size_t header_start;
+    size_t text_start;
+    size_t new_capacity;
+    unsigned long now;
+
+    if (!base || !msg) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    if (base->pending_count == base->pending_capacity) {
+        new_capacity = base->pending_capacity ? base->pending_capacity * 2 : 16;
+        pending = realloc(base->pending, new_capacity * sizeof(ftn_jam_pending_t));
+        if (!pending) {
+            return FTN_ERROR_NOMEM;
+        }
+        base->pending = pending;
+        base->pending_capacity = new_capacity;
+    }
+
+    /* Fixed header first, completed once the subfields are in */
+    header_start = base->headers_len;
+    text_start = base->text_len;
+    if (jam_reserve(&base->headers, &base->headers_capacity, header_start + FTN_JAM_MSGHDR_SIZE) != 0) {
+        return FTN_ERROR_NOMEM;
+    }
+    memset(base->headers + header_start, 0, FTN_JAM_MSGHDR_SIZE);
+    base->headers_len += FTN_JAM_MSGHDR_SIZE;
+
+    if (jam_add_kludges(base, msg) != 0 ||
+        jam_add_text(base, msg->text) != 0 ||
+        jam_add_text(base, msg->tearline) != 0 ||
+        jam_add_text(base, msg->origin) != 0) {
+        base->headers_len = header_start;
+        base->text_len = text_start;
+        return FTN_ERROR_NOMEM;
+    }
+
+    now = (unsigned long)time(NULL);
+    header = base->headers + header_start;
+    memcpy(header, "JAM", 4);
+    jam_put_u16(header + JAM_HDR_REVISION, 1);
+    jam_put_u32(header + JAM_HDR_SUBFIELDLEN,
+                (unsigned long)(base->headers_len - header_start - FTN_JAM_MSGHDR_SIZE));
+    jam_put_u32(header + JAM_HDR_MSGIDCRC, msg->msgid ? ftn_jam_crc(msg->msgid) : JAM_NONE);
+    jam_put_u32(header + JAM_HDR_REPLYCRC, msg->reply ? ftn_jam_crc(msg->reply) : JAM_NONE);
+    jam_put_u32(header + JAM_HDR_WRITTEN, (unsigned long)msg->timestamp);
+    jam_put_u32(header + JAM_HDR_RECEIVED, now);
+    jam_put_u32(header + JAM_HDR_PROCESSED, now);
+    jam_put_u32(header + JAM_HDR_ATTRIBUTE, jam_attributes(msg));
+    jam_put_u32(header + JAM_HDR_TXTLEN, (unsigned long)(base->text_len - text_start));
+    jam_put_u32(header + JAM_HDR_PASSWORD, JAM_NONE);
+    jam_put_u32(header + JAM_HDR_COST, msg->cost);
+
+    pending = &base->pending[base->pending_count++];
+    pending->header_offset = header_start;
+    pending->text_offset = text_start;
+    pending->to_crc = ftn_jam_crc(msg->to_user ? msg->to_user : "");
+    return FTN_OK;
+}
+
+int ftn_jam_batch_full(const ftn_jam_base_t* base) {
+    return base && base->pending_count >= base->batch_size;
+}
+
+static void jam_clear(ftn_jam_base_t* base) {
+    base->headers_len = 0;
+    base->text_len = 0;
+    base->pending_count = 0;
+}
+
+ftn_error_t ftn_jam_flush(ftn_jam_base_t* base) {
+    unsigned char header[FTN_JAM_HEADER_SIZE];
+    unsigned char* index = NULL;
+    unsigned char* msghdr;
+    unsigned long first;
+    struct stat st;
+    off_t header_end = 0;
+    off_t text_end = 0;
+    off_t index_end = 0;
+    int header_fd;
+    int text_fd = -1;
+    int index_fd = -1;
+    int locked = 0;
+    int writing = 0;
+    ftn_error_t result = FTN_OK;
+    size_t i;
+
+    if (!base) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    if (base->pending_count == 0) {
+        return FTN_OK;
+    }
+
+    header_fd = jam_open_file(base->path, ".jhr", O_RDWR);
+    text_fd = jam_open_file(base->path, ".jdt", O_RDWR | O_CREAT);
+    index_fd = jam_open_file(base->path, ".jdx", O_RDWR | O_CREAT);
+    index = malloc(base->pending_count * FTN_JAM_INDEX_SIZE);
+    if (header_fd < 0 || text_fd < 0 || index_fd < 0 || !index) {
+        result = index ? FTN_ERROR_FILE : FTN_ERROR_NOMEM;
+        goto cleanup;
+    }
+    if (jam_lock(header_fd, F_WRLCK) != 0) {
+        result = FTN_ERROR_FILE;
+        goto cleanup;
+    }
+    locked = 1;
+
+    if ((result = jam_read_base_header(header_fd, header)) != FTN_OK) {
+        goto cleanup;
+    }
+    if (fstat(header_fd, &st) != 0) {
+        result = FTN_ERROR_FILE;
+        goto cleanup;
+    }
+    header_end = st.st_size;
+    if (fstat(text_fd, &st) != 0) {
+        result = FTN_ERROR_FILE;
+        goto cleanup;
+    }
+    text_end = st.st_size;
+    if (fstat(index_fd, &st) != 0) {
+        result = FTN_ERROR_FILE;
+        goto cleanup;
+    }
+    index_end = st.st_size - st.st_size % FTN_JAM_INDEX_SIZE;
+
+    /* Offsets in JAM files are 32 bits */
+    if ((unsigned long)header_end > JAM_NONE - base->headers_len ||
+        (unsigned long)text_end > JAM_NONE - base->text_len) {
+        result = FTN_ERROR_FILE;
+        goto cleanup;
+    }
+
+    /* Number the queued messages and point them at their new homes */
+    first = jam_get_u32(header + JAM_BASE_FIRST) + (unsigned long)(index_end / FTN_JAM_INDEX_SIZE);
+    for (i = 0; i < base->pending_count; i++) {
+        msghdr = base->headers + base->pending[i].header_offset;
+        jam_put_u32(msghdr + JAM_HDR_NUMBER, first + i);
+        jam_put_u32(msghdr + JAM_HDR_OFFSET, (unsigned long)text_end + base->pending[i].text_offset);
+        jam_put_u32(index + i * FTN_JAM_INDEX_SIZE, base->pending[i].to_crc);
+        jam_put_u32(index + i * FTN_JAM_INDEX_SIZE + 4,
+                    (unsigned long)header_end + base->pending[i].header_offset);
+    }
+
+    /* Text and headers before the index, so indexed messages are always complete */
+    writing = 1;
+    if (jam_pwrite_all(text_fd, base->text, base->text_len, text_end) != 0 ||
+        jam_pwrite_all(header_fd, base->headers, base->headers_len, header_end) != 0 ||
+        jam_pwrite_all(index_fd, index, base->pending_count * FTN_JAM_INDEX_SIZE, index_end) != 0) {
+        result = FTN_ERROR_FILE;
+        goto cleanup;
+    }
+
+    jam_put_u32(header + JAM_BASE_ACTIVE,
+                jam_get_u32(header + JAM_BASE_ACTIVE) + (unsigned long)base->pending_count);
+    jam_put_u32(header + JAM_BASE_MODCOUNTER, jam_get_u32(header + JAM_BASE_MODCOUNTER) + 1);
+    /* Only the counters changed; the reserved area is left alone */
+    if (jam_pwrite_all(header_fd, header, JAM_BASE_FIRST, 0) != 0) {
+        result = FTN_ERROR_FILE;
+        goto cleanup;
+    }
+    base->written += base->pending_count;
+
+cleanup:
+    if (result != FTN_OK && writing) {
+        /* Leave the base as it was */
+        if (ftruncate(text_fd, text_end) != 0 ||
+            ftruncate(header_fd, header_end) != 0 ||
+            ftruncate(index_fd, index_end) != 0) {
+            result = FTN_ERROR_FILE;
+        }
+    }
+    if (locked) {
+        jam_lock(header_fd, F_UNLCK);
+    }
+    if (header_fd >= 0) close(header_fd);
+    if (text_fd >= 0) close(text_fd);
+    if (index_fd >= 0) close(index_fd);
+    free(index);
+    /* A failed flush keeps the queue for the next one */
+    if (result == FTN_OK) {
+        jam_clear(base);
+    }
+    return result;
+}
+
+/* Read access to a base: .jhr is read-locked while the base is open */
+typedef struct {
+    int header_fd;
+    int index_fd;
+    unsigned long first;
+    unsigned long count;
+} jam_reader_t;
+
+static ftn_error_t jam_reader_open(jam_reader_t* reader, const char* path) {
+    unsigned char header[FTN_JAM_HEADER_SIZE];
+    struct stat st;
+    ftn_error_t result;
+
+    reader->header_fd = jam_open_file(path, ".jhr", O_RDONLY);
+    reader->index_fd = jam_open_file(path, ".jdx", O_RDONLY);
+    if (reader->header_fd < 0 || reader->index_fd < 0) {
+        result = errno == ENOENT ? FTN_ERROR_FILE_NOT_FOUND : FTN_ERROR_FILE;
+        goto fail;
+    }
+    if (jam_lock(reader->header_fd, F_RDLCK) != 0) {
+        result = FTN_ERROR_FILE;
+        goto fail;
+    }
+    if ((result = jam_read_base_header(reader->header_fd, header)) != FTN_OK) {
+        goto fail;
+    }
+    if (fstat(reader->index_fd, &st) != 0) {
+        result = FTN_ERROR_FILE;
+        goto fail;
+    }
+    reader->first = jam_get_u32(header + JAM_BASE_FIRST);
+    reader->count = (unsigned long)(st.st_size / FTN_JAM_INDEX_SIZE);
+    return FTN_OK;
+
+fail:
+    if (reader->header_fd >= 0) close(reader->header_fd);
+    if (reader->index_fd >= 0) close(reader->index_fd);
+    return result;
+}
+
+static void jam_reader_close(jam_reader_t* reader) {
+    close(reader->header_fd);
+    close(reader->index_fd);
+}
+
+/* Read a message header and its subfields */
+static ftn_error_t jam_read_header(int fd, unsigned long offset, unsigned char* header,
+                                   unsigned char** subfields, size_t* subfields_len) {
+    if (offset == JAM_NONE ||
+        jam_pread_all(fd, header, FTN_JAM_MSGHDR_SIZE, (off_t)offset) != 0 ||
+        memcmp(header, "JAM", 4) != 0) {
+        return FTN_ERROR_INVALID_FORMAT;
+    }
+    *subfields_len = jam_get_u32(header + JAM_HDR_SUBFIELDLEN);
+    *subfields = malloc(*subfields_len + 1);
+    if (!*subfields) {
+        return FTN_ERROR_NOMEM;
+    }
+    if (jam_pread_all(fd, *subfields, *subfields_len, (off_t)offset + FTN_JAM_MSGHDR_SIZE) != 0) {
+        free(*subfields);
+        *subfields = NULL;
+        return FTN_ERROR_INVALID_FORMAT;
+    }
+    return FTN_OK;
+}
+
+/* Walk the subfields; returns the next one, or NULL at the end */
+static const unsigned char* jam_next_subfield(const unsigned char* subfields, size_t len, size_t* pos,
+                                              unsigned int* id, char** value) {
+    const unsigned char* field;
+    unsigned long data_len;
+
+    if (*pos + 8 > len) {
+        return NULL;
+    }
+    field = subfields + *pos;
+    data_len = jam_get_u32(field + 4);
+    if (data_len > len - *pos - 8) {
+        return NULL;
+    }
+    *id = jam_get_u16(field);
+    *value = malloc(data_len + 1);
+    if (!*value) {
+        return NULL;
+    }
+    memcpy(*value, field + 8, data_len);
+    (*value)[data_len] = '\0';
+    *pos += 8 + data_len;
+    return field;
+}
+
+ftn_error_t ftn_jam_count(const char* path, unsigned long* first, unsigned long* count) {
+    jam_reader_t reader;
+    ftn_error_t result;
+
+    if (!path || !first || !count) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    if ((result = jam_reader_open(&reader, path)) != FTN_OK) {
+        return result;
+    }
+    *first = reader.first;
+    *count = reader.count;
+    jam_reader_close(&reader);
+    return FTN_OK;
+}
+
+static ftn_error_t jam_add_via(ftn_message_t* msg, const char* trace) {
+    char** via_lines;
+    char* line;
+
+    line = malloc(strlen(trace) + 5);
+    via_lines = realloc(msg->via_lines, (msg->via_count + 1) * sizeof(char*));
+    if (via_lines) {
+        msg->via_lines = via_lines;
+    }
+    if (!line || !via_lines) {
+        free(line);
+        return FTN_ERROR_NOMEM;
+    }
+    sprintf(line, "Via %s", trace);
+    msg->via_lines[msg->via_count++] = line;
+    return FTN_OK;
+}
+
+/* Fill in a message from its subfields. Takes ownership of value. */
+static ftn_error_t jam_apply_subfield(ftn_message_t* msg, unsigned int id, char* value) {
+    char* line;
+    ftn_error_t result = FTN_OK;
+
+    switch (id) {
+    case FTN_JAM_OADDRESS:
+        ftn_address_parse(value, &msg->orig_addr);
+        break;
+    case FTN_JAM_DADDRESS:
+        ftn_address_parse(value, &msg->dest_addr);
+        break;
+    case FTN_JAM_SENDERNAME:
+        free(msg->from_user);
+        msg->from_user = value;
+        return FTN_OK;
+    case FTN_JAM_RECEIVERNAME:
+        free(msg->to_user);
+        msg->to_user = value;
+        return FTN_OK;
+    case FTN_JAM_SUBJECT:
+        free(msg->subject);
+        msg->subject = value;
+        return FTN_OK;
+    case FTN_JAM_MSGID:
+        free(msg->msgid);
+        msg->msgid = value;
+        return FTN_OK;
+    case FTN_JAM_REPLYID:
+        free(msg->reply);
+        msg->reply = value;
+        return FTN_OK;
+    case FTN_JAM_TZUTCINFO:
+        free(msg->tzutc);
+        msg->tzutc = value;
+        return FTN_OK;
+    case FTN_JAM_PID:
+        line = malloc(strlen(value) + 6);
+        if (!line) {
+            result = FTN_ERROR_NOMEM;
+            break;
+        }
+        sprintf(line, "PID: %s", value);
+        result = ftn_message_add_control(msg, line);
+        free(line);
+        break;
+    case FTN_JAM_FTSKLUDGE:
+        result = ftn_message_add_control(msg, value);
+        break;
+    case FTN_JAM_SEENBY2D:
+        result = ftn_message_add_seenby(msg, value);
+        break;
+    case FTN_JAM_PATH2D:
+        result = ftn_message_add_path(msg, value);
+        break;
+    case FTN_JAM_TRACE:
+        result = jam_add_via(msg, value);
+        break;
+    default:
+        break;
+    }
+    free(value);
+    return result;
+}
+
+ftn_error_t ftn_jam_read(const char* path, unsigned long number, ftn_message_t** msg) {
+    unsigned char record[FTN_JAM_INDEX_SIZE];
+    unsigned char header[FTN_JAM_MSGHDR_SIZE];
+    unsigned char* subfields = NULL;
+    size_t subfields_len = 0;
+    size_t pos = 0;
+    unsigned long attributes;
+    unsigned long text_len;
+    unsigned int id;
+    char* value;
+    char* text = NULL;
+    ftn_message_t* message = NULL;
+    jam_reader_t reader;
+    int text_fd;
+    size_t i;
+    ftn_error_t result;
+
+    if (!path || !msg) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    *msg = NULL;
+
+    if ((result = jam_reader_open(&reader, path)) != FTN_OK) {
+        return result;
+    }
+    if (number < reader.first || number - reader.first >= reader.count ||
+        jam_pread_all(reader.index_fd, record, sizeof(record),
+                      (off_t)(number - reader.first) * FTN_JAM_INDEX_SIZE) != 0 ||
+        jam_get_u32(record + 4) == JAM_NONE) {
+        jam_reader_close(&reader);
+        return FTN_ERROR_NOTFOUND;
+    }
+    result = jam_read_header(reader.header_fd, jam_get_u32(record + 4), header, &subfields, &subfields_len);
+    if (result != FTN_OK) {
+        jam_reader_close(&reader);
+        return result;
+    }
+
+    /* Message text */
+    text_len = jam_get_u32(header + JAM_HDR_TXTLEN);
+    text = malloc(text_len + 1);
+    text_fd = jam_open_file(path, ".jdt", O_RDONLY);
+    if (!text || text_fd < 0 ||
+        jam_pread_all(text_fd, text, text_len, (off_t)jam_get_u32(header + JAM_HDR_OFFSET)) != 0) {
+        result = !text ? FTN_ERROR_NOMEM : FTN_ERROR_FILE;
+    }
+    if (text_fd >= 0) {
+        close(text_fd);
+    }
+    jam_reader_close(&reader);
+    if (result != FTN_OK) {
+        goto cleanup;
+    }
+    text[text_len] = '\0';
+
+    attributes = jam_get_u32(header + JAM_HDR_ATTRIBUTE);
+    message = ftn_message_new(attributes & FTN_JAM_MSG_TYPENET ? FTN_MSG_NETMAIL : FTN_MSG_ECHOMAIL);
+    if (!message) {
+        result = FTN_ERROR_NOMEM;
+        goto cleanup;
+    }
+    for (i = 0; i < JAM_ATTRIBUTE_COUNT; i++) {
+        if (attributes & jam_attribute_map[i].jam) {
+            message->attributes |= jam_attribute_map[i].ftn;
+        }
+    }
+    message->timestamp = (time_t)jam_get_u32(header + JAM_HDR_WRITTEN);
+    message->cost = (unsigned int)jam_get_u32(header + JAM_HDR_COST);
+
+    while (result == FTN_OK && jam_next_subfield(subfields, subfields_len, &pos, &id, &value)) {
+        result = jam_apply_subfield(message, id, value);
+    }
+    if (result == FTN_OK) {
+        /* Body, tearline and origin */
+        result = ftn_message_parse_text(message, text);
+    }
+
+cleanup:
+    free(subfields);
+    free(text);
+    if (result != FTN_OK) {
+        ftn_message_free(message);
+        return result;
+    }
+    *msg = message;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_jam_find_recipient(const char* path, const char* name,
+                                   unsigned long* numbers, size_t max, size_t* count) {
+    unsigned char records[JAM_INDEX_CHUNK * FTN_JAM_INDEX_SIZE];
+    unsigned char header[FTN_JAM_MSGHDR_SIZE];
+    unsigned char* subfields;
+    size_t subfields_len;
+    size_t pos;
+    unsigned int id;
+    char* value;
+    unsigned long number = 0;
+    unsigned long chunk;
+    unsigned long i;
+    uint32_t crc;
+    int match;
+    jam_reader_t reader;
+    ftn_error_t result;
+
+    if (!path || !name || !count || (max > 0 && !numbers)) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    *count = 0;
+
+    if ((result = jam_reader_open(&reader, path)) != FTN_OK) {
+        return result;
+    }
+    crc = ftn_jam_crc(name);
+
+    /* The index alone narrows the search; headers are only read to rule out CRC collisions */
+    while (result == FTN_OK && number < reader.count && *count < max) {
+        chunk = reader.count - number;
+        if (chunk > JAM_INDEX_CHUNK) {
+            chunk = JAM_INDEX_CHUNK;
+        }
+        if (jam_pread_all(reader.index_fd, records, chunk * FTN_JAM_INDEX_SIZE,
+                          (off_t)number * FTN_JAM_INDEX_SIZE) != 0) {
+            result = FTN_ERROR_FILE;
+            break;
+        }
+        for (i = 0; i < chunk && *count < max; i++) {
+            if (jam_get_u32(records + i * FTN_JAM_INDEX_SIZE) != crc ||
+                jam_get_u32(records + i * FTN_JAM_INDEX_SIZE + 4) == JAM_NONE) {
+                continue;
+            }
+            if (jam_read_header(reader.header_fd, jam_get_u32(records + i * FTN_JAM_INDEX_SIZE + 4),
+                                header, &subfields, &subfields_len) != FTN_OK) {
+                continue;
+            }
+            match = 0;
+            pos = 0;
+            while (jam_next_subfield(subfields, subfields_len, &pos, &id, &value)) {
+                if (id == FTN_JAM_RECEIVERNAME) {
+                    match = strcasecmp(value, name) == 0;
+                }
+                free(value);
+            }
+            free(subfields);
+            if (match) {
+                numbers[(*count)++] = reader.first + number + i;
+            }
+        }
+        number += chunk;
+    }
+
+    jam_reader_close(&reader);
+    return result;
+}
@@ -0,0 +1,400 @@
+/*
+ * lmtp.c - Pipelined LMTP delivery client for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ftn.h"
+#include "ftn/lmtp.h"
+#include "ftn/net.h"
+#include "ftn/log.h"
+
+/* Client lifecycle */
+ftn_lmtp_client_t* ftn_lmtp_client_new(const char* target, const char* domain, size_t batch_size) {
+    ftn_lmtp_client_t* client;
+
+    if (!target || !*target) {
+        return NULL;
+    }
+
+    client = malloc(sizeof(ftn_lmtp_client_t));
+    if (!client) {
+        return NULL;
+    }
+    memset(client, 0, sizeof(ftn_lmtp_client_t));
+
+    if (ftn_textproto_init(&client->proto, "LMTP", target) != FTN_OK) {
+        goto fail;
+    }
+    if (domain && *domain) {
+        client->domain = ftn_textproto_strdup(domain);
+        if (!client->domain) {
+            goto fail;
+        }
+    }
+    client->batch_size = batch_size > 0 ? batch_size : FTN_LMTP_DEFAULT_BATCH;
+
+    return client;
+
+fail:
+    ftn_lmtp_client_free(client);
+    return NULL;
+}
+
+void ftn_lmtp_client_free(ftn_lmtp_client_t* client) {
+    if (!client) return;
+
+    ftn_lmtp_disconnect(client);
+    ftn_lmtp_clear(client);
+    free(client->queue);
+    ftn_textproto_free(&client->proto);
+    free(client->domain);
+    free(client);
+}
+
+/* PIPELINING is only listed in the LHLO reply */
+static ftn_error_t lmtp_read_reply(ftn_lmtp_client_t* client, int* code) {
+    return ftn_textproto_read_reply(&client->proto, code, "PIPELINING", &client->pipelining);
+}
+
+/* Connection management */
+ftn_error_t ftn_lmtp_connect(ftn_lmtp_client_t* client) {
+    char hostname[256];
+    int code;
+
+    if (!client) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    if (client->proto.conn) {
+        return FTN_OK;
+    }
+
+    client->pipelining = 0;
+    client->rset_pending = 0;
+    if (ftn_textproto_connect(&client->proto, FTN_LMTP_DEFAULT_PORT, FTN_LMTP_TIMEOUT_MS) != FTN_OK) {
+        return FTN_ERROR_NETWORK;
+    }
+
+    /* Greeting, then LHLO; the capabilities tell us whether we may pipeline */
+    if (lmtp_read_reply(client, &code) != FTN_OK || code != 220) {
+        goto fail;
+    }
+    if (gethostname(hostname, sizeof(hostname)) != 0) {
+        strcpy(hostname, "localhost");
+    }
+    hostname[sizeof(hostname) - 1] = '\0';
+    if (ftn_textproto_append_command(&client->proto, "LHLO ", hostname) != FTN_OK ||
+        ftn_textproto_write(&client->proto) != FTN_OK ||
+        lmtp_read_reply(client, &code) != FTN_OK || code != 250) {
+        goto fail;
+    }
+
+    client->connections++;
+    logf_debug("LMTP: connected to %s%s", client->proto.target, client->pipelining ? " (pipelining)" : "");
+    return FTN_OK;
+
+fail:
+    logf_error("LMTP: %s refused the session: %s", client->proto.target, client->proto.last_reply);
+    ftn_textproto_close(&client->proto);
+    return FTN_ERROR_NETWORK;
+}
+
+void ftn_lmtp_disconnect(ftn_lmtp_client_t* client) {
+    int code;
+
+    if (!client || !client->proto.conn) {
+        return;
+    }
+
+    client->proto.out_len = 0;
+    if (((ftn_net_connection_t*)client->proto.conn)->connected &&
+        ftn_textproto_append_command(&client->proto, "QUIT", NULL) == FTN_OK &&
+        ftn_textproto_write(&client->proto) == FTN_OK) {
+        lmtp_read_reply(client, &code);
+    }
+    ftn_textproto_close(&client->proto);
+}
+
+/* Queue management */
+/* The RCPT TO path for a mailbox; 0 when it does not fit in a command line */
+static int lmtp_format_rcpt(const ftn_lmtp_client_t* client, const char* user, char* rcpt, size_t size) {
+    int length;
+
+    if (client->domain) {
+        length = snprintf(rcpt, size, "<%s@%s>", user, client->domain);
+    } else {
+        length = snprintf(rcpt, size, "<%s>", user);
+    }
+    return length >= 0 && (size_t)length < size;
+}
+
+ftn_error_t ftn_lmtp_queue(ftn_lmtp_client_t* client, const char* user, const char* network, char* text) {
+    ftn_lmtp_message_t* msg;
+    char rcpt[FTN_LMTP_LINE_MAX];
+
+    if (!client || !user || !text) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    /* A truncated address could deliver to someone else's mailbox */
+    if (!lmtp_format_rcpt(client, user, rcpt, sizeof(rcpt))) {
+        logf_warning("LMTP: recipient address for %.64s... is too long", user);
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    if (client->queue_count >= client->queue_capacity) {
+        size_t capacity = client->queue_capacity ? client->queue_capacity * 2 : client->batch_size;
+        ftn_lmtp_message_t* queue = realloc(client->queue, capacity * sizeof(ftn_lmtp_message_t));
+        if (!queue) {
+            return FTN_ERROR_NOMEM;
+        }
+        client->queue = queue;
+        client->queue_capacity = capacity;
+    }
+
+    msg = &client->queue[client->queue_count];
+    memset(msg, 0, sizeof(ftn_lmtp_message_t));
+    msg->user = ftn_textproto_strdup(user);
+    msg->network = ftn_textproto_strdup(network);
+    if (!msg->user || (network && !msg->network)) {
+        free(msg->user);
+        free(msg->network);
+        return FTN_ERROR_NOMEM;
+    }
+    msg->text = text;
+    client->queue_count++;
+    return FTN_OK;
+}
+
+int ftn_lmtp_queue_full(const ftn_lmtp_client_t* client) {
+    return client && client->queue_count >= client->batch_size;
+}
+
+int ftn_lmtp_delivered(const ftn_lmtp_message_t* msg) {
+    return msg && msg->status >= 200 && msg->status < 300;
+}
+
+void ftn_lmtp_clear(ftn_lmtp_client_t* client) {
+    size_t i;
+
+    if (!client) return;
+
+    for (i = 0; i < client->queue_count; i++) {
+        free(client->queue[i].user);
+        free(client->queue[i].network);
+        free(client->queue[i].text);
+    }
+    client->queue_count = 0;
+}
+
+/* Envelope: MAIL FROM, RCPT TO and DATA. Without PIPELINING each command
+   waits for its reply here; with it they are only buffered. */
+static ftn_error_t lmtp_envelope(ftn_lmtp_client_t* client, ftn_lmtp_message_t* msg) {
+    char rcpt[FTN_LMTP_LINE_MAX];
+    ftn_error_t result;
+
+    /* Checked when queued; delivery failures come back to the tosser, so nothing should bounce */
+    if (!lmtp_format_rcpt(client, msg->user, rcpt, sizeof(rcpt))) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    if (client->pipelining) {
+        if (ftn_textproto_append_command(&client->proto, "MAIL FROM:<>", NULL) != FTN_OK ||
+            ftn_textproto_append_command(&client->proto, "RCPT TO:", rcpt) != FTN_OK ||
+            ftn_textproto_append_command(&client->proto, "DATA", NULL) != FTN_OK) {
+            return FTN_ERROR_NOMEM;
+        }
+        return FTN_OK;
+    }
+
+    if ((result = ftn_textproto_append_command(&client->proto, "MAIL FROM:<>", NULL)) != FTN_OK ||
+        (result = ftn_textproto_write(&client->proto)) != FTN_OK ||
+        (result = lmtp_read_reply(client, &msg->mail_code)) != FTN_OK) {
+        return result;
+    }
+    if (msg->mail_code / 100 != 2) {
+        return FTN_OK;
+    }
+    if ((result = ftn_textproto_append_command(&client->proto, "RCPT TO:", rcpt)) != FTN_OK ||
+        (result = ftn_textproto_write(&client->proto)) != FTN_OK ||
+        (result = lmtp_read_reply(client, &msg->rcpt_code)) != FTN_OK) {
+        return result;
+    }
+    if (msg->rcpt_code / 100 != 2) {
+        return FTN_OK;
+    }
+    if ((result = ftn_textproto_append_command(&client->proto, "DATA", NULL)) != FTN_OK ||
+        (result = ftn_textproto_write(&client->proto)) != FTN_OK) {
+        return result;
+    }
+    return lmtp_read_reply(client, &msg->data_code);
+}
+
+/* Collect the replies to a pipelined envelope */
+static ftn_error_t lmtp_envelope_replies(ftn_lmtp_client_t* client, ftn_lmtp_message_t* msg) {
+    ftn_error_t result;
+    int code;
+
+    if (!client->pipelining) {
+        return FTN_OK;
+    }
+
+    while (client->rset_pending > 0) {
+        if ((result = lmtp_read_reply(client, &code)) != FTN_OK) {
+            return result;
+        }
+        client->rset_pending--;
+    }
+
+    if ((result = lmtp_read_reply(client, &msg->mail_code)) != FTN_OK ||
+        (result = lmtp_read_reply(client, &msg->rcpt_code)) != FTN_OK) {
+        return result;
+    }
+    return lmtp_read_reply(client, &msg->data_code);
+}
+
+/* Deliver the queue from message `first` on. Each message costs one round
+   trip when pipelining: its content goes out together with the next
+   envelope, and the replies to both are read back in order. */
+static ftn_error_t lmtp_transfer(ftn_lmtp_client_t* client, size_t first) {
+    ftn_lmtp_message_t* msg;
+    ftn_error_t result;
+    size_t i;
+    int accepted;
+
+    for (i = first; i < client->queue_count; i++) {
+        msg = &client->queue[i];
+
+        if (i == first || !client->pipelining) {
+            if ((result = lmtp_envelope(client, msg)) != FTN_OK ||
+                (result = ftn_textproto_write(&client->proto)) != FTN_OK) {
+                return result;
+            }
+        }
+        if ((result = lmtp_envelope_replies(client, msg)) != FTN_OK) {
+            return result;
+        }
+
+        accepted = msg->data_code == 354;
+        if (accepted) {
+            /* A server that took DATA without a recipient gets an empty message */
+            if (msg->rcpt_code / 100 == 2) {
+                result = ftn_textproto_append_dotted(&client->proto, msg->text);
+            } else {
+                result = ftn_textproto_append(&client->proto, ".\r\n", 3);
+            }
+            if (result != FTN_OK) {
+                return result;
+            }
+        } else if (msg->mail_code / 100 == 2) {
+            /* The transaction is still open on the server side */
+            if ((result = ftn_textproto_append_command(&client->proto, "RSET", NULL)) != FTN_OK) {
+                return result;
+            }
+            client->rset_pending++;
+        }
+
+        if (client->pipelining && i + 1 < client->queue_count) {
+            if ((result = lmtp_envelope(client, &client->queue[i + 1])) != FTN_OK) {
+                return result;
+            }
+        }
+        if ((result = ftn_textproto_write(&client->proto)) != FTN_OK) {
+            return result;
+        }
+
+        if (!client->pipelining) {
+            int code;
+            while (client->rset_pending > 0) {
+                if ((result = lmtp_read_reply(client, &code)) != FTN_OK) {
+                    return result;
+                }
+                client->rset_pending--;
+            }
+        }
+
+        if (accepted) {
+            /* LMTP answers once per recipient, and there is exactly one */
+            if ((result = lmtp_read_reply(client, &msg->status)) != FTN_OK) {
+                return result;
+            }
+        } else if (msg->mail_code / 100 != 2) {
+            msg->status = msg->mail_code;
+        } else if (msg->rcpt_code / 100 != 2) {
+            msg->status = msg->rcpt_code;
+        } else {
+            msg->status = msg->data_code;
+        }
+
+        if (ftn_lmtp_delivered(msg)) {
+            client->delivered++;
+        } else {
+            client->failed++;
+            logf_warning("LMTP: %s refused mail for %s with %d", client->proto.target, msg->user, msg->status);
+        }
+    }
+
+    return FTN_OK;
+}
+
+ftn_error_t ftn_lmtp_flush(ftn_lmtp_client_t* client) {
+    ftn_error_t result = FTN_OK;
+    size_t first;
+    int attempt;
+
+    if (!client) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    /* A kept-open connection may have been closed by the server while idle,
+       so a failed batch is resumed once on a fresh connection */
+    for (attempt = 0; attempt < 2; attempt++) {
+        for (first = 0; first < client->queue_count && client->queue[first].status != 0; first++) {
+        }
+        if (first >= client->queue_count) {
+            return FTN_OK;
+        }
+
+        result = ftn_lmtp_connect(client);
+        if (result != FTN_OK) {
+            return result;
+        }
+
+        /* Replies for the half-sent message can't be trusted after a failure */
+        client->queue[first].mail_code = 0;
+        client->queue[first].rcpt_code = 0;
+        client->queue[first].data_code = 0;
+
+        result = lmtp_transfer(client, first);
+        if (result == FTN_OK) {
+            return FTN_OK;
+        }
+
+        logf_warning("LMTP: connection to %s lost, reconnecting", client->proto.target);
+        ftn_textproto_close(&client->proto);
+    }
+
+    return result;
+}
@@ -29,6 +29,7 @@
 
 #include "ftn/log.h"
 #include "ftn/compat.h"
+#include "ftn/thread.h"
 
 /* Include config types directly to avoid circular dependencies */
 #include "ftn/log_levels.h"
@@ -44,8 +45,13 @@ static ftn_log_level_t current_log_level = FTN_LOG_INFO;
 static FILE* log_file = NULL;
 static char* log_ident = NULL;
 
+/* Guards the state above, and keeps lines from different threads whole */
+static ftn_mutex_t log_mutex = FTN_MUTEX_INITIALIZER;
+
 void ftn_log_init(const void* config_ptr) {
     const ftn_logging_config_t* config = (const ftn_logging_config_t*)config_ptr;
+
+    ftn_mutex_lock(&log_mutex);
     if (config) {
         current_log_level = config->level;
 
@@ -73,9 +79,11 @@ void ftn_log_init(const void* config_ptr) {
         current_log_level = FTN_LOG_INFO;
         log_file = NULL;
     }
+    ftn_mutex_unlock(&log_mutex);
 }
 
 void ftn_log_cleanup(void) {
+    ftn_mutex_lock(&log_mutex);
     if (log_file) {
         fclose(log_file);
         log_file = NULL;
@@ -85,14 +93,22 @@ void ftn_log_cleanup(void) {
         free(log_ident);
         log_ident = NULL;
     }
+    ftn_mutex_unlock(&log_mutex);
 }
 
 ftn_log_level_t ftn_log_get_level(void) {
-    return current_log_level;
+    ftn_log_level_t level;
+
+    ftn_mutex_lock(&log_mutex);
+    level = current_log_level;
+    ftn_mutex_unlock(&log_mutex);
+    return level;
 }
 
 void ftn_log_set_level(ftn_log_level_t level) {
+    ftn_mutex_lock(&log_mutex);
     current_log_level = level;
+    ftn_mutex_unlock(&log_mutex);
 }
 
 static void get_log_level_str(ftn_log_level_t level, const char** level_str) {
@@ -119,63 +135,42 @@ static void get_log_level_str(ftn_log_level_t level, const char** level_str) {
 }
 
 void ftn_log(ftn_log_level_t level, const char* message) {
-    const char* level_str;
-    FILE* output;
-    time_t now;
-    struct tm* tm_info;
-    char timestamp[32];
-
-    if (level < current_log_level) {
-        return;
-    }
-
-    get_log_level_str(level, &level_str);
-
-    time(&now);
-    tm_info = localtime(&now);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
-
-    /* Use log file if available, otherwise console */
-    if (log_file) {
-        fprintf(log_file, "[%s] %s: %s\n", timestamp, level_str, message);
-        fflush(log_file);
-    } else {
-        output = (level >= FTN_LOG_ERROR) ? stderr : stdout;
-        fprintf(output, "[%s] %s: %s\n", timestamp, level_str, message);
-        fflush(output);
-    }
+    ftn_logf(level, "%s", message);
 }
 
 void ftn_vlogf(ftn_log_level_t level, const char* format, va_list args) {
     const char* level_str;
     FILE* output;
     time_t now;
-    struct tm* tm_info;
+    struct tm tm_info;
     char timestamp[32];
 
-    if (level < current_log_level) {
+    if (level < ftn_log_get_level()) {
         return;
     }
 
     get_log_level_str(level, &level_str);
 
     time(&now);
-    tm_info = localtime(&now);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
+    if (!ftn_localtime_r(&now, &tm_info)) {
+        memset(&tm_info, 0, sizeof(tm_info));
+    }
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &tm_info);
+
+    ftn_mutex_lock(&log_mutex);
 
     /* Use log file if available, otherwise console */
     if (log_file) {
-        fprintf(log_file, "[%s] %s: ", timestamp, level_str);
-        vfprintf(log_file, format, args);
-        fprintf(log_file, "\n");
-        fflush(log_file);
+        output = log_file;
     } else {
         output = (level >= FTN_LOG_ERROR) ? stderr : stdout;
-        fprintf(output, "[%s] %s: ", timestamp, level_str);
-        vfprintf(output, format, args);
-        fprintf(output, "\n");
-        fflush(output);
     }
+    fprintf(output, "[%s] %s: ", timestamp, level_str);
+    vfprintf(output, format, args);
+    fprintf(output, "\n");
+    fflush(output);
+
+    ftn_mutex_unlock(&log_mutex);
 }
 
 void ftn_logf(ftn_log_level_t level, const char* format, ...) {
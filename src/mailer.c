@@ -35,6 +35,8 @@
 #include "ftn/mailer.h"
 #include "ftn/log.h"
 #include "ftn/version.h"
+#include "ftn/tls.h"
+#include "ftn/thread.h"
 
 /* Global signal flags - same pattern as fntosser.c */
 volatile sig_atomic_t fnmailer_shutdown_requested = 0;
@@ -42,29 +44,30 @@ volatile sig_atomic_t fnmailer_reload_requested = 0;
 volatile sig_atomic_t fnmailer_dump_stats_requested = 0;
 volatile sig_atomic_t fnmailer_toggle_debug_requested = 0;
 
-/* Signal handlers - same pattern as fntosser.c */
+/*
+ * Signal handlers - same pattern as fntosser.c. They only set flags, as
+ * logging is not safe in a handler, and re-install themselves because a
+ * strict C89 build gets System V signal() semantics, which reset the
+ * handler after one delivery: a second SIGHUP would kill the daemon.
+ */
 static void fnmailer_handle_sigterm(int sig) {
-    (void)sig;
+    signal(sig, fnmailer_handle_sigterm);
     fnmailer_shutdown_requested = 1;
-    logf_info("Shutdown signal received, exiting gracefully");
 }
 
 static void fnmailer_handle_sighup(int sig) {
-    (void)sig;
+    signal(sig, fnmailer_handle_sighup);
     fnmailer_reload_requested = 1;
-    logf_info("Reload signal received, will reload configuration");
 }
 
 static void fnmailer_handle_sigusr1(int sig) {
-    (void)sig;
+    signal(sig, fnmailer_handle_sigusr1);
     fnmailer_dump_stats_requested = 1;
-    logf_info("Statistics dump requested");
 }
 
 static void fnmailer_handle_sigusr2(int sig) {
-    (void)sig;
+    signal(sig, fnmailer_handle_sigusr2);
     fnmailer_toggle_debug_requested = 1;
-    logf_info("Debug mode toggle requested");
 }
 
 /* Signal handling implementation - same pattern as fntosser.c */
@@ -128,7 +131,38 @@ void ftn_mailer_check_signals(ftn_mailer_context_t* mailer) {
     }
 }
 
+static void mailer_tuning_from_config(const ftn_network_config_t* config, ftn_net_tuning_t* tuning);
+
 /* Mailer context management */
+static void mailer_free_networks(ftn_mailer_context_t* ctx) {
+    size_t i;
+
+    if (!ctx->networks) {
+        return;
+    }
+
+    for (i = 0; i < ctx->network_count; i++) {
+        if (ctx->networks[i].active_connection) {
+            ftn_net_connection_free(ctx->networks[i].active_connection);
+        }
+        if (ctx->networks[i].listener) {
+            ftn_net_server_free(ctx->networks[i].listener);
+        }
+        ftn_tls_context_free(ctx->networks[i].tls);
+        ftn_freq_index_free(ctx->networks[i].freq_index);
+        if (ctx->networks[i].plz_history) {
+            ftn_plz_history_save(ctx->networks[i].plz_history);
+            ftn_plz_history_free(ctx->networks[i].plz_history);
+        }
+        if (ctx->networks[i].crc_cache) {
+            ftn_crc_cache_save(ctx->networks[i].crc_cache);
+            ftn_crc_cache_free(ctx->networks[i].crc_cache);
+        }
+    }
+    free(ctx->networks);
+    ctx->networks = NULL;
+}
+
 ftn_mailer_context_t* ftn_mailer_context_new(void) {
     ftn_mailer_context_t* ctx = malloc(sizeof(ftn_mailer_context_t));
     if (!ctx) {
@@ -146,7 +180,7 @@ void ftn_mailer_context_free(ftn_mailer_context_t* ctx) {
     }
 
     /* Free config */
-    if (ctx->config) {
+    if (ctx->config && ctx->owns_config) {
         ftn_config_free(ctx->config);
     }
 
@@ -154,17 +188,13 @@ void ftn_mailer_context_free(ftn_mailer_context_t* ctx) {
         free(ctx->config_filename);
     }
 
-    /* Free network contexts */
-    if (ctx->networks) {
-        size_t i;
-        for (i = 0; i < ctx->network_count; i++) {
-            if (ctx->networks[i].active_connection) {
-                ftn_net_connection_free(ctx->networks[i].active_connection);
-            }
-        }
-        free(ctx->networks);
+    if (ctx->capture_dir) {
+        free(ctx->capture_dir);
     }
 
+    /* Free network contexts */
+    mailer_free_networks(ctx);
+
     if (ctx->pid_file) {
         free(ctx->pid_file);
     }
@@ -192,11 +222,20 @@ ftn_error_t ftn_mailer_context_init(ftn_mailer_context_t* ctx, const ftn_mailer_
         strcpy(ctx->config_filename, options->config_file);
     }
 
+    if (options->capture_dir) {
+        ctx->capture_dir = malloc(strlen(options->capture_dir) + 1);
+        if (!ctx->capture_dir) {
+            return FTN_ERROR_NOMEM;
+        }
+        strcpy(ctx->capture_dir, options->capture_dir);
+    }
+
     /* Load configuration */
     ctx->config = ftn_config_new();
     if (!ctx->config) {
         return FTN_ERROR_NOMEM;
     }
+    ctx->owns_config = 1;
 
     result = ftn_config_load(ctx->config, ctx->config_filename);
     if (result != FTN_OK) {
@@ -222,16 +261,100 @@ ftn_error_t ftn_mailer_context_init(ftn_mailer_context_t* ctx, const ftn_mailer_
     if (result != FTN_OK) {
         return result;
     }
+    ftn_mailer_open_listeners(ctx);
 
     ctx->running = 1;
     return FTN_OK;
 }
 
+/* Use a config owned by the caller, such as one shared with a tosser */
+ftn_error_t ftn_mailer_context_attach(ftn_mailer_context_t* ctx, ftn_config_t* config) {
+    ftn_error_t result;
+
+    if (!ctx || !config) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    result = ftn_config_validate_mailer(config);
+    if (result != FTN_OK) {
+        return result;
+    }
+
+    if (ctx->config && ctx->owns_config) {
+        ftn_config_free(ctx->config);
+    }
+    ctx->config = config;
+    ctx->owns_config = 0;
+
+    result = ftn_mailer_init_networks(ctx);
+    if (result != FTN_OK) {
+        return result;
+    }
+
+    ctx->running = 1;
+    return FTN_OK;
+}
+
+void ftn_mailer_context_adopt(ftn_mailer_context_t* ctx, ftn_mailer_context_t* old) {
+    ftn_net_tuning_t tuning;
+    ftn_network_context_t* net;
+    size_t i;
+    size_t j;
+
+    if (!ctx || !old) {
+        return;
+    }
+
+    ctx->start_time = old->start_time;
+    ctx->total_connections = old->total_connections;
+    ctx->successful_connections = old->successful_connections;
+    ctx->failed_connections = old->failed_connections;
+    ctx->bytes_sent = old->bytes_sent;
+    ctx->bytes_received = old->bytes_received;
+
+    if (!ctx->pid_file) {
+        ctx->pid_file = old->pid_file;
+        old->pid_file = NULL;
+    }
+    if (!ctx->capture_dir) {
+        ctx->capture_dir = old->capture_dir;
+        old->capture_dir = NULL;
+    }
+
+    /* The old sockets still hold the ports, so they are moved rather than reopened */
+    for (i = 0; i < ctx->network_count; i++) {
+        net = &ctx->networks[i];
+        if (net->listener || net->config->listen_port <= 0) {
+            continue;
+        }
+        for (j = 0; j < old->network_count; j++) {
+            if (old->networks[j].listener &&
+                old->networks[j].config->listen_port == net->config->listen_port) {
+                net->listener = old->networks[j].listener;
+                old->networks[j].listener = NULL;
+                mailer_tuning_from_config(net->config, &tuning);
+                if (ftn_net_server_set_tuning(net->listener, &tuning) != FTN_OK) {
+                    logf_warning("Failed to tune listener on port %d for %s", net->config->listen_port,
+                                 net->config->section_name);
+                }
+                break;
+            }
+        }
+    }
+}
+
+void ftn_mailer_set_nodelist(ftn_mailer_context_t* ctx, ftn_nodelist_t* nodelist) {
+    if (ctx) {
+        ctx->nodelist = nodelist;
+    }
+}
+
 /* Command line parsing */
 ftn_error_t ftn_mailer_parse_args(int argc, char* argv[], ftn_mailer_options_t* options) {
     int c;
     static struct option long_options[] = {
         {"config", required_argument, 0, 'c'},
+        {"capture", required_argument, 0, 'C'},
         {"daemon", no_argument, 0, 'd'},
         {"sleep", required_argument, 0, 's'},
         {"verbose", no_argument, 0, 'v'},
@@ -247,7 +370,7 @@ ftn_error_t ftn_mailer_parse_args(int argc, char* argv[], ftn_mailer_options_t*
     memset(options, 0, sizeof(ftn_mailer_options_t));
     options->sleep_interval = 60; /* Default 60 seconds */
 
-    while ((c = getopt_long(argc, argv, "c:ds:vh", long_options, NULL)) != -1) {
+    while ((c = getopt_long(argc, argv, "c:C:ds:vh", long_options, NULL)) != -1) {
         switch (c) {
             case 'c':
                 if (options->config_file) {
@@ -260,6 +383,17 @@ ftn_error_t ftn_mailer_parse_args(int argc, char* argv[], ftn_mailer_options_t*
                 strcpy(options->config_file, optarg);
                 break;
 
+            case 'C':
+                if (options->capture_dir) {
+                    free(options->capture_dir);
+                }
+                options->capture_dir = malloc(strlen(optarg) + 1);
+                if (!options->capture_dir) {
+                    return FTN_ERROR_NOMEM;
+                }
+                strcpy(options->capture_dir, optarg);
+                break;
+
             case 'd':
                 options->daemon_mode = 1;
                 break;
@@ -308,6 +442,7 @@ void ftn_mailer_show_help(const char* program_name) {
     printf("\n");
     printf("Options:\n");
     printf("  -c, --config FILE     Configuration file path (required)\n");
+    printf("  -C, --capture DIR     Record every binkp session to a capture in DIR\n");
     printf("  -d, --daemon          Run in continuous (daemon) mode\n");
     printf("  -s, --sleep SECONDS   Sleep interval for daemon mode (default: 60)\n");
     printf("  -v, --verbose         Enable verbose logging\n");
@@ -385,7 +520,9 @@ ftn_error_t ftn_mailer_daemonize(ftn_mailer_context_t* ctx) {
 
 ftn_error_t ftn_mailer_create_pid_file(ftn_mailer_context_t* ctx) {
     FILE* fp;
+    char* tmp_path;
     pid_t pid;
+    int ok;
 
     if (!ctx || !ctx->pid_file) {
         return FTN_OK; /* PID file is optional */
@@ -393,14 +530,29 @@ ftn_error_t ftn_mailer_create_pid_file(ftn_mailer_context_t* ctx) {
 
     pid = getpid();
 
-    fp = fopen(ctx->pid_file, "w");
+    /* Written under another name, so nobody reads a PID file that is
+       still empty */
+    tmp_path = malloc(strlen(ctx->pid_file) + 5);
+    if (!tmp_path) {
+        return FTN_ERROR_NOMEM;
+    }
+    sprintf(tmp_path, "%s.tmp", ctx->pid_file);
+
+    fp = fopen(tmp_path, "w");
     if (!fp) {
+        free(tmp_path);
         return FTN_ERROR_FILE_ACCESS;
     }
 
-    fprintf(fp, "%d\n", (int)pid);
-    fclose(fp);
+    ok = fprintf(fp, "%d\n", (int)pid) > 0;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path, ctx->pid_file) != 0) {
+        unlink(tmp_path);
+        free(tmp_path);
+        return FTN_ERROR_FILE_ACCESS;
+    }
 
+    free(tmp_path);
     return FTN_OK;
 }
 
@@ -418,6 +570,9 @@ ftn_error_t ftn_mailer_init_networks(ftn_mailer_context_t* ctx) {
         return FTN_ERROR_INVALID_PARAMETER;
     }
 
+    /* Drop the contexts for a previous config */
+    mailer_free_networks(ctx);
+
     ctx->network_count = ctx->config->network_count;
     if (ctx->network_count == 0) {
         return FTN_ERROR_INVALID;
@@ -436,57 +591,336 @@ ftn_error_t ftn_mailer_init_networks(ftn_mailer_context_t* ctx) {
         ctx->networks[i].last_successful_poll = 0;
         ctx->networks[i].consecutive_failures = 0;
         ctx->networks[i].active_connection = NULL;
+        ctx->networks[i].listener = NULL;
     }
 
     return FTN_OK;
 }
 
-ftn_error_t ftn_mailer_poll_networks(ftn_mailer_context_t* ctx) {
+/* Socket tuning profile for a network's uplink */
+static void mailer_tuning_from_config(const ftn_network_config_t* config, ftn_net_tuning_t* tuning) {
+    ftn_net_tuning_init(tuning);
+    tuning->bandwidth_kbps = (unsigned long)config->tcp_bandwidth;
+    tuning->rtt_ms = (unsigned long)config->tcp_rtt;
+    tuning->notsent_lowat = config->tcp_notsent_lowat;
+    tuning->cork_frames = config->tcp_cork;
+    if (config->tcp_congestion) {
+        strncpy(tuning->congestion, config->tcp_congestion, sizeof(tuning->congestion) - 1);
+        tuning->congestion[sizeof(tuning->congestion) - 1] = '\0';
+    }
+}
+
+/* Wrap an uplink connection in TLS (binkps); the context is kept for later calls */
+static ftn_error_t mailer_start_tls(ftn_network_context_t* net, ftn_net_connection_t* conn, const char* hostname) {
+    const ftn_network_config_t* config = net->config;
+
+    if (!net->tls) {
+        net->tls = ftn_tls_context_new(0, config->tls_cert_file, config->tls_key_file, config->tls_ca_file);
+        if (!net->tls) {
+            return FTN_ERROR_NETWORK;
+        }
+
+        if (config->tls_fingerprint && ftn_tls_context_set_fingerprint(net->tls, config->tls_fingerprint) != FTN_OK) {
+            logf_error("Invalid tls_fingerprint for %s", config->section_name);
+            ftn_tls_context_free(net->tls);
+            net->tls = NULL;
+            return FTN_ERROR_INVALID_PARAMETER;
+        }
+    }
+
+    return ftn_tls_start(net->tls, conn, hostname);
+}
+
+/* Find a hub's binkp host and port from its IBN nodelist flag */
+static int mailer_hub_from_nodelist(ftn_nodelist_t* nodelist, const ftn_address_t* hub,
+                                    char* hostname, size_t size, int* port) {
+    ftn_nodelist_entry_t* entry;
+    ftn_inet_service_t* services = NULL;
+    size_t count;
     size_t i;
-    time_t now = time(NULL);
+    int found = 0;
 
-    if (!ctx) {
+    entry = ftn_nodelist_find_by_address(nodelist, hub);
+    if (!entry || !entry->flags) {
+        return 0;
+    }
+
+    count = ftn_nodelist_parse_inet_flags(entry->flags, &services);
+    for (i = 0; i < count && !found; i++) {
+        if (services[i].protocol == FTN_INET_IBN && services[i].hostname) {
+            strncpy(hostname, services[i].hostname, size - 1);
+            hostname[size - 1] = '\0';
+            *port = services[i].has_port ? (int)services[i].port
+                                         : (int)ftn_inet_protocol_default_port(FTN_INET_IBN);
+            found = 1;
+        }
+    }
+    ftn_nodelist_free_inet_services(services, count);
+    return found;
+}
+
+/*
+ * Poll one network: returns 1 when the hub was reached, 0 when it was not
+ * and -1 when there was nothing to call. Only the network context is
+ * updated, so different networks may be polled from different threads.
+ */
+int ftn_mailer_poll_network(ftn_mailer_context_t* ctx, ftn_network_context_t* net, time_t now) {
+    ftn_net_tuning_t tuning;
+    ftn_net_connection_t* conn;
+    char hostname[256];
+    int port;
+    int result = -1;
+
+    if (!ctx || !net) {
+        return -1;
+    }
+
+    logf_debug("Polling network %s", net->config->section_name);
+
+    hostname[0] = '\0';
+    port = net->config->hub_port;
+    if (net->config->hub_hostname) {
+        strncpy(hostname, net->config->hub_hostname, sizeof(hostname) - 1);
+        hostname[sizeof(hostname) - 1] = '\0';
+    } else if (ctx->nodelist && net->config->hub_str) {
+        mailer_hub_from_nodelist(ctx->nodelist, &net->config->hub, hostname, sizeof(hostname), &port);
+    }
+
+    /* Simple connection test for now - this will be expanded in later tasks */
+    if (hostname[0]) {
+        mailer_tuning_from_config(net->config, &tuning);
+        conn = ftn_net_connect_tuned(hostname, port, 5000, &tuning);
+        if (conn && net->config->use_tls && mailer_start_tls(net, conn, hostname) != FTN_OK) {
+            ftn_net_connection_free(conn);
+            conn = NULL;
+        }
+        if (conn) {
+            logf_info("Successfully connected to %s:%d", hostname, port);
+
+            net->last_successful_poll = now;
+            net->consecutive_failures = 0;
+            result = 1;
+
+            /* Close connection for now - actual protocol will be implemented later */
+            ftn_net_connection_free(conn);
+        } else {
+            logf_warning("Failed to connect to %s:%d", hostname, port);
+
+            net->consecutive_failures++;
+            result = 0;
+        }
+    }
+
+    /* Schedule next poll */
+    net->next_poll_time = now + net->config->poll_frequency;
+    return result;
+}
+
+ftn_error_t ftn_mailer_open_listener(ftn_network_context_t* net) {
+    ftn_net_tuning_t tuning;
+
+    if (!net || !net->config || net->config->listen_port <= 0) {
         return FTN_ERROR_INVALID_PARAMETER;
     }
 
+    if (net->listener) {
+        return FTN_OK;
+    }
+
+    net->listener = ftn_net_listen(net->config->listen_port, NULL, 16);
+    if (!net->listener) {
+        logf_error("Failed to listen on port %d for %s", net->config->listen_port,
+                   net->config->section_name);
+        return FTN_ERROR_NETWORK;
+    }
+
+    /* Buffer sizes set on the listening socket are inherited by accepted ones */
+    mailer_tuning_from_config(net->config, &tuning);
+    if (ftn_net_server_set_tuning(net->listener, &tuning) != FTN_OK) {
+        logf_warning("Failed to tune listener on port %d for %s", net->config->listen_port,
+                     net->config->section_name);
+    }
+
+    logf_info("Listening on port %d for %s", net->config->listen_port, net->config->section_name);
+    return FTN_OK;
+}
+
+void ftn_mailer_open_listeners(ftn_mailer_context_t* ctx) {
+    size_t i;
+
+    if (!ctx) {
+        return;
+    }
+
     for (i = 0; i < ctx->network_count; i++) {
-        ftn_network_context_t* net = &ctx->networks[i];
+        if (ctx->networks[i].config->listen_port > 0 && !ctx->networks[i].listener) {
+            ftn_mailer_open_listener(&ctx->networks[i]);
+        }
+    }
+}
 
-        /* Check if polling is due */
-        if (now < net->next_poll_time) {
-            continue;
+int ftn_mailer_answer_network(ftn_mailer_context_t* ctx, ftn_network_context_t* net, int timeout_ms) {
+    ftn_net_connection_t* conn;
+
+    if (!ctx || !net || !net->listener) {
+        return -1;
+    }
+
+    conn = ftn_net_accept(net->listener, timeout_ms);
+    if (!conn) {
+        return 0;
+    }
+
+    logf_info("Answered call from %s for %s", conn->hostname ? conn->hostname : "unknown",
+              net->config->section_name);
+
+    /* Close connection for now - actual protocol will be implemented later */
+    ftn_net_connection_free(conn);
+    return 1;
+}
+
+ftn_error_t ftn_mailer_setup_transfer(ftn_network_context_t* net, ftn_transfer_context_t* transfer) {
+    const ftn_network_config_t* config;
+
+    if (!net || !net->config || !transfer) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    config = net->config;
+    if (config->crc_cache) {
+        if (!net->crc_cache) {
+            net->crc_cache = ftn_crc_cache_new(config->crc_cache);
+            if (!net->crc_cache) {
+                return FTN_ERROR_NOMEM;
+            }
+            if (ftn_crc_cache_load(net->crc_cache) != BINKP_OK) {
+                logf_warning("Failed to load CRC cache: %s", config->crc_cache);
+            }
+        } else if (ftn_crc_cache_save(net->crc_cache) != BINKP_OK) {
+            logf_warning("Failed to save CRC cache: %s", config->crc_cache);
         }
+    }
+    ftn_transfer_context_set_crc(transfer, net->crc_cache, config->use_crc);
 
-        logf_debug("Polling network %s", net->config->section_name);
+    if (!config->freq_dirs) {
+        ftn_transfer_context_set_freq(transfer, NULL, 0);
+        return FTN_OK;
+    }
 
-        /* Simple connection test for now - this will be expanded in later tasks */
-        if (net->config->hub_hostname) {
-            ftn_net_connection_t* conn = ftn_net_connect(net->config->hub_hostname,
-                                                       net->config->hub_port, 5000);
-            if (conn) {
-                logf_info("Successfully connected to %s:%d",
-                           net->config->hub_hostname, net->config->hub_port);
+    if (!net->freq_index) {
+        net->freq_index = ftn_freq_index_open(config->freq_dirs, config->freq_index, config->freq_magic);
+        if (!net->freq_index) {
+            logf_error("Failed to build file request index for network: %s", config->section_name);
+            return FTN_ERROR_NOMEM;
+        }
+    } else {
+        ftn_freq_index_update(net->freq_index, NULL);
+        if (config->freq_index && net->freq_index->modified && ftn_freq_index_save(net->freq_index) != FTN_OK) {
+            logf_warning("Failed to save file request index: %s", config->freq_index);
+        }
+    }
 
-                /* Update statistics */
-                ctx->successful_connections++;
-                net->last_successful_poll = now;
-                net->consecutive_failures = 0;
+    ftn_transfer_context_set_freq(transfer, net->freq_index,
+                                  config->freq_limit > 0 ? (size_t)config->freq_limit : 0);
+    return FTN_OK;
+}
 
-                /* Close connection for now - actual protocol will be implemented later */
-                ftn_net_connection_free(conn);
-            } else {
-                logf_warning("Failed to connect to %s:%d",
-                              net->config->hub_hostname, net->config->hub_port);
+ftn_error_t ftn_mailer_setup_plz(ftn_network_context_t* net, ftn_binkp_session_t* session, ftn_plz_context_t* plz) {
+    const ftn_network_config_t* config;
 
-                ctx->failed_connections++;
-                net->consecutive_failures++;
+    if (!net || !net->config || !session || !plz) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    config = net->config;
+    if (ftn_plz_init(plz) != BINKP_OK) {
+        return FTN_ERROR_NOMEM;
+    }
+    ftn_plz_configure_from_network(plz, config);
+
+    if (config->plz_history) {
+        if (!net->plz_history) {
+            net->plz_history = ftn_plz_history_new(config->plz_history);
+            if (!net->plz_history) {
+                ftn_plz_free(plz);
+                return FTN_ERROR_NOMEM;
             }
+            if (ftn_plz_history_load(net->plz_history) != BINKP_OK) {
+                logf_warning("Failed to load PLZ history: %s", config->plz_history);
+            }
+        } else if (ftn_plz_history_save(net->plz_history) != BINKP_OK) {
+            logf_warning("Failed to save PLZ history: %s", config->plz_history);
+        }
+    }
+
+    ftn_binkp_session_set_plz(session, plz, net->plz_history);
+    return FTN_OK;
+}
+
+ftn_binkp_capture_t* ftn_mailer_open_capture(ftn_mailer_context_t* ctx, ftn_network_context_t* net, int is_originator) {
+    const char* dir;
+    char path[1024];
+    char stamp[32];
+    time_t now;
+    struct tm tm;
+
+    if (!ctx || !net || !net->config) {
+        return NULL;
+    }
+
+    dir = ctx->capture_dir ? ctx->capture_dir : net->config->capture_dir;
+    if (!dir) {
+        return NULL;
+    }
+
+    now = time(NULL);
+    if (!ftn_localtime_r(&now, &tm) || strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm) == 0) {
+        strcpy(stamp, "session");
+    }
 
+    if (snprintf(path, sizeof(path), "%s/%s-%s-%ld.bkc", dir, net->config->section_name, stamp,
+                 (long)getpid()) >= (int)sizeof(path)) {
+        logf_error("Capture path too long in %s", dir);
+        return NULL;
+    }
+
+    return ftn_binkp_capture_open(path, is_originator);
+}
+
+ftn_error_t ftn_mailer_poll_networks(ftn_mailer_context_t* ctx) {
+    size_t i;
+    time_t now = time(NULL);
+    int result;
+
+    if (!ctx) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    for (i = 0; i < ctx->network_count; i++) {
+        ftn_network_context_t* net = &ctx->networks[i];
+
+        /* Answer calls that arrived since the last pass */
+        while (ftn_mailer_answer_network(ctx, net, 0) > 0) {
             ctx->total_connections++;
         }
 
-        /* Schedule next poll */
-        net->next_poll_time = now + net->config->poll_frequency;
+        /* Check if polling is due */
+        if (now < net->next_poll_time) {
+            continue;
+        }
+
+        result = ftn_mailer_poll_network(ctx, net, now);
+        if (result < 0) {
+            continue;
+        }
+
+        /* Update statistics */
+        if (result > 0) {
+            ctx->successful_connections++;
+        } else {
+            ctx->failed_connections++;
+        }
+        ctx->total_connections++;
     }
 
     return FTN_OK;
@@ -581,6 +1015,7 @@ ftn_error_t ftn_mailer_reload_config(ftn_mailer_context_t* ctx) {
         logf_error("Failed to reinitialize networks: %d", result);
         return result;
     }
+    ftn_mailer_open_listeners(ctx);
 
     logf_info("Configuration reloaded successfully");
     return FTN_OK;
@@ -0,0 +1,700 @@
+/*
+ * mime.c - MIME body and header decoding for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <ftn.h>
+#include <ftn/mime.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIME_MAX_DEPTH 8
+#define MIME_VALUE_MAX 256
+
+/* Character sets understood by the transcoder */
+typedef enum {
+    MIME_CS_UNKNOWN = 0,
+    MIME_CS_ASCII,
+    MIME_CS_UTF8,
+    MIME_CS_LATIN1,
+    MIME_CS_CP1252,
+    MIME_CS_CP437
+} mime_charset_t;
+
+/* Base64 symbol values; 0x80 marks anything that is not a symbol */
+static const unsigned char base64_table[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3E, 0x80, 0x80, 0x80, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+};
+
+/* Unicode code points for CP437 bytes 0x80-0xFF */
+static const unsigned short cp437_table[128] = {
+    0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+    0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+    0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+    0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+    0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+    0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556,
+    0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F,
+    0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B,
+    0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4,
+    0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+    0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248,
+    0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x00A0
+};
+
+/* Unicode code points for Windows-1252 bytes 0x80-0x9F */
+static const unsigned short cp1252_table[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178
+};
+
+/* Transfer decoding */
+
+size_t ftn_mime_base64_decode(const char* in, size_t len, char* out) {
+    const unsigned char* src = (const unsigned char*)in;
+    unsigned char* dst = (unsigned char*)out;
+    unsigned long word;
+    unsigned int quad[4];
+    unsigned int n;
+    unsigned int v;
+    size_t i = 0;
+    size_t o = 0;
+
+    if (!in || !out) return 0;
+
+    while (i < len) {
+        /* Fast path: eight symbols per pass with a single validity test.
+           Mail wraps base64 at 76 symbols, so nearly all input stays here. */
+        while (len - i >= 8) {
+            unsigned int a = base64_table[src[i]];
+            unsigned int b = base64_table[src[i + 1]];
+            unsigned int c = base64_table[src[i + 2]];
+            unsigned int d = base64_table[src[i + 3]];
+            unsigned int e = base64_table[src[i + 4]];
+            unsigned int f = base64_table[src[i + 5]];
+            unsigned int g = base64_table[src[i + 6]];
+            unsigned int h = base64_table[src[i + 7]];
+
+            if ((a | b | c | d | e | f | g | h) & 0x80) break;
+
+            word = ((unsigned long)a << 18) | ((unsigned long)b << 12) | (c << 6) | d;
+            dst[o] = (unsigned char)(word >> 16);
+            dst[o + 1] = (unsigned char)(word >> 8);
+            dst[o + 2] = (unsigned char)word;
+            word = ((unsigned long)e << 18) | ((unsigned long)f << 12) | (g << 6) | h;
+            dst[o + 3] = (unsigned char)(word >> 16);
+            dst[o + 4] = (unsigned char)(word >> 8);
+            dst[o + 5] = (unsigned char)word;
+            o += 6;
+            i += 8;
+        }
+
+        /* Slow path: one group, skipping line breaks; padding ends the data */
+        n = 0;
+        while (i < len && n < 4) {
+            v = base64_table[src[i]];
+            if (v & 0x80) {
+                if (src[i] == '=') {
+                    i = len;
+                    break;
+                }
+                i++;
+                continue;
+            }
+            quad[n++] = v;
+            i++;
+        }
+
+        if (n >= 2) dst[o++] = (unsigned char)((quad[0] << 2) | (quad[1] >> 4));
+        if (n >= 3) dst[o++] = (unsigned char)(((quad[1] & 0x0F) << 4) | (quad[2] >> 2));
+        if (n == 4) dst[o++] = (unsigned char)(((quad[2] & 0x03) << 6) | quad[3]);
+    }
+
+    return o;
+}
+
+static int hex_value(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+size_t ftn_mime_qp_decode(const char* in, size_t len, char* out, int header) {
+    const char* end;
+    const char* p;
+    const char* mark;
+    size_t o = 0;
+    int hi;
+    int lo;
+
+    if (!in || !out) return 0;
+
+    p = in;
+    end = in + len;
+    while (p < end) {
+        /* Copy the literal run up to the next escape in one go */
+        mark = memchr(p, '=', (size_t)(end - p));
+        if (!mark) mark = end;
+        if (header) {
+            /* Encoded words write spaces as underscores */
+            while (p < mark) {
+                out[o++] = (*p == '_') ? ' ' : *p;
+                p++;
+            }
+        } else {
+            memcpy(out + o, p, (size_t)(mark - p));
+            o += (size_t)(mark - p);
+            p = mark;
+        }
+        if (p >= end) break;
+
+        /* Soft line break */
+        if (end - p >= 2 && p[1] == '\n') {
+            p += 2;
+            continue;
+        }
+        if (end - p >= 3 && p[1] == '\r' && p[2] == '\n') {
+            p += 3;
+            continue;
+        }
+
+        if (end - p >= 3 && (hi = hex_value((unsigned char)p[1])) >= 0 &&
+            (lo = hex_value((unsigned char)p[2])) >= 0) {
+            out[o++] = (char)((hi << 4) | lo);
+            p += 3;
+        } else if (end - p == 1) {
+            /* Soft break on the last line */
+            p++;
+        } else {
+            out[o++] = *p++;
+        }
+    }
+
+    return o;
+}
+
+/* Character sets */
+
+static mime_charset_t mime_charset(const char* name) {
+    if (!name || !*name) return MIME_CS_UNKNOWN;
+
+    if (strcasecmp(name, "utf-8") == 0 || strcasecmp(name, "utf8") == 0) {
+        return MIME_CS_UTF8;
+    }
+    if (strcasecmp(name, "us-ascii") == 0 || strcasecmp(name, "ascii") == 0) {
+        return MIME_CS_ASCII;
+    }
+    if (strcasecmp(name, "iso-8859-1") == 0 || strcasecmp(name, "iso8859-1") == 0 ||
+        strcasecmp(name, "latin1") == 0 || strcasecmp(name, "latin-1") == 0) {
+        return MIME_CS_LATIN1;
+    }
+    if (strcasecmp(name, "windows-1252") == 0 || strcasecmp(name, "cp1252") == 0) {
+        return MIME_CS_CP1252;
+    }
+    if (strcasecmp(name, "cp437") == 0 || strcasecmp(name, "ibm437") == 0 ||
+        strcasecmp(name, "ibmpc") == 0) {
+        return MIME_CS_CP437;
+    }
+    return MIME_CS_UNKNOWN;
+}
+
+/* FTN target character set; UTF-8 unless another one is named */
+static mime_charset_t mime_target(const char* chrs) {
+    mime_charset_t cs = mime_charset(chrs);
+
+    if (cs == MIME_CS_CP1252) return MIME_CS_LATIN1;
+    if (cs == MIME_CS_UNKNOWN) return MIME_CS_UTF8;
+    return cs;
+}
+
+const char* ftn_mime_chrs_kludge(const char* chrs) {
+    switch (mime_target(chrs)) {
+        case MIME_CS_ASCII: return "ASCII 1";
+        case MIME_CS_LATIN1: return "LATIN-1 2";
+        case MIME_CS_CP437: return "CP437 2";
+        default: return "UTF-8 4";
+    }
+}
+
+/* Read one character, returning its code point; *used gets its length */
+static unsigned long mime_next_char(const unsigned char* s, size_t len, mime_charset_t cs, size_t* used) {
+    unsigned long cp;
+    size_t need;
+    size_t i;
+
+    *used = 1;
+    switch (cs) {
+        case MIME_CS_CP437:
+            return s[0] < 0x80 ? s[0] : cp437_table[s[0] - 0x80];
+        case MIME_CS_CP1252:
+            return (s[0] >= 0x80 && s[0] < 0xA0) ? cp1252_table[s[0] - 0x80] : s[0];
+        case MIME_CS_UTF8:
+            break;
+        default:
+            return s[0];
+    }
+
+    if (s[0] < 0x80) return s[0];
+    if ((s[0] & 0xE0) == 0xC0) {
+        cp = s[0] & 0x1F;
+        need = 1;
+    } else if ((s[0] & 0xF0) == 0xE0) {
+        cp = s[0] & 0x0F;
+        need = 2;
+    } else if ((s[0] & 0xF8) == 0xF0) {
+        cp = s[0] & 0x07;
+        need = 3;
+    } else {
+        /* Stray byte: most likely Latin-1 mislabelled as UTF-8 */
+        return s[0];
+    }
+
+    if (need >= len) return s[0];
+    for (i = 1; i <= need; i++) {
+        if ((s[i] & 0xC0) != 0x80) return s[0];
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+    *used = need + 1;
+    return cp;
+}
+
+/* Write one code point; returns the number of bytes written */
+static size_t mime_put_char(unsigned char* out, unsigned long cp, mime_charset_t cs) {
+    size_t i;
+
+    switch (cs) {
+        case MIME_CS_UTF8:
+            if (cp < 0x80) {
+                out[0] = (unsigned char)cp;
+                return 1;
+            }
+            if (cp < 0x800) {
+                out[0] = (unsigned char)(0xC0 | (cp >> 6));
+                out[1] = (unsigned char)(0x80 | (cp & 0x3F));
+                return 2;
+            }
+            if (cp < 0x10000) {
+                out[0] = (unsigned char)(0xE0 | (cp >> 12));
+                out[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+                out[2] = (unsigned char)(0x80 | (cp & 0x3F));
+                return 3;
+            }
+            out[0] = (unsigned char)(0xF0 | (cp >> 18));
+            out[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+            out[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+            out[3] = (unsigned char)(0x80 | (cp & 0x3F));
+            return 4;
+        case MIME_CS_LATIN1:
+            out[0] = (unsigned char)(cp < 0x100 ? cp : '?');
+            return 1;
+        case MIME_CS_CP437:
+            out[0] = '?';
+            if (cp < 0x80) {
+                out[0] = (unsigned char)cp;
+            } else {
+                for (i = 0; i < 128; i++) {
+                    if (cp437_table[i] == cp) {
+                        out[0] = (unsigned char)(0x80 + i);
+                        break;
+                    }
+                }
+            }
+            return 1;
+        default:
+            out[0] = (unsigned char)(cp < 0x80 ? cp : '?');
+            return 1;
+    }
+}
+
+char* ftn_mime_transcode(const char* in, size_t len, const char* charset, const char* chrs) {
+    const unsigned char* src = (const unsigned char*)in;
+    mime_charset_t from;
+    mime_charset_t to;
+    unsigned char* out;
+    unsigned long cp;
+    size_t used;
+    size_t i;
+    size_t o;
+
+    if (!in) return NULL;
+
+    from = mime_charset(charset);
+    to = mime_target(chrs);
+
+    /* Most mail is plain ASCII, which every target shares */
+    for (i = 0; i < len && src[i] < 0x80; i++);
+
+    if (i == len || from == to || from == MIME_CS_UNKNOWN || from == MIME_CS_ASCII) {
+        out = malloc(len + 1);
+        if (!out) return NULL;
+        memcpy(out, in, len);
+        out[len] = '\0';
+        return (char*)out;
+    }
+
+    /* A single-byte character never needs more than three UTF-8 bytes */
+    out = malloc(len * 3 + 1);
+    if (!out) return NULL;
+    memcpy(out, in, i);
+    o = i;
+
+    while (i < len) {
+        if (src[i] < 0x80) {
+            out[o++] = src[i++];
+            continue;
+        }
+        cp = mime_next_char(src + i, len - i, from, &used);
+        i += used;
+        o += mime_put_char(out + o, cp, to);
+    }
+    out[o] = '\0';
+
+    return (char*)out;
+}
+
+/* MIME structure */
+
+/* Find a header in a raw header block, unfolding continuation lines */
+static int mime_find_header(const char* block, size_t len, const char* name, char* out, size_t size) {
+    const char* end = block + len;
+    const char* p = block;
+    const char* line_end;
+    size_t name_len = strlen(name);
+    size_t o = 0;
+    int found = 0;
+
+    while (p < end) {
+        line_end = memchr(p, '\n', (size_t)(end - p));
+        if (!line_end) line_end = end;
+
+        if (found) {
+            /* Continuation lines start with whitespace */
+            if (p < line_end && (*p == ' ' || *p == '\t')) {
+                while (p < line_end && (*p == ' ' || *p == '\t')) p++;
+                if (o < size - 1) out[o++] = ' ';
+            } else {
+                break;
+            }
+        } else if ((size_t)(line_end - p) > name_len && p[name_len] == ':' &&
+                   strncasecmp(p, name, name_len) == 0) {
+            found = 1;
+            p += name_len + 1;
+            while (p < line_end && (*p == ' ' || *p == '\t')) p++;
+        } else {
+            p = line_end + 1;
+            continue;
+        }
+
+        while (p < line_end && o < size - 1) {
+            if (*p != '\r') out[o++] = *p;
+            p++;
+        }
+        p = line_end + 1;
+    }
+
+    out[o] = '\0';
+    return found;
+}
+
+/* Copy a parameter such as boundary or charset out of a header value */
+static int mime_param(const char* value, const char* name, char* out, size_t size) {
+    const char* p = value;
+    size_t name_len = strlen(name);
+    size_t o = 0;
+
+    while ((p = strchr(p, ';')) != NULL) {
+        p++;
+        while (*p == ' ' || *p == '\t') p++;
+        if (strncasecmp(p, name, name_len) != 0) continue;
+        p += name_len;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p != '=') continue;
+        p++;
+        while (*p == ' ' || *p == '\t') p++;
+
+        if (*p == '"') {
+            p++;
+            while (*p && *p != '"' && o < size - 1) out[o++] = *p++;
+        } else {
+            while (*p && *p != ';' && *p != ' ' && *p != '\t' && o < size - 1) out[o++] = *p++;
+        }
+        out[o] = '\0';
+        return o > 0;
+    }
+    return 0;
+}
+
+/* Next delimiter line at or after p, which must be at the start of a line */
+static const char* mime_next_boundary(const char* p, const char* end, const char* delim, size_t delim_len) {
+    while (p && p + delim_len <= end) {
+        if (memcmp(p, delim, delim_len) == 0) return p;
+        p = memchr(p, '\n', (size_t)(end - p));
+        if (p) p++;
+    }
+    return NULL;
+}
+
+static char* mime_decode_entity(const char* content_type, const char* encoding,
+                                const char* body, size_t len, const char* chrs,
+                                int depth, int* is_plain);
+
+/* Decode the parts of a multipart entity, preferring text/plain */
+static char* mime_decode_multipart(const char* content_type, const char* body, size_t len,
+                                   const char* chrs, int depth, int* is_plain) {
+    char delim[MIME_VALUE_MAX + 2];
+    char part_type[MIME_VALUE_MAX];
+    char part_encoding[MIME_VALUE_MAX];
+    const char* end = body + len;
+    const char* p;
+    const char* next;
+    const char* part_end;
+    const char* part_body;
+    const char* blank;
+    size_t delim_len;
+    char* best = NULL;
+    char* text;
+    int plain;
+
+    strcpy(delim, "--");
+    if (!mime_param(content_type, "boundary", delim + 2, sizeof(delim) - 2)) {
+        return NULL;
+    }
+    delim_len = strlen(delim);
+
+    p = mime_next_boundary(body, end, delim, delim_len);
+    while (p) {
+        p += delim_len;
+
+        /* "--boundary--" closes the multipart */
+        if (end - p >= 2 && p[0] == '-' && p[1] == '-') break;
+
+        p = memchr(p, '\n', (size_t)(end - p));
+        if (!p) break;
+        p++;
+
+        next = mime_next_boundary(p, end, delim, delim_len);
+        part_end = next ? next : end;
+        /* The line break before a delimiter belongs to the delimiter */
+        if (next && part_end > p && part_end[-1] == '\n') part_end--;
+
+        /* Part headers end at the first empty line */
+        if (p < part_end && *p == '\n') {
+            blank = p;
+            part_body = p + 1;
+        } else {
+            blank = p;
+            while (blank && blank < part_end) {
+                blank = memchr(blank, '\n', (size_t)(part_end - blank));
+                if (blank && blank + 1 < part_end && blank[1] == '\n') break;
+                if (blank) blank++;
+            }
+            if (!blank || blank >= part_end) {
+                p = next;
+                continue;
+            }
+            part_body = blank + 2;
+        }
+
+        mime_find_header(p, (size_t)(blank - p), "Content-Type", part_type, sizeof(part_type));
+        mime_find_header(p, (size_t)(blank - p), "Content-Transfer-Encoding", part_encoding, sizeof(part_encoding));
+
+        plain = 0;
+        text = mime_decode_entity(part_type, part_encoding, part_body,
+                                  part_body < part_end ? (size_t)(part_end - part_body) : 0,
+                                  chrs, depth + 1, &plain);
+        if (text) {
+            if (plain) {
+                free(best);
+                *is_plain = 1;
+                return text;
+            }
+            /* Keep the first other text part in case there is no plain one */
+            if (!best) {
+                best = text;
+            } else {
+                free(text);
+            }
+        }
+
+        p = next;
+    }
+
+    return best;
+}
+
+static char* mime_decode_entity(const char* content_type, const char* encoding,
+                                const char* body, size_t len, const char* chrs,
+                                int depth, int* is_plain) {
+    char charset[MIME_VALUE_MAX];
+    char* decoded;
+    char* text;
+    size_t decoded_len;
+    size_t i;
+    size_t o;
+
+    if (depth > MIME_MAX_DEPTH) return NULL;
+
+    /* Without a Content-Type, a body is plain text */
+    if (!content_type || !*content_type) content_type = "text/plain";
+
+    if (strncasecmp(content_type, "multipart/", 10) == 0) {
+        return mime_decode_multipart(content_type, body, len, chrs, depth, is_plain);
+    }
+    if (strncasecmp(content_type, "text/", 5) != 0) {
+        return NULL;
+    }
+
+    decoded = malloc(len + 1);
+    if (!decoded) return NULL;
+
+    if (encoding && strncasecmp(encoding, "base64", 6) == 0) {
+        decoded_len = ftn_mime_base64_decode(body, len, decoded);
+    } else if (encoding && strncasecmp(encoding, "quoted-printable", 16) == 0) {
+        decoded_len = ftn_mime_qp_decode(body, len, decoded, 0);
+    } else {
+        memcpy(decoded, body, len);
+        decoded_len = len;
+    }
+
+    /* Encoded text carries its own CRLF line ends */
+    for (i = 0, o = 0; i < decoded_len; i++) {
+        if (decoded[i] == '\r' && i + 1 < decoded_len && decoded[i + 1] == '\n') continue;
+        decoded[o++] = decoded[i];
+    }
+    decoded_len = o;
+
+    if (!mime_param(content_type, "charset", charset, sizeof(charset))) {
+        charset[0] = '\0';
+    }
+    text = ftn_mime_transcode(decoded, decoded_len, charset, chrs);
+    free(decoded);
+
+    *is_plain = strncasecmp(content_type, "text/plain", 10) == 0;
+    return text;
+}
+
+char* ftn_mime_decode_body(const rfc822_message_t* message, const char* chrs) {
+    const char* content_type;
+    const char* encoding;
+    int is_plain = 0;
+
+    if (!message || !message->body) return NULL;
+
+    content_type = rfc822_message_get_header(message, "Content-Type");
+    encoding = rfc822_message_get_header(message, "Content-Transfer-Encoding");
+
+    return mime_decode_entity(content_type, encoding, message->body, strlen(message->body),
+                              chrs, 0, &is_plain);
+}
+
+char* ftn_mime_decode_header(const char* value, const char* chrs) {
+    char charset[MIME_VALUE_MAX];
+    const char* p;
+    const char* q;
+    const char* text;
+    const char* text_end;
+    char* out;
+    char* decoded;
+    char* converted;
+    size_t decoded_len;
+    size_t charset_len;
+    size_t o = 0;
+    size_t word_end = 0;
+    int after_word = 0;
+    int encoding;
+
+    if (!value) return NULL;
+
+    out = malloc(strlen(value) * 3 + 1);
+    if (!out) return NULL;
+
+    p = value;
+    while (*p) {
+        if (p[0] == '=' && p[1] == '?') {
+            /* =?charset?encoding?text?= */
+            q = strchr(p + 2, '?');
+            if (q && q[1] && q[2] == '?' && (text_end = strstr(q + 3, "?=")) != NULL) {
+                charset_len = (size_t)(q - (p + 2));
+                if (charset_len >= sizeof(charset)) charset_len = sizeof(charset) - 1;
+                memcpy(charset, p + 2, charset_len);
+                charset[charset_len] = '\0';
+                /* RFC 2231 language suffix */
+                if (strchr(charset, '*')) *strchr(charset, '*') = '\0';
+
+                encoding = q[1];
+                text = q + 3;
+                decoded = malloc((size_t)(text_end - text) + 1);
+                if (decoded && (encoding == 'B' || encoding == 'b' ||
+                                encoding == 'Q' || encoding == 'q')) {
+                    if (encoding == 'B' || encoding == 'b') {
+                        decoded_len = ftn_mime_base64_decode(text, (size_t)(text_end - text), decoded);
+                    } else {
+                        decoded_len = ftn_mime_qp_decode(text, (size_t)(text_end - text), decoded, 1);
+                    }
+                    converted = ftn_mime_transcode(decoded, decoded_len, charset, chrs);
+                    free(decoded);
+                    if (converted) {
+                        /* Whitespace between adjacent encoded words is dropped */
+                        if (after_word) o = word_end;
+                        strcpy(out + o, converted);
+                        o += strlen(converted);
+                        free(converted);
+                        word_end = o;
+                        after_word = 1;
+                        p = text_end + 2;
+                        continue;
+                    }
+                } else {
+                    free(decoded);
+                }
+            }
+        }
+
+        if (*p != ' ' && *p != '\t') after_word = 0;
+        out[o++] = *p++;
+    }
+    out[o] = '\0';
+
+    return out;
+}
@@ -4,13 +4,26 @@
  */
 
 #include <ftn.h>
+#include <ftn/net.h>
+#include <ftn/thread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <time.h>
+#include <signal.h>
 #include <sys/stat.h>
 #include <dirent.h>
 
+/* Listener mode limits */
+#define GATEWAY_LINE_MAX      1024
+#define GATEWAY_REPLY_MAX     128
+#define GATEWAY_MAX_RCPTS     100
+#define GATEWAY_MAX_MESSAGE   (4 * 1024 * 1024)
+#define GATEWAY_TIMEOUT_MS    300000
+#define GATEWAY_DEFAULT_SIZE  (256 * 1024)
+#define GATEWAY_DEFAULT_AGE   60
+
 static void print_version(void) {
     printf("msg2pkt (libFTN) %s\n", ftn_get_version());
     printf("%s\n", ftn_get_copyright());
@@ -19,6 +32,7 @@ static void print_version(void) {
 
 static void print_usage(const char* program_name) {
     printf("Usage: %s [options] <output_dir> <rfc822_files...>\n", program_name);
+    printf("       %s [options] --listen <address> <output_dir>\n", program_name);
     printf("\n");
     printf("Convert RFC822 message files to FidoNet packet format.\n");
     printf("\n");
@@ -26,6 +40,10 @@ static void print_usage(const char* program_name) {
     printf("  -d, --domain <domain>  Domain name for RFC822 addresses (default: fidonet.org)\n");
     printf("  -n, --network <name>   Network name to append to addresses (e.g., fsxNet)\n");
     printf("  -s, --sent <dir>       Move processed files to specified 'Sent' directory\n");
+    printf("  -c, --chrs <charset>   FTN character set: UTF-8, LATIN-1, CP437 or ASCII (default: UTF-8)\n");
+    printf("  -l, --listen <address> Accept mail from the MTA instead of reading files\n");
+    printf("  -S, --max-size <bytes> Listener: close a packet at this size (default: %d)\n", GATEWAY_DEFAULT_SIZE);
+    printf("  -T, --max-age <secs>   Listener: close a packet after this long (default: %d)\n", GATEWAY_DEFAULT_AGE);
     printf("  -h, --help             Show this help message\n");
     printf("      --version          Show version information\n");
     printf("\n");
@@ -38,6 +56,17 @@ static void print_usage(const char* program_name) {
     printf("From and To addresses are automatically parsed from message headers.\n");
     printf("Only messages matching the specified domain are processed.\n");
     printf("If --network is specified, it will be appended to FTN addresses (e.g., 21:1/141@fsxNet).\n");
+    printf("MIME mail is decoded: the text/plain part is taken, base64 and quoted-printable\n");
+    printf("are undone, and the text is transcoded to --chrs with a matching CHRS kludge.\n");
+    printf("\n");
+    printf("In listener mode an address of unix:<path> (or any path) accepts LMTP on a\n");
+    printf("Unix socket, and [host:]port accepts SMTP (host defaults to 127.0.0.1).\n");
+    printf("Messages are appended to one open packet per destination node, which is\n");
+    printf("closed when it reaches --max-size or --max-age, and on SIGTERM or SIGINT.\n");
+    printf("Packets are written as <name>.pkt.tmp and renamed once complete; each\n");
+    printf("message is synced to disk before it is acknowledged, and packets left\n");
+    printf("unfinished by an earlier listener are completed at startup. A netmail\n");
+    printf("is written once for each RCPT TO address.\n");
 }
 
 /* Generate unique 8-character packet filename in specified directory */
@@ -45,10 +74,12 @@ static char* generate_packet_filename(const char* output_dir) {
     char* full_path;
     char filename[13]; /* 8 chars + ".pkt" + null */
     time_t now;
+    struct tm tm_buf;
     struct tm* tm_info;
     unsigned int random_part;
     int dir_len;
     struct stat st;
+    char temp_path[512];
     int attempts = 0;
     
     if (!output_dir) output_dir = ".";
@@ -59,7 +90,7 @@ static char* generate_packet_filename(const char* output_dir) {
     if (!full_path) return NULL;
     
     now = time(NULL);
-    tm_info = localtime(&now);
+    tm_info = ftn_localtime_r(&now, &tm_buf);
     
     /* Generate a pseudo-random number based on current time */
     random_part = (unsigned int)(now & 0xFFFFFF);
@@ -83,8 +114,12 @@ static char* generate_packet_filename(const char* output_dir) {
             snprintf(full_path, dir_len + 1 + 12 + 1, "%s/%s", output_dir, filename);
         }
         
+        /* A packet still being written by the listener has a .tmp suffix */
+        snprintf(temp_path, sizeof(temp_path), "%s.tmp", full_path);
+        
         attempts++;
-    } while (stat(full_path, &st) == 0 && attempts < 256); /* File exists, try again */
+    } while ((stat(full_path, &st) == 0 || stat(temp_path, &st) == 0) &&
+             attempts < 256); /* File exists, try again */
     
     if (attempts >= 256) {
         free(full_path);
@@ -233,6 +268,729 @@ static int message_id_exists(const char* output_dir, const char* message_id) {
     return found;
 }
 
+/* Conversion results */
+#define CONVERT_OK      0
+#define CONVERT_SKIPPED 1
+#define CONVERT_FAILED  2
+
+/* Parse an RFC822 message and convert it to FTN. On a skip or failure
+   a short explanation is left in reason. */
+static int convert_message(const char* content, const char* domain, const char* network,
+                           const char* chrs, ftn_message_t** out, char* reason, size_t reason_size) {
+    rfc822_message_t* rfc_msg = NULL;
+    ftn_message_t* ftn_msg = NULL;
+    ftn_error_t error;
+    
+    *out = NULL;
+    
+    /* Parse RFC822 message */
+    error = rfc822_message_parse(content, &rfc_msg);
+    if (error != FTN_OK) {
+        snprintf(reason, reason_size, "parse error");
+        return CONVERT_FAILED;
+    }
+    
+    /* Check if it's a USENET article */
+    if (rfc822_message_get_header(rfc_msg, "Newsgroups")) {
+        /* This is a USENET article */
+        const char* newsgroups = rfc822_message_get_header(rfc_msg, "Newsgroups");
+        const char* from_header = rfc822_message_get_header(rfc_msg, "From");
+        int domain_match = 0;
+        
+        /* Check if From address matches domain */
+        if (from_header && strstr(from_header, domain)) {
+            domain_match = 1;
+        }
+        
+        /* Check if newsgroup matches domain pattern */
+        if (newsgroups) {
+            /* Extract network name from newsgroup (e.g., fidonet.* or fsxnet.*) */
+            char network_prefix[64];
+            const char* dot_pos = strchr(newsgroups, '.');
+            if (dot_pos) {
+                size_t prefix_len = dot_pos - newsgroups;
+                if (prefix_len < sizeof(network_prefix) - 1) {
+                    strlcpy(network_prefix, newsgroups, prefix_len + 1);
+                    /* Check if this matches our expected network */
+                    if (strstr(domain, network_prefix) || 
+                        (network && strcasecmp(network_prefix, network) == 0)) {
+                        domain_match = 1;
+                    }
+                }
+            }
+        }
+        
+        if (!domain_match) {
+            snprintf(reason, reason_size, "network mismatch");
+            rfc822_message_free(rfc_msg);
+            return CONVERT_SKIPPED;
+        }
+        
+        /* Use USENET conversion */
+        error = usenet_to_ftn_chrs(rfc_msg, network ? network : "fidonet", chrs, &ftn_msg);
+    } else {
+        /* Regular RFC822 email */
+        const char* from_header = rfc822_message_get_header(rfc_msg, "From");
+        const char* to_header = rfc822_message_get_header(rfc_msg, "To");
+        int from_match = 0;
+        int to_match = 0;
+        
+        /* Check if From and To addresses match domain */
+        if (from_header && strstr(from_header, domain)) {
+            from_match = 1;
+        }
+        if (to_header && strstr(to_header, domain)) {
+            to_match = 1;
+        }
+        
+        if (!from_match || !to_match) {
+            snprintf(reason, reason_size, "domain mismatch: From=%s, To=%s",
+                     from_match ? "match" : "no match",
+                     to_match ? "match" : "no match");
+            rfc822_message_free(rfc_msg);
+            return CONVERT_SKIPPED;
+        }
+        
+        /* Use standard conversion */
+        error = rfc822_to_ftn_chrs(rfc_msg, domain, chrs, &ftn_msg);
+    }
+    
+    rfc822_message_free(rfc_msg);
+    
+    if (error != FTN_OK || !ftn_msg) {
+        snprintf(reason, reason_size, "conversion error");
+        return CONVERT_FAILED;
+    }
+    
+    /* If network is specified, append it to addresses */
+    if (network) {
+        /* Append network to INTL if present */
+        if (ftn_msg->intl) {
+            char new_intl[256];
+            snprintf(new_intl, sizeof(new_intl), "%s@%s", ftn_msg->intl, network);
+            free(ftn_msg->intl);
+            ftn_msg->intl = strdup(new_intl);
+        }
+    }
+    
+    *out = ftn_msg;
+    return CONVERT_OK;
+}
+
+/* Fill in a packet header for a message, stamped with the current time */
+static void init_packet_header(ftn_packet_header_t* header, const ftn_message_t* msg) {
+    time_t now;
+    struct tm tm_buf;
+    struct tm* tm_info;
+    
+    memset(header, 0, sizeof(ftn_packet_header_t));
+    
+    now = time(NULL);
+    tm_info = ftn_localtime_r(&now, &tm_buf);
+    if (tm_info) {
+        header->year = tm_info->tm_year + 1900;
+        header->month = tm_info->tm_mon;
+        header->day = tm_info->tm_mday;
+        header->hour = tm_info->tm_hour;
+        header->minute = tm_info->tm_min;
+        header->second = tm_info->tm_sec;
+    }
+    
+    header->packet_type = 0x0002;
+    header->orig_zone = msg->orig_addr.zone;
+    header->orig_net = msg->orig_addr.net;
+    header->orig_node = msg->orig_addr.node;
+    header->dest_zone = msg->dest_addr.zone;
+    header->dest_net = msg->dest_addr.net;
+    header->dest_node = msg->dest_addr.node;
+}
+
+/* Listener mode */
+
+static volatile sig_atomic_t shutdown_requested = 0;
+
+static void handle_shutdown(int sig) {
+    (void)sig;
+    shutdown_requested = 1;
+}
+
+/* An open packet for one destination node */
+typedef struct {
+    ftn_address_t dest;
+    ftn_packet_writer_t* writer;
+} gateway_packet_t;
+
+/* Gateway state shared by all sessions */
+typedef struct {
+    const char* output_dir;
+    const char* domain;
+    const char* network;
+    const char* chrs;
+    size_t max_size;                /* Close a packet once it reaches this size */
+    int max_age;                    /* Close a packet this many seconds after opening */
+    gateway_packet_t* packets;
+    size_t packet_count;
+    size_t packet_capacity;
+    int accepted_count;
+    int rejected_count;
+    int packet_total;
+} gateway_t;
+
+/* One SMTP or LMTP session */
+typedef struct {
+    ftn_net_connection_t* conn;
+    int lmtp;
+    char* rcpts[GATEWAY_MAX_RCPTS]; /* Accepted RCPT TO addresses */
+    int rcpt_count;
+    char in[4096];
+    size_t in_len;
+    size_t in_pos;
+} gateway_session_t;
+
+static void gateway_close_packet(gateway_t* gw, size_t index) {
+    gateway_packet_t* pkt = &gw->packets[index];
+    size_t count = pkt->writer->message_count;
+    char* filename = strdup(pkt->writer->filename);
+    
+    if (ftn_packet_writer_close(pkt->writer) == FTN_OK) {
+        printf("Packet saved: %s (%lu messages)\n",
+               filename ? filename : "?", (unsigned long)count);
+        gw->packet_total++;
+    } else {
+        fprintf(stderr, "Error: Failed to save packet %s\n", filename ? filename : "?");
+    }
+    free(filename);
+    
+    gw->packets[index] = gw->packets[gw->packet_count - 1];
+    gw->packet_count--;
+}
+
+/* Close packets that are big or old enough; all of them when forced */
+static void gateway_flush(gateway_t* gw, int force) {
+    time_t now = time(NULL);
+    size_t i = 0;
+    
+    while (i < gw->packet_count) {
+        ftn_packet_writer_t* writer = gw->packets[i].writer;
+        
+        if (force || writer->size >= gw->max_size ||
+            now - writer->opened >= gw->max_age) {
+            gateway_close_packet(gw, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+/* Append a message to the open packet for its destination */
+static ftn_error_t gateway_append(gateway_t* gw, const ftn_message_t* msg) {
+    gateway_packet_t* pkt = NULL;
+    ftn_packet_header_t header;
+    char* filename;
+    size_t i;
+    ftn_error_t error;
+    
+    for (i = 0; i < gw->packet_count; i++) {
+        if (gw->packets[i].dest.zone == msg->dest_addr.zone &&
+            gw->packets[i].dest.net == msg->dest_addr.net &&
+            gw->packets[i].dest.node == msg->dest_addr.node) {
+            pkt = &gw->packets[i];
+            break;
+        }
+    }
+    
+    if (!pkt) {
+        if (gw->packet_count >= gw->packet_capacity) {
+            size_t capacity = gw->packet_capacity ? gw->packet_capacity * 2 : 8;
+            gateway_packet_t* packets = realloc(gw->packets, capacity * sizeof(gateway_packet_t));
+            if (!packets) return FTN_ERROR_MEMORY;
+            gw->packets = packets;
+            gw->packet_capacity = capacity;
+        }
+        
+        filename = generate_packet_filename(gw->output_dir);
+        if (!filename) return FTN_ERROR_FILE;
+        
+        init_packet_header(&header, msg);
+        pkt = &gw->packets[gw->packet_count];
+        pkt->dest = msg->dest_addr;
+        pkt->writer = ftn_packet_writer_open(filename, &header);
+        free(filename);
+        if (!pkt->writer) return FTN_ERROR_FILE_ACCESS;
+        gw->packet_count++;
+    }
+    
+    /* A message that cannot be appended or synced is cut off again */
+    error = ftn_packet_writer_append(pkt->writer, msg);
+    if (error == FTN_OK) {
+        error = ftn_packet_writer_sync(pkt->writer);
+    }
+    if (error != FTN_OK) return error;
+    
+    if (pkt->writer->size >= gw->max_size) {
+        gateway_close_packet(gw, (size_t)(pkt - gw->packets));
+    }
+    return FTN_OK;
+}
+
+static int session_reply(gateway_session_t* session, const char* reply) {
+    char line[GATEWAY_LINE_MAX + 3];
+    
+    snprintf(line, sizeof(line), "%s\r\n", reply);
+    return ftn_net_send_all(session->conn, line, strlen(line)) == FTN_OK;
+}
+
+/* Read one line without its CRLF; returns 0 once the client has gone */
+static int session_read_line(gateway_session_t* session, char* line, size_t size, int* truncated) {
+    size_t len = 0;
+    size_t received;
+    char c;
+    
+    *truncated = 0;
+    for (;;) {
+        if (session->in_pos >= session->in_len) {
+            if (ftn_net_recv(session->conn, session->in, sizeof(session->in), &received) != FTN_OK ||
+                received == 0) {
+                return 0;
+            }
+            session->in_len = received;
+            session->in_pos = 0;
+        }
+        c = session->in[session->in_pos++];
+        if (c == '\n') break;
+        if (c == '\r') continue;
+        if (len < size - 1) {
+            line[len++] = c;
+        } else {
+            *truncated = 1;
+        }
+    }
+    line[len] = '\0';
+    return 1;
+}
+
+/* Read the DATA section up to the lone "." and undo dot-stuffing.
+   Returns NULL with *too_big set if the message exceeded the limit. */
+static char* session_read_data(gateway_session_t* session, int* too_big, int* closed) {
+    char line[GATEWAY_LINE_MAX];
+    char* text;
+    char* bigger;
+    size_t len = 0;
+    size_t capacity = 8192;
+    size_t line_len;
+    const char* start;
+    int truncated;
+    
+    *too_big = 0;
+    *closed = 0;
+    text = malloc(capacity);
+    
+    for (;;) {
+        if (!session_read_line(session, line, sizeof(line), &truncated)) {
+            *closed = 1;
+            free(text);
+            return NULL;
+        }
+        if (!truncated && strcmp(line, ".") == 0) break;
+        
+        start = (line[0] == '.') ? line + 1 : line;
+        line_len = strlen(start);
+        if (!text || *too_big) continue;
+        
+        if (len + line_len + 2 > GATEWAY_MAX_MESSAGE) {
+            *too_big = 1;
+            continue;
+        }
+        if (len + line_len + 2 > capacity) {
+            while (len + line_len + 2 > capacity) capacity *= 2;
+            bigger = realloc(text, capacity);
+            if (!bigger) {
+                free(text);
+                text = NULL;
+                continue;
+            }
+            text = bigger;
+        }
+        memcpy(text + len, start, line_len);
+        len += line_len;
+        text[len++] = '\n';
+    }
+    
+    if (!text || *too_big) {
+        free(text);
+        return NULL;
+    }
+    text[len] = '\0';
+    return text;
+}
+
+/* Does an RCPT mailbox name the same person as an FTN user name? The
+   mailbox is the name as ftn_address_to_rfc822 writes it. */
+static int gateway_mailbox_matches(const char* mailbox, const char* name) {
+    char c;
+    
+    for (; *mailbox && *name; mailbox++, name++) {
+        c = *name;
+        if (c >= 'A' && c <= 'Z') {
+            c = c + 32;
+        } else if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.' || c == '-')) {
+            c = '_';
+        }
+        if (tolower((unsigned char)*mailbox) != c) return 0;
+    }
+    return *mailbox == '\0' && *name == '\0';
+}
+
+/* Address the netmail to one envelope recipient and store it. The To
+   header's name is kept when it is that recipient; otherwise the name
+   comes from the mailbox. */
+static ftn_error_t gateway_deliver_to(gateway_t* gw, ftn_message_t* msg, const char* rcpt) {
+    ftn_address_t header_dest = msg->dest_addr;
+    char* header_to = msg->to_user;
+    char* user = NULL;
+    char* p;
+    ftn_error_t error;
+    
+    error = rfc822_address_to_ftn(rcpt, gw->domain, &msg->dest_addr, &user);
+    if (error != FTN_OK) {
+        msg->dest_addr = header_dest;
+        return error;
+    }
+    
+    if (!header_to || !user || ftn_address_compare(&msg->dest_addr, &header_dest) != 0 ||
+        !gateway_mailbox_matches(user, header_to)) {
+        for (p = user; p && *p; p++) {
+            if (*p == '_') *p = ' ';
+        }
+        msg->to_user = user;
+    }
+    
+    error = gateway_append(gw, msg);
+    
+    msg->to_user = header_to;
+    msg->dest_addr = header_dest;
+    free(user);
+    return error;
+}
+
+/* Convert one received message and store it, once for an echomail and
+   once per envelope recipient for a netmail. Each recipient gets its
+   own reply in replies. */
+static void gateway_deliver(gateway_t* gw, const char* text, gateway_session_t* session,
+                            char replies[][GATEWAY_REPLY_MAX]) {
+    ftn_message_t* ftn_msg = NULL;
+    char reason[96];
+    int result;
+    int i;
+    
+    result = convert_message(text, gw->domain, gw->network, gw->chrs, &ftn_msg, reason, sizeof(reason));
+    for (i = 0; i < session->rcpt_count; i++) {
+        if (result == CONVERT_SKIPPED) {
+            snprintf(replies[i], GATEWAY_REPLY_MAX, "550 5.7.1 Not gatewayed (%s)", reason);
+        } else if (result == CONVERT_FAILED) {
+            snprintf(replies[i], GATEWAY_REPLY_MAX, "554 5.6.0 Cannot convert message (%s)", reason);
+        } else if (ftn_msg->area && i > 0) {
+            /* An echomail goes to its area once, whoever it was sent to */
+            strcpy(replies[i], replies[0]);
+            continue;
+        } else if ((ftn_msg->area ? gateway_append(gw, ftn_msg)
+                                  : gateway_deliver_to(gw, ftn_msg, session->rcpts[i])) != FTN_OK) {
+            snprintf(replies[i], GATEWAY_REPLY_MAX, "451 4.3.0 Cannot write packet");
+        } else {
+            snprintf(replies[i], GATEWAY_REPLY_MAX, "250 2.0.0 Message accepted for delivery");
+            gw->accepted_count++;
+            continue;
+        }
+        gw->rejected_count++;
+    }
+    ftn_message_free(ftn_msg);
+}
+
+/* Forget the envelope recipients of the current transaction */
+static void session_clear_rcpts(gateway_session_t* session) {
+    int i;
+    
+    for (i = 0; i < session->rcpt_count; i++) {
+        free(session->rcpts[i]);
+        session->rcpts[i] = NULL;
+    }
+    session->rcpt_count = 0;
+}
+
+/* Take the address out of "RCPT TO:<address> [parameters]" */
+static char* session_rcpt_address(const char* arg) {
+    const char* end;
+    char* address;
+    size_t len;
+    
+    while (*arg == ' ') arg++;
+    if (*arg == '<') {
+        arg++;
+        end = strchr(arg, '>');
+    } else {
+        end = strchr(arg, ' ');
+    }
+    len = end ? (size_t)(end - arg) : strlen(arg);
+    if (len == 0) return NULL;
+    
+    address = malloc(len + 1);
+    if (!address) return NULL;
+    memcpy(address, arg, len);
+    address[len] = '\0';
+    return address;
+}
+
+static void gateway_session(gateway_t* gw, ftn_net_connection_t* conn, int lmtp) {
+    gateway_session_t session;
+    char line[GATEWAY_LINE_MAX];
+    char reply[GATEWAY_LINE_MAX];
+    char replies[GATEWAY_MAX_RCPTS][GATEWAY_REPLY_MAX];
+    char* rcpt;
+    ftn_address_t rcpt_addr;
+    int have_sender = 0;
+    int greeted = 0;
+    int truncated;
+    int i;
+    
+    memset(&session, 0, sizeof(session));
+    session.conn = conn;
+    session.lmtp = lmtp;
+    ftn_net_set_timeout(conn, GATEWAY_TIMEOUT_MS);
+    
+    snprintf(reply, sizeof(reply), "220 %s msg2pkt %s ready", gw->domain, lmtp ? "LMTP" : "ESMTP");
+    if (!session_reply(&session, reply)) return;
+    
+    while (!shutdown_requested) {
+        if (!session_read_line(&session, line, sizeof(line), &truncated)) break;
+        
+        if (truncated) {
+            if (!session_reply(&session, "500 5.5.2 Line too long")) break;
+        } else if (strncasecmp(line, "LHLO", 4) == 0 || strncasecmp(line, "EHLO", 4) == 0) {
+            if ((strncasecmp(line, "LHLO", 4) == 0) != lmtp) {
+                if (!session_reply(&session, "500 5.5.1 Wrong greeting for this protocol")) break;
+                continue;
+            }
+            snprintf(reply, sizeof(reply), "250-%s\r\n250-PIPELINING\r\n250-8BITMIME\r\n250 ENHANCEDSTATUSCODES", gw->domain);
+            if (!session_reply(&session, reply)) break;
+            greeted = 1;
+            have_sender = 0;
+            session_clear_rcpts(&session);
+        } else if (strncasecmp(line, "HELO", 4) == 0 && !lmtp) {
+            snprintf(reply, sizeof(reply), "250 %s", gw->domain);
+            if (!session_reply(&session, reply)) break;
+            greeted = 1;
+            have_sender = 0;
+            session_clear_rcpts(&session);
+        } else if (strncasecmp(line, "MAIL FROM:", 10) == 0) {
+            if (!greeted) {
+                if (!session_reply(&session, "503 5.5.1 Say hello first")) break;
+            } else if (have_sender) {
+                if (!session_reply(&session, "503 5.5.1 Sender already given")) break;
+            } else {
+                have_sender = 1;
+                session_clear_rcpts(&session);
+                if (!session_reply(&session, "250 2.1.0 OK")) break;
+            }
+        } else if (strncasecmp(line, "RCPT TO:", 8) == 0) {
+            if (!have_sender) {
+                if (!session_reply(&session, "503 5.5.1 Need MAIL first")) break;
+            } else if (!strstr(line + 8, gw->domain)) {
+                snprintf(reply, sizeof(reply), "550 5.1.1 Recipient is not in %s", gw->domain);
+                if (!session_reply(&session, reply)) break;
+            } else if (session.rcpt_count >= GATEWAY_MAX_RCPTS) {
+                if (!session_reply(&session, "452 4.5.3 Too many recipients")) break;
+            } else if (!(rcpt = session_rcpt_address(line + 8))) {
+                if (!session_reply(&session, "501 5.1.3 Bad recipient address syntax")) break;
+            } else if (rfc822_address_to_ftn(rcpt, gw->domain, &rcpt_addr, NULL) != FTN_OK) {
+                free(rcpt);
+                if (!session_reply(&session, "550 5.1.1 Recipient is not an FTN address")) break;
+            } else {
+                session.rcpts[session.rcpt_count++] = rcpt;
+                if (!session_reply(&session, "250 2.1.5 OK")) break;
+            }
+        } else if (strcasecmp(line, "DATA") == 0) {
+            char* text;
+            int too_big;
+            int closed;
+            
+            if (session.rcpt_count == 0) {
+                if (!session_reply(&session, "503 5.5.1 Need RCPT first")) break;
+                continue;
+            }
+            if (!session_reply(&session, "354 End data with <CR><LF>.<CR><LF>")) break;
+            
+            text = session_read_data(&session, &too_big, &closed);
+            if (closed) break;
+            
+            if (text) {
+                gateway_deliver(gw, text, &session, replies);
+                free(text);
+            } else {
+                for (i = 0; i < session.rcpt_count; i++) {
+                    snprintf(replies[i], GATEWAY_REPLY_MAX, "%s",
+                             too_big ? "552 5.3.4 Message too big" : "451 4.3.0 Out of memory");
+                }
+            }
+            
+            if (lmtp) {
+                /* LMTP answers once per accepted recipient */
+                for (i = 0; i < session.rcpt_count; i++) {
+                    if (!session_reply(&session, replies[i])) break;
+                }
+                if (i < session.rcpt_count) break;
+            } else {
+                /* SMTP has one answer for them all, so a recipient that
+                   failed has the whole message sent again */
+                for (i = 1; i < session.rcpt_count && replies[0][0] == '2'; i++) {
+                    if (replies[i][0] != '2') strcpy(replies[0], replies[i]);
+                }
+                if (!session_reply(&session, replies[0])) break;
+            }
+            
+            have_sender = 0;
+            session_clear_rcpts(&session);
+            gateway_flush(gw, 0);
+        } else if (strcasecmp(line, "RSET") == 0) {
+            have_sender = 0;
+            session_clear_rcpts(&session);
+            if (!session_reply(&session, "250 2.0.0 OK")) break;
+        } else if (strncasecmp(line, "NOOP", 4) == 0) {
+            if (!session_reply(&session, "250 2.0.0 OK")) break;
+        } else if (strcasecmp(line, "QUIT") == 0) {
+            session_reply(&session, "221 2.0.0 Bye");
+            break;
+        } else {
+            if (!session_reply(&session, "502 5.5.2 Command not recognized")) break;
+        }
+    }
+    
+    session_clear_rcpts(&session);
+}
+
+/* Finish the packets a previous listener left open. Every message in
+   them was synced before it was acknowledged, so they are closed as they
+   are rather than thrown away. */
+static void gateway_recover(gateway_t* gw) {
+    DIR* dir;
+    struct dirent* entry;
+    char temp_path[512];
+    char final_path[512];
+    ftn_packet_t* packet;
+    size_t count;
+    size_t len;
+    FILE* fp;
+    int ok;
+    
+    dir = opendir(gw->output_dir);
+    if (!dir) return;
+    
+    while ((entry = readdir(dir)) != NULL) {
+        len = strlen(entry->d_name);
+        if (len < 8 || strcmp(entry->d_name + len - 8, ".pkt.tmp") != 0) continue;
+        
+        snprintf(temp_path, sizeof(temp_path), "%s/%s", gw->output_dir, entry->d_name);
+        snprintf(final_path, sizeof(final_path), "%s/%.*s", gw->output_dir, (int)(len - 4), entry->d_name);
+        
+        if (ftn_packet_load(temp_path, &packet) != FTN_OK) {
+            fprintf(stderr, "Warning: Cannot read unfinished packet %s, left in place\n", temp_path);
+            continue;
+        }
+        count = packet->message_count;
+        ftn_packet_free(packet);
+        
+        if (count == 0) {
+            remove(temp_path);
+            continue;
+        }
+        
+        /* Put the terminator on and give it its final name */
+        fp = fopen(temp_path, "ab");
+        ok = fp && fputc(0, fp) != EOF && fputc(0, fp) != EOF;
+        if (fp && fclose(fp) != 0) ok = 0;
+        if (ok && rename(temp_path, final_path) == 0) {
+            printf("Packet recovered: %s (%lu messages)\n", final_path, (unsigned long)count);
+            gw->packet_total++;
+        } else {
+            fprintf(stderr, "Error: Failed to recover packet %s\n", temp_path);
+        }
+    }
+    
+    closedir(dir);
+}
+
+/* Accept mail until told to stop. A target naming a socket path (or
+   starting with "unix:") speaks LMTP; "[host:]port" speaks SMTP. */
+static int run_listener(gateway_t* gw, const char* target) {
+    ftn_net_server_t* server;
+    ftn_net_connection_t* conn;
+    const char* colon;
+    char host[256];
+    int lmtp;
+    int port;
+    
+    if (strncmp(target, "unix:", 5) == 0 || strchr(target, '/')) {
+        lmtp = 1;
+        if (strncmp(target, "unix:", 5) == 0) target += 5;
+        server = ftn_net_listen_unix(target, 16);
+    } else {
+        lmtp = 0;
+        colon = strrchr(target, ':');
+        if (colon) {
+            size_t host_len = colon - target;
+            if (host_len >= sizeof(host)) host_len = sizeof(host) - 1;
+            memcpy(host, target, host_len);
+            host[host_len] = '\0';
+            port = atoi(colon + 1);
+        } else {
+            strcpy(host, "127.0.0.1");
+            port = atoi(target);
+        }
+        server = ftn_net_listen(port, host, 16);
+    }
+    
+    if (!server) {
+        fprintf(stderr, "Error: Cannot listen on %s\n", target);
+        return 1;
+    }
+    
+    gateway_recover(gw);
+    
+    signal(SIGTERM, handle_shutdown);
+    signal(SIGINT, handle_shutdown);
+    signal(SIGPIPE, SIG_IGN);
+    
+    printf("Listening for %s on %s\n", lmtp ? "LMTP" : "SMTP", target);
+    printf("Output directory: %s\n", gw->output_dir);
+    printf("Domain: %s\n", gw->domain);
+    if (gw->network) {
+        printf("Network: %s\n", gw->network);
+    }
+    printf("Packets close at %lu bytes or after %d seconds\n",
+           (unsigned long)gw->max_size, gw->max_age);
+    fflush(stdout);
+    
+    while (!shutdown_requested) {
+        conn = ftn_net_accept(server, 1000);
+        if (conn) {
+            gateway_session(gw, conn, lmtp);
+            ftn_net_connection_free(conn);
+        }
+        gateway_flush(gw, 0);
+        fflush(stdout);
+    }
+    
+    gateway_flush(gw, 1);
+    ftn_net_server_free(server);
+    
+    printf("\nGateway stopped:\n");
+    printf("  Accepted: %d messages\n", gw->accepted_count);
+    printf("  Rejected: %d messages\n", gw->rejected_count);
+    printf("  Packets: %d\n", gw->packet_total);
+    
+    free(gw->packets);
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     ftn_packet_t* packet = NULL;
     char* output_filename = NULL;
@@ -240,6 +998,10 @@ int main(int argc, char* argv[]) {
     char* sent_dir = NULL;
     const char* domain = "fidonet.org";
     const char* network = NULL;
+    const char* chrs = NULL;
+    const char* listen_target = NULL;
+    long max_size = GATEWAY_DEFAULT_SIZE;
+    int max_age = GATEWAY_DEFAULT_AGE;
     char** input_files = NULL;
     int input_count = 0;
     int i;
@@ -248,8 +1010,6 @@ int main(int argc, char* argv[]) {
     int skipped_count = 0;
     int output_filename_allocated = 0;
     ftn_error_t error;
-    time_t now;
-    struct tm* tm_info;
     
     /* Parse command line arguments */
     for (i = 1; i < argc; i++) {
@@ -277,6 +1037,30 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             sent_dir = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--chrs") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: %s option requires a character set argument\n", argv[i]);
+                return 1;
+            }
+            chrs = argv[++i];
+        } else if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--listen") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: %s option requires an address argument\n", argv[i]);
+                return 1;
+            }
+            listen_target = argv[++i];
+        } else if (strcmp(argv[i], "-S") == 0 || strcmp(argv[i], "--max-size") == 0) {
+            if (i + 1 >= argc || (max_size = atol(argv[i + 1])) <= 58) {
+                fprintf(stderr, "Error: %s option requires a size in bytes\n", argv[i]);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-T") == 0 || strcmp(argv[i], "--max-age") == 0) {
+            if (i + 1 >= argc || (max_age = atoi(argv[i + 1])) <= 0) {
+                fprintf(stderr, "Error: %s option requires a number of seconds\n", argv[i]);
+                return 1;
+            }
+            i++;
         } else if (argv[i][0] == '-') {
             fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
             print_usage(argv[0]);
@@ -299,7 +1083,14 @@ int main(int argc, char* argv[]) {
         }
     }
     
-    if (!output_dir || input_count == 0) {
+    if (listen_target && (!output_dir || input_count > 0)) {
+        fprintf(stderr, "Error: Listener mode takes only an output directory\n");
+        print_usage(argv[0]);
+        free(input_files);
+        return 1;
+    }
+    
+    if (!listen_target && (!output_dir || input_count == 0)) {
         fprintf(stderr, "Error: Both output directory and input files are required\n");
         print_usage(argv[0]);
         free(input_files);
@@ -322,6 +1113,19 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (listen_target) {
+        gateway_t gw;
+        
+        memset(&gw, 0, sizeof(gw));
+        gw.output_dir = output_dir;
+        gw.domain = domain;
+        gw.network = network;
+        gw.chrs = chrs;
+        gw.max_size = (size_t)max_size;
+        gw.max_age = max_age;
+        return run_listener(&gw, listen_target);
+    }
+    
     /* Generate output filename */
     output_filename = generate_packet_filename(output_dir);
     if (!output_filename) {
@@ -353,25 +1157,12 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    /* Set packet creation time */
-    now = time(NULL);
-    tm_info = localtime(&now);
-    if (tm_info) {
-        packet->header.year = tm_info->tm_year + 1900;
-        packet->header.month = tm_info->tm_mon;
-        packet->header.day = tm_info->tm_mday;
-        packet->header.hour = tm_info->tm_hour;
-        packet->header.minute = tm_info->tm_min;
-        packet->header.second = tm_info->tm_sec;
-    }
-    
-    packet->header.packet_type = 0x0002;
-    
     /* Process each input file */
     for (i = 0; i < input_count; i++) {
         char* file_content = NULL;
-        rfc822_message_t* rfc_msg = NULL;
         ftn_message_t* ftn_msg = NULL;
+        char reason[128];
+        int result;
         
         printf("Processing: %s... ", input_files[i]);
         fflush(stdout);
@@ -384,109 +1175,23 @@ int main(int argc, char* argv[]) {
             continue;
         }
         
-        /* Parse RFC822 message */
-        error = rfc822_message_parse(file_content, &rfc_msg);
-        if (error != FTN_OK) {
-            printf("FAILED (parse error)\n");
-            free(file_content);
-            failed_count++;
+        result = convert_message(file_content, domain, network, chrs, &ftn_msg, reason, sizeof(reason));
+        free(file_content);
+        if (result == CONVERT_SKIPPED) {
+            printf("SKIPPED (%s)\n", reason);
+            skipped_count++;
             continue;
         }
-        
-        /* Check if it's a USENET article */
-        if (rfc822_message_get_header(rfc_msg, "Newsgroups")) {
-            /* This is a USENET article */
-            const char* newsgroups = rfc822_message_get_header(rfc_msg, "Newsgroups");
-            const char* from_header = rfc822_message_get_header(rfc_msg, "From");
-            int domain_match = 0;
-            
-            /* Check if From address matches domain */
-            if (from_header && strstr(from_header, domain)) {
-                domain_match = 1;
-            }
-            
-            /* Check if newsgroup matches domain pattern */
-            if (newsgroups) {
-                /* Extract network name from newsgroup (e.g., fidonet.* or fsxnet.*) */
-                char network_prefix[64];
-                const char* dot_pos = strchr(newsgroups, '.');
-                if (dot_pos) {
-                    size_t prefix_len = dot_pos - newsgroups;
-                    if (prefix_len < sizeof(network_prefix) - 1) {
-                        strlcpy(network_prefix, newsgroups, prefix_len + 1);
-                        /* Check if this matches our expected network */
-                        if (strstr(domain, network_prefix) || 
-                            (network && strcasecmp(network_prefix, network) == 0)) {
-                            domain_match = 1;
-                        }
-                    }
-                }
-            }
-            
-            if (!domain_match) {
-                printf("SKIPPED (network mismatch)\n");
-                rfc822_message_free(rfc_msg);
-                free(file_content);
-                skipped_count++;
-                continue;
-            }
-            
-            /* Use USENET conversion */
-            error = usenet_to_ftn(rfc_msg, network ? network : "fidonet", &ftn_msg);
-        } else {
-            /* Regular RFC822 email */
-            const char* from_header = rfc822_message_get_header(rfc_msg, "From");
-            const char* to_header = rfc822_message_get_header(rfc_msg, "To");
-            int from_match = 0;
-            int to_match = 0;
-            
-            /* Check if From and To addresses match domain */
-            if (from_header && strstr(from_header, domain)) {
-                from_match = 1;
-            }
-            if (to_header && strstr(to_header, domain)) {
-                to_match = 1;
-            }
-            
-            if (!from_match || !to_match) {
-                printf("SKIPPED (domain mismatch: From=%s, To=%s)\n", 
-                       from_match ? "match" : "no match",
-                       to_match ? "match" : "no match");
-                rfc822_message_free(rfc_msg);
-                free(file_content);
-                skipped_count++;
-                continue;
-            }
-            
-            /* Use standard conversion */
-            error = rfc822_to_ftn(rfc_msg, domain, &ftn_msg);
-        }
-        
-        if (error != FTN_OK) {
-            printf("FAILED (conversion error)\n");
-            rfc822_message_free(rfc_msg);
-            free(file_content);
+        if (result == CONVERT_FAILED) {
+            printf("FAILED (%s)\n", reason);
             failed_count++;
             continue;
         }
         
-        /* If network is specified, append it to addresses */
-        if (network && ftn_msg) {
-            /* Append network to INTL if present */
-            if (ftn_msg->intl) {
-                char new_intl[256];
-                snprintf(new_intl, sizeof(new_intl), "%s@%s", ftn_msg->intl, network);
-                free(ftn_msg->intl);
-                ftn_msg->intl = strdup(new_intl);
-            }
-        }
-        
         /* Check if message ID already exists in output directory */
         if (ftn_msg->msgid && message_id_exists(output_dir, ftn_msg->msgid)) {
             printf("SKIPPED (duplicate message ID: %s)\n", ftn_msg->msgid);
             ftn_message_free(ftn_msg);
-            rfc822_message_free(rfc_msg);
-            free(file_content);
             skipped_count++;
             continue;
         }
@@ -496,20 +1201,13 @@ int main(int argc, char* argv[]) {
         if (error != FTN_OK) {
             printf("FAILED (packet error)\n");
             ftn_message_free(ftn_msg);
-            rfc822_message_free(rfc_msg);
-            free(file_content);
             failed_count++;
             continue;
         }
         
-        /* Update packet header with zone information from first message */
+        /* Packet header comes from the first message */
         if (processed_count == 0) {
-            packet->header.orig_zone = ftn_msg->orig_addr.zone;
-            packet->header.orig_net = ftn_msg->orig_addr.net;
-            packet->header.orig_node = ftn_msg->orig_addr.node;
-            packet->header.dest_zone = ftn_msg->dest_addr.zone;
-            packet->header.dest_net = ftn_msg->dest_addr.net;
-            packet->header.dest_node = ftn_msg->dest_addr.node;
+            init_packet_header(&packet->header, ftn_msg);
         }
         
         printf("OK\n");
@@ -520,8 +1218,6 @@ int main(int argc, char* argv[]) {
             move_to_sent(input_files[i], sent_dir);
         }
         
-        rfc822_message_free(rfc_msg);
-        free(file_content);
         /* Note: ftn_msg is now owned by the packet and will be freed with it */
     }
     
@@ -558,4 +1254,4 @@ int main(int argc, char* argv[]) {
     }
     
     return (failed_count > 0) ? 1 : 0;
-}
\ No newline at end of file
+}
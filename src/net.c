@@ -29,6 +29,17 @@
 
 #include "ftn.h"
 #include "ftn/net.h"
+#include "ftn/log.h"
+#include "ftn/tls.h"
+#include "ftn/thread.h"
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/un.h>
+#endif
 
 #ifdef _WIN32
 #pragma comment(lib, "ws2_32.lib")
@@ -36,34 +47,64 @@
 
 static int ftn_net_initialized = 0;
 
+/* Guards initialization and the non-reentrant resolver */
+static ftn_mutex_t ftn_net_mutex = FTN_MUTEX_INITIALIZER;
+
 /* Network initialization and cleanup */
 ftn_error_t ftn_net_init(void) {
-    if (ftn_net_initialized) {
-        return FTN_OK;
-    }
-
 #ifdef _WIN32
     WSADATA wsaData;
-    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (result != 0) {
-        return FTN_ERROR_NETWORK;
-    }
 #endif
+    ftn_error_t error = FTN_OK;
 
-    ftn_net_initialized = 1;
-    return FTN_OK;
-}
-
-void ftn_net_cleanup(void) {
+    ftn_mutex_lock(&ftn_net_mutex);
     if (!ftn_net_initialized) {
-        return;
+#ifdef _WIN32
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            error = FTN_ERROR_NETWORK;
+        }
+#endif
+        if (error == FTN_OK) {
+            ftn_net_initialized = 1;
+        }
     }
+    ftn_mutex_unlock(&ftn_net_mutex);
+    return error;
+}
 
+void ftn_net_cleanup(void) {
+    ftn_mutex_lock(&ftn_net_mutex);
+    if (ftn_net_initialized) {
 #ifdef _WIN32
-    WSACleanup();
+        WSACleanup();
 #endif
+        ftn_net_initialized = 0;
+    }
+    ftn_mutex_unlock(&ftn_net_mutex);
+}
+
+/* Resolve a hostname to its first IPv4 address */
+static int ftn_net_lookup(const char* hostname, struct in_addr* address) {
+    struct hostent* host;
+    int found = 0;
+
+    /* gethostbyname returns static storage, so copy it out under the lock */
+    ftn_mutex_lock(&ftn_net_mutex);
+    host = gethostbyname(hostname);
+    if (host && host->h_addrtype == AF_INET && host->h_addr_list[0]) {
+        memcpy(address, host->h_addr_list[0], sizeof(struct in_addr));
+        found = 1;
+    }
+    ftn_mutex_unlock(&ftn_net_mutex);
+    return found;
+}
+
+/* Dotted-quad form of an IPv4 address, without inet_ntoa's static buffer */
+static void ftn_net_format_address(const struct in_addr* address, char* buffer, size_t size) {
+    unsigned long ip = (unsigned long)ntohl(address->s_addr);
 
-    ftn_net_initialized = 0;
+    snprintf(buffer, size, "%lu.%lu.%lu.%lu",
+             (ip >> 24) & 0xFF, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF);
 }
 
 /* Helper function to close socket */
@@ -113,11 +154,51 @@ static ftn_error_t ftn_net_set_socket_non_blocking(ftn_socket_t socket, int non_
     return FTN_OK;
 }
 
+/* Apply a tuning profile to a socket, trying every option before reporting failure */
+static ftn_error_t ftn_net_tune_socket(ftn_socket_t sock, const ftn_net_tuning_t* tuning) {
+    ftn_error_t result = FTN_OK;
+    size_t buffer_size;
+    int value;
+
+    buffer_size = ftn_net_tuning_buffer_size(tuning);
+    if (buffer_size > 0) {
+        value = (int)buffer_size;
+        if (setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (const char*)&value, sizeof(value)) < 0 ||
+            setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (const char*)&value, sizeof(value)) < 0) {
+            result = FTN_ERROR_NETWORK;
+        }
+    }
+
+#ifdef TCP_NOTSENT_LOWAT
+    if (tuning->notsent_lowat > 0) {
+        value = tuning->notsent_lowat;
+        if (setsockopt(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, (const char*)&value, sizeof(value)) < 0) {
+            result = FTN_ERROR_NETWORK;
+        }
+    }
+#endif
+
+#ifdef TCP_CONGESTION
+    if (tuning->congestion[0]) {
+        if (setsockopt(sock, IPPROTO_TCP, TCP_CONGESTION, tuning->congestion,
+                       (socklen_t)strlen(tuning->congestion)) < 0) {
+            /* The algorithm may not be loaded or allowed; the default still works */
+            result = FTN_ERROR_NETWORK;
+        }
+    }
+#endif
+
+    return result;
+}
+
 /* Connection management */
 ftn_net_connection_t* ftn_net_connect(const char* hostname, int port, int timeout_ms) {
+    return ftn_net_connect_tuned(hostname, port, timeout_ms, NULL);
+}
+
+ftn_net_connection_t* ftn_net_connect_tuned(const char* hostname, int port, int timeout_ms, const ftn_net_tuning_t* tuning) {
     ftn_net_connection_t* conn;
     struct sockaddr_in addr;
-    struct hostent* host;
     ftn_socket_t sock;
     int result;
 
@@ -125,10 +206,8 @@ ftn_net_connection_t* ftn_net_connect(const char* hostname, int port, int timeou
         return NULL;
     }
 
-    if (!ftn_net_initialized) {
-        if (ftn_net_init() != FTN_OK) {
-            return NULL;
-        }
+    if (ftn_net_init() != FTN_OK) {
+        return NULL;
     }
 
     /* Allocate connection structure */
@@ -154,19 +233,25 @@ ftn_net_connection_t* ftn_net_connect(const char* hostname, int port, int timeou
         return NULL;
     }
 
-    /* Resolve hostname */
-    host = gethostbyname(hostname);
-    if (!host) {
-        ftn_net_close_socket(sock);
-        ftn_net_connection_free(conn);
-        return NULL;
+    /* Buffer sizes must be set before connecting to take part in window scaling */
+    if (tuning) {
+        if (ftn_net_tune_socket(sock, tuning) != FTN_OK) {
+            logf_warning("Failed to tune socket for %s:%d: %s", hostname, port, strerror(errno));
+        }
+        conn->cork_frames = tuning->cork_frames;
     }
 
     /* Setup address structure */
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
     addr.sin_port = htons(port);
-    memcpy(&addr.sin_addr, host->h_addr_list[0], host->h_length);
+
+    /* Resolve hostname */
+    if (!ftn_net_lookup(hostname, &addr.sin_addr)) {
+        ftn_net_close_socket(sock);
+        ftn_net_connection_free(conn);
+        return NULL;
+    }
 
     /* Set socket non-blocking for timeout */
     if (timeout_ms > 0) {
@@ -228,11 +313,72 @@ ftn_net_connection_t* ftn_net_connect(const char* hostname, int port, int timeou
     return conn;
 }
 
+ftn_net_connection_t* ftn_net_connect_unix(const char* path, int timeout_ms) {
+#ifdef _WIN32
+    (void)path;
+    (void)timeout_ms;
+    return NULL;
+#else
+    ftn_net_connection_t* conn;
+    struct sockaddr_un addr;
+    ftn_socket_t sock;
+
+    if (!path || strlen(path) >= sizeof(addr.sun_path)) {
+        return NULL;
+    }
+
+    conn = malloc(sizeof(ftn_net_connection_t));
+    if (!conn) {
+        return NULL;
+    }
+
+    memset(conn, 0, sizeof(ftn_net_connection_t));
+    conn->socket = FTN_INVALID_SOCKET;
+    conn->hostname = malloc(strlen(path) + 1);
+    if (!conn->hostname) {
+        free(conn);
+        return NULL;
+    }
+    strcpy(conn->hostname, path);
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == FTN_INVALID_SOCKET) {
+        ftn_net_connection_free(conn);
+        return NULL;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    /* Local connects complete or fail at once, so no timeout is needed here */
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        ftn_net_close_socket(sock);
+        ftn_net_connection_free(conn);
+        return NULL;
+    }
+
+    conn->socket = sock;
+    conn->connected = 1;
+    conn->connect_time = time(NULL);
+
+    if (timeout_ms > 0) {
+        ftn_net_set_timeout(conn, timeout_ms);
+    }
+
+    return conn;
+#endif
+}
+
 ftn_error_t ftn_net_disconnect(ftn_net_connection_t* conn) {
     if (!conn) {
         return FTN_ERROR_INVALID_PARAMETER;
     }
 
+    if (conn->tls) {
+        ftn_tls_close(conn);
+    }
+
     if (conn->socket != FTN_INVALID_SOCKET) {
         ftn_net_close_socket(conn->socket);
         conn->socket = FTN_INVALID_SOCKET;
@@ -268,6 +414,14 @@ ftn_error_t ftn_net_send(ftn_net_connection_t* conn, const void* data, size_t le
         return FTN_ERROR_NOT_CONNECTED;
     }
 
+    if (conn->tls) {
+        ftn_error_t tls_result = ftn_tls_send(conn, data, len, bytes_sent);
+        if (tls_result == FTN_OK) {
+            conn->bytes_sent += *bytes_sent;
+        }
+        return tls_result;
+    }
+
     result = send(conn->socket, (const char*)data, len, 0);
     if (result == -1) {
         int error = ftn_net_get_socket_error();
@@ -298,6 +452,14 @@ ftn_error_t ftn_net_recv(ftn_net_connection_t* conn, void* buffer, size_t len, s
         return FTN_ERROR_NOT_CONNECTED;
     }
 
+    if (conn->tls) {
+        ftn_error_t tls_result = ftn_tls_recv(conn, buffer, len, bytes_received);
+        if (tls_result == FTN_OK) {
+            conn->bytes_received += *bytes_received;
+        }
+        return tls_result;
+    }
+
     result = recv(conn->socket, (char*)buffer, len, 0);
     if (result == -1) {
         int error = ftn_net_get_socket_error();
@@ -348,6 +510,76 @@ ftn_error_t ftn_net_send_all(ftn_net_connection_t* conn, const void* data, size_
     return FTN_OK;
 }
 
+ftn_error_t ftn_net_sendfile(ftn_net_connection_t* conn, int fd, long offset, size_t len, size_t* bytes_sent) {
+    ftn_error_t result;
+
+    if (!conn || fd < 0 || offset < 0 || !bytes_sent) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    if (!conn->connected || conn->socket == FTN_INVALID_SOCKET) {
+        return FTN_ERROR_NOT_CONNECTED;
+    }
+
+    *bytes_sent = 0;
+
+    if (conn->tls) {
+        result = ftn_tls_sendfile(conn, fd, offset, len, bytes_sent);
+    } else {
+#if defined(__linux__)
+        /* File pages go to the socket without passing through user space */
+        off_t position = (off_t)offset;
+        ssize_t sent;
+
+        result = FTN_OK;
+        while (*bytes_sent < len) {
+            sent = sendfile(conn->socket, fd, &position, len - *bytes_sent);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                result = (errno == EAGAIN) ? FTN_ERROR_WOULD_BLOCK : FTN_ERROR_NETWORK;
+                break;
+            }
+            if (sent == 0) {
+                break;
+            }
+            *bytes_sent += (size_t)sent;
+        }
+#elif !defined(_WIN32)
+        char buffer[16384];
+        ssize_t got;
+        size_t chunk;
+
+        result = FTN_OK;
+        while (*bytes_sent < len && result == FTN_OK) {
+            chunk = len - *bytes_sent;
+            if (chunk > sizeof(buffer)) {
+                chunk = sizeof(buffer);
+            }
+            got = pread(fd, buffer, chunk, (off_t)(offset + (long)*bytes_sent));
+            if (got <= 0) {
+                if (got < 0) {
+                    result = FTN_ERROR_FILE_IO;
+                }
+                break;
+            }
+            result = ftn_net_send_all(conn, buffer, (size_t)got);
+            if (result == FTN_OK) {
+                *bytes_sent += (size_t)got;
+            }
+        }
+        /* ftn_net_send_all already counted the bytes */
+        return result;
+#else
+        result = FTN_ERROR_INVALID_PARAMETER;
+#endif
+    }
+
+    conn->bytes_sent += *bytes_sent;
+    return result;
+}
+
 ftn_error_t ftn_net_recv_all(ftn_net_connection_t* conn, void* buffer, size_t len) {
     char* ptr = (char*)buffer;
     size_t remaining = len;
@@ -464,10 +696,8 @@ ftn_net_server_t* ftn_net_listen(int port, const char* bind_address, int max_con
         return NULL;
     }
 
-    if (!ftn_net_initialized) {
-        if (ftn_net_init() != FTN_OK) {
-            return NULL;
-        }
+    if (ftn_net_init() != FTN_OK) {
+        return NULL;
     }
 
     /* Allocate server structure */
@@ -535,10 +765,74 @@ ftn_net_server_t* ftn_net_listen(int port, const char* bind_address, int max_con
     return server;
 }
 
+ftn_net_server_t* ftn_net_listen_unix(const char* path, int max_connections) {
+#ifdef _WIN32
+    (void)path;
+    (void)max_connections;
+    return NULL;
+#else
+    ftn_net_server_t* server;
+    struct sockaddr_un addr;
+    ftn_socket_t sock;
+
+    if (!path || strlen(path) >= sizeof(addr.sun_path) || max_connections <= 0) {
+        return NULL;
+    }
+
+    server = malloc(sizeof(ftn_net_server_t));
+    if (!server) {
+        return NULL;
+    }
+
+    memset(server, 0, sizeof(ftn_net_server_t));
+    server->socket = FTN_INVALID_SOCKET;
+    server->max_connections = max_connections;
+    server->bind_address = malloc(strlen(path) + 1);
+    if (!server->bind_address) {
+        free(server);
+        return NULL;
+    }
+    strcpy(server->bind_address, path);
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == FTN_INVALID_SOCKET) {
+        ftn_net_server_free(server);
+        return NULL;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    /* A socket left behind by an earlier run would make bind fail */
+    unlink(path);
+
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        ftn_net_close_socket(sock);
+        ftn_net_server_free(server);
+        return NULL;
+    }
+
+    if (listen(sock, max_connections) < 0) {
+        ftn_net_close_socket(sock);
+        unlink(path);
+        ftn_net_server_free(server);
+        return NULL;
+    }
+
+    server->socket = sock;
+    server->listening = 1;
+    server->unix_socket = 1;
+
+    return server;
+#endif
+}
+
 ftn_net_connection_t* ftn_net_accept(ftn_net_server_t* server, int timeout_ms) {
     ftn_net_connection_t* conn;
-    struct sockaddr_in client_addr;
-    socklen_t addr_len = sizeof(client_addr);
+    struct sockaddr_storage client_storage;
+    struct sockaddr_in* client_in = (struct sockaddr_in*)&client_storage;
+    socklen_t addr_len = sizeof(client_storage);
     ftn_socket_t client_sock;
 
     if (!server || !server->listening) {
@@ -565,7 +859,7 @@ ftn_net_connection_t* ftn_net_accept(ftn_net_server_t* server, int timeout_ms) {
     }
 
     /* Accept connection */
-    client_sock = accept(server->socket, (struct sockaddr*)&client_addr, &addr_len);
+    client_sock = accept(server->socket, (struct sockaddr*)&client_storage, &addr_len);
     if (client_sock == FTN_INVALID_SOCKET) {
         return NULL;
     }
@@ -582,21 +876,45 @@ ftn_net_connection_t* ftn_net_accept(ftn_net_server_t* server, int timeout_ms) {
     conn->connected = 1;
     conn->connect_time = time(NULL);
 
-    /* Get client hostname */
-    {
-        char* client_ip = inet_ntoa(client_addr.sin_addr);
-        if (client_ip) {
-            conn->hostname = malloc(strlen(client_ip) + 1);
-            if (conn->hostname) {
-                strcpy(conn->hostname, client_ip);
-            }
+    /* Buffers are inherited from the listening socket; the rest is per connection */
+    if (server->has_tuning) {
+        if (ftn_net_tune_socket(client_sock, &server->tuning) != FTN_OK) {
+            logf_warning("Failed to tune accepted socket: %s", strerror(errno));
+        }
+        conn->cork_frames = server->tuning.cork_frames;
+    }
+
+    /* Get client hostname; local clients are named after the socket */
+    if (client_storage.ss_family == AF_INET) {
+        char client_ip[16];
+        ftn_net_format_address(&client_in->sin_addr, client_ip, sizeof(client_ip));
+        conn->hostname = malloc(strlen(client_ip) + 1);
+        if (conn->hostname) {
+            strcpy(conn->hostname, client_ip);
+        }
+        conn->port = ntohs(client_in->sin_port);
+    } else if (server->bind_address) {
+        conn->hostname = malloc(strlen(server->bind_address) + 1);
+        if (conn->hostname) {
+            strcpy(conn->hostname, server->bind_address);
         }
     }
-    conn->port = ntohs(client_addr.sin_port);
 
     return conn;
 }
 
+ftn_error_t ftn_net_server_set_tuning(ftn_net_server_t* server, const ftn_net_tuning_t* tuning) {
+    if (!server || !tuning || server->socket == FTN_INVALID_SOCKET) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    server->tuning = *tuning;
+    server->has_tuning = 1;
+
+    /* Accepted sockets take their buffer sizes from the listening socket */
+    return ftn_net_tune_socket(server->socket, tuning);
+}
+
 void ftn_net_server_free(ftn_net_server_t* server) {
     if (!server) {
         return;
@@ -607,6 +925,11 @@ void ftn_net_server_free(ftn_net_server_t* server) {
     }
 
     if (server->bind_address) {
+#ifndef _WIN32
+        if (server->unix_socket) {
+            unlink(server->bind_address);
+        }
+#endif
         free(server->bind_address);
     }
 
@@ -665,38 +988,88 @@ ftn_error_t ftn_net_set_timeout(ftn_net_connection_t* conn, int timeout_ms) {
     return FTN_OK;
 }
 
+/* Socket tuning */
+void ftn_net_tuning_init(ftn_net_tuning_t* tuning) {
+    if (tuning) {
+        memset(tuning, 0, sizeof(ftn_net_tuning_t));
+    }
+}
+
+size_t ftn_net_tuning_buffer_size(const ftn_net_tuning_t* tuning) {
+    double bdp;
+
+    if (!tuning || tuning->bandwidth_kbps == 0 || tuning->rtt_ms == 0) {
+        return 0;
+    }
+
+    /* kbit/s * ms / 8 = bytes in flight */
+    bdp = (double)tuning->bandwidth_kbps * (double)tuning->rtt_ms / 8.0;
+    if (bdp < FTN_NET_MIN_BUFFER) {
+        return FTN_NET_MIN_BUFFER;
+    }
+    if (bdp > FTN_NET_MAX_BUFFER) {
+        return FTN_NET_MAX_BUFFER;
+    }
+    return (size_t)bdp;
+}
+
+ftn_error_t ftn_net_apply_tuning(ftn_net_connection_t* conn, const ftn_net_tuning_t* tuning) {
+    if (!conn || !tuning || conn->socket == FTN_INVALID_SOCKET) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    conn->cork_frames = tuning->cork_frames;
+    return ftn_net_tune_socket(conn->socket, tuning);
+}
+
+ftn_error_t ftn_net_set_cork(ftn_net_connection_t* conn, int enable) {
+    if (!conn || conn->socket == FTN_INVALID_SOCKET) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    enable = enable ? 1 : 0;
+    if (conn->corked == enable) {
+        return FTN_OK;
+    }
+
+#if defined(TCP_CORK)
+    if (setsockopt(conn->socket, IPPROTO_TCP, TCP_CORK, (const char*)&enable, sizeof(enable)) < 0) {
+        return FTN_ERROR_NETWORK;
+    }
+#elif defined(TCP_NOPUSH)
+    if (setsockopt(conn->socket, IPPROTO_TCP, TCP_NOPUSH, (const char*)&enable, sizeof(enable)) < 0) {
+        return FTN_ERROR_NETWORK;
+    }
+#endif
+
+    conn->corked = enable;
+    return FTN_OK;
+}
+
 /* Utility functions */
 ftn_error_t ftn_net_resolve_hostname(const char* hostname, char* ip_buffer, size_t buffer_size) {
-    struct hostent* host;
+    struct in_addr address;
+    char ip[16];
 
     if (!hostname || !ip_buffer || buffer_size == 0) {
         return FTN_ERROR_INVALID_PARAMETER;
     }
 
-    if (!ftn_net_initialized) {
-        if (ftn_net_init() != FTN_OK) {
-            return FTN_ERROR_NETWORK;
-        }
+    if (ftn_net_init() != FTN_OK) {
+        return FTN_ERROR_NETWORK;
     }
 
-    host = gethostbyname(hostname);
-    if (!host) {
+    if (!ftn_net_lookup(hostname, &address)) {
         return FTN_ERROR_NETWORK;
     }
 
-    {
-        char* ip = inet_ntoa(*((struct in_addr*)host->h_addr_list[0]));
-        if (!ip) {
-            return FTN_ERROR_NETWORK;
-        }
-
-        if (strlen(ip) >= buffer_size) {
-            return FTN_ERROR_BUFFER_TOO_SMALL;
-        }
-
-        strcpy(ip_buffer, ip);
-        return FTN_OK;
+    ftn_net_format_address(&address, ip, sizeof(ip));
+    if (strlen(ip) >= buffer_size) {
+        return FTN_ERROR_BUFFER_TOO_SMALL;
     }
+
+    strcpy(ip_buffer, ip);
+    return FTN_OK;
 }
 
 const char* ftn_net_get_error_string(ftn_error_t error) {
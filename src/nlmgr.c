@@ -0,0 +1,443 @@
+/*
+ * nlmgr.c - Nodelist manager with hot reload for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/nlmgr.h"
+#include "ftn/thread.h"
+#include "ftn/log.h"
+
+#if !defined(FTN_NO_THREADS) && !defined(_WIN32)
+#define NLMGR_THREADS
+#include <pthread.h>
+#endif
+
+/* A nodelist being parsed for the manager */
+struct ftn_nodelist_build {
+    char* file;
+    time_t mtime;
+    long size;
+    ftn_nodelist_t* nodelist;
+    ftn_error_t result;
+    int done;                       /* Guarded by build_mutex */
+#ifdef NLMGR_THREADS
+    pthread_t thread;
+    int threaded;
+#endif
+};
+
+static ftn_mutex_t build_mutex = FTN_MUTEX_INITIALIZER;
+
+/* Guards current against acquire(), the reader counts and the retired list */
+static ftn_mutex_t reader_mutex = FTN_MUTEX_INITIALIZER;
+
+static char* nlmgr_strdup(const char* str) {
+    char* result = malloc(strlen(str) + 1);
+    if (result) {
+        strcpy(result, str);
+    }
+    return result;
+}
+
+/* NODELIST.nnn, the day-of-year extension of a weekly nodelist */
+static int nlmgr_is_nodelist_name(const char* name) {
+    const char* prefix = "nodelist.";
+    const char* p;
+
+    for (p = prefix; *p; p++, name++) {
+        if (tolower((unsigned char)*name) != *p) {
+            return 0;
+        }
+    }
+    if (!*name) {
+        return 0;
+    }
+    for (; *name; name++) {
+        if (!isdigit((unsigned char)*name)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+char* ftn_nodelist_manager_locate(const char* path, time_t* mtime, long* size) {
+    struct stat st;
+    DIR* dir;
+    struct dirent* entry;
+    char* best = NULL;
+    time_t best_mtime = 0;
+    long best_size = 0;
+
+    if (!path || stat(path, &st) != 0) {
+        return NULL;
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        if (mtime) *mtime = st.st_mtime;
+        if (size) *size = (long)st.st_size;
+        return nlmgr_strdup(path);
+    }
+
+    dir = opendir(path);
+    if (!dir) {
+        return NULL;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        char* candidate;
+
+        if (!nlmgr_is_nodelist_name(entry->d_name)) {
+            continue;
+        }
+        candidate = malloc(strlen(path) + strlen(entry->d_name) + 2);
+        if (!candidate) {
+            break;
+        }
+        sprintf(candidate, "%s/%s", path, entry->d_name);
+
+        /* Newest file wins; on a tie, the later name */
+        if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) &&
+            (!best || st.st_mtime > best_mtime ||
+             (st.st_mtime == best_mtime && strcmp(candidate, best) > 0))) {
+            free(best);
+            best = candidate;
+            best_mtime = st.st_mtime;
+            best_size = (long)st.st_size;
+        } else {
+            free(candidate);
+        }
+    }
+    closedir(dir);
+
+    if (best) {
+        if (mtime) *mtime = best_mtime;
+        if (size) *size = best_size;
+    }
+    return best;
+}
+
+/* Parse the nodelist; runs in the build thread when there is one */
+static void* nlmgr_build_run(void* arg) {
+    struct ftn_nodelist_build* build = (struct ftn_nodelist_build*)arg;
+
+    build->result = ftn_nodelist_load(build->file, &build->nodelist);
+    if (build->result == FTN_OK && build->nodelist->count == 0) {
+        /* Most likely a file still being written; keep what we have */
+        ftn_nodelist_free(build->nodelist);
+        build->nodelist = NULL;
+        build->result = FTN_ERROR_PARSE;
+    }
+
+    ftn_mutex_lock(&build_mutex);
+    build->done = 1;
+    ftn_mutex_unlock(&build_mutex);
+    return NULL;
+}
+
+static void nlmgr_build_free(struct ftn_nodelist_build* build) {
+    if (!build) return;
+
+    if (build->nodelist) {
+        ftn_nodelist_free(build->nodelist);
+    }
+    free(build->file);
+    free(build);
+}
+
+/* Takes ownership of file */
+static struct ftn_nodelist_build* nlmgr_build_new(char* file, time_t mtime, long size) {
+    struct ftn_nodelist_build* build;
+
+    build = malloc(sizeof(struct ftn_nodelist_build));
+    if (!build) {
+        free(file);
+        return NULL;
+    }
+    memset(build, 0, sizeof(struct ftn_nodelist_build));
+    build->file = file;
+    build->mtime = mtime;
+    build->size = size;
+    return build;
+}
+
+static void nlmgr_start_build(ftn_nodelist_manager_t* mgr, char* file, time_t mtime, long size) {
+    struct ftn_nodelist_build* build = nlmgr_build_new(file, mtime, size);
+
+    if (!build) {
+        return;
+    }
+    mgr->build = build;
+
+#ifdef NLMGR_THREADS
+    if (pthread_create(&build->thread, NULL, nlmgr_build_run, build) == 0) {
+        build->threaded = 1;
+        return;
+    }
+    log_warning("Could not start nodelist build thread, loading in the foreground");
+#endif
+    nlmgr_build_run(build);
+}
+
+static void nlmgr_build_join(struct ftn_nodelist_build* build) {
+#ifdef NLMGR_THREADS
+    if (build->threaded) {
+        pthread_join(build->thread, NULL);
+    }
+#else
+    (void)build;
+#endif
+}
+
+/* Make a finished build the current index */
+static int nlmgr_finish_build(ftn_nodelist_manager_t* mgr) {
+    struct ftn_nodelist_build* build = mgr->build;
+    ftn_nodelist_hold_t* hold = NULL;
+    ftn_nodelist_t* old;
+    int replaced;
+
+    mgr->build = NULL;
+    nlmgr_build_join(build);
+
+    if (build->result != FTN_OK) {
+        logf_warning("Failed to load nodelist: %s", build->file);
+        free(mgr->failed_file);
+        mgr->failed_file = build->file;
+        mgr->failed_mtime = build->mtime;
+        mgr->failed_size = build->size;
+        build->file = NULL;
+        nlmgr_build_free(build);
+        return 0;
+    }
+
+    /* Allocated up front so the old index can always be kept for its readers */
+    old = mgr->current;
+    replaced = old != NULL;
+    if (old) {
+        hold = malloc(sizeof(ftn_nodelist_hold_t));
+        if (!hold) {
+            log_error("Out of memory publishing the new nodelist");
+            nlmgr_build_free(build);
+            return 0;
+        }
+    }
+
+    ftn_mutex_lock(&reader_mutex);
+    ftn_atomic_store_ptr((void**)&mgr->current, build->nodelist);
+    if (old && mgr->readers > 0) {
+        hold->nodelist = old;
+        hold->readers = mgr->readers;
+        hold->next = mgr->retired;
+        mgr->retired = hold;
+        old = NULL;
+        hold = NULL;
+    }
+    mgr->readers = 0;
+    ftn_mutex_unlock(&reader_mutex);
+
+    /* Nobody took a reference, so only the owner's get() could see it */
+    if (old) {
+        ftn_nodelist_free(old);
+    }
+    free(hold);
+
+    logf_info("Loaded nodelist %s with %lu entries", build->file,
+              (unsigned long)build->nodelist->count);
+
+    free(mgr->file);
+    mgr->file = build->file;
+    mgr->file_mtime = build->mtime;
+    mgr->file_size = build->size;
+    if (replaced) {
+        mgr->reloads++;
+    }
+
+    build->file = NULL;
+    build->nodelist = NULL;
+    nlmgr_build_free(build);
+    return 1;
+}
+
+static int nlmgr_same_file(const char* file, time_t mtime, long size,
+                           const char* known, time_t known_mtime, long known_size) {
+    return known && strcmp(file, known) == 0 && mtime == known_mtime && size == known_size;
+}
+
+ftn_nodelist_manager_t* ftn_nodelist_manager_new(const char* path, int interval) {
+    ftn_nodelist_manager_t* mgr;
+
+    if (!path) {
+        return NULL;
+    }
+
+    mgr = malloc(sizeof(ftn_nodelist_manager_t));
+    if (!mgr) {
+        return NULL;
+    }
+    memset(mgr, 0, sizeof(ftn_nodelist_manager_t));
+
+    mgr->path = nlmgr_strdup(path);
+    if (!mgr->path) {
+        free(mgr);
+        return NULL;
+    }
+    mgr->interval = interval > 0 ? interval : FTN_NODELIST_CHECK_INTERVAL;
+
+    /* The first nodelist is loaded before the manager is handed out */
+    {
+        time_t mtime = 0;
+        long size = 0;
+        char* file = ftn_nodelist_manager_locate(path, &mtime, &size);
+
+        if (file) {
+            mgr->build = nlmgr_build_new(file, mtime, size);
+            if (mgr->build) {
+                nlmgr_build_run(mgr->build);
+                nlmgr_finish_build(mgr);
+            }
+        } else {
+            logf_warning("No nodelist found at %s", path);
+        }
+    }
+
+    mgr->next_check = time(NULL) + mgr->interval;
+    return mgr;
+}
+
+void ftn_nodelist_manager_free(ftn_nodelist_manager_t* mgr) {
+    if (!mgr) return;
+
+    if (mgr->build) {
+        nlmgr_build_join(mgr->build);
+        nlmgr_build_free(mgr->build);
+    }
+    if (mgr->current) {
+        ftn_nodelist_free(mgr->current);
+    }
+    while (mgr->retired) {
+        ftn_nodelist_hold_t* next = mgr->retired->next;
+
+        ftn_nodelist_free(mgr->retired->nodelist);
+        free(mgr->retired);
+        mgr->retired = next;
+    }
+    free(mgr->path);
+    free(mgr->file);
+    free(mgr->failed_file);
+    free(mgr);
+}
+
+ftn_nodelist_t* ftn_nodelist_manager_get(const ftn_nodelist_manager_t* mgr) {
+    if (!mgr) return NULL;
+    return (ftn_nodelist_t*)ftn_atomic_load_ptr((void* const*)&mgr->current);
+}
+
+ftn_nodelist_t* ftn_nodelist_manager_acquire(ftn_nodelist_manager_t* mgr) {
+    ftn_nodelist_t* nodelist;
+
+    if (!mgr) return NULL;
+
+    ftn_mutex_lock(&reader_mutex);
+    nodelist = mgr->current;
+    if (nodelist) {
+        mgr->readers++;
+    }
+    ftn_mutex_unlock(&reader_mutex);
+    return nodelist;
+}
+
+void ftn_nodelist_manager_release(ftn_nodelist_manager_t* mgr, ftn_nodelist_t* nodelist) {
+    ftn_nodelist_hold_t** link;
+    ftn_nodelist_hold_t* done = NULL;
+
+    if (!mgr || !nodelist) return;
+
+    ftn_mutex_lock(&reader_mutex);
+    if (nodelist == mgr->current) {
+        if (mgr->readers > 0) {
+            mgr->readers--;
+        }
+    } else {
+        for (link = &mgr->retired; *link; link = &(*link)->next) {
+            if ((*link)->nodelist == nodelist) {
+                if (--(*link)->readers == 0) {
+                    done = *link;
+                    *link = done->next;
+                }
+                break;
+            }
+        }
+    }
+    ftn_mutex_unlock(&reader_mutex);
+
+    /* The last reader of a replaced index frees it */
+    if (done) {
+        ftn_nodelist_free(done->nodelist);
+        free(done);
+    }
+}
+
+int ftn_nodelist_manager_check(ftn_nodelist_manager_t* mgr, time_t now) {
+    int published = 0;
+
+    if (!mgr) return 0;
+
+    if (mgr->build) {
+        int done;
+
+        ftn_mutex_lock(&build_mutex);
+        done = mgr->build->done;
+        ftn_mutex_unlock(&build_mutex);
+        if (!done) {
+            return 0;
+        }
+        published = nlmgr_finish_build(mgr);
+    }
+
+    if (now >= mgr->next_check) {
+        time_t mtime = 0;
+        long size = 0;
+        char* file;
+
+        mgr->next_check = now + mgr->interval;
+        file = ftn_nodelist_manager_locate(mgr->path, &mtime, &size);
+        if (file && !nlmgr_same_file(file, mtime, size, mgr->file, mgr->file_mtime, mgr->file_size) &&
+            !nlmgr_same_file(file, mtime, size, mgr->failed_file, mgr->failed_mtime, mgr->failed_size)) {
+            logf_debug("Nodelist changed, rebuilding from %s", file);
+            nlmgr_start_build(mgr, file, mtime, size);
+        } else {
+            free(file);
+        }
+    }
+
+    return published;
+}
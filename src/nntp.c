@@ -0,0 +1,310 @@
+/*
+ * nntp.c - Streaming NNTP feed client for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ftn.h"
+#include "ftn/nntp.h"
+#include "ftn/net.h"
+#include "ftn/log.h"
+
+/* Feed lifecycle */
+ftn_nntp_feed_t* ftn_nntp_feed_new(const char* target, size_t window, size_t batch_size) {
+    ftn_nntp_feed_t* feed;
+
+    if (!target || !*target) {
+        return NULL;
+    }
+
+    feed = malloc(sizeof(ftn_nntp_feed_t));
+    if (!feed) {
+        return NULL;
+    }
+    memset(feed, 0, sizeof(ftn_nntp_feed_t));
+
+    feed->window = window > 0 ? window : FTN_NNTP_DEFAULT_WINDOW;
+    feed->batch_size = batch_size > 0 ? batch_size : FTN_NNTP_DEFAULT_BATCH;
+    feed->pending = malloc(feed->window * sizeof(ftn_nntp_pending_t));
+    if (ftn_textproto_init(&feed->proto, "NNTP", target) != FTN_OK || !feed->pending) {
+        ftn_nntp_feed_free(feed);
+        return NULL;
+    }
+
+    return feed;
+}
+
+void ftn_nntp_feed_free(ftn_nntp_feed_t* feed) {
+    if (!feed) return;
+
+    ftn_nntp_disconnect(feed);
+    ftn_nntp_clear(feed);
+    free(feed->queue);
+    free(feed->pending);
+    ftn_textproto_free(&feed->proto);
+    free(feed);
+}
+
+/* Replies are single lines, so there is no keyword to look for */
+static ftn_error_t nntp_read_reply(ftn_nntp_feed_t* feed, int* code) {
+    return ftn_textproto_read_reply(&feed->proto, code, NULL, NULL);
+}
+
+/* Connection management */
+ftn_error_t ftn_nntp_connect(ftn_nntp_feed_t* feed) {
+    int code;
+
+    if (!feed) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    if (feed->proto.conn) {
+        return FTN_OK;
+    }
+
+    feed->pending_head = 0;
+    feed->pending_count = 0;
+    if (ftn_textproto_connect(&feed->proto, FTN_NNTP_DEFAULT_PORT, FTN_NNTP_TIMEOUT_MS) != FTN_OK) {
+        return FTN_ERROR_NETWORK;
+    }
+
+    /* 200 or 201 greeting, then switch to streaming */
+    if (nntp_read_reply(feed, &code) != FTN_OK || (code != 200 && code != 201)) {
+        goto fail;
+    }
+    if (ftn_textproto_append_command(&feed->proto, "MODE STREAM", NULL) != FTN_OK ||
+        ftn_textproto_write(&feed->proto) != FTN_OK ||
+        nntp_read_reply(feed, &code) != FTN_OK) {
+        goto fail;
+    }
+    if (code != 203) {
+        logf_error("NNTP: %s does not support streaming: %s", feed->proto.target, feed->proto.last_reply);
+        goto fail;
+    }
+
+    feed->connections++;
+    logf_debug("NNTP: streaming to %s", feed->proto.target);
+    return FTN_OK;
+
+fail:
+    logf_error("NNTP: %s refused the feed: %s", feed->proto.target, feed->proto.last_reply);
+    ftn_textproto_close(&feed->proto);
+    return FTN_ERROR_NETWORK;
+}
+
+void ftn_nntp_disconnect(ftn_nntp_feed_t* feed) {
+    int code;
+
+    if (!feed || !feed->proto.conn) {
+        return;
+    }
+
+    feed->proto.out_len = 0;
+    if (((ftn_net_connection_t*)feed->proto.conn)->connected &&
+        ftn_textproto_append_command(&feed->proto, "QUIT", NULL) == FTN_OK &&
+        ftn_textproto_write(&feed->proto) == FTN_OK) {
+        nntp_read_reply(feed, &code);
+    }
+    ftn_textproto_close(&feed->proto);
+}
+
+/* Queue management */
+ftn_error_t ftn_nntp_queue(ftn_nntp_feed_t* feed, const char* message_id, const char* area,
+                           const char* network, char* text) {
+    ftn_nntp_article_t* article;
+
+    if (!feed || !message_id || !text) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    if (feed->queue_count >= feed->queue_capacity) {
+        size_t capacity = feed->queue_capacity ? feed->queue_capacity * 2 : feed->batch_size;
+        ftn_nntp_article_t* queue = realloc(feed->queue, capacity * sizeof(ftn_nntp_article_t));
+        if (!queue) {
+            return FTN_ERROR_NOMEM;
+        }
+        feed->queue = queue;
+        feed->queue_capacity = capacity;
+    }
+
+    article = &feed->queue[feed->queue_count];
+    memset(article, 0, sizeof(ftn_nntp_article_t));
+    article->message_id = ftn_textproto_strdup(message_id);
+    article->area = ftn_textproto_strdup(area);
+    article->network = ftn_textproto_strdup(network);
+    if (!article->message_id || (area && !article->area) || (network && !article->network)) {
+        free(article->message_id);
+        free(article->area);
+        free(article->network);
+        return FTN_ERROR_NOMEM;
+    }
+    article->text = text;
+    feed->queue_count++;
+    return FTN_OK;
+}
+
+int ftn_nntp_queue_full(const ftn_nntp_feed_t* feed) {
+    return feed && feed->queue_count >= feed->batch_size;
+}
+
+/* The server has made up its mind: it took the article, already had it or refused it */
+int ftn_nntp_done(const ftn_nntp_article_t* article) {
+    return article && (article->status == 239 || article->status == 438 || article->status == 439);
+}
+
+void ftn_nntp_clear(ftn_nntp_feed_t* feed) {
+    size_t i;
+
+    if (!feed) return;
+
+    for (i = 0; i < feed->queue_count; i++) {
+        free(feed->queue[i].message_id);
+        free(feed->queue[i].area);
+        free(feed->queue[i].network);
+        free(feed->queue[i].text);
+    }
+    feed->queue_count = 0;
+}
+
+static void nntp_push(ftn_nntp_feed_t* feed, int takethis, size_t article) {
+    ftn_nntp_pending_t* slot;
+
+    slot = &feed->pending[(feed->pending_head + feed->pending_count) % feed->window];
+    slot->takethis = takethis;
+    slot->article = article;
+    feed->pending_count++;
+}
+
+static ftn_nntp_pending_t nntp_pop(ftn_nntp_feed_t* feed) {
+    ftn_nntp_pending_t slot = feed->pending[feed->pending_head];
+
+    feed->pending_head = (feed->pending_head + 1) % feed->window;
+    feed->pending_count--;
+    return slot;
+}
+
+/* Offer the queue from article `first` on. Up to `window` CHECK and
+   TAKETHIS commands are in flight at once; replies come back in order,
+   and each wanted CHECK is answered with its TAKETHIS right away. */
+static ftn_error_t nntp_transfer(ftn_nntp_feed_t* feed, size_t first) {
+    ftn_nntp_article_t* article;
+    ftn_nntp_pending_t done;
+    ftn_error_t result;
+    size_t next = first;
+    int code;
+
+    while (next < feed->queue_count || feed->pending_count > 0) {
+        while (feed->pending_count < feed->window && next < feed->queue_count) {
+            if (feed->queue[next].status == 0) {
+                if ((result = ftn_textproto_append_command(&feed->proto, "CHECK ", feed->queue[next].message_id)) != FTN_OK) {
+                    return result;
+                }
+                nntp_push(feed, 0, next);
+            }
+            next++;
+        }
+        /* Only go back to the socket once every buffered reply is handled */
+        if (feed->pending_count == 0 || !ftn_textproto_reply_buffered(&feed->proto)) {
+            if ((result = ftn_textproto_write(&feed->proto)) != FTN_OK) {
+                return result;
+            }
+        }
+        if (feed->pending_count == 0) {
+            continue;
+        }
+
+        if ((result = nntp_read_reply(feed, &code)) != FTN_OK) {
+            return result;
+        }
+        done = nntp_pop(feed);
+        article = &feed->queue[done.article];
+
+        if (!done.takethis && code == 238) {
+            /* Wanted: the article takes the freed slot */
+            if ((result = ftn_textproto_append_command(&feed->proto, "TAKETHIS ", article->message_id)) != FTN_OK ||
+                (result = ftn_textproto_append_dotted(&feed->proto, article->text)) != FTN_OK) {
+                return result;
+            }
+            nntp_push(feed, 1, done.article);
+            continue;
+        }
+
+        article->status = code;
+        switch (code) {
+            case 239:
+                feed->accepted++;
+                break;
+            case 438:
+                feed->refused++;
+                break;
+            case 431:
+                feed->deferred++;
+                break;
+            case 439:
+                feed->rejected++;
+                logf_warning("NNTP: %s rejected %s", feed->proto.target, article->message_id);
+                break;
+            default:
+                logf_warning("NNTP: unexpected reply to %s %s: %s", done.takethis ? "TAKETHIS" : "CHECK",
+                             article->message_id, feed->proto.last_reply);
+                break;
+        }
+    }
+
+    return FTN_OK;
+}
+
+ftn_error_t ftn_nntp_flush(ftn_nntp_feed_t* feed) {
+    ftn_error_t result = FTN_OK;
+    size_t first;
+    int attempt;
+
+    if (!feed) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    /* A kept-open connection may have been dropped by the server while idle.
+       Offering an article twice is harmless, the Message-ID dedups it. */
+    for (attempt = 0; attempt < 2; attempt++) {
+        for (first = 0; first < feed->queue_count && feed->queue[first].status != 0; first++) {
+        }
+        if (first >= feed->queue_count) {
+            return FTN_OK;
+        }
+
+        result = ftn_nntp_connect(feed);
+        if (result != FTN_OK) {
+            return result;
+        }
+
+        result = nntp_transfer(feed, first);
+        if (result == FTN_OK) {
+            return FTN_OK;
+        }
+
+        logf_warning("NNTP: connection to %s lost, reconnecting", feed->proto.target);
+        ftn_textproto_close(&feed->proto);
+    }
+
+    return result;
+}
@@ -0,0 +1,350 @@
+/*
+ * outbound.c - BSO netmail outbound for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/outbound.h"
+#include "ftn/thread.h"
+#include "ftn/log.h"
+
+/* BSO address layout used by the flow API */
+struct ftn_address {
+    int zone;
+    int net;
+    int node;
+    int point;
+    char* domain;
+};
+
+static void outbound_fill_header(const ftn_outbound_t* outbound, const ftn_address_t* next_hop,
+                                 ftn_packet_header_t* header);
+static ftn_outbound_packet_t* outbound_find(ftn_outbound_t* outbound, const ftn_address_t* next_hop,
+                                            ftn_flow_flavor_t flavor);
+static ftn_outbound_packet_t* outbound_open(ftn_outbound_t* outbound, const ftn_address_t* next_hop,
+                                            ftn_flow_flavor_t flavor);
+static void outbound_bso_address(const ftn_address_t* address, struct ftn_address* bso_addr);
+static ftn_packet_writer_t* outbound_open_spill(const char* flow_path, const ftn_packet_header_t* header);
+static ftn_error_t outbound_close(ftn_outbound_t* outbound, ftn_outbound_packet_t* packet);
+static void outbound_discard(ftn_outbound_t* outbound, ftn_outbound_packet_t* packet);
+
+ftn_outbound_t* ftn_outbound_new(const char* path, const ftn_address_t* address, const ftn_address_t* hub,
+                                 const char* password) {
+    ftn_outbound_t* outbound;
+    size_t len;
+
+    if (!path || !address) return NULL;
+
+    outbound = malloc(sizeof(ftn_outbound_t));
+    if (!outbound) return NULL;
+    memset(outbound, 0, sizeof(ftn_outbound_t));
+
+    outbound->path = malloc(strlen(path) + 1);
+    if (!outbound->path) {
+        free(outbound);
+        return NULL;
+    }
+    strcpy(outbound->path, path);
+
+    outbound->address = *address;
+
+    /* The password belongs to the hub; other nodes get packets without one */
+    if (hub && password) {
+        outbound->hub = *hub;
+        outbound->has_hub = 1;
+        len = strlen(password);
+        memcpy(outbound->password, password, len < 8 ? len : 8);
+    }
+
+    return outbound;
+}
+
+void ftn_outbound_free(ftn_outbound_t* outbound) {
+    if (!outbound) return;
+
+    ftn_outbound_flush(outbound);
+    free(outbound->packets);
+    free(outbound->path);
+    free(outbound);
+}
+
+ftn_flow_flavor_t ftn_outbound_flavor(const ftn_message_t* message) {
+    if (!message) return FLOW_FLAVOR_NORMAL;
+
+    if (message->attributes & FTN_ATTR_CRASH) {
+        return FLOW_FLAVOR_CONTINUOUS;
+    }
+    if (message->attributes & FTN_ATTR_HOLDFORPICKUP) {
+        return FLOW_FLAVOR_HOLD;
+    }
+    return FLOW_FLAVOR_NORMAL;
+}
+
+ftn_error_t ftn_outbound_add(ftn_outbound_t* outbound, const ftn_address_t* next_hop,
+                             ftn_flow_flavor_t flavor, const ftn_message_t* message) {
+    ftn_outbound_packet_t* packet;
+    ftn_error_t error;
+
+    if (!outbound || !next_hop || !message) return FTN_ERROR_INVALID_PARAMETER;
+
+    packet = outbound_find(outbound, next_hop, flavor);
+    if (!packet) {
+        /* Keep the number of open packets and held locks bounded */
+        if (outbound->packet_count >= FTN_OUTBOUND_MAX_OPEN) {
+            error = ftn_outbound_flush(outbound);
+            if (error != FTN_OK) return error;
+        }
+        packet = outbound_open(outbound, next_hop, flavor);
+        if (!packet) return FTN_ERROR_FILE;
+    }
+
+    /* The writer cuts a message it could not append off the packet again */
+    error = ftn_packet_writer_append(packet->writer, message);
+    if (error != FTN_OK) {
+        logf_error("Failed to append netmail for %d:%d/%d.%d",
+                   next_hop->zone, next_hop->net, next_hop->node, next_hop->point);
+        if (packet->writer->message_count == 0) {
+            outbound_discard(outbound, packet);
+        }
+        return error;
+    }
+
+    outbound->messages_queued++;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_outbound_flush(ftn_outbound_t* outbound) {
+    ftn_error_t result = FTN_OK;
+    size_t i;
+
+    if (!outbound) return FTN_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < outbound->packet_count; i++) {
+        if (outbound_close(outbound, &outbound->packets[i]) != FTN_OK) {
+            result = FTN_ERROR_FILE;
+        }
+    }
+    outbound->packet_count = 0;
+    return result;
+}
+
+/* Packet header from us to a next hop, stamped now */
+static void outbound_fill_header(const ftn_outbound_t* outbound, const ftn_address_t* next_hop,
+                                 ftn_packet_header_t* header) {
+    struct tm tm_buf;
+    struct tm* tm_info;
+    time_t now;
+
+    memset(header, 0, sizeof(ftn_packet_header_t));
+
+    now = time(NULL);
+    tm_info = ftn_localtime_r(&now, &tm_buf);
+    if (tm_info) {
+        header->year = tm_info->tm_year + 1900;
+        header->month = tm_info->tm_mon;
+        header->day = tm_info->tm_mday;
+        header->hour = tm_info->tm_hour;
+        header->minute = tm_info->tm_min;
+        header->second = tm_info->tm_sec;
+    }
+    header->packet_type = 0x0002;
+    header->orig_zone = outbound->address.zone;
+    header->orig_net = outbound->address.net;
+    header->orig_node = outbound->address.node;
+    header->dest_zone = next_hop->zone;
+    header->dest_net = next_hop->net;
+    header->dest_node = next_hop->node;
+    if (outbound->has_hub && ftn_address_compare(next_hop, &outbound->hub) == 0) {
+        memcpy(header->password, outbound->password, 8);
+    }
+}
+
+static ftn_outbound_packet_t* outbound_find(ftn_outbound_t* outbound, const ftn_address_t* next_hop,
+                                            ftn_flow_flavor_t flavor) {
+    ftn_outbound_packet_t* packet;
+    size_t i;
+
+    for (i = 0; i < outbound->packet_count; i++) {
+        packet = &outbound->packets[i];
+        if (packet->flavor == flavor &&
+            packet->address.zone == next_hop->zone &&
+            packet->address.net == next_hop->net &&
+            packet->address.node == next_hop->node &&
+            packet->address.point == next_hop->point) {
+            return packet;
+        }
+    }
+    return NULL;
+}
+
+/* Lock a next hop and open its packet, or a spill packet if it is busy */
+static ftn_outbound_packet_t* outbound_open(ftn_outbound_t* outbound, const ftn_address_t* next_hop,
+                                            ftn_flow_flavor_t flavor) {
+    ftn_outbound_packet_t* packet;
+    ftn_outbound_packet_t* grown;
+    ftn_packet_header_t header;
+    struct ftn_address bso_addr;
+    ftn_bso_error_t result;
+    char* flow_path = NULL;
+    size_t capacity;
+
+    if (outbound->packet_count >= outbound->packet_capacity) {
+        capacity = outbound->packet_capacity ? outbound->packet_capacity * 2 : 8;
+        grown = realloc(outbound->packets, capacity * sizeof(ftn_outbound_packet_t));
+        if (!grown) return NULL;
+        outbound->packets = grown;
+        outbound->packet_capacity = capacity;
+    }
+    packet = &outbound->packets[outbound->packet_count];
+    memset(packet, 0, sizeof(ftn_outbound_packet_t));
+    packet->address = *next_hop;
+    packet->flavor = flavor;
+    outbound_bso_address(next_hop, &bso_addr);
+
+    /* Also creates the zone and point directories */
+    result = ftn_flow_get_path(outbound->path, &bso_addr, FLOW_TYPE_NETMAIL, flavor, &flow_path);
+    if (result != BSO_OK) {
+        logf_error("Failed to find outbound packet for %d:%d/%d.%d: %s",
+                   next_hop->zone, next_hop->net, next_hop->node, next_hop->point,
+                   ftn_bso_error_string(result));
+        return NULL;
+    }
+
+    outbound_fill_header(outbound, next_hop, &header);
+
+    result = ftn_control_acquire_lock(&bso_addr, outbound->path, &packet->lock);
+    if (result == BSO_OK) {
+        packet->writer = ftn_packet_writer_reopen(flow_path, &header);
+        if (!packet->writer) {
+            logf_error("Failed to open outbound packet %s", flow_path);
+            ftn_control_release_lock(&packet->lock);
+        }
+    } else if (result == BSO_ERROR_BUSY) {
+        logf_info("%d:%d/%d.%d is busy, queueing netmail in a separate packet",
+                  next_hop->zone, next_hop->net, next_hop->node, next_hop->point);
+        packet->spilled = 1;
+        packet->writer = outbound_open_spill(flow_path, &header);
+    } else {
+        logf_error("Failed to lock %d:%d/%d.%d: %s",
+                   next_hop->zone, next_hop->net, next_hop->node, next_hop->point,
+                   ftn_bso_error_string(result));
+    }
+
+    free(flow_path);
+    if (!packet->writer) return NULL;
+
+    outbound->packet_count++;
+    return packet;
+}
+
+static void outbound_bso_address(const ftn_address_t* address, struct ftn_address* bso_addr) {
+    memset(bso_addr, 0, sizeof(struct ftn_address));
+    bso_addr->zone = (int)address->zone;
+    bso_addr->net = (int)address->net;
+    bso_addr->node = (int)address->node;
+    bso_addr->point = (int)address->point;
+}
+
+/*
+ * A new packet beside the netmail packet, to be sent from the flow file.
+ * It is closed as "<name>.pkt.tmp" and only gets its real name once the
+ * node is free and the reference is in its flow file.
+ */
+static ftn_packet_writer_t* outbound_open_spill(const char* flow_path, const ftn_packet_header_t* header) {
+    char path[1024];
+    char temp_path[1024];
+    const char* slash;
+    unsigned long serial;
+    struct stat st;
+    int dir_len;
+    int attempts;
+
+    slash = strrchr(flow_path, '/');
+    dir_len = slash ? (int)(slash - flow_path) : 0;
+
+    serial = (unsigned long)time(NULL) & 0xFFFFFFFFUL;
+    for (attempts = 0; attempts < 256; attempts++) {
+        snprintf(path, sizeof(path), "%.*s/%08lx.pkt", dir_len, flow_path,
+                 (serial + attempts) & 0xFFFFFFFFUL);
+        snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+        if (stat(path, &st) != 0 && stat(temp_path, &st) != 0) {
+            return ftn_packet_writer_open(temp_path, header);
+        }
+    }
+    return NULL;
+}
+
+/* Terminate a packet, reference it if it was spilled, and unlock */
+static ftn_error_t outbound_close(ftn_outbound_t* outbound, ftn_outbound_packet_t* packet) {
+    struct ftn_address bso_addr;
+    ftn_error_t error;
+    ftn_bso_error_t result;
+    char* path = NULL;
+
+    /* A spilled packet is referenced under its name without ".tmp" */
+    if (packet->spilled) {
+        path = malloc(strlen(packet->writer->filename) + 1);
+        if (path) {
+            strcpy(path, packet->writer->filename);
+            path[strlen(path) - 4] = '\0';
+        }
+    }
+
+    error = ftn_packet_writer_close(packet->writer);
+    packet->writer = NULL;
+    if (error != FTN_OK) {
+        logf_error("Failed to close outbound packet for %d:%d/%d.%d",
+                   packet->address.zone, packet->address.net,
+                   packet->address.node, packet->address.point);
+    }
+
+    if (packet->spilled) {
+        if (!path) return FTN_ERROR_NOMEM;
+        if (error == FTN_OK) {
+            outbound_bso_address(&packet->address, &bso_addr);
+            result = ftn_flow_queue_pending(outbound->path, &bso_addr, packet->flavor,
+                                            path, REF_DIRECTIVE_DELETE);
+            if (result != BSO_OK) error = FTN_ERROR_FILE;
+        }
+        free(path);
+    } else {
+        ftn_control_release_lock(&packet->lock);
+    }
+
+    return error;
+}
+
+/* Drop a packet a failed append left without messages */
+static void outbound_discard(ftn_outbound_t* outbound, ftn_outbound_packet_t* packet) {
+    ftn_packet_writer_abort(packet->writer);
+    packet->writer = NULL;
+    if (!packet->spilled) {
+        ftn_control_release_lock(&packet->lock);
+    }
+    *packet = outbound->packets[outbound->packet_count - 1];
+    outbound->packet_count--;
+}
@@ -0,0 +1,562 @@
+/*
+ * pack.c - Append-only article packs for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/pack.h"
+#include "ftn/rfc822.h"
+#include "zlib.h"
+
+#define PACK_FILE_MODE (S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)
+
+/* Set in the high word of a record's offset for deflated articles */
+#define PACK_DEFLATED 0x80000000UL
+
+/* Deflated articles start with the dictionary version and the plain length */
+#define PACK_DEFLATE_HEADER 5
+#define PACK_DICTIONARY_VERSION 1
+#define PACK_MIN_COMPRESS 64
+
+/*
+ * Preset dictionary for deflated articles. Deflate finds matches in it
+ * as if it preceded every article, with the most common strings best
+ * placed at the end. Articles store the version of the dictionary they
+ * were written with, so it must never change without a new version.
+ * It is kept in pieces because C89 limits the length of string literals.
+ */
+static const char* const pack_dictionary_parts[] = {
+    "Organization: \nIn-Reply-To: <\nReferences: <\nX-FTN-To: \n",
+    "X-FTN-Tearline: --- \nX-FTN-Origin:  * Origin: \nX-FTN-Attributes: \n",
+    "X-FTN-Control: Via \nX-FTN-Control: TID: \nX-FTN-Control: RESCANNED\n",
+    "X-FTN-Control: CHRS: CP866 2\nX-FTN-Control: CHRS: CP437 2\n",
+    "X-FTN-Control: CHRS: LATIN-1 2\nX-FTN-Control: CHRS: UTF-8 4\n",
+    "X-FTN-Control: TZUTC: 0000\nX-FTN-Control: PID: \n",
+    "Date: Mon, Tue, Wed, Thu, Fri, Sat, Sun, ",
+    " Jan  Feb  Mar  Apr  May  Jun  Jul  Aug  Sep  Oct  Nov  Dec 2025 +0000\n",
+    "Subject: Re: \nNewsgroups: fidonet.\nMessage-ID: <\n",
+    "From: \"\" <@fidonet.ftn>\nX-FTN-From: \nX-FTN-Area: \nPath: \n",
+    "X-FTN-Seen-By: \nX-FTN-Path: \n\nHello All!\n\n",
+    " wrote:\n > \n > > \n\n--- \n * Origin: "
+};
+
+#define PACK_DICTIONARY_MAX 1024
+
+static uInt pack_dictionary(Bytef* out) {
+    size_t len = 0;
+    size_t part_len;
+    size_t i;
+
+    for (i = 0; i < sizeof(pack_dictionary_parts) / sizeof(pack_dictionary_parts[0]); i++) {
+        part_len = strlen(pack_dictionary_parts[i]);
+        memcpy(out + len, pack_dictionary_parts[i], part_len);
+        len += part_len;
+    }
+    return (uInt)len;
+}
+
+/* Pack files are little-endian */
+static void pack_put_u32(unsigned char* p, unsigned long value) {
+    p[0] = (unsigned char)(value & 0xFF);
+    p[1] = (unsigned char)((value >> 8) & 0xFF);
+    p[2] = (unsigned char)((value >> 16) & 0xFF);
+    p[3] = (unsigned char)((value >> 24) & 0xFF);
+}
+
+static unsigned long pack_get_u32(const unsigned char* p) {
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static int pack_open_file(const char* path, const char* ext, int flags) {
+    char* file_path;
+    int fd;
+
+    file_path = malloc(strlen(path) + strlen(ext) + 1);
+    if (!file_path) {
+        return -1;
+    }
+    sprintf(file_path, "%s%s", path, ext);
+    fd = open(file_path, flags, PACK_FILE_MODE);
+    free(file_path);
+    return fd;
+}
+
+static int pack_lock(int fd, int type) {
+    struct flock fl;
+
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = (short)type;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = 0;
+    fl.l_len = 1;
+    while (fcntl(fd, F_SETLKW, &fl) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int pack_pread_all(int fd, void* buf, size_t len, off_t offset) {
+    unsigned char* p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+        n = pread(fd, p, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+static int pack_pwrite_all(int fd, const void* buf, size_t len, off_t offset) {
+    const unsigned char* p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+        n = pwrite(fd, p, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+/* First article number and number of records */
+static ftn_error_t pack_read_index(ftn_pack_t* pack, long* first, long* count) {
+    unsigned char header[FTN_PACK_INDEX_HEADER_SIZE];
+    struct stat st;
+
+    if (fstat(pack->index_fd, &st) != 0) {
+        return FTN_ERROR_FILE;
+    }
+    if (pack_pread_all(pack->index_fd, header, sizeof(header), 0) != 0 ||
+        memcmp(header, "FTNI", 4) != 0) {
+        return FTN_ERROR_INVALID_FORMAT;
+    }
+    *first = (long)pack_get_u32(header + 8);
+    *count = (long)((st.st_size - FTN_PACK_INDEX_HEADER_SIZE) / FTN_PACK_RECORD_SIZE);
+    return FTN_OK;
+}
+
+/* Give a new index its header */
+static ftn_error_t pack_init_index(int fd) {
+    unsigned char header[FTN_PACK_INDEX_HEADER_SIZE];
+    struct stat st;
+    ftn_error_t result = FTN_OK;
+
+    if (pack_lock(fd, F_WRLCK) != 0 || fstat(fd, &st) != 0) {
+        return FTN_ERROR_FILE;
+    }
+    if (st.st_size == 0) {
+        memset(header, 0, sizeof(header));
+        memcpy(header, "FTNI", 4);
+        pack_put_u32(header + 4, FTN_PACK_VERSION);
+        pack_put_u32(header + 8, 1);
+        if (pack_pwrite_all(fd, header, sizeof(header), 0) != 0) {
+            result = FTN_ERROR_FILE;
+        }
+    } else if (st.st_size < FTN_PACK_INDEX_HEADER_SIZE) {
+        result = FTN_ERROR_INVALID_FORMAT;
+    }
+    pack_lock(fd, F_UNLCK);
+    return result;
+}
+
+ftn_pack_t* ftn_pack_open(const char* path, int flags) {
+    ftn_pack_t* pack;
+    int writable = (flags & FTN_PACK_WRITE) != 0;
+    int open_flags = writable ? O_RDWR | O_CREAT : O_RDONLY;
+
+    if (!path) {
+        return NULL;
+    }
+
+    pack = malloc(sizeof(ftn_pack_t));
+    if (!pack) {
+        return NULL;
+    }
+    memset(pack, 0, sizeof(ftn_pack_t));
+    pack->flags = flags;
+    pack->path = strdup(path);
+    pack->pack_fd = pack_open_file(path, ".pack", open_flags);
+    pack->index_fd = pack_open_file(path, ".idx", open_flags);
+    if (!pack->path || pack->pack_fd < 0 || pack->index_fd < 0 ||
+        (writable && pack_init_index(pack->index_fd) != FTN_OK)) {
+        ftn_pack_close(pack);
+        return NULL;
+    }
+    return pack;
+}
+
+void ftn_pack_close(ftn_pack_t* pack) {
+    if (!pack) {
+        return;
+    }
+    if (pack->pack_fd >= 0) close(pack->pack_fd);
+    if (pack->index_fd >= 0) close(pack->index_fd);
+    if (pack->deflate_stream) {
+        deflateEnd(pack->deflate_stream);
+        free(pack->deflate_stream);
+    }
+    if (pack->inflate_stream) {
+        inflateEnd(pack->inflate_stream);
+        free(pack->inflate_stream);
+    }
+    free(pack->buffer);
+    free(pack->path);
+    free(pack);
+}
+
+static int pack_reserve(ftn_pack_t* pack, size_t needed) {
+    unsigned char* grown;
+
+    if (needed <= pack->buffer_size) {
+        return 0;
+    }
+    grown = realloc(pack->buffer, needed);
+    if (!grown) {
+        return -1;
+    }
+    pack->buffer = grown;
+    pack->buffer_size = needed;
+    return 0;
+}
+
+/* Deflate an article into pack->buffer; returns the stored size, or 0 if
+   compression would not save anything */
+static size_t pack_deflate(ftn_pack_t* pack, const char* article, size_t length) {
+    z_stream* stream = pack->deflate_stream;
+    Bytef dictionary[PACK_DICTIONARY_MAX];
+
+    if (!stream) {
+        stream = malloc(sizeof(z_stream));
+        if (!stream) {
+            return 0;
+        }
+        memset(stream, 0, sizeof(z_stream));
+        if (deflateInit2(stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            free(stream);
+            return 0;
+        }
+        pack->deflate_stream = stream;
+    } else if (deflateReset(stream) != Z_OK) {
+        return 0;
+    }
+
+    if (deflateSetDictionary(stream, dictionary, pack_dictionary(dictionary)) != Z_OK ||
+        pack_reserve(pack, length) != 0) {
+        return 0;
+    }
+
+    /* Anything that does not fit in the plain length is not worth keeping */
+    pack->buffer[0] = PACK_DICTIONARY_VERSION;
+    pack_put_u32(pack->buffer + 1, (unsigned long)length);
+    stream->next_in = (Bytef*)article;
+    stream->avail_in = (uInt)length;
+    stream->next_out = pack->buffer + PACK_DEFLATE_HEADER;
+    stream->avail_out = (uInt)(length - PACK_DEFLATE_HEADER);
+    if (deflate(stream, Z_FINISH) != Z_STREAM_END) {
+        return 0;
+    }
+    return PACK_DEFLATE_HEADER + (size_t)stream->total_out;
+}
+
+/* Inflate a stored article into a new string */
+static ftn_error_t pack_inflate(ftn_pack_t* pack, const unsigned char* stored, size_t stored_len,
+                                char** article, size_t* length) {
+    z_stream* stream = pack->inflate_stream;
+    Bytef dictionary[PACK_DICTIONARY_MAX];
+    unsigned long plain_len;
+    char* text;
+
+    if (stored_len < PACK_DEFLATE_HEADER || stored[0] != PACK_DICTIONARY_VERSION) {
+        return FTN_ERROR_INVALID_FORMAT;
+    }
+    plain_len = pack_get_u32(stored + 1);
+
+    if (!stream) {
+        stream = malloc(sizeof(z_stream));
+        if (!stream) {
+            return FTN_ERROR_NOMEM;
+        }
+        memset(stream, 0, sizeof(z_stream));
+        if (inflateInit2(stream, -MAX_WBITS) != Z_OK) {
+            free(stream);
+            return FTN_ERROR_NOMEM;
+        }
+        pack->inflate_stream = stream;
+    } else if (inflateReset(stream) != Z_OK) {
+        return FTN_ERROR_INVALID_FORMAT;
+    }
+
+    text = malloc(plain_len + 1);
+    if (!text) {
+        return FTN_ERROR_NOMEM;
+    }
+    if (inflateSetDictionary(stream, dictionary, pack_dictionary(dictionary)) != Z_OK) {
+        free(text);
+        return FTN_ERROR_INVALID_FORMAT;
+    }
+    stream->next_in = (Bytef*)(stored + PACK_DEFLATE_HEADER);
+    stream->avail_in = (uInt)(stored_len - PACK_DEFLATE_HEADER);
+    stream->next_out = (Bytef*)text;
+    stream->avail_out = (uInt)plain_len;
+    if (inflate(stream, Z_FINISH) != Z_STREAM_END || stream->total_out != plain_len) {
+        free(text);
+        return FTN_ERROR_INVALID_FORMAT;
+    }
+    text[plain_len] = '\0';
+
+    *article = text;
+    *length = (size_t)plain_len;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_pack_append(ftn_pack_t* pack, const char* article, size_t length, long* number) {
+    unsigned char record[FTN_PACK_RECORD_SIZE];
+    struct stat st;
+    const void* data = article;
+    size_t stored_len = length;
+    unsigned long flags = 0;
+    off_t offset;
+    long first;
+    long count;
+    ftn_error_t result;
+
+    if (!pack || !article || !(pack->flags & FTN_PACK_WRITE)) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    if (length > 0xFFFFFFFFUL) {
+        return FTN_ERROR_INVALID;
+    }
+
+    /* Compress before taking the lock */
+    if ((pack->flags & FTN_PACK_COMPRESS) && length >= PACK_MIN_COMPRESS) {
+        stored_len = pack_deflate(pack, article, length);
+        if (stored_len > 0) {
+            data = pack->buffer;
+            flags = PACK_DEFLATED;
+        } else {
+            stored_len = length;
+        }
+    }
+
+    if (pack_lock(pack->index_fd, F_WRLCK) != 0) {
+        return FTN_ERROR_FILE;
+    }
+    if ((result = pack_read_index(pack, &first, &count)) != FTN_OK) {
+        goto unlock;
+    }
+    if (fstat(pack->pack_fd, &st) != 0) {
+        result = FTN_ERROR_FILE;
+        goto unlock;
+    }
+    offset = st.st_size;
+
+    /* The article first: an index record always points at a whole article */
+    pack_put_u32(record, (unsigned long)(offset & 0xFFFFFFFFUL));
+    pack_put_u32(record + 4, (unsigned long)((offset >> 16) >> 16) | flags);
+    pack_put_u32(record + 8, (unsigned long)stored_len);
+    pack_put_u32(record + 12, (unsigned long)time(NULL));
+    if (pack_pwrite_all(pack->pack_fd, data, stored_len, offset) != 0 ||
+        pack_pwrite_all(pack->index_fd, record, sizeof(record),
+                        FTN_PACK_INDEX_HEADER_SIZE + (off_t)count * FTN_PACK_RECORD_SIZE) != 0) {
+        /* Drop the partial article; an unindexed tail would only waste space */
+        result = FTN_ERROR_FILE;
+        if (ftruncate(pack->pack_fd, offset) != 0) {
+            result = FTN_ERROR_FILE_IO;
+        }
+        goto unlock;
+    }
+
+    pack->appended++;
+    pack->bytes_in += (unsigned long)length;
+    pack->bytes_out += (unsigned long)stored_len;
+    if (number) {
+        *number = first + count;
+    }
+
+unlock:
+    pack_lock(pack->index_fd, F_UNLCK);
+    return result;
+}
+
+ftn_error_t ftn_pack_range(ftn_pack_t* pack, long* first, long* last) {
+    long count;
+    ftn_error_t result;
+
+    if (!pack || !first || !last) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    if ((result = pack_read_index(pack, first, &count)) != FTN_OK) {
+        return result;
+    }
+    *last = *first + count - 1;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_pack_entry(ftn_pack_t* pack, long number, ftn_pack_entry_t* entry) {
+    unsigned char record[FTN_PACK_RECORD_SIZE];
+    long first;
+    long count;
+    ftn_error_t result;
+
+    if (!pack || !entry) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    if ((result = pack_read_index(pack, &first, &count)) != FTN_OK) {
+        return result;
+    }
+    if (number < first || number - first >= count) {
+        return FTN_ERROR_NOTFOUND;
+    }
+    if (pack_pread_all(pack->index_fd, record, sizeof(record),
+                       FTN_PACK_INDEX_HEADER_SIZE + (off_t)(number - first) * FTN_PACK_RECORD_SIZE) != 0) {
+        return FTN_ERROR_FILE;
+    }
+
+    entry->offset = (off_t)pack_get_u32(record) |
+                    (((off_t)(pack_get_u32(record + 4) & ~PACK_DEFLATED) << 16) << 16);
+    entry->length = (size_t)pack_get_u32(record + 8);
+    entry->arrived = (time_t)pack_get_u32(record + 12);
+    entry->compressed = (pack_get_u32(record + 4) & PACK_DEFLATED) != 0;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_pack_read(ftn_pack_t* pack, long number, char** article, size_t* length) {
+    ftn_pack_entry_t entry;
+    ftn_error_t result;
+    char* text;
+
+    if (!pack || !article) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    *article = NULL;
+    if ((result = ftn_pack_entry(pack, number, &entry)) != FTN_OK) {
+        return result;
+    }
+
+    if (entry.compressed) {
+        if (pack_reserve(pack, entry.length) != 0) {
+            return FTN_ERROR_NOMEM;
+        }
+        if (pack_pread_all(pack->pack_fd, pack->buffer, entry.length, entry.offset) != 0) {
+            return FTN_ERROR_FILE;
+        }
+        return pack_inflate(pack, pack->buffer, entry.length, article, length ? length : &entry.length);
+    }
+
+    text = malloc(entry.length + 1);
+    if (!text) {
+        return FTN_ERROR_NOMEM;
+    }
+    if (pack_pread_all(pack->pack_fd, text, entry.length, entry.offset) != 0) {
+        free(text);
+        return FTN_ERROR_FILE;
+    }
+    text[entry.length] = '\0';
+
+    *article = text;
+    if (length) {
+        *length = entry.length;
+    }
+    return FTN_OK;
+}
+
+/* Overview fields may not contain tabs or line breaks */
+static void pack_overview_field(char* out, size_t size, const char* value) {
+    size_t i;
+
+    for (i = 0; value && value[i] && i < size - 1; i++) {
+        out[i] = (value[i] == '\t' || value[i] == '\r' || value[i] == '\n') ? ' ' : value[i];
+    }
+    out[i] = '\0';
+}
+
+ftn_error_t ftn_pack_overview(ftn_pack_t* pack, long number, char** line) {
+    static const char* const headers[] = { "Subject", "From", "Date", "Message-ID", "References" };
+    char fields[5][256];
+    rfc822_message_t* message = NULL;
+    const char* body;
+    char* article;
+    size_t length;
+    unsigned long lines = 0;
+    ftn_error_t result;
+    size_t i;
+
+    if (!line) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    *line = NULL;
+    if ((result = ftn_pack_read(pack, number, &article, &length)) != FTN_OK) {
+        return result;
+    }
+    if ((result = rfc822_message_parse(article, &message)) != FTN_OK) {
+        free(article);
+        return result;
+    }
+    for (i = 0; i < sizeof(headers) / sizeof(headers[0]); i++) {
+        pack_overview_field(fields[i], sizeof(fields[i]), rfc822_message_get_header(message, headers[i]));
+    }
+    rfc822_message_free(message);
+
+    body = strstr(article, "\n\n");
+    for (body = body ? body + 2 : article + length; *body; body++) {
+        if (*body == '\n') {
+            lines++;
+        }
+    }
+    free(article);
+
+    *line = malloc(sizeof(fields) + 64);
+    if (!*line) {
+        return FTN_ERROR_NOMEM;
+    }
+    sprintf(*line, "%ld\t%s\t%s\t%s\t%s\t%s\t%lu\t%lu", number, fields[0], fields[1], fields[2],
+            fields[3], fields[4], (unsigned long)length, lines);
+    return FTN_OK;
+}
@@ -3,11 +3,16 @@
  * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
  */
 
+#define _POSIX_C_SOURCE 200112L
 #include <ftn.h>
+#include <ftn/thread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 /* Helper function to read a 16-bit little-endian integer */
 static unsigned int read_uint16(FILE* fp) {
@@ -235,22 +240,8 @@ ftn_error_t ftn_packet_load(const char* filename, ftn_packet_t** packet) {
     return FTN_OK;
 }
 
-ftn_error_t ftn_packet_save(const char* filename, const ftn_packet_t* packet) {
-    FILE* fp;
-    const ftn_packet_header_t* header;
-    size_t i;
-    ftn_message_t* message;
-    char datetime_str[21];
-    char* full_text;
-    
-    if (!filename || !packet) return FTN_ERROR_INVALID_PARAMETER;
-    
-    fp = fopen(filename, "wb");
-    if (!fp) return FTN_ERROR_FILE_ACCESS;
-    
-    header = &packet->header;
-    
-    /* Write packet header */
+/* Write the 58-byte packet header */
+static ftn_error_t write_packet_header(FILE* fp, const ftn_packet_header_t* header) {
     if (!write_uint16(fp, header->orig_node) ||
         !write_uint16(fp, header->dest_node) ||
         !write_uint16(fp, header->year) ||
@@ -263,14 +254,12 @@ ftn_error_t ftn_packet_save(const char* filename, const ftn_packet_t* packet) {
         !write_uint16(fp, header->packet_type) ||
         !write_uint16(fp, header->orig_net) ||
         !write_uint16(fp, header->dest_net)) {
-        fclose(fp);
         return FTN_ERROR_FILE_ACCESS;
     }
     
     /* Write product code and serial number */
     if (fwrite(&header->prod_code, 1, 1, fp) != 1 ||
         fwrite(&header->serial_no, 1, 1, fp) != 1) {
-        fclose(fp);
         return FTN_ERROR_FILE_ACCESS;
     }
     
@@ -279,60 +268,84 @@ ftn_error_t ftn_packet_save(const char* filename, const ftn_packet_t* packet) {
         !write_uint16(fp, header->orig_zone) ||
         !write_uint16(fp, header->dest_zone) ||
         fwrite(header->fill, 1, 20, fp) != 20) {
-        fclose(fp);
         return FTN_ERROR_FILE_ACCESS;
     }
     
+    return FTN_OK;
+}
+
+/* Write one packed message */
+static ftn_error_t write_packed_message(FILE* fp, const ftn_message_t* message) {
+    char datetime_str[21];
+    char* full_text;
+    
+    /* Write message type */
+    if (!write_uint16(fp, 0x0002)) {
+        return FTN_ERROR_FILE_ACCESS;
+    }
+    
+    /* Write packed message header */
+    if (!write_uint16(fp, message->orig_addr.node) ||
+        !write_uint16(fp, message->dest_addr.node) ||
+        !write_uint16(fp, message->orig_addr.net) ||
+        !write_uint16(fp, message->dest_addr.net) ||
+        !write_uint16(fp, message->attributes) ||
+        !write_uint16(fp, message->cost)) {
+        return FTN_ERROR_FILE_ACCESS;
+    }
+    
+    /* Write datetime */
+    ftn_datetime_to_string(message->timestamp, datetime_str, sizeof(datetime_str));
+    if (fwrite(datetime_str, 1, 20, fp) != 20) {
+        return FTN_ERROR_FILE_ACCESS;
+    }
+    
+    /* Write strings */
+    if (!write_packed_string(fp, message->to_user, 35) ||
+        !write_packed_string(fp, message->from_user, 35) ||
+        !write_packed_string(fp, message->subject, 71)) {
+        return FTN_ERROR_FILE_ACCESS;
+    }
+    
+    /* Create full message text with control lines */
+    full_text = ftn_message_create_text(message);
+    if (!full_text) {
+        return FTN_ERROR_MEMORY;
+    }
+    
+    if (!write_packed_string(fp, full_text, 65535)) {
+        free(full_text);
+        return FTN_ERROR_FILE_ACCESS;
+    }
+    
+    free(full_text);
+    return FTN_OK;
+}
+
+ftn_error_t ftn_packet_save(const char* filename, const ftn_packet_t* packet) {
+    FILE* fp;
+    size_t i;
+    ftn_error_t error;
+    
+    if (!filename || !packet) return FTN_ERROR_INVALID_PARAMETER;
+    
+    fp = fopen(filename, "wb");
+    if (!fp) return FTN_ERROR_FILE_ACCESS;
+    
+    /* Write packet header */
+    error = write_packet_header(fp, &packet->header);
+    if (error != FTN_OK) {
+        fclose(fp);
+        return error;
+    }
+    
     /* Write messages */
     for (i = 0; i < packet->message_count; i++) {
-        message = packet->messages[i];
-        
-        /* Write message type */
-        if (!write_uint16(fp, 0x0002)) {
-            fclose(fp);
-            return FTN_ERROR_FILE_ACCESS;
-        }
-        
-        /* Write packed message header */
-        if (!write_uint16(fp, message->orig_addr.node) ||
-            !write_uint16(fp, message->dest_addr.node) ||
-            !write_uint16(fp, message->orig_addr.net) ||
-            !write_uint16(fp, message->dest_addr.net) ||
-            !write_uint16(fp, message->attributes) ||
-            !write_uint16(fp, message->cost)) {
-            fclose(fp);
-            return FTN_ERROR_FILE_ACCESS;
-        }
-        
-        /* Write datetime */
-        ftn_datetime_to_string(message->timestamp, datetime_str, sizeof(datetime_str));
-        if (fwrite(datetime_str, 1, 20, fp) != 20) {
-            fclose(fp);
-            return FTN_ERROR_FILE_ACCESS;
-        }
-        
-        /* Write strings */
-        if (!write_packed_string(fp, message->to_user, 35) ||
-            !write_packed_string(fp, message->from_user, 35) ||
-            !write_packed_string(fp, message->subject, 71)) {
-            fclose(fp);
-            return FTN_ERROR_FILE_ACCESS;
-        }
-        
-        /* Create full message text with control lines */
-        full_text = ftn_message_create_text(message);
-        if (!full_text) {
-            fclose(fp);
-            return FTN_ERROR_MEMORY;
-        }
-        
-        if (!write_packed_string(fp, full_text, 65535)) {
-            free(full_text);
+        error = write_packed_message(fp, packet->messages[i]);
+        if (error != FTN_OK) {
             fclose(fp);
-            return FTN_ERROR_FILE_ACCESS;
+            return error;
         }
-        
-        free(full_text);
     }
     
     /* Write packet terminator */
@@ -345,6 +358,226 @@ ftn_error_t ftn_packet_save(const char* filename, const ftn_packet_t* packet) {
     return FTN_OK;
 }
 
+ftn_packet_writer_t* ftn_packet_writer_open(const char* filename, const ftn_packet_header_t* header) {
+    ftn_packet_writer_t* writer;
+    size_t len;
+    
+    if (!filename || !header) return NULL;
+    
+    writer = malloc(sizeof(ftn_packet_writer_t));
+    if (!writer) return NULL;
+    memset(writer, 0, sizeof(ftn_packet_writer_t));
+    
+    len = strlen(filename);
+    writer->filename = malloc(len + 1);
+    writer->temp_filename = malloc(len + 5);
+    if (!writer->filename || !writer->temp_filename) {
+        free(writer->filename);
+        free(writer->temp_filename);
+        free(writer);
+        return NULL;
+    }
+    strcpy(writer->filename, filename);
+    sprintf(writer->temp_filename, "%s.tmp", filename);
+    
+    /* Tossers only pick up *.pkt, so the packet stays invisible until closed */
+    writer->fp = fopen(writer->temp_filename, "wb");
+    if (!writer->fp) {
+        free(writer->filename);
+        free(writer->temp_filename);
+        free(writer);
+        return NULL;
+    }
+    
+    if (write_packet_header(writer->fp, header) != FTN_OK) {
+        ftn_packet_writer_abort(writer);
+        return NULL;
+    }
+    
+    writer->size = 58;
+    writer->opened = time(NULL);
+    return writer;
+}
+
+ftn_packet_writer_t* ftn_packet_writer_reopen(const char* filename, const ftn_packet_header_t* header) {
+    ftn_packet_writer_t* writer;
+    struct flock lock;
+    struct stat st;
+    unsigned char tail[2];
+    int fd;
+    
+    if (!filename || !header) return NULL;
+    
+    writer = malloc(sizeof(ftn_packet_writer_t));
+    if (!writer) return NULL;
+    memset(writer, 0, sizeof(ftn_packet_writer_t));
+    
+    writer->filename = malloc(strlen(filename) + 1);
+    if (!writer->filename) {
+        free(writer);
+        return NULL;
+    }
+    strcpy(writer->filename, filename);
+    
+    fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        free(writer->filename);
+        free(writer);
+        return NULL;
+    }
+    writer->fp = fdopen(fd, "r+b");
+    if (!writer->fp) {
+        close(fd);
+        free(writer->filename);
+        free(writer);
+        return NULL;
+    }
+    
+    /* Other tossers appending to the same packet wait here until we close it */
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    if (fcntl(fd, F_SETLKW, &lock) != 0 || fstat(fd, &st) != 0) {
+        ftn_packet_writer_abort(writer);
+        return NULL;
+    }
+    
+    if (st.st_size == 0) {
+        if (write_packet_header(writer->fp, header) != FTN_OK) {
+            ftn_packet_writer_abort(writer);
+            return NULL;
+        }
+        writer->append_offset = 58;
+    } else if (st.st_size < 60) {
+        /* Too short to hold a header and a terminator */
+        ftn_packet_writer_abort(writer);
+        return NULL;
+    } else {
+        /* Write over the terminator; a packet cut short keeps its tail */
+        if (fseek(writer->fp, (long)st.st_size - 2, SEEK_SET) != 0 ||
+            fread(tail, 1, 2, writer->fp) != 2) {
+            ftn_packet_writer_abort(writer);
+            return NULL;
+        }
+        writer->append_offset = (long)st.st_size;
+        if (tail[0] == 0 && tail[1] == 0) {
+            writer->append_offset -= 2;
+        }
+        if (fseek(writer->fp, writer->append_offset, SEEK_SET) != 0) {
+            ftn_packet_writer_abort(writer);
+            return NULL;
+        }
+    }
+    
+    writer->size = (size_t)writer->append_offset;
+    writer->opened = time(NULL);
+    return writer;
+}
+
+/* Cut the packet back to offset, dropping a message that was not written */
+static void packet_writer_truncate(ftn_packet_writer_t* writer, long offset) {
+    fflush(writer->fp);
+    clearerr(writer->fp);
+    if (ftruncate(fileno(writer->fp), offset) == 0) {
+        fseek(writer->fp, offset, SEEK_SET);
+    }
+    writer->size = (size_t)offset;
+}
+
+ftn_error_t ftn_packet_writer_append(ftn_packet_writer_t* writer, const ftn_message_t* message) {
+    ftn_error_t error;
+    long start;
+    long pos;
+    
+    if (!writer || !writer->fp || !message) return FTN_ERROR_INVALID_PARAMETER;
+    
+    start = ftell(writer->fp);
+    if (start < 0) return FTN_ERROR_FILE_ACCESS;
+    
+    error = write_packed_message(writer->fp, message);
+    if (error != FTN_OK) {
+        packet_writer_truncate(writer, start);
+        return error;
+    }
+    
+    pos = ftell(writer->fp);
+    if (pos > 0) writer->size = (size_t)pos;
+    writer->message_offset = start;
+    writer->message_count++;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_packet_writer_sync(ftn_packet_writer_t* writer) {
+    if (!writer || !writer->fp) return FTN_ERROR_INVALID_PARAMETER;
+    
+    /* Only a message that reached the disk may be acknowledged */
+    if (fflush(writer->fp) != 0 || fsync(fileno(writer->fp)) != 0) {
+        if (writer->message_count > 0 && writer->message_offset > 0) {
+            packet_writer_truncate(writer, writer->message_offset);
+            writer->message_count--;
+            writer->message_offset = 0;
+        }
+        return FTN_ERROR_FILE_ACCESS;
+    }
+    return FTN_OK;
+}
+
+ftn_error_t ftn_packet_writer_close(ftn_packet_writer_t* writer) {
+    ftn_error_t error = FTN_OK;
+    
+    if (!writer) return FTN_ERROR_INVALID_PARAMETER;
+    
+    /* Write packet terminator */
+    if (!write_uint16(writer->fp, 0x0000)) {
+        error = FTN_ERROR_FILE_ACCESS;
+    }
+    if (fclose(writer->fp) != 0 && error == FTN_OK) {
+        error = FTN_ERROR_FILE_ACCESS;
+    }
+    writer->fp = NULL;
+    
+    /* A packet appended in place is already under its final name */
+    if (writer->temp_filename) {
+        if (error == FTN_OK && rename(writer->temp_filename, writer->filename) != 0) {
+            error = FTN_ERROR_FILE_ACCESS;
+        }
+        
+        if (error != FTN_OK) {
+            remove(writer->temp_filename);
+        }
+    }
+    
+    free(writer->filename);
+    free(writer->temp_filename);
+    free(writer);
+    return error;
+}
+
+void ftn_packet_writer_abort(ftn_packet_writer_t* writer) {
+    if (!writer) return;
+    
+    if (!writer->temp_filename) {
+        /* Drop whatever was appended and put the terminator back */
+        if (writer->fp && writer->append_offset > 0) {
+            fflush(writer->fp);
+            if (ftruncate(fileno(writer->fp), writer->append_offset) == 0 &&
+                fseek(writer->fp, writer->append_offset, SEEK_SET) == 0) {
+                write_uint16(writer->fp, 0x0000);
+            }
+        }
+    }
+    if (writer->fp) {
+        fclose(writer->fp);
+    }
+    if (writer->temp_filename) {
+        remove(writer->temp_filename);
+    }
+    
+    free(writer->filename);
+    free(writer->temp_filename);
+    free(writer);
+}
+
 ftn_error_t ftn_packet_add_message(ftn_packet_t* packet, ftn_message_t* message) {
     ftn_message_t** temp;
     
@@ -428,6 +661,7 @@ void ftn_message_free(ftn_message_t* message) {
 
 /* Date/time conversion functions */
 ftn_error_t ftn_datetime_to_string(time_t timestamp, char* buffer, size_t size) {
+    struct tm tm_buf;
     struct tm* tm_info;
     const char* months[] = {
         "Jan", "Feb", "Mar", "Apr", "May", "Jun",
@@ -436,7 +670,7 @@ ftn_error_t ftn_datetime_to_string(time_t timestamp, char* buffer, size_t size)
     
     if (!buffer || size < 21) return FTN_ERROR_INVALID_PARAMETER;
     
-    tm_info = localtime(&timestamp);
+    tm_info = ftn_localtime_r(&timestamp, &tm_buf);
     if (!tm_info) return FTN_ERROR_INVALID_PARAMETER;
     
     /* Format: "01 Jan 86  02:34:56\0" (20 chars + null) */
@@ -11,6 +11,7 @@
 #include "ftn/packet.h"
 #include "ftn/storage.h"
 #include "ftn/version.h"
+#include "ftn/intern.h"
 
 static void print_version(void) {
     printf("pkt2news (libFTN) %s\n", ftn_get_version());
@@ -155,5 +156,6 @@ int main(int argc, char* argv[]) {
     printf("  Failed: %d\n", failed_count);
     
     free(packet_files);
+    ftn_intern_cleanup();
     return (failed_count > 0) ? 1 : 0;
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
  */
 
 #include <ftn.h>
+#include <ftn/intern.h>
+#include <ftn/thread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -332,6 +334,28 @@ ftn_error_t rfc822_message_parse(const char* text, rfc822_message_t** message) {
             break;
         }
         
+        /* A line starting with whitespace continues the previous header */
+        if ((*line_start == ' ' || *line_start == '\t') && msg->header_count > 0) {
+            rfc822_header_t* last = msg->headers[msg->header_count - 1];
+            size_t value_len = strlen(last->value);
+            char* joined;
+            
+            while (line_len > 0 && (*line_start == ' ' || *line_start == '\t')) {
+                line_start++;
+                line_len--;
+            }
+            joined = realloc(last->value, value_len + line_len + 2);
+            if (!joined) {
+                rfc822_message_free(msg);
+                return FTN_ERROR_NOMEM;
+            }
+            joined[value_len] = ' ';
+            memcpy(joined + value_len + 1, line_start, line_len);
+            joined[value_len + 1 + line_len] = '\0';
+            last->value = joined;
+            continue;
+        }
+        
         /* Copy line */
         line = malloc(line_len + 1);
         if (!line) {
@@ -677,13 +701,14 @@ ftn_error_t rfc822_address_to_ftn(const char* rfc_addr, const char* domain, ftn_
 
 /* Convert FTN timestamp to RFC822 date format */
 char* ftn_timestamp_to_rfc822(time_t timestamp) {
+    struct tm tm_buf;
     struct tm* tm_info;
     char* result;
     static const char* weekdays[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
     static const char* months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
                                    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
     
-    tm_info = gmtime(&timestamp);
+    tm_info = ftn_gmtime_r(&timestamp, &tm_buf);
     if (!tm_info) return NULL;
     
     result = malloc(64);
@@ -899,8 +924,70 @@ error_cleanup:
     return error;
 }
 
+/* Decode MIME-encoded text of rfc_msg into msg, transcoding to chrs.
+   Adds a CHRS kludge when the result is not plain ASCII. */
+static void rfc822_decode_mime(const rfc822_message_t* rfc_msg, const char* chrs, ftn_message_t* msg) {
+    char* decoded;
+    char* fields[4];
+    char kludge[32];
+    size_t i;
+    const unsigned char* c;
+    
+    /* Body: fall back to the raw text if there is no text part */
+    decoded = ftn_mime_decode_body(rfc_msg, chrs);
+    if (!decoded && rfc_msg->body) {
+        decoded = malloc(strlen(rfc_msg->body) + 1);
+        if (decoded) {
+            strcpy(decoded, rfc_msg->body);
+        }
+    }
+    msg->text = decoded;
+    
+    /* Encoded words in the subject and names */
+    if (msg->subject) {
+        decoded = ftn_mime_decode_header(msg->subject, chrs);
+        if (decoded) {
+            free(msg->subject);
+            msg->subject = decoded;
+        }
+    }
+    if (msg->from_user) {
+        decoded = ftn_mime_decode_header(msg->from_user, chrs);
+        if (decoded) {
+            free(msg->from_user);
+            msg->from_user = decoded;
+        }
+    }
+    if (msg->to_user) {
+        decoded = ftn_mime_decode_header(msg->to_user, chrs);
+        if (decoded) {
+            free(msg->to_user);
+            msg->to_user = decoded;
+        }
+    }
+    
+    fields[0] = msg->text;
+    fields[1] = msg->subject;
+    fields[2] = msg->from_user;
+    fields[3] = msg->to_user;
+    for (i = 0; i < 4; i++) {
+        for (c = (const unsigned char*)fields[i]; c && *c; c++) {
+            if (*c >= 0x80) {
+                snprintf(kludge, sizeof(kludge), "CHRS: %s", ftn_mime_chrs_kludge(chrs));
+                ftn_message_add_control(msg, kludge);
+                return;
+            }
+        }
+    }
+}
+
 /* Convert RFC822 message to FTN */
 ftn_error_t rfc822_to_ftn(const rfc822_message_t* rfc_msg, const char* domain, ftn_message_t** ftn_msg) {
+    return rfc822_to_ftn_chrs(rfc_msg, domain, NULL, ftn_msg);
+}
+
+/* Convert RFC822 message to FTN, transcoding text to the given CHRS */
+ftn_error_t rfc822_to_ftn_chrs(const rfc822_message_t* rfc_msg, const char* domain, const char* chrs, ftn_message_t** ftn_msg) {
     ftn_message_t* msg;
     const char* header_value;
     char* name = NULL;
@@ -1000,13 +1087,8 @@ ftn_error_t rfc822_to_ftn(const rfc822_message_t* rfc_msg, const char* domain, f
         }
     }
     
-    /* Set body */
-    if (rfc_msg->body) {
-        msg->text = malloc(strlen(rfc_msg->body) + 1);
-        if (msg->text) {
-            strcpy(msg->text, rfc_msg->body);
-        }
-    }
+    /* Set body, decoding MIME content */
+    rfc822_decode_mime(rfc_msg, chrs, msg);
     
     *ftn_msg = msg;
     return FTN_OK;
@@ -1080,7 +1162,8 @@ char* newsgroup_to_ftn_area(const char* newsgroup, const char* network) {
 ftn_error_t ftn_to_usenet(const ftn_message_t* ftn_msg, const char* network, rfc822_message_t** usenet_msg) {
     rfc822_message_t* msg;
     char* from_addr;
-    char* newsgroup;
+    const char* newsgroup;
+    char* built_newsgroup;
     char* date_str;
     char buffer[256];
     ftn_error_t error;
@@ -1104,12 +1187,19 @@ ftn_error_t ftn_to_usenet(const ftn_message_t* ftn_msg, const char* network, rfc
         if (error != FTN_OK) goto error_cleanup;
     }
     
-    /* Set Newsgroups header */
-    newsgroup = ftn_area_to_newsgroup(network, ftn_msg->area);
+    /* Set Newsgroups header, built by hand once the intern table is full */
+    newsgroup = ftn_intern_newsgroup(ftn_intern(FTN_INTERN_NETWORK, network),
+                                     ftn_intern(FTN_INTERN_AREA, ftn_msg->area));
     if (newsgroup) {
         error = rfc822_message_add_header(msg, "Newsgroups", newsgroup);
-        free(newsgroup);
         if (error != FTN_OK) goto error_cleanup;
+    } else {
+        built_newsgroup = ftn_area_to_newsgroup(network, ftn_msg->area);
+        if (built_newsgroup) {
+            error = rfc822_message_add_header(msg, "Newsgroups", built_newsgroup);
+            free(built_newsgroup);
+            if (error != FTN_OK) goto error_cleanup;
+        }
     }
     
     /* Set Subject header */
@@ -1208,6 +1298,11 @@ error_cleanup:
 
 /* Convert RFC1036 USENET article to FTN Echomail message */
 ftn_error_t usenet_to_ftn(const rfc822_message_t* usenet_msg, const char* network, ftn_message_t** ftn_msg) {
+    return usenet_to_ftn_chrs(usenet_msg, network, NULL, ftn_msg);
+}
+
+/* Convert RFC1036 USENET article to FTN Echomail, transcoding text to the given CHRS */
+ftn_error_t usenet_to_ftn_chrs(const rfc822_message_t* usenet_msg, const char* network, const char* chrs, ftn_message_t** ftn_msg) {
     ftn_message_t* msg;
     const char* header_value;
     char* name = NULL;
@@ -1346,13 +1441,8 @@ ftn_error_t usenet_to_ftn(const rfc822_message_t* usenet_msg, const char* networ
         }
     }
     
-    /* Set body */
-    if (usenet_msg->body) {
-        msg->text = malloc(strlen(usenet_msg->body) + 1);
-        if (msg->text) {
-            strcpy(msg->text, usenet_msg->body);
-        }
-    }
+    /* Set body, decoding MIME content */
+    rfc822_decode_mime(usenet_msg, chrs, msg);
     
     *ftn_msg = msg;
     return FTN_OK;
@@ -31,6 +31,7 @@
 #include "ftn/packet.h"
 #include "ftn/config.h"
 #include "ftn/dupechk.h"
+#include "ftn/thread.h"
 
 /* Default routing settings */
 #define DEFAULT_RULE_CAPACITY 64
@@ -64,6 +65,7 @@ ftn_router_t* ftn_router_new(const ftn_config_t* config, ftn_dupecheck_t* dupech
     router->dupecheck = dupecheck;
     router->rule_count = 0;
     router->rule_capacity = DEFAULT_RULE_CAPACITY;
+    router->profile = 0;
 
     router->rules = malloc(sizeof(ftn_routing_rule_t*) * router->rule_capacity);
     if (!router->rules) {
@@ -197,6 +199,7 @@ ftn_error_t ftn_router_analyze_message(ftn_router_t* router, const ftn_message_t
         if (result != FTN_OK) {
             return result;
         }
+        dest->area_id = ftn_intern(FTN_INTERN_AREA, dest->area_name);
     }
 
     /* Find network for address */
@@ -409,6 +412,7 @@ ftn_error_t ftn_routing_rule_set(ftn_routing_rule_t* rule, const char* name, con
 
     rule->action = action;
     rule->priority = priority;
+    rule->last_area_id = FTN_INTERN_NONE;
 
     if (parameter) {
         rule->parameter = ftn_router_strdup(parameter);
@@ -484,6 +488,64 @@ ftn_error_t ftn_router_remove_rule(ftn_router_t* router, const char* rule_name)
     return FTN_ERROR_NOTFOUND;
 }
 
+/* Rule profiling */
+void ftn_router_set_profiling(ftn_router_t* router, int enabled) {
+    if (router) {
+        router->profile = enabled ? 1 : 0;
+    }
+}
+
+void ftn_router_reset_rule_stats(ftn_router_t* router) {
+    size_t i;
+
+    if (!router) return;
+
+    for (i = 0; i < router->rule_count; i++) {
+        router->rules[i]->evaluations = 0;
+        router->rules[i]->matches = 0;
+        router->rules[i]->match_time = 0.0;
+    }
+}
+
+static int rule_profile_compare(const void* a, const void* b) {
+    const ftn_routing_rule_t* ra = *(const ftn_routing_rule_t* const*)a;
+    const ftn_routing_rule_t* rb = *(const ftn_routing_rule_t* const*)b;
+
+    if (ra->match_time > rb->match_time) return -1;
+    if (ra->match_time < rb->match_time) return 1;
+    return ra->priority - rb->priority;
+}
+
+void ftn_router_print_rule_profile(const ftn_router_t* router, FILE* fp) {
+    ftn_routing_rule_t** sorted;
+    size_t i;
+
+    if (!router || !fp) return;
+
+    fprintf(fp, "Routing rule profile (%lu rules, most expensive first)\n",
+            (unsigned long)router->rule_count);
+    if (router->rule_count == 0) return;
+
+    /* Sort a copy so the routing order is left alone */
+    sorted = malloc(sizeof(ftn_routing_rule_t*) * router->rule_count);
+    if (!sorted) return;
+    memcpy(sorted, router->rules, sizeof(ftn_routing_rule_t*) * router->rule_count);
+    qsort(sorted, router->rule_count, sizeof(ftn_routing_rule_t*), rule_profile_compare);
+
+    fprintf(fp, "%-20s %5s %10s %10s %12s %10s\n",
+            "Rule", "Prio", "Evaluated", "Matched", "Time (ms)", "Avg (us)");
+    for (i = 0; i < router->rule_count; i++) {
+        const ftn_routing_rule_t* rule = sorted[i];
+        double avg = rule->evaluations ? rule->match_time * 1e6 / rule->evaluations : 0.0;
+
+        fprintf(fp, "%-20s %5d %10lu %10lu %12.3f %10.3f\n",
+                rule->name ? rule->name : "-", rule->priority,
+                rule->evaluations, rule->matches, rule->match_time * 1e3, avg);
+    }
+
+    free(sorted);
+}
+
 /* Utility functions */
 char* ftn_router_format_address(const ftn_address_t* addr) {
     char* result;
@@ -550,12 +612,17 @@ ftn_error_t ftn_router_route_message(ftn_router_t* router, const ftn_message_t*
     for (i = 0; i < router->rule_count; i++) {
         ftn_routing_rule_t* rule = router->rules[i];
         int match = 0;
+        double started = router->profile ? ftn_monotonic_time() : 0.0;
 
         /* Check if rule pattern matches */
         if (strncmp(rule->pattern, "area:", 5) == 0) {
             /* Area pattern */
-            if (dest.area_name) {
+            if (dest.area_id != FTN_INTERN_NONE && dest.area_id == rule->last_area_id) {
+                match = rule->last_area_match;
+            } else if (dest.area_name) {
                 match = ftn_router_area_match(rule->pattern + 5, dest.area_name);
+                rule->last_area_id = dest.area_id;
+                rule->last_area_match = match;
             }
         } else if (strncmp(rule->pattern, "addr:", 5) == 0) {
             /* Address pattern */
@@ -570,7 +637,14 @@ ftn_error_t ftn_router_route_message(ftn_router_t* router, const ftn_message_t*
             }
         }
 
+        rule->evaluations++;
+        if (router->profile) {
+            rule->match_time += ftn_monotonic_time() - started;
+        }
+
         if (match) {
+            rule->matches++;
+
             /* Apply the matching rule */
             switch (rule->action) {
                 case FTN_ROUTE_LOCAL_MAIL:
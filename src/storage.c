@@ -39,6 +39,14 @@
 #include "ftn/config.h"
 #include "ftn/packet.h"
 #include "ftn/rfc822.h"
+#include "ftn/intern.h"
+#include "ftn/thread.h"
+#include "ftn/lmtp.h"
+#include "ftn/nntp.h"
+#include "ftn/log.h"
+
+static ftn_error_t storage_close_packs(ftn_storage_t* storage);
+static void storage_maildir_clear(ftn_storage_t* storage);
 
 /* Internal utility functions */
 static char* ftn_storage_strdup(const char* str) {
@@ -92,6 +100,9 @@ ftn_storage_t* ftn_storage_new(const ftn_config_t* config) {
         if (storage->active_file_path) {
             sprintf(storage->active_file_path, "%s/%s", storage->news_root, FTN_USENET_ACTIVE_FILE);
         }
+        if (news_config->pack) {
+            storage->pack = FTN_PACK_WRITE | (news_config->compress ? FTN_PACK_COMPRESS : 0);
+        }
     }
 
     if (mail_config && mail_config->inbox) {
@@ -100,18 +111,88 @@ ftn_storage_t* ftn_storage_new(const ftn_config_t* config) {
             ftn_storage_free(storage);
             return NULL;
         }
+
+        /* Configurations built by hand have no compiled template */
+        storage->mail_template = mail_config->inbox_template;
+        if (!storage->mail_template) {
+            storage->own_template = ftn_path_template_compile(mail_config->inbox);
+            storage->mail_template = storage->own_template;
+            if (!storage->mail_template) {
+                ftn_storage_free(storage);
+                return NULL;
+            }
+        }
+    }
+
+    if (news_config && news_config->nntp) {
+        storage->nntp = ftn_nntp_feed_new(news_config->nntp,
+                                          news_config->nntp_window > 0 ? (size_t)news_config->nntp_window : 0,
+                                          news_config->nntp_batch > 0 ? (size_t)news_config->nntp_batch : 0);
+        if (!storage->nntp) {
+            ftn_storage_free(storage);
+            return NULL;
+        }
+    }
+
+    if (news_config && news_config->jam) {
+        storage->jam_root = ftn_storage_strdup(news_config->jam);
+        if (!storage->jam_root) {
+            ftn_storage_free(storage);
+            return NULL;
+        }
+        storage->jam_batch = news_config->jam_batch > 0 ? (size_t)news_config->jam_batch : 0;
+    }
+
+    if (mail_config && mail_config->lmtp) {
+        storage->lmtp = ftn_lmtp_client_new(mail_config->lmtp, mail_config->lmtp_domain,
+                                            mail_config->lmtp_batch > 0 ? (size_t)mail_config->lmtp_batch : 0);
+        if (!storage->lmtp) {
+            ftn_storage_free(storage);
+            return NULL;
+        }
     }
 
     return storage;
 }
 
 void ftn_storage_free(ftn_storage_t* storage) {
+    size_t i;
+
     if (!storage) return;
 
     if (storage->active_file) {
         fclose(storage->active_file);
     }
 
+    if (storage->lmtp) {
+        ftn_storage_flush_mail(storage);
+        ftn_lmtp_client_free(storage->lmtp);
+    }
+
+    if (storage->nntp) {
+        ftn_storage_flush_news(storage);
+        ftn_nntp_feed_free(storage->nntp);
+    }
+
+    if (storage_close_packs(storage) != FTN_OK) {
+        logf_error("Failed to update active file %s", storage->active_file_path);
+    }
+    ftn_storage_safe_free(storage->packs);
+
+    for (i = 0; i < storage->jam_count; i++) {
+        if (ftn_jam_flush(storage->jam[i].base) != FTN_OK) {
+            logf_error("Failed to write JAM base %s", storage->jam[i].base->path);
+        }
+        ftn_jam_close(storage->jam[i].base);
+    }
+    ftn_storage_safe_free(storage->jam);
+    ftn_storage_safe_free(storage->jam_root);
+
+    storage_maildir_clear(storage);
+    ftn_storage_safe_free(storage->maildirs);
+    ftn_storage_safe_free(storage->maildir_spare.path);
+    ftn_path_template_free(storage->own_template);
+
     ftn_storage_safe_free(storage->news_root);
     ftn_storage_safe_free(storage->mail_root);
     ftn_storage_safe_free(storage->active_file_path);
@@ -235,61 +316,165 @@ void ftn_maildir_file_free(ftn_maildir_file_t* file_info) {
     memset(file_info, 0, sizeof(ftn_maildir_file_t));
 }
 
-ftn_error_t ftn_storage_store_mail(ftn_storage_t* storage, const ftn_message_t* msg,
-                                  const char* username, const char* network) {
-    char* expanded_path = NULL;
-    char* rfc822_text = NULL;
-    char* domain = NULL;
-    ftn_maildir_file_t file_info;
-    FILE* tmp_file = NULL;
-    ftn_error_t result = FTN_OK;
-    const ftn_network_config_t* net_config;
+#define FTN_STORAGE_MAILDIR_SLOTS 64
 
-    if (!storage || !msg || !username || !network) {
-        return FTN_ERROR_INVALID_PARAMETER;
-    }
+static unsigned long storage_maildir_hash(unsigned int user_id, unsigned int network_id) {
+    return ((user_id * 2654435761UL) ^ (network_id * 40503UL)) & 0xFFFFFFFFUL;
+}
 
-    if (!storage->mail_root) {
-        return FTN_ERROR_INVALID;
+static ftn_storage_maildir_t* storage_maildir_slot(ftn_storage_maildir_t* table, size_t capacity,
+                                                   unsigned int user_id, unsigned int network_id) {
+    size_t i = storage_maildir_hash(user_id, network_id) & (capacity - 1);
+
+    while (table[i].path && (table[i].user_id != user_id || table[i].network_id != network_id)) {
+        i = (i + 1) & (capacity - 1);
     }
+    return &table[i];
+}
 
-    /* Get network configuration for domain */
-    net_config = ftn_config_get_network(storage->config, network);
-    if (net_config && net_config->domain) {
-        domain = net_config->domain;
-    } else {
-        domain = "fidonet.org";  /* Default domain */
+/* Drop every cached Maildir. Removing single entries would break the
+   probe chains, and a fresh expansion is cheap next to a delivery. */
+static void storage_maildir_clear(ftn_storage_t* storage) {
+    size_t i;
+
+    for (i = 0; i < storage->maildir_capacity; i++) {
+        ftn_storage_safe_free(storage->maildirs[i].path);
+        memset(&storage->maildirs[i], 0, sizeof(ftn_storage_maildir_t));
     }
+    storage->maildir_count = 0;
+}
 
-    /* Expand path template */
-    expanded_path = ftn_storage_expand_path(storage->mail_root, username, network);
-    if (!expanded_path) {
+static ftn_error_t storage_maildir_grow(ftn_storage_t* storage) {
+    ftn_storage_maildir_t* table;
+    size_t capacity;
+    size_t i;
+
+    capacity = storage->maildir_capacity ? storage->maildir_capacity * 2 : FTN_STORAGE_MAILDIR_SLOTS;
+    table = calloc(capacity, sizeof(ftn_storage_maildir_t));
+    if (!table) {
         return FTN_ERROR_NOMEM;
     }
 
-    /* Create maildir if it doesn't exist */
-    result = ftn_storage_create_maildir(expanded_path);
-    if (result != FTN_OK) {
-        goto cleanup;
+    for (i = 0; i < storage->maildir_capacity; i++) {
+        ftn_storage_maildir_t* old = &storage->maildirs[i];
+        if (old->path) {
+            *storage_maildir_slot(table, capacity, old->user_id, old->network_id) = *old;
+        }
     }
 
-    /* Convert FTN message to RFC822 */
-    result = ftn_storage_convert_to_rfc822(msg, domain, &rfc822_text);
-    if (result != FTN_OK) {
-        goto cleanup;
+    free(storage->maildirs);
+    storage->maildirs = table;
+    storage->maildir_capacity = capacity;
+    return FTN_OK;
+}
+
+/* Find the Maildir for a user, expanding the template the first time.
+   Users and networks are keyed by their interned IDs. Variables the
+   template does not use are left out of the key, so a plain inbox path
+   is one entry shared by every user. Names past the intern table's
+   limit get a Maildir expanded for this message only. */
+static ftn_storage_maildir_t* storage_maildir(ftn_storage_t* storage, const char* username,
+                                              const char* network) {
+    const ftn_path_template_t* tpl = storage->mail_template;
+    const char* user = (tpl->uses_user && username) ? username : "";
+    unsigned int user_id = FTN_INTERN_NONE;
+    unsigned int network_id = FTN_INTERN_NONE;
+    ftn_storage_maildir_t* entry;
+
+    if (*user) {
+        user_id = ftn_intern(FTN_INTERN_USER, user);
+    }
+    if (tpl->uses_network && network) {
+        network_id = ftn_intern(FTN_INTERN_NETWORK, network);
+    }
+    if ((*user && user_id == FTN_INTERN_NONE) ||
+        (tpl->uses_network && network && network_id == FTN_INTERN_NONE)) {
+        entry = &storage->maildir_spare;
+        ftn_storage_safe_free(entry->path);
+        entry->path = ftn_path_template_expand(tpl, user, network ? network : "");
+        entry->exists = 0;
+        return entry->path ? entry : NULL;
+    }
+
+    if (storage->maildir_capacity) {
+        entry = storage_maildir_slot(storage->maildirs, storage->maildir_capacity, user_id, network_id);
+        if (entry->path) {
+            return entry;
+        }
+    }
+
+    /* A run with mail for many users keeps the table bounded */
+    if (storage->maildir_count >= FTN_STORAGE_MAILDIR_MAX) {
+        storage_maildir_clear(storage);
+    }
+    if ((storage->maildir_count + 1) * 4 > storage->maildir_capacity * 3 &&
+        storage_maildir_grow(storage) != FTN_OK) {
+        return NULL;
+    }
+
+    entry = storage_maildir_slot(storage->maildirs, storage->maildir_capacity, user_id, network_id);
+    entry->path = ftn_path_template_expand(tpl, user, network ? network : "");
+    if (!entry->path) {
+        return NULL;
+    }
+    entry->user_id = user_id;
+    entry->network_id = network_id;
+    entry->exists = 0;
+    storage->maildir_count++;
+
+    return entry;
+}
+
+/* Write rendered mail into a user's Maildir */
+static ftn_error_t storage_write_maildir(ftn_storage_t* storage, const char* rfc822_text,
+                                         const char* username, const char* network) {
+    ftn_storage_maildir_t* maildir;
+    ftn_maildir_file_t file_info;
+    FILE* tmp_file = NULL;
+    int checked = 0;
+    ftn_error_t result = FTN_OK;
+
+    memset(&file_info, 0, sizeof(file_info));
+
+    if (!storage->mail_root) {
+        return FTN_ERROR_INVALID;
+    }
+
+    maildir = storage_maildir(storage, username, network);
+    if (!maildir) {
+        return FTN_ERROR_NOMEM;
     }
 
     /* Generate maildir filename */
-    result = ftn_storage_generate_maildir_filename(&file_info, expanded_path);
+    result = ftn_storage_generate_maildir_filename(&file_info, maildir->path);
     if (result != FTN_OK) {
         goto cleanup;
     }
 
-    /* Write to tmp directory first (atomic operation) */
-    tmp_file = fopen(file_info.tmp_path, "w");
+    /* Write to tmp directory first (atomic operation). The directories are
+       only checked the first time, or again if they have gone away. */
+    if (maildir->exists) {
+        tmp_file = fopen(file_info.tmp_path, "w");
+        if (!tmp_file) {
+            maildir->exists = 0;
+        }
+    }
     if (!tmp_file) {
-        result = FTN_ERROR_FILE;
-        goto cleanup;
+        result = ftn_storage_create_directory_recursive(maildir->path, FTN_STORAGE_DIR_MODE);
+        if (result == FTN_OK) {
+            result = ftn_storage_create_maildir(maildir->path);
+        }
+        if (result != FTN_OK) {
+            goto cleanup;
+        }
+        maildir->exists = 1;
+        checked = 1;
+
+        tmp_file = fopen(file_info.tmp_path, "w");
+        if (!tmp_file) {
+            result = FTN_ERROR_FILE;
+            goto cleanup;
+        }
     }
 
     if (fputs(rfc822_text, tmp_file) == EOF) {
@@ -300,8 +485,11 @@ ftn_error_t ftn_storage_store_mail(ftn_storage_t* storage, const ftn_message_t*
     fclose(tmp_file);
     tmp_file = NULL;
 
-    /* Move to new directory */
-    if (rename(file_info.tmp_path, file_info.new_path) != 0) {
+    /* Move to new directory. If only the cache said it was there, new/
+       may have been removed since; create the directories and try again. */
+    if (rename(file_info.tmp_path, file_info.new_path) != 0 &&
+        (checked || ftn_storage_create_maildir(maildir->path) != FTN_OK ||
+         rename(file_info.tmp_path, file_info.new_path) != 0)) {
         result = FTN_ERROR_FILE;
         unlink(file_info.tmp_path);  /* Clean up temp file */
         goto cleanup;
@@ -314,47 +502,324 @@ cleanup:
     }
 
     ftn_maildir_file_free(&file_info);
-    ftn_storage_safe_free(expanded_path);
-    ftn_storage_safe_free(rfc822_text);
 
     return result;
 }
 
-/* USENET spool operations */
-ftn_error_t ftn_storage_store_news(ftn_storage_t* storage, const ftn_message_t* msg,
-                                  const char* area, const char* network) {
-    char* newsgroup = NULL;
-    char* usenet_text = NULL;
-    char* article_dir = NULL;
-    char* article_path = NULL;
-    char* lowercase_area = NULL;
-    long article_num = 0;
-    ftn_error_t result = FTN_OK;
+ftn_error_t ftn_storage_store_mail(ftn_storage_t* storage, const ftn_message_t* msg,
+                                  const char* username, const char* network) {
+    char* rfc822_text = NULL;
+    char* mailbox;
+    const char* domain;
+    ftn_error_t result;
+    const ftn_network_config_t* net_config;
 
-    if (!storage || !msg || !area || !network) {
+    if (!storage || !msg || !username || !network) {
         return FTN_ERROR_INVALID_PARAMETER;
     }
 
-    if (!storage->news_root) {
+    if (!storage->mail_root && !storage->lmtp) {
         return FTN_ERROR_INVALID;
     }
 
-    /* Convert area to lowercase for directory structure */
-    lowercase_area = ftn_storage_sanitize_area_name(area);
-    if (!lowercase_area) {
-        return FTN_ERROR_NOMEM;
+    /* Get network configuration for domain */
+    net_config = ftn_config_get_network(storage->config, network);
+    if (net_config && net_config->domain) {
+        domain = net_config->domain;
+    } else {
+        domain = "fidonet.org";  /* Default domain */
     }
 
-    /* Generate newsgroup name */
-    newsgroup = ftn_area_to_newsgroup(network, area);
-    if (!newsgroup) {
-        free(lowercase_area);
+    /* Convert FTN message to RFC822 */
+    result = ftn_storage_convert_to_rfc822(msg, domain, &rfc822_text);
+    if (result != FTN_OK) {
+        return result;
+    }
+
+    if (!storage->lmtp) {
+        result = storage_write_maildir(storage, rfc822_text, username, network);
+        free(rfc822_text);
+        return result;
+    }
+
+    /* Hand the message to the MDA; it is delivered with the next flush */
+    mailbox = ftn_storage_sanitize_username(username);
+    if (!mailbox) {
+        free(rfc822_text);
         return FTN_ERROR_NOMEM;
     }
+    result = ftn_lmtp_queue(storage->lmtp, mailbox, network, rfc822_text);
+    free(mailbox);
+    if (result == FTN_ERROR_INVALID_PARAMETER) {
+        /* A recipient the MDA cannot be given goes where undelivered mail goes */
+        result = storage_write_maildir(storage, rfc822_text, username, network);
+        free(rfc822_text);
+        if (result != FTN_OK) {
+            storage->undelivered = 1;
+        }
+        return result;
+    }
+    if (result != FTN_OK) {
+        free(rfc822_text);
+        return result;
+    }
 
-    /* Convert FTN message to USENET format */
-    result = ftn_storage_convert_to_usenet(msg, network, &usenet_text);
+    if (ftn_lmtp_queue_full(storage->lmtp)) {
+        return ftn_storage_flush_mail(storage);
+    }
+    return FTN_OK;
+}
+
+ftn_error_t ftn_storage_flush_mail(ftn_storage_t* storage) {
+    ftn_lmtp_message_t* msg;
+    ftn_error_t result = FTN_OK;
+    size_t i;
+
+    if (!storage) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    if (!storage->lmtp || storage->lmtp->queue_count == 0) {
+        return FTN_OK;
+    }
+
+    if (ftn_lmtp_flush(storage->lmtp) != FTN_OK) {
+        logf_error("LMTP delivery to %s failed", storage->lmtp->proto.target);
+    }
+
+    /* Whatever the MDA did not take goes to the Maildir so nothing is lost */
+    for (i = 0; i < storage->lmtp->queue_count; i++) {
+        msg = &storage->lmtp->queue[i];
+        if (ftn_lmtp_delivered(msg)) {
+            continue;
+        }
+        if (storage_write_maildir(storage, msg->text, msg->user, msg->network) != FTN_OK) {
+            logf_error("Failed to store undelivered mail for user: %s", msg->user);
+            result = FTN_ERROR_FILE;
+        }
+    }
+
+    /* Remembered for the tosser, which may not be the caller when the queue filled up */
     if (result != FTN_OK) {
+        storage->undelivered = 1;
+    }
+    ftn_lmtp_clear(storage->lmtp);
+    return result;
+}
+
+/* USENET spool operations */
+/* Write a rendered article into the news spool */
+/* Bring the active file up to date for every pack appended to, in one rewrite */
+static ftn_error_t storage_update_pack_active(ftn_storage_t* storage) {
+    char temp_path[512];
+    char line[1024];
+    char existing_newsgroup[256];
+    long existing_high, existing_low;
+    long first, last;
+    char existing_perm;
+    const char* newsgroup;
+    FILE* active_fp;
+    FILE* temp_fp;
+    ftn_storage_pack_t* entry;
+    int* written;
+    int touched = 0;
+    size_t i;
+    ftn_error_t result = FTN_OK;
+
+    for (i = 0; i < storage->pack_count; i++) {
+        touched |= storage->packs[i].touched;
+    }
+    if (!touched) {
+        return FTN_OK;
+    }
+    if (!storage->active_file_path) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    written = calloc(storage->pack_count, sizeof(int));
+    if (!written) {
+        return FTN_ERROR_NOMEM;
+    }
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", storage->active_file_path);
+    active_fp = fopen(storage->active_file_path, "r");
+    temp_fp = fopen(temp_path, "w");
+    if (!temp_fp) {
+        if (active_fp) fclose(active_fp);
+        free(written);
+        return FTN_ERROR_FILE;
+    }
+
+    /* The range of a pack comes from its index, not from the old entry */
+    while (active_fp && fgets(line, sizeof(line), active_fp)) {
+        entry = NULL;
+        if (sscanf(line, "%255s %ld %ld %c", existing_newsgroup, &existing_high, &existing_low, &existing_perm) == 4) {
+            for (i = 0; i < storage->pack_count && !entry; i++) {
+                newsgroup = storage->packs[i].newsgroup;
+                if (storage->packs[i].touched && strcmp(newsgroup, existing_newsgroup) == 0) {
+                    entry = &storage->packs[i];
+                    written[i] = 1;
+                }
+            }
+        }
+        if (entry && ftn_pack_range(entry->pack, &first, &last) == FTN_OK) {
+            fprintf(temp_fp, "%s %ld %ld %c\n", existing_newsgroup, last, first, existing_perm);
+        } else {
+            fputs(line, temp_fp);
+        }
+    }
+    if (active_fp) {
+        fclose(active_fp);
+    }
+
+    for (i = 0; i < storage->pack_count; i++) {
+        entry = &storage->packs[i];
+        if (entry->touched && !written[i] && ftn_pack_range(entry->pack, &first, &last) == FTN_OK) {
+            fprintf(temp_fp, "%s %ld %ld y\n", entry->newsgroup, last, first);
+        }
+    }
+    free(written);
+
+    if (fclose(temp_fp) != 0 || rename(temp_path, storage->active_file_path) != 0) {
+        unlink(temp_path);
+        result = FTN_ERROR_FILE;
+    } else {
+        for (i = 0; i < storage->pack_count; i++) {
+            storage->packs[i].touched = 0;
+        }
+    }
+    return result;
+}
+
+static ftn_error_t storage_close_packs(ftn_storage_t* storage) {
+    ftn_error_t result;
+    size_t i;
+
+    result = storage_update_pack_active(storage);
+    for (i = 0; i < storage->pack_count; i++) {
+        ftn_pack_close(storage->packs[i].pack);
+        free(storage->packs[i].newsgroup);
+    }
+    storage->pack_count = 0;
+    return result;
+}
+
+/* Find or open the pack for a newsgroup: <path>/<network>/<lowercase area>.pack.
+   Areas that could not be interned (FTN_INTERN_NONE) are told apart by name. */
+static ftn_storage_pack_t* storage_pack(ftn_storage_t* storage, ftn_intern_id_t area_id,
+                                        ftn_intern_id_t network_id, const char* network,
+                                        const char* lowercase_area, const char* newsgroup) {
+    ftn_storage_pack_t* grown;
+    ftn_pack_t* pack;
+    char* name;
+    char* dir;
+    char* path;
+    size_t new_capacity;
+    size_t i;
+
+    for (i = 0; i < storage->pack_count; i++) {
+        if (storage->packs[i].area_id == area_id && storage->packs[i].network_id == network_id &&
+            (area_id != FTN_INTERN_NONE || strcmp(storage->packs[i].newsgroup, newsgroup) == 0)) {
+            return &storage->packs[i];
+        }
+    }
+
+    if (storage->pack_count >= FTN_STORAGE_MAX_PACKS &&
+        storage_close_packs(storage) != FTN_OK) {
+        logf_error("Failed to update active file %s", storage->active_file_path);
+    }
+    if (storage->pack_count == storage->pack_capacity) {
+        new_capacity = storage->pack_capacity ? storage->pack_capacity * 2 : 16;
+        grown = realloc(storage->packs, new_capacity * sizeof(ftn_storage_pack_t));
+        if (!grown) {
+            return NULL;
+        }
+        storage->packs = grown;
+        storage->pack_capacity = new_capacity;
+    }
+
+    dir = malloc(strlen(storage->news_root) + strlen(network) + 2);
+    path = malloc(strlen(storage->news_root) + strlen(network) + strlen(lowercase_area) + 3);
+    if (!dir || !path) {
+        ftn_storage_safe_free(dir);
+        ftn_storage_safe_free(path);
+        return NULL;
+    }
+    sprintf(dir, "%s/%s", storage->news_root, network);
+    sprintf(path, "%s/%s", dir, lowercase_area);
+
+    pack = NULL;
+    if (ftn_storage_create_directory_recursive(dir, FTN_STORAGE_DIR_MODE) == FTN_OK) {
+        pack = ftn_pack_open(path, storage->pack);
+    }
+    if (!pack) {
+        logf_error("Failed to open pack %s", path);
+    }
+    free(dir);
+    free(path);
+    if (!pack) {
+        return NULL;
+    }
+    name = ftn_storage_strdup(newsgroup);
+    if (!name) {
+        ftn_pack_close(pack);
+        return NULL;
+    }
+
+    storage->packs[storage->pack_count].newsgroup = name;
+    storage->packs[storage->pack_count].area_id = area_id;
+    storage->packs[storage->pack_count].network_id = network_id;
+    storage->packs[storage->pack_count].pack = pack;
+    storage->packs[storage->pack_count].touched = 0;
+    return &storage->packs[storage->pack_count++];
+}
+
+static ftn_error_t storage_write_article(ftn_storage_t* storage, const char* usenet_text,
+                                         const char* area, const char* network) {
+    const char* newsgroup;
+    const char* lowercase_area;
+    char* own_newsgroup = NULL;
+    char* own_lowercase = NULL;
+    char* article_dir = NULL;
+    char* article_path = NULL;
+    ftn_intern_id_t area_id;
+    ftn_intern_id_t network_id;
+    long article_num = 0;
+    ftn_error_t result = FTN_OK;
+
+    if (!storage->news_root) {
+        return FTN_ERROR_INVALID;
+    }
+
+    /* Lowercase directory name and newsgroup are cached per interned area.
+       Once the intern table is full they are built for each message. */
+    area_id = ftn_intern(FTN_INTERN_AREA, area);
+    network_id = ftn_intern(FTN_INTERN_NETWORK, network);
+    lowercase_area = ftn_intern_lower(FTN_INTERN_AREA, area_id);
+    newsgroup = ftn_intern_newsgroup(network_id, area_id);
+    if (!lowercase_area || !newsgroup) {
+        area_id = FTN_INTERN_NONE;
+        own_lowercase = ftn_storage_sanitize_area_name(area);
+        own_newsgroup = ftn_area_to_newsgroup(network, area);
+        if (!own_lowercase || !own_newsgroup) {
+            result = FTN_ERROR_NOMEM;
+            goto cleanup;
+        }
+        lowercase_area = own_lowercase;
+        newsgroup = own_newsgroup;
+    }
+
+    /* Pack spool: one append, and the active file is updated at the next flush */
+    if (storage->pack) {
+        ftn_storage_pack_t* entry = storage_pack(storage, area_id, network_id, network,
+                                                 lowercase_area, newsgroup);
+        if (!entry) {
+            result = FTN_ERROR_FILE;
+            goto cleanup;
+        }
+        result = ftn_pack_append(entry->pack, usenet_text, strlen(usenet_text), &article_num);
+        if (result == FTN_OK) {
+            entry->touched = 1;
+        }
         goto cleanup;
     }
 
@@ -396,15 +861,322 @@ ftn_error_t ftn_storage_store_news(ftn_storage_t* storage, const ftn_message_t*
     result = ftn_storage_update_active_file(storage, newsgroup, article_num);
 
 cleanup:
-    ftn_storage_safe_free(newsgroup);
-    ftn_storage_safe_free(usenet_text);
     ftn_storage_safe_free(article_dir);
     ftn_storage_safe_free(article_path);
-    ftn_storage_safe_free(lowercase_area);
+    ftn_storage_safe_free(own_newsgroup);
+    ftn_storage_safe_free(own_lowercase);
+
+    return result;
+}
+
+/* Build an NNTP Message-ID from the MSGID kludge. "2:5020/1@fidonet 1a2b3c4d"
+   becomes "<1a2b3c4d.2.5020.1.fidonet@fidonet.ftn>", so the same message always
+   gets the same ID and the news server can drop duplicates. */
+static char* storage_nntp_message_id(const ftn_message_t* msg, const char* network) {
+    char local[256];
+    const char* serial;
+    const char* p;
+    char* result;
+    size_t len = 0;
+    unsigned long hash = 2166136261UL;
+
+    if (msg->msgid && (serial = strrchr(msg->msgid, ' ')) != NULL && serial[1]) {
+        for (p = serial + 1; *p && len < sizeof(local) / 2; p++) {
+            local[len++] = isalnum((unsigned char)*p) ? *p : '.';
+        }
+        local[len++] = '.';
+        for (p = msg->msgid; p < serial && len < sizeof(local) - 1; p++) {
+            local[len++] = isalnum((unsigned char)*p) || *p == '-' ? *p : '.';
+        }
+        local[len] = '\0';
+    } else {
+        /* No MSGID: name the article after its body */
+        for (p = msg->text ? msg->text : ""; *p; p++) {
+            hash = ((hash ^ (unsigned char)*p) * 16777619UL) & 0xFFFFFFFFUL;
+        }
+        sprintf(local, "%08lx.%lx", hash, (unsigned long)msg->timestamp);
+    }
+
+    result = malloc(strlen(local) + strlen(network) + 8);
+    if (result) {
+        sprintf(result, "<%s@%s.ftn>", local, network);
+    }
+    return result;
+}
+
+/* Render an article for the feed: a usable Message-ID and a Path header */
+static ftn_error_t storage_queue_article(ftn_storage_t* storage, const ftn_message_t* msg,
+                                        const char* area, const char* network) {
+    rfc822_message_t* usenet_msg = NULL;
+    char* usenet_text = NULL;
+    char* message_id = NULL;
+    char* path = NULL;
+    ftn_error_t result;
+
+    result = ftn_to_usenet(msg, network, &usenet_msg);
+    if (result != FTN_OK) {
+        return result;
+    }
+
+    message_id = storage_nntp_message_id(msg, network);
+    path = malloc(strlen(network) + 16);
+    if (!message_id || !path) {
+        result = FTN_ERROR_NOMEM;
+        goto cleanup;
+    }
+    sprintf(path, "%s!not-for-mail", network);
+
+    if ((result = rfc822_message_set_header(usenet_msg, "Message-ID", message_id)) != FTN_OK ||
+        (result = rfc822_message_set_header(usenet_msg, "Path", path)) != FTN_OK) {
+        goto cleanup;
+    }
+    usenet_text = rfc822_message_to_text(usenet_msg);
+    if (!usenet_text) {
+        result = FTN_ERROR_NOMEM;
+        goto cleanup;
+    }
+
+    result = ftn_nntp_queue(storage->nntp, message_id, area, network, usenet_text);
+    if (result == FTN_OK) {
+        usenet_text = NULL;
+    }
+
+cleanup:
+    rfc822_message_free(usenet_msg);
+    ftn_storage_safe_free(usenet_text);
+    ftn_storage_safe_free(message_id);
+    ftn_storage_safe_free(path);
+
+    return result;
+}
+
+/* Find or open the JAM base for an area: <jam>/<network>/<lowercase area> */
+static ftn_jam_base_t* storage_jam_base(ftn_storage_t* storage, const char* area, const char* network) {
+    ftn_storage_jam_t* grown;
+    ftn_jam_base_t* base;
+    ftn_intern_id_t area_id;
+    ftn_intern_id_t network_id;
+    const char* lowercase_area;
+    char* own_lowercase = NULL;
+    char* dir;
+    char* path;
+    size_t new_capacity;
+    size_t i;
+
+    /* Once the intern table is full, bases are found by their path */
+    area_id = ftn_intern(FTN_INTERN_AREA, area);
+    network_id = ftn_intern(FTN_INTERN_NETWORK, network);
+    lowercase_area = ftn_intern_lower(FTN_INTERN_AREA, area_id);
+    if (!lowercase_area || network_id == FTN_INTERN_NONE) {
+        area_id = FTN_INTERN_NONE;
+        own_lowercase = ftn_storage_sanitize_area_name(area);
+        if (!own_lowercase) {
+            return NULL;
+        }
+        lowercase_area = own_lowercase;
+    } else {
+        for (i = 0; i < storage->jam_count; i++) {
+            if (storage->jam[i].area_id == area_id && storage->jam[i].network_id == network_id) {
+                return storage->jam[i].base;
+            }
+        }
+    }
+
+    dir = malloc(strlen(storage->jam_root) + strlen(network) + 2);
+    path = malloc(strlen(storage->jam_root) + strlen(network) + strlen(lowercase_area) + 3);
+    if (!dir || !path) {
+        ftn_storage_safe_free(dir);
+        ftn_storage_safe_free(path);
+        ftn_storage_safe_free(own_lowercase);
+        return NULL;
+    }
+    sprintf(dir, "%s/%s", storage->jam_root, network);
+    sprintf(path, "%s/%s", dir, lowercase_area);
+
+    base = NULL;
+    for (i = 0; i < storage->jam_count && own_lowercase; i++) {
+        if (storage->jam[i].area_id == FTN_INTERN_NONE && strcmp(storage->jam[i].base->path, path) == 0) {
+            base = storage->jam[i].base;
+            break;
+        }
+    }
+    ftn_storage_safe_free(own_lowercase);
+    if (base) {
+        free(dir);
+        free(path);
+        return base;
+    }
+
+    if (storage->jam_count == storage->jam_capacity) {
+        new_capacity = storage->jam_capacity ? storage->jam_capacity * 2 : 16;
+        grown = realloc(storage->jam, new_capacity * sizeof(ftn_storage_jam_t));
+        if (!grown) {
+            free(dir);
+            free(path);
+            return NULL;
+        }
+        storage->jam = grown;
+        storage->jam_capacity = new_capacity;
+    }
+
+    if (ftn_storage_create_directory_recursive(dir, FTN_STORAGE_DIR_MODE) == FTN_OK) {
+        base = ftn_jam_open(path, storage->jam_batch);
+    }
+    if (base) {
+        storage->jam[storage->jam_count].area_id = area_id;
+        storage->jam[storage->jam_count].network_id = network_id;
+        storage->jam[storage->jam_count].base = base;
+        storage->jam_count++;
+    } else {
+        logf_error("Failed to open JAM base %s", path);
+    }
+
+    free(dir);
+    free(path);
+    return base;
+}
+
+static ftn_error_t storage_store_jam(ftn_storage_t* storage, const ftn_message_t* msg,
+                                     const char* area, const char* network) {
+    ftn_jam_base_t* base;
+    ftn_error_t result;
 
+    base = storage_jam_base(storage, area, network);
+    if (!base) {
+        return FTN_ERROR_FILE;
+    }
+
+    result = ftn_jam_append(base, msg);
+    if (result == FTN_OK && ftn_jam_batch_full(base)) {
+        result = ftn_jam_flush(base);
+        if (result != FTN_OK) {
+            logf_error("Failed to write JAM base %s", base->path);
+        }
+    }
+    return result;
+}
+
+/* Write out every queued JAM message; each base is locked on its own */
+static ftn_error_t storage_flush_jam(ftn_storage_t* storage) {
+    ftn_error_t result = FTN_OK;
+    size_t i;
+
+    for (i = 0; i < storage->jam_count; i++) {
+        if (ftn_jam_flush(storage->jam[i].base) != FTN_OK) {
+            logf_error("Failed to write JAM base %s", storage->jam[i].base->path);
+            result = FTN_ERROR_FILE;
+        }
+    }
     return result;
 }
 
+ftn_error_t ftn_storage_store_news(ftn_storage_t* storage, const ftn_message_t* msg,
+                                  const char* area, const char* network) {
+    char* usenet_text = NULL;
+    ftn_error_t result;
+
+    if (!storage || !msg || !area || !network) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    if (!storage->news_root && !storage->nntp && !storage->jam_root) {
+        return FTN_ERROR_INVALID;
+    }
+
+    /* JAM bases are written alongside the spool or the feed, if either is set up */
+    if (storage->jam_root) {
+        result = storage_store_jam(storage, msg, area, network);
+        if (result != FTN_OK || (!storage->news_root && !storage->nntp)) {
+            return result;
+        }
+    }
+
+    /* Feed the news server; the article goes out with the next flush */
+    if (storage->nntp) {
+        result = storage_queue_article(storage, msg, area, network);
+        if (result == FTN_OK && ftn_nntp_queue_full(storage->nntp)) {
+            result = ftn_storage_flush_news(storage);
+        }
+        return result;
+    }
+
+    /* Convert FTN message to USENET format */
+    result = ftn_storage_convert_to_usenet(msg, network, &usenet_text);
+    if (result != FTN_OK) {
+        return result;
+    }
+
+    result = storage_write_article(storage, usenet_text, area, network);
+    ftn_storage_safe_free(usenet_text);
+
+    return result;
+}
+
+ftn_error_t ftn_storage_flush_news(ftn_storage_t* storage) {
+    ftn_nntp_article_t* article;
+    ftn_error_t result = FTN_OK;
+    size_t i;
+
+    if (!storage) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    result = storage_flush_jam(storage);
+    if (!storage->nntp || storage->nntp->queue_count == 0) {
+        if (storage_update_pack_active(storage) != FTN_OK) {
+            result = FTN_ERROR_FILE;
+        }
+        return result;
+    }
+
+    if (ftn_nntp_flush(storage->nntp) != FTN_OK) {
+        logf_error("NNTP feed to %s failed", storage->nntp->proto.target);
+    }
+
+    /* Articles the server did not decide on are spooled for it to pick up later */
+    for (i = 0; i < storage->nntp->queue_count; i++) {
+        article = &storage->nntp->queue[i];
+        if (ftn_nntp_done(article)) {
+            continue;
+        }
+        if (!storage->news_root ||
+            storage_write_article(storage, article->text, article->area, article->network) != FTN_OK) {
+            logf_error("Failed to spool unfed article %s", article->message_id);
+            result = FTN_ERROR_FILE;
+        }
+    }
+
+    /* Without a spool the articles left are gone; the tosser keeps their packet */
+    if (result != FTN_OK) {
+        storage->undelivered = 1;
+    }
+    ftn_nntp_clear(storage->nntp);
+    if (storage_update_pack_active(storage) != FTN_OK) {
+        result = FTN_ERROR_FILE;
+    }
+    return result;
+}
+
+ftn_error_t ftn_storage_flush(ftn_storage_t* storage) {
+    ftn_error_t mail_result;
+    ftn_error_t news_result;
+
+    if (!storage) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    mail_result = ftn_storage_flush_mail(storage);
+    news_result = ftn_storage_flush_news(storage);
+
+    /* Also report losses from flushes made when a queue filled up */
+    if (storage->undelivered) {
+        storage->undelivered = 0;
+        if (mail_result == FTN_OK && news_result == FTN_OK) {
+            return FTN_ERROR_FILE;
+        }
+    }
+    return mail_result != FTN_OK ? mail_result : news_result;
+}
+
 ftn_error_t ftn_storage_create_newsgroup(ftn_storage_t* storage, const char* newsgroup) {
     char* dir_path;
     char* work_path;
@@ -473,56 +1245,16 @@ void ftn_message_list_free(ftn_message_list_t* list) {
 
 /* Utility functions */
 char* ftn_storage_expand_path(const char* template, const char* username, const char* network) {
+    ftn_path_template_t* tpl;
     char* result;
-    char* src;
-    char* dst;
-    size_t max_len;
-    const char* user_str = username ? username : "";
-    const char* net_str = network ? network : "";
-
-    if (!template) {
-        return NULL;
-    }
 
-    /* Calculate maximum possible length (very conservative) */
-    max_len = strlen(template) +
-              (username ? strlen(username) * 10 : 0) +
-              (network ? strlen(network) * 10 : 0) + 100;
-
-    result = malloc(max_len);
-    if (!result) {
+    tpl = ftn_path_template_compile(template);
+    if (!tpl) {
         return NULL;
     }
 
-    /* Simple character-by-character substitution */
-    src = (char*)template;
-    dst = result;
-
-    while (*src && (dst - result) < (int)max_len - 50) {
-        if (strncmp(src, "%USER%", 6) == 0) {
-            strcpy(dst, user_str);
-            dst += strlen(user_str);
-            src += 6;
-        } else if (strncmp(src, "%NETWORK%", 9) == 0) {
-            strcpy(dst, net_str);
-            dst += strlen(net_str);
-            src += 9;
-        } else {
-            *dst++ = *src++;
-        }
-    }
-    *dst = '\0';
-
-    /* Reallocate to actual size */
-    {
-        char* trimmed = malloc(strlen(result) + 1);
-        if (trimmed) {
-            strcpy(trimmed, result);
-            free(result);
-            result = trimmed;
-        }
-    }
-
+    result = ftn_path_template_expand(tpl, username ? username : "", network ? network : "");
+    ftn_path_template_free(tpl);
     return result;
 }
 
@@ -592,6 +1324,7 @@ ftn_error_t ftn_storage_generate_message_filename(const ftn_message_t* msg, char
     char timestamp_str[32];
     char from_addr[64];
     char to_addr[64];
+    struct tm tm_buf;
     struct tm* tm_info;
 
     if (!msg || !filename) {
@@ -636,7 +1369,7 @@ ftn_error_t ftn_storage_generate_message_filename(const ftn_message_t* msg, char
     ftn_address_to_string(&msg->dest_addr, to_addr, sizeof(to_addr));
 
     if (msg->timestamp > 0) {
-        tm_info = gmtime(&msg->timestamp);
+        tm_info = ftn_gmtime_r(&msg->timestamp, &tm_buf);
         if (tm_info) {
             snprintf(timestamp_str, sizeof(timestamp_str), "%04d%02d%02d_%02d%02d%02d",
                      tm_info->tm_year + 1900, tm_info->tm_mon + 1, tm_info->tm_mday,
@@ -647,7 +1380,7 @@ ftn_error_t ftn_storage_generate_message_filename(const ftn_message_t* msg, char
     } else {
         /* Use current time if no timestamp available */
         time_t now = time(NULL);
-        tm_info = gmtime(&now);
+        tm_info = ftn_gmtime_r(&now, &tm_buf);
         if (tm_info) {
             snprintf(timestamp_str, sizeof(timestamp_str), "%04d%02d%02d_%02d%02d%02d",
                      tm_info->tm_year + 1900, tm_info->tm_mon + 1, tm_info->tm_mday,
@@ -0,0 +1,241 @@
+/*
+ * textproto.c - Line-based client connections for LMTP and NNTP
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "ftn.h"
+#include "ftn/textproto.h"
+#include "ftn/net.h"
+#include "ftn/log.h"
+
+char* ftn_textproto_strdup(const char* str) {
+    char* result;
+
+    if (!str) return NULL;
+    result = malloc(strlen(str) + 1);
+    if (result) {
+        strcpy(result, str);
+    }
+    return result;
+}
+
+/* Lifecycle */
+ftn_error_t ftn_textproto_init(ftn_textproto_t* proto, const char* protocol, const char* target) {
+    memset(proto, 0, sizeof(ftn_textproto_t));
+    proto->protocol = protocol;
+    proto->target = ftn_textproto_strdup(target);
+    return proto->target ? FTN_OK : FTN_ERROR_NOMEM;
+}
+
+void ftn_textproto_free(ftn_textproto_t* proto) {
+    ftn_textproto_close(proto);
+    free(proto->out);
+    free(proto->target);
+    proto->out = NULL;
+    proto->target = NULL;
+}
+
+/* Connection management */
+ftn_error_t ftn_textproto_connect(ftn_textproto_t* proto, int default_port, int timeout_ms) {
+    char hostname[256];
+    const char* path;
+    char* colon;
+    int port = default_port;
+
+    proto->in_len = 0;
+    proto->in_pos = 0;
+    proto->out_len = 0;
+    proto->last_reply[0] = '\0';
+
+    path = proto->target;
+    if (strncmp(path, "unix:", 5) == 0) {
+        path += 5;
+    }
+    if (strchr(path, '/') || path != proto->target) {
+        proto->conn = ftn_net_connect_unix(path, timeout_ms);
+    } else {
+        strncpy(hostname, proto->target, sizeof(hostname) - 1);
+        hostname[sizeof(hostname) - 1] = '\0';
+        colon = strrchr(hostname, ':');
+        if (colon) {
+            *colon = '\0';
+            port = atoi(colon + 1);
+        }
+        proto->conn = ftn_net_connect(hostname, port, timeout_ms);
+        if (proto->conn) {
+            ftn_net_set_timeout(proto->conn, timeout_ms);
+            ftn_net_set_nodelay(proto->conn, 1);
+        }
+    }
+
+    if (!proto->conn) {
+        logf_error("%s: failed to connect to %s", proto->protocol, proto->target);
+        return FTN_ERROR_NETWORK;
+    }
+    return FTN_OK;
+}
+
+void ftn_textproto_close(ftn_textproto_t* proto) {
+    ftn_net_connection_free(proto->conn);
+    proto->conn = NULL;
+}
+
+/* Output buffer */
+ftn_error_t ftn_textproto_reserve(ftn_textproto_t* proto, size_t len) {
+    char* out;
+    size_t capacity;
+
+    if (proto->out_len + len <= proto->out_capacity) {
+        return FTN_OK;
+    }
+
+    capacity = proto->out_capacity ? proto->out_capacity : 4096;
+    while (capacity < proto->out_len + len) {
+        capacity *= 2;
+    }
+    out = realloc(proto->out, capacity);
+    if (!out) {
+        return FTN_ERROR_NOMEM;
+    }
+    proto->out = out;
+    proto->out_capacity = capacity;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_textproto_append(ftn_textproto_t* proto, const char* data, size_t len) {
+    if (ftn_textproto_reserve(proto, len) != FTN_OK) {
+        return FTN_ERROR_NOMEM;
+    }
+    memcpy(proto->out + proto->out_len, data, len);
+    proto->out_len += len;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_textproto_append_command(ftn_textproto_t* proto, const char* verb, const char* arg) {
+    if (ftn_textproto_append(proto, verb, strlen(verb)) != FTN_OK ||
+        (arg && ftn_textproto_append(proto, arg, strlen(arg)) != FTN_OK) ||
+        ftn_textproto_append(proto, "\r\n", 2) != FTN_OK) {
+        return FTN_ERROR_NOMEM;
+    }
+    return FTN_OK;
+}
+
+ftn_error_t ftn_textproto_append_dotted(ftn_textproto_t* proto, const char* text) {
+    const char* line = text;
+    const char* end;
+    size_t len;
+
+    /* Worst case every line gains a dot and a CR */
+    if (ftn_textproto_reserve(proto, strlen(text) * 2 + 8) != FTN_OK) {
+        return FTN_ERROR_NOMEM;
+    }
+
+    while (*line) {
+        end = strchr(line, '\n');
+        len = end ? (size_t)(end - line) : strlen(line);
+        if (len > 0 && line[len - 1] == '\r') {
+            len--;
+        }
+
+        if (*line == '.') {
+            proto->out[proto->out_len++] = '.';
+        }
+        memcpy(proto->out + proto->out_len, line, len);
+        proto->out_len += len;
+        proto->out[proto->out_len++] = '\r';
+        proto->out[proto->out_len++] = '\n';
+
+        if (!end) break;
+        line = end + 1;
+    }
+
+    memcpy(proto->out + proto->out_len, ".\r\n", 3);
+    proto->out_len += 3;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_textproto_write(ftn_textproto_t* proto) {
+    ftn_error_t result;
+
+    if (proto->out_len == 0) {
+        return FTN_OK;
+    }
+    result = ftn_net_send_all(proto->conn, proto->out, proto->out_len);
+    proto->out_len = 0;
+    return result;
+}
+
+/* Reply reader */
+ftn_error_t ftn_textproto_read_reply(ftn_textproto_t* proto, int* code, const char* keyword, int* has_keyword) {
+    char line[FTN_TEXTPROTO_LINE_MAX];
+    size_t line_len;
+    size_t received;
+    ftn_error_t result;
+    char c;
+
+    for (;;) {
+        line_len = 0;
+        for (;;) {
+            if (proto->in_pos >= proto->in_len) {
+                result = ftn_net_recv(proto->conn, proto->in, sizeof(proto->in), &received);
+                if (result != FTN_OK) {
+                    return result;
+                }
+                proto->in_len = received;
+                proto->in_pos = 0;
+            }
+            c = proto->in[proto->in_pos++];
+            if (c == '\n') break;
+            if (c != '\r' && line_len < sizeof(line) - 1) {
+                line[line_len++] = c;
+            }
+        }
+        line[line_len] = '\0';
+
+        if (line_len < 3 || !isdigit((unsigned char)line[0]) ||
+            !isdigit((unsigned char)line[1]) || !isdigit((unsigned char)line[2])) {
+            strcpy(proto->last_reply, line);
+            logf_error("%s: malformed reply from %s: %s", proto->protocol, proto->target, line);
+            return FTN_ERROR_INVALID;
+        }
+
+        if (keyword && line_len >= 4 + strlen(keyword) &&
+            strncmp(line + 4, keyword, strlen(keyword)) == 0) {
+            *has_keyword = 1;
+        }
+
+        /* "250-" continues, "250 " or a bare code ends the reply */
+        if (line[3] != '-') {
+            *code = atoi(line);
+            strcpy(proto->last_reply, line);
+            return FTN_OK;
+        }
+    }
+}
+
+int ftn_textproto_reply_buffered(const ftn_textproto_t* proto) {
+    return memchr(proto->in + proto->in_pos, '\n', proto->in_len - proto->in_pos) != NULL;
+}
@@ -0,0 +1,124 @@
+/*
+ * thread.c - Thread support for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "ftn/thread.h"
+
+void ftn_mutex_lock(ftn_mutex_t* mutex) {
+#if defined(FTN_NO_THREADS)
+    (void)mutex;
+#elif defined(_WIN32)
+    AcquireSRWLockExclusive(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+void ftn_mutex_unlock(ftn_mutex_t* mutex) {
+#if defined(FTN_NO_THREADS)
+    (void)mutex;
+#elif defined(_WIN32)
+    ReleaseSRWLockExclusive(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+#if !defined(FTN_NO_THREADS) && !defined(_WIN32) && !defined(__GNUC__)
+static ftn_mutex_t atomic_mutex = FTN_MUTEX_INITIALIZER;
+#endif
+
+void* ftn_atomic_load_ptr(void* const* ptr) {
+#if defined(FTN_NO_THREADS)
+    return *ptr;
+#elif defined(_WIN32)
+    return InterlockedCompareExchangePointer((PVOID volatile*)ptr, NULL, NULL);
+#elif defined(__GNUC__)
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#else
+    void* value;
+    ftn_mutex_lock(&atomic_mutex);
+    value = *ptr;
+    ftn_mutex_unlock(&atomic_mutex);
+    return value;
+#endif
+}
+
+void ftn_atomic_store_ptr(void** ptr, void* value) {
+#if defined(FTN_NO_THREADS)
+    *ptr = value;
+#elif defined(_WIN32)
+    InterlockedExchangePointer((PVOID volatile*)ptr, value);
+#elif defined(__GNUC__)
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#else
+    ftn_mutex_lock(&atomic_mutex);
+    *ptr = value;
+    ftn_mutex_unlock(&atomic_mutex);
+#endif
+}
+
+struct tm* ftn_localtime_r(const time_t* timep, struct tm* result) {
+    if (!timep || !result) return NULL;
+#if defined(_WIN32)
+    return localtime_s(result, timep) == 0 ? result : NULL;
+#else
+    return localtime_r(timep, result);
+#endif
+}
+
+struct tm* ftn_gmtime_r(const time_t* timep, struct tm* result) {
+    if (!timep || !result) return NULL;
+#if defined(_WIN32)
+    return gmtime_s(result, timep) == 0 ? result : NULL;
+#else
+    return gmtime_r(timep, result);
+#endif
+}
+
+double ftn_monotonic_time(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER count;
+    LARGE_INTEGER frequency;
+
+    if (!QueryPerformanceFrequency(&frequency) || !QueryPerformanceCounter(&count)) {
+        return 0.0;
+    }
+    return (double)count.QuadPart / (double)frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return 0.0;
+    }
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
@@ -0,0 +1,768 @@
+/*
+ * tic.c - TIC file echo processing for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/tic.h"
+#include "ftn/areafix.h"
+#include "ftn/flow.h"
+#include "ftn/log.h"
+#include "ftn/binkp/crc.h"
+#include "ftn/thread.h"
+
+/* BSO address layout used by the flow API */
+struct ftn_address {
+    int zone;
+    int net;
+    int node;
+    int point;
+    char* domain;
+};
+
+#define MAX_LINE_LENGTH   1024
+#define COPY_BUFFER_SIZE  8192
+#define INITIAL_CAPACITY  16
+
+static char* ftn_tic_strdup(const char* str) {
+    char* result;
+    if (!str) return NULL;
+
+    result = malloc(strlen(str) + 1);
+    if (result) {
+        strcpy(result, str);
+    }
+    return result;
+}
+
+static int ftn_tic_keyword(const char* keyword, const char* name) {
+    while (*keyword && *name) {
+        if (toupper((unsigned char)*keyword) != toupper((unsigned char)*name)) {
+            return 0;
+        }
+        keyword++;
+        name++;
+    }
+    return *keyword == '\0' && *name == '\0';
+}
+
+/* Replace a string field, freeing any previous value */
+static ftn_error_t ftn_tic_set(char** field, const char* value) {
+    char* copy;
+
+    copy = ftn_tic_strdup(value);
+    if (!copy) return FTN_ERROR_NOMEM;
+    free(*field);
+    *field = copy;
+    return FTN_OK;
+}
+
+static ftn_error_t ftn_tic_append(char*** lines, size_t* count, const char* value) {
+    char** grown;
+    char* copy;
+
+    copy = ftn_tic_strdup(value);
+    if (!copy) return FTN_ERROR_NOMEM;
+
+    grown = realloc(*lines, (*count + 1) * sizeof(char*));
+    if (!grown) {
+        free(copy);
+        return FTN_ERROR_NOMEM;
+    }
+    grown[*count] = copy;
+    *lines = grown;
+    (*count)++;
+    return FTN_OK;
+}
+
+static void ftn_tic_free_lines(char** lines, size_t count) {
+    size_t i;
+
+    if (!lines) return;
+    for (i = 0; i < count; i++) {
+        free(lines[i]);
+    }
+    free(lines);
+}
+
+/* File and area names become path components, so keep them to one level */
+static int ftn_tic_safe_name(const char* name) {
+    if (!name || *name == '\0' || *name == '.') return 0;
+    return strchr(name, '/') == NULL && strchr(name, '\\') == NULL;
+}
+
+ftn_tic_t* ftn_tic_new(void) {
+    ftn_tic_t* tic;
+
+    tic = malloc(sizeof(ftn_tic_t));
+    if (!tic) return NULL;
+
+    memset(tic, 0, sizeof(ftn_tic_t));
+    return tic;
+}
+
+void ftn_tic_free(ftn_tic_t* tic) {
+    if (!tic) return;
+
+    free(tic->area);
+    free(tic->file);
+    free(tic->lfn);
+    free(tic->desc);
+    free(tic->replaces);
+    free(tic->magic);
+    free(tic->password);
+    ftn_tic_free_lines(tic->ldesc, tic->ldesc_count);
+    ftn_tic_free_lines(tic->path, tic->path_count);
+    ftn_tic_free_lines(tic->extra, tic->extra_count);
+    free(tic->seenby);
+    free(tic);
+}
+
+int ftn_tic_is_seenby(const ftn_tic_t* tic, const ftn_address_t* address) {
+    size_t i;
+
+    if (!tic || !address) return 0;
+
+    for (i = 0; i < tic->seenby_count; i++) {
+        if (ftn_address_compare(&tic->seenby[i], address) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+ftn_error_t ftn_tic_add_seenby(ftn_tic_t* tic, const ftn_address_t* address) {
+    ftn_address_t* grown;
+    size_t new_capacity;
+
+    if (!tic || !address) return FTN_ERROR_INVALID_PARAMETER;
+    if (ftn_tic_is_seenby(tic, address)) return FTN_OK;
+
+    if (tic->seenby_count >= tic->seenby_capacity) {
+        new_capacity = tic->seenby_capacity ? tic->seenby_capacity * 2 : INITIAL_CAPACITY;
+        grown = realloc(tic->seenby, new_capacity * sizeof(ftn_address_t));
+        if (!grown) return FTN_ERROR_NOMEM;
+        tic->seenby = grown;
+        tic->seenby_capacity = new_capacity;
+    }
+
+    tic->seenby[tic->seenby_count++] = *address;
+    return FTN_OK;
+}
+
+static ftn_error_t ftn_tic_parse_line(ftn_tic_t* tic, char* line) {
+    char* keyword;
+    char* value;
+    char* end;
+    char* separator;
+    ftn_address_t addr;
+
+    keyword = line;
+    value = line;
+    while (*value && !isspace((unsigned char)*value)) value++;
+    separator = value;
+    if (*value) {
+        *value++ = '\0';
+        while (*value && isspace((unsigned char)*value)) value++;
+    }
+    end = value + strlen(value);
+    while (end > value && isspace((unsigned char)end[-1])) *--end = '\0';
+
+    if (ftn_tic_keyword(keyword, "Area")) return ftn_tic_set(&tic->area, value);
+    if (ftn_tic_keyword(keyword, "File")) return ftn_tic_set(&tic->file, value);
+    if (ftn_tic_keyword(keyword, "Lfn") || ftn_tic_keyword(keyword, "Fullname")) {
+        return ftn_tic_set(&tic->lfn, value);
+    }
+    if (ftn_tic_keyword(keyword, "Desc")) return ftn_tic_set(&tic->desc, value);
+    if (ftn_tic_keyword(keyword, "LDesc")) return ftn_tic_append(&tic->ldesc, &tic->ldesc_count, value);
+    if (ftn_tic_keyword(keyword, "Replaces")) return ftn_tic_set(&tic->replaces, value);
+    if (ftn_tic_keyword(keyword, "Magic")) return ftn_tic_set(&tic->magic, value);
+    if (ftn_tic_keyword(keyword, "Pw")) return ftn_tic_set(&tic->password, value);
+    if (ftn_tic_keyword(keyword, "Path")) return ftn_tic_append(&tic->path, &tic->path_count, value);
+
+    if (ftn_tic_keyword(keyword, "Size")) {
+        tic->size = strtoul(value, NULL, 10);
+        tic->has_size = 1;
+        return FTN_OK;
+    }
+    if (ftn_tic_keyword(keyword, "Crc")) {
+        tic->crc = strtoul(value, NULL, 16);
+        tic->has_crc = 1;
+        return FTN_OK;
+    }
+
+    if (ftn_tic_keyword(keyword, "Origin") || ftn_tic_keyword(keyword, "From") ||
+        ftn_tic_keyword(keyword, "To") || ftn_tic_keyword(keyword, "Seenby")) {
+        memset(&addr, 0, sizeof(addr));
+        if (!ftn_address_parse(value, &addr)) {
+            logf_warning("Ignoring bad address in TIC line: %s %s", keyword, value);
+            return FTN_OK;
+        }
+        if (ftn_tic_keyword(keyword, "Origin")) {
+            tic->origin = addr;
+        } else if (ftn_tic_keyword(keyword, "From")) {
+            tic->from = addr;
+        } else if (ftn_tic_keyword(keyword, "To")) {
+            tic->to = addr;
+            tic->has_to = 1;
+        } else {
+            return ftn_tic_add_seenby(tic, &addr);
+        }
+        return FTN_OK;
+    }
+
+    /* Keep anything else (Created, Date, ...) for the outgoing TICs */
+    if (*value) {
+        *separator = ' ';
+    }
+    return ftn_tic_append(&tic->extra, &tic->extra_count, keyword);
+}
+
+ftn_error_t ftn_tic_parse(const char* path, ftn_tic_t** tic) {
+    FILE* fp;
+    char line[MAX_LINE_LENGTH];
+    ftn_tic_t* result;
+    ftn_error_t error = FTN_OK;
+    size_t len;
+
+    if (!path || !tic) return FTN_ERROR_INVALID_PARAMETER;
+    *tic = NULL;
+
+    fp = fopen(path, "r");
+    if (!fp) return FTN_ERROR_FILE;
+
+    result = ftn_tic_new();
+    if (!result) {
+        fclose(fp);
+        return FTN_ERROR_NOMEM;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (len == 0) continue;
+
+        error = ftn_tic_parse_line(result, line);
+        if (error != FTN_OK) break;
+    }
+    fclose(fp);
+
+    if (error == FTN_OK && (!result->area || !result->file)) {
+        logf_error("TIC file %s has no Area or File line", path);
+        error = FTN_ERROR_PARSE;
+    }
+    if (error == FTN_OK && (!ftn_tic_safe_name(result->area) || !ftn_tic_safe_name(result->file))) {
+        logf_error("TIC file %s names an unsafe area or file", path);
+        error = FTN_ERROR_PARSE;
+    }
+
+    if (error != FTN_OK) {
+        ftn_tic_free(result);
+        return error;
+    }
+
+    *tic = result;
+    return FTN_OK;
+}
+
+ftn_error_t ftn_tic_write(const ftn_tic_t* tic, const char* path) {
+    FILE* fp;
+    char addr[64];
+    size_t i;
+    int failed;
+
+    if (!tic || !path) return FTN_ERROR_INVALID_PARAMETER;
+
+    fp = fopen(path, "w");
+    if (!fp) {
+        logf_error("Failed to create TIC file %s: %s", path, strerror(errno));
+        return FTN_ERROR_FILE;
+    }
+
+    fprintf(fp, "Area %s\r\n", tic->area ? tic->area : "");
+    ftn_address_to_string(&tic->origin, addr, sizeof(addr));
+    fprintf(fp, "Origin %s\r\n", addr);
+    ftn_address_to_string(&tic->from, addr, sizeof(addr));
+    fprintf(fp, "From %s\r\n", addr);
+    if (tic->has_to) {
+        ftn_address_to_string(&tic->to, addr, sizeof(addr));
+        fprintf(fp, "To %s\r\n", addr);
+    }
+    fprintf(fp, "File %s\r\n", tic->file ? tic->file : "");
+    if (tic->lfn) fprintf(fp, "Lfn %s\r\n", tic->lfn);
+    if (tic->replaces) fprintf(fp, "Replaces %s\r\n", tic->replaces);
+    if (tic->magic) fprintf(fp, "Magic %s\r\n", tic->magic);
+    if (tic->desc) fprintf(fp, "Desc %s\r\n", tic->desc);
+    for (i = 0; i < tic->ldesc_count; i++) {
+        fprintf(fp, "LDesc %s\r\n", tic->ldesc[i]);
+    }
+    if (tic->has_size) fprintf(fp, "Size %lu\r\n", tic->size);
+    if (tic->has_crc) fprintf(fp, "Crc %08lX\r\n", tic->crc);
+    for (i = 0; i < tic->extra_count; i++) {
+        fprintf(fp, "%s\r\n", tic->extra[i]);
+    }
+    for (i = 0; i < tic->path_count; i++) {
+        fprintf(fp, "Path %s\r\n", tic->path[i]);
+    }
+    for (i = 0; i < tic->seenby_count; i++) {
+        ftn_address_to_string(&tic->seenby[i], addr, sizeof(addr));
+        fprintf(fp, "Seenby %s\r\n", addr);
+    }
+    if (tic->password) fprintf(fp, "Pw %s\r\n", tic->password);
+
+    failed = ferror(fp);
+    if (fclose(fp) != 0 || failed) {
+        logf_error("Failed to write TIC file %s", path);
+        return FTN_ERROR_FILE;
+    }
+    return FTN_OK;
+}
+
+ftn_error_t ftn_tic_validate(const ftn_tic_t* tic, const char* file_path) {
+    struct stat st;
+    uint32_t crc;
+
+    if (!tic || !file_path) return FTN_ERROR_INVALID_PARAMETER;
+
+    if (stat(file_path, &st) != 0) {
+        return FTN_ERROR_NOTFOUND;
+    }
+
+    if (tic->has_size && (unsigned long)st.st_size != tic->size) {
+        logf_warning("File %s is %lu bytes, TIC says %lu", file_path,
+                     (unsigned long)st.st_size, tic->size);
+        return FTN_ERROR_CRC;
+    }
+
+    if (tic->has_crc) {
+        if (ftn_crc32_file(file_path, &crc) != BINKP_OK) {
+            return FTN_ERROR_FILE;
+        }
+        if ((unsigned long)crc != (tic->crc & 0xFFFFFFFFUL)) {
+            logf_warning("File %s has CRC %08lX, TIC says %08lX", file_path,
+                         (unsigned long)crc, tic->crc);
+            return FTN_ERROR_CRC;
+        }
+    }
+
+    return FTN_OK;
+}
+
+int ftn_tic_is_tic_name(const char* filename) {
+    size_t len;
+
+    if (!filename) return 0;
+
+    len = strlen(filename);
+    return len > 4 && ftn_tic_keyword(filename + len - 4, ".tic");
+}
+
+/* Locate the TIC's file next to it, tolerating a change of case in transit */
+static int ftn_tic_find_file(const char* dir, const char* name, char* path, size_t size) {
+    DIR* d;
+    struct dirent* entry;
+    struct stat st;
+    int found = 0;
+
+    snprintf(path, size, "%s/%s", dir, name);
+    if (stat(path, &st) == 0) return 1;
+
+    d = opendir(dir);
+    if (!d) return 0;
+
+    while ((entry = readdir(d)) != NULL) {
+        if (ftn_tic_keyword(entry->d_name, name)) {
+            snprintf(path, size, "%s/%s", dir, entry->d_name);
+            found = 1;
+            break;
+        }
+    }
+    closedir(d);
+    return found;
+}
+
+static ftn_error_t ftn_tic_copy_file(const char* src, const char* dst) {
+    FILE* in;
+    FILE* out;
+    char buffer[COPY_BUFFER_SIZE];
+    size_t bytes;
+    ftn_error_t result = FTN_OK;
+
+    in = fopen(src, "rb");
+    if (!in) return FTN_ERROR_FILE;
+
+    out = fopen(dst, "wb");
+    if (!out) {
+        fclose(in);
+        return FTN_ERROR_FILE;
+    }
+
+    while ((bytes = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, 1, bytes, out) != bytes) {
+            result = FTN_ERROR_FILE;
+            break;
+        }
+    }
+    if (ferror(in)) result = FTN_ERROR_FILE;
+
+    fclose(in);
+    if (fclose(out) != 0) result = FTN_ERROR_FILE;
+    if (result != FTN_OK) unlink(dst);
+    return result;
+}
+
+/* Move within a filesystem, copying across filesystems */
+static ftn_error_t ftn_tic_move_file(const char* src, const char* dst) {
+    if (rename(src, dst) == 0) return FTN_OK;
+
+    if (errno != EXDEV || ftn_tic_copy_file(src, dst) != FTN_OK) {
+        logf_error("Failed to move %s to %s: %s", src, dst, strerror(errno));
+        return FTN_ERROR_FILE;
+    }
+    unlink(src);
+    return FTN_OK;
+}
+
+/* Move a refused file into the bad directory, if there is one */
+static void ftn_tic_reject_file(const ftn_tic_context_t* ctx, const char* source) {
+    char dest[1024];
+    const char* name;
+
+    if (!ctx->bad_path) return;
+    if (ftn_storage_create_directory_recursive(ctx->bad_path, 0755) != FTN_OK) return;
+
+    name = strrchr(source, '/');
+    name = name ? name + 1 : source;
+    snprintf(dest, sizeof(dest), "%s/%s", ctx->bad_path, name);
+    if (ftn_tic_move_file(source, dest) == FTN_OK) {
+        logf_info("Moved refused file %s to %s", source, dest);
+    }
+}
+
+/*
+ * Give a link its own directory entry for the stored file. A hard link
+ * costs no data writes; only a filebox on another filesystem gets a copy.
+ */
+static ftn_error_t ftn_tic_link_file(const char* src, const char* dst) {
+    unlink(dst);
+    if (link(src, dst) == 0) return FTN_OK;
+
+    logf_debug("Hard link %s -> %s failed (%s), copying", src, dst, strerror(errno));
+    return ftn_tic_copy_file(src, dst);
+}
+
+/* Sequence for TIC names, shared by all threads */
+static unsigned long tic_sequence = 0;
+static ftn_mutex_t tic_sequence_mutex = FTN_MUTEX_INITIALIZER;
+
+/* Pick an unused 8.3 TIC name in a directory */
+static void ftn_tic_unique_name(const char* dir, char* path, size_t size) {
+    struct stat st;
+    unsigned long stamp;
+    unsigned long sequence;
+
+    stamp = ((unsigned long)time(NULL) << 8) & 0xFFFFFFFFUL;
+    do {
+        ftn_mutex_lock(&tic_sequence_mutex);
+        sequence = tic_sequence++;
+        ftn_mutex_unlock(&tic_sequence_mutex);
+        snprintf(path, size, "%s/%08lx.tic", dir, (stamp + sequence) & 0xFFFFFFFFUL);
+    } while (stat(path, &st) == 0);
+}
+
+static ftn_error_t ftn_tic_add_path(ftn_tic_t* tic, const ftn_address_t* address) {
+    char addr[64];
+    char stamp[64];
+    char line[160];
+    time_t now;
+    struct tm tm_buf;
+    struct tm* tm;
+
+    now = time(NULL);
+    tm = ftn_gmtime_r(&now, &tm_buf);
+    if (!tm || strftime(stamp, sizeof(stamp), "%a %b %d %H:%M:%S %Y UTC", tm) == 0) {
+        stamp[0] = '\0';
+    }
+
+    ftn_address_to_string(address, addr, sizeof(addr));
+    snprintf(line, sizeof(line), "%s %lu %s", addr, (unsigned long)now, stamp);
+    return ftn_tic_append(&tic->path, &tic->path_count, line);
+}
+
+/* Hard-link the stored file into one link's filebox and queue it with a fresh TIC */
+static ftn_error_t ftn_tic_send_to_link(const ftn_tic_context_t* ctx, ftn_tic_t* tic,
+                                        const char* stored, const ftn_areafix_link_t* link) {
+    char box[1024];
+    char file_path[1024];
+    char tic_path[1024];
+    char* saved_password;
+    struct ftn_address bso_addr;
+    ftn_error_t result;
+
+    snprintf(box, sizeof(box), "%s/%u.%u.%u.%u", ctx->filebox_path,
+             link->address.zone, link->address.net, link->address.node, link->address.point);
+    if (ftn_storage_create_directory_recursive(box, 0755) != FTN_OK) {
+        return FTN_ERROR_FILE;
+    }
+
+    snprintf(file_path, sizeof(file_path), "%s/%s", box, tic->file);
+    result = ftn_tic_link_file(stored, file_path);
+    if (result != FTN_OK) return result;
+
+    /* Address the TIC to this link with its own password */
+    tic->to = link->address;
+    tic->has_to = 1;
+    saved_password = tic->password;
+    tic->password = link->password;
+    ftn_tic_unique_name(box, tic_path, sizeof(tic_path));
+    result = ftn_tic_write(tic, tic_path);
+    tic->password = saved_password;
+    if (result != FTN_OK) {
+        unlink(file_path);
+        return result;
+    }
+
+    memset(&bso_addr, 0, sizeof(bso_addr));
+    bso_addr.zone = (int)link->address.zone;
+    bso_addr.net = (int)link->address.net;
+    bso_addr.node = (int)link->address.node;
+    bso_addr.point = (int)link->address.point;
+
+    /* The file goes first so the link never sees a TIC without it; a
+       busy link gets both once its session ends */
+    if (ftn_flow_queue_reference(ctx->outbound_path, &bso_addr, FLOW_FLAVOR_NORMAL,
+                                 file_path, REF_DIRECTIVE_DELETE) != BSO_OK ||
+        ftn_flow_queue_reference(ctx->outbound_path, &bso_addr, FLOW_FLAVOR_NORMAL,
+                                 tic_path, REF_DIRECTIVE_DELETE) != BSO_OK) {
+        return FTN_ERROR_FILE;
+    }
+
+    return FTN_OK;
+}
+
+/*
+ * Some links could not be queued: put a copy of the stored file back
+ * beside its TIC and add the links that did get it to the TIC's Seenby,
+ * so the next pass sends only to the rest.
+ */
+static void ftn_tic_keep_for_retry(const char* tic_path, const char* source, const char* stored,
+                                   const ftn_areafix_t* subs, const ftn_areafix_word_t* done) {
+    ftn_tic_t* original = NULL;
+    char temp[1024];
+    size_t j;
+
+    if (ftn_tic_copy_file(stored, source) != FTN_OK) {
+        logf_error("Failed to keep %s for retry", source);
+        return;
+    }
+    if (ftn_tic_parse(tic_path, &original) != FTN_OK) return;
+
+    for (j = 0; j < subs->link_count; j++) {
+        if (FTN_AREAFIX_BIT_TEST(done, j) &&
+            ftn_tic_add_seenby(original, &subs->links[j].address) != FTN_OK) {
+            ftn_tic_free(original);
+            return;
+        }
+    }
+
+    snprintf(temp, sizeof(temp), "%s.tmp", tic_path);
+    if (ftn_tic_write(original, temp) != FTN_OK || rename(temp, tic_path) != 0) {
+        logf_error("Failed to update %s for retry", tic_path);
+        unlink(temp);
+    }
+    ftn_tic_free(original);
+}
+
+ftn_error_t ftn_tic_process(const ftn_tic_context_t* ctx, const char* tic_path, size_t* links_sent) {
+    ftn_tic_t* tic = NULL;
+    ftn_areafix_word_t* seen = NULL;
+    ftn_areafix_word_t* out = NULL;
+    ftn_areafix_t* subs;
+    const ftn_areafix_link_t* from_link;
+    char dir[1024];
+    char source[1024];
+    char area_dir[1024];
+    char stored[1024];
+    char* slash;
+    char* p;
+    int area_id;
+    int from_id;
+    size_t sent = 0;
+    size_t j;
+    ftn_error_t result;
+
+    if (!ctx || !tic_path || !ctx->fileecho_path) return FTN_ERROR_INVALID_PARAMETER;
+    if (links_sent) *links_sent = 0;
+    subs = ctx->subscriptions;
+
+    result = ftn_tic_parse(tic_path, &tic);
+    if (result != FTN_OK) return result;
+
+    /* The file travels in the same directory as its TIC */
+    snprintf(dir, sizeof(dir), "%s", tic_path);
+    slash = strrchr(dir, '/');
+    if (slash) {
+        *slash = '\0';
+    } else {
+        strcpy(dir, ".");
+    }
+
+    if (!ftn_tic_find_file(dir, tic->file, source, sizeof(source))) {
+        logf_debug("TIC %s: file %s has not arrived yet", tic_path, tic->file);
+        result = FTN_ERROR_NOTFOUND;
+        goto cleanup;
+    }
+
+    /* Only accept files from a configured link with the right password,
+       or from a link explicitly marked as having none */
+    from_id = subs ? ftn_areafix_find_link(subs, &tic->from) : -1;
+    if (from_id < 0) {
+        logf_error("TIC %s: %u:%u/%u.%u is not a configured link", tic_path,
+                   tic->from.zone, tic->from.net, tic->from.node, tic->from.point);
+        result = FTN_ERROR_INVALID;
+        goto reject;
+    }
+    from_link = &subs->links[from_id];
+    if (!from_link->password || !*from_link->password) {
+        if (!from_link->insecure) {
+            logf_error("TIC %s: link has no password and is not marked insecure", tic_path);
+            result = FTN_ERROR_INVALID;
+            goto reject;
+        }
+    } else if (!tic->password || !ftn_tic_keyword(tic->password, from_link->password)) {
+        logf_error("TIC %s: bad password from link", tic_path);
+        result = FTN_ERROR_INVALID;
+        goto reject;
+    }
+
+    result = ftn_tic_validate(tic, source);
+    if (result == FTN_ERROR_CRC) goto reject;
+    if (result != FTN_OK) goto cleanup;
+
+    area_id = ftn_areafix_find_area(subs, tic->area);
+
+    /* Store the file in its area, lower-cased like news group directories */
+    snprintf(area_dir, sizeof(area_dir), "%s/%s", ctx->fileecho_path, tic->area);
+    for (p = area_dir + strlen(ctx->fileecho_path) + 1; *p; p++) {
+        *p = (char)tolower((unsigned char)*p);
+    }
+    if (ftn_storage_create_directory_recursive(area_dir, 0755) != FTN_OK) {
+        result = FTN_ERROR_FILE;
+        goto cleanup;
+    }
+
+    if (tic->replaces && ftn_tic_safe_name(tic->replaces) &&
+        !ftn_tic_keyword(tic->replaces, tic->file)) {
+        snprintf(stored, sizeof(stored), "%s/%s", area_dir, tic->replaces);
+        if (unlink(stored) == 0) {
+            logf_info("Removed %s, replaced by %s", stored, tic->file);
+        }
+    }
+
+    snprintf(stored, sizeof(stored), "%s/%s", area_dir, tic->file);
+    result = ftn_tic_move_file(source, stored);
+    if (result != FTN_OK) goto cleanup;
+
+    logf_info("Received %s in file area %s", tic->file, tic->area);
+
+    if (area_id < 0 || !ctx->filebox_path || !ctx->outbound_path) {
+        if (area_id < 0) {
+            logf_info("File area %s has no subscribers", tic->area);
+        }
+        goto cleanup;
+    }
+
+    /* Links to send to: subscribed, not already in Seenby, not the sender */
+    seen = ftn_areafix_bitset_new(subs);
+    out = ftn_areafix_bitset_new(subs);
+    if (!seen || !out) {
+        result = FTN_ERROR_NOMEM;
+        goto cleanup;
+    }
+    for (j = 0; j < subs->link_count; j++) {
+        if (ftn_tic_is_seenby(tic, &subs->links[j].address) ||
+            ftn_address_compare(&tic->from, &subs->links[j].address) == 0) {
+            FTN_AREAFIX_BIT_SET(seen, j);
+        }
+    }
+    if (ftn_areafix_fanout(subs, (size_t)area_id, seen, out) == 0) {
+        goto cleanup;
+    }
+
+    /* Every outgoing TIC carries the full distribution in its Seenby */
+    if (ftn_tic_add_seenby(tic, &ctx->address) != FTN_OK ||
+        ftn_tic_add_path(tic, &ctx->address) != FTN_OK) {
+        result = FTN_ERROR_NOMEM;
+        goto cleanup;
+    }
+    for (j = 0; j < subs->link_count; j++) {
+        if (FTN_AREAFIX_BIT_TEST(out, j) &&
+            ftn_tic_add_seenby(tic, &subs->links[j].address) != FTN_OK) {
+            result = FTN_ERROR_NOMEM;
+            goto cleanup;
+        }
+    }
+    tic->from = ctx->address;
+
+    for (j = 0; j < subs->link_count; j++) {
+        if (!FTN_AREAFIX_BIT_TEST(out, j)) continue;
+
+        if (ftn_tic_send_to_link(ctx, tic, stored, &subs->links[j]) == FTN_OK) {
+            sent++;
+        } else {
+            logf_error("Failed to queue %s for %u:%u/%u.%u", tic->file,
+                       subs->links[j].address.zone, subs->links[j].address.net,
+                       subs->links[j].address.node, subs->links[j].address.point);
+            FTN_AREAFIX_BIT_CLEAR(out, j);
+            result = FTN_ERROR_FILE;
+        }
+    }
+    logf_info("Sent %s to %lu links", tic->file, (unsigned long)sent);
+    if (result != FTN_OK) {
+        ftn_tic_keep_for_retry(tic_path, source, stored, subs, out);
+    }
+    goto cleanup;
+
+reject:
+    ftn_tic_reject_file(ctx, source);
+
+cleanup:
+    if (links_sent) *links_sent = sent;
+    free(seen);
+    free(out);
+    ftn_tic_free(tic);
+    return result;
+}
@@ -0,0 +1,449 @@
+/*
+ * tls.c - binkps (binkp over TLS) transport for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "ftn.h"
+#include "ftn/tls.h"
+#include "ftn/log.h"
+
+#ifdef FTN_WITH_TLS
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#define TLS_SENDFILE_CHUNK 16384
+#define TLS_FINGERPRINT_SIZE 32 /* SHA-256 */
+
+struct ftn_tls_context {
+    SSL_CTX* ctx;
+    int is_server;
+    unsigned char pin[TLS_FINGERPRINT_SIZE];
+    int has_pin;
+};
+
+static void tls_log_errors(const char* what) {
+    unsigned long error;
+    char message[256];
+
+    error = ERR_get_error();
+    if (error == 0) {
+        logf_error("%s failed", what);
+        return;
+    }
+
+    while (error != 0) {
+        ERR_error_string_n(error, message, sizeof(message));
+        logf_error("%s failed: %s", what, message);
+        error = ERR_get_error();
+    }
+}
+
+/* Map an OpenSSL I/O result onto the network error codes */
+static ftn_error_t tls_io_error(ftn_net_connection_t* conn, int ret) {
+    switch (SSL_get_error((SSL*)conn->tls, ret)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            return FTN_ERROR_WOULD_BLOCK;
+        case SSL_ERROR_ZERO_RETURN:
+            conn->connected = 0;
+            return FTN_ERROR_CONNECTION_CLOSED;
+        default:
+            ERR_clear_error();
+            return FTN_ERROR_NETWORK;
+    }
+}
+
+int ftn_tls_available(void) {
+    return 1;
+}
+
+ftn_tls_context_t* ftn_tls_context_new(int is_server, const char* cert_file, const char* key_file, const char* ca_file) {
+    ftn_tls_context_t* ctx;
+
+    if (is_server && (!cert_file || !key_file)) {
+        logf_error("TLS server needs a certificate and a key");
+        return NULL;
+    }
+
+    ctx = malloc(sizeof(ftn_tls_context_t));
+    if (!ctx) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(ftn_tls_context_t));
+    ctx->is_server = is_server;
+
+    ctx->ctx = SSL_CTX_new(is_server ? TLS_server_method() : TLS_client_method());
+    if (!ctx->ctx) {
+        tls_log_errors("SSL_CTX_new");
+        free(ctx);
+        return NULL;
+    }
+
+    SSL_CTX_set_min_proto_version(ctx->ctx, TLS1_2_VERSION);
+#ifdef SSL_OP_ENABLE_KTLS
+    /* Hand record encryption to the kernel when it can take the keys */
+    SSL_CTX_set_options(ctx->ctx, SSL_OP_ENABLE_KTLS);
+#endif
+
+    if (cert_file && SSL_CTX_use_certificate_chain_file(ctx->ctx, cert_file) != 1) {
+        tls_log_errors("Loading TLS certificate");
+        ftn_tls_context_free(ctx);
+        return NULL;
+    }
+
+    if (key_file && (SSL_CTX_use_PrivateKey_file(ctx->ctx, key_file, SSL_FILETYPE_PEM) != 1 ||
+                     SSL_CTX_check_private_key(ctx->ctx) != 1)) {
+        tls_log_errors("Loading TLS key");
+        ftn_tls_context_free(ctx);
+        return NULL;
+    }
+
+    if (ca_file) {
+        if (SSL_CTX_load_verify_locations(ctx->ctx, ca_file, NULL) != 1) {
+            tls_log_errors("Loading TLS CA file");
+            ftn_tls_context_free(ctx);
+            return NULL;
+        }
+        SSL_CTX_set_verify(ctx->ctx, SSL_VERIFY_PEER, NULL);
+    } else if (!is_server) {
+        if (SSL_CTX_set_default_verify_paths(ctx->ctx) != 1) {
+            tls_log_errors("Loading system CA store");
+            ftn_tls_context_free(ctx);
+            return NULL;
+        }
+        SSL_CTX_set_verify(ctx->ctx, SSL_VERIFY_PEER, NULL);
+    } else {
+        SSL_CTX_set_verify(ctx->ctx, SSL_VERIFY_NONE, NULL);
+    }
+
+    return ctx;
+}
+
+ftn_error_t ftn_tls_context_set_fingerprint(ftn_tls_context_t* ctx, const char* fingerprint) {
+    unsigned char pin[TLS_FINGERPRINT_SIZE];
+    size_t count = 0;
+    int high = -1;
+    int digit;
+    const char* p;
+
+    if (!ctx || ctx->is_server || !fingerprint) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    for (p = fingerprint; *p; p++) {
+        if (*p == ':') {
+            continue;
+        }
+        if (*p >= '0' && *p <= '9') {
+            digit = *p - '0';
+        } else if (*p >= 'a' && *p <= 'f') {
+            digit = *p - 'a' + 10;
+        } else if (*p >= 'A' && *p <= 'F') {
+            digit = *p - 'A' + 10;
+        } else {
+            return FTN_ERROR_INVALID_PARAMETER;
+        }
+
+        if (high < 0) {
+            high = digit;
+        } else {
+            if (count == sizeof(pin)) {
+                return FTN_ERROR_INVALID_PARAMETER;
+            }
+            pin[count++] = (unsigned char)((high << 4) | digit);
+            high = -1;
+        }
+    }
+
+    if (count != sizeof(pin) || high >= 0) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    memcpy(ctx->pin, pin, sizeof(pin));
+    ctx->has_pin = 1;
+    return FTN_OK;
+}
+
+/* Compare the server certificate with the pinned fingerprint */
+static int tls_matches_pin(const ftn_tls_context_t* ctx, SSL* ssl) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    X509* cert;
+    int match;
+
+    cert = SSL_get1_peer_certificate(ssl);
+    if (!cert) {
+        return 0;
+    }
+
+    match = X509_digest(cert, EVP_sha256(), digest, &length) == 1 &&
+            length == TLS_FINGERPRINT_SIZE && memcmp(digest, ctx->pin, length) == 0;
+    X509_free(cert);
+    return match;
+}
+
+void ftn_tls_context_free(ftn_tls_context_t* ctx) {
+    if (!ctx) {
+        return;
+    }
+
+    /* Sessions keep their own reference to the SSL_CTX */
+    if (ctx->ctx) {
+        SSL_CTX_free(ctx->ctx);
+    }
+    free(ctx);
+}
+
+ftn_error_t ftn_tls_start(ftn_tls_context_t* ctx, ftn_net_connection_t* conn, const char* server_name) {
+    SSL* ssl;
+    int ret;
+
+    if (!ctx || !conn || conn->socket == FTN_INVALID_SOCKET || conn->tls) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    ssl = SSL_new(ctx->ctx);
+    if (!ssl) {
+        tls_log_errors("SSL_new");
+        return FTN_ERROR_NOMEM;
+    }
+
+    if (SSL_set_fd(ssl, conn->socket) != 1) {
+        tls_log_errors("SSL_set_fd");
+        SSL_free(ssl);
+        return FTN_ERROR_NETWORK;
+    }
+
+    if (!ctx->is_server) {
+        if (server_name) {
+            SSL_set_tlsext_host_name(ssl, server_name);
+        }
+
+        if (ctx->has_pin) {
+            /* The fingerprint is checked once the handshake is done */
+            SSL_set_verify(ssl, SSL_VERIFY_NONE, NULL);
+        } else if (!server_name || SSL_set1_host(ssl, server_name) != 1) {
+            logf_error("TLS connect needs a server name to verify");
+            SSL_free(ssl);
+            return FTN_ERROR_INVALID_PARAMETER;
+        }
+    }
+
+    ret = ctx->is_server ? SSL_accept(ssl) : SSL_connect(ssl);
+    if (ret != 1) {
+        tls_log_errors(ctx->is_server ? "TLS accept" : "TLS connect");
+        SSL_free(ssl);
+        return FTN_ERROR_NETWORK;
+    }
+
+    if (!ctx->is_server && ctx->has_pin && !tls_matches_pin(ctx, ssl)) {
+        logf_error("TLS certificate of %s does not match the pinned fingerprint",
+                   server_name ? server_name : "peer");
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+        return FTN_ERROR_NETWORK;
+    }
+
+    conn->tls = ssl;
+    conn->ktls_send = BIO_get_ktls_send(SSL_get_wbio(ssl)) ? 1 : 0;
+    conn->ktls_recv = BIO_get_ktls_recv(SSL_get_rbio(ssl)) ? 1 : 0;
+
+    logf_info("TLS session with %s: %s, %s (kernel TLS send %s, receive %s)",
+              conn->hostname ? conn->hostname : "peer", SSL_get_version(ssl),
+              SSL_get_cipher_name(ssl), conn->ktls_send ? "on" : "off",
+              conn->ktls_recv ? "on" : "off");
+    return FTN_OK;
+}
+
+void ftn_tls_close(ftn_net_connection_t* conn) {
+    if (!conn || !conn->tls) {
+        return;
+    }
+
+    /* Send close_notify; the peer's reply is not waited for */
+    SSL_shutdown((SSL*)conn->tls);
+    SSL_free((SSL*)conn->tls);
+    conn->tls = NULL;
+    conn->ktls_send = 0;
+    conn->ktls_recv = 0;
+}
+
+int ftn_tls_is_ktls(const ftn_net_connection_t* conn) {
+    return conn && conn->tls && conn->ktls_send;
+}
+
+ftn_error_t ftn_tls_send(ftn_net_connection_t* conn, const void* data, size_t len, size_t* bytes_sent) {
+    int ret;
+
+    if (!conn || !conn->tls || !data || !bytes_sent) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    *bytes_sent = 0;
+    ret = SSL_write_ex((SSL*)conn->tls, data, len, bytes_sent);
+    if (ret != 1) {
+        return tls_io_error(conn, ret);
+    }
+    return FTN_OK;
+}
+
+ftn_error_t ftn_tls_recv(ftn_net_connection_t* conn, void* buffer, size_t len, size_t* bytes_received) {
+    int ret;
+
+    if (!conn || !conn->tls || !buffer || !bytes_received) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    *bytes_received = 0;
+    ret = SSL_read_ex((SSL*)conn->tls, buffer, len, bytes_received);
+    if (ret != 1) {
+        return tls_io_error(conn, ret);
+    }
+    return FTN_OK;
+}
+
+ftn_error_t ftn_tls_sendfile(ftn_net_connection_t* conn, int fd, long offset, size_t len, size_t* bytes_sent) {
+    char buffer[TLS_SENDFILE_CHUNK];
+    ossl_ssize_t sent;
+    ssize_t got;
+    size_t written;
+    size_t chunk;
+    int ret;
+
+    if (!conn || !conn->tls || fd < 0 || !bytes_sent) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    *bytes_sent = 0;
+
+    /* Zero copy: the kernel encrypts straight from the page cache */
+    if (conn->ktls_send) {
+        sent = SSL_sendfile((SSL*)conn->tls, fd, (off_t)offset, len, 0);
+        if (sent < 0) {
+            return tls_io_error(conn, (int)sent);
+        }
+        *bytes_sent = (size_t)sent;
+        return FTN_OK;
+    }
+
+    /* User-space fallback */
+    while (*bytes_sent < len) {
+        chunk = len - *bytes_sent;
+        if (chunk > sizeof(buffer)) {
+            chunk = sizeof(buffer);
+        }
+
+        got = pread(fd, buffer, chunk, (off_t)(offset + (long)*bytes_sent));
+        if (got < 0) {
+            return FTN_ERROR_FILE_IO;
+        }
+        if (got == 0) {
+            break;
+        }
+
+        ret = SSL_write_ex((SSL*)conn->tls, buffer, (size_t)got, &written);
+        if (ret != 1) {
+            return *bytes_sent > 0 ? FTN_OK : tls_io_error(conn, ret);
+        }
+        *bytes_sent += written;
+    }
+
+    return FTN_OK;
+}
+
+#else /* !FTN_WITH_TLS */
+
+int ftn_tls_available(void) {
+    return 0;
+}
+
+ftn_tls_context_t* ftn_tls_context_new(int is_server, const char* cert_file, const char* key_file, const char* ca_file) {
+    (void)is_server;
+    (void)cert_file;
+    (void)key_file;
+    (void)ca_file;
+    logf_error("TLS support was not compiled in (build with WITH_TLS=1)");
+    return NULL;
+}
+
+void ftn_tls_context_free(ftn_tls_context_t* ctx) {
+    (void)ctx;
+}
+
+ftn_error_t ftn_tls_context_set_fingerprint(ftn_tls_context_t* ctx, const char* fingerprint) {
+    (void)ctx;
+    (void)fingerprint;
+    return FTN_ERROR_NETWORK;
+}
+
+ftn_error_t ftn_tls_start(ftn_tls_context_t* ctx, ftn_net_connection_t* conn, const char* server_name) {
+    (void)ctx;
+    (void)conn;
+    (void)server_name;
+    return FTN_ERROR_NETWORK;
+}
+
+void ftn_tls_close(ftn_net_connection_t* conn) {
+    (void)conn;
+}
+
+int ftn_tls_is_ktls(const ftn_net_connection_t* conn) {
+    (void)conn;
+    return 0;
+}
+
+ftn_error_t ftn_tls_send(ftn_net_connection_t* conn, const void* data, size_t len, size_t* bytes_sent) {
+    (void)conn;
+    (void)data;
+    (void)len;
+    (void)bytes_sent;
+    return FTN_ERROR_NETWORK;
+}
+
+ftn_error_t ftn_tls_recv(ftn_net_connection_t* conn, void* buffer, size_t len, size_t* bytes_received) {
+    (void)conn;
+    (void)buffer;
+    (void)len;
+    (void)bytes_received;
+    return FTN_ERROR_NETWORK;
+}
+
+ftn_error_t ftn_tls_sendfile(ftn_net_connection_t* conn, int fd, long offset, size_t len, size_t* bytes_sent) {
+    (void)conn;
+    (void)fd;
+    (void)offset;
+    (void)len;
+    (void)bytes_sent;
+    return FTN_ERROR_NETWORK;
+}
+
+#endif /* FTN_WITH_TLS */
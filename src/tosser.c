@@ -0,0 +1,823 @@
+/*
+ * tosser.c - Inbound packet tosser for libFTN
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/tosser.h"
+#include "ftn/packet.h"
+#include "ftn/inbound.h"
+#include "ftn/tic.h"
+#include "ftn/outbound.h"
+#include "ftn/log.h"
+
+static ftn_error_t ensure_directories_exist(const ftn_network_config_t* network);
+static ftn_error_t move_packet_to_processed(const char* packet_path, const char* processed_dir);
+static ftn_error_t move_packet_to_bad(const char* packet_path, const char* bad_dir);
+static ftn_error_t process_single_packet(const char* packet_path, const ftn_network_config_t* network,
+                                        ftn_router_t* router, ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
+                                        ftn_areafix_t* areafix, ftn_outbound_t* outbound, ftn_toss_stats_t* stats);
+static ftn_error_t process_message(const ftn_message_t* msg, const ftn_network_config_t* network,
+                                  ftn_router_t* router, ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
+                                  ftn_areafix_t* areafix, ftn_outbound_t* outbound, ftn_toss_stats_t* stats);
+static ftn_error_t process_areafix_request(const ftn_message_t* msg, const ftn_network_config_t* network,
+                                          ftn_areafix_t* areafix, ftn_toss_stats_t* stats);
+static void report_echomail_fanout(const ftn_message_t* msg, const ftn_areafix_t* areafix);
+static int schedule_network_inbox(const ftn_network_config_t* network, size_t index,
+                                  ftn_inbound_queue_t* queue);
+static int toss_inbound_queue(const ftn_config_t* config, ftn_inbound_queue_t* queue, int time_budget,
+                              ftn_router_t* router, ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
+                              ftn_areafix_t** areafix, ftn_outbound_t** outbound, ftn_toss_stats_t* stats);
+static int process_network_tics(const ftn_network_config_t* network, ftn_toss_stats_t* stats);
+
+ftn_tosser_t* ftn_tosser_new(const ftn_config_t* config) {
+    ftn_tosser_t* tosser;
+    const ftn_network_config_t* network;
+    size_t i;
+
+    if (!config) return NULL;
+
+    tosser = malloc(sizeof(ftn_tosser_t));
+    if (!tosser) return NULL;
+    memset(tosser, 0, sizeof(ftn_tosser_t));
+    tosser->config = config;
+
+    tosser->storage = ftn_storage_new(config);
+    if (!tosser->storage || ftn_storage_initialize(tosser->storage) != FTN_OK) {
+        log_error("Failed to initialize storage");
+        goto fail;
+    }
+
+    /* Initialize duplicate checker - use first network's duplicate_db path */
+    if (config->network_count > 0 && config->networks[0].duplicate_db) {
+        tosser->dupecheck = ftn_dupecheck_new(config->networks[0].duplicate_db);
+    } else {
+        /* Use default path */
+        tosser->dupecheck = ftn_dupecheck_new("dupecheck.db");
+    }
+
+    if (!tosser->dupecheck) {
+        log_error("Failed to initialize duplicate checker");
+        goto fail;
+    }
+
+    /* Hashed mode must be chosen before loading, so a string database is converted */
+    if (config->network_count > 0 && config->networks[0].duplicate_hash) {
+        ftn_dupecheck_set_hashed(tosser->dupecheck, 1);
+    }
+
+    if (ftn_dupecheck_load(tosser->dupecheck) != FTN_OK) {
+        log_error("Failed to load duplicate database");
+        goto fail;
+    }
+
+    /* The tosser checks and records duplicates itself before routing; a router
+       sharing the database would find every message it had just recorded */
+    tosser->router = ftn_router_new(config, NULL);
+    if (!tosser->router) {
+        log_error("Failed to initialize router");
+        goto fail;
+    }
+
+    /* Load each network's subscription table, if configured */
+    if (config->network_count > 0) {
+        tosser->areafix = calloc(config->network_count, sizeof(ftn_areafix_t*));
+        if (!tosser->areafix) {
+            log_error("Failed to allocate Areafix tables");
+            goto fail;
+        }
+    }
+    for (i = 0; i < config->network_count; i++) {
+        network = &config->networks[i];
+        if (!network->areafix_db) continue;
+
+        tosser->areafix[i] = ftn_areafix_new(network->areafix_db);
+        if (!tosser->areafix[i] || ftn_areafix_load(tosser->areafix[i]) != FTN_OK) {
+            logf_error("Failed to load Areafix database: %s", network->areafix_db);
+            ftn_areafix_free(tosser->areafix[i]);
+            tosser->areafix[i] = NULL;
+        }
+    }
+
+    /* Forwarded netmail goes to each network's BSO outbound */
+    if (config->network_count > 0) {
+        tosser->outbound = calloc(config->network_count, sizeof(ftn_outbound_t*));
+        if (!tosser->outbound) {
+            log_error("Failed to allocate outbounds");
+            goto fail;
+        }
+    }
+    for (i = 0; i < config->network_count; i++) {
+        network = &config->networks[i];
+        if (!network->outbound_path) continue;
+
+        tosser->outbound[i] = ftn_outbound_new(network->outbound_path, &network->address,
+                                               network->hub_str ? &network->hub : NULL, network->password);
+        if (!tosser->outbound[i]) {
+            logf_error("Failed to set up outbound: %s", network->outbound_path);
+        }
+    }
+
+    return tosser;
+
+fail:
+    ftn_tosser_free(tosser);
+    return NULL;
+}
+
+void ftn_tosser_free(ftn_tosser_t* tosser) {
+    size_t i;
+
+    if (!tosser) return;
+
+    if (tosser->areafix) {
+        for (i = 0; i < tosser->config->network_count; i++) {
+            ftn_areafix_free(tosser->areafix[i]);
+        }
+        free(tosser->areafix);
+    }
+    if (tosser->outbound) {
+        for (i = 0; i < tosser->config->network_count; i++) {
+            ftn_outbound_free(tosser->outbound[i]);
+        }
+        free(tosser->outbound);
+    }
+    if (tosser->router) ftn_router_free(tosser->router);
+    if (tosser->dupecheck) ftn_dupecheck_free(tosser->dupecheck);
+    if (tosser->storage) ftn_storage_free(tosser->storage);
+    free(tosser);
+}
+
+ftn_error_t ftn_tosser_flush(ftn_tosser_t* tosser) {
+    if (!tosser) return FTN_ERROR_INVALID_PARAMETER;
+
+    if (ftn_dupecheck_save(tosser->dupecheck) != FTN_OK) {
+        logf_warning("Failed to save duplicate database: %s", tosser->dupecheck->db_path);
+        return FTN_ERROR_FILE;
+    }
+    return FTN_OK;
+}
+
+ftn_error_t ftn_tosser_process_inbox(ftn_tosser_t* tosser, int time_budget, ftn_toss_stats_t* stats) {
+    const ftn_config_t* config;
+    ftn_inbound_queue_t* queue = NULL;
+    const ftn_network_config_t* network;
+    ftn_error_t result = FTN_OK;
+    size_t deferred;
+    size_t i;
+
+    if (!tosser || !stats) {
+        log_error("Invalid parameters to ftn_tosser_process_inbox");
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+    config = tosser->config;
+
+    logf_info("Processing inbox for %lu configured networks", (unsigned long)config->network_count);
+
+    queue = ftn_inbound_queue_new();
+    if (!queue) {
+        log_error("Failed to allocate inbound queue");
+        return FTN_ERROR_NOMEM;
+    }
+
+    /* Enumerate every network inbox once */
+    for (i = 0; i < config->network_count; i++) {
+        network = &config->networks[i];
+        logf_debug("Scanning network: %s", network->name);
+
+        /* Packets and files held back while a link was busy go out first */
+        deferred = 0;
+        if (network->outbound_path &&
+            ftn_flow_attach_deferred(network->outbound_path, &deferred) != BSO_OK) {
+            logf_error("Failed to attach deferred references in %s", network->outbound_path);
+        } else if (deferred) {
+            logf_info("%lu references still waiting for busy links", (unsigned long)deferred);
+        }
+
+        if (schedule_network_inbox(network, i, queue) != 0) {
+            logf_error("Error processing network: %s", network->name);
+            result = FTN_ERROR_FILE;
+            /* Continue processing other networks */
+        }
+    }
+
+    /* Toss netmail first, then smaller and older packets */
+    ftn_inbound_queue_sort(queue);
+    if (toss_inbound_queue(config, queue, time_budget, tosser->router, tosser->storage,
+                           tosser->dupecheck, tosser->areafix, tosser->outbound, stats) != 0) {
+        result = FTN_ERROR_FILE;
+    }
+
+    /* File echoes arrive alongside packets */
+    for (i = 0; i < config->network_count; i++) {
+        network = &config->networks[i];
+        if (!network->fileecho_path || !network->inbox) continue;
+
+        if (process_network_tics(network, stats) != 0) {
+            logf_error("Error processing TIC files for network: %s", network->name);
+            result = FTN_ERROR_FILE;
+        }
+    }
+
+    ftn_inbound_queue_free(queue);
+
+    stats->processing_end_time = time(NULL);
+    ftn_toss_stats_print(stats);
+
+    return result;
+}
+
+ftn_error_t ftn_tosser_toss_packet(ftn_tosser_t* tosser, const char* packet_path, size_t network_index,
+                                   ftn_toss_stats_t* stats) {
+    if (!tosser || !packet_path || !stats || network_index >= tosser->config->network_count) {
+        return FTN_ERROR_INVALID_PARAMETER;
+    }
+
+    return process_single_packet(packet_path, &tosser->config->networks[network_index],
+                                 tosser->router, tosser->storage, tosser->dupecheck,
+                                 tosser->areafix ? tosser->areafix[network_index] : NULL,
+                                 tosser->outbound ? tosser->outbound[network_index] : NULL, stats);
+}
+
+/* Initialize processing statistics */
+void ftn_toss_stats_init(ftn_toss_stats_t* stats) {
+    if (!stats) return;
+
+    memset(stats, 0, sizeof(ftn_toss_stats_t));
+    stats->processing_start_time = time(NULL);
+}
+
+/* Print processing statistics */
+void ftn_toss_stats_print(const ftn_toss_stats_t* stats) {
+    double elapsed_time;
+
+    if (!stats) return;
+
+    elapsed_time = difftime(stats->processing_end_time, stats->processing_start_time);
+
+    log_info("Processing Statistics:");
+    logf_info("  Packets processed: %lu", (unsigned long)stats->packets_processed);
+    logf_info("  Messages processed: %lu", (unsigned long)stats->messages_processed);
+    logf_info("  Duplicates found: %lu", (unsigned long)stats->duplicates_found);
+    logf_info("  Messages stored: %lu", (unsigned long)stats->messages_stored);
+    logf_info("  Messages forwarded: %lu", (unsigned long)stats->messages_forwarded);
+    logf_info("  Errors encountered: %lu", (unsigned long)stats->errors_encountered);
+    if (stats->packets_deferred > 0) {
+        logf_info("  Packets deferred: %lu", (unsigned long)stats->packets_deferred);
+    }
+    if (stats->files_processed > 0) {
+        logf_info("  Files processed: %lu", (unsigned long)stats->files_processed);
+    }
+    logf_info("  Processing time: %.2f seconds", elapsed_time);
+}
+
+/* Ensure required directories exist */
+static ftn_error_t ensure_directories_exist(const ftn_network_config_t* network) {
+    struct stat st;
+
+    if (!network) {
+        return FTN_ERROR_INVALID;
+    }
+
+    /* Create inbox directory */
+    if (network->inbox) {
+        if (stat(network->inbox, &st) != 0) {
+            if (mkdir(network->inbox, 0755) != 0) {
+                logf_error("Failed to create inbox directory: %s", network->inbox);
+                return FTN_ERROR_FILE;
+            }
+            logf_debug("Created inbox directory: %s", network->inbox);
+        }
+    }
+
+    /* Create outbox directory */
+    if (network->outbox) {
+        if (stat(network->outbox, &st) != 0) {
+            if (mkdir(network->outbox, 0755) != 0) {
+                logf_error("Failed to create outbox directory: %s", network->outbox);
+                return FTN_ERROR_FILE;
+            }
+            logf_debug("Created outbox directory: %s", network->outbox);
+        }
+    }
+
+    /* Create processed directory */
+    if (network->processed) {
+        if (stat(network->processed, &st) != 0) {
+            if (mkdir(network->processed, 0755) != 0) {
+                logf_error("Failed to create processed directory: %s", network->processed);
+                return FTN_ERROR_FILE;
+            }
+            logf_debug("Created processed directory: %s", network->processed);
+        }
+    }
+
+    /* Create bad directory */
+    if (network->bad) {
+        if (stat(network->bad, &st) != 0) {
+            if (mkdir(network->bad, 0755) != 0) {
+                logf_error("Failed to create bad directory: %s", network->bad);
+                return FTN_ERROR_FILE;
+            }
+            logf_debug("Created bad directory: %s", network->bad);
+        }
+    }
+
+    return FTN_OK;
+}
+
+/* Move packet to processed directory */
+static ftn_error_t move_packet_to_processed(const char* packet_path, const char* processed_dir) {
+    char dest_path[512];
+    const char* filename;
+
+    if (!packet_path || !processed_dir) {
+        return FTN_ERROR_INVALID;
+    }
+
+    filename = strrchr(packet_path, '/');
+    if (filename) {
+        filename++; /* Skip the '/' */
+    } else {
+        filename = packet_path;
+    }
+
+    snprintf(dest_path, sizeof(dest_path), "%s/%s", processed_dir, filename);
+
+    if (rename(packet_path, dest_path) != 0) {
+        logf_error("Failed to move packet %s to processed directory: %s", packet_path, strerror(errno));
+        return FTN_ERROR_FILE;
+    }
+
+    logf_debug("Moved packet to processed: %s -> %s", packet_path, dest_path);
+    return FTN_OK;
+}
+
+/* Move packet to bad directory */
+static ftn_error_t move_packet_to_bad(const char* packet_path, const char* bad_dir) {
+    char dest_path[512];
+    const char* filename;
+
+    if (!packet_path || !bad_dir) {
+        return FTN_ERROR_INVALID;
+    }
+
+    filename = strrchr(packet_path, '/');
+    if (filename) {
+        filename++; /* Skip the '/' */
+    } else {
+        filename = packet_path;
+    }
+
+    snprintf(dest_path, sizeof(dest_path), "%s/%s", bad_dir, filename);
+
+    if (rename(packet_path, dest_path) != 0) {
+        logf_error("Failed to move packet %s to bad directory: %s", packet_path, strerror(errno));
+        return FTN_ERROR_FILE;
+    }
+
+    logf_debug("Moved packet to bad: %s -> %s", packet_path, dest_path);
+    return FTN_OK;
+}
+
+/* Process a single message */
+static ftn_error_t process_message(const ftn_message_t* msg, const ftn_network_config_t* network,
+                                  ftn_router_t* router, ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
+                                  ftn_areafix_t* areafix, ftn_outbound_t* outbound, ftn_toss_stats_t* stats) {
+    ftn_routing_decision_t decision;
+    ftn_error_t error;
+    int is_duplicate;
+
+    if (!msg || !network || !router || !storage || !dupecheck || !stats) {
+        return FTN_ERROR_INVALID;
+    }
+
+    stats->messages_processed++;
+
+    /* Check for duplicates */
+    error = ftn_dupecheck_is_duplicate(dupecheck, msg, &is_duplicate);
+    if (error != FTN_OK) {
+        log_error("Duplicate check failed for message");
+        stats->errors_encountered++;
+        return FTN_ERROR_INVALID;
+    }
+
+    if (is_duplicate) {
+        logf_debug("Skipping duplicate message: %s", msg->msgid ? msg->msgid : "no-msgid");
+        stats->duplicates_found++;
+        return FTN_OK;
+    }
+
+    /* Add to duplicate database */
+    error = ftn_dupecheck_add_message(dupecheck, msg);
+    if (error != FTN_OK) {
+        log_error("Failed to add message to duplicate database");
+        /* Continue processing - this is not fatal */
+    }
+
+    /* Netmail for the Areafix robot updates subscriptions instead of being delivered */
+    if (areafix && ftn_areafix_is_request(msg, &network->address)) {
+        return process_areafix_request(msg, network, areafix, stats);
+    }
+
+    /* Determine routing */
+    error = ftn_router_route_message(router, msg, &decision);
+    if (error != FTN_OK) {
+        log_error("Routing failed for message");
+        stats->errors_encountered++;
+        return FTN_ERROR_INVALID;
+    }
+
+    /* Store message based on routing decision */
+    switch (decision.action) {
+        case FTN_ROUTE_LOCAL_MAIL:
+            error = ftn_storage_store_mail(storage, msg, decision.destination_user, network->name);
+            if (error == FTN_OK) {
+                stats->messages_stored++;
+                logf_debug("Stored netmail for user: %s", decision.destination_user);
+            } else {
+                logf_error("Failed to store netmail for user: %s", decision.destination_user);
+                stats->errors_encountered++;
+                return FTN_ERROR_INVALID;
+            }
+            break;
+
+        case FTN_ROUTE_LOCAL_NEWS:
+            error = ftn_storage_store_news(storage, msg, decision.destination_area, network->name);
+            if (error == FTN_OK) {
+                stats->messages_stored++;
+                logf_debug("Stored echomail for area: %s", decision.destination_area);
+                if (areafix) {
+                    report_echomail_fanout(msg, areafix);
+                }
+            } else {
+                logf_error("Failed to store echomail for area: %s", decision.destination_area);
+                stats->errors_encountered++;
+                return FTN_ERROR_INVALID;
+            }
+            break;
+
+        case FTN_ROUTE_FORWARD:
+            {
+                char addr_str[64];
+                ftn_address_to_string(&decision.forward_to, addr_str, sizeof(addr_str));
+                if (!outbound) {
+                    logf_warning("No outbound_path for network %s, not forwarding to %s", network->name, addr_str);
+                    break;
+                }
+                error = ftn_outbound_add(outbound, &decision.forward_to, ftn_outbound_flavor(msg), msg);
+                if (error != FTN_OK) {
+                    logf_error("Failed to queue netmail for %s", addr_str);
+                    stats->errors_encountered++;
+                    return FTN_ERROR_INVALID;
+                }
+                stats->messages_forwarded++;
+                logf_debug("Queued netmail for %s", addr_str);
+            }
+            break;
+
+        case FTN_ROUTE_DROP:
+            logf_debug("Dropping message per routing rules: %s", msg->msgid ? msg->msgid : "no-msgid");
+            break;
+
+        default:
+            logf_error("Invalid routing action: %d", decision.action);
+            stats->errors_encountered++;
+            return FTN_ERROR_INVALID;
+    }
+
+    return FTN_OK;
+}
+
+/* Apply an Areafix request and queue the robot's reply */
+static ftn_error_t process_areafix_request(const ftn_message_t* msg, const ftn_network_config_t* network,
+                                          ftn_areafix_t* areafix, ftn_toss_stats_t* stats) {
+    char* response = NULL;
+    char addr_str[64];
+    ftn_error_t error;
+
+    ftn_address_to_string(&msg->orig_addr, addr_str, sizeof(addr_str));
+    logf_info("Processing Areafix request from %s", addr_str);
+
+    error = ftn_areafix_process_request(areafix, msg, &response);
+    if (error != FTN_OK) {
+        logf_error("Failed to process Areafix request from %s", addr_str);
+        stats->errors_encountered++;
+        return error;
+    }
+
+    if (ftn_areafix_save(areafix) != FTN_OK) {
+        logf_error("Failed to save Areafix database: %s", areafix->db_path);
+        stats->errors_encountered++;
+    }
+
+    if (network->outbox) {
+        if (ftn_areafix_write_reply(network->outbox, &network->address, msg, response) != FTN_OK) {
+            logf_error("Failed to write Areafix reply for %s", addr_str);
+            stats->errors_encountered++;
+        }
+    }
+
+    free(response);
+    return FTN_OK;
+}
+
+/* Log the links an echomail message fans out to */
+static void report_echomail_fanout(const ftn_message_t* msg, const ftn_areafix_t* areafix) {
+    ftn_areafix_word_t* seen;
+    ftn_areafix_word_t* out;
+    int area_id;
+    size_t count;
+
+    if (!msg->area) return;
+
+    area_id = ftn_areafix_find_area(areafix, msg->area);
+    if (area_id < 0) {
+        logf_debug("Area %s has no subscription entry", msg->area);
+        return;
+    }
+
+    seen = ftn_areafix_bitset_new(areafix);
+    out = ftn_areafix_bitset_new(areafix);
+    if (seen && out && ftn_areafix_seenby_bits(areafix, msg, seen) == FTN_OK) {
+        count = ftn_areafix_fanout(areafix, (size_t)area_id, seen, out);
+        logf_debug("Echomail in %s fans out to %lu links", msg->area, (unsigned long)count);
+    }
+
+    free(seen);
+    free(out);
+}
+
+/* Process a single packet file */
+static ftn_error_t process_single_packet(const char* packet_path, const ftn_network_config_t* network,
+                                        ftn_router_t* router, ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
+                                        ftn_areafix_t* areafix, ftn_outbound_t* outbound, ftn_toss_stats_t* stats) {
+    ftn_packet_t* packet = NULL;
+    ftn_error_t error;
+    int delivered;
+    size_t i;
+
+    if (!packet_path || !network || !router || !storage || !dupecheck || !stats) {
+        return FTN_ERROR_INVALID;
+    }
+
+    logf_debug("Processing packet: %s", packet_path);
+
+    /* Load packet */
+    error = ftn_packet_load(packet_path, &packet);
+    if (error != FTN_OK) {
+        logf_error("Failed to load packet: %s", packet_path);
+        stats->errors_encountered++;
+
+        /* Move to bad directory */
+        if (network->bad) {
+            move_packet_to_bad(packet_path, network->bad);
+        }
+        return FTN_ERROR_PARSE;
+    }
+
+    stats->packets_processed++;
+    logf_debug("Loaded packet with %lu messages", (unsigned long)packet->message_count);
+
+    /* Process each message in the packet */
+    for (i = 0; i < packet->message_count; i++) {
+        error = process_message(packet->messages[i], network, router, storage, dupecheck, areafix, outbound,
+                                stats);
+        if (error != FTN_OK) {
+            logf_error("Error processing message %lu in packet %s", (unsigned long)(i + 1), packet_path);
+            /* Continue processing other messages */
+        }
+    }
+
+    /* Mail and news queued for LMTP or NNTP must be delivered before the packet is retired */
+    delivered = ftn_storage_flush(storage) == FTN_OK;
+    if (!delivered) {
+        logf_error("Failed to deliver messages from packet %s", packet_path);
+        stats->errors_encountered++;
+    }
+
+    /* Close the outbound packets so the mailer can send them */
+    if (outbound && ftn_outbound_flush(outbound) != FTN_OK) {
+        logf_error("Failed to queue netmail forwarded from packet %s", packet_path);
+        stats->errors_encountered++;
+    }
+
+    ftn_packet_free(packet);
+
+    /* A packet whose messages were not all stored is the only copy left of them */
+    if (!delivered) {
+        if (network->bad && move_packet_to_bad(packet_path, network->bad) == FTN_OK) {
+            logf_warning("Kept undelivered packet in bad directory: %s", network->bad);
+        } else {
+            logf_warning("Left undelivered packet in inbox: %s", packet_path);
+        }
+        return FTN_ERROR_FILE;
+    }
+
+    /* Move packet to processed directory */
+    if (network->processed) {
+        error = move_packet_to_processed(packet_path, network->processed);
+        if (error != FTN_OK) {
+            logf_error("Failed to move processed packet: %s", packet_path);
+            /* Not fatal - packet was processed successfully */
+        }
+    }
+
+    return FTN_OK;
+}
+
+/* Queue the packets waiting in a network inbox */
+static int schedule_network_inbox(const ftn_network_config_t* network, size_t index,
+                                  ftn_inbound_queue_t* queue) {
+    size_t before;
+
+    if (!network || !queue) {
+        log_error("Invalid parameters to schedule_network_inbox");
+        return -1;
+    }
+
+    /* Ensure directories exist */
+    if (ensure_directories_exist(network) != FTN_OK) {
+        logf_error("Failed to ensure directories exist for network: %s", network->name);
+        return -1;
+    }
+
+    if (!network->inbox) {
+        logf_error("No inbox path configured for network: %s", network->name);
+        return -1;
+    }
+
+    before = queue->count;
+    if (ftn_inbound_scan(queue, network->inbox, index) != FTN_OK) {
+        logf_error("Failed to scan inbox directory: %s", network->inbox);
+        return -1;
+    }
+
+    logf_info("Found %lu packets in inbox for network: %s",
+              (unsigned long)(queue->count - before), network->name);
+    return 0;
+}
+
+/* Toss queued packets in order, deferring echomail once the budget is spent */
+static int toss_inbound_queue(const ftn_config_t* config, ftn_inbound_queue_t* queue, int time_budget,
+                              ftn_router_t* router, ftn_storage_t* storage, ftn_dupecheck_t* dupecheck,
+                              ftn_areafix_t** areafix, ftn_outbound_t** outbound, ftn_toss_stats_t* stats) {
+    const ftn_inbound_entry_t* entry;
+    const ftn_network_config_t* network;
+    time_t deadline = 0;
+    size_t prefetch_depth = 0;
+    int result = 0;
+    size_t i;
+
+    if (!config || !queue || !router || !storage || !dupecheck || !stats) {
+        log_error("Invalid parameters to toss_inbound_queue");
+        return -1;
+    }
+
+    if (time_budget > 0) {
+        deadline = stats->processing_start_time + time_budget;
+    }
+    if (config->daemon && config->daemon->prefetch_depth > 0) {
+        prefetch_depth = (size_t)config->daemon->prefetch_depth;
+    }
+
+    for (i = 0; i < queue->count; i++) {
+        entry = &queue->entries[i];
+
+        /* Netmail is never deferred; the queue is sorted so the rest can wait */
+        if (deadline && entry->pkt_class != FTN_INBOUND_NETMAIL && time(NULL) >= deadline) {
+            stats->packets_deferred = queue->count - i;
+            logf_info("Toss budget of %d seconds exhausted, deferring %lu packets",
+                      time_budget, (unsigned long)stats->packets_deferred);
+            break;
+        }
+
+        /* Warm the next packets while this one is being delivered */
+        if (prefetch_depth > 0) {
+            ftn_inbound_prefetch(queue, i, prefetch_depth + 1);
+        }
+
+        network = &config->networks[entry->source];
+        logf_debug("Tossing %s packet (%ld bytes): %s",
+                   ftn_inbound_class_string(entry->pkt_class), entry->size, entry->path);
+
+        if (process_single_packet(entry->path, network, router, storage, dupecheck,
+                                  areafix ? areafix[entry->source] : NULL,
+                                  outbound ? outbound[entry->source] : NULL, stats) != FTN_OK) {
+            logf_error("Error processing packet: %s", entry->path);
+            result = -1;
+            /* Continue processing other packets */
+        }
+    }
+
+    return result;
+}
+
+/* Distribute the file echoes waiting in a network's inbox */
+static int process_network_tics(const ftn_network_config_t* network, ftn_toss_stats_t* stats) {
+    ftn_tic_context_t ctx;
+    ftn_areafix_t* filefix = NULL;
+    DIR* dir;
+    struct dirent* entry;
+    char tic_path[1024];
+    char filebox[1024];
+    size_t links_sent;
+    ftn_error_t error;
+    int result = 0;
+
+    memset(&ctx, 0, sizeof(ctx));
+    if (!network->address_str || !ftn_address_parse(network->address_str, &ctx.address)) {
+        logf_error("No valid address configured for network: %s", network->name);
+        return -1;
+    }
+
+    /* Keep the filebox beside the file areas so hard links work by default */
+    if (network->filebox_path) {
+        ctx.filebox_path = network->filebox_path;
+    } else {
+        snprintf(filebox, sizeof(filebox), "%s/.filebox", network->fileecho_path);
+        ctx.filebox_path = filebox;
+    }
+    ctx.fileecho_path = network->fileecho_path;
+    ctx.outbound_path = network->outbound_path;
+    ctx.bad_path = network->bad;
+
+    if (network->filefix_db) {
+        filefix = ftn_areafix_new(network->filefix_db);
+        if (!filefix || ftn_areafix_load(filefix) != FTN_OK) {
+            logf_error("Failed to load file echo database: %s", network->filefix_db);
+            ftn_areafix_free(filefix);
+            return -1;
+        }
+        ctx.subscriptions = filefix;
+    }
+
+    dir = opendir(network->inbox);
+    if (!dir) {
+        logf_error("Failed to open inbox directory: %s", network->inbox);
+        ftn_areafix_free(filefix);
+        return -1;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (!ftn_tic_is_tic_name(entry->d_name)) continue;
+
+        snprintf(tic_path, sizeof(tic_path), "%s/%s", network->inbox, entry->d_name);
+        error = ftn_tic_process(&ctx, tic_path, &links_sent);
+
+        if (error == FTN_OK) {
+            stats->files_processed++;
+            if (network->processed) {
+                move_packet_to_processed(tic_path, network->processed);
+            } else {
+                remove(tic_path);
+            }
+        } else if (error == FTN_ERROR_NOTFOUND) {
+            /* The file is still in transit; try again next cycle */
+            continue;
+        } else if (error == FTN_ERROR_FILE) {
+            /* A local write failed; the TIC stays for the next cycle */
+            logf_error("Failed to store or queue TIC file: %s", tic_path);
+            stats->errors_encountered++;
+            result = -1;
+        } else {
+            logf_error("Failed to process TIC file: %s", tic_path);
+            stats->errors_encountered++;
+            result = -1;
+            if (network->bad) {
+                move_packet_to_bad(tic_path, network->bad);
+            }
+        }
+    }
+
+    closedir(dir);
+    ftn_areafix_free(filefix);
+    return result;
+}
@@ -21,6 +21,8 @@
  * SOFTWARE.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -183,6 +185,35 @@ void ftn_transfer_context_free(ftn_transfer_context_t* ctx) {
     memset(ctx, 0, sizeof(ftn_transfer_context_t));
 }
 
+ftn_bso_error_t ftn_transfer_context_set_session(ftn_transfer_context_t* ctx, struct ftn_binkp_session* session) {
+    if (!ctx) {
+        return BSO_ERROR_INVALID_PATH;
+    }
+
+    ctx->session = session;
+    return BSO_OK;
+}
+
+ftn_bso_error_t ftn_transfer_context_set_crc(ftn_transfer_context_t* ctx, ftn_crc_cache_t* cache, int use_crc) {
+    if (!ctx) {
+        return BSO_ERROR_INVALID_PATH;
+    }
+
+    ctx->crc_cache = cache;
+    ctx->use_crc = use_crc;
+    return BSO_OK;
+}
+
+ftn_bso_error_t ftn_transfer_context_set_freq(ftn_transfer_context_t* ctx, const ftn_freq_index_t* index, size_t limit) {
+    if (!ctx) {
+        return BSO_ERROR_INVALID_PATH;
+    }
+
+    ctx->freq_index = index;
+    ctx->freq_limit = limit;
+    return BSO_OK;
+}
+
 ftn_bso_error_t ftn_transfer_add_file(ftn_transfer_context_t* ctx, const ftn_file_transfer_t* transfer) {
     ftn_file_transfer_t* new_transfer;
 
@@ -354,9 +385,31 @@ ftn_bso_error_t ftn_transfer_send_file_header(ftn_transfer_context_t* ctx, ftn_f
         filename = transfer->filename;
     }
 
+    /*
+     * The CRC option needs the whole-file CRC up front. The same bundle or
+     * file echo usually goes to many links, so it comes from the cache
+     * and each version of a file is only read for its CRC once.
+     */
+    transfer->has_crc = 0;
+    if (ctx->crc_cache && ftn_crc_cache_lookup(ctx->crc_cache, transfer->filename, &transfer->crc32)) {
+        transfer->has_crc = 1;
+    } else if (ctx->use_crc) {
+        if (ftn_crc32_file_cached(ctx->crc_cache, transfer->filename, &transfer->crc32) != BINKP_OK) {
+            logf_error("Cannot calculate CRC for: %s", transfer->filename);
+            return BSO_ERROR_FILE_IO;
+        }
+        transfer->has_crc = 1;
+    }
+
     /* Send M_FILE command via binkp session */
     /* This would integrate with the binkp session to send the M_FILE command */
-    logf_info("Sending file header: %s (%zu bytes)", filename, transfer->total_size);
+    if (transfer->has_crc) {
+        logf_info("Sending file header: %s (%zu bytes, CRC %08lX)", filename, transfer->total_size,
+                  (unsigned long)transfer->crc32);
+    } else {
+        logf_info("Sending file header: %s (%zu bytes)", filename, transfer->total_size);
+    }
+    transfer->running_crc = 0xFFFFFFFFUL;
 
     /* Open file for reading */
     transfer->file_handle = fopen(transfer->filename, "rb");
@@ -380,17 +433,36 @@ ftn_bso_error_t ftn_transfer_send_file_header(ftn_transfer_context_t* ctx, ftn_f
 
 ftn_bso_error_t ftn_transfer_send_file_data(ftn_transfer_context_t* ctx, ftn_file_transfer_t* transfer) {
     char buffer[FTN_TRANSFER_CHUNK_SIZE];
+    ftn_binkp_frame_t frame;
+    ftn_binkp_error_t sent;
     size_t bytes_read;
+    size_t remaining;
+    struct stat st;
     ftn_bso_error_t result;
 
     if (!ctx || !transfer || !transfer->file_handle) {
         return BSO_ERROR_INVALID_PATH;
     }
 
-    /* Read chunk from file */
-    result = ftn_transfer_read_chunk(transfer, buffer, &bytes_read);
-    if (result != BSO_OK) {
-        return result;
+    /* Unless its CRC is being learned, the file goes to the session without a copy */
+    if (ctx->session && !(ctx->crc_cache && !transfer->has_crc)) {
+        remaining = transfer->total_size - transfer->transferred;
+        bytes_read = (remaining < BINKP_MAX_FRAME_SIZE) ? remaining : BINKP_MAX_FRAME_SIZE;
+        if (bytes_read > 0) {
+            sent = ftn_binkp_send_file_data(ctx->session, fileno(transfer->file_handle),
+                                            (long)transfer->transferred, bytes_read);
+            if (sent != BINKP_OK) {
+                logf_error("Failed to send file data: %s: %s", transfer->filename, ftn_binkp_error_string(sent));
+                return BSO_ERROR_FILE_IO;
+            }
+            transfer->transferred += bytes_read;
+            return BSO_OK;
+        }
+    } else {
+        result = ftn_transfer_read_chunk(transfer, buffer, &bytes_read);
+        if (result != BSO_OK) {
+            return result;
+        }
     }
 
     if (bytes_read == 0) {
@@ -399,12 +471,36 @@ ftn_bso_error_t ftn_transfer_send_file_data(ftn_transfer_context_t* ctx, ftn_fil
         transfer->file_handle = NULL;
         transfer->state = TRANSFER_STATE_WAITING_ACK;
 
+        /* A complete first send leaves the CRC behind for later sessions */
+        if (ctx->crc_cache && !transfer->has_crc && transfer->resume_offset == 0 &&
+            transfer->transferred == transfer->total_size &&
+            stat(transfer->filename, &st) == 0 && (size_t)st.st_size == transfer->total_size &&
+            st.st_mtime == transfer->timestamp) {
+            transfer->crc32 = transfer->running_crc ^ 0xFFFFFFFFUL;
+            transfer->has_crc = 1;
+            ftn_crc_cache_store(ctx->crc_cache, transfer->filename, transfer->crc32);
+        }
+
         logf_info("File sent: %s (%zu bytes)", transfer->filename, transfer->transferred);
         return BSO_OK;
     }
 
-    /* Send data via binkp session */
-    /* This would integrate with the binkp session to send data frames */
+    if (ctx->crc_cache && !transfer->has_crc) {
+        transfer->running_crc = ftn_crc32_update(transfer->running_crc, (const uint8_t*)buffer, bytes_read);
+    }
+
+    if (ctx->session) {
+        ftn_binkp_frame_init(&frame);
+        if (ftn_binkp_frame_create(&frame, 0, (const uint8_t*)buffer, bytes_read) != BINKP_OK) {
+            return BSO_ERROR_MEMORY;
+        }
+        sent = ftn_binkp_send_frame(ctx->session, &frame);
+        ftn_binkp_frame_free(&frame);
+        if (sent != BINKP_OK) {
+            logf_error("Failed to send file data: %s: %s", transfer->filename, ftn_binkp_error_string(sent));
+            return BSO_ERROR_FILE_IO;
+        }
+    }
     transfer->transferred += bytes_read;
 
     return BSO_OK;
@@ -505,6 +601,88 @@ ftn_bso_error_t ftn_transfer_receive_file_data(ftn_transfer_context_t* ctx, cons
     return ftn_transfer_write_chunk(ctx->current_recv, data, len);
 }
 
+ftn_bso_error_t ftn_transfer_complete_receive(ftn_transfer_context_t* ctx) {
+    ftn_file_transfer_t* transfer;
+    ftn_bso_error_t result = BSO_OK;
+
+    if (!ctx || !ctx->current_recv) {
+        return BSO_ERROR_INVALID_PATH;
+    }
+
+    transfer = ctx->current_recv;
+    if (transfer->file_handle) {
+        if (fclose(transfer->file_handle) != 0) {
+            result = BSO_ERROR_FILE_IO;
+        }
+        transfer->file_handle = NULL;
+    }
+
+    if (result == BSO_OK && ctx->freq_index && ftn_freq_is_request_name(transfer->filename)) {
+        /* Answered here and now; the .req never reaches the inbox */
+        result = ftn_transfer_answer_request(ctx, transfer->temp_filename, NULL);
+        remove(transfer->temp_filename);
+    } else if (result == BSO_OK && rename(transfer->temp_filename, transfer->filename) != 0) {
+        logf_error("Cannot rename %s to %s: %s", transfer->temp_filename, transfer->filename, strerror(errno));
+        result = BSO_ERROR_FILE_IO;
+    }
+
+    transfer->state = result == BSO_OK ? TRANSFER_STATE_COMPLETED : TRANSFER_STATE_ERROR;
+    if (result == BSO_OK) {
+        ctx->completed_files++;
+    }
+
+    ftn_file_transfer_free(transfer);
+    free(transfer);
+    ctx->current_recv = NULL;
+    return result;
+}
+
+static ftn_error_t transfer_queue_freq_file(const ftn_freq_file_t* file, void* data) {
+    ftn_transfer_context_t* ctx = (ftn_transfer_context_t*)data;
+    ftn_file_transfer_t transfer;
+    ftn_bso_error_t result;
+
+    result = ftn_file_transfer_setup_send(&transfer, file->path, REF_DIRECTIVE_NONE);
+    if (result == BSO_ERROR_NOT_FOUND) {
+        return FTN_OK;
+    }
+    if (result != BSO_OK) {
+        return FTN_ERROR_NOMEM;
+    }
+
+    result = ftn_transfer_add_file(ctx, &transfer);
+    ftn_file_transfer_free(&transfer);
+    return result == BSO_OK ? FTN_OK : FTN_ERROR_NOMEM;
+}
+
+ftn_bso_error_t ftn_transfer_answer_request(ftn_transfer_context_t* ctx, const char* req_path, size_t* queued) {
+    ftn_error_t error;
+
+    if (queued) {
+        *queued = 0;
+    }
+    if (!ctx || !req_path || !ctx->freq_index) {
+        return BSO_ERROR_INVALID_PATH;
+    }
+
+    if (ctx->session && !ctx->session->authenticated) {
+        logf_warning("Ignoring file request from an unauthenticated session");
+        return BSO_OK;
+    }
+
+    error = ftn_freq_answer_request(ctx->freq_index, req_path, ctx->freq_limit,
+                                    transfer_queue_freq_file, ctx, queued);
+    if (error == FTN_ERROR_NOMEM) {
+        return BSO_ERROR_MEMORY;
+    }
+    if (error != FTN_OK) {
+        return BSO_ERROR_FILE_IO;
+    }
+
+    ctx->requests_answered++;
+    return BSO_OK;
+}
+
 ftn_bso_error_t ftn_transfer_create_temp_filename(const char* final_filename, char** temp_filename) {
     const char* basename;
     char* result;
@@ -0,0 +1,391 @@
+/*
+ * test_areafix.c - Echo area subscription and Areafix robot tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "ftn.h"
+#include "ftn/areafix.h"
+#include "ftn/packet.h"
+
+#define TEST_DB "tmp/test_areafix.db"
+#define TEST_OUTBOX "tmp/test_areafix_out"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* Helper function to build a table with three links and two areas */
+ftn_areafix_t* create_test_table(const char* db_path) {
+    ftn_areafix_t* areafix;
+    ftn_address_t addr;
+    size_t id;
+
+    areafix = ftn_areafix_new(db_path);
+    if (!areafix) return NULL;
+
+    ftn_address_parse("1:2/3", &addr);
+    ftn_areafix_add_link(areafix, &addr, "secret", &id);
+    ftn_address_parse("1:2/4", &addr);
+    ftn_areafix_add_link(areafix, &addr, NULL, &id);
+    ftn_address_parse("1:5/6", &addr);
+    ftn_areafix_add_link(areafix, &addr, NULL, &id);
+
+    ftn_areafix_add_area(areafix, "FIDO_SYSOP", &id);
+    ftn_areafix_add_area(areafix, "fido_test", &id);
+    return areafix;
+}
+
+void test_areas_and_links(void) {
+    ftn_areafix_t* areafix;
+    ftn_address_t addr;
+
+    test_start("area and link lookup");
+
+    areafix = create_test_table(NULL);
+    if (!areafix) {
+        test_fail("Failed to create table");
+        return;
+    }
+
+    ftn_address_parse("1:2/4", &addr);
+    if (areafix->link_count != 3 || areafix->area_count != 2 ||
+        ftn_areafix_find_link(areafix, &addr) != 1 ||
+        ftn_areafix_find_area(areafix, "fido_sysop") != 0 ||
+        ftn_areafix_find_area(areafix, "FIDO_TEST") != 1 ||
+        ftn_areafix_find_area(areafix, "NOPE") != -1) {
+        test_fail("Lookup returned wrong index");
+        ftn_areafix_free(areafix);
+        return;
+    }
+
+    if (strcmp(areafix->areas[1].tag, "FIDO_TEST") != 0) {
+        test_fail("Area tag not normalized");
+        ftn_areafix_free(areafix);
+        return;
+    }
+
+    ftn_areafix_free(areafix);
+    test_pass();
+}
+
+void test_many_areas_and_links(void) {
+    ftn_areafix_t* areafix;
+    ftn_address_t addr;
+    char tag[32];
+    size_t id;
+    int i;
+
+    test_start("many areas and links");
+
+    areafix = ftn_areafix_new(NULL);
+    if (!areafix) {
+        test_fail("Failed to create table");
+        return;
+    }
+
+    for (i = 0; i < 2000; i++) {
+        sprintf(tag, "AREA%d", i);
+        if (ftn_areafix_add_area(areafix, tag, &id) != FTN_OK || id != (size_t)i) {
+            test_fail("Failed to add area");
+            ftn_areafix_free(areafix);
+            return;
+        }
+    }
+
+    /* Subscribe early, then widen the bitsets well past one word */
+    addr.zone = 1;
+    addr.net = 100;
+    addr.point = 0;
+    addr.node = 0;
+    ftn_areafix_add_link(areafix, &addr, NULL, &id);
+    ftn_areafix_subscribe(areafix, 1500, 0);
+    for (i = 1; i < 300; i++) {
+        addr.node = (unsigned int)i;
+        ftn_areafix_add_link(areafix, &addr, NULL, &id);
+    }
+    ftn_areafix_subscribe(areafix, 1500, 299);
+
+    if (ftn_areafix_find_area(areafix, "area1999") != 1999 ||
+        !ftn_areafix_is_subscribed(areafix, 1500, 0) ||
+        !ftn_areafix_is_subscribed(areafix, 1500, 299) ||
+        ftn_areafix_is_subscribed(areafix, 1500, 298) ||
+        ftn_areafix_bitset_count(areafix, areafix->areas[1500].links) != 2) {
+        test_fail("Subscriptions lost when widening bitsets");
+        ftn_areafix_free(areafix);
+        return;
+    }
+
+    ftn_areafix_free(areafix);
+    test_pass();
+}
+
+void test_fanout(void) {
+    ftn_areafix_t* areafix;
+    ftn_message_t* msg;
+    ftn_areafix_word_t* seen;
+    ftn_areafix_word_t* out;
+    size_t count;
+
+    test_start("echomail fan-out");
+
+    areafix = create_test_table(NULL);
+    msg = ftn_message_new(FTN_MSG_ECHOMAIL);
+    if (!areafix || !msg) {
+        test_fail("Failed to create test data");
+        return;
+    }
+
+    ftn_areafix_subscribe(areafix, 0, 0);
+    ftn_areafix_subscribe(areafix, 0, 1);
+    ftn_areafix_subscribe(areafix, 0, 2);
+
+    /* 2/3 and 2/4 have already seen it; 5/6 has not */
+    ftn_message_add_seenby(msg, " 2/3 4 7/1");
+
+    seen = ftn_areafix_bitset_new(areafix);
+    out = ftn_areafix_bitset_new(areafix);
+    ftn_areafix_seenby_bits(areafix, msg, seen);
+    count = ftn_areafix_fanout(areafix, 0, seen, out);
+
+    if (count != 1 || !FTN_AREAFIX_BIT_TEST(out, 2) ||
+        FTN_AREAFIX_BIT_TEST(out, 0) || FTN_AREAFIX_BIT_TEST(out, 1)) {
+        test_fail("Fan-out should only include 1:5/6");
+    } else if (ftn_areafix_fanout(areafix, 1, seen, out) != 0) {
+        test_fail("Unsubscribed area should not fan out");
+    } else {
+        test_pass();
+    }
+
+    free(seen);
+    free(out);
+    ftn_message_free(msg);
+    ftn_areafix_free(areafix);
+}
+
+void test_save_and_load(void) {
+    ftn_areafix_t* areafix;
+    ftn_address_t addr;
+
+    test_start("database save and load");
+
+    remove(TEST_DB);
+    areafix = create_test_table(TEST_DB);
+    if (!areafix) {
+        test_fail("Failed to create table");
+        return;
+    }
+    ftn_areafix_subscribe(areafix, 1, 0);
+    ftn_areafix_subscribe(areafix, 1, 2);
+    areafix->links[1].insecure = 1;
+
+    if (ftn_areafix_save(areafix) != FTN_OK) {
+        test_fail("Failed to save database");
+        ftn_areafix_free(areafix);
+        return;
+    }
+    ftn_areafix_free(areafix);
+
+    areafix = ftn_areafix_new(TEST_DB);
+    if (!areafix || ftn_areafix_load(areafix) != FTN_OK) {
+        test_fail("Failed to load database");
+        ftn_areafix_free(areafix);
+        return;
+    }
+
+    ftn_address_parse("1:2/3", &addr);
+    if (areafix->link_count != 3 || areafix->area_count != 2 ||
+        !areafix->links[ftn_areafix_find_link(areafix, &addr)].password ||
+        strcmp(areafix->links[0].password, "secret") != 0 ||
+        areafix->links[0].insecure || !areafix->links[1].insecure || areafix->links[1].password ||
+        !ftn_areafix_is_subscribed(areafix, 1, 0) ||
+        ftn_areafix_is_subscribed(areafix, 1, 1) ||
+        !ftn_areafix_is_subscribed(areafix, 1, 2) ||
+        ftn_areafix_is_subscribed(areafix, 0, 0)) {
+        test_fail("Loaded database does not match");
+        ftn_areafix_free(areafix);
+        return;
+    }
+
+    ftn_areafix_free(areafix);
+    remove(TEST_DB);
+    test_pass();
+}
+
+void test_robot_request(void) {
+    ftn_areafix_t* areafix;
+    ftn_message_t* msg;
+    ftn_address_t local;
+    char* response = NULL;
+
+    test_start("Areafix robot request");
+
+    areafix = create_test_table(NULL);
+    msg = ftn_message_new(FTN_MSG_NETMAIL);
+    if (!areafix || !msg) {
+        test_fail("Failed to create test data");
+        return;
+    }
+
+    ftn_address_parse("1:2/1", &local);
+    ftn_address_parse("1:2/3", &msg->orig_addr);
+    msg->dest_addr = local;
+    msg->to_user = malloc(8);
+    msg->subject = malloc(8);
+    msg->text = malloc(64);
+    strcpy(msg->to_user, "areafix");
+    strcpy(msg->subject, "SECRET");
+    strcpy(msg->text, "+fido_*\r\n-fido_test\r\n%QUERY\r\n---\r\n+IGNORED");
+
+    if (!ftn_areafix_is_request(msg, &local)) {
+        test_fail("Request not recognized");
+    } else if (ftn_areafix_process_request(areafix, msg, &response) != FTN_OK || !response) {
+        test_fail("Request processing failed");
+    } else if (!ftn_areafix_is_subscribed(areafix, 0, 0) ||
+               ftn_areafix_is_subscribed(areafix, 1, 0) ||
+               !strstr(response, "Linked: FIDO_SYSOP") ||
+               !strstr(response, "Unlinked: FIDO_TEST")) {
+        test_fail("Request not applied");
+    } else {
+        free(response);
+        response = NULL;
+
+        /* Wrong password changes nothing */
+        strcpy(msg->subject, "wrong");
+        strcpy(msg->text, "-FIDO_SYSOP");
+        if (ftn_areafix_process_request(areafix, msg, &response) != FTN_OK ||
+            !strstr(response, "Password incorrect") ||
+            !ftn_areafix_is_subscribed(areafix, 0, 0)) {
+            test_fail("Bad password not rejected");
+        } else {
+            free(response);
+            response = NULL;
+
+            /* A link without a password only when it is marked insecure */
+            ftn_address_parse("1:2/4", &msg->orig_addr);
+            strcpy(msg->text, "+FIDO_SYSOP");
+            if (ftn_areafix_process_request(areafix, msg, &response) != FTN_OK ||
+                !strstr(response, "no Areafix password") ||
+                ftn_areafix_is_subscribed(areafix, 0, 1)) {
+                test_fail("Request from a link without a password accepted");
+            } else {
+                free(response);
+                response = NULL;
+                areafix->links[1].insecure = 1;
+                if (ftn_areafix_process_request(areafix, msg, &response) != FTN_OK ||
+                    !ftn_areafix_is_subscribed(areafix, 0, 1)) {
+                    test_fail("Request from an insecure link refused");
+                } else {
+                    test_pass();
+                }
+            }
+        }
+    }
+
+    free(response);
+    ftn_message_free(msg);
+    ftn_areafix_free(areafix);
+}
+
+void test_robot_reply(void) {
+    ftn_message_t* msg;
+    ftn_address_t local;
+    ftn_packet_t* packet = NULL;
+    char command[256];
+    char path[256];
+    DIR* dir;
+    struct dirent* entry;
+    int status;
+
+    test_start("Areafix reply packet");
+
+    snprintf(command, sizeof(command), "rm -rf %s && mkdir -p %s", TEST_OUTBOX, TEST_OUTBOX);
+    status = system(command);
+    (void)status;
+
+    msg = ftn_message_new(FTN_MSG_NETMAIL);
+    if (!msg) {
+        test_fail("Failed to create test message");
+        return;
+    }
+    ftn_address_parse("1:2/1", &local);
+    ftn_address_parse("1:2/3", &msg->orig_addr);
+    msg->from_user = malloc(16);
+    strcpy(msg->from_user, "Remote Sysop");
+
+    if (ftn_areafix_write_reply(TEST_OUTBOX, &local, msg, "Linked: FIDO_SYSOP\r") != FTN_OK) {
+        test_fail("Failed to write reply");
+        ftn_message_free(msg);
+        return;
+    }
+    ftn_message_free(msg);
+
+    path[0] = '\0';
+    dir = opendir(TEST_OUTBOX);
+    if (dir) {
+        while ((entry = readdir(dir)) != NULL) {
+            if (strstr(entry->d_name, ".pkt")) {
+                snprintf(path, sizeof(path), "%s/%s", TEST_OUTBOX, entry->d_name);
+            }
+        }
+        closedir(dir);
+    }
+    if (!path[0]) {
+        test_fail("Reply packet not found");
+        return;
+    }
+
+    if (ftn_packet_load(path, &packet) != FTN_OK || packet->message_count != 1 ||
+        strcmp(packet->messages[0]->to_user, "Remote Sysop") != 0 ||
+        packet->messages[0]->dest_addr.node != 3) {
+        test_fail("Reply packet has wrong contents");
+    } else {
+        test_pass();
+    }
+
+    if (packet) ftn_packet_free(packet);
+    snprintf(command, sizeof(command), "rm -rf %s", TEST_OUTBOX);
+    status = system(command);
+    (void)status;
+}
+
+int main(void) {
+    printf("Areafix Subscription Tests\n");
+    printf("==========================\n\n");
+
+    test_areas_and_links();
+    test_many_areas_and_links();
+    test_fanout();
+    test_save_and_load();
+    test_robot_request();
+    test_robot_reply();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}
@@ -0,0 +1,368 @@
+/*
+ * test_capture.c - Binkp session capture and replay tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ftn.h"
+#include "ftn/binkp/session.h"
+#include "ftn/binkp/capture.h"
+#include "ftn/mailer.h"
+
+#define TEST_ROOT    "tmp/test_capture"
+#define TEST_CAPTURE TEST_ROOT "/session.bkc"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* Helper function to start from an empty directory */
+void reset_test_dir(void) {
+    int status;
+
+    status = system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT);
+    (void)status;
+}
+
+/* Helper function to record one command frame */
+void record_command(ftn_binkp_capture_t* capture, ftn_binkp_capture_dir_t direction,
+                    ftn_binkp_command_t cmd, const char* args) {
+    ftn_binkp_command_frame_t cmd_frame;
+    ftn_binkp_frame_t frame;
+
+    ftn_binkp_command_init(&cmd_frame);
+    ftn_binkp_frame_init(&frame);
+    if (ftn_binkp_command_create(&cmd_frame, cmd, args) == BINKP_OK &&
+        ftn_binkp_command_to_frame(&cmd_frame, &frame) == BINKP_OK) {
+        ftn_binkp_capture_record(capture, direction, &frame);
+    }
+    ftn_binkp_command_free(&cmd_frame);
+    ftn_binkp_frame_free(&frame);
+}
+
+/* Helper function to capture an originating session against 2:5020/1 */
+void write_originator_capture(int complete) {
+    ftn_binkp_capture_t* capture;
+
+    capture = ftn_binkp_capture_open(TEST_CAPTURE, 1);
+    if (!capture) {
+        return;
+    }
+
+    record_command(capture, BINKP_CAPTURE_SENT, BINKP_M_NUL, "libftn binkp/1.0");
+    record_command(capture, BINKP_CAPTURE_SENT, BINKP_M_ADR, "1:2/3");
+    record_command(capture, BINKP_CAPTURE_RECEIVED, BINKP_M_ADR, "2:5020/1");
+    if (complete) {
+        record_command(capture, BINKP_CAPTURE_RECEIVED, BINKP_M_EOB, "");
+    }
+    ftn_binkp_capture_close(capture);
+}
+
+/* Helper function to set up a one-network configuration */
+void setup_config(ftn_config_t* config, ftn_network_config_t* network, const char* address) {
+    memset(config, 0, sizeof(ftn_config_t));
+    memset(network, 0, sizeof(ftn_network_config_t));
+    network->address_str = (char*)address;
+    config->networks = network;
+    config->network_count = 1;
+}
+
+void test_capture_round_trip(void) {
+    ftn_binkp_capture_t* capture;
+    ftn_binkp_replay_t* replay;
+    ftn_binkp_frame_t frame;
+    const uint8_t data[] = "packet data";
+
+    test_start("capture file round trip");
+    reset_test_dir();
+
+    capture = ftn_binkp_capture_open(TEST_CAPTURE, 0);
+    if (!capture) {
+        test_fail("Failed to open capture");
+        return;
+    }
+
+    record_command(capture, BINKP_CAPTURE_SENT, BINKP_M_ADR, "1:2/3");
+    ftn_binkp_frame_init(&frame);
+    ftn_binkp_frame_create(&frame, 0, data, sizeof(data) - 1);
+    ftn_binkp_capture_record(capture, BINKP_CAPTURE_RECEIVED, &frame);
+    ftn_binkp_frame_free(&frame);
+    ftn_binkp_capture_close(capture);
+
+    replay = ftn_binkp_replay_load(TEST_CAPTURE);
+    if (!replay) {
+        test_fail("Failed to load capture");
+        return;
+    }
+
+    if (replay->is_originator || replay->count != 2) {
+        test_fail("Wrong role or record count");
+    } else if (replay->records[0].direction != BINKP_CAPTURE_SENT ||
+               !replay->records[0].frame.is_command ||
+               replay->records[1].direction != BINKP_CAPTURE_RECEIVED ||
+               replay->records[1].frame.is_command ||
+               replay->records[1].frame.size != sizeof(data) - 1 ||
+               memcmp(replay->records[1].frame.data, data, sizeof(data) - 1) != 0 ||
+               replay->records[1].offset_us < replay->records[0].offset_us) {
+        test_fail("Records do not match what was captured");
+    } else {
+        test_pass();
+    }
+
+    ftn_binkp_replay_free(replay);
+}
+
+void test_replay_session(void) {
+    ftn_binkp_replay_t* replay;
+    ftn_binkp_replay_stats_t stats;
+    ftn_config_t config;
+    ftn_network_config_t network;
+
+    test_start("replaying a capture against the session engine");
+    reset_test_dir();
+    write_originator_capture(1);
+
+    replay = ftn_binkp_replay_load(TEST_CAPTURE);
+    if (!replay) {
+        test_fail("Failed to load capture");
+        return;
+    }
+
+    setup_config(&config, &network, "1:2/3");
+    if (ftn_binkp_replay_run(replay, &config, &stats) != BINKP_OK || stats.result != BINKP_OK) {
+        test_fail("Replayed session did not complete");
+    } else if (stats.frames_fed != 2 || stats.frames_sent != 2 ||
+               stats.divergences != 0 || stats.frames_unused != 0) {
+        test_fail("Unexpected replay statistics");
+    } else {
+        test_pass();
+    }
+
+    ftn_binkp_replay_free(replay);
+}
+
+void test_replay_divergence(void) {
+    ftn_binkp_replay_t* replay;
+    ftn_binkp_replay_stats_t stats;
+    ftn_config_t config;
+    ftn_network_config_t network;
+
+    test_start("replay divergence and early hangup");
+    reset_test_dir();
+    write_originator_capture(0);
+
+    replay = ftn_binkp_replay_load(TEST_CAPTURE);
+    if (!replay) {
+        test_fail("Failed to load capture");
+        return;
+    }
+
+    /* A different local address changes one sent frame; the capture
+       ends before M_EOB, which the engine sees as the peer hanging up */
+    setup_config(&config, &network, "1:2/4");
+    ftn_binkp_replay_run(replay, &config, &stats);
+    if (stats.result != BINKP_ERROR_NETWORK) {
+        test_fail("Expected the session to end with a network error");
+    } else if (stats.divergences != 1 || stats.frames_fed != 1) {
+        test_fail("Expected exactly one divergent frame");
+    } else {
+        test_pass();
+    }
+
+    ftn_binkp_replay_free(replay);
+}
+
+/* Helper function to check whether a file contains a string */
+int file_contains(const char* path, const char* text) {
+    FILE* fp;
+    char buffer[4096];
+    size_t len;
+    size_t text_len = strlen(text);
+    size_t i;
+
+    fp = fopen(path, "rb");
+    if (!fp) {
+        return 0;
+    }
+    len = fread(buffer, 1, sizeof(buffer), fp);
+    fclose(fp);
+    for (i = 0; i + text_len <= len; i++) {
+        if (memcmp(buffer + i, text, text_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void test_password_redacted(void) {
+    ftn_binkp_capture_t* capture;
+    ftn_binkp_replay_t* replay;
+    ftn_binkp_frame_t frame;
+    ftn_binkp_command_frame_t cmd_frame;
+
+    test_start("M_PWD redaction and replay");
+    reset_test_dir();
+
+    capture = ftn_binkp_capture_open(TEST_CAPTURE, 0);
+    if (!capture) {
+        test_fail("Failed to open capture");
+        return;
+    }
+    record_command(capture, BINKP_CAPTURE_RECEIVED, BINKP_M_PWD, "topsecret");
+    record_command(capture, BINKP_CAPTURE_SENT, BINKP_M_PWD, "topsecret");
+    ftn_binkp_capture_close(capture);
+
+    if (file_contains(TEST_CAPTURE, "topsecret")) {
+        test_fail("Password written to the capture");
+        return;
+    }
+
+    replay = ftn_binkp_replay_load(TEST_CAPTURE);
+    if (!replay || replay->count != 2) {
+        test_fail("Failed to load capture");
+        ftn_binkp_replay_free(replay);
+        return;
+    }
+
+    /* The replay password takes the place of the captured one */
+    replay->password = "replaypw";
+    ftn_binkp_command_init(&cmd_frame);
+    if (ftn_binkp_replay_receive(replay, &frame) != BINKP_OK ||
+        ftn_binkp_command_parse(&frame, &cmd_frame) != BINKP_OK ||
+        cmd_frame.cmd != BINKP_M_PWD || !cmd_frame.args || strcmp(cmd_frame.args, "replaypw") != 0) {
+        test_fail("Redacted M_PWD not replayed with the replay password");
+    } else {
+        ftn_binkp_frame_free(&frame);
+        ftn_binkp_command_free(&cmd_frame);
+        ftn_binkp_command_init(&cmd_frame);
+        ftn_binkp_frame_init(&frame);
+        if (ftn_binkp_command_create(&cmd_frame, BINKP_M_PWD, "otherpw") != BINKP_OK ||
+            ftn_binkp_command_to_frame(&cmd_frame, &frame) != BINKP_OK ||
+            ftn_binkp_replay_send(replay, &frame) != BINKP_OK || replay->divergences != 0) {
+            test_fail("Sent M_PWD should match a redacted one");
+        } else {
+            test_pass();
+        }
+    }
+    ftn_binkp_frame_free(&frame);
+    ftn_binkp_command_free(&cmd_frame);
+    ftn_binkp_replay_free(replay);
+}
+
+void test_long_session_offsets(void) {
+    FILE* fp;
+    ftn_binkp_replay_t* replay;
+    uint8_t header[BINKP_CAPTURE_HEADER_SIZE];
+    const uint8_t record[BINKP_CAPTURE_RECORD_SIZE + 1] = {
+        'R', 0xF0, 0x00, 0x00, 0x00, 0x80, 0x01, BINKP_M_EOB
+    };
+
+    test_start("offsets past 71 minutes");
+    reset_test_dir();
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, BINKP_CAPTURE_MAGIC, BINKP_CAPTURE_MAGIC_SIZE);
+    header[8] = 'O';
+    fp = fopen(TEST_CAPTURE, "wb");
+    if (!fp) {
+        test_fail("Failed to write capture");
+        return;
+    }
+    fwrite(header, 1, sizeof(header), fp);
+    fwrite(record, 1, sizeof(record), fp);
+    fwrite(record, 1, sizeof(record), fp);
+    fclose(fp);
+
+    /* Two gaps of about 67 minutes: the second frame is past 2^32 us */
+    replay = ftn_binkp_replay_load(TEST_CAPTURE);
+    if (!replay || replay->count != 2) {
+        test_fail("Failed to load capture");
+    } else if (replay->records[1].offset_us <= 4294967295.0 ||
+               replay->records[1].offset_us != 2.0 * replay->records[0].offset_us) {
+        test_fail("Offsets wrapped");
+    } else {
+        test_pass();
+    }
+    ftn_binkp_replay_free(replay);
+}
+
+void test_mailer_capture(void) {
+    ftn_mailer_context_t* ctx;
+    ftn_network_config_t config;
+    ftn_network_context_t net;
+    ftn_binkp_capture_t* capture;
+
+    test_start("mailer capture_dir");
+    reset_test_dir();
+
+    ctx = ftn_mailer_context_new();
+    memset(&config, 0, sizeof(config));
+    config.section_name = "fidonet";
+    memset(&net, 0, sizeof(net));
+    net.config = &config;
+
+    if (!ctx) {
+        test_fail("Failed to create mailer context");
+        return;
+    }
+
+    capture = ftn_mailer_open_capture(ctx, &net, 1);
+    if (capture) {
+        test_fail("Captured without capture_dir");
+        ftn_binkp_capture_close(capture);
+    } else {
+        config.capture_dir = TEST_ROOT;
+        capture = ftn_mailer_open_capture(ctx, &net, 1);
+        if (!capture) {
+            test_fail("No capture with capture_dir set");
+        } else {
+            ftn_binkp_capture_close(capture);
+            if (system("ls " TEST_ROOT "/fidonet-*.bkc >/dev/null 2>&1") != 0) {
+                test_fail("Capture file not created");
+            } else {
+                test_pass();
+            }
+        }
+    }
+
+    ftn_mailer_context_free(ctx);
+}
+
+int main(void) {
+    printf("Running binkp capture tests...\n\n");
+
+    test_capture_round_trip();
+    test_replay_session();
+    test_replay_divergence();
+    test_password_redacted();
+    test_long_session_offsets();
+    test_mailer_capture();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}
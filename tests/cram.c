@@ -0,0 +1,164 @@
+/*
+ * test_cram.c - MD5 and HMAC-MD5 test vectors
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ftn.h"
+#include "ftn/binkp/cram.h"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* Compare a digest against its expected lowercase hex form */
+static int digest_is(const uint8_t* digest, const char* expected) {
+    char* hex;
+    int same;
+
+    hex = ftn_bytes_to_hex(digest, 16, 1);
+    if (!hex) {
+        return 0;
+    }
+    same = strcmp(hex, expected) == 0;
+    free(hex);
+    return same;
+}
+
+/* The test suite of RFC 1321, appendix A.5 */
+void test_md5_vectors(void) {
+    static const char* const inputs[] = {
+        "",
+        "a",
+        "abc",
+        "message digest",
+        "abcdefghijklmnopqrstuvwxyz",
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+        "12345678901234567890123456789012345678901234567890123456789012345678901234567890"
+    };
+    static const char* const digests[] = {
+        "d41d8cd98f00b204e9800998ecf8427e",
+        "0cc175b9c0f1b6a831c399e269772661",
+        "900150983cd24fb0d6963f7d28e17f72",
+        "f96b697d7cb7938d525a2f31aaf161d0",
+        "c3fcd3d76192e4007dfb496cca67e13b",
+        "d174ab98d277d9f5a5611c2c9f419d9f",
+        "57edf4a22be3c955ac49da2e2107b67a"
+    };
+    uint8_t digest[16];
+    size_t i;
+
+    test_start("MD5 RFC 1321 vectors");
+
+    for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        if (ftn_md5_hash((const uint8_t*)inputs[i], strlen(inputs[i]), digest) != BINKP_OK ||
+            !digest_is(digest, digests[i])) {
+            printf("(\"%s\") ", inputs[i]);
+            test_fail("Wrong digest");
+            return;
+        }
+    }
+    test_pass();
+}
+
+/* Feeding the input in pieces gives the same digest as one call */
+void test_md5_streaming(void) {
+    const char* input = "12345678901234567890123456789012345678901234567890123456789012345678901234567890";
+    ftn_md5_context_t ctx;
+    uint8_t digest[16];
+    size_t len = strlen(input);
+    size_t split;
+
+    test_start("MD5 streaming updates");
+
+    for (split = 0; split <= len; split++) {
+        ftn_md5_init(&ctx);
+        ftn_md5_update(&ctx, input, split);
+        ftn_md5_update(&ctx, input + split, len - split);
+        ftn_md5_final(&ctx, digest);
+        if (!digest_is(digest, "57edf4a22be3c955ac49da2e2107b67a")) {
+            printf("(split at %lu) ", (unsigned long)split);
+            test_fail("Split input changed the digest");
+            return;
+        }
+    }
+    test_pass();
+}
+
+/* The HMAC-MD5 vectors of RFC 2104, and RFC 2202's key longer than a block */
+void test_hmac_md5_vectors(void) {
+    uint8_t key[80];
+    uint8_t data[50];
+    uint8_t digest[16];
+    const char* jefe = "what do ya want for nothing?";
+    const char* large = "Test Using Larger Than Block-Size Key - Hash Key First";
+
+    test_start("HMAC-MD5 RFC 2104 vectors");
+
+    memset(key, 0x0b, 16);
+    if (ftn_hmac_md5(key, 16, (const uint8_t*)"Hi There", 8, digest) != BINKP_OK ||
+        !digest_is(digest, "9294727a3638bb1c13f48ef8158bfc9d")) {
+        test_fail("Wrong digest for \"Hi There\"");
+        return;
+    }
+
+    if (ftn_hmac_md5((const uint8_t*)"Jefe", 4, (const uint8_t*)jefe, strlen(jefe), digest) != BINKP_OK ||
+        !digest_is(digest, "750c783e6ab0b503eaa86e310a5db738")) {
+        test_fail("Wrong digest for \"Jefe\"");
+        return;
+    }
+
+    memset(key, 0xaa, 16);
+    memset(data, 0xdd, sizeof(data));
+    if (ftn_hmac_md5(key, 16, data, sizeof(data), digest) != BINKP_OK ||
+        !digest_is(digest, "56be34521d144c88dbb8c733f0e8b3f6")) {
+        test_fail("Wrong digest for 0xdd data");
+        return;
+    }
+
+    memset(key, 0xaa, sizeof(key));
+    if (ftn_hmac_md5(key, sizeof(key), (const uint8_t*)large, strlen(large), digest) != BINKP_OK ||
+        !digest_is(digest, "6b1ab7fe4bd7bf8f0b62e6ce61b9d0cd")) {
+        test_fail("Wrong digest for a key longer than a block");
+        return;
+    }
+
+    test_pass();
+}
+
+int main(void) {
+    printf("CRAM Digest Tests\n");
+    printf("=================\n\n");
+
+    test_md5_vectors();
+    test_md5_streaming();
+    test_hmac_md5_vectors();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}
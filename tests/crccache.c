@@ -0,0 +1,232 @@
+/*
+ * test_crccache.c - Persistent file CRC cache tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ftn.h"
+#include "ftn/binkp/crc.h"
+#include "ftn/mailer.h"
+
+#define TEST_ROOT  "tmp/test_crccache"
+#define TEST_CACHE TEST_ROOT "/crc.cache"
+#define TEST_FILE1 TEST_ROOT "/bundle.su0"
+#define TEST_FILE2 TEST_ROOT "/nodediff.a01"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* Helper function to write a file */
+void write_test_file(const char* path, const char* content) {
+    FILE* fp;
+
+    fp = fopen(path, "wb");
+    if (fp) {
+        fputs(content, fp);
+        fclose(fp);
+    }
+}
+
+/* Helper function to start from an empty directory */
+void reset_test_dir(void) {
+    int status;
+
+    status = system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT);
+    (void)status;
+}
+
+void test_cached_crc(void) {
+    ftn_crc_cache_t* cache;
+    uint32_t expected, crc = 0;
+
+    test_start("CRC cache hit and miss");
+    reset_test_dir();
+    write_test_file(TEST_FILE1, "packet bundle contents");
+
+    cache = ftn_crc_cache_new(NULL);
+    if (!cache) {
+        test_fail("Failed to create cache");
+        return;
+    }
+
+    ftn_crc32_file(TEST_FILE1, &expected);
+    if (ftn_crc32_file_cached(cache, TEST_FILE1, &crc) != BINKP_OK || crc != expected ||
+        cache->misses != 1 || cache->hits != 0) {
+        test_fail("First lookup wrong");
+    } else if (ftn_crc32_file_cached(cache, TEST_FILE1, &crc) != BINKP_OK || crc != expected ||
+               cache->hits != 1) {
+        test_fail("Second lookup did not hit the cache");
+    } else {
+        /* A new version of the file must not reuse the old CRC */
+        write_test_file(TEST_FILE1, "a different, longer bundle");
+        ftn_crc32_file(TEST_FILE1, &expected);
+        if (ftn_crc32_file_cached(cache, TEST_FILE1, &crc) != BINKP_OK || crc != expected ||
+            cache->count != 1) {
+            test_fail("Changed file served a stale CRC");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_crc_cache_free(cache);
+}
+
+void test_persistence(void) {
+    ftn_crc_cache_t* first;
+    ftn_crc_cache_t* second;
+    ftn_crc_cache_t* reader;
+    uint32_t crc1, crc2, crc = 0;
+
+    test_start("CRC cache shared between processes");
+    reset_test_dir();
+    write_test_file(TEST_FILE1, "first file");
+    write_test_file(TEST_FILE2, "second file");
+
+    /* Two caches loaded before either saved, as two mailers would be */
+    first = ftn_crc_cache_new(TEST_CACHE);
+    second = ftn_crc_cache_new(TEST_CACHE);
+    if (!first || !second || ftn_crc_cache_load(first) != BINKP_OK ||
+        ftn_crc_cache_load(second) != BINKP_OK) {
+        test_fail("Failed to create caches");
+        ftn_crc_cache_free(first);
+        ftn_crc_cache_free(second);
+        return;
+    }
+
+    ftn_crc32_file_cached(first, TEST_FILE1, &crc1);
+    ftn_crc32_file_cached(second, TEST_FILE2, &crc2);
+    if (ftn_crc_cache_save(first) != BINKP_OK || ftn_crc_cache_save(second) != BINKP_OK) {
+        test_fail("Failed to save caches");
+        ftn_crc_cache_free(first);
+        ftn_crc_cache_free(second);
+        return;
+    }
+    ftn_crc_cache_free(first);
+    ftn_crc_cache_free(second);
+
+    reader = ftn_crc_cache_new(TEST_CACHE);
+    if (!reader || ftn_crc_cache_load(reader) != BINKP_OK) {
+        test_fail("Failed to load cache");
+    } else if (!ftn_crc_cache_lookup(reader, TEST_FILE1, &crc) || crc != crc1 ||
+               !ftn_crc_cache_lookup(reader, TEST_FILE2, &crc) || crc != crc2) {
+        test_fail("Saved entries lost");
+    } else {
+        test_pass();
+    }
+
+    ftn_crc_cache_free(reader);
+}
+
+void test_store(void) {
+    ftn_crc_cache_t* cache;
+    uint32_t expected, crc = 0;
+    const char* content = "streamed while sending";
+
+    test_start("CRC cache store after send");
+    reset_test_dir();
+    write_test_file(TEST_FILE1, content);
+
+    cache = ftn_crc_cache_new(NULL);
+    if (!cache) {
+        test_fail("Failed to create cache");
+        return;
+    }
+
+    expected = ftn_crc32_calculate((const uint8_t*)content, strlen(content));
+    if (ftn_crc_cache_store(cache, TEST_FILE1, expected) != BINKP_OK ||
+        !ftn_crc_cache_lookup(cache, TEST_FILE1, &crc) || crc != expected) {
+        test_fail("Stored CRC not found");
+    } else if (ftn_crc_cache_store(cache, TEST_ROOT "/missing", 0) != BINKP_ERROR_FILE_IO) {
+        test_fail("Stored CRC for missing file");
+    } else if (ftn_crc32_file_cached(cache, TEST_ROOT "/missing", &crc) != BINKP_ERROR_FILE_IO) {
+        test_fail("Missing file not reported as an I/O error");
+    } else {
+        test_pass();
+    }
+
+    ftn_crc_cache_free(cache);
+}
+
+void test_mailer_transfer(void) {
+    ftn_network_config_t config;
+    ftn_network_context_t net;
+    ftn_transfer_context_t transfer;
+    uint32_t expected, crc = 0;
+    const char* content = "sent to every link";
+    ftn_crc_cache_t* reloaded;
+
+    test_start("CRC cache hooked into mailer transfers");
+    reset_test_dir();
+    write_test_file(TEST_FILE1, content);
+    expected = ftn_crc32_calculate((const uint8_t*)content, strlen(content));
+
+    memset(&config, 0, sizeof(config));
+    config.section_name = "test";
+    config.crc_cache = TEST_CACHE;
+    config.use_crc = 1;
+    memset(&net, 0, sizeof(net));
+    net.config = &config;
+    ftn_transfer_context_init(&transfer);
+
+    if (ftn_mailer_setup_transfer(&net, &transfer) != FTN_OK || !transfer.crc_cache ||
+        transfer.crc_cache != net.crc_cache || !transfer.use_crc) {
+        test_fail("Transfer context has no CRC cache");
+    } else if (ftn_crc32_file_cached(transfer.crc_cache, TEST_FILE1, &crc) != BINKP_OK || crc != expected) {
+        test_fail("Wrong CRC");
+    } else if (ftn_mailer_setup_transfer(&net, &transfer) != FTN_OK) {
+        test_fail("Second session setup failed");
+    } else {
+        /* The next session saved what the first one learned */
+        reloaded = ftn_crc_cache_new(TEST_CACHE);
+        crc = 0;
+        if (!reloaded || ftn_crc_cache_load(reloaded) != BINKP_OK ||
+            !ftn_crc_cache_lookup(reloaded, TEST_FILE1, &crc) || crc != expected) {
+            test_fail("CRC cache not saved between sessions");
+        } else {
+            test_pass();
+        }
+        ftn_crc_cache_free(reloaded);
+    }
+
+    ftn_transfer_context_free(&transfer);
+    ftn_crc_cache_free(net.crc_cache);
+}
+
+int main(void) {
+    printf("CRC Cache Tests\n");
+    printf("===============\n\n");
+
+    test_cached_crc();
+    test_persistence();
+    test_store();
+    test_mailer_transfer();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}
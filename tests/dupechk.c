@@ -12,6 +12,7 @@
 
 #include "ftn.h"
 #include "ftn/dupechk.h"
+#include "ftn/intern.h"
 #include "ftn/packet.h"
 
 static int tests_run = 0;
@@ -50,6 +51,24 @@ ftn_message_t* create_test_message_with_msgid(const char* msgid) {
     return msg;
 }
 
+/* Helper function to create an echomail message without MSGID */
+ftn_message_t* create_test_echomail_area(const char* area) {
+    ftn_message_t* msg = ftn_message_new(FTN_MSG_ECHOMAIL);
+
+    if (!msg) return NULL;
+
+    msg->area = malloc(strlen(area) + 1);
+    msg->text = malloc(16);
+    if (!msg->area || !msg->text) {
+        ftn_message_free(msg);
+        return NULL;
+    }
+    strcpy(msg->area, area);
+    strcpy(msg->text, "Same body");
+
+    return msg;
+}
+
 /* Test MSGID extraction */
 void test_msgid_extraction_basic(void) {
     ftn_message_t* msg;
@@ -652,6 +671,261 @@ void test_performance_large_dataset(void) {
     test_pass();
 }
 
+/* Test hashed keys, including messages without a MSGID */
+void test_hashed_add_and_find(void) {
+    ftn_dupecheck_t* dupecheck;
+    ftn_message_t* msg1 = NULL;
+    ftn_message_t* msg2 = NULL;
+    ftn_message_t* plain1 = NULL;
+    ftn_message_t* plain2 = NULL;
+    ftn_dupecheck_stats_t stats;
+    int dupe1 = 0, dupe2 = 0, dupe3 = 0, dupe4 = 0;
+
+    test_start("hashed keys add and find");
+
+    dupecheck = ftn_dupecheck_new("tmp/test_dupecheck_hashed.db");
+    if (!dupecheck || ftn_dupecheck_set_hashed(dupecheck, 1) != FTN_OK) {
+        test_fail("Failed to create hashed dupecheck");
+        ftn_dupecheck_free(dupecheck);
+        return;
+    }
+
+    msg1 = create_test_message_with_msgid("1:2/3@fidonet  HASH1");
+    msg2 = create_test_message_with_msgid("1:2/3@fidonet hash2");
+    plain1 = ftn_message_new(FTN_MSG_NETMAIL);
+    plain2 = ftn_message_new(FTN_MSG_NETMAIL);
+    if (!msg1 || !msg2 || !plain1 || !plain2) {
+        test_fail("Failed to create test messages");
+        goto cleanup;
+    }
+    plain1->text = malloc(16);
+    plain2->text = malloc(16);
+    if (!plain1->text || !plain2->text) {
+        test_fail("Failed to create test messages");
+        goto cleanup;
+    }
+    strcpy(plain1->text, "Same header");
+    strcpy(plain2->text, "Other body");
+
+    ftn_dupecheck_add_message(dupecheck, msg1);
+    ftn_dupecheck_add_message(dupecheck, plain1);
+
+    /* Re-check msg1 with a differently spaced and cased MSGID */
+    ftn_message_free(msg1);
+    msg1 = create_test_message_with_msgid("1:2/3@fidonet hash1");
+
+    ftn_dupecheck_is_duplicate(dupecheck, msg1, &dupe1);
+    ftn_dupecheck_is_duplicate(dupecheck, msg2, &dupe2);
+    ftn_dupecheck_is_duplicate(dupecheck, plain1, &dupe3);
+    ftn_dupecheck_is_duplicate(dupecheck, plain2, &dupe4);
+
+    if (!msg1 || !dupe1 || dupe2) {
+        test_fail("MSGID keys not matched correctly");
+    } else if (!dupe3 || dupe4) {
+        test_fail("Content keys not matched correctly");
+    } else if (ftn_dupecheck_get_stats(dupecheck, &stats) != FTN_OK || stats.total_entries != 2) {
+        test_fail("Database should contain 2 keys");
+    } else if (ftn_dupecheck_set_hashed(dupecheck, 0) == FTN_OK) {
+        test_fail("Hashed database should not switch back");
+    } else {
+        test_pass();
+    }
+
+cleanup:
+    ftn_message_free(msg1);
+    ftn_message_free(msg2);
+    ftn_message_free(plain1);
+    ftn_message_free(plain2);
+    ftn_dupecheck_free(dupecheck);
+}
+
+/* Test a string database converted to hashed keys, then saved and reloaded */
+void test_hashed_convert_save_load(void) {
+    ftn_dupecheck_t* dupecheck = NULL;
+    ftn_message_t* msgs[100];
+    char msgid[64];
+    int is_dupe;
+    int found = 0;
+    int i;
+    FILE* fp;
+    char line[128];
+
+    test_start("hashed database conversion, save and load");
+
+    for (i = 0; i < 100; i++) {
+        snprintf(msgid, sizeof(msgid), "1:2/3@fidonet conv%d", i);
+        msgs[i] = create_test_message_with_msgid(msgid);
+    }
+
+    /* Half of them in a string database */
+    dupecheck = ftn_dupecheck_new("tmp/test_dupecheck_convert.db");
+    if (dupecheck) {
+        for (i = 0; i < 50; i++) ftn_dupecheck_add_message(dupecheck, msgs[i]);
+        ftn_dupecheck_save(dupecheck);
+        ftn_dupecheck_free(dupecheck);
+    }
+
+    /* Loaded hashed, the rest added, then saved */
+    dupecheck = ftn_dupecheck_new("tmp/test_dupecheck_convert.db");
+    if (dupecheck && ftn_dupecheck_set_hashed(dupecheck, 1) == FTN_OK &&
+        ftn_dupecheck_load(dupecheck) == FTN_OK) {
+        for (i = 50; i < 100; i++) ftn_dupecheck_add_message(dupecheck, msgs[i]);
+        ftn_dupecheck_save(dupecheck);
+    }
+    ftn_dupecheck_free(dupecheck);
+
+    /* A plain dupecheck picks up hashed mode from the file */
+    dupecheck = ftn_dupecheck_new("tmp/test_dupecheck_convert.db");
+    if (dupecheck && ftn_dupecheck_load(dupecheck) == FTN_OK) {
+        for (i = 0; i < 100; i++) {
+            if (msgs[i] && ftn_dupecheck_is_duplicate(dupecheck, msgs[i], &is_dupe) == FTN_OK && is_dupe) {
+                found++;
+            }
+        }
+    }
+
+    line[0] = '\0';
+    fp = fopen("tmp/test_dupecheck_convert.db", "r");
+    if (fp) {
+        if (!fgets(line, sizeof(line), fp)) line[0] = '\0';
+        fclose(fp);
+    }
+
+    if (found != 100) {
+        test_fail("Not every message was found after reload");
+    } else if (strncmp(line, "# libFTN Hashed", 15) != 0) {
+        test_fail("Database was not saved hashed");
+    } else {
+        test_pass();
+    }
+
+    for (i = 0; i < 100; i++) ftn_message_free(msgs[i]);
+    ftn_dupecheck_free(dupecheck);
+    unlink("tmp/test_dupecheck_convert.db");
+}
+
+/* Test cleanup of hashed keys by day */
+void test_hashed_cleanup(void) {
+    ftn_dupecheck_t* dupecheck;
+    ftn_dupecheck_db_t* db;
+    ftn_dupecheck_key_t key;
+    ftn_message_t* msg;
+    int is_dupe = 0;
+    time_t now;
+
+    test_start("hashed database cleanup");
+
+    dupecheck = ftn_dupecheck_new("tmp/test_dupecheck_hclean.db");
+    msg = create_test_message_with_msgid("1:2/3@fidonet fresh");
+    if (!dupecheck || !msg || ftn_dupecheck_set_hashed(dupecheck, 1) != FTN_OK) {
+        test_fail("Failed to set up test");
+        ftn_message_free(msg);
+        ftn_dupecheck_free(dupecheck);
+        return;
+    }
+    db = (ftn_dupecheck_db_t*)dupecheck->db_handle;
+
+    /* One key seen ten days ago */
+    time(&now);
+    memset(&key, 0, sizeof(key));
+    key.key[0] = 0x12345678;
+    key.day = (uint32_t)(now / 86400) - 10;
+    ftn_dupecheck_db_add_key(db, &key);
+    ftn_dupecheck_add_message(dupecheck, msg);
+
+    ftn_dupecheck_cleanup_old(dupecheck, now - 5 * 86400);
+    ftn_dupecheck_is_duplicate(dupecheck, msg, &is_dupe);
+
+    if (ftn_dupecheck_db_find_key(db, &key) >= 0) {
+        test_fail("Old key was not removed");
+    } else if (!is_dupe || db->key_count != 1) {
+        test_fail("Recent key was removed");
+    } else {
+        test_pass();
+    }
+
+    ftn_message_free(msg);
+    ftn_dupecheck_free(dupecheck);
+}
+
+/* Content keys treat area tags case-insensitively */
+void test_content_key_area_case(void) {
+    ftn_message_t* upper;
+    ftn_message_t* lower;
+    ftn_message_t* other;
+    ftn_dupecheck_key_t k1, k2, k3;
+
+    test_start("content key area case");
+
+    upper = create_test_echomail_area("FIDO.TEST");
+    lower = create_test_echomail_area("fido.test");
+    other = create_test_echomail_area("FIDO.OTHER");
+    if (!upper || !lower || !other) {
+        test_fail("Failed to create test messages");
+    } else if (ftn_dupecheck_message_key(upper, &k1) != FTN_OK ||
+               ftn_dupecheck_message_key(lower, &k2) != FTN_OK ||
+               ftn_dupecheck_message_key(other, &k3) != FTN_OK) {
+        test_fail("Failed to build content keys");
+    } else if (memcmp(k1.key, k2.key, sizeof(k1.key)) != 0) {
+        test_fail("Area case changed the key");
+    } else if (memcmp(k1.key, k3.key, sizeof(k1.key)) == 0) {
+        test_fail("Different areas share a key");
+    } else {
+        test_pass();
+    }
+
+    ftn_message_free(upper);
+    ftn_message_free(lower);
+    ftn_message_free(other);
+}
+
+/* Content keys ignore the packet addresses of echomail, not of netmail */
+void test_content_key_links(void) {
+    ftn_message_t* first;
+    ftn_message_t* second;
+    ftn_dupecheck_key_t k1, k2, k3, k4;
+
+    test_start("content key across links");
+
+    first = create_test_echomail_area("FIDO.TEST");
+    second = create_test_echomail_area("FIDO.TEST");
+    if (!first || !second) {
+        test_fail("Failed to create test messages");
+    } else {
+        first->orig_addr.zone = 1;
+        first->orig_addr.net = 2;
+        first->orig_addr.node = 3;
+        first->dest_addr.node = 1;
+        second->orig_addr.zone = 1;
+        second->orig_addr.net = 4;
+        second->orig_addr.node = 5;
+        second->dest_addr.node = 2;
+        if (ftn_dupecheck_message_key(first, &k1) != FTN_OK ||
+            ftn_dupecheck_message_key(second, &k2) != FTN_OK) {
+            test_fail("Failed to build echomail keys");
+        } else if (memcmp(k1.key, k2.key, sizeof(k1.key)) != 0) {
+            test_fail("Echomail copies from two links differ");
+        } else {
+            /* The same two messages as netmail */
+            free(first->area);
+            free(second->area);
+            first->area = NULL;
+            second->area = NULL;
+            if (ftn_dupecheck_message_key(first, &k3) != FTN_OK ||
+                ftn_dupecheck_message_key(second, &k4) != FTN_OK) {
+                test_fail("Failed to build netmail keys");
+            } else if (memcmp(k3.key, k4.key, sizeof(k3.key)) == 0) {
+                test_fail("Netmail between other nodes shares a key");
+            } else {
+                test_pass();
+            }
+        }
+    }
+
+    ftn_message_free(first);
+    ftn_message_free(second);
+}
+
 int main(void) {
     printf("Duplicate Detection System Tests\n");
     printf("================================\n\n");
@@ -673,12 +947,21 @@ int main(void) {
     test_database_cleanup_old();
     test_database_statistics();
 
+    /* Hashed key tests */
+    test_hashed_add_and_find();
+    test_hashed_convert_save_load();
+    test_hashed_cleanup();
+    test_content_key_area_case();
+    test_content_key_links();
+
     /* Error condition tests */
     test_error_conditions();
 
     /* Performance tests */
     test_performance_large_dataset();
 
+    ftn_intern_cleanup();
+
     printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
 
     if (tests_passed == tests_run) {
@@ -0,0 +1,533 @@
+/*
+ * test_fnd.c - FTN daemon integration tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/compat.h"
+#include "ftn/net.h"
+#include "ftn/packet.h"
+
+#define TEST_ROOT   "tmp/test_fnd"
+#define TEST_OUTPUT TEST_ROOT "/output"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+/* The daemon changes to /, so every path it reads is absolute */
+static char root[512];
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+static int file_exists(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+static void root_path(char* path, size_t size, const char* name) {
+    snprintf(path, size, "%s/%s", root, name);
+}
+
+int run_fnd_command(const char* args, char* output, size_t output_size) {
+    char command[1024];
+    int status;
+
+    snprintf(command, sizeof(command), "./bin/fnd %s > " TEST_OUTPUT " 2>&1", args);
+
+    status = system(command);
+
+    if (output && output_size > 0) {
+        FILE* fp = fopen(TEST_OUTPUT, "r");
+        if (fp) {
+            size_t bytes_read = fread(output, 1, output_size - 1, fp);
+            output[bytes_read] = '\0';
+            fclose(fp);
+        } else {
+            output[0] = '\0';
+        }
+    }
+
+    return WEXITSTATUS(status);
+}
+
+/* Write the test config, sending processed packets to the named directory */
+static int write_config(const char* processed) {
+    char path[600];
+    FILE* fp;
+
+    root_path(path, sizeof(path), "ftn.ini");
+    fp = fopen(path, "w");
+    if (!fp) {
+        return 0;
+    }
+    fprintf(fp,
+            "[node]\n"
+            "name = Test Node\n"
+            "networks = testnet\n"
+            "sysop = testuser\n"
+            "sysop_name = Test User\n"
+            "\n"
+            "[daemon]\n"
+            "pid_file = %s/fnd.pid\n"
+            "sleep_interval = 1\n"
+            "\n"
+            "[logging]\n"
+            "log_file = %s/fnd.log\n"
+            "\n"
+            "[news]\n"
+            "path = %s/news\n"
+            "\n"
+            "[mail]\n"
+            "inbox = %s/mail/%%USER%%\n"
+            "\n"
+            "[testnet]\n"
+            "name = TestNet\n"
+            "domain = test.example.com\n"
+            "address = 99:1/1.0\n"
+            "hub = 99:1/0\n"
+            "inbox = %s/inbox\n"
+            "outbox = %s/outbox\n"
+            "processed = %s/%s\n"
+            "bad = %s/bad\n"
+            "duplicate_db = %s/dupes.db\n",
+            root, root, root, root, root, root, root, processed, root, root);
+    fclose(fp);
+    return 1;
+}
+
+/* A mailer config with two networks whose hubs both answer on one port */
+static int write_mailer_config(int port) {
+    char path[600];
+    FILE* fp;
+    int i;
+
+    root_path(path, sizeof(path), "mailer.ini");
+    fp = fopen(path, "w");
+    if (!fp) {
+        return 0;
+    }
+    fprintf(fp,
+            "[node]\n"
+            "name = Test Node\n"
+            "networks = net1,net2\n"
+            "sysop = testuser\n"
+            "sysop_name = Test User\n"
+            "\n"
+            "[daemon]\n"
+            "pid_file = %s/mailer.pid\n"
+            "sleep_interval = 1\n"
+            "max_connections = 4\n",
+            root);
+    for (i = 1; i <= 2; i++) {
+        fprintf(fp,
+                "\n"
+                "[net%d]\n"
+                "name = Net%d\n"
+                "domain = net%d.example.com\n"
+                "address = 9%d:1/1.0\n"
+                "hub = 9%d:1/0\n"
+                "hub_hostname = 127.0.0.1\n"
+                "hub_port = %d\n"
+                "inbox = %s/inbox\n"
+                "outbox = %s/outbox\n"
+                "outbound_path = %s/outbox\n",
+                i, i, i, i, i, port, root, root, root);
+    }
+    fclose(fp);
+    return 1;
+}
+
+/* Replace the test config with one that does not validate */
+static int write_broken_config(void) {
+    char path[600];
+    FILE* fp;
+
+    root_path(path, sizeof(path), "ftn.ini");
+    fp = fopen(path, "w");
+    if (!fp) {
+        return 0;
+    }
+    fprintf(fp, "[node]\nname = Test Node\n");
+    fclose(fp);
+    return 1;
+}
+
+static int setup_root(void) {
+    int status;
+
+    status = system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT "/inbox " TEST_ROOT "/processed "
+                    TEST_ROOT "/reloaded " TEST_ROOT "/outbox " TEST_ROOT "/bad " TEST_ROOT "/news " TEST_ROOT "/mail");
+    if (status != 0 || !getcwd(root, sizeof(root) - 64)) {
+        return 0;
+    }
+    strcat(root, "/" TEST_ROOT);
+    return write_config("processed");
+}
+
+/* Drop a packet with one echomail message from the hub into the inbox */
+static int write_packet(const char* name) {
+    ftn_packet_t* packet;
+    ftn_message_t* msg;
+    ftn_address_t hub = {99, 1, 0, 0};
+    ftn_address_t node = {99, 1, 1, 0};
+    char path[600];
+    char msgid[64];
+    int ok;
+
+    packet = ftn_packet_new();
+    msg = ftn_message_new(FTN_MSG_ECHOMAIL);
+    if (!packet || !msg) {
+        ftn_packet_free(packet);
+        ftn_message_free(msg);
+        return 0;
+    }
+
+    packet->header.orig_zone = hub.zone;
+    packet->header.orig_net = hub.net;
+    packet->header.orig_node = hub.node;
+    packet->header.dest_zone = node.zone;
+    packet->header.dest_net = node.net;
+    packet->header.dest_node = node.node;
+
+    sprintf(msgid, "99:1/0 %.8s", name);
+    msg->orig_addr = hub;
+    msg->dest_addr = node;
+    msg->from_user = strdup("Hub Sysop");
+    msg->to_user = strdup("All");
+    msg->subject = strdup("Daemon test");
+    msg->text = strdup("Hello from the hub.\r\n");
+    msg->area = strdup("TESTAREA");
+    msg->msgid = strdup(msgid);
+    msg->timestamp = time(NULL);
+    ftn_packet_add_message(packet, msg);
+
+    /* Written under another name, so the daemon never sees half a packet */
+    snprintf(path, sizeof(path), "%s/%s.tmp", root, name);
+    ok = ftn_packet_save(path, packet) == FTN_OK;
+    ftn_packet_free(packet);
+    if (ok) {
+        char final[600];
+        snprintf(final, sizeof(final), "%s/inbox/%s.pkt", root, name);
+        ok = rename(path, final) == 0;
+    }
+    return ok;
+}
+
+static void pause_briefly(void) {
+    struct timespec delay;
+
+    delay.tv_sec = 0;
+    delay.tv_nsec = 100000000L;
+    nanosleep(&delay, NULL);
+}
+
+/* Wait up to ten seconds for a file to appear */
+static int wait_for_file(const char* path) {
+    int i;
+
+    for (i = 0; i < 100; i++) {
+        if (file_exists(path)) {
+            return 1;
+        }
+        pause_briefly();
+    }
+    return 0;
+}
+
+static int wait_for_exit(pid_t pid) {
+    int i;
+
+    for (i = 0; i < 100; i++) {
+        if (kill(pid, 0) != 0) {
+            return 1;
+        }
+        pause_briefly();
+    }
+    return 0;
+}
+
+static pid_t read_pid(const char* path) {
+    FILE* fp;
+    long pid = 0;
+
+    fp = fopen(path, "r");
+    if (!fp) {
+        return 0;
+    }
+    if (fscanf(fp, "%ld", &pid) != 1) {
+        pid = 0;
+    }
+    fclose(fp);
+    return (pid_t)pid;
+}
+
+/* Wait up to ten seconds for the daemon named in a PID file to be running.
+   The daemon forks after the command returns, so the file may not be
+   there yet, or may still name a process that has gone. */
+static pid_t wait_for_pid(const char* path) {
+    pid_t pid;
+    int i;
+
+    for (i = 0; i < 100; i++) {
+        pid = read_pid(path);
+        if (pid > 0 && kill(pid, 0) == 0) {
+            return pid;
+        }
+        pause_briefly();
+    }
+    return 0;
+}
+
+/* Wait up to ten seconds for the daemon to log a line containing text */
+static int wait_for_log(const char* text) {
+    char path[600];
+    char line[1024];
+    FILE* fp;
+    int i;
+
+    root_path(path, sizeof(path), "fnd.log");
+    for (i = 0; i < 100; i++) {
+        fp = fopen(path, "r");
+        if (fp) {
+            while (fgets(line, sizeof(line), fp)) {
+                if (strstr(line, text)) {
+                    fclose(fp);
+                    return 1;
+                }
+            }
+            fclose(fp);
+        }
+        pause_briefly();
+    }
+    return 0;
+}
+
+void test_help_option(void) {
+    char output[2048];
+    int exit_code;
+
+    test_start("help option");
+
+    exit_code = run_fnd_command("--help", output, sizeof(output));
+
+    if (exit_code == 0 && strstr(output, "Usage:") != NULL && strstr(output, "--modules") != NULL) {
+        test_pass();
+    } else {
+        test_fail("Help option did not work correctly");
+    }
+}
+
+void test_option_errors(void) {
+    char output[2048];
+    char args[700];
+
+    test_start("option errors");
+
+    snprintf(args, sizeof(args), "-c %s/ftn.ini -m nosuchmodule", root);
+
+    if (run_fnd_command("", output, sizeof(output)) == 0 ||
+        strstr(output, "Configuration file is required") == NULL) {
+        test_fail("Missing config not reported");
+    } else if (run_fnd_command("-c /nonexistent/config.ini", output, sizeof(output)) == 0) {
+        test_fail("Unreadable config accepted");
+    } else if (run_fnd_command(args, output, sizeof(output)) == 0) {
+        test_fail("Unknown module accepted");
+    } else {
+        test_pass();
+    }
+}
+
+void test_single_shot(void) {
+    char args[700];
+    char processed[600];
+
+    test_start("single-shot toss");
+
+    snprintf(args, sizeof(args), "-c %s/ftn.ini -m tosser", root);
+    root_path(processed, sizeof(processed), "processed/00000001.pkt");
+
+    if (!write_packet("00000001")) {
+        test_fail("Could not write packet");
+    } else if (run_fnd_command(args, NULL, 0) != 0) {
+        test_fail("Daemon pass failed");
+    } else if (!file_exists(processed)) {
+        test_fail("Packet not tossed");
+    } else {
+        test_pass();
+    }
+}
+
+void test_daemon_reload(void) {
+    char args[700];
+    char path[600];
+    pid_t pid;
+
+    test_start("daemon tosses across reloads");
+
+    snprintf(args, sizeof(args), "-c %s/ftn.ini -m tosser,scanner -d", root);
+    root_path(path, sizeof(path), "fnd.pid");
+
+    if (run_fnd_command(args, NULL, 0) != 0 || (pid = wait_for_pid(path)) <= 0) {
+        test_fail("Daemon did not start");
+        return;
+    }
+
+    root_path(path, sizeof(path), "processed/00000002.pkt");
+    if (!write_packet("00000002") || !wait_for_file(path)) {
+        test_fail("Daemon did not toss");
+        kill(pid, SIGTERM);
+        return;
+    }
+
+    /* A config that does not load leaves the running state alone */
+    root_path(path, sizeof(path), "processed/00000003.pkt");
+    if (!write_broken_config() || kill(pid, SIGHUP) != 0) {
+        test_fail("Could not request reload");
+        kill(pid, SIGTERM);
+        return;
+    }
+    if (!wait_for_log("Failed to reload configuration")) {
+        test_fail("Bad reload not reported");
+        kill(pid, SIGTERM);
+        return;
+    }
+    if (kill(pid, 0) != 0) {
+        test_fail("Daemon exited on a bad reload");
+        return;
+    }
+    if (!write_packet("00000003") || !wait_for_file(path)) {
+        test_fail("Daemon stopped tossing after a bad reload");
+        kill(pid, SIGTERM);
+        return;
+    }
+
+    /* A good config takes effect */
+    root_path(path, sizeof(path), "reloaded/00000004.pkt");
+    if (!write_config("reloaded") || kill(pid, SIGHUP) != 0) {
+        test_fail("Could not request reload");
+        kill(pid, SIGTERM);
+        return;
+    }
+    if (!wait_for_log("Configuration reloaded successfully")) {
+        test_fail("Good reload not reported");
+        kill(pid, SIGTERM);
+        return;
+    }
+    if (!write_packet("00000004") || !wait_for_file(path)) {
+        test_fail("Reloaded config not used");
+        kill(pid, SIGTERM);
+        return;
+    }
+
+    root_path(path, sizeof(path), "fnd.pid");
+    if (kill(pid, SIGTERM) != 0 || !wait_for_exit(pid)) {
+        test_fail("Daemon did not stop");
+    } else if (file_exists(path)) {
+        test_fail("PID file left behind");
+    } else {
+        test_pass();
+    }
+}
+
+/* With more than one worker, uplinks are polled from a thread pool that
+   must be started in the daemon, not in the process that forks it */
+void test_daemon_polls_uplinks(void) {
+    ftn_net_server_t* server;
+    ftn_net_connection_t* conn[2];
+    char args[700];
+    char path[600];
+    int port = 40000 + (int)(getpid() % 10000);
+    pid_t pid;
+    int accepted = 0;
+    int polled;
+
+    test_start("daemon polls two uplinks at once");
+
+    snprintf(args, sizeof(args), "-c %s/mailer.ini -m mailer -d", root);
+    root_path(path, sizeof(path), "mailer.pid");
+
+    server = ftn_net_listen(port, "127.0.0.1", 4);
+    if (!server || !write_mailer_config(port)) {
+        test_fail("Could not set up the hubs");
+        ftn_net_server_free(server);
+        return;
+    }
+    if (run_fnd_command(args, NULL, 0) != 0 || (pid = wait_for_pid(path)) <= 0) {
+        test_fail("Daemon did not start");
+        ftn_net_server_free(server);
+        return;
+    }
+
+    while (accepted < 2 && (conn[accepted] = ftn_net_accept(server, 10000)) != NULL) {
+        accepted++;
+    }
+    polled = accepted;
+    while (accepted > 0) {
+        ftn_net_connection_free(conn[--accepted]);
+    }
+    ftn_net_server_free(server);
+
+    if (polled < 2) {
+        test_fail("Uplinks were not polled");
+        kill(pid, SIGKILL);
+    } else if (kill(pid, SIGTERM) != 0 || !wait_for_exit(pid)) {
+        test_fail("Daemon hung polling its uplinks");
+        kill(pid, SIGKILL);
+    } else if (file_exists(path)) {
+        test_fail("PID file left behind");
+    } else {
+        test_pass();
+    }
+}
+
+int main(void) {
+    printf("FTN Daemon Tests\n");
+    printf("================\n\n");
+
+    if (!setup_root()) {
+        printf("Could not set up %s\n", TEST_ROOT);
+        return 1;
+    }
+
+    test_help_option();
+    test_option_errors();
+    test_single_shot();
+    test_daemon_reload();
+    test_daemon_polls_uplinks();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}
@@ -0,0 +1,281 @@
+/*
+ * test_freq.c - File request index and responder tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/freq.h"
+#include "ftn/transfer.h"
+
+#define TEST_ROOT     "tmp/test_freq"
+#define TEST_AREA     TEST_ROOT "/files"
+#define TEST_INDEX    TEST_ROOT "/freq.idx"
+#define TEST_OUTBOUND TEST_ROOT "/outbound"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* Helper function to create a small file */
+void write_test_file(const char* path) {
+    FILE* fp;
+
+    fp = fopen(path, "w");
+    if (fp) {
+        fputs("data\n", fp);
+        fclose(fp);
+    }
+}
+
+/* Helper function to make a directory look unchanged for a while */
+void age_directory(const char* path) {
+    struct utimbuf times;
+
+    times.actime = time(NULL) - 100;
+    times.modtime = times.actime;
+    utime(path, &times);
+}
+
+/* Helper function to build a fresh file area */
+void create_test_area(void) {
+    int status;
+
+    status = system("rm -rf " TEST_ROOT " && mkdir -p " TEST_AREA);
+    (void)status;
+
+    write_test_file(TEST_AREA "/NODELIST.A01");
+    write_test_file(TEST_AREA "/nodediff.a08");
+    write_test_file(TEST_AREA "/nodediff.a15");
+    write_test_file(TEST_AREA "/readme.txt");
+    age_directory(TEST_AREA);
+}
+
+void test_resolve(void) {
+    ftn_freq_index_t* index;
+    const ftn_freq_file_t* results[8];
+    size_t rescanned = 0;
+
+    test_start("FREQ index resolve");
+    create_test_area();
+
+    index = ftn_freq_index_new(NULL);
+    if (!index || ftn_freq_index_add_dir(index, TEST_AREA "/") != FTN_OK ||
+        ftn_freq_index_add_magic(index, "NODELIST", TEST_AREA "/NODELIST.A01") != FTN_OK) {
+        test_fail("Failed to create index");
+        ftn_freq_index_free(index);
+        return;
+    }
+
+    if (ftn_freq_index_update(index, &rescanned) != FTN_OK || rescanned != 1 ||
+        index->file_count != 4) {
+        test_fail("Directory not indexed");
+    } else if (ftn_freq_resolve(index, "README.TXT", results, 8) != 1 ||
+               strcmp(results[0]->path, TEST_AREA "/readme.txt") != 0) {
+        test_fail("Exact name not resolved");
+    } else if (ftn_freq_resolve(index, "nodediff.*", results, 8) != 2) {
+        test_fail("Wildcard not resolved");
+    } else if (ftn_freq_resolve(index, "nodediff.*", results, 1) != 1) {
+        test_fail("Result limit ignored");
+    } else if (ftn_freq_resolve(index, "nodelist", results, 8) != 1 ||
+               strcmp(results[0]->path, TEST_AREA "/NODELIST.A01") != 0) {
+        test_fail("Magic name not resolved");
+    } else if (ftn_freq_resolve(index, "missing.zip", results, 8) != 0) {
+        test_fail("Missing file resolved");
+    } else {
+        test_pass();
+    }
+
+    ftn_freq_index_free(index);
+}
+
+void test_incremental_update(void) {
+    ftn_freq_index_t* index;
+    const ftn_freq_file_t* results[8];
+    size_t rescanned = 99;
+
+    test_start("FREQ index persistence and incremental update");
+    create_test_area();
+
+    index = ftn_freq_index_new(TEST_INDEX);
+    if (!index) {
+        test_fail("Failed to create index");
+        return;
+    }
+    ftn_freq_index_add_dir(index, TEST_AREA);
+    ftn_freq_index_update(index, NULL);
+    if (ftn_freq_index_save(index) != FTN_OK) {
+        test_fail("Failed to save index");
+        ftn_freq_index_free(index);
+        return;
+    }
+    ftn_freq_index_free(index);
+
+    /* A reloaded index of an unchanged directory needs no scan */
+    index = ftn_freq_index_new(TEST_INDEX);
+    ftn_freq_index_add_dir(index, TEST_AREA);
+    if (ftn_freq_index_load(index) != FTN_OK || index->file_count != 4 ||
+        ftn_freq_index_update(index, &rescanned) != FTN_OK || rescanned != 0) {
+        test_fail("Unchanged directory rescanned");
+        ftn_freq_index_free(index);
+        return;
+    }
+
+    /* Adding a file changes the directory mtime and triggers a rescan */
+    write_test_file(TEST_AREA "/newfile.zip");
+    if (ftn_freq_index_update(index, &rescanned) != FTN_OK || rescanned != 1 ||
+        ftn_freq_resolve(index, "NEWFILE.ZIP", results, 8) != 1) {
+        test_fail("Changed directory not rescanned");
+    } else {
+        test_pass();
+    }
+
+    ftn_freq_index_free(index);
+}
+
+void test_process_request(void) {
+    ftn_freq_index_t* index;
+    ftn_address_t requester;
+    size_t queued = 0;
+    FILE* fp;
+    char line[256];
+    int lines = 0;
+
+    test_start("FREQ request processing");
+    create_test_area();
+
+    index = ftn_freq_index_new(NULL);
+    ftn_freq_index_add_dir(index, TEST_AREA);
+    ftn_freq_index_update(index, NULL);
+
+    fp = fopen(TEST_ROOT "/00020003.req", "w");
+    if (!fp) {
+        test_fail("Failed to write request");
+        ftn_freq_index_free(index);
+        return;
+    }
+    fprintf(fp, "NODEDIFF.A* !secret\r\nmissing.zip\r\nREADME.TXT +1700000000\r\n");
+    fclose(fp);
+
+    ftn_address_parse("1:2/3", &requester);
+    if (ftn_freq_process_request(index, TEST_ROOT "/00020003.req", TEST_OUTBOUND,
+                                 &requester, 2, &queued) != FTN_OK || queued != 2) {
+        test_fail("Request not processed within limit");
+        ftn_freq_index_free(index);
+        return;
+    }
+
+    fp = fopen(TEST_OUTBOUND "/h00020003.flo", "r");
+    if (!fp) {
+        test_fail("Hold flow file not written");
+    } else {
+        while (fgets(line, sizeof(line), fp)) {
+            if (strncmp(line, TEST_AREA "/nodediff.a", strlen(TEST_AREA "/nodediff.a")) == 0) {
+                lines++;
+            }
+        }
+        fclose(fp);
+        if (lines != 2) {
+            test_fail("Wrong files queued");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_freq_index_free(index);
+}
+
+/* Receive a .req in a session and check how it is answered */
+static size_t receive_request(ftn_transfer_context_t* ctx, const char* name) {
+    const char* request = "NODEDIFF.A*\r\nREADME.TXT\r\n";
+
+    if (ftn_transfer_receive_file_header(ctx, name, strlen(request), time(NULL), 0) != BSO_OK ||
+        ftn_transfer_receive_file_data(ctx, request, strlen(request)) != BSO_OK ||
+        ftn_transfer_complete_receive(ctx) != BSO_OK) {
+        return (size_t)-1;
+    }
+    return ctx->pending_count;
+}
+
+void test_session_request(void) {
+    ftn_freq_index_t* index;
+    ftn_transfer_context_t ctx;
+    ftn_binkp_session_t session;
+    struct stat st;
+
+    test_start("FREQ answered inside the session");
+    create_test_area();
+
+    index = ftn_freq_index_new(NULL);
+    ftn_freq_index_add_dir(index, TEST_AREA);
+    ftn_freq_index_update(index, NULL);
+
+    /* The .req is named after us, not after the node asking */
+    ftn_transfer_context_init(&ctx);
+    ftn_transfer_context_set_freq(&ctx, index, 2);
+    memset(&session, 0, sizeof(session));
+    ctx.session = &session;
+
+    if (receive_request(&ctx, "00010001.req") != 0) {
+        test_fail("Request answered for an unauthenticated session");
+    } else {
+        session.authenticated = 1;
+        if (receive_request(&ctx, "00010001.req") != 2 || ctx.requests_answered != 1) {
+            test_fail("Requested files not added to the send queue");
+        } else if (strncmp(ctx.pending_files[0]->filename, TEST_AREA "/nodediff.a",
+                           strlen(TEST_AREA "/nodediff.a")) != 0) {
+            test_fail("Wrong file queued");
+        } else if (stat("00010001.req", &st) == 0 || stat("00010001.req.tmp", &st) == 0) {
+            test_fail("Request file left behind");
+        } else if (stat(TEST_OUTBOUND "/h00010001.flo", &st) == 0) {
+            test_fail("Request answered through the outbound");
+        } else {
+            test_pass();
+        }
+    }
+
+    ctx.session = NULL;
+    ftn_transfer_context_free(&ctx);
+    ftn_freq_index_free(index);
+}
+
+int main(void) {
+    printf("File Request Tests\n");
+    printf("==================\n\n");
+
+    test_resolve();
+    test_incremental_update();
+    test_process_request();
+    test_session_request();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}
@@ -0,0 +1,318 @@
+/*
+ * test_inbound.c - Inbound packet scheduling tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ftn.h"
+#include "ftn/inbound.h"
+#include "ftn/packet.h"
+
+#define TEST_INBOX "tmp/test_inbound"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* Helper function to write a single-message packet */
+int write_test_packet(const char* path, ftn_message_type_t type, size_t text_len) {
+    ftn_packet_t* packet;
+    ftn_message_t* msg;
+    int result;
+
+    packet = ftn_packet_new();
+    msg = ftn_message_new(type);
+    if (!packet || !msg) {
+        if (packet) ftn_packet_free(packet);
+        if (msg) ftn_message_free(msg);
+        return 0;
+    }
+
+    msg->to_user = malloc(8);
+    msg->from_user = malloc(8);
+    msg->subject = malloc(8);
+    msg->text = malloc(text_len + 1);
+    if (!msg->to_user || !msg->from_user || !msg->subject || !msg->text) {
+        ftn_message_free(msg);
+        ftn_packet_free(packet);
+        return 0;
+    }
+    strcpy(msg->to_user, "Sysop");
+    strcpy(msg->from_user, "Tester");
+    strcpy(msg->subject, "Test");
+    memset(msg->text, 'x', text_len);
+    msg->text[text_len] = '\0';
+
+    if (type == FTN_MSG_ECHOMAIL) {
+        msg->area = malloc(8);
+        if (msg->area) strcpy(msg->area, "TEST");
+    }
+
+    if (ftn_packet_add_message(packet, msg) != FTN_OK) {
+        ftn_message_free(msg);
+        ftn_packet_free(packet);
+        return 0;
+    }
+
+    result = ftn_packet_save(path, packet) == FTN_OK;
+    ftn_packet_free(packet);
+    return result;
+}
+
+void test_classify_netmail(void) {
+    ftn_inbound_class_t pkt_class;
+
+    test_start("classify netmail packet");
+
+    if (!write_test_packet(TEST_INBOX "/netmail.pkt", FTN_MSG_NETMAIL, 16)) {
+        test_fail("Failed to write test packet");
+        return;
+    }
+
+    if (ftn_inbound_classify(TEST_INBOX "/netmail.pkt", &pkt_class) != FTN_OK ||
+        pkt_class != FTN_INBOUND_NETMAIL) {
+        test_fail("Netmail packet not classified as netmail");
+        return;
+    }
+
+    test_pass();
+}
+
+void test_classify_echomail(void) {
+    ftn_inbound_class_t pkt_class;
+
+    test_start("classify echomail packet");
+
+    if (!write_test_packet(TEST_INBOX "/echomail.pkt", FTN_MSG_ECHOMAIL, 16)) {
+        test_fail("Failed to write test packet");
+        return;
+    }
+
+    if (ftn_inbound_classify(TEST_INBOX "/echomail.pkt", &pkt_class) != FTN_OK ||
+        pkt_class != FTN_INBOUND_ECHOMAIL) {
+        test_fail("Echomail packet not classified as echomail");
+        return;
+    }
+
+    test_pass();
+}
+
+void test_classify_truncated(void) {
+    ftn_inbound_class_t pkt_class;
+    FILE* fp;
+
+    test_start("classify truncated packet");
+
+    fp = fopen(TEST_INBOX "/short.pkt", "wb");
+    if (!fp) {
+        test_fail("Failed to write test packet");
+        return;
+    }
+    fputs("not a packet", fp);
+    fclose(fp);
+
+    if (ftn_inbound_classify(TEST_INBOX "/short.pkt", &pkt_class) != FTN_OK ||
+        pkt_class != FTN_INBOUND_UNKNOWN) {
+        test_fail("Truncated packet not classified as unknown");
+        return;
+    }
+
+    if (ftn_inbound_classify(TEST_INBOX "/missing.pkt", &pkt_class) == FTN_OK) {
+        test_fail("Missing packet should fail");
+        return;
+    }
+
+    test_pass();
+}
+
+void test_packet_names(void) {
+    test_start("packet name matching");
+
+    if (!ftn_inbound_is_packet_name("0000abcd.pkt") ||
+        !ftn_inbound_is_packet_name("0000ABCD.PKT") ||
+        ftn_inbound_is_packet_name(".pkt") ||
+        ftn_inbound_is_packet_name("0000abcd.flo") ||
+        ftn_inbound_is_packet_name(NULL)) {
+        test_fail("Packet name matching incorrect");
+        return;
+    }
+
+    test_pass();
+}
+
+void test_queue_order(void) {
+    ftn_inbound_queue_t* queue;
+
+    test_start("queue ordering");
+
+    queue = ftn_inbound_queue_new();
+    if (!queue) {
+        test_fail("Failed to create queue");
+        return;
+    }
+
+    ftn_inbound_queue_add(queue, "big-echo.pkt", FTN_INBOUND_ECHOMAIL, 50000, 100, 0);
+    ftn_inbound_queue_add(queue, "bad.pkt", FTN_INBOUND_UNKNOWN, 10, 100, 0);
+    ftn_inbound_queue_add(queue, "new-echo.pkt", FTN_INBOUND_ECHOMAIL, 500, 300, 1);
+    ftn_inbound_queue_add(queue, "old-echo.pkt", FTN_INBOUND_ECHOMAIL, 500, 200, 1);
+    ftn_inbound_queue_add(queue, "big-net.pkt", FTN_INBOUND_NETMAIL, 90000, 100, 0);
+    ftn_inbound_queue_add(queue, "small-net.pkt", FTN_INBOUND_NETMAIL, 100, 400, 1);
+    ftn_inbound_queue_sort(queue);
+
+    if (queue->count != 6 ||
+        strcmp(queue->entries[0].path, "small-net.pkt") != 0 ||
+        strcmp(queue->entries[1].path, "big-net.pkt") != 0 ||
+        strcmp(queue->entries[2].path, "old-echo.pkt") != 0 ||
+        strcmp(queue->entries[3].path, "new-echo.pkt") != 0 ||
+        strcmp(queue->entries[4].path, "big-echo.pkt") != 0 ||
+        strcmp(queue->entries[5].path, "bad.pkt") != 0) {
+        test_fail("Queue not sorted by class, size and age");
+        ftn_inbound_queue_free(queue);
+        return;
+    }
+
+    if (queue->entries[0].source != 1 || queue->entries[1].source != 0) {
+        test_fail("Queue entry source not preserved");
+        ftn_inbound_queue_free(queue);
+        return;
+    }
+
+    ftn_inbound_queue_free(queue);
+    test_pass();
+}
+
+void test_scan_inbox(void) {
+    ftn_inbound_queue_t* queue;
+    FILE* fp;
+
+    test_start("inbox scan");
+
+    /* Non-packet files are ignored */
+    fp = fopen(TEST_INBOX "/readme.txt", "w");
+    if (fp) {
+        fputs("ignore me", fp);
+        fclose(fp);
+    }
+
+    queue = ftn_inbound_queue_new();
+    if (!queue) {
+        test_fail("Failed to create queue");
+        return;
+    }
+
+    if (ftn_inbound_scan(queue, TEST_INBOX, 7) != FTN_OK) {
+        test_fail("Failed to scan inbox");
+        ftn_inbound_queue_free(queue);
+        return;
+    }
+    ftn_inbound_queue_sort(queue);
+
+    if (queue->count != 3 ||
+        queue->entries[0].pkt_class != FTN_INBOUND_NETMAIL ||
+        queue->entries[1].pkt_class != FTN_INBOUND_ECHOMAIL ||
+        queue->entries[2].pkt_class != FTN_INBOUND_UNKNOWN ||
+        queue->entries[0].source != 7) {
+        test_fail("Inbox scan returned unexpected entries");
+        ftn_inbound_queue_free(queue);
+        return;
+    }
+
+    if (ftn_inbound_scan(queue, TEST_INBOX "/missing", 0) == FTN_OK) {
+        test_fail("Scanning a missing inbox should fail");
+        ftn_inbound_queue_free(queue);
+        return;
+    }
+
+    ftn_inbound_queue_free(queue);
+    test_pass();
+}
+
+void test_prefetch(void) {
+    ftn_inbound_queue_t* queue;
+
+    test_start("packet prefetch");
+
+    queue = ftn_inbound_queue_new();
+    if (!queue) {
+        test_fail("Failed to create queue");
+        return;
+    }
+
+    ftn_inbound_queue_add(queue, TEST_INBOX "/netmail.pkt", FTN_INBOUND_NETMAIL, 100, 100, 0);
+    ftn_inbound_queue_add(queue, TEST_INBOX "/missing.pkt", FTN_INBOUND_NETMAIL, 100, 100, 0);
+    ftn_inbound_queue_add(queue, TEST_INBOX "/echomail.pkt", FTN_INBOUND_ECHOMAIL, 100, 100, 0);
+
+    /* Missing files are skipped, and the range is clamped to the queue */
+    if (ftn_inbound_prefetch(queue, 1, 10) != FTN_OK) {
+        test_fail("Prefetch failed");
+        ftn_inbound_queue_free(queue);
+        return;
+    }
+
+    if (queue->entries[0].prefetched ||
+        !queue->entries[1].prefetched ||
+        !queue->entries[2].prefetched) {
+        test_fail("Prefetch marked the wrong entries");
+        ftn_inbound_queue_free(queue);
+        return;
+    }
+
+    if (ftn_inbound_prefetch(NULL, 0, 1) == FTN_OK) {
+        test_fail("Prefetch should reject a NULL queue");
+        ftn_inbound_queue_free(queue);
+        return;
+    }
+
+    ftn_inbound_queue_free(queue);
+    test_pass();
+}
+
+int main(void) {
+    int status;
+
+    printf("Inbound Scheduling Tests\n");
+    printf("========================\n\n");
+
+    status = system("rm -rf " TEST_INBOX " && mkdir -p " TEST_INBOX);
+    (void)status;
+
+    test_classify_netmail();
+    test_classify_echomail();
+    test_classify_truncated();
+    test_packet_names();
+    test_queue_order();
+    test_scan_inbox();
+    test_prefetch();
+
+    status = system("rm -rf " TEST_INBOX);
+    (void)status;
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}
@@ -0,0 +1,208 @@
+/*
+ * test_intern.c - Name interning tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ftn.h"
+#include "ftn/intern.h"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+void test_intern_basic(void) {
+    ftn_intern_id_t a, b, c;
+
+    test_start("basic interning");
+
+    a = ftn_intern(FTN_INTERN_AREA, "FIDO_SYSOP");
+    b = ftn_intern(FTN_INTERN_AREA, "fido_sysop");
+    c = ftn_intern(FTN_INTERN_AREA, "FIDO_TEST");
+
+    if (a == FTN_INTERN_NONE || a != b || a == c) {
+        test_fail("Area IDs not case-insensitive and unique");
+        return;
+    }
+
+    if (strcmp(ftn_intern_name(FTN_INTERN_AREA, a), "FIDO_SYSOP") != 0 ||
+        strcmp(ftn_intern_lower(FTN_INTERN_AREA, a), "fido_sysop") != 0) {
+        test_fail("Interned forms incorrect");
+        return;
+    }
+
+    if (ftn_intern_find(FTN_INTERN_AREA, "Fido_Test") != c ||
+        ftn_intern_find(FTN_INTERN_AREA, "NOT_THERE") != FTN_INTERN_NONE ||
+        ftn_intern_count(FTN_INTERN_AREA) != 2) {
+        test_fail("Lookup without adding failed");
+        return;
+    }
+
+    test_pass();
+}
+
+void test_intern_kinds(void) {
+    ftn_intern_id_t upper, lower;
+
+    test_start("separate kinds");
+
+    /* Network names are case-sensitive since they name directories */
+    upper = ftn_intern(FTN_INTERN_NETWORK, "Fidonet");
+    lower = ftn_intern(FTN_INTERN_NETWORK, "fidonet");
+    if (upper == FTN_INTERN_NONE || upper == lower) {
+        test_fail("Network names should be case-sensitive");
+        return;
+    }
+
+    if (ftn_intern_find(FTN_INTERN_AREA, "Fidonet") != FTN_INTERN_NONE ||
+        ftn_intern_name(FTN_INTERN_NETWORK, 99) != NULL ||
+        ftn_intern(FTN_INTERN_NETWORK, NULL) != FTN_INTERN_NONE) {
+        test_fail("Kinds should not share names or IDs");
+        return;
+    }
+
+    test_pass();
+}
+
+void test_intern_newsgroup(void) {
+    ftn_intern_id_t net1, net2, area;
+    const char* group;
+    const char* first;
+
+    test_start("cached newsgroup names");
+
+    net1 = ftn_intern(FTN_INTERN_NETWORK, "fidonet");
+    net2 = ftn_intern(FTN_INTERN_NETWORK, "fsxnet");
+    area = ftn_intern(FTN_INTERN_AREA, "GENERAL");
+
+    group = ftn_intern_newsgroup(net1, area);
+    if (!group || strcmp(group, "fidonet.general") != 0 ||
+        ftn_intern_newsgroup(net1, area) != group) {
+        test_fail("Newsgroup not built or not cached");
+        return;
+    }
+
+    first = group;
+    group = ftn_intern_newsgroup(net2, area);
+    if (!group || strcmp(group, "fsxnet.general") != 0) {
+        test_fail("Newsgroup not rebuilt for another network");
+        return;
+    }
+
+    /* Names handed out earlier must stay valid for other callers */
+    if (strcmp(first, "fidonet.general") != 0 || ftn_intern_newsgroup(net1, area) != first) {
+        test_fail("Newsgroup for the first network was not kept");
+        return;
+    }
+
+    if (ftn_intern_newsgroup(net1, FTN_INTERN_NONE) != NULL) {
+        test_fail("Unknown area should have no newsgroup");
+        return;
+    }
+
+    test_pass();
+}
+
+void test_intern_growth(void) {
+    char name[32];
+    ftn_intern_id_t ids[5000];
+    int i;
+
+    test_start("table growth");
+
+    for (i = 0; i < 5000; i++) {
+        sprintf(name, "AREA.%d", i);
+        ids[i] = ftn_intern(FTN_INTERN_AREA, name);
+        if (ids[i] == FTN_INTERN_NONE) {
+            test_fail("Failed to intern name");
+            return;
+        }
+    }
+
+    for (i = 0; i < 5000; i++) {
+        sprintf(name, "area.%d", i);
+        if (ftn_intern_find(FTN_INTERN_AREA, name) != ids[i]) {
+            test_fail("ID changed after table growth");
+            return;
+        }
+    }
+
+    ftn_intern_cleanup();
+    if (ftn_intern_count(FTN_INTERN_AREA) != 0 ||
+        ftn_intern_find(FTN_INTERN_AREA, "AREA.1") != FTN_INTERN_NONE) {
+        test_fail("Cleanup did not empty the tables");
+        return;
+    }
+
+    test_pass();
+}
+
+void test_intern_limit(void) {
+    char name[32];
+    ftn_intern_id_t first;
+    size_t i;
+
+    test_start("bounded table");
+
+    ftn_intern_cleanup();
+    first = ftn_intern(FTN_INTERN_AREA, "KEEP");
+    for (i = 1; i < FTN_INTERN_MAX_NAMES; i++) {
+        sprintf(name, "FLOOD.%lu", (unsigned long)i);
+        if (ftn_intern(FTN_INTERN_AREA, name) == FTN_INTERN_NONE) {
+            test_fail("Table filled up early");
+            return;
+        }
+    }
+
+    /* Full: known names still resolve, new ones are refused */
+    if (ftn_intern(FTN_INTERN_AREA, "keep") != first ||
+        ftn_intern(FTN_INTERN_AREA, "ONE.MORE") != FTN_INTERN_NONE ||
+        ftn_intern_count(FTN_INTERN_AREA) != FTN_INTERN_MAX_NAMES) {
+        test_fail("Table grew past its limit");
+        return;
+    }
+
+    ftn_intern_cleanup();
+    test_pass();
+}
+
+int main(void) {
+    printf("Name Interning Tests\n");
+    printf("====================\n\n");
+
+    test_intern_basic();
+    test_intern_kinds();
+    test_intern_newsgroup();
+    test_intern_growth();
+    test_intern_limit();
+
+    ftn_intern_cleanup();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}
@@ -0,0 +1,320 @@
+/*
+ * test_jam.c - JAM message base tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/jam.h"
+#include "ftn/storage.h"
+#include "ftn/config.h"
+#include "ftn/packet.h"
+
+#define TEST_ROOT "tmp/test_jam"
+#define TEST_BASE TEST_ROOT "/testarea"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+static int reset_root(void) {
+    return system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT) == 0;
+}
+
+static long file_size(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static ftn_message_t* create_echomail(const char* to, const char* msgid, const char* text) {
+    ftn_message_t* msg = ftn_message_new(FTN_MSG_ECHOMAIL);
+    if (!msg) return NULL;
+
+    msg->orig_addr.zone = 1;
+    msg->orig_addr.net = 2;
+    msg->orig_addr.node = 3;
+    msg->timestamp = 1700000000;
+    msg->attributes = FTN_ATTR_LOCAL;
+    msg->from_user = strdup("Test Sender");
+    msg->to_user = strdup(to);
+    msg->subject = strdup("JAM test");
+    msg->area = strdup("TESTAREA");
+    msg->text = strdup(text);
+    msg->tearline = strdup("--- libFTN");
+    msg->origin = strdup("* Origin: Test System (1:2/3)");
+    msg->msgid = strdup(msgid);
+    msg->tzutc = strdup("0100");
+    ftn_message_add_control(msg, "PID: libFTN 1.0");
+    ftn_message_add_control(msg, "CHRS: UTF-8 4");
+    ftn_message_add_seenby(msg, " 2/3 4");
+    ftn_message_add_path(msg, "2/3");
+    return msg;
+}
+
+void test_round_trip(void) {
+    ftn_jam_base_t* base;
+    ftn_message_t* msgs[3];
+    ftn_message_t* read = NULL;
+    ftn_message_t* missing = NULL;
+    unsigned long first = 0;
+    unsigned long count = 0;
+    size_t i;
+
+    test_start("message round trip");
+
+    msgs[0] = create_echomail("All", "1:2/3 00000001", "First message");
+    msgs[1] = create_echomail("Sysop", "1:2/3 00000002", "Second message\r\nwith two lines");
+    msgs[2] = create_echomail("All", "1:2/3 00000003", "Third message");
+
+    if (!reset_root() || !(base = ftn_jam_open(TEST_BASE, 0))) {
+        test_fail("Failed to create base");
+        goto cleanup;
+    }
+    for (i = 0; i < 3; i++) {
+        if (ftn_jam_append(base, msgs[i]) != FTN_OK) {
+            test_fail("Failed to queue message");
+            ftn_jam_close(base);
+            goto cleanup;
+        }
+    }
+    if (file_size(TEST_BASE ".jdx") != 0) {
+        test_fail("Messages were written before the flush");
+        ftn_jam_close(base);
+        goto cleanup;
+    }
+    if (ftn_jam_close(base) != FTN_OK) {
+        test_fail("Failed to write base");
+        goto cleanup;
+    }
+
+    if (ftn_jam_count(TEST_BASE, &first, &count) != FTN_OK || first != 1 || count != 3) {
+        test_fail("Wrong message count");
+    } else if (file_size(TEST_BASE ".jlr") != 0 || file_size(TEST_BASE ".jdx") != 3 * FTN_JAM_INDEX_SIZE) {
+        test_fail("Wrong index or lastread file");
+    } else if (ftn_jam_read(TEST_BASE, 2, &read) != FTN_OK) {
+        test_fail("Failed to read message 2");
+    } else if (read->type != FTN_MSG_ECHOMAIL || !ftn_message_has_attribute(read, FTN_ATTR_LOCAL) ||
+               read->timestamp != 1700000000 || read->orig_addr.net != 2 || read->orig_addr.node != 3) {
+        test_fail("Wrong header fields");
+    } else if (strcmp(read->to_user, "Sysop") != 0 || strcmp(read->from_user, "Test Sender") != 0 ||
+               strcmp(read->subject, "JAM test") != 0 || strcmp(read->msgid, "1:2/3 00000002") != 0 ||
+               strcmp(read->tzutc, "0100") != 0) {
+        test_fail("Wrong subfields");
+    } else if (!ftn_message_get_control(read, "PID") || !ftn_message_get_control(read, "CHRS") ||
+               read->seenby_count != 1 || strcmp(read->seenby[0], "2/3 4") != 0 ||
+               read->path_count != 1 || strcmp(read->path[0], "2/3") != 0) {
+        test_fail("Wrong kludges");
+    } else if (!strstr(read->text, "Second message") || !strstr(read->text, "with two lines") ||
+               !read->tearline || strcmp(read->tearline, "--- libFTN") != 0 ||
+               !read->origin || strcmp(read->origin, "* Origin: Test System (1:2/3)") != 0) {
+        test_fail("Wrong message text");
+    } else if (ftn_jam_read(TEST_BASE, 4, &missing) == FTN_OK || missing) {
+        test_fail("Read past the last message");
+    } else {
+        test_pass();
+    }
+
+cleanup:
+    ftn_message_free(read);
+    for (i = 0; i < 3; i++) {
+        ftn_message_free(msgs[i]);
+    }
+}
+
+void test_recipient_index(void) {
+    unsigned char record[FTN_JAM_INDEX_SIZE];
+    unsigned long numbers[8];
+    size_t count = 0;
+    FILE* fp;
+
+    test_start("recipient index");
+
+    /* Uses the base written by test_round_trip */
+    fp = fopen(TEST_BASE ".jdx", "rb");
+    if (!fp || fseek(fp, FTN_JAM_INDEX_SIZE, SEEK_SET) != 0 || fread(record, 1, sizeof(record), fp) != sizeof(record)) {
+        test_fail("Failed to read index");
+        if (fp) fclose(fp);
+        return;
+    }
+    fclose(fp);
+
+    if (ftn_jam_crc("SysOp") != 0x754FADB6UL) {
+        test_fail("Wrong name CRC");
+    } else if ((record[0] | (record[1] << 8) | ((unsigned long)record[2] << 16) |
+                ((unsigned long)record[3] << 24)) != 0x754FADB6UL) {
+        test_fail("Index record has the wrong CRC");
+    } else if (ftn_jam_find_recipient(TEST_BASE, "SYSOP", numbers, 8, &count) != FTN_OK ||
+               count != 1 || numbers[0] != 2) {
+        test_fail("Wrong messages for Sysop");
+    } else if (ftn_jam_find_recipient(TEST_BASE, "all", numbers, 8, &count) != FTN_OK ||
+               count != 2 || numbers[0] != 1 || numbers[1] != 3) {
+        test_fail("Wrong messages for All");
+    } else if (ftn_jam_find_recipient(TEST_BASE, "Nobody", numbers, 8, &count) != FTN_OK || count != 0) {
+        test_fail("Found messages for an unknown user");
+    } else {
+        test_pass();
+    }
+}
+
+void test_batches(void) {
+    ftn_jam_base_t* first_writer;
+    ftn_jam_base_t* second_writer;
+    ftn_message_t* msg;
+    ftn_message_t* read = NULL;
+    unsigned long first = 0;
+    unsigned long count = 0;
+    int ok = 1;
+    int i;
+
+    test_start("batches from two writers");
+
+    msg = create_echomail("All", "1:2/3 0000000a", "Batched");
+    first_writer = ftn_jam_open(TEST_ROOT "/batch", 2);
+    second_writer = ftn_jam_open(TEST_ROOT "/batch", 2);
+    if (!msg || !first_writer || !second_writer) {
+        test_fail("Failed to open base twice");
+        goto cleanup;
+    }
+
+    /* Each writer numbers its batch from the base as it finds it */
+    for (i = 0; i < 2 && ok; i++) {
+        ok = ftn_jam_append(first_writer, msg) == FTN_OK &&
+             ftn_jam_append(second_writer, msg) == FTN_OK;
+    }
+    if (!ok || !ftn_jam_batch_full(first_writer) ||
+        ftn_jam_flush(first_writer) != FTN_OK || ftn_jam_flush(second_writer) != FTN_OK) {
+        test_fail("Failed to write batches");
+    } else if (ftn_jam_count(TEST_ROOT "/batch", &first, &count) != FTN_OK || count != 4) {
+        test_fail("Batches overlapped");
+    } else if (ftn_jam_read(TEST_ROOT "/batch", 4, &read) != FTN_OK || strcmp(read->text, "Batched") != 0) {
+        test_fail("Last message of the second batch is unreadable");
+    } else if (first_writer->written != 2 || second_writer->written != 2) {
+        test_fail("Wrong written counts");
+    } else {
+        test_pass();
+    }
+
+cleanup:
+    ftn_message_free(read);
+    ftn_message_free(msg);
+    ftn_jam_close(first_writer);
+    ftn_jam_close(second_writer);
+}
+
+void test_failed_flush(void) {
+    ftn_jam_base_t* base;
+    ftn_message_t* msg;
+    unsigned long first = 0;
+    unsigned long count = 0;
+
+    test_start("failed flush keeps the queue");
+
+    msg = create_echomail("All", "1:2/3 0000000b", "Retried");
+    base = ftn_jam_open(TEST_ROOT "/retry", 0);
+    if (!msg || !base || ftn_jam_append(base, msg) != FTN_OK || ftn_jam_append(base, msg) != FTN_OK) {
+        test_fail("Failed to queue messages");
+        goto cleanup;
+    }
+
+    /* Without its header file the base cannot be written */
+    if (rename(TEST_ROOT "/retry.jhr", TEST_ROOT "/retry.jhr.away") != 0) {
+        test_fail("Could not move the header file");
+    } else if (ftn_jam_flush(base) == FTN_OK) {
+        test_fail("Flush without a header file succeeded");
+    } else if (base->pending_count != 2) {
+        test_fail("Queue dropped by a failed flush");
+    } else if (rename(TEST_ROOT "/retry.jhr.away", TEST_ROOT "/retry.jhr") != 0 ||
+               ftn_jam_flush(base) != FTN_OK) {
+        test_fail("Retried flush failed");
+    } else if (ftn_jam_count(TEST_ROOT "/retry", &first, &count) != FTN_OK || count != 2 ||
+               base->pending_count != 0) {
+        test_fail("Queued messages not written on retry");
+    } else {
+        test_pass();
+    }
+
+cleanup:
+    ftn_message_free(msg);
+    ftn_jam_close(base);
+}
+
+void test_storage_jam(void) {
+    ftn_config_t* config;
+    ftn_storage_t* storage;
+    ftn_message_t* msg;
+    unsigned long first = 0;
+    unsigned long count = 0;
+
+    test_start("storage writes JAM bases");
+
+    config = ftn_config_new();
+    config->news = malloc(sizeof(ftn_news_config_t));
+    memset(config->news, 0, sizeof(ftn_news_config_t));
+    config->news->jam = malloc(64);
+    strcpy(config->news->jam, TEST_ROOT "/jam");
+
+    storage = ftn_storage_new(config);
+    msg = create_echomail("All", "1:2/3 00000100", "Tossed");
+    if (!storage || !msg) {
+        test_fail("Failed to set up storage");
+        goto cleanup;
+    }
+
+    if (ftn_storage_store_news(storage, msg, "TESTAREA", "fidonet") != FTN_OK ||
+        ftn_storage_store_news(storage, msg, "OTHER", "fidonet") != FTN_OK ||
+        ftn_storage_store_news(storage, msg, "TESTAREA", "fidonet") != FTN_OK) {
+        test_fail("Failed to store messages");
+    } else if (storage->jam_count != 2) {
+        test_fail("Expected one open base per area");
+    } else if (ftn_storage_flush(storage) != FTN_OK) {
+        test_fail("Failed to flush");
+    } else if (ftn_jam_count(TEST_ROOT "/jam/fidonet/testarea", &first, &count) != FTN_OK || count != 2) {
+        test_fail("Wrong count in testarea");
+    } else if (ftn_jam_count(TEST_ROOT "/jam/fidonet/other", &first, &count) != FTN_OK || count != 1) {
+        test_fail("Wrong count in other");
+    } else {
+        test_pass();
+    }
+
+cleanup:
+    ftn_message_free(msg);
+    ftn_storage_free(storage);
+    ftn_config_free(config);
+}
+
+int main(void) {
+    printf("JAM Message Base Tests\n");
+    printf("======================\n\n");
+
+    test_round_trip();
+    test_recipient_index();
+    test_batches();
+    test_failed_flush();
+    test_storage_jam();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
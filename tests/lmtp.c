@@ -0,0 +1,503 @@
+/*
+ * test_lmtp.c - Pipelined LMTP delivery tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "ftn.h"
+#include "ftn/lmtp.h"
+#include "ftn/storage.h"
+#include "ftn/config.h"
+#include "ftn/packet.h"
+
+#define TEST_ROOT   "tmp/test_lmtp"
+#define TEST_SOCKET TEST_ROOT "/lmtp.sock"
+#define TEST_LOG    TEST_ROOT "/server.log"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* Helper function to start from an empty directory */
+void reset_test_dir(void) {
+    int status;
+
+    status = system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT);
+    (void)status;
+}
+
+/* Stand-in LMTP server: buffered line reader over one connection */
+static char server_buf[65536];
+static size_t server_len = 0;
+static size_t server_pos = 0;
+static unsigned long server_reads = 0;
+
+static int server_read_line(int fd, char* line, size_t size) {
+    size_t len = 0;
+    ssize_t n;
+    char c;
+
+    for (;;) {
+        if (server_pos >= server_len) {
+            n = read(fd, server_buf, sizeof(server_buf));
+            if (n <= 0) return -1;
+            server_len = (size_t)n;
+            server_pos = 0;
+            server_reads++;
+        }
+        c = server_buf[server_pos++];
+        if (c == '\n') break;
+        if (c != '\r' && len < size - 1) line[len++] = c;
+    }
+    line[len] = '\0';
+    return 0;
+}
+
+static void server_reply(int fd, const char* text) {
+    ssize_t n = write(fd, text, strlen(text));
+    (void)n;
+}
+
+/* Accept connections until killed. Mail for "nobody" is refused at RCPT. */
+static void run_server(int listen_fd, int pipelining) {
+    char line[1024];
+    char rcpt[256];
+    FILE* log;
+    int fd;
+    int have_mail;
+    int have_rcpt;
+
+    for (;;) {
+        fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+
+        server_len = server_pos = 0;
+        server_reads = 0;
+        have_mail = have_rcpt = 0;
+
+        log = fopen(TEST_LOG, "a");
+        fprintf(log, "CONNECT\n");
+        fflush(log);
+
+        server_reply(fd, "220 test LMTP ready\r\n");
+        while (server_read_line(fd, line, sizeof(line)) == 0) {
+            if (strncmp(line, "LHLO", 4) == 0) {
+                server_reply(fd, "250-test\r\n");
+                if (pipelining) server_reply(fd, "250-PIPELINING\r\n");
+                server_reply(fd, "250 ENHANCEDSTATUSCODES\r\n");
+            } else if (strncmp(line, "MAIL FROM:", 10) == 0) {
+                server_reply(fd, have_mail ? "503 5.5.1 Nested MAIL\r\n" : "250 2.1.0 OK\r\n");
+                have_mail = 1;
+            } else if (strncmp(line, "RCPT TO:", 8) == 0) {
+                if (!have_mail) {
+                    server_reply(fd, "503 5.5.1 MAIL first\r\n");
+                } else if (strstr(line, "nobody")) {
+                    server_reply(fd, "550 5.1.1 User doesn't exist\r\n");
+                } else {
+                    strncpy(rcpt, line + 8, sizeof(rcpt) - 1);
+                    rcpt[sizeof(rcpt) - 1] = '\0';
+                    have_rcpt = 1;
+                    server_reply(fd, "250 2.1.5 OK\r\n");
+                }
+            } else if (strcmp(line, "DATA") == 0) {
+                if (!have_rcpt) {
+                    server_reply(fd, "503 5.5.1 No valid recipients\r\n");
+                    continue;
+                }
+                server_reply(fd, "354 OK\r\n");
+                fprintf(log, "TO %s\n", rcpt);
+                while (server_read_line(fd, line, sizeof(line)) == 0 && strcmp(line, ".") != 0) {
+                    fprintf(log, "%s\n", line[0] == '.' ? line + 1 : line);
+                }
+                fprintf(log, "END\n");
+                fflush(log);
+                server_reply(fd, "250 2.0.0 Saved\r\n");
+                have_mail = have_rcpt = 0;
+            } else if (strcmp(line, "RSET") == 0) {
+                have_mail = have_rcpt = 0;
+                server_reply(fd, "250 2.0.0 OK\r\n");
+            } else if (strcmp(line, "QUIT") == 0) {
+                server_reply(fd, "221 2.0.0 Bye\r\n");
+                break;
+            } else {
+                server_reply(fd, "500 5.5.2 Unknown command\r\n");
+            }
+        }
+
+        fprintf(log, "READS %lu\n", server_reads);
+        fclose(log);
+        close(fd);
+    }
+}
+
+/* Helper function to fork a stand-in server on TEST_SOCKET */
+pid_t start_server(int pipelining) {
+    struct sockaddr_un addr;
+    int listen_fd;
+    pid_t pid;
+
+    reset_test_dir();
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, TEST_SOCKET);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 4) != 0) {
+        close(listen_fd);
+        return -1;
+    }
+
+    pid = fork();
+    if (pid == 0) {
+        run_server(listen_fd, pipelining);
+        _exit(0);
+    }
+    close(listen_fd);
+    return pid;
+}
+
+void stop_server(pid_t pid) {
+    int status;
+
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, &status, 0);
+    }
+}
+
+/* Helper function to count lines of the server log starting with a prefix */
+int count_log_lines(const char* prefix) {
+    char line[1024];
+    FILE* log;
+    int count = 0;
+
+    log = fopen(TEST_LOG, "r");
+    if (!log) return 0;
+    while (fgets(line, sizeof(line), log)) {
+        if (strncmp(line, prefix, strlen(prefix)) == 0) count++;
+    }
+    fclose(log);
+    return count;
+}
+
+/* Helper function to read the READS counter of the last closed connection */
+unsigned long last_read_count(void) {
+    char line[1024];
+    FILE* log;
+    unsigned long reads = 0;
+    struct timespec pause;
+    int attempts;
+
+    /* The server logs its count only after it sees the disconnect */
+    for (attempts = 0; attempts < 200 && reads == 0; attempts++) {
+        log = fopen(TEST_LOG, "r");
+        if (log) {
+            while (fgets(line, sizeof(line), log)) {
+                if (strncmp(line, "READS ", 6) == 0) reads = strtoul(line + 6, NULL, 10);
+            }
+            fclose(log);
+        }
+        if (reads == 0) {
+            pause.tv_sec = 0;
+            pause.tv_nsec = 10000000L;
+            nanosleep(&pause, NULL);
+        }
+    }
+    return reads;
+}
+
+/* Helper function to queue a copy of a message */
+ftn_error_t queue_text(ftn_lmtp_client_t* client, const char* user, const char* text) {
+    char* copy = malloc(strlen(text) + 1);
+
+    if (!copy) return FTN_ERROR_NOMEM;
+    strcpy(copy, text);
+    if (ftn_lmtp_queue(client, user, "fidonet", copy) != FTN_OK) {
+        free(copy);
+        return FTN_ERROR_NOMEM;
+    }
+    return FTN_OK;
+}
+
+void check_batch_delivery(int pipelining) {
+    ftn_lmtp_client_t* client;
+    pid_t server;
+
+    test_start(pipelining ? "pipelined batch delivery" : "delivery without PIPELINING");
+
+    server = start_server(pipelining);
+    client = ftn_lmtp_client_new(TEST_SOCKET, "example.org", 0);
+    if (server < 0 || !client) {
+        test_fail("Failed to set up client and server");
+        ftn_lmtp_client_free(client);
+        stop_server(server);
+        return;
+    }
+
+    queue_text(client, "alice", "Subject: one\n\nHello\n.leading dot\n");
+    queue_text(client, "nobody", "Subject: two\n\nLost\n");
+    queue_text(client, "bob", "Subject: three\n\nNo trailing newline");
+
+    if (ftn_lmtp_flush(client) != FTN_OK) {
+        test_fail("Flush failed");
+    } else if (client->pipelining != pipelining) {
+        test_fail("PIPELINING capability not detected correctly");
+    } else if (client->queue[0].status != 250 || client->queue[1].status != 550 ||
+               client->queue[2].status != 250) {
+        test_fail("Unexpected per-message status");
+    } else if (client->delivered != 2 || client->failed != 1) {
+        test_fail("Delivery counters are wrong");
+    } else {
+        ftn_lmtp_disconnect(client);
+        if (count_log_lines("TO <alice@example.org>") != 1 || count_log_lines("TO <bob@example.org>") != 1 ||
+            count_log_lines("TO <nobody") != 0) {
+            test_fail("Server did not receive the expected recipients");
+        } else if (count_log_lines(".leading dot") != 1 || count_log_lines("No trailing newline") != 1) {
+            test_fail("Message content was not dot-stuffed correctly");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_lmtp_client_free(client);
+    stop_server(server);
+}
+
+void test_pipelined_delivery(void) {
+    check_batch_delivery(1);
+}
+
+void test_unpipelined_delivery(void) {
+    check_batch_delivery(0);
+}
+
+void test_persistent_connection(void) {
+    ftn_lmtp_client_t* client;
+    pid_t server;
+
+    test_start("persistent connection across flushes");
+
+    server = start_server(1);
+    client = ftn_lmtp_client_new("unix:" TEST_SOCKET, NULL, 0);
+    if (server < 0 || !client) {
+        test_fail("Failed to set up client and server");
+        ftn_lmtp_client_free(client);
+        stop_server(server);
+        return;
+    }
+
+    queue_text(client, "alice", "Subject: one\n\nFirst batch\n");
+    ftn_lmtp_flush(client);
+    ftn_lmtp_clear(client);
+    queue_text(client, "alice", "Subject: two\n\nSecond batch\n");
+    ftn_lmtp_flush(client);
+    ftn_lmtp_clear(client);
+    ftn_lmtp_disconnect(client);
+
+    if (client->connections != 1 || count_log_lines("CONNECT") != 1) {
+        test_fail("Client reconnected between flushes");
+    } else if (client->delivered != 2 || count_log_lines("TO <alice>") != 2) {
+        test_fail("Messages were not delivered");
+    } else {
+        test_pass();
+    }
+
+    ftn_lmtp_client_free(client);
+    stop_server(server);
+}
+
+void test_pipelined_round_trips(void) {
+    ftn_lmtp_client_t* client;
+    pid_t server;
+    unsigned long reads;
+    int i;
+
+    test_start("pipelined round trips");
+
+    server = start_server(1);
+    client = ftn_lmtp_client_new(TEST_SOCKET, NULL, 0);
+    if (server < 0 || !client) {
+        test_fail("Failed to set up client and server");
+        ftn_lmtp_client_free(client);
+        stop_server(server);
+        return;
+    }
+
+    for (i = 0; i < 20; i++) {
+        queue_text(client, "alice", "Subject: burst\n\nBody\n");
+    }
+    ftn_lmtp_flush(client);
+    ftn_lmtp_disconnect(client);
+    reads = last_read_count();
+
+    /* Four commands per message would take 80 reads without pipelining */
+    if (client->delivered != 20) {
+        test_fail("Messages were not delivered");
+    } else if (reads == 0 || reads > 30) {
+        test_fail("Commands were not pipelined");
+    } else {
+        test_pass();
+    }
+
+    ftn_lmtp_client_free(client);
+    stop_server(server);
+}
+
+void test_storage_fallback(void) {
+    ftn_config_t* config;
+    ftn_storage_t* storage;
+    ftn_message_t* msg;
+    struct dirent* entry;
+    DIR* dir;
+    pid_t server;
+    int files = 0;
+
+    test_start("storage falls back to Maildir");
+
+    server = start_server(1);
+    mkdir(TEST_ROOT "/mail", 0755);
+
+    config = ftn_config_new();
+    config->mail = malloc(sizeof(ftn_mail_config_t));
+    memset(config->mail, 0, sizeof(ftn_mail_config_t));
+    config->mail->inbox = malloc(64);
+    strcpy(config->mail->inbox, TEST_ROOT "/mail/%USER%");
+    config->mail->lmtp = malloc(64);
+    strcpy(config->mail->lmtp, TEST_SOCKET);
+
+    storage = ftn_storage_new(config);
+    msg = ftn_message_new(FTN_MSG_NETMAIL);
+    if (!storage || !msg || !storage->lmtp) {
+        test_fail("Failed to set up storage");
+        goto cleanup;
+    }
+    msg->from_user = malloc(16);
+    strcpy(msg->from_user, "Sysop");
+    msg->to_user = malloc(16);
+    strcpy(msg->to_user, "Nobody");
+    msg->subject = malloc(16);
+    strcpy(msg->subject, "Test Subject");
+    msg->text = malloc(32);
+    strcpy(msg->text, "This is a test message.");
+
+    if (ftn_storage_store_mail(storage, msg, "Alice", "fidonet") != FTN_OK ||
+        ftn_storage_store_mail(storage, msg, "Nobody", "fidonet") != FTN_OK) {
+        test_fail("Failed to queue mail");
+        goto cleanup;
+    }
+    if (storage->lmtp->queue_count != 2) {
+        test_fail("Mail was not queued for LMTP");
+        goto cleanup;
+    }
+    if (ftn_storage_flush_mail(storage) != FTN_OK) {
+        test_fail("Flush failed");
+        goto cleanup;
+    }
+
+    dir = opendir(TEST_ROOT "/mail/nobody/new");
+    if (dir) {
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] != '.') files++;
+        }
+        closedir(dir);
+    }
+
+    if (storage->lmtp->delivered != 1 || count_log_lines("TO <alice>") != 1) {
+        test_fail("Mail was not delivered over LMTP");
+    } else if (files != 1) {
+        test_fail("Refused mail was not written to the Maildir");
+    } else if (access(TEST_ROOT "/mail/alice", F_OK) == 0) {
+        test_fail("Delivered mail was also written to the Maildir");
+    } else {
+        test_pass();
+    }
+
+cleanup:
+    ftn_message_free(msg);
+    ftn_storage_free(storage);
+    ftn_config_free(config);
+    stop_server(server);
+}
+
+void test_long_recipient(void) {
+    ftn_lmtp_client_t* client;
+    char user[FTN_LMTP_LINE_MAX];
+    char* text;
+
+    test_start("recipient too long for RCPT TO");
+
+    memset(user, 'a', sizeof(user) - 8);
+    user[sizeof(user) - 8] = '\0';
+    client = ftn_lmtp_client_new(TEST_SOCKET, "example.org", 0);
+    text = malloc(16);
+    if (!client || !text) {
+        test_fail("Failed to create client");
+        free(text);
+        ftn_lmtp_client_free(client);
+        return;
+    }
+    strcpy(text, "Body\r\n");
+
+    /* The client owns the text only once it is queued */
+    if (ftn_lmtp_queue(client, user, "fidonet", text) == FTN_OK) {
+        test_fail("Truncated recipient queued");
+    } else {
+        free(text);
+        if (client->queue_count != 0) {
+            test_fail("Rejected message left in the queue");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_lmtp_client_free(client);
+}
+
+int main(void) {
+    printf("LMTP Tests\n");
+    printf("==========\n\n");
+
+    /* A server that goes away must not kill the client */
+    signal(SIGPIPE, SIG_IGN);
+
+    test_pipelined_delivery();
+    test_unpipelined_delivery();
+    test_persistent_connection();
+    test_pipelined_round_trips();
+    test_storage_fallback();
+    test_long_recipient();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
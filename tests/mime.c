@@ -0,0 +1,241 @@
+/*
+ * test_mime.c - MIME decoding tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ftn.h"
+#include "ftn/mime.h"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+void test_base64(void) {
+    /* "The quick brown fox jumps over the lazy dog." wrapped mid-stream */
+    const char* encoded = "VGhlIHF1aWNrIGJyb3duIGZveCBq\ndW1wcyBvdmVyIHRoZSBsYXp5IGRvZy4=\n";
+    const char* tail = "YQ==";
+    char out[128];
+    size_t len;
+
+    test_start("base64 decoding");
+
+    len = ftn_mime_base64_decode(encoded, strlen(encoded), out);
+    if (len != 44 || memcmp(out, "The quick brown fox jumps over the lazy dog.", 44) != 0) {
+        test_fail("wrapped input decoded wrongly");
+        return;
+    }
+
+    len = ftn_mime_base64_decode(tail, strlen(tail), out);
+    if (len != 1 || out[0] != 'a') {
+        test_fail("padding handled wrongly");
+        return;
+    }
+
+    test_pass();
+}
+
+void test_quoted_printable(void) {
+    const char* body = "Caf=C3=A9 au lait is a very long line that was wrapped by=\nthe sender, 2+2=3D4=\r\n.";
+    const char* word = "Hello_World=21";
+    char out[128];
+    size_t len;
+
+    test_start("quoted-printable decoding");
+
+    len = ftn_mime_qp_decode(body, strlen(body), out, 0);
+    out[len] = '\0';
+    if (strcmp(out, "Caf\xC3\xA9 au lait is a very long line that was wrapped bythe sender, 2+2=4.") != 0) {
+        test_fail("body decoded wrongly");
+        return;
+    }
+
+    len = ftn_mime_qp_decode(word, strlen(word), out, 1);
+    out[len] = '\0';
+    if (strcmp(out, "Hello World!") != 0) {
+        test_fail("encoded word decoded wrongly");
+        return;
+    }
+
+    test_pass();
+}
+
+void test_transcode(void) {
+    char* text;
+
+    test_start("charset transcoding");
+
+    /* Latin-1 e-acute to UTF-8 */
+    text = ftn_mime_transcode("caf\xE9", 4, "iso-8859-1", FTN_CHRS_UTF8);
+    if (!text || strcmp(text, "caf\xC3\xA9") != 0) {
+        free(text);
+        test_fail("Latin-1 to UTF-8 failed");
+        return;
+    }
+    free(text);
+
+    /* UTF-8 e-acute and box drawing to CP437 */
+    text = ftn_mime_transcode("\xC3\xA9\xE2\x94\x80", 5, "utf-8", FTN_CHRS_CP437);
+    if (!text || strcmp(text, "\x82\xC4") != 0) {
+        free(text);
+        test_fail("UTF-8 to CP437 failed");
+        return;
+    }
+    free(text);
+
+    /* The euro sign has no Latin-1 form */
+    text = ftn_mime_transcode("\xE2\x82\xAC", 3, "UTF-8", FTN_CHRS_LATIN1);
+    if (!text || strcmp(text, "?") != 0) {
+        free(text);
+        test_fail("unmappable character not replaced");
+        return;
+    }
+    free(text);
+
+    if (strcmp(ftn_mime_chrs_kludge(NULL), "UTF-8 4") != 0 ||
+        strcmp(ftn_mime_chrs_kludge("IBMPC"), "CP437 2") != 0) {
+        test_fail("wrong CHRS kludge");
+        return;
+    }
+
+    test_pass();
+}
+
+void test_encoded_header(void) {
+    char* text;
+
+    test_start("encoded header words");
+
+    text = ftn_mime_decode_header("=?UTF-8?B?SGVsbG8=?= =?iso-8859-1?Q?W=F6rld?= again", NULL);
+    if (!text || strcmp(text, "HelloW\xC3\xB6rld again") != 0) {
+        free(text);
+        test_fail("encoded words decoded wrongly");
+        return;
+    }
+    free(text);
+
+    text = ftn_mime_decode_header("Plain =?bogus subject", NULL);
+    if (!text || strcmp(text, "Plain =?bogus subject") != 0) {
+        free(text);
+        test_fail("plain text was altered");
+        return;
+    }
+    free(text);
+
+    test_pass();
+}
+
+void test_multipart(void) {
+    const char* mail =
+        "From: John Doe <john.doe@f1.n100.z1.fidonet.org>\r\n"
+        "To: Jane Smith <jane.smith@f2.n200.z1.fidonet.org>\r\n"
+        "Subject: =?UTF-8?Q?Gr=C3=BC=C3=9Fe?=\r\n"
+        "MIME-Version: 1.0\r\n"
+        "Content-Type: multipart/alternative;\r\n"
+        "\tboundary=\"b1\"\r\n"
+        "\r\n"
+        "This is a multi-part message in MIME format.\r\n"
+        "--b1\r\n"
+        "Content-Type: text/html; charset=utf-8\r\n"
+        "\r\n"
+        "<p>HTML</p>\r\n"
+        "--b1\r\n"
+        "Content-Type: text/plain; charset=utf-8\r\n"
+        "Content-Transfer-Encoding: base64\r\n"
+        "\r\n"
+        "SGFsbG8sIFfDtnJsZCEKWmVpbGUgendlaQo=\r\n"
+        "--b1--\r\n";
+    rfc822_message_t* rfc_msg = NULL;
+    ftn_message_t* ftn_msg = NULL;
+    const char* chrs;
+
+    test_start("multipart conversion");
+
+    if (rfc822_message_parse(mail, &rfc_msg) != FTN_OK) {
+        test_fail("parse failed");
+        return;
+    }
+    if (rfc822_to_ftn_chrs(rfc_msg, "fidonet.org", FTN_CHRS_CP437, &ftn_msg) != FTN_OK) {
+        rfc822_message_free(rfc_msg);
+        test_fail("conversion failed");
+        return;
+    }
+
+    if (!ftn_msg->text || strcmp(ftn_msg->text, "Hallo, W\x94rld!\nZeile zwei\n") != 0) {
+        test_fail("wrong body");
+    } else if (!ftn_msg->subject || strcmp(ftn_msg->subject, "Gr\x81\xE1" "e") != 0) {
+        test_fail("wrong subject");
+    } else if (!(chrs = ftn_message_get_control(ftn_msg, "CHRS")) || strstr(chrs, "CP437 2") == NULL) {
+        test_fail("missing CHRS kludge");
+    } else {
+        test_pass();
+    }
+
+    ftn_message_free(ftn_msg);
+    rfc822_message_free(rfc_msg);
+}
+
+void test_plain_mail(void) {
+    const char* mail =
+        "From: John Doe <john.doe@f1.n100.z1.fidonet.org>\n"
+        "To: Jane Smith <jane.smith@f2.n200.z1.fidonet.org>\n"
+        "Subject: Plain\n"
+        "\n"
+        "Nothing =3D encoded here.\n";
+    rfc822_message_t* rfc_msg = NULL;
+    ftn_message_t* ftn_msg = NULL;
+
+    test_start("plain mail unchanged");
+
+    if (rfc822_message_parse(mail, &rfc_msg) != FTN_OK ||
+        rfc822_to_ftn(rfc_msg, "fidonet.org", &ftn_msg) != FTN_OK) {
+        rfc822_message_free(rfc_msg);
+        test_fail("conversion failed");
+        return;
+    }
+
+    if (!ftn_msg->text || strcmp(ftn_msg->text, "Nothing =3D encoded here.\n") != 0) {
+        test_fail("body was altered");
+    } else if (ftn_message_get_control(ftn_msg, "CHRS")) {
+        test_fail("unexpected CHRS kludge");
+    } else {
+        test_pass();
+    }
+
+    ftn_message_free(ftn_msg);
+    rfc822_message_free(rfc_msg);
+}
+
+int main(void) {
+    printf("MIME Decoding Tests\n");
+    printf("===================\n\n");
+
+    test_base64();
+    test_quoted_printable();
+    test_transcode();
+    test_encoded_header();
+    test_multipart();
+    test_plain_mail();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -0,0 +1,320 @@
+/*
+ * test_net.c - Socket tuning tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "ftn.h"
+#include "ftn/net.h"
+#include "ftn/mailer.h"
+#include "ftn/transfer.h"
+#include "ftn/binkp/session.h"
+
+#define TEST_ROOT "tmp/test_net"
+#define TEST_FILE TEST_ROOT "/bundle.su0"
+#define TEST_SIZE 40000
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* A loopback port unlikely to clash with parallel test runs */
+static int test_port(int offset) {
+    return 30000 + (int)(getpid() % 10000) * 2 + offset;
+}
+
+/* A profile whose buffers clamp to the 64 KiB minimum */
+static void test_tuning(ftn_net_tuning_t* tuning) {
+    ftn_net_tuning_init(tuning);
+    tuning->bandwidth_kbps = 1000;
+    tuning->rtt_ms = 100;
+    tuning->notsent_lowat = 16384;
+    tuning->cork_frames = 1;
+}
+
+/* Check a socket carries the test profile */
+static int socket_is_tuned(ftn_socket_t sock) {
+    int value = 0;
+    socklen_t len = sizeof(value);
+
+    if (getsockopt(sock, SOL_SOCKET, SO_SNDBUF, (char*)&value, &len) < 0 || value < 65536) {
+        return 0;
+    }
+#ifdef TCP_NOTSENT_LOWAT
+    value = 0;
+    len = sizeof(value);
+    if (getsockopt(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, (char*)&value, &len) < 0 || value != 16384) {
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+void test_tuned_connections(void) {
+    ftn_net_tuning_t tuning;
+    ftn_net_server_t* server;
+    ftn_net_connection_t* client = NULL;
+    ftn_net_connection_t* answered = NULL;
+    int port = test_port(0);
+
+    test_start("tuning on listening, accepted and connected sockets");
+    test_tuning(&tuning);
+
+    server = ftn_net_listen(port, "127.0.0.1", 4);
+    if (!server) {
+        test_fail("Could not listen");
+        return;
+    }
+
+    if (ftn_net_server_set_tuning(server, &tuning) != FTN_OK) {
+        test_fail("Listener tuning failed");
+    } else if (!socket_is_tuned(server->socket)) {
+        test_fail("Listener not tuned");
+    } else if (!(client = ftn_net_connect_tuned("127.0.0.1", port, 2000, &tuning))) {
+        test_fail("Could not connect");
+    } else if (!(answered = ftn_net_accept(server, 2000))) {
+        test_fail("Could not accept");
+    } else if (!socket_is_tuned(client->socket) || !client->cork_frames) {
+        test_fail("Connected socket not tuned");
+    } else if (!socket_is_tuned(answered->socket) || !answered->cork_frames) {
+        test_fail("Accepted socket not tuned");
+    } else {
+        test_pass();
+    }
+
+    ftn_net_connection_free(answered);
+    ftn_net_connection_free(client);
+    ftn_net_server_free(server);
+}
+
+void test_tuning_failure(void) {
+    ftn_net_tuning_t tuning;
+    ftn_net_server_t* server;
+    ftn_net_connection_t* client = NULL;
+    ftn_net_connection_t* answered = NULL;
+    int port = test_port(1);
+
+    test_start("connections survive a failed tuning option");
+    test_tuning(&tuning);
+    strcpy(tuning.congestion, "nosuchcc");
+
+    server = ftn_net_listen(port, "127.0.0.1", 4);
+    if (!server) {
+        test_fail("Could not listen");
+        return;
+    }
+
+#ifdef TCP_CONGESTION
+    if (ftn_net_server_set_tuning(server, &tuning) == FTN_OK) {
+        test_fail("Unknown congestion algorithm accepted");
+        ftn_net_server_free(server);
+        return;
+    }
+#else
+    ftn_net_server_set_tuning(server, &tuning);
+#endif
+
+    if (!(client = ftn_net_connect_tuned("127.0.0.1", port, 2000, &tuning))) {
+        test_fail("Could not connect");
+    } else if (!(answered = ftn_net_accept(server, 2000))) {
+        test_fail("Could not accept");
+    } else if (!socket_is_tuned(client->socket) || !socket_is_tuned(answered->socket)) {
+        test_fail("Other options not applied");
+    } else {
+        test_pass();
+    }
+
+    ftn_net_connection_free(answered);
+    ftn_net_connection_free(client);
+    ftn_net_server_free(server);
+}
+
+void test_mailer_listener(void) {
+    ftn_mailer_context_t* ctx;
+    ftn_network_config_t config;
+    ftn_network_context_t net;
+    ftn_net_connection_t* client = NULL;
+    int port = test_port(0);
+
+    test_start("mailer listener uses the network's tuning");
+
+    memset(&config, 0, sizeof(config));
+    config.section_name = "test";
+    config.listen_port = port;
+    config.tcp_bandwidth = 1000;
+    config.tcp_rtt = 100;
+    config.tcp_notsent_lowat = 16384;
+    memset(&net, 0, sizeof(net));
+    net.config = &config;
+
+    ctx = ftn_mailer_context_new();
+    if (!ctx) {
+        test_fail("Could not create mailer");
+        return;
+    }
+
+    if (ftn_mailer_answer_network(ctx, &net, 0) != -1) {
+        test_fail("Answered without a listener");
+    } else if (ftn_mailer_open_listener(&net) != FTN_OK || !net.listener) {
+        test_fail("Could not open listener");
+    } else if (!net.listener->has_tuning || !socket_is_tuned(net.listener->socket)) {
+        test_fail("Listener not tuned");
+    } else if (ftn_mailer_answer_network(ctx, &net, 0) != 0) {
+        test_fail("Answered with no caller");
+    } else if (!(client = ftn_net_connect("127.0.0.1", port, 2000))) {
+        test_fail("Could not connect");
+    } else if (ftn_mailer_answer_network(ctx, &net, 2000) != 1) {
+        test_fail("Call not answered");
+    } else {
+        test_pass();
+    }
+
+    ftn_net_connection_free(client);
+    ftn_net_server_free(net.listener);
+    ftn_mailer_context_free(ctx);
+}
+
+/* Receive data frames until size bytes arrive, checking them against content */
+static int receive_file_frames(ftn_net_connection_t* conn, const char* content, size_t size) {
+    ftn_binkp_frame_t frame;
+    size_t received = 0;
+    int ok = 1;
+
+    while (ok && received < size) {
+        ftn_binkp_frame_init(&frame);
+        if (ftn_binkp_frame_receive(conn, &frame, 2000) != BINKP_OK || frame.is_command ||
+            received + frame.size > size || memcmp(frame.data, content + received, frame.size) != 0) {
+            ok = 0;
+        } else {
+            received += frame.size;
+        }
+        ftn_binkp_frame_free(&frame);
+    }
+
+    return ok;
+}
+
+void test_transfer_sendfile(void) {
+    ftn_net_server_t* server;
+    ftn_net_connection_t* client = NULL;
+    ftn_net_connection_t* answered = NULL;
+    ftn_config_t config;
+    ftn_binkp_session_t session;
+    ftn_transfer_context_t transfer;
+    ftn_file_transfer_t file;
+    char* content;
+    FILE* fp;
+    size_t i;
+    int status;
+    int port = test_port(1);
+    int steps = 0;
+
+    test_start("file data sent from the page cache");
+    status = system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT);
+    (void)status;
+
+    content = malloc(TEST_SIZE);
+    if (!content) {
+        test_fail("Out of memory");
+        return;
+    }
+    for (i = 0; i < TEST_SIZE; i++) {
+        content[i] = (char)(i * 7 + i / 251);
+    }
+    fp = fopen(TEST_FILE, "wb");
+    if (fp) {
+        fwrite(content, 1, TEST_SIZE, fp);
+        fclose(fp);
+    }
+
+    server = ftn_net_listen(port, "127.0.0.1", 4);
+    if (!server) {
+        test_fail("Could not listen");
+        free(content);
+        return;
+    }
+
+    memset(&config, 0, sizeof(config));
+    ftn_transfer_context_init(&transfer);
+    ftn_file_transfer_init(&file);
+    memset(&session, 0, sizeof(session));
+
+    if (!(client = ftn_net_connect("127.0.0.1", port, 2000)) || !(answered = ftn_net_accept(server, 2000))) {
+        test_fail("Could not connect");
+    } else if (ftn_binkp_session_init(&session, client, &config, 1) != BINKP_OK ||
+               ftn_transfer_context_set_session(&transfer, &session) != BSO_OK ||
+               ftn_file_transfer_setup_send(&file, TEST_FILE, REF_DIRECTIVE_NONE) != BSO_OK ||
+               ftn_transfer_add_file(&transfer, &file) != BSO_OK) {
+        test_fail("Could not queue file");
+    } else {
+        /* Header, two full frames, then the end of the file */
+        while (steps < 8 && ftn_transfer_process_next(&transfer) == BSO_OK &&
+               transfer.current_send->state == TRANSFER_STATE_SENDING) {
+            steps++;
+        }
+
+        if (!transfer.current_send || transfer.current_send->state != TRANSFER_STATE_WAITING_ACK ||
+            transfer.current_send->transferred != TEST_SIZE) {
+            test_fail("File not sent");
+        } else if (!receive_file_frames(answered, content, TEST_SIZE)) {
+            test_fail("Frames do not match the file");
+        } else if (session.bytes_sent != TEST_SIZE + 2 * BINKP_HEADER_SIZE) {
+            test_fail("Sent bytes not counted");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_file_transfer_free(&file);
+    ftn_transfer_context_free(&transfer);
+    ftn_binkp_session_free(&session);
+    ftn_net_connection_free(answered);
+    ftn_net_connection_free(client);
+    ftn_net_server_free(server);
+    free(content);
+}
+
+int main(void) {
+    printf("Network Tests\n");
+    printf("=============\n\n");
+
+    test_tuned_connections();
+    test_tuning_failure();
+    test_mailer_listener();
+    test_transfer_sendfile();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}
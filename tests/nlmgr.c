@@ -0,0 +1,254 @@
+/*
+ * test_nlmgr.c - Nodelist manager tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <utime.h>
+
+#include "ftn.h"
+#include "ftn/nlmgr.h"
+
+#define TEST_ROOT "tmp/test_nlmgr"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* Write a nodelist with the given number of nodes in net 1:100 */
+static int write_nodelist(const char* name, int nodes, time_t mtime) {
+    char path[256];
+    struct utimbuf times;
+    FILE* fp;
+    int i;
+
+    sprintf(path, "%s/%s", TEST_ROOT, name);
+    fp = fopen(path, "w");
+    if (!fp) return -1;
+    fprintf(fp, ";A Test Nodelist for Friday, January 3, 2025 -- Day number 003 : 00000\r\n");
+    if (nodes > 0) {
+        fprintf(fp, "Zone,1,Test_Zone,Somewhere,Zone_Sysop,-Unpublished-,300,CM\r\n");
+        fprintf(fp, "Host,100,Test_Net,Somewhere,Net_Sysop,-Unpublished-,300,CM\r\n");
+        for (i = 1; i <= nodes - 2; i++) {
+            fprintf(fp, ",%d,Node_%d,Somewhere,Sysop_%d,-Unpublished-,300,CM,IBN\r\n", i, i, i);
+        }
+    }
+    fclose(fp);
+
+    times.actime = mtime;
+    times.modtime = mtime;
+    return utime(path, &times);
+}
+
+/* Check until the build started by the last check has been picked up */
+static int wait_for_build(ftn_nodelist_manager_t* mgr, time_t now) {
+    struct timespec pause;
+    int published = 0;
+    int i;
+
+    pause.tv_sec = 0;
+    pause.tv_nsec = 10000000L;
+    for (i = 0; i < 500 && mgr->build; i++) {
+        published = ftn_nodelist_manager_check(mgr, now);
+        if (!mgr->build) break;
+        nanosleep(&pause, NULL);
+    }
+    return published;
+}
+
+static void test_locate(void) {
+    time_t base = time(NULL) - 3600;
+    time_t mtime = 0;
+    long size = 0;
+    char* file;
+
+    test_start("locate newest nodelist");
+
+    if (system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT) != 0 ||
+        write_nodelist("NODELIST.003", 4, base) != 0 ||
+        write_nodelist("NODELIST.010", 5, base + 60) != 0 ||
+        write_nodelist("NODELIST.Z17", 6, base + 120) != 0 ||
+        write_nodelist("nodelist.txt", 6, base + 120) != 0) {
+        test_fail("Could not set up nodelists");
+        return;
+    }
+
+    file = ftn_nodelist_manager_locate(TEST_ROOT, &mtime, &size);
+    if (!file || strcmp(file, TEST_ROOT "/NODELIST.010") != 0) {
+        test_fail("Wrong nodelist picked from the directory");
+    } else if (mtime != base + 60 || size <= 0) {
+        test_fail("Wrong file details");
+    } else {
+        free(file);
+        file = ftn_nodelist_manager_locate(TEST_ROOT "/NODELIST.003", NULL, NULL);
+        if (!file || strcmp(file, TEST_ROOT "/NODELIST.003") != 0) {
+            test_fail("A file path was not used as it is");
+        } else {
+            test_pass();
+        }
+    }
+    free(file);
+}
+
+static void test_hot_reload(void) {
+    time_t base = time(NULL) - 3600;
+    ftn_nodelist_manager_t* mgr;
+    ftn_nodelist_t* before;
+    ftn_nodelist_t* after;
+    ftn_nodelist_t* held;
+    int i;
+
+    test_start("hot reload");
+
+    if (system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT) != 0 ||
+        write_nodelist("NODELIST.003", 4, base) != 0) {
+        test_fail("Could not set up nodelist");
+        return;
+    }
+
+    mgr = ftn_nodelist_manager_new(TEST_ROOT, 60);
+    before = ftn_nodelist_manager_get(mgr);
+    if (!before || before->count != 4) {
+        test_fail("Initial nodelist was not loaded");
+        ftn_nodelist_manager_free(mgr);
+        return;
+    }
+
+    /* A reader that keeps the index across reloads */
+    held = ftn_nodelist_manager_acquire(mgr);
+    if (held != before || mgr->readers != 1) {
+        test_fail("Acquire did not return the current index");
+        ftn_nodelist_manager_release(mgr, held);
+        ftn_nodelist_manager_free(mgr);
+        return;
+    }
+
+    /* Nothing changed: no build is started */
+    ftn_nodelist_manager_check(mgr, mgr->next_check);
+    if (mgr->build || ftn_nodelist_manager_get(mgr) != before) {
+        test_fail("Unchanged nodelist was rebuilt");
+        ftn_nodelist_manager_free(mgr);
+        return;
+    }
+
+    if (write_nodelist("NODELIST.010", 7, base + 60) != 0) {
+        test_fail("Could not write new nodelist");
+        ftn_nodelist_manager_free(mgr);
+        return;
+    }
+
+    /* Before the interval is up the directory is not looked at */
+    ftn_nodelist_manager_check(mgr, mgr->next_check - 1);
+    if (mgr->build) {
+        test_fail("Nodelist was checked before the interval");
+        ftn_nodelist_manager_free(mgr);
+        return;
+    }
+
+    ftn_nodelist_manager_check(mgr, mgr->next_check);
+    if (!wait_for_build(mgr, mgr->next_check - 1)) {
+        test_fail("New nodelist was not published");
+        ftn_nodelist_manager_free(mgr);
+        return;
+    }
+
+    /* The old index stays readable for as many checks as it is held */
+    for (i = 0; i < 3; i++) {
+        ftn_nodelist_manager_check(mgr, mgr->next_check - 1);
+    }
+
+    after = ftn_nodelist_manager_get(mgr);
+    if (!after || after->count != 7 || mgr->reloads != 1 || mgr->readers != 0) {
+        test_fail("Wrong nodelist published");
+        ftn_nodelist_manager_release(mgr, held);
+    } else if (!mgr->retired || mgr->retired->nodelist != before || mgr->retired->readers != 1 ||
+               held->count != 4) {
+        test_fail("Old nodelist was not kept for its reader");
+        ftn_nodelist_manager_release(mgr, held);
+    } else {
+        ftn_nodelist_manager_release(mgr, held);
+        if (mgr->retired) {
+            test_fail("Old nodelist was not freed by its last reader");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_nodelist_manager_free(mgr);
+}
+
+static void test_bad_nodelist(void) {
+    time_t base = time(NULL) - 3600;
+    ftn_nodelist_manager_t* mgr;
+    ftn_nodelist_t* before;
+
+    test_start("bad nodelist is not published");
+
+    if (system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT) != 0 ||
+        write_nodelist("NODELIST.003", 4, base) != 0) {
+        test_fail("Could not set up nodelist");
+        return;
+    }
+
+    mgr = ftn_nodelist_manager_new(TEST_ROOT "/NODELIST.003", 60);
+    before = ftn_nodelist_manager_get(mgr);
+    if (!before) {
+        test_fail("Initial nodelist was not loaded");
+        ftn_nodelist_manager_free(mgr);
+        return;
+    }
+
+    /* A nodelist with no entries is most likely still being copied in */
+    if (write_nodelist("NODELIST.003", 0, base + 60) != 0) {
+        test_fail("Could not truncate nodelist");
+        ftn_nodelist_manager_free(mgr);
+        return;
+    }
+
+    ftn_nodelist_manager_check(mgr, mgr->next_check);
+    if (wait_for_build(mgr, mgr->next_check - 1) || ftn_nodelist_manager_get(mgr) != before) {
+        test_fail("Empty nodelist replaced the current one");
+    } else {
+        /* The same broken file is not parsed again */
+        ftn_nodelist_manager_check(mgr, mgr->next_check);
+        if (mgr->build) {
+            test_fail("Broken nodelist was parsed again");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_nodelist_manager_free(mgr);
+}
+
+int main(void) {
+    printf("Nodelist Manager Tests\n");
+    printf("======================\n\n");
+
+    test_locate();
+    test_hot_reload();
+    test_bad_nodelist();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -0,0 +1,482 @@
+/*
+ * test_nntp.c - Streaming NNTP feed tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "ftn.h"
+#include "ftn/nntp.h"
+#include "ftn/storage.h"
+#include "ftn/config.h"
+#include "ftn/packet.h"
+
+#define TEST_ROOT   "tmp/test_nntp"
+#define TEST_SOCKET TEST_ROOT "/nntp.sock"
+#define TEST_LOG    TEST_ROOT "/server.log"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* Helper function to start from an empty directory */
+void reset_test_dir(void) {
+    int status;
+
+    status = system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT);
+    (void)status;
+}
+
+/* Stand-in news server: buffered line reader over one connection */
+static char server_buf[65536];
+static size_t server_len = 0;
+static size_t server_pos = 0;
+static unsigned long server_reads = 0;
+
+static int server_read_line(int fd, char* line, size_t size) {
+    size_t len = 0;
+    ssize_t n;
+    char c;
+
+    for (;;) {
+        if (server_pos >= server_len) {
+            n = read(fd, server_buf, sizeof(server_buf));
+            if (n <= 0) return -1;
+            server_len = (size_t)n;
+            server_pos = 0;
+            server_reads++;
+        }
+        c = server_buf[server_pos++];
+        if (c == '\n') break;
+        if (c != '\r' && len < size - 1) line[len++] = c;
+    }
+    line[len] = '\0';
+    return 0;
+}
+
+static void server_reply(int fd, const char* format, const char* id) {
+    char reply[512];
+    ssize_t n;
+
+    sprintf(reply, format, id);
+    n = write(fd, reply, strlen(reply));
+    (void)n;
+}
+
+/* Accept connections until killed. The server already has <dup@test>,
+   defers IDs containing "busy" and rejects articles for *.bad groups. */
+static void run_server(int listen_fd, int streaming) {
+    static char seen[256][128];
+    size_t seen_count = 0;
+    char line[1024];
+    char id[128];
+    FILE* log;
+    size_t i;
+    int fd;
+    int known;
+    int bad;
+
+    strcpy(seen[seen_count++], "<dup@test>");
+
+    for (;;) {
+        fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+
+        server_len = server_pos = 0;
+        server_reads = 0;
+
+        log = fopen(TEST_LOG, "a");
+        fprintf(log, "CONNECT\n");
+        fflush(log);
+
+        server_reply(fd, "200 test news server ready\r\n", NULL);
+        while (server_read_line(fd, line, sizeof(line)) == 0) {
+            if (strcmp(line, "MODE STREAM") == 0) {
+                server_reply(fd, streaming ? "203 Streaming permitted\r\n" : "501 Unknown MODE\r\n", NULL);
+            } else if (strncmp(line, "CHECK ", 6) == 0 || strncmp(line, "TAKETHIS ", 9) == 0) {
+                int takethis = line[0] == 'T';
+
+                strncpy(id, strchr(line, ' ') + 1, sizeof(id) - 1);
+                id[sizeof(id) - 1] = '\0';
+                known = 0;
+                for (i = 0; i < seen_count; i++) {
+                    if (strcmp(seen[i], id) == 0) known = 1;
+                }
+
+                if (!takethis) {
+                    if (known) {
+                        server_reply(fd, "438 %s\r\n", id);
+                    } else if (strstr(id, "busy")) {
+                        server_reply(fd, "431 %s\r\n", id);
+                    } else {
+                        server_reply(fd, "238 %s\r\n", id);
+                    }
+                    continue;
+                }
+
+                /* The article always follows TAKETHIS, wanted or not */
+                bad = 0;
+                fprintf(log, "ARTICLE %s\n", id);
+                while (server_read_line(fd, line, sizeof(line)) == 0 && strcmp(line, ".") != 0) {
+                    if (strncmp(line, "Newsgroups:", 11) == 0 && strstr(line, ".bad")) bad = 1;
+                    fprintf(log, "%s\n", line[0] == '.' ? line + 1 : line);
+                }
+                fprintf(log, "END\n");
+                fflush(log);
+
+                if (known || bad) {
+                    server_reply(fd, "439 %s\r\n", id);
+                } else {
+                    if (seen_count < 256) strcpy(seen[seen_count++], id);
+                    server_reply(fd, "239 %s\r\n", id);
+                }
+            } else if (strcmp(line, "QUIT") == 0) {
+                server_reply(fd, "205 Bye\r\n", NULL);
+                break;
+            } else {
+                server_reply(fd, "500 What?\r\n", NULL);
+            }
+        }
+
+        fprintf(log, "READS %lu\n", server_reads);
+        fclose(log);
+        close(fd);
+    }
+}
+
+/* Helper function to fork a stand-in server on TEST_SOCKET */
+pid_t start_server(int streaming) {
+    struct sockaddr_un addr;
+    int listen_fd;
+    pid_t pid;
+
+    reset_test_dir();
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, TEST_SOCKET);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 4) != 0) {
+        close(listen_fd);
+        return -1;
+    }
+
+    pid = fork();
+    if (pid == 0) {
+        run_server(listen_fd, streaming);
+        _exit(0);
+    }
+    close(listen_fd);
+    return pid;
+}
+
+void stop_server(pid_t pid) {
+    int status;
+
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, &status, 0);
+    }
+}
+
+/* Helper function to count lines of the server log starting with a prefix */
+int count_log_lines(const char* prefix) {
+    char line[1024];
+    FILE* log;
+    int count = 0;
+
+    log = fopen(TEST_LOG, "r");
+    if (!log) return 0;
+    while (fgets(line, sizeof(line), log)) {
+        if (strncmp(line, prefix, strlen(prefix)) == 0) count++;
+    }
+    fclose(log);
+    return count;
+}
+
+/* Helper function to read the READS counter of the last closed connection */
+unsigned long last_read_count(void) {
+    char line[1024];
+    FILE* log;
+    unsigned long reads = 0;
+    struct timespec pause;
+    int attempts;
+
+    /* The server logs its count only after it sees the disconnect */
+    for (attempts = 0; attempts < 200 && reads == 0; attempts++) {
+        log = fopen(TEST_LOG, "r");
+        if (log) {
+            while (fgets(line, sizeof(line), log)) {
+                if (strncmp(line, "READS ", 6) == 0) reads = strtoul(line + 6, NULL, 10);
+            }
+            fclose(log);
+        }
+        if (reads == 0) {
+            pause.tv_sec = 0;
+            pause.tv_nsec = 10000000L;
+            nanosleep(&pause, NULL);
+        }
+    }
+    return reads;
+}
+
+/* Helper function to queue a copy of an article */
+ftn_error_t queue_article(ftn_nntp_feed_t* feed, const char* id, const char* text) {
+    char* copy = malloc(strlen(text) + 1);
+
+    if (!copy) return FTN_ERROR_NOMEM;
+    strcpy(copy, text);
+    if (ftn_nntp_queue(feed, id, "TEST.AREA", "fidonet", copy) != FTN_OK) {
+        free(copy);
+        return FTN_ERROR_NOMEM;
+    }
+    return FTN_OK;
+}
+
+void test_streaming_feed(void) {
+    ftn_nntp_feed_t* feed;
+    pid_t server;
+
+    test_start("streaming feed");
+
+    server = start_server(1);
+    feed = ftn_nntp_feed_new(TEST_SOCKET, 0, 0);
+    if (server < 0 || !feed) {
+        test_fail("Failed to set up feed and server");
+        ftn_nntp_feed_free(feed);
+        stop_server(server);
+        return;
+    }
+
+    queue_article(feed, "<one@test>", "Newsgroups: fidonet.test\nSubject: one\n\n.leading dot\n");
+    queue_article(feed, "<dup@test>", "Newsgroups: fidonet.test\nSubject: dup\n\nAgain\n");
+    queue_article(feed, "<busy@test>", "Newsgroups: fidonet.test\nSubject: later\n\nLater\n");
+    queue_article(feed, "<rej@test>", "Newsgroups: fidonet.bad\nSubject: rejected\n\nNo\n");
+
+    if (ftn_nntp_flush(feed) != FTN_OK) {
+        test_fail("Flush failed");
+    } else if (feed->queue[0].status != 239 || feed->queue[1].status != 438 ||
+               feed->queue[2].status != 431 || feed->queue[3].status != 439) {
+        test_fail("Unexpected per-article status");
+    } else if (!ftn_nntp_done(&feed->queue[0]) || !ftn_nntp_done(&feed->queue[1]) ||
+               ftn_nntp_done(&feed->queue[2]) || !ftn_nntp_done(&feed->queue[3])) {
+        test_fail("Deferred articles must be retried, decided ones must not");
+    } else {
+        ftn_nntp_disconnect(feed);
+        if (count_log_lines("ARTICLE <one@test>") != 1 || count_log_lines("ARTICLE <dup@test>") != 0 ||
+            count_log_lines("ARTICLE <busy@test>") != 0) {
+            test_fail("Server received the wrong articles");
+        } else if (count_log_lines(".leading dot") != 1) {
+            test_fail("Article was not dot-stuffed correctly");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_nntp_feed_free(feed);
+    stop_server(server);
+}
+
+void test_feed_window(void) {
+    ftn_nntp_feed_t* feed;
+    pid_t server;
+    char id[64];
+    unsigned long reads;
+    int i;
+
+    test_start("pipelined window");
+
+    server = start_server(1);
+    feed = ftn_nntp_feed_new("unix:" TEST_SOCKET, 8, 0);
+    if (server < 0 || !feed) {
+        test_fail("Failed to set up feed and server");
+        ftn_nntp_feed_free(feed);
+        stop_server(server);
+        return;
+    }
+
+    for (i = 0; i < 40; i++) {
+        sprintf(id, "<burst%d@test>", i);
+        queue_article(feed, id, "Newsgroups: fidonet.test\nSubject: burst\n\nBody\n");
+    }
+    ftn_nntp_flush(feed);
+    ftn_nntp_clear(feed);
+    queue_article(feed, "<after@test>", "Newsgroups: fidonet.test\nSubject: after\n\nBody\n");
+    ftn_nntp_flush(feed);
+    ftn_nntp_disconnect(feed);
+    reads = last_read_count();
+
+    /* CHECK and TAKETHIS one at a time would take 80 reads */
+    if (feed->accepted != 41) {
+        test_fail("Articles were not accepted");
+    } else if (feed->connections != 1 || count_log_lines("CONNECT") != 1) {
+        test_fail("Feed reconnected between flushes");
+    } else if (reads == 0 || reads > 50) {
+        test_fail("Commands were not pipelined");
+    } else {
+        test_pass();
+    }
+
+    ftn_nntp_feed_free(feed);
+    stop_server(server);
+}
+
+void test_no_streaming(void) {
+    ftn_nntp_feed_t* feed;
+    pid_t server;
+
+    test_start("server without streaming");
+
+    server = start_server(0);
+    feed = ftn_nntp_feed_new(TEST_SOCKET, 0, 0);
+    if (server < 0 || !feed) {
+        test_fail("Failed to set up feed and server");
+        ftn_nntp_feed_free(feed);
+        stop_server(server);
+        return;
+    }
+
+    queue_article(feed, "<one@test>", "Newsgroups: fidonet.test\nSubject: one\n\nBody\n");
+    if (ftn_nntp_flush(feed) == FTN_OK) {
+        test_fail("Flush should fail without MODE STREAM");
+    } else if (ftn_nntp_done(&feed->queue[0])) {
+        test_fail("Article should be left for the spool");
+    } else {
+        test_pass();
+    }
+
+    ftn_nntp_feed_free(feed);
+    stop_server(server);
+}
+
+/* Helper function to create an echomail message */
+ftn_message_t* create_echomail(const char* msgid, const char* text) {
+    ftn_message_t* msg = ftn_message_new(FTN_MSG_ECHOMAIL);
+
+    if (!msg) return NULL;
+    msg->area = malloc(16);
+    strcpy(msg->area, "TESTAREA");
+    msg->from_user = malloc(16);
+    strcpy(msg->from_user, "Sysop");
+    msg->to_user = malloc(16);
+    strcpy(msg->to_user, "All");
+    msg->subject = malloc(16);
+    strcpy(msg->subject, "Test Subject");
+    msg->text = malloc(strlen(text) + 1);
+    strcpy(msg->text, text);
+    if (msgid) {
+        msg->msgid = malloc(strlen(msgid) + 1);
+        strcpy(msg->msgid, msgid);
+    }
+    msg->orig_addr.zone = 1;
+    msg->orig_addr.net = 2;
+    msg->orig_addr.node = 3;
+    return msg;
+}
+
+void test_storage_feed(void) {
+    ftn_config_t* config;
+    ftn_storage_t* storage;
+    ftn_message_t* fed;
+    ftn_message_t* busy;
+    pid_t server;
+
+    test_start("storage feeds and spools");
+
+    server = start_server(1);
+
+    config = ftn_config_new();
+    config->news = malloc(sizeof(ftn_news_config_t));
+    memset(config->news, 0, sizeof(ftn_news_config_t));
+    config->news->path = malloc(64);
+    strcpy(config->news->path, TEST_ROOT "/news");
+    config->news->nntp = malloc(64);
+    strcpy(config->news->nntp, TEST_SOCKET);
+
+    storage = ftn_storage_new(config);
+    fed = create_echomail("1:2/3 1a2b3c4d", "Fed to the server");
+    busy = create_echomail("1:2/3 busy", "Spooled for later");
+    if (!storage || !storage->nntp || !fed || !busy || ftn_storage_initialize(storage) != FTN_OK) {
+        test_fail("Failed to set up storage");
+        goto cleanup;
+    }
+
+    if (ftn_storage_store_news(storage, fed, "TESTAREA", "fidonet") != FTN_OK ||
+        ftn_storage_store_news(storage, busy, "TESTAREA", "fidonet") != FTN_OK ||
+        ftn_storage_flush(storage) != FTN_OK) {
+        test_fail("Failed to feed articles");
+        goto cleanup;
+    }
+
+    /* The same message tossed again is recognised by its Message-ID */
+    if (ftn_storage_store_news(storage, fed, "TESTAREA", "fidonet") != FTN_OK ||
+        ftn_storage_flush(storage) != FTN_OK) {
+        test_fail("Failed to feed the article again");
+        goto cleanup;
+    }
+
+    if (count_log_lines("ARTICLE <1a2b3c4d.1.2.3@fidonet.ftn>") != 1) {
+        test_fail("Article was not fed with a derived Message-ID");
+    } else if (count_log_lines("Path: fidonet!not-for-mail") != 1) {
+        test_fail("Article has no Path header");
+    } else if (storage->nntp->refused != 1) {
+        test_fail("Duplicate article was not refused by Message-ID");
+    } else if (access(TEST_ROOT "/news/fidonet/testarea/1", F_OK) != 0 ||
+               access(TEST_ROOT "/news/fidonet/testarea/2", F_OK) == 0) {
+        test_fail("Only the deferred article belongs in the spool");
+    } else {
+        test_pass();
+    }
+
+cleanup:
+    ftn_message_free(fed);
+    ftn_message_free(busy);
+    ftn_storage_free(storage);
+    ftn_config_free(config);
+    stop_server(server);
+}
+
+int main(void) {
+    printf("NNTP Feed Tests\n");
+    printf("===============\n\n");
+
+    /* A server that goes away must not kill the feed */
+    signal(SIGPIPE, SIG_IGN);
+
+    test_streaming_feed();
+    test_feed_window();
+    test_no_streaming();
+    test_storage_feed();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
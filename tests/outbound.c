@@ -0,0 +1,287 @@
+/*
+ * test_outbound.c - BSO netmail outbound tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ftn.h"
+#include "ftn/outbound.h"
+#include "ftn/packet.h"
+
+#define TEST_ROOT "tmp/test_outbound"
+#define TEST_OUTBOUND TEST_ROOT "/out"
+#define TEST_PACKET TEST_OUTBOUND "/00020003.out"
+#define TEST_BUSY TEST_OUTBOUND "/00020003.bsy"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+static const ftn_address_t local_addr = { 1, 2, 1, 0 };
+static const ftn_address_t hop_addr = { 1, 2, 3, 0 };
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+static ftn_message_t* make_netmail(const char* subject, unsigned int attributes) {
+    ftn_message_t* msg = ftn_message_new(FTN_MSG_NETMAIL);
+
+    if (!msg) return NULL;
+    msg->orig_addr = local_addr;
+    msg->dest_addr.zone = 1;
+    msg->dest_addr.net = 5;
+    msg->dest_addr.node = 7;
+    msg->attributes = attributes;
+    msg->timestamp = 1700000000;
+    msg->from_user = malloc(8);
+    msg->to_user = malloc(8);
+    msg->subject = malloc(strlen(subject) + 1);
+    msg->text = malloc(16);
+    if (!msg->from_user || !msg->to_user || !msg->subject || !msg->text) {
+        ftn_message_free(msg);
+        return NULL;
+    }
+    strcpy(msg->from_user, "Sender");
+    strcpy(msg->to_user, "Someone");
+    strcpy(msg->subject, subject);
+    strcpy(msg->text, "Hello there\r");
+    return msg;
+}
+
+/* Number of messages in a packet, or -1 if it does not load */
+static int packet_messages(const char* path) {
+    ftn_packet_t* packet = NULL;
+    int count;
+
+    if (ftn_packet_load(path, &packet) != FTN_OK) return -1;
+    count = (int)packet->message_count;
+    ftn_packet_free(packet);
+    return count;
+}
+
+/* Queue netmail for the next hop, which is our hub unless hub says otherwise */
+static int queue_messages_via(const ftn_address_t* hub, const char* subject, unsigned int attributes, int count) {
+    ftn_outbound_t* outbound;
+    ftn_message_t* msg;
+    int ok = 1;
+    int i;
+
+    outbound = ftn_outbound_new(TEST_OUTBOUND, &local_addr, hub, "SECRET");
+    msg = make_netmail(subject, attributes);
+    if (!outbound || !msg) ok = 0;
+
+    for (i = 0; ok && i < count; i++) {
+        if (ftn_outbound_add(outbound, &hop_addr, ftn_outbound_flavor(msg), msg) != FTN_OK) ok = 0;
+    }
+    if (ok && ftn_outbound_flush(outbound) != FTN_OK) ok = 0;
+
+    ftn_message_free(msg);
+    ftn_outbound_free(outbound);
+    return ok;
+}
+
+static int queue_messages(const char* subject, unsigned int attributes, int count) {
+    return queue_messages_via(&hop_addr, subject, attributes, count);
+}
+
+void test_append_existing(void) {
+    ftn_packet_t* packet = NULL;
+
+    test_start("appending to the next hop's packet");
+
+    if (system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT) != 0) {
+        test_fail("Could not create test directory");
+    } else if (!queue_messages("First", 0, 2)) {
+        test_fail("Could not queue netmail");
+    } else if (packet_messages(TEST_PACKET) != 2) {
+        test_fail("New packet does not hold both messages");
+    } else if (access(TEST_BUSY, F_OK) == 0) {
+        test_fail("Busy flag was left behind");
+    } else if (!queue_messages("Second", 0, 3)) {
+        test_fail("Could not queue more netmail");
+    } else if (packet_messages(TEST_PACKET) != 5) {
+        test_fail("Messages were not appended to the existing packet");
+    } else if (ftn_packet_load(TEST_PACKET, &packet) != FTN_OK ||
+               packet->header.dest_node != 3 || packet->header.orig_node != 1 ||
+               memcmp(packet->header.password, "SECRET", 6) != 0 ||
+               strcmp(packet->messages[4]->subject, "Second") != 0) {
+        test_fail("Wrong packet contents");
+    } else {
+        test_pass();
+    }
+
+    ftn_packet_free(packet);
+}
+
+void test_password_for_hub(void) {
+    static const ftn_address_t other_hub = { 1, 2, 9, 0 };
+    ftn_packet_t* packet = NULL;
+    size_t i;
+
+    test_start("packet password only for the hub");
+
+    if (system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT) != 0) {
+        test_fail("Could not create test directory");
+    } else if (!queue_messages_via(&other_hub, "Forwarded", 0, 1)) {
+        test_fail("Could not queue netmail");
+    } else if (ftn_packet_load(TEST_PACKET, &packet) != FTN_OK) {
+        test_fail("Packet does not load");
+    } else {
+        for (i = 0; i < sizeof(packet->header.password) && packet->header.password[i] == 0; i++) {
+        }
+        if (i < sizeof(packet->header.password)) {
+            test_fail("Hub password sent to another node");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_packet_free(packet);
+}
+
+void test_flavor(void) {
+    test_start("flavor from message attributes");
+
+    if (system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT) != 0) {
+        test_fail("Could not create test directory");
+    } else if (!queue_messages("Crash", FTN_ATTR_CRASH, 1) ||
+               !queue_messages("Hold", FTN_ATTR_HOLDFORPICKUP, 1)) {
+        test_fail("Could not queue netmail");
+    } else if (packet_messages(TEST_OUTBOUND "/c00020003.out") != 1 ||
+               packet_messages(TEST_OUTBOUND "/h00020003.out") != 1) {
+        test_fail("Flavored packets were not written");
+    } else if (access(TEST_PACKET, F_OK) == 0) {
+        test_fail("Normal packet was written");
+    } else {
+        test_pass();
+    }
+}
+
+/* The file named by the first line of the deferred list */
+static int deferred_file(char* path, size_t size) {
+    FILE* fp;
+    char line[512];
+    int offset = 0;
+    int fields[7];
+
+    fp = fopen(TEST_OUTBOUND "/.deferred", "r");
+    if (!fp) return 0;
+    if (!fgets(line, sizeof(line), fp)) line[0] = '\0';
+    fclose(fp);
+    line[strcspn(line, "\n")] = '\0';
+
+    if (sscanf(line, "%d %d %d %d %d %d %d %n", &fields[0], &fields[1], &fields[2], &fields[3],
+               &fields[4], &fields[5], &fields[6], &offset) != 7 || fields[6] != 1) {
+        return 0;
+    }
+    snprintf(path, size, "%s", line + offset);
+    return 1;
+}
+
+void test_busy_spill(void) {
+    FILE* fp;
+    char line[512];
+    char pending[512];
+    char temp[520];
+    const char* spilled = NULL;
+
+    test_start("separate packet while the node is busy");
+
+    line[0] = '\0';
+    if (system("rm -rf " TEST_ROOT " && mkdir -p " TEST_OUTBOUND " && touch " TEST_BUSY) != 0) {
+        test_fail("Could not create test directory");
+    } else if (!queue_messages("Busy", 0, 2)) {
+        test_fail("Could not queue netmail");
+    } else if (access(TEST_PACKET, F_OK) == 0) {
+        test_fail("Packet of a busy node was touched");
+    } else if (access(TEST_BUSY, F_OK) != 0) {
+        test_fail("Another program's busy flag was removed");
+    } else if (access(TEST_OUTBOUND "/00020003.flo", F_OK) == 0) {
+        test_fail("Busy node's flow file was written");
+    } else if (!deferred_file(pending, sizeof(pending))) {
+        test_fail("Spilled packet not deferred");
+    } else if (snprintf(temp, sizeof(temp), "%s.tmp", pending) < 0 ||
+               access(pending, F_OK) == 0 || access(temp, F_OK) != 0) {
+        test_fail("Spilled packet visible before it is referenced");
+    } else if (remove(TEST_BUSY) != 0 ||
+               ftn_flow_attach_deferred(TEST_OUTBOUND, NULL) != BSO_OK) {
+        test_fail("Could not attach the deferred reference");
+    } else if (!(fp = fopen(TEST_OUTBOUND "/00020003.flo", "r"))) {
+        test_fail("No reference file was written");
+    } else {
+        if (!fgets(line, sizeof(line), fp)) line[0] = '\0';
+        fclose(fp);
+        line[strcspn(line, "\n")] = '\0';
+        spilled = line + 1;
+        if (line[0] != '^' || strcmp(spilled, pending) != 0) {
+            test_fail("Wrong reference line");
+        } else if (packet_messages(spilled) != 2) {
+            test_fail("Referenced packet does not hold the messages");
+        } else {
+            test_pass();
+        }
+    }
+}
+
+void test_writer_abort(void) {
+    ftn_packet_header_t header;
+    ftn_packet_writer_t* writer;
+    ftn_message_t* msg;
+
+    test_start("abandoning an in-place append");
+
+    memset(&header, 0, sizeof(header));
+    header.packet_type = 0x0002;
+    msg = make_netmail("Aborted", 0);
+
+    if (system("rm -rf " TEST_ROOT " && mkdir -p " TEST_OUTBOUND) != 0 || !msg) {
+        test_fail("Could not set up test");
+    } else if (!queue_messages("Kept", 0, 1)) {
+        test_fail("Could not queue netmail");
+    } else if (!(writer = ftn_packet_writer_reopen(TEST_PACKET, &header))) {
+        test_fail("Could not reopen packet");
+    } else {
+        ftn_packet_writer_append(writer, msg);
+        ftn_packet_writer_append(writer, msg);
+        ftn_packet_writer_abort(writer);
+        if (packet_messages(TEST_PACKET) != 1) {
+            test_fail("Abandoned messages were left in the packet");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_message_free(msg);
+}
+
+int main(void) {
+    printf("BSO Outbound Tests\n");
+    printf("==================\n\n");
+
+    test_append_existing();
+    test_password_for_hub();
+    test_flavor();
+    test_busy_spill();
+    test_writer_abort();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+/*
+ * test_pack.c - Pack spool tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ftn.h"
+#include "ftn/pack.h"
+#include "ftn/storage.h"
+#include "ftn/config.h"
+#include "ftn/packet.h"
+
+#define TEST_ROOT "tmp/test_pack"
+#define TEST_PACK TEST_ROOT "/group"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+static const char* articles[] = {
+    "Subject: First\nFrom: a@example.org\nMessage-ID: <1@example.org>\n\nOne line\n",
+    "Subject: Second\tarticle\nFrom: b@example.org\nDate: Tue, 14 Nov 2023 22:13:20 +0000\n"
+        "Message-ID: <2@example.org>\nReferences: <1@example.org>\n\nTwo\nlines\n",
+    "Subject: Third\nFrom: c@example.org\nMessage-ID: <3@example.org>\n\n"
+};
+
+void test_append_read(void) {
+    ftn_pack_t* pack;
+    ftn_pack_t* reader = NULL;
+    ftn_pack_entry_t entry;
+    char* article = NULL;
+    size_t length = 0;
+    long number = 0;
+    long first = 0;
+    long last = 0;
+    int i;
+
+    test_start("append and read");
+
+    if (system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT) != 0 ||
+        !(pack = ftn_pack_open(TEST_PACK, FTN_PACK_WRITE))) {
+        test_fail("Failed to create pack");
+        return;
+    }
+    for (i = 0; i < 3; i++) {
+        if (ftn_pack_append(pack, articles[i], strlen(articles[i]), &number) != FTN_OK || number != i + 1) {
+            test_fail("Failed to append article");
+            ftn_pack_close(pack);
+            return;
+        }
+    }
+    ftn_pack_close(pack);
+
+    reader = ftn_pack_open(TEST_PACK, FTN_PACK_READ);
+    if (!reader) {
+        test_fail("Failed to reopen pack");
+    } else if (ftn_pack_range(reader, &first, &last) != FTN_OK || first != 1 || last != 3) {
+        test_fail("Wrong active range");
+    } else if (ftn_pack_entry(reader, 2, &entry) != FTN_OK ||
+               entry.offset != (off_t)strlen(articles[0]) || entry.length != strlen(articles[1])) {
+        test_fail("Wrong index record");
+    } else if (ftn_pack_read(reader, 2, &article, &length) != FTN_OK ||
+               length != strlen(articles[1]) || strcmp(article, articles[1]) != 0) {
+        test_fail("Wrong article text");
+    } else if (ftn_pack_entry(reader, 4, &entry) != FTN_ERROR_NOTFOUND ||
+               ftn_pack_entry(reader, 0, &entry) != FTN_ERROR_NOTFOUND) {
+        test_fail("Found articles outside the range");
+    } else if (ftn_pack_append(reader, articles[0], strlen(articles[0]), NULL) == FTN_OK) {
+        test_fail("Appended through a read-only pack");
+    } else {
+        test_pass();
+    }
+
+    free(article);
+    ftn_pack_close(reader);
+}
+
+void test_overview(void) {
+    ftn_pack_t* pack;
+    char* line = NULL;
+    char expected[256];
+
+    test_start("overview lines");
+
+    sprintf(expected, "2\tSecond article\tb@example.org\tTue, 14 Nov 2023 22:13:20 +0000\t"
+                      "<2@example.org>\t<1@example.org>\t%lu\t2", (unsigned long)strlen(articles[1]));
+
+    /* Uses the pack written by test_append_read */
+    pack = ftn_pack_open(TEST_PACK, FTN_PACK_READ);
+    if (!pack || ftn_pack_overview(pack, 2, &line) != FTN_OK) {
+        test_fail("Failed to build overview");
+    } else if (strcmp(line, expected) != 0) {
+        test_fail("Wrong overview line");
+    } else {
+        test_pass();
+    }
+
+    free(line);
+    ftn_pack_close(pack);
+}
+
+void test_compressed(void) {
+    ftn_pack_t* pack;
+    ftn_pack_entry_t entry;
+    char article[4096];
+    const char* short_article = "Subject: Hi\n\nShort\n";
+    char* read = NULL;
+    size_t length = 0;
+    long number = 0;
+    int ok = 1;
+    int i;
+
+    test_start("compressed articles");
+
+    strcpy(article, "Path: fidonet!not-for-mail\nFrom: \"Test Sender\" <test.sender@f3.n2.z1.fidonet.ftn>\n"
+                    "Newsgroups: fidonet.testarea\nSubject: Re: Compression\nMessage-ID: <1:2/3 1a2b3c4d>\n"
+                    "X-FTN-Control: PID: libFTN 1.0\nX-FTN-Control: CHRS: UTF-8 4\n\n");
+    for (i = 0; i < 20; i++) {
+        strcat(article, " TS> Quoted text that shows up again and again in echomail.\n");
+    }
+    strcat(article, "\n--- libFTN\n * Origin: Test System (1:2/3)\n");
+
+    pack = ftn_pack_open(TEST_ROOT "/compressed", FTN_PACK_WRITE | FTN_PACK_COMPRESS);
+    ok = pack &&
+         ftn_pack_append(pack, article, strlen(article), &number) == FTN_OK &&
+         ftn_pack_append(pack, short_article, strlen(short_article), &number) == FTN_OK;
+    if (!ok) {
+        test_fail("Failed to append articles");
+    } else if (pack->bytes_out * 3 > pack->bytes_in) {
+        test_fail("Articles did not compress");
+    }
+    ftn_pack_close(pack);
+    if (!ok) {
+        return;
+    }
+
+    /* A plain article appended later to the same pack */
+    pack = ftn_pack_open(TEST_ROOT "/compressed", FTN_PACK_WRITE);
+    if (!pack || ftn_pack_append(pack, article, strlen(article), &number) != FTN_OK || number != 3) {
+        test_fail("Failed to append a plain article");
+    } else if (ftn_pack_entry(pack, 1, &entry) != FTN_OK || !entry.compressed || entry.length >= strlen(article)) {
+        test_fail("First article was not stored compressed");
+    } else if (ftn_pack_entry(pack, 2, &entry) != FTN_OK || entry.compressed) {
+        test_fail("Short article was compressed");
+    } else if (ftn_pack_read(pack, 1, &read, &length) != FTN_OK || length != strlen(article) ||
+               strcmp(read, article) != 0) {
+        test_fail("Compressed article reads back wrongly");
+    } else {
+        free(read);
+        read = NULL;
+        if (ftn_pack_read(pack, 3, &read, &length) != FTN_OK || strcmp(read, article) != 0 ||
+            ftn_pack_entry(pack, 3, &entry) != FTN_OK || entry.compressed) {
+            test_fail("Plain article reads back wrongly");
+        } else {
+            test_pass();
+        }
+    }
+
+    free(read);
+    ftn_pack_close(pack);
+}
+
+static ftn_message_t* create_echomail(const char* msgid, const char* text) {
+    ftn_message_t* msg = ftn_message_new(FTN_MSG_ECHOMAIL);
+    if (!msg) return NULL;
+
+    msg->orig_addr.zone = 1;
+    msg->orig_addr.net = 2;
+    msg->orig_addr.node = 3;
+    msg->timestamp = 1700000000;
+    msg->from_user = strdup("Test Sender");
+    msg->to_user = strdup("All");
+    msg->subject = strdup("Pack test");
+    msg->area = strdup("TESTAREA");
+    msg->text = strdup(text);
+    msg->msgid = strdup(msgid);
+    return msg;
+}
+
+static int active_has_line(const char* expected) {
+    char line[256];
+    int found = 0;
+    FILE* fp = fopen(TEST_ROOT "/news/" FTN_USENET_ACTIVE_FILE, "r");
+
+    if (!fp) return 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strcmp(line, expected) == 0) {
+            found = 1;
+        }
+    }
+    fclose(fp);
+    return found;
+}
+
+void test_storage_pack(void) {
+    ftn_config_t* config;
+    ftn_storage_t* storage;
+    ftn_message_t* msg;
+    FILE* fp;
+
+    test_start("storage spools into packs");
+
+    config = ftn_config_new();
+    config->news = malloc(sizeof(ftn_news_config_t));
+    memset(config->news, 0, sizeof(ftn_news_config_t));
+    config->news->path = malloc(64);
+    strcpy(config->news->path, TEST_ROOT "/news");
+    config->news->pack = 1;
+
+    storage = ftn_storage_new(config);
+    msg = create_echomail("1:2/3 00000001", "Packed");
+    if (!storage || !msg || ftn_storage_initialize(storage) != FTN_OK) {
+        test_fail("Failed to set up storage");
+        goto cleanup;
+    }
+
+    /* Groups the packs do not know about are left alone */
+    fp = fopen(TEST_ROOT "/news/" FTN_USENET_ACTIVE_FILE, "w");
+    if (fp) {
+        fputs("local.test 7 3 y\n", fp);
+        fclose(fp);
+    }
+
+    if (ftn_storage_store_news(storage, msg, "TESTAREA", "fidonet") != FTN_OK ||
+        ftn_storage_store_news(storage, msg, "OTHER", "fidonet") != FTN_OK ||
+        ftn_storage_store_news(storage, msg, "TESTAREA", "fidonet") != FTN_OK) {
+        test_fail("Failed to store articles");
+    } else if (active_has_line("fidonet.testarea 2 1 y\n")) {
+        test_fail("Active file was updated before the flush");
+    } else if (ftn_storage_flush(storage) != FTN_OK) {
+        test_fail("Failed to flush");
+    } else if (!active_has_line("fidonet.testarea 2 1 y\n") || !active_has_line("fidonet.other 1 1 y\n") ||
+               !active_has_line("local.test 7 3 y\n")) {
+        test_fail("Wrong active file");
+    } else if (access(TEST_ROOT "/news/fidonet/testarea.pack", F_OK) != 0 ||
+               access(TEST_ROOT "/news/fidonet/testarea/1", F_OK) == 0) {
+        test_fail("Articles were not packed");
+    } else if (ftn_storage_store_news(storage, msg, "TESTAREA", "fidonet") != FTN_OK ||
+               ftn_storage_flush(storage) != FTN_OK || !active_has_line("fidonet.testarea 3 1 y\n")) {
+        test_fail("Existing active entry was not updated");
+    } else {
+        test_pass();
+    }
+
+cleanup:
+    ftn_message_free(msg);
+    ftn_storage_free(storage);
+    ftn_config_free(config);
+}
+
+int main(void) {
+    printf("Pack Spool Tests\n");
+    printf("================\n\n");
+
+    test_append_read();
+    test_overview();
+    test_compressed();
+    test_storage_pack();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -352,6 +352,85 @@ static void test_packet_roundtrip(void) {
     printf("Packet save/load roundtrip: PASSED\n");
 }
 
+static void test_packet_writer(void) {
+    ftn_packet_writer_t* writer;
+    ftn_packet_header_t header;
+    ftn_packet_t* loaded_packet;
+    ftn_message_t* message;
+    const char* test_filename = "test_writer.pkt";
+    FILE* fp;
+    char subject[16];
+    int i;
+    
+    printf("Testing streaming packet writer...\n");
+    
+    memset(&header, 0, sizeof(header));
+    header.orig_zone = 1;
+    header.orig_net = 100;
+    header.orig_node = 1;
+    header.dest_zone = 1;
+    header.dest_net = 200;
+    header.dest_node = 2;
+    header.packet_type = 0x0002;
+    
+    remove(test_filename);
+    writer = ftn_packet_writer_open(test_filename, &header);
+    assert(writer != NULL);
+    assert(writer->size == 58);
+    
+    for (i = 0; i < 3; i++) {
+        message = ftn_message_new(FTN_MSG_NETMAIL);
+        assert(message != NULL);
+        sprintf(subject, "Subject %d", i);
+        message->to_user = strdup("Test User");
+        message->from_user = strdup("Test Sender");
+        message->subject = strdup(subject);
+        message->text = strdup("Streamed message body.");
+        message->orig_addr.zone = 1;
+        message->orig_addr.net = 100;
+        message->orig_addr.node = 1;
+        message->dest_addr.zone = 1;
+        message->dest_addr.net = 200;
+        message->dest_addr.node = 2;
+        assert(ftn_packet_writer_append(writer, message) == FTN_OK);
+        ftn_message_free(message);
+    }
+    assert(writer->message_count == 3);
+    assert(writer->size > 58);
+
+    /* A synced packet holds every appended message on disk */
+    assert(ftn_packet_writer_sync(writer) == FTN_OK);
+    fp = fopen("test_writer.pkt.tmp", "rb");
+    assert(fp != NULL);
+    assert(fseek(fp, 0, SEEK_END) == 0);
+    assert((size_t)ftell(fp) == writer->size);
+    fclose(fp);
+
+    /* Nothing is visible under the final name until the writer is closed */
+    fp = fopen(test_filename, "rb");
+    assert(fp == NULL);
+    
+    assert(ftn_packet_writer_close(writer) == FTN_OK);
+    
+    assert(ftn_packet_load(test_filename, &loaded_packet) == FTN_OK);
+    assert(loaded_packet->message_count == 3);
+    assert(loaded_packet->header.dest_net == 200);
+    assert(strcmp(loaded_packet->messages[2]->subject, "Subject 2") == 0);
+    ftn_packet_free(loaded_packet);
+    remove(test_filename);
+    
+    /* An aborted packet leaves nothing behind */
+    writer = ftn_packet_writer_open(test_filename, &header);
+    assert(writer != NULL);
+    ftn_packet_writer_abort(writer);
+    fp = fopen("test_writer.pkt.tmp", "rb");
+    assert(fp == NULL);
+    fp = fopen(test_filename, "rb");
+    assert(fp == NULL);
+    
+    printf("Streaming packet writer: PASSED\n");
+}
+
 int main(void) {
     printf("Running packet and message tests...\n\n");
     
@@ -364,6 +443,7 @@ int main(void) {
     test_message_text_creation();
     test_packet_creation();
     test_packet_roundtrip();
+    test_packet_writer();
     
     printf("\nAll packet and message tests passed!\n");
     return 0;
@@ -25,8 +25,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include "ftn.h"
 #include "ftn/binkp.h"
 #include "ftn/binkp/plz.h"
+#include "ftn/binkp/capture.h"
+#include "ftn/mailer.h"
 
 static int test_plz_context_lifecycle(void) {
     ftn_plz_context_t ctx;
@@ -258,6 +261,251 @@ static int test_plz_no_compression_mode(void) {
     return 1;
 }
 
+static int test_plz_choose_level(void) {
+    printf("Testing PLZ adaptive level choice... ");
+
+    /* Deflate slower than the link: step down */
+    if (ftn_plz_choose_level(6, 1000.0, 5000.0) != 5 ||
+        ftn_plz_choose_level(1, 1000.0, 5000.0) != 1) {
+        printf("FAIL: did not step down for a fast link\n");
+        return 0;
+    }
+
+    /* Link much slower than deflate: step up */
+    if (ftn_plz_choose_level(6, 50000.0, 1000.0) != 7 ||
+        ftn_plz_choose_level(9, 50000.0, 1000.0) != 9) {
+        printf("FAIL: did not step up for a slow link\n");
+        return 0;
+    }
+
+    /* Balanced, or no measurement: stay */
+    if (ftn_plz_choose_level(6, 3000.0, 2000.0) != 6 ||
+        ftn_plz_choose_level(6, 0.0, 2000.0) != 6) {
+        printf("FAIL: changed level without reason\n");
+        return 0;
+    }
+
+    printf("PASS\n");
+    return 1;
+}
+
+static int test_plz_adaptive_roundtrip(void) {
+    ftn_plz_context_t ctx;
+    uint8_t* input;
+    uint8_t* compressed = NULL;
+    uint8_t* decompressed = NULL;
+    size_t compressed_len = 0;
+    size_t decompressed_len = 0;
+    size_t input_len = 16384;
+    size_t i;
+    int frame;
+    int ok = 1;
+
+    printf("Testing PLZ adaptive level roundtrip... ");
+
+    input = malloc(input_len);
+    if (!input || ftn_plz_init(&ctx) != BINKP_OK) {
+        printf("FAIL: init failed\n");
+        free(input);
+        return 0;
+    }
+    for (i = 0; i < input_len; i++) {
+        input[i] = (uint8_t)("FidoNet echomail "[i % 17] + (i / 997) % 3);
+    }
+
+    ftn_plz_set_mode(&ctx, PLZ_MODE_SUPPORTED);
+    ftn_plz_set_level(&ctx, PLZ_LEVEL_AUTO);
+    ftn_plz_set_adaptive(&ctx, PLZ_LEVEL_BEST);
+    ftn_plz_negotiate(&ctx, "PLZ");
+
+    /* A link that drains every frame in a microsecond makes deflate the bottleneck */
+    for (frame = 0; frame < 8 && ok; frame++) {
+        if (ftn_plz_compress_data(&ctx, input, input_len, &compressed, &compressed_len) != BINKP_OK ||
+            ftn_plz_decompress_data(&ctx, compressed, compressed_len, &decompressed, &decompressed_len) != BINKP_OK) {
+            printf("FAIL: frame %d did not round trip\n", frame);
+            ok = 0;
+        } else if (decompressed_len != input_len || memcmp(decompressed, input, input_len) != 0) {
+            printf("FAIL: frame %d data mismatch\n", frame);
+            ok = 0;
+        }
+        ftn_plz_record_drain(&ctx, compressed_len, 1);
+        free(compressed);
+        free(decompressed);
+        compressed = NULL;
+        decompressed = NULL;
+    }
+
+    if (ok && (ctx.level_changes == 0 || ftn_plz_current_level(&ctx) >= PLZ_LEVEL_BEST)) {
+        printf("FAIL: level did not adapt (level %d)\n", ftn_plz_current_level(&ctx));
+        ok = 0;
+    }
+
+    if (ok) {
+        printf("PASS (settled at level %d)\n", ftn_plz_current_level(&ctx));
+    }
+
+    free(input);
+    ftn_plz_free(&ctx);
+    return ok;
+}
+
+static int test_plz_history(void) {
+    ftn_plz_context_t ctx;
+    ftn_plz_history_t* history;
+    int status;
+    int ok = 1;
+
+    printf("Testing PLZ per-link history... ");
+
+    status = system("rm -rf tmp/test_plz && mkdir -p tmp/test_plz");
+    (void)status;
+
+    ftn_plz_init(&ctx);
+    ftn_plz_set_adaptive(&ctx, 3);
+    ctx.compress_rate = 2000000.0;
+    ctx.drain_rate = 50000.0;
+
+    history = ftn_plz_history_new("tmp/test_plz/plz.history");
+    if (!history || ftn_plz_history_update(history, "2:5020/1@fidonet", &ctx) != BINKP_OK ||
+        ftn_plz_history_save(history) != BINKP_OK) {
+        printf("FAIL: could not save history\n");
+        ok = 0;
+    }
+    ftn_plz_history_free(history);
+
+    if (ok) {
+        history = ftn_plz_history_new("tmp/test_plz/plz.history");
+        if (!history || ftn_plz_history_load(history) != BINKP_OK) {
+            printf("FAIL: could not load history\n");
+            ok = 0;
+        } else if (ftn_plz_history_level(history, "2:5020/1@fidonet") != 3 ||
+                   ftn_plz_history_level(history, "1:2/3") != 0) {
+            printf("FAIL: wrong levels in history\n");
+            ok = 0;
+        }
+        ftn_plz_history_free(history);
+    }
+
+    if (ok) {
+        printf("PASS\n");
+    }
+
+    ftn_plz_free(&ctx);
+    return ok;
+}
+
+/* Helper function to record one command frame */
+static void record_command(ftn_binkp_capture_t* capture, ftn_binkp_capture_dir_t direction,
+                           ftn_binkp_command_t cmd, const char* args) {
+    ftn_binkp_command_frame_t cmd_frame;
+    ftn_binkp_frame_t frame;
+
+    ftn_binkp_command_init(&cmd_frame);
+    ftn_binkp_frame_init(&frame);
+    if (ftn_binkp_command_create(&cmd_frame, cmd, args) == BINKP_OK &&
+        ftn_binkp_command_to_frame(&cmd_frame, &frame) == BINKP_OK) {
+        ftn_binkp_capture_record(capture, direction, &frame);
+    }
+    ftn_binkp_command_free(&cmd_frame);
+    ftn_binkp_frame_free(&frame);
+}
+
+static int test_plz_session(void) {
+    ftn_plz_context_t seed;
+    ftn_plz_context_t plz;
+    ftn_plz_history_t* history;
+    ftn_binkp_capture_t* capture;
+    ftn_binkp_replay_t* replay = NULL;
+    ftn_binkp_session_t session;
+    ftn_binkp_frame_t frame;
+    ftn_config_t config;
+    ftn_network_config_t network;
+    ftn_network_context_t net;
+    uint8_t data[4096];
+    size_t sent_before;
+    int status;
+    int ok = 1;
+
+    printf("Testing PLZ in the session write path... ");
+
+    status = system("rm -rf tmp/test_plz && mkdir -p tmp/test_plz");
+    (void)status;
+
+    /* The link settled on level 3 last time */
+    ftn_plz_init(&seed);
+    ftn_plz_set_adaptive(&seed, 3);
+    history = ftn_plz_history_new("tmp/test_plz/plz.history");
+    ftn_plz_history_update(history, "2:5020/1@fidonet", &seed);
+    ftn_plz_history_save(history);
+    ftn_plz_history_free(history);
+    ftn_plz_free(&seed);
+
+    /* The peer offers PLZ */
+    capture = ftn_binkp_capture_open("tmp/test_plz/session.bkc", 1);
+    record_command(capture, BINKP_CAPTURE_RECEIVED, BINKP_M_NUL, "OPT PLZ");
+    record_command(capture, BINKP_CAPTURE_RECEIVED, BINKP_M_ADR, "2:5020/1@fidonet");
+    record_command(capture, BINKP_CAPTURE_RECEIVED, BINKP_M_EOB, "");
+    ftn_binkp_capture_close(capture);
+
+    memset(&config, 0, sizeof(config));
+    memset(&network, 0, sizeof(network));
+    network.section_name = "fidonet";
+    network.address_str = "1:2/3";
+    network.use_compression = 1;
+    network.plz_mode = PLZ_MODE_SUPPORTED;
+    network.plz_level = PLZ_LEVEL_AUTO;
+    network.plz_history = "tmp/test_plz/plz.history";
+    config.networks = &network;
+    config.network_count = 1;
+    memset(&net, 0, sizeof(net));
+    net.config = &network;
+
+    replay = ftn_binkp_replay_load("tmp/test_plz/session.bkc");
+    if (!replay || ftn_binkp_session_init_replay(&session, replay, &config) != BINKP_OK) {
+        printf("FAIL: could not set up replay\n");
+        ftn_binkp_replay_free(replay);
+        return 0;
+    }
+
+    if (ftn_mailer_setup_plz(&net, &session, &plz) != FTN_OK) {
+        printf("FAIL: could not set up PLZ\n");
+        ok = 0;
+    } else if (ftn_binkp_session_run(&session) != BINKP_OK) {
+        printf("FAIL: session did not complete\n");
+        ok = 0;
+    } else if (!ftn_plz_is_negotiated(&plz) || ftn_plz_current_level(&plz) != 3) {
+        printf("FAIL: PLZ not negotiated from the remembered level\n");
+        ok = 0;
+    } else if (!net.plz_history || !net.plz_history->modified) {
+        printf("FAIL: session did not update the history\n");
+        ok = 0;
+    } else {
+        /* A compressible data frame goes out smaller than it came in */
+        memset(data, 'A', sizeof(data));
+        ftn_binkp_frame_init(&frame);
+        ftn_binkp_frame_create(&frame, 0, data, sizeof(data));
+        sent_before = session.bytes_sent;
+        if (ftn_binkp_send_frame(&session, &frame) != BINKP_OK ||
+            session.bytes_sent - sent_before >= sizeof(data) || plz.bytes_sent_compressed == 0) {
+            printf("FAIL: data frame not compressed\n");
+            ok = 0;
+        }
+        ftn_binkp_frame_free(&frame);
+    }
+
+    if (ok) {
+        printf("PASS\n");
+    }
+
+    ftn_binkp_session_free(&session);
+    ftn_binkp_replay_free(replay);
+    ftn_plz_free(&plz);
+    if (net.plz_history) {
+        ftn_plz_history_free(net.plz_history);
+    }
+    return ok;
+}
+
 int main(void) {
     int passed = 0;
     int total = 0;
@@ -269,6 +517,10 @@ int main(void) {
     total++; if (test_plz_compression_roundtrip()) passed++;
     total++; if (test_plz_compression_levels()) passed++;
     total++; if (test_plz_no_compression_mode()) passed++;
+    total++; if (test_plz_choose_level()) passed++;
+    total++; if (test_plz_adaptive_roundtrip()) passed++;
+    total++; if (test_plz_history()) passed++;
+    total++; if (test_plz_session()) passed++;
 
     printf("\nTest Results: %d/%d tests passed\n", passed, total);
 
@@ -411,6 +411,171 @@ void test_basic_routing(void) {
     test_pass();
 }
 
+/* Test per-rule profiling counters */
+void test_rule_profiling(void) {
+    ftn_config_t* config;
+    ftn_router_t* router;
+    ftn_message_t* msg;
+    ftn_routing_decision_t* decision;
+    ftn_routing_rule_t* rule;
+    ftn_address_t test_addr = {1, 1, 100, 0};
+    FILE* fp;
+    int i;
+
+    test_start("rule profiling");
+
+    config = create_test_config();
+    router = ftn_router_new(config, NULL);
+    decision = ftn_routing_decision_new();
+    rule = ftn_routing_rule_new();
+    msg = create_test_netmail("testuser", "sysop", &test_addr, &test_addr);
+
+    if (!router || !decision || !rule || !msg) {
+        test_fail("Failed to set up router");
+        goto cleanup;
+    }
+
+    /* An area rule never matches netmail, so the address rule decides */
+    ftn_routing_rule_set(rule, "areas", "area:FIDO.*", FTN_ROUTE_LOCAL_NEWS, NULL, 1);
+    ftn_router_add_rule(router, rule);
+    ftn_routing_rule_free(rule);
+    rule = ftn_routing_rule_new();
+    if (!rule) {
+        test_fail("Failed to create routing rule");
+        goto cleanup;
+    }
+    ftn_routing_rule_set(rule, "zone1", "addr:1:*", FTN_ROUTE_LOCAL_MAIL, NULL, 2);
+    ftn_router_add_rule(router, rule);
+
+    /* Counted, but not timed, until profiling is enabled */
+    if (ftn_router_route_message(router, msg, decision) != FTN_OK ||
+        router->rules[1]->evaluations != 1 || router->rules[1]->match_time != 0.0) {
+        test_fail("Rules timed without profiling");
+        goto cleanup;
+    }
+    ftn_routing_decision_free(decision);
+    decision = ftn_routing_decision_new();
+    if (!decision) {
+        test_fail("Failed to create decision");
+        goto cleanup;
+    }
+    ftn_router_reset_rule_stats(router);
+    ftn_router_set_profiling(router, 1);
+
+    for (i = 0; i < 3; i++) {
+        if (ftn_router_route_message(router, msg, decision) != FTN_OK) {
+            test_fail("Failed to route message");
+            goto cleanup;
+        }
+        ftn_routing_decision_free(decision);
+        decision = ftn_routing_decision_new();
+        if (!decision) {
+            test_fail("Failed to create decision");
+            goto cleanup;
+        }
+    }
+
+    if (router->rules[0]->evaluations != 3 || router->rules[0]->matches != 0) {
+        test_fail("Area rule counters are wrong");
+        goto cleanup;
+    }
+    if (router->rules[1]->evaluations != 3 || router->rules[1]->matches != 3) {
+        test_fail("Address rule counters are wrong");
+        goto cleanup;
+    }
+    if (router->rules[0]->match_time < 0.0 || router->rules[1]->match_time < 0.0) {
+        test_fail("Match time went negative");
+        goto cleanup;
+    }
+
+    fp = fopen("tmp/test_router_profile.txt", "w");
+    if (!fp) {
+        test_fail("Failed to open profile report");
+        goto cleanup;
+    }
+    ftn_router_print_rule_profile(router, fp);
+    fclose(fp);
+
+    ftn_router_reset_rule_stats(router);
+    if (router->rules[1]->evaluations != 0 || router->rules[1]->matches != 0 ||
+        router->rules[1]->match_time != 0.0) {
+        test_fail("Counters were not reset");
+        goto cleanup;
+    }
+
+    test_pass();
+
+cleanup:
+    if (msg) ftn_message_free(msg);
+    if (rule) ftn_routing_rule_free(rule);
+    if (decision) ftn_routing_decision_free(decision);
+    if (router) ftn_router_free(router);
+    if (config) ftn_config_free(config);
+}
+
+void test_area_rule_cache(void) {
+    ftn_config_t* config;
+    ftn_router_t* router;
+    ftn_routing_decision_t* decision = NULL;
+    ftn_routing_rule_t* rule;
+    ftn_message_t* msgs[3];
+    ftn_routing_action_t expected[3];
+    int i;
+
+    test_start("area rule result cache");
+
+    config = create_test_config();
+    router = ftn_router_new(config, NULL);
+    rule = ftn_routing_rule_new();
+    msgs[0] = create_test_echomail("FIDO.TEST", "All", "sysop");
+    msgs[1] = create_test_echomail("fido.test", "All", "sysop");
+    msgs[2] = create_test_echomail("LOCAL.CHAT", "All", "sysop");
+    expected[0] = FTN_ROUTE_DROP;
+    expected[1] = FTN_ROUTE_DROP;
+    expected[2] = FTN_ROUTE_LOCAL_NEWS;
+
+    if (!router || !rule || !msgs[0] || !msgs[1] || !msgs[2]) {
+        test_fail("Failed to set up router");
+        goto cleanup;
+    }
+
+    ftn_routing_rule_set(rule, "fido", "area:FIDO.*", FTN_ROUTE_DROP, "filtered", 1);
+    ftn_router_add_rule(router, rule);
+
+    for (i = 0; i < 3; i++) {
+        decision = ftn_routing_decision_new();
+        if (!decision || ftn_router_route_message(router, msgs[i], decision) != FTN_OK) {
+            test_fail("Failed to route message");
+            goto cleanup;
+        }
+        if (decision->action != expected[i]) {
+            test_fail("Wrong routing decision");
+            goto cleanup;
+        }
+        ftn_routing_decision_free(decision);
+        decision = NULL;
+    }
+
+    /* Both spellings of FIDO.TEST share one interned area */
+    if (router->rules[0]->last_area_id != ftn_intern_find(FTN_INTERN_AREA, "LOCAL.CHAT") ||
+        router->rules[0]->last_area_match != 0 ||
+        ftn_intern_find(FTN_INTERN_AREA, "FIDO.TEST") != ftn_intern_find(FTN_INTERN_AREA, "fido.test")) {
+        test_fail("Area result was not cached by interned ID");
+        goto cleanup;
+    }
+
+    test_pass();
+
+cleanup:
+    for (i = 0; i < 3; i++) {
+        if (msgs[i]) ftn_message_free(msgs[i]);
+    }
+    if (rule) ftn_routing_rule_free(rule);
+    if (decision) ftn_routing_decision_free(decision);
+    if (router) ftn_router_free(router);
+    if (config) ftn_config_free(config);
+}
+
 int main(void) {
     printf("Router Tests\n");
     printf("============\n\n");
@@ -423,6 +588,10 @@ int main(void) {
     test_routing_rule_management();
     test_address_validation();
     test_basic_routing();
+    test_rule_profiling();
+    test_area_rule_cache();
+
+    ftn_intern_cleanup();
 
     /* Print summary */
     printf("\nTest Summary: %d/%d tests passed\n", tests_passed, tests_run);
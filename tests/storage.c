@@ -13,6 +13,7 @@
 #include "ftn.h"
 #include "ftn/storage.h"
 #include "ftn/config.h"
+#include "ftn/intern.h"
 #include "ftn/packet.h"
 
 static int tests_run = 0;
@@ -161,6 +162,57 @@ void test_path_templating(void) {
     test_pass();
 }
 
+/* Test compiled path templates */
+void test_compiled_path_template(void) {
+    ftn_path_template_t* tpl;
+    char* result;
+
+    test_start("compiled path template");
+
+    tpl = ftn_path_template_compile("/var/mail/%NETWORK%/%USER%/Maildir");
+    if (!tpl) {
+        test_fail("Failed to compile template");
+        return;
+    }
+
+    if (tpl->segment_count != 5 || !tpl->uses_user || !tpl->uses_network ||
+        tpl->literal_length != strlen("/var/mail///Maildir")) {
+        test_fail("Template was not split into segments");
+        ftn_path_template_free(tpl);
+        return;
+    }
+
+    result = ftn_path_template_expand(tpl, "bob", "fidonet");
+    if (!result || strcmp(result, "/var/mail/fidonet/bob/Maildir") != 0) {
+        test_fail("Expansion failed");
+        free(result);
+        ftn_path_template_free(tpl);
+        return;
+    }
+    free(result);
+
+    /* Variables without a value are kept as written */
+    result = ftn_path_template_expand(tpl, NULL, "fsxnet");
+    if (!result || strcmp(result, "/var/mail/fsxnet/%USER%/Maildir") != 0) {
+        test_fail("Missing user was not kept");
+        free(result);
+        ftn_path_template_free(tpl);
+        return;
+    }
+    free(result);
+    ftn_path_template_free(tpl);
+
+    tpl = ftn_path_template_compile("/var/mail/inbox");
+    if (!tpl || tpl->segment_count != 1 || tpl->uses_user || tpl->uses_network) {
+        test_fail("Plain path was not one literal segment");
+        ftn_path_template_free(tpl);
+        return;
+    }
+    ftn_path_template_free(tpl);
+
+    test_pass();
+}
+
 /* Test directory creation */
 void test_directory_creation(void) {
     const char* test_dir = "tmp/test_storage_dir";
@@ -500,6 +552,244 @@ void test_basic_mail_storage(void) {
     test_pass();
 }
 
+/* Test that resolved Maildirs are cached per user and network */
+void test_maildir_cache(void) {
+    ftn_config_t* config;
+    ftn_storage_t* storage = NULL;
+    ftn_message_t* msg = NULL;
+    struct stat st;
+    char user[32];
+    int status;
+    int i;
+
+    test_start("maildir cache");
+
+    status = system("rm -rf tmp/test_storage_cache");
+    (void)status;
+
+    config = create_test_config();
+    if (!config) {
+        test_fail("Failed to create test config");
+        return;
+    }
+    config->mail = malloc(sizeof(ftn_mail_config_t));
+    if (!config->mail) {
+        test_fail("Failed to allocate mail config");
+        ftn_config_free(config);
+        return;
+    }
+    memset(config->mail, 0, sizeof(ftn_mail_config_t));
+    config->mail->inbox = malloc(64);
+    if (!config->mail->inbox) {
+        test_fail("Failed to allocate inbox");
+        ftn_config_free(config);
+        return;
+    }
+    strcpy(config->mail->inbox, "tmp/test_storage_cache/%NETWORK%/%USER%");
+
+    storage = ftn_storage_new(config);
+    msg = create_test_message(FTN_MSG_NETMAIL, "alice", "sysop");
+    if (!storage || !msg) {
+        test_fail("Failed to create storage or message");
+        goto cleanup;
+    }
+
+    if (ftn_storage_store_mail(storage, msg, "alice", "fidonet") != FTN_OK ||
+        ftn_storage_store_mail(storage, msg, "alice", "fidonet") != FTN_OK) {
+        test_fail("Failed to store mail");
+        goto cleanup;
+    }
+    if (storage->maildir_count != 1) {
+        test_fail("Repeated delivery added a second cache entry");
+        goto cleanup;
+    }
+
+    if (ftn_storage_store_mail(storage, msg, "bob", "fidonet") != FTN_OK ||
+        ftn_storage_store_mail(storage, msg, "alice", "fsxnet") != FTN_OK) {
+        test_fail("Failed to store mail for other pairs");
+        goto cleanup;
+    }
+    if (storage->maildir_count != 3) {
+        test_fail("Expected one cache entry per user and network");
+        goto cleanup;
+    }
+
+    /* A Maildir that disappears is created again on the next delivery */
+    if (rename("tmp/test_storage_cache/fidonet/alice", "tmp/test_storage_cache/fidonet/alice.old") != 0) {
+        test_fail("Failed to move Maildir away");
+        goto cleanup;
+    }
+    if (ftn_storage_store_mail(storage, msg, "alice", "fidonet") != FTN_OK) {
+        test_fail("Failed to store mail after Maildir was removed");
+        goto cleanup;
+    }
+    if (stat("tmp/test_storage_cache/fidonet/alice/new", &st) != 0 || !S_ISDIR(st.st_mode)) {
+        test_fail("Maildir was not recreated");
+        goto cleanup;
+    }
+
+    /* So is a new/ that disappears while tmp/ is still there */
+    status = system("rm -rf tmp/test_storage_cache/fidonet/alice/new");
+    (void)status;
+    if (ftn_storage_store_mail(storage, msg, "alice", "fidonet") != FTN_OK) {
+        test_fail("Failed to store mail after new/ was removed");
+        goto cleanup;
+    }
+    if (stat("tmp/test_storage_cache/fidonet/alice/new", &st) != 0 || !S_ISDIR(st.st_mode)) {
+        test_fail("new/ was not recreated");
+        goto cleanup;
+    }
+
+    /* Mail for more users than the cache holds empties it instead of growing it */
+    for (i = 0; i <= FTN_STORAGE_MAILDIR_MAX; i++) {
+        sprintf(user, "user%d", i);
+        if (ftn_storage_store_mail(storage, msg, user, "fidonet") != FTN_OK) {
+            test_fail("Failed to store mail for many users");
+            goto cleanup;
+        }
+        if (storage->maildir_count > FTN_STORAGE_MAILDIR_MAX) {
+            test_fail("Maildir cache grew past its limit");
+            goto cleanup;
+        }
+    }
+    if (ftn_storage_store_mail(storage, msg, "alice", "fidonet") != FTN_OK) {
+        test_fail("Failed to store mail after the cache was emptied");
+        goto cleanup;
+    }
+
+    test_pass();
+
+cleanup:
+    if (msg) ftn_message_free(msg);
+    if (storage) ftn_storage_free(storage);
+    ftn_config_free(config);
+}
+
+/* Store echomail for two areas, one of them twice */
+static int store_two_areas(ftn_storage_t* storage, const ftn_message_t* msg) {
+    return ftn_storage_store_news(storage, msg, "NEWAREA", "fidonet") == FTN_OK &&
+           ftn_storage_store_news(storage, msg, "OTHERAREA", "fidonet") == FTN_OK &&
+           ftn_storage_store_news(storage, msg, "NEWAREA", "fidonet") == FTN_OK;
+}
+
+/* New areas are still stored once the intern table is full. Run last, as
+   it leaves the process-wide table full until it is cleaned up. */
+void test_intern_table_full(void) {
+    ftn_config_t* config;
+    ftn_storage_t* spool = NULL;
+    ftn_storage_t* packs = NULL;
+    ftn_message_t* msg = NULL;
+    char name[32];
+    char line[256];
+    struct stat st;
+    FILE* fp;
+    int listed = 0;
+    int status;
+    int i;
+
+    test_start("storage with a full intern table");
+
+    status = system("rm -rf tmp/test_storage_full && mkdir -p tmp/test_storage_full");
+    (void)status;
+
+    config = create_test_config();
+    if (!config || !(config->news = calloc(1, sizeof(ftn_news_config_t))) ||
+        !(config->news->path = malloc(64)) || !(config->news->jam = malloc(64))) {
+        test_fail("Failed to create test config");
+        ftn_config_free(config);
+        return;
+    }
+    strcpy(config->news->path, "tmp/test_storage_full/news");
+    strcpy(config->news->jam, "tmp/test_storage_full/jam");
+    if (!(config->mail = calloc(1, sizeof(ftn_mail_config_t))) || !(config->mail->inbox = malloc(64))) {
+        test_fail("Failed to create mail config");
+        ftn_config_free(config);
+        return;
+    }
+    strcpy(config->mail->inbox, "tmp/test_storage_full/mail/%USER%");
+
+    /* The network is interned first, as the tosser would have done */
+    ftn_intern(FTN_INTERN_NETWORK, "fidonet");
+    for (i = 0; ; i++) {
+        sprintf(name, "FILL.%d", i);
+        if (ftn_intern(FTN_INTERN_AREA, name) == FTN_INTERN_NONE) {
+            break;
+        }
+    }
+    for (i = 0; ; i++) {
+        sprintf(name, "user%d", i);
+        if (ftn_intern(FTN_INTERN_USER, name) == FTN_INTERN_NONE) {
+            break;
+        }
+    }
+    if (ftn_intern_find(FTN_INTERN_AREA, "NEWAREA") != FTN_INTERN_NONE ||
+        ftn_intern_find(FTN_INTERN_USER, "newuser") != FTN_INTERN_NONE) {
+        test_fail("Intern table did not fill");
+        goto cleanup;
+    }
+
+    msg = create_test_message(FTN_MSG_ECHOMAIL, "All", "sysop");
+    spool = ftn_storage_new(config);
+    config->news->pack = 1;
+    packs = ftn_storage_new(config);
+    if (!msg || !spool || !packs) {
+        test_fail("Failed to create storage or message");
+        goto cleanup;
+    }
+
+    if (ftn_storage_store_mail(spool, msg, "newuser", "fidonet") != FTN_OK ||
+        ftn_storage_store_mail(spool, msg, "newuser", "fidonet") != FTN_OK ||
+        stat("tmp/test_storage_full/mail/newuser/new", &st) != 0) {
+        test_fail("Failed to store mail for a new user");
+        goto cleanup;
+    }
+    if (spool->maildir_count != 0) {
+        test_fail("User outside the intern table was cached");
+        goto cleanup;
+    }
+    if (!store_two_areas(spool, msg)) {
+        test_fail("Failed to store articles in the spool");
+        goto cleanup;
+    }
+    if (spool->jam_count != 2) {
+        test_fail("Expected one JAM base per area");
+        goto cleanup;
+    }
+    if (!store_two_areas(packs, msg)) {
+        test_fail("Failed to store articles in packs");
+        goto cleanup;
+    }
+    if (packs->pack_count != 2) {
+        test_fail("Expected one pack per area");
+        goto cleanup;
+    }
+    if (ftn_storage_flush(spool) != FTN_OK || ftn_storage_flush(packs) != FTN_OK) {
+        test_fail("Failed to flush");
+        goto cleanup;
+    }
+
+    fp = fopen("tmp/test_storage_full/news/active", "r");
+    while (fp && fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "fidonet.newarea ", 16) == 0 || strncmp(line, "fidonet.otherarea ", 18) == 0) {
+            listed++;
+        }
+    }
+    if (fp) fclose(fp);
+    if (listed < 2) {
+        test_fail("New areas missing from the active file");
+        goto cleanup;
+    }
+
+    test_pass();
+
+cleanup:
+    if (msg) ftn_message_free(msg);
+    if (spool) ftn_storage_free(spool);
+    if (packs) ftn_storage_free(packs);
+    ftn_config_free(config);
+    ftn_intern_cleanup();
+}
+
 int main(void) {
     printf("Storage Tests\n");
     printf("=============\n\n");
@@ -507,6 +797,7 @@ int main(void) {
     /* Run all tests */
     test_storage_lifecycle();
     test_path_templating();
+    test_compiled_path_template();
     test_directory_creation();
     test_recursive_directory_creation();
     test_maildir_creation();
@@ -514,6 +805,8 @@ int main(void) {
     test_message_list_operations();
     test_atomic_file_writing();
     test_basic_mail_storage();
+    test_maildir_cache();
+    test_intern_table_full();
 
     /* Print summary */
     printf("\nTest Summary: %d/%d tests passed\n", tests_passed, tests_run);
@@ -0,0 +1,474 @@
+/*
+ * test_tic.c - TIC file echo processing tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/tic.h"
+#include "ftn/areafix.h"
+#include "ftn/flow.h"
+#include "ftn/binkp/crc.h"
+
+#define TEST_ROOT     "tmp/test_tic"
+#define TEST_INBOUND  TEST_ROOT "/in"
+#define TEST_AREAS    TEST_ROOT "/areas"
+#define TEST_FILEBOX  TEST_ROOT "/boxes"
+#define TEST_OUTBOUND TEST_ROOT "/outbound"
+#define TEST_BAD      TEST_ROOT "/bad"
+#define TEST_CONTENT  "This is the file being distributed.\r\n"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* Helper function to start from empty directories */
+void reset_test_dirs(void) {
+    int status;
+
+    status = system("rm -rf " TEST_ROOT " && mkdir -p " TEST_INBOUND);
+    (void)status;
+}
+
+/* Helper function to write a file and return its CRC */
+unsigned long write_test_file(const char* path, const char* content) {
+    FILE* fp;
+
+    fp = fopen(path, "wb");
+    if (!fp) return 0;
+    fputs(content, fp);
+    fclose(fp);
+    return (unsigned long)ftn_crc32_calculate((const uint8_t*)content, strlen(content));
+}
+
+/* Helper function to write an inbound TIC */
+void write_test_tic(const char* path, unsigned long crc, const char* extra) {
+    FILE* fp;
+
+    fp = fopen(path, "w");
+    if (!fp) return;
+    fprintf(fp, "Area NODEDIFF\r\nOrigin 1:2/3\r\nFrom 1:2/3\r\nFile nodediff.a01\r\n");
+    fprintf(fp, "Desc Weekly nodelist difference\r\nSize %lu\r\nCrc %08lX\r\n",
+            (unsigned long)strlen(TEST_CONTENT), crc);
+    fprintf(fp, "Created by hatch 1.0\r\nPath 1:2/3 1700000000\r\nSeenby 1:2/3\r\n");
+    fprintf(fp, "%sPw secret\r\n", extra ? extra : "");
+    fclose(fp);
+}
+
+/* Helper function to check whether a file contains a string */
+int file_contains(const char* path, const char* needle) {
+    FILE* fp;
+    char buffer[4096];
+    size_t bytes;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 0;
+    bytes = fread(buffer, 1, sizeof(buffer) - 1, fp);
+    fclose(fp);
+    buffer[bytes] = '\0';
+    return strstr(buffer, needle) != NULL;
+}
+
+void test_parse_and_write(void) {
+    ftn_tic_t* tic = NULL;
+    ftn_tic_t* copy = NULL;
+    ftn_address_t addr;
+
+    test_start("TIC parse and write");
+    reset_test_dirs();
+
+    write_test_tic(TEST_INBOUND "/test.tic", 0x1234ABCDUL, "Seenby 1:2/4\r\nLDesc Line one\r\n");
+    if (ftn_tic_parse(TEST_INBOUND "/test.tic", &tic) != FTN_OK) {
+        test_fail("Failed to parse TIC");
+        return;
+    }
+
+    ftn_address_parse("1:2/4", &addr);
+    if (strcmp(tic->area, "NODEDIFF") != 0 || strcmp(tic->file, "nodediff.a01") != 0 ||
+        !tic->has_crc || tic->crc != 0x1234ABCDUL || tic->size != strlen(TEST_CONTENT) ||
+        tic->seenby_count != 2 || !ftn_tic_is_seenby(tic, &addr) ||
+        tic->path_count != 1 || tic->ldesc_count != 1 || tic->extra_count != 1 ||
+        strcmp(tic->extra[0], "Created by hatch 1.0") != 0 || strcmp(tic->password, "secret") != 0) {
+        test_fail("Parsed fields wrong");
+        ftn_tic_free(tic);
+        return;
+    }
+
+    if (ftn_tic_write(tic, TEST_INBOUND "/copy.tic") != FTN_OK ||
+        ftn_tic_parse(TEST_INBOUND "/copy.tic", &copy) != FTN_OK) {
+        test_fail("Round trip failed");
+    } else if (copy->crc != tic->crc || copy->seenby_count != 2 ||
+               strcmp(copy->extra[0], tic->extra[0]) != 0 || strcmp(copy->desc, tic->desc) != 0) {
+        test_fail("Round trip changed fields");
+    } else {
+        test_pass();
+    }
+
+    ftn_tic_free(copy);
+    ftn_tic_free(tic);
+}
+
+void test_unsafe_names(void) {
+    ftn_tic_t* tic = NULL;
+    FILE* fp;
+
+    test_start("TIC unsafe file names");
+    reset_test_dirs();
+
+    fp = fopen(TEST_INBOUND "/evil.tic", "w");
+    if (!fp) {
+        test_fail("Failed to write TIC");
+        return;
+    }
+    fprintf(fp, "Area NODEDIFF\r\nFile ../../etc/passwd\r\n");
+    fclose(fp);
+
+    if (ftn_tic_parse(TEST_INBOUND "/evil.tic", &tic) != FTN_ERROR_PARSE) {
+        test_fail("Path traversal accepted");
+        ftn_tic_free(tic);
+    } else {
+        test_pass();
+    }
+}
+
+void test_validate(void) {
+    ftn_tic_t* tic;
+    unsigned long crc;
+
+    test_start("TIC file validation");
+    reset_test_dirs();
+
+    tic = ftn_tic_new();
+    if (!tic) {
+        test_fail("Failed to create TIC");
+        return;
+    }
+
+    crc = write_test_file(TEST_INBOUND "/nodediff.a01", TEST_CONTENT);
+    tic->size = strlen(TEST_CONTENT);
+    tic->has_size = 1;
+    tic->crc = crc;
+    tic->has_crc = 1;
+
+    if (ftn_tic_validate(tic, TEST_INBOUND "/nodediff.a01") != FTN_OK) {
+        test_fail("Good file rejected");
+    } else if (ftn_tic_validate(tic, TEST_INBOUND "/missing.a01") != FTN_ERROR_NOTFOUND) {
+        test_fail("Missing file not reported");
+    } else {
+        tic->crc = crc ^ 1;
+        if (ftn_tic_validate(tic, TEST_INBOUND "/nodediff.a01") != FTN_ERROR_CRC) {
+            test_fail("Bad CRC accepted");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_tic_free(tic);
+}
+
+void test_process_fanout(void) {
+    ftn_areafix_t* subs;
+    ftn_tic_context_t ctx;
+    ftn_address_t addr;
+    struct stat st;
+    unsigned long crc;
+    size_t id, area, sent = 0;
+    test_start("TIC hard-link fan-out");
+    reset_test_dirs();
+
+    subs = ftn_areafix_new(NULL);
+    if (!subs) {
+        test_fail("Failed to create subscriptions");
+        return;
+    }
+    ftn_areafix_add_area(subs, "nodediff", &area);
+    ftn_address_parse("1:2/3", &addr);
+    ftn_areafix_add_link(subs, &addr, "secret", &id);
+    ftn_areafix_subscribe(subs, area, id);
+    ftn_address_parse("1:2/4", &addr);
+    ftn_areafix_add_link(subs, &addr, NULL, &id);
+    ftn_areafix_subscribe(subs, area, id);
+    ftn_address_parse("1:5/6.7", &addr);
+    ftn_areafix_add_link(subs, &addr, NULL, &id);
+    ftn_areafix_subscribe(subs, area, id);
+    ftn_address_parse("1:5/8", &addr);
+    ftn_areafix_add_link(subs, &addr, NULL, &id);
+    ftn_areafix_subscribe(subs, area, id);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ftn_address_parse("1:2/1", &ctx.address);
+    ctx.fileecho_path = TEST_AREAS;
+    ctx.filebox_path = TEST_FILEBOX;
+    ctx.outbound_path = TEST_OUTBOUND;
+    ctx.subscriptions = subs;
+
+    crc = write_test_file(TEST_INBOUND "/NODEDIFF.A01", TEST_CONTENT);
+    write_test_tic(TEST_INBOUND "/test.tic", crc, "Seenby 1:5/8\r\n");
+
+    /* Sender 1:2/3 and seen-by 1:5/8 are skipped, so two links get the file */
+    if (ftn_tic_process(&ctx, TEST_INBOUND "/test.tic", &sent) != FTN_OK || sent != 2) {
+        test_fail("Processing failed");
+    } else if (stat(TEST_AREAS "/nodediff/nodediff.a01", &st) != 0) {
+        test_fail("File not stored in area");
+    } else if (st.st_nlink != 3) {
+        test_fail("Links do not share the stored file");
+    } else if (!file_contains(TEST_OUTBOUND "/00020004.flo", "^" TEST_FILEBOX "/1.2.4.0/nodediff.a01") ||
+               !file_contains(TEST_OUTBOUND "/00020004.flo", ".tic\n") ||
+               !file_contains(TEST_OUTBOUND "/00050006.pnt/00000007.flo", "^" TEST_FILEBOX "/1.5.6.7/")) {
+        test_fail("Flow files not written");
+    } else if (stat(TEST_OUTBOUND "/00020003.flo", &st) == 0 ||
+               stat(TEST_OUTBOUND "/00050008.flo", &st) == 0) {
+        test_fail("File sent back to a link that has it");
+    } else {
+        test_pass();
+    }
+
+    /* A file that has not arrived yet leaves the TIC waiting */
+    test_start("TIC waiting for its file");
+    write_test_tic(TEST_INBOUND "/late.tic", crc, NULL);
+    if (ftn_tic_process(&ctx, TEST_INBOUND "/late.tic", &sent) != FTN_ERROR_NOTFOUND) {
+        test_fail("Missing file not reported");
+    } else {
+        test_pass();
+    }
+
+    ftn_areafix_free(subs);
+}
+
+void test_process_security(void) {
+    ftn_areafix_t* subs;
+    ftn_tic_context_t ctx;
+    ftn_address_t addr;
+    struct stat st;
+    unsigned long crc;
+    size_t id, area, sent = 0;
+
+    test_start("TIC from unknown link refused");
+    reset_test_dirs();
+
+    subs = ftn_areafix_new(NULL);
+    if (!subs) {
+        test_fail("Failed to create subscriptions");
+        return;
+    }
+    ftn_areafix_add_area(subs, "nodediff", &area);
+    ftn_address_parse("1:2/4", &addr);
+    ftn_areafix_add_link(subs, &addr, "secret", &id);
+    ftn_areafix_subscribe(subs, area, id);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ftn_address_parse("1:2/1", &ctx.address);
+    ctx.fileecho_path = TEST_AREAS;
+    ctx.filebox_path = TEST_FILEBOX;
+    ctx.outbound_path = TEST_OUTBOUND;
+    ctx.bad_path = TEST_BAD;
+    ctx.subscriptions = subs;
+
+    crc = write_test_file(TEST_INBOUND "/NODEDIFF.A01", TEST_CONTENT);
+    write_test_tic(TEST_INBOUND "/test.tic", crc, NULL);
+    if (ftn_tic_process(&ctx, TEST_INBOUND "/test.tic", &sent) != FTN_ERROR_INVALID || sent != 0) {
+        test_fail("TIC from 1:2/3 was accepted");
+    } else if (stat(TEST_BAD "/NODEDIFF.A01", &st) != 0 ||
+               stat(TEST_AREAS "/nodediff/nodediff.a01", &st) == 0) {
+        test_fail("Refused file not moved to bad");
+    } else {
+        test_pass();
+    }
+
+    /* A link without a password needs the insecure flag */
+    test_start("TIC from link without password");
+    ftn_address_parse("1:2/3", &addr);
+    ftn_areafix_add_link(subs, &addr, NULL, &id);
+    crc = write_test_file(TEST_INBOUND "/NODEDIFF.A01", TEST_CONTENT);
+    if (ftn_tic_process(&ctx, TEST_INBOUND "/test.tic", &sent) != FTN_ERROR_INVALID) {
+        test_fail("Link without password was trusted");
+    } else {
+        subs->links[id].insecure = 1;
+        crc = write_test_file(TEST_INBOUND "/NODEDIFF.A01", TEST_CONTENT);
+        if (ftn_tic_process(&ctx, TEST_INBOUND "/test.tic", &sent) != FTN_OK || sent != 1) {
+            test_fail("Insecure link was refused");
+        } else {
+            test_pass();
+        }
+    }
+
+    /* A damaged file goes to bad instead of staying in the inbox */
+    test_start("TIC with bad CRC");
+    write_test_file(TEST_INBOUND "/NODEDIFF.A01", "Damaged in transit\r\n");
+    remove(TEST_BAD "/NODEDIFF.A01");
+    if (ftn_tic_process(&ctx, TEST_INBOUND "/test.tic", &sent) != FTN_ERROR_CRC) {
+        test_fail("Damaged file was accepted");
+    } else if (stat(TEST_BAD "/NODEDIFF.A01", &st) != 0 ||
+               stat(TEST_INBOUND "/NODEDIFF.A01", &st) == 0) {
+        test_fail("Damaged file not moved to bad");
+    } else {
+        test_pass();
+    }
+
+    (void)crc;
+    ftn_areafix_free(subs);
+}
+
+/* A link that cannot be queued keeps the TIC for a retry to that link alone */
+void test_process_partial_failure(void) {
+    ftn_areafix_t* subs;
+    ftn_tic_context_t ctx;
+    ftn_tic_t* kept = NULL;
+    ftn_address_t addr;
+    struct stat st;
+    unsigned long crc;
+    size_t id, area, sent = 0;
+    FILE* fp;
+
+    test_start("TIC kept when a link cannot be queued");
+    reset_test_dirs();
+    system("mkdir -p " TEST_FILEBOX);
+
+    subs = ftn_areafix_new(NULL);
+    if (!subs) {
+        test_fail("Failed to create subscriptions");
+        return;
+    }
+    ftn_areafix_add_area(subs, "nodediff", &area);
+    ftn_address_parse("1:2/3", &addr);
+    ftn_areafix_add_link(subs, &addr, "secret", &id);
+    ftn_areafix_subscribe(subs, area, id);
+    ftn_address_parse("1:2/4", &addr);
+    ftn_areafix_add_link(subs, &addr, NULL, &id);
+    ftn_areafix_subscribe(subs, area, id);
+    ftn_address_parse("1:5/6.7", &addr);
+    ftn_areafix_add_link(subs, &addr, NULL, &id);
+    ftn_areafix_subscribe(subs, area, id);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ftn_address_parse("1:2/1", &ctx.address);
+    ctx.fileecho_path = TEST_AREAS;
+    ctx.filebox_path = TEST_FILEBOX;
+    ctx.outbound_path = TEST_OUTBOUND;
+    ctx.bad_path = TEST_BAD;
+    ctx.subscriptions = subs;
+
+    /* A plain file where 1:5/6.7's filebox should be */
+    fp = fopen(TEST_FILEBOX "/1.5.6.7", "w");
+    if (fp) fclose(fp);
+
+    crc = write_test_file(TEST_INBOUND "/NODEDIFF.A01", TEST_CONTENT);
+    write_test_tic(TEST_INBOUND "/test.tic", crc, NULL);
+
+    ftn_address_parse("1:2/4", &addr);
+    if (ftn_tic_process(&ctx, TEST_INBOUND "/test.tic", &sent) != FTN_ERROR_FILE || sent != 1) {
+        test_fail("Failed link not reported");
+    } else if (stat(TEST_INBOUND "/NODEDIFF.A01", &st) != 0) {
+        test_fail("File not kept beside its TIC");
+    } else if (ftn_tic_parse(TEST_INBOUND "/test.tic", &kept) != FTN_OK ||
+               !ftn_tic_is_seenby(kept, &addr) || kept->seenby_count != 2) {
+        test_fail("Kept TIC does not list the link already served");
+    } else {
+        remove(TEST_FILEBOX "/1.5.6.7");
+        remove(TEST_OUTBOUND "/00020004.flo");
+        if (ftn_tic_process(&ctx, TEST_INBOUND "/test.tic", &sent) != FTN_OK || sent != 1) {
+            test_fail("Retry failed");
+        } else if (!file_contains(TEST_OUTBOUND "/00050006.pnt/00000007.flo",
+                                  "^" TEST_FILEBOX "/1.5.6.7/nodediff.a01")) {
+            test_fail("Retry did not queue the failed link");
+        } else if (stat(TEST_OUTBOUND "/00020004.flo", &st) == 0) {
+            test_fail("Retry sent the file twice");
+        } else if (stat(TEST_INBOUND "/NODEDIFF.A01", &st) == 0) {
+            test_fail("File left in the inbox after the retry");
+        } else {
+            test_pass();
+        }
+    }
+
+    ftn_tic_free(kept);
+    ftn_areafix_free(subs);
+}
+
+void test_deferred_references(void) {
+    struct {
+        int zone, net, node, point;
+        char* domain;
+    } bso_addr;
+    struct stat st;
+    size_t waiting = 99;
+    FILE* fp;
+
+    test_start("references deferred for a busy link");
+    reset_test_dirs();
+    system("mkdir -p " TEST_OUTBOUND);
+
+    memset(&bso_addr, 0, sizeof(bso_addr));
+    bso_addr.zone = 1;
+    bso_addr.net = 2;
+    bso_addr.node = 4;
+
+    fp = fopen(TEST_OUTBOUND "/00020004.bsy", "w");
+    if (fp) fclose(fp);
+
+    if (ftn_flow_append_reference(TEST_OUTBOUND, (struct ftn_address*)&bso_addr, FLOW_FLAVOR_NORMAL,
+                                  "/files/a.zip", REF_DIRECTIVE_DELETE) != BSO_ERROR_BUSY) {
+        test_fail("Append ignored the .bsy");
+    } else if (ftn_flow_queue_reference(TEST_OUTBOUND, (struct ftn_address*)&bso_addr, FLOW_FLAVOR_NORMAL,
+                                        "/files/a.zip", REF_DIRECTIVE_DELETE) != BSO_OK ||
+               ftn_flow_queue_reference(TEST_OUTBOUND, (struct ftn_address*)&bso_addr, FLOW_FLAVOR_NORMAL,
+                                        "/files/a.tic", REF_DIRECTIVE_DELETE) != BSO_OK) {
+        test_fail("Queueing for a busy link failed");
+    } else if (stat(TEST_OUTBOUND "/00020004.flo", &st) == 0) {
+        test_fail("Flow file written while the link was busy");
+    } else if (ftn_flow_attach_deferred(TEST_OUTBOUND, &waiting) != BSO_OK || waiting != 2) {
+        test_fail("Busy link's references were attached");
+    } else {
+        remove(TEST_OUTBOUND "/00020004.bsy");
+        if (ftn_flow_attach_deferred(TEST_OUTBOUND, &waiting) != BSO_OK || waiting != 0) {
+            test_fail("References not attached once the link was free");
+        } else if (!file_contains(TEST_OUTBOUND "/00020004.flo", "^/files/a.zip\n^/files/a.tic\n")) {
+            test_fail("References attached out of order");
+        } else if (stat(TEST_OUTBOUND "/00020004.bsy", &st) == 0) {
+            test_fail("Lock left behind");
+        } else {
+            test_pass();
+        }
+    }
+}
+
+int main(void) {
+    printf("TIC File Echo Tests\n");
+    printf("===================\n\n");
+
+    test_parse_and_write();
+    test_unsafe_names();
+    test_validate();
+    test_process_fanout();
+    test_process_security();
+    test_process_partial_failure();
+    test_deferred_references();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}
@@ -0,0 +1,187 @@
+/*
+ * test_tls.c - binkps certificate verification tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "ftn.h"
+#include "ftn/net.h"
+#include "ftn/tls.h"
+
+#define TEST_ROOT "tmp/test_tls"
+#define TEST_CERT TEST_ROOT "/hub.pem"
+#define TEST_KEY  TEST_ROOT "/hub.key"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+/* The hub's self-signed certificate, issued to "localhost" */
+static int make_certificate(char* fingerprint, size_t size) {
+    char line[256];
+    char* value;
+    FILE* fp;
+    int status;
+
+    status = system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT " && "
+                    "openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj /CN=localhost "
+                    "-addext subjectAltName=DNS:localhost "
+                    "-keyout " TEST_KEY " -out " TEST_CERT " >/dev/null 2>&1");
+    if (status != 0) {
+        return 0;
+    }
+
+    fp = popen("openssl x509 -noout -fingerprint -sha256 -in " TEST_CERT, "r");
+    if (!fp) {
+        return 0;
+    }
+    line[0] = '\0';
+    if (!fgets(line, sizeof(line), fp)) {
+        line[0] = '\0';
+    }
+    pclose(fp);
+
+    value = strchr(line, '=');
+    if (!value) {
+        return 0;
+    }
+    value++;
+    value[strcspn(value, "\r\n")] = '\0';
+    strncpy(fingerprint, value, size - 1);
+    fingerprint[size - 1] = '\0';
+    return 1;
+}
+
+/*
+ * Run one binkps handshake against a hub in a child process. Returns the
+ * client's ftn_tls_start result.
+ */
+static ftn_error_t handshake(int port, const char* ca_file, const char* fingerprint, const char* server_name) {
+    ftn_net_server_t* server;
+    ftn_net_connection_t* conn;
+    ftn_tls_context_t* tls;
+    ftn_error_t result = FTN_ERROR_NETWORK;
+    pid_t child;
+    int status;
+
+    server = ftn_net_listen(port, "127.0.0.1", 4);
+    if (!server) {
+        return FTN_ERROR_NETWORK;
+    }
+
+    child = fork();
+    if (child == 0) {
+        tls = ftn_tls_context_new(1, TEST_CERT, TEST_KEY, NULL);
+        conn = ftn_net_accept(server, 5000);
+        if (tls && conn) {
+            ftn_tls_start(tls, conn, NULL);
+        }
+        ftn_net_connection_free(conn);
+        ftn_tls_context_free(tls);
+        _exit(0);
+    }
+
+    tls = ftn_tls_context_new(0, NULL, NULL, ca_file);
+    conn = ftn_net_connect("127.0.0.1", port, 2000);
+    if (tls && conn && fingerprint) {
+        result = ftn_tls_context_set_fingerprint(tls, fingerprint);
+    }
+    if (tls && conn && (!fingerprint || result == FTN_OK)) {
+        result = ftn_tls_start(tls, conn, server_name);
+    }
+
+    ftn_net_connection_free(conn);
+    ftn_tls_context_free(tls);
+    ftn_net_server_free(server);
+    if (child > 0) {
+        waitpid(child, &status, 0);
+    }
+    return result;
+}
+
+static int test_port(int offset) {
+    return 30000 + (int)(getpid() % 10000) * 2 + offset;
+}
+
+void test_verification(const char* fingerprint) {
+    char wrong[128];
+
+    test_start("hub verified against the CA file and its name");
+    if (handshake(test_port(0), TEST_CERT, NULL, "localhost") != FTN_OK) {
+        test_fail("Trusted hub rejected");
+    } else if (handshake(test_port(1), TEST_CERT, NULL, "hub.example.net") == FTN_OK) {
+        test_fail("Certificate for another name accepted");
+    } else if (handshake(test_port(0), TEST_CERT, NULL, NULL) == FTN_OK) {
+        test_fail("Session without a name to check accepted");
+    } else {
+        test_pass();
+    }
+
+    test_start("untrusted self-signed hub rejected");
+    if (handshake(test_port(1), NULL, NULL, "localhost") == FTN_OK) {
+        test_fail("Hub outside the CA store accepted");
+    } else {
+        test_pass();
+    }
+
+    test_start("hub pinned by fingerprint");
+    strcpy(wrong, fingerprint);
+    wrong[0] = (char)(wrong[0] == '0' ? '1' : '0');
+    if (handshake(test_port(0), NULL, fingerprint, "127.0.0.1") != FTN_OK) {
+        test_fail("Pinned hub rejected");
+    } else if (handshake(test_port(1), NULL, wrong, "127.0.0.1") == FTN_OK) {
+        test_fail("Wrong fingerprint accepted");
+    } else if (handshake(test_port(0), NULL, "AB:CD", "127.0.0.1") == FTN_OK) {
+        test_fail("Short fingerprint accepted");
+    } else {
+        test_pass();
+    }
+}
+
+int main(void) {
+    char fingerprint[128];
+
+    printf("TLS Tests\n");
+    printf("=========\n\n");
+
+    if (!ftn_tls_available()) {
+        printf("Built without TLS support (make WITH_TLS=1), skipping\n");
+    } else if (!make_certificate(fingerprint, sizeof(fingerprint))) {
+        printf("Cannot create a test certificate with openssl, skipping\n");
+    } else {
+        test_verification(fingerprint);
+    }
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}
@@ -0,0 +1,327 @@
+/*
+ * test_tosser.c - Tosser state and pass tests
+ * Copyright (c) 2025 Andrew C. Young <andrew@vaelen.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "ftn.h"
+#include "ftn/compat.h"
+#include "ftn/config.h"
+#include "ftn/packet.h"
+#include "ftn/tosser.h"
+
+#define TEST_ROOT      "tmp/test_tosser"
+#define TEST_CONFIG    TEST_ROOT "/ftn.ini"
+#define TEST_INBOX     TEST_ROOT "/inbox"
+#define TEST_PROCESSED TEST_ROOT "/processed"
+#define TEST_DUPE_DB   TEST_ROOT "/dupes.db"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+void test_start(const char* test_name) {
+    printf("Testing %s... ", test_name);
+    fflush(stdout);
+}
+
+void test_pass(void) {
+    printf("PASS\n");
+    tests_passed++;
+    tests_run++;
+}
+
+void test_fail(const char* message) {
+    printf("FAIL: %s\n", message);
+    tests_run++;
+}
+
+static int file_exists(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+/* Helper function to start from an empty network with a fresh config; the
+   news and mail sections name either a spool or a server */
+static ftn_config_t* setup_network_with(const char* news, const char* mail) {
+    ftn_config_t* config;
+    FILE* fp;
+    int status;
+
+    status = system("rm -rf " TEST_ROOT " && mkdir -p " TEST_INBOX " " TEST_PROCESSED " "
+                    TEST_ROOT "/bad " TEST_ROOT "/news " TEST_ROOT "/mail");
+    (void)status;
+
+    fp = fopen(TEST_CONFIG, "w");
+    if (!fp) {
+        return NULL;
+    }
+    fprintf(fp,
+            "[node]\n"
+            "name = Test Node\n"
+            "networks = testnet\n"
+            "sysop = testuser\n"
+            "sysop_name = Test User\n"
+            "\n"
+            "[news]\n"
+            "%s\n"
+            "\n"
+            "[mail]\n"
+            "%s\n"
+            "\n"
+            "[testnet]\n"
+            "name = TestNet\n"
+            "domain = test.example.com\n"
+            "address = 99:1/1.0\n"
+            "hub = 99:1/0\n"
+            "inbox = " TEST_INBOX "\n"
+            "processed = " TEST_PROCESSED "\n"
+            "bad = " TEST_ROOT "/bad\n"
+            "duplicate_db = " TEST_DUPE_DB "\n",
+            news, mail);
+    fclose(fp);
+
+    config = ftn_config_new();
+    if (config && ftn_config_load(config, TEST_CONFIG) != FTN_OK) {
+        ftn_config_free(config);
+        config = NULL;
+    }
+    return config;
+}
+
+static ftn_config_t* setup_network(void) {
+    return setup_network_with("path = " TEST_ROOT "/news", "inbox = " TEST_ROOT "/mail/%USER%");
+}
+
+/* Write a packet with one message from the hub: echomail in the area, or
+   netmail to the sysop without one */
+static int write_message_packet(const char* path, const char* msgid, const char* area) {
+    ftn_packet_t* packet;
+    ftn_message_t* msg;
+    ftn_address_t hub = {99, 1, 0, 0};
+    ftn_address_t node = {99, 1, 1, 0};
+    int ok;
+
+    packet = ftn_packet_new();
+    msg = ftn_message_new(area ? FTN_MSG_ECHOMAIL : FTN_MSG_NETMAIL);
+    if (!packet || !msg) {
+        ftn_packet_free(packet);
+        ftn_message_free(msg);
+        return 0;
+    }
+
+    packet->header.orig_zone = hub.zone;
+    packet->header.orig_net = hub.net;
+    packet->header.orig_node = hub.node;
+    packet->header.dest_zone = node.zone;
+    packet->header.dest_net = node.net;
+    packet->header.dest_node = node.node;
+
+    msg->orig_addr = hub;
+    msg->dest_addr = node;
+    msg->from_user = strdup("Hub Sysop");
+    msg->to_user = strdup(area ? "All" : "Test User");
+    msg->subject = strdup("Tosser test");
+    msg->text = strdup("Hello from the hub.\r\n");
+    msg->area = area ? strdup(area) : NULL;
+    msg->msgid = strdup(msgid);
+    msg->timestamp = time(NULL);
+    ftn_packet_add_message(packet, msg);
+
+    ok = ftn_packet_save(path, packet) == FTN_OK;
+    ftn_packet_free(packet);
+    return ok;
+}
+
+static int write_packet(const char* path, const char* msgid) {
+    return write_message_packet(path, msgid, "TESTAREA");
+}
+
+void test_lifecycle(void) {
+    ftn_config_t* config;
+    ftn_tosser_t* tosser;
+
+    test_start("tosser lifecycle");
+    config = setup_network();
+    if (!config) {
+        test_fail("Could not load config");
+        return;
+    }
+
+    if (ftn_tosser_new(NULL) != NULL) {
+        test_fail("Tosser created without a config");
+    } else if (!(tosser = ftn_tosser_new(config))) {
+        test_fail("Could not create tosser");
+    } else {
+        if (tosser->config != config || !tosser->storage || !tosser->dupecheck || !tosser->router ||
+            !tosser->outbound || tosser->outbound[0]) {
+            test_fail("Tosser state incomplete");
+        } else {
+            test_pass();
+        }
+        ftn_tosser_free(tosser);
+    }
+
+    ftn_tosser_free(NULL);
+    ftn_config_free(config);
+}
+
+void test_passes_share_state(void) {
+    ftn_config_t* config;
+    ftn_tosser_t* tosser;
+    ftn_toss_stats_t first;
+    ftn_toss_stats_t second;
+
+    test_start("passes share the duplicate database");
+    config = setup_network();
+    tosser = config ? ftn_tosser_new(config) : NULL;
+    if (!tosser) {
+        test_fail("Could not create tosser");
+        ftn_config_free(config);
+        return;
+    }
+
+    ftn_toss_stats_init(&first);
+    ftn_toss_stats_init(&second);
+
+    if (!write_packet(TEST_INBOX "/00000001.pkt", "1@99:1/0 00000001")) {
+        test_fail("Could not write packet");
+    } else if (ftn_tosser_process_inbox(tosser, 0, &first) != FTN_OK ||
+               first.packets_processed != 1 || first.messages_processed != 1 ||
+               first.messages_stored != 1 || first.duplicates_found != 0) {
+        test_fail("First pass did not toss the packet");
+    } else if (file_exists(TEST_INBOX "/00000001.pkt") || !file_exists(TEST_PROCESSED "/00000001.pkt")) {
+        test_fail("Packet not moved to processed");
+    } else if (!write_packet(TEST_INBOX "/00000002.pkt", "1@99:1/0 00000001")) {
+        test_fail("Could not write second packet");
+    } else if (ftn_tosser_process_inbox(tosser, 0, &second) != FTN_OK ||
+               second.packets_processed != 1 || second.duplicates_found != 1 ||
+               second.messages_stored != 0) {
+        test_fail("Second pass did not see the duplicate");
+    } else if (ftn_tosser_flush(tosser) != FTN_OK || !file_exists(TEST_DUPE_DB)) {
+        test_fail("Duplicate database not written");
+    } else {
+        test_pass();
+    }
+
+    ftn_tosser_free(tosser);
+    ftn_config_free(config);
+}
+
+void test_toss_packet(void) {
+    ftn_config_t* config;
+    ftn_tosser_t* tosser;
+    ftn_toss_stats_t stats;
+
+    test_start("tossing one packet without a scan");
+    config = setup_network();
+    tosser = config ? ftn_tosser_new(config) : NULL;
+    if (!tosser) {
+        test_fail("Could not create tosser");
+        ftn_config_free(config);
+        return;
+    }
+
+    ftn_toss_stats_init(&stats);
+    if (!write_packet(TEST_INBOX "/00000003.pkt", "1@99:1/0 00000003")) {
+        test_fail("Could not write packet");
+    } else if (ftn_tosser_toss_packet(tosser, TEST_INBOX "/00000003.pkt", 1, &stats) == FTN_OK) {
+        test_fail("Unknown network accepted");
+    } else if (ftn_tosser_toss_packet(tosser, TEST_INBOX "/00000003.pkt", 0, &stats) != FTN_OK ||
+               stats.messages_processed != 1 || stats.messages_stored != 1) {
+        test_fail("Packet not tossed");
+    } else {
+        test_pass();
+    }
+
+    ftn_tosser_free(tosser);
+    ftn_config_free(config);
+}
+
+void test_undelivered_packet_kept(void) {
+    ftn_config_t* config;
+    ftn_tosser_t* tosser;
+    ftn_toss_stats_t stats;
+
+    test_start("packet kept when its mail cannot be delivered");
+    config = setup_network_with("path = " TEST_ROOT "/news", "lmtp = unix:" TEST_ROOT "/no-such-mda.sock");
+    tosser = config ? ftn_tosser_new(config) : NULL;
+    if (!tosser) {
+        test_fail("Could not create tosser");
+        ftn_config_free(config);
+        return;
+    }
+
+    ftn_toss_stats_init(&stats);
+    if (!write_message_packet(TEST_INBOX "/00000004.pkt", "1@99:1/0 00000004", NULL)) {
+        test_fail("Could not write packet");
+    } else if (ftn_tosser_process_inbox(tosser, 0, &stats) == FTN_OK && stats.errors_encountered == 0) {
+        test_fail("Failed delivery not reported");
+    } else if (file_exists(TEST_PROCESSED "/00000004.pkt")) {
+        test_fail("Undelivered packet moved to processed");
+    } else if (!file_exists(TEST_ROOT "/bad/00000004.pkt")) {
+        test_fail("Undelivered packet not kept in bad");
+    } else {
+        test_pass();
+    }
+
+    ftn_tosser_free(tosser);
+    ftn_config_free(config);
+}
+
+void test_unfed_packet_kept(void) {
+    ftn_config_t* config;
+    ftn_tosser_t* tosser;
+    ftn_toss_stats_t stats;
+
+    test_start("packet kept when its articles cannot be fed");
+    config = setup_network_with("nntp = unix:" TEST_ROOT "/no-such-server.sock",
+                                "inbox = " TEST_ROOT "/mail/%USER%");
+    tosser = config ? ftn_tosser_new(config) : NULL;
+    if (!tosser) {
+        test_fail("Could not create tosser");
+        ftn_config_free(config);
+        return;
+    }
+
+    ftn_toss_stats_init(&stats);
+    if (!write_packet(TEST_INBOX "/00000005.pkt", "1@99:1/0 00000005")) {
+        test_fail("Could not write packet");
+    } else if (ftn_tosser_process_inbox(tosser, 0, &stats) == FTN_OK && stats.errors_encountered == 0) {
+        test_fail("Failed feed not reported");
+    } else if (file_exists(TEST_PROCESSED "/00000005.pkt")) {
+        test_fail("Unfed packet moved to processed");
+    } else if (!file_exists(TEST_ROOT "/bad/00000005.pkt")) {
+        test_fail("Unfed packet not kept in bad");
+    } else {
+        test_pass();
+    }
+
+    ftn_tosser_free(tosser);
+    ftn_config_free(config);
+}
+
+int main(void) {
+    printf("Tosser Tests\n");
+    printf("============\n\n");
+
+    test_lifecycle();
+    test_passes_share_state();
+    test_toss_packet();
+    test_undelivered_packet_kept();
+    test_unfed_packet_kept();
+
+    printf("\nTest Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    if (tests_passed == tests_run) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
+}